@@ -8,6 +8,9 @@
 
 #include <drivers/i2c.h>
 #include "Smbus_mailbox/Smbus_mailbox.h"
+#include "pfr/pfr_mailbox_fifo.h"
+#include "pfr/pfr_i2c_ring.h"
+#include "BmcI2C_handler.h"
 #ifdef CONFIG_INTEL_PFR_SUPPORT
 #include "intel_2.0/intel_pfr_verification.h"
 #include "intel_2.0/intel_pfr_provision.h"
@@ -18,14 +21,19 @@
 #endif
 #include <../../Silicon/AST1060/i2c/I2C_Slave_aspeed.h>
 // extern struct i2c_slave_callbacks i2c_1060_callbacks_pch;
-extern I2C_Slave_Process gI2cSlaveProcess;
 // extern struct i2c_slave_callbacks i2c_1060_callbacks_bmc;
 extern uint8_t gBmcFlag;
 extern uint8_t gProvisinDoneFlag;
-uint8_t gI2CReadFlag;
-uint8_t gDataReceived;
 EVENT_CONTEXT I2CData;
 AO_DATA I2CActiveObjectData;
+// Writes from the BMC, decoded by BmcI2cProcessCommands out of the ISR
+static struct pfr_i2c_ring gBmcI2cRing;
+static uint8_t gBmcAddress;
+// Block read response being sent to the BMC
+static uint8_t gBmcBlockBuf[PFR_MAILBOX_BLOCK_MAX];
+static size_t gBmcBlockLength;
+static size_t gBmcBlockIndex;
+static bool gBmcBlockRead;
 /*	* I2c slave device callback function.
  * there are 5 callback function need to creat and link into I2c slave device when initial I2c device as slave device
  * and callback function structure is
@@ -40,6 +48,9 @@ AO_DATA I2CActiveObjectData;
  *
  * in I2C write byte protcol, the slave callback function will in the following order
  * write_requested->write_receive(receive mailbox register address)->write_receive(receive mailbox command)
+ *
+ * The callbacks run in the ISR.  Writes only go into gBmcI2cRing, and the state machine is woken
+ * once to decode everything queued, so a burst of BMC writes does not stretch the clock.
  */
 
 /*	* i2c_1060_slave_cb2_write_requested
@@ -51,7 +62,10 @@ AO_DATA I2CActiveObjectData;
  */
 int i2c_1060_slave_bmc_write_requested(struct i2c_slave_config *config)
 {
-	gI2cSlaveProcess.operation = MASTER_CMD_READ;
+	PFR_I2C_TRACE(&gBmcI2cRing, PFR_I2C_TRACE_WRITE_REQUESTED, config->address);
+	gBmcAddress = config->address;
+	gBmcBlockRead = false;
+	pfr_i2c_ring_start(&gBmcI2cRing);
 
 	return 0;
 }
@@ -67,14 +81,27 @@ int i2c_1060_slave_bmc_write_requested(struct i2c_slave_config *config)
 int i2c_1060_slave_bmc_read_requested(struct i2c_slave_config *config,
 				      uint8_t *val)
 {
-	if (gI2cSlaveProcess.operation == MASTER_DATA_READ_SLAVE_DATA_SEND) {
-		gI2CReadFlag = TRUE;
-		gBmcFlag = TRUE;
-		*val = PchBmcCommands(gI2cSlaveProcess.DataBuf, gI2CReadFlag);
-		printk("read command:%x, return value:%x \n", gI2cSlaveProcess.DataBuf[0], *val);
+	uint8_t command[2] = {gBmcI2cRing.command, 0};
+
+	// The command byte written before the repeated start selects the register to read
+	pfr_i2c_ring_abort(&gBmcI2cRing);
+	if (gBmcI2cRing.length > 0) {
+		if (command[0] == UFM_READ_FIFO_BLOCK) {
+			// The whole response is built now and sent as the BMC clocks it out
+			int length = SmbusMailboxBlockRead(config->address, UFM_READ_FIFO_BLOCK, gBmcBlockBuf,
+							   sizeof(gBmcBlockBuf));
+
+			gBmcBlockLength = (length > 0) ? length : 0;
+			gBmcBlockIndex = 0;
+			gBmcBlockRead = true;
+			*val = (gBmcBlockLength > 0) ? gBmcBlockBuf[gBmcBlockIndex++] : 0;
+		} else {
+			gBmcFlag = TRUE;
+			*val = PchBmcCommands(command, TRUE);
+		}
 	}
-	gDataReceived = 0;
-	ClearI2cSlaveProcessData();
+	PFR_I2C_TRACE(&gBmcI2cRing, PFR_I2C_TRACE_READ_REQUESTED, *val);
+
 	return 0;
 }
 
@@ -89,32 +116,8 @@ int i2c_1060_slave_bmc_read_requested(struct i2c_slave_config *config,
 int i2c_1060_slave_bmc_write_received(struct i2c_slave_config *config,
 				      uint8_t val)
 {
-	// read protocol to read master command
-	if (gI2cSlaveProcess.operation == MASTER_CMD_READ) {
-		gI2cSlaveProcess.DataBuf[SLAVE_BUF_INDEX0] = val;
-		gI2cSlaveProcess.operation = MASTER_DATA_READ_SLAVE_DATA_SEND;
-	}
-
-	// write protocol to read master data after read master command
-	if (gI2cSlaveProcess.operation == MASTER_DATA_READ_SLAVE_DATA_SEND) {
-		gI2cSlaveProcess.DataBuf[SLAVE_BUF_INDEX1] = val;
-		gI2cSlaveProcess.InProcess = I2CInProcess_Flag;
-		gBmcFlag = TRUE;
-		gDataReceived = gDataReceived + 1;
-		// printk("write command :%x %x\n", gI2cSlaveProcess.DataBuf[0],gI2cSlaveProcess.DataBuf[1]);
-	}
-
-	if (gDataReceived == 2) {
-
-		I2CActiveObjectData.ProcessNewCommand = 1;
-		I2CActiveObjectData.type = I2C_EVENT;
-
-		I2CData.operation = I2C_HANDLE;
-		I2CData.i2c_data = gI2cSlaveProcess.DataBuf;
-		post_smc_action(I2C, &I2CActiveObjectData, &I2CData);
-		printk("write command :%x %x\n", gI2cSlaveProcess.DataBuf[0],gI2cSlaveProcess.DataBuf[1]);
-		gDataReceived = 0;
-	}
+	PFR_I2C_TRACE(&gBmcI2cRing, PFR_I2C_TRACE_WRITE_RECEIVED, val);
+	pfr_i2c_ring_put(&gBmcI2cRing, val);
 
 	return 0;
 }
@@ -130,7 +133,10 @@ int i2c_1060_slave_bmc_write_received(struct i2c_slave_config *config,
 int i2c_1060_slave_bmc_read_processed(struct i2c_slave_config *config,
 				      uint8_t *val)
 {
-	// printk("i2c_1060_slave_cb2_read_processed read_processed *val = %x\n",val);
+	if (gBmcBlockRead)
+		*val = (gBmcBlockIndex < gBmcBlockLength) ? gBmcBlockBuf[gBmcBlockIndex++] : 0xff;
+	PFR_I2C_TRACE(&gBmcI2cRing, PFR_I2C_TRACE_READ_PROCESSED, *val);
+
 	return 0;
 }
 
@@ -143,11 +149,47 @@ int i2c_1060_slave_bmc_read_processed(struct i2c_slave_config *config,
  */
 int i2c_1060_slave_bmc_stop(struct i2c_slave_config *config)
 {
-	// printk("i2c_1060_slave_cb2_stop stop\n");
+	PFR_I2C_TRACE(&gBmcI2cRing, PFR_I2C_TRACE_STOP, gBmcI2cRing.length);
+	gBmcBlockRead = false;
+
+	// A lone command byte only selects the register for a read that follows
+	if (gBmcI2cRing.length == 1)
+		pfr_i2c_ring_abort(&gBmcI2cRing);
+
+	if (pfr_i2c_ring_stop(&gBmcI2cRing)) {
+		I2CActiveObjectData.type = I2C_EVENT;
+		I2CData.operation = I2C_HANDLE;
+		I2CData.i2c_data = NULL;
+		if (post_smc_action(I2C, &I2CActiveObjectData, &I2CData))
+			pfr_i2c_ring_rearm(&gBmcI2cRing);
+	}
 
 	return 0;
 }
 
+/*	* BmcI2cProcessCommands
+ * decode the writes queued by the BMC callbacks, in thread context
+ *
+ * @param None
+ *
+ * @return None
+ */
+void BmcI2cProcessCommands(void)
+{
+	uint8_t msg[PFR_I2C_RING_MSG_MAX];
+	size_t length;
+
+	while ((length = pfr_i2c_ring_get(&gBmcI2cRing, msg, sizeof(msg))) != 0) {
+		if (msg[0] == UFM_WRITE_FIFO_BLOCK) {
+			// A block longer than the FIFO is rejected as having a bad length
+			SmbusMailboxBlockWrite(gBmcAddress, msg, length);
+		} else if (length >= 2) {
+			gBmcFlag = TRUE;
+			PchBmcCommands(msg, 0);
+		}
+	}
+}
+
 /*	* i2c_1060_callbacks_2
  * callback function for I2C_2
  */
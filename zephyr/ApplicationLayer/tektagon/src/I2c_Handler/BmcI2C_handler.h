@@ -4,4 +4,11 @@
 //*                                                                     *//
 //*        All rights reserved. Subject to AMI licensing agreement.     *//
 //*                                                                     *//
-//***********************************************************************//
\ No newline at end of file
+//***********************************************************************//
+
+#ifndef BMC_I2C_HANDLER_H
+#define BMC_I2C_HANDLER_H
+
+void BmcI2cProcessCommands(void);
+
+#endif /*BMC_I2C_HANDLER_H*/
@@ -9,6 +9,9 @@
 #include <drivers/i2c.h>
 
 #include <../../Silicon/AST1060/i2c/I2C_Slave_aspeed.h>
+#include "Smbus_mailbox/Smbus_mailbox.h"
+#include "pfr/pfr_i2c_ring.h"
+#include "PchI2c_handler.h"
 #ifdef CONFIG_INTEL_PFR_SUPPORT
 #include "intel_2.0/intel_pfr_verification.h"
 #include "intel_2.0/intel_pfr_provision.h"
@@ -18,8 +21,11 @@
 #include "cerberus/cerberus_pfr_provision.h"
 #endif
 // extern struct i2c_slave_callbacks i2c_1060_callbacks_pch;
-extern I2C_Slave_Process gI2cSlaveProcess;
 extern uint8_t gBmcFlag;
+extern EVENT_CONTEXT I2CData;
+extern AO_DATA I2CActiveObjectData;
+// Writes from the PCH, decoded by PchI2cProcessCommands out of the ISR
+static struct pfr_i2c_ring gPchI2cRing;
 
 
 /*	* i2c_1060_slave_cb1_write_requested
@@ -31,8 +37,9 @@ extern uint8_t gBmcFlag;
  */
 int i2c_1060_slave_pch_write_requested(struct i2c_slave_config *config)
 {
-	gI2cSlaveProcess.operation = MASTER_CMD_READ;
-	printk("i2c_1060_slave_cb1_write_requested write_requested\n");
+	PFR_I2C_TRACE(&gPchI2cRing, PFR_I2C_TRACE_WRITE_REQUESTED, config->address);
+	pfr_i2c_ring_start(&gPchI2cRing);
+
 	return 0;
 }
 
@@ -47,13 +54,17 @@ int i2c_1060_slave_pch_write_requested(struct i2c_slave_config *config)
 int i2c_1060_slave_pch_read_requested(struct i2c_slave_config *config,
 				      uint8_t *val)
 {
-	if (gI2cSlaveProcess.operation == MASTER_DATA_READ_SLAVE_DATA_SEND) {
+	uint8_t command[2] = {gPchI2cRing.command, 0};
+
+	// The command byte written before the repeated start selects the register to read
+	pfr_i2c_ring_abort(&gPchI2cRing);
+	if (gPchI2cRing.length > 0) {
 		gBmcFlag = FALSE;
-		*val = PchBmcCommands(&gI2cSlaveProcess.DataBuf[SLAVE_BUF_INDEX0]);
+		*val = PchBmcCommands(command, TRUE);
 	}
-	printk("i2c_1060_slave_cb1_read_requested read_requested *val = %x\n", *val);
-	ClearI2cSlaveProcessData();
-	return *val;
+	PFR_I2C_TRACE(&gPchI2cRing, PFR_I2C_TRACE_READ_REQUESTED, *val);
+
+	return 0;
 }
 
 /*	* i2c_1060_slave_cb1_write_received
@@ -67,20 +78,9 @@ int i2c_1060_slave_pch_read_requested(struct i2c_slave_config *config,
 int i2c_1060_slave_pch_write_received(struct i2c_slave_config *config,
 				      uint8_t val)
 {
-	printk("i2c_1060_slave_cb1_write_received write_received val = %x\n", val);
-	// read protocol to read master command
-	if (gI2cSlaveProcess.operation == MASTER_CMD_READ) {
-		gI2cSlaveProcess.DataBuf[SLAVE_BUF_INDEX0] = val;
-		gI2cSlaveProcess.operation = MASTER_DATA_READ_SLAVE_DATA_SEND;
-	}
+	PFR_I2C_TRACE(&gPchI2cRing, PFR_I2C_TRACE_WRITE_RECEIVED, val);
+	pfr_i2c_ring_put(&gPchI2cRing, val);
 
-	// write protocol to read master data after read master command
-	if (gI2cSlaveProcess.operation == MASTER_DATA_READ_SLAVE_DATA_SEND) {
-		gI2cSlaveProcess.DataBuf[SLAVE_BUF_INDEX1] = val;
-		gI2cSlaveProcess.InProcess = I2CInProcess_Flag;
-		gBmcFlag = FALSE;
-		PchBmcCommands(&gI2cSlaveProcess.DataBuf[SLAVE_BUF_INDEX0]);
-	}
 	return 0;
 }
 
@@ -95,7 +95,8 @@ int i2c_1060_slave_pch_write_received(struct i2c_slave_config *config,
 int i2c_1060_slave_pch_read_processed(struct i2c_slave_config *config,
 				      uint8_t *val)
 {
-	printk("i2c_1060_slave_cb1_read_processed read_processed *val = %x\n", val);
+	PFR_I2C_TRACE(&gPchI2cRing, PFR_I2C_TRACE_READ_PROCESSED, *val);
+
 	return 0;
 }
 
@@ -108,10 +109,43 @@ int i2c_1060_slave_pch_read_processed(struct i2c_slave_config *config,
  */
 int i2c_1060_slave_pch_stop(struct i2c_slave_config *config)
 {
-	printk("i2c_1060_slave_cb1_stop stop\n");
+	PFR_I2C_TRACE(&gPchI2cRing, PFR_I2C_TRACE_STOP, gPchI2cRing.length);
+
+	// A lone command byte only selects the register for a read that follows
+	if (gPchI2cRing.length == 1)
+		pfr_i2c_ring_abort(&gPchI2cRing);
+
+	if (pfr_i2c_ring_stop(&gPchI2cRing)) {
+		I2CActiveObjectData.type = I2C_EVENT;
+		I2CData.operation = I2C_HANDLE;
+		I2CData.i2c_data = NULL;
+		if (post_smc_action(I2C, &I2CActiveObjectData, &I2CData))
+			pfr_i2c_ring_rearm(&gPchI2cRing);
+	}
+
 	return 0;
 }
 
+/*	* PchI2cProcessCommands
+ * decode the writes queued by the PCH callbacks, in thread context
+ *
+ * @param None
+ *
+ * @return None
+ */
+void PchI2cProcessCommands(void)
+{
+	uint8_t msg[PFR_I2C_RING_MSG_MAX];
+	size_t length;
+
+	while ((length = pfr_i2c_ring_get(&gPchI2cRing, msg, sizeof(msg))) != 0) {
+		if (length >= 2) {
+			gBmcFlag = FALSE;
+			PchBmcCommands(msg, 0);
+		}
+	}
+}
+
 /*	* i2c_1060_callbacks_1
  * callback function for I2C_1
  */
@@ -4,4 +4,11 @@
 //*                                                                     *//
 //*        All rights reserved. Subject to AMI licensing agreement.     *//
 //*                                                                     *//
-//***********************************************************************//
\ No newline at end of file
+//***********************************************************************//
+
+#ifndef PCH_I2C_HANDLER_H
+#define PCH_I2C_HANDLER_H
+
+void PchI2cProcessCommands(void);
+
+#endif /*PCH_I2C_HANDLER_H*/
@@ -8,6 +8,8 @@
 #include "Smbus_mailbox.h"
 #include <Common.h>
 #include "Definition.h"
+#include "pfr/pfr_ufm.h"
+#include "pfr/pfr_mailbox_fifo.h"
 #ifdef CONFIG_INTEL_PFR_SUPPORT
 #include "intel_2.0/intel_pfr_pfm_manifest.h"
 #include "intel_2.0/intel_pfr_definitions.h"
@@ -19,8 +21,10 @@
 #include "cerberus/cerberus_pfr_provision.h"
 #endif
 
+#include "pfr/pfr_printk.h"
+
 #if SMBUS_MAILBOX_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_MAILBOX, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -37,12 +41,11 @@ uint8_t gReadAndWriteRfAddress[READ_WRITE_RF_COUNT] = { 0x08, 0x09, 0x0B, 0x0C,
 extern struct st_pfr_instance pfr_instance;
 EVENT_CONTEXT DataContext;
 
-uint8_t gUfmFifoData[64];
-uint8_t gReadFifoData[64];
+struct pfr_mailbox_fifo gUfmWriteFifo;
+struct pfr_mailbox_fifo gUfmReadFifo;
 uint8_t gRootKeyHash[32];
 uint8_t gPchOffsets[12];
 uint8_t gBmcOffsets[12];
-uint8_t gUfmFifoLength;
 uint8_t gbmcactivesvn;
 uint8_t gbmcactiveMajorVersion;
 uint8_t gbmcActiveMinorVersion;
@@ -58,7 +61,6 @@ extern uint32_t gMaxTimeout;
 extern int gBMCWatchDogTimer;
 extern int gPCHWatchDogTimer;
 uint8_t gProvisionCount;
-uint8_t gFifoData;
 uint8_t gBmcFlag;
 uint8_t gDataCount;
 uint8_t gProvisionData;
@@ -83,11 +85,7 @@ void ResetMailBox(void)
 **/
 unsigned char erase_provision_flash(void)
 {
-	int status;
-	struct SpiEngine *spi_flash = getSpiEngineWrapper();
-	spi_flash->spi.device_id[0] = ROT_INTERNAL_INTEL_STATE;
-	status = spi_flash->spi.base.sector_erase(&spi_flash->spi, 0);
-	return status;
+	return ufm_erase(PROVISION_UFM);
 }
 /**
     Function to Initialize Smbus Mailbox with default value
@@ -97,44 +95,17 @@ unsigned char erase_provision_flash(void)
  **/
 void get_provision_data_in_flash(uint32_t addr, uint8_t *DataBuffer, uint32_t length)
 {
-	uint8_t status;
-	struct SpiEngine *spi_flash = getSpiEngineWrapper();
-
-	spi_flash->spi.device_id[0] = ROT_INTERNAL_INTEL_STATE; // Internal UFM SPI
-	status = spi_flash->spi.base.read(&spi_flash->spi, addr, DataBuffer, length);
-
+	// Served from the UFM cache, the flash is only read once per boot
+	ufm_read(PROVISION_UFM, addr, DataBuffer, length);
 }
 
+/**
+    Function to update provisioning data. The change is buffered in RAM and
+    reaches the UFM on the next ufm_flush(PROVISION_UFM).
+ **/
 unsigned char set_provision_data_in_flash(uint8_t addr, uint8_t *DataBuffer, uint8_t DataSize)
 {
-	uint8_t status;
-	uint8_t buffer[1024];
-	struct SpiEngine *spi_flash = getSpiEngineWrapper();
-	spi_flash->spi.device_id[0] = ROT_INTERNAL_INTEL_STATE;
-
-	// Read Intel State
-	status = spi_flash->spi.base.read(&spi_flash->spi, 0, buffer, sizeof(buffer) / sizeof(buffer[0]));
-
-	if (status == Success) {
-		status = erase_provision_flash();
-
-		if (status == Success) {
-			for (int i = addr; i < DataSize + addr; i++) {
-				buffer[i] = DataBuffer[i - addr];
-			}
-
-			memcpy(buffer + addr, DataBuffer, DataSize);
-
-			status = spi_flash->spi.base.write(&spi_flash->spi, 0, buffer, sizeof(buffer) / sizeof(buffer[0]));
-			if (status != Success) 
-				return Failure;
-		}
-	}
-
-	spi_flash->spi.device_id[0] = ROT_INTERNAL_INTEL_STATE;
-	status = spi_flash->spi.base.read(&spi_flash->spi, 0, buffer, sizeof(buffer) / sizeof(buffer[0]));
-
-	return status;
+	return ufm_write(PROVISION_UFM, addr, DataBuffer, DataSize);
 }
 void get_image_svn(uint8_t image_id, uint32_t address, uint8_t *SVN, uint8_t *MajorVersion, uint8_t *MinorVersion)
 {
@@ -788,20 +759,23 @@ void lock_provision_flash(void)
 	UfmStatus |= 1;
 
 	set_provision_data_in_flash(UFM_STATUS, (uint8_t *)&UfmStatus, sizeof(UfmStatus));
+
+	// Everything provisioned so far must be on flash before the UFM is locked
+	ufm_flush(PROVISION_UFM);
 }
 void ReadRootKey(void)
 {
-	memcpy(gReadFifoData, gRootKeyHash, SHA256_DIGEST_LENGTH);
+	pfr_mailbox_fifo_load(&gUfmReadFifo, gRootKeyHash, SHA256_DIGEST_LENGTH);
 }
 
 void ReadPchOfsets(void)
 {
-	memcpy(gReadFifoData, gPchOffsets, sizeof(gPchOffsets));
+	pfr_mailbox_fifo_load(&gUfmReadFifo, gPchOffsets, sizeof(gPchOffsets));
 }
 
 void ReadBmcOffets(void)
 {
-	memcpy(gReadFifoData, gBmcOffsets, sizeof(gBmcOffsets));
+	pfr_mailbox_fifo_load(&gUfmReadFifo, gBmcOffsets, sizeof(gBmcOffsets));
 }
 /**
     Function to process th UFM command operations
@@ -837,7 +811,7 @@ void process_provision_command(void)
 		break;
 	case PROVISION_ROOT_KEY:
 		set_provision_status(COMMAND_BUSY);
-		memcpy(gRootKeyHash, gUfmFifoData, SHA256_DIGEST_LENGTH);
+		memcpy(gRootKeyHash, gUfmWriteFifo.data, SHA256_DIGEST_LENGTH);
 		gProvisionCount++;
 		gProvisionData = 1;
 		set_provision_status(COMMAND_DONE);
@@ -849,7 +823,7 @@ void process_provision_command(void)
 		break;
 	case PROVISION_PCH_OFFSET:
 		set_provision_status(COMMAND_BUSY);
-		memcpy(gPchOffsets, gUfmFifoData, sizeof(gPchOffsets));
+		memcpy(gPchOffsets, gUfmWriteFifo.data, sizeof(gPchOffsets));
 		gProvisionCount++;
 		gProvisionData = 1;
 		set_provision_status(COMMAND_DONE);
@@ -857,7 +831,7 @@ void process_provision_command(void)
 		break;
 	case PROVISION_BMC_OFFSET:
 		set_provision_status(COMMAND_BUSY);
-		memcpy(gBmcOffsets, gUfmFifoData, sizeof(gPchOffsets));
+		memcpy(gBmcOffsets, gUfmWriteFifo.data, sizeof(gBmcOffsets));
 		gProvisionCount++;
 		gProvisionData = 1;
 		set_provision_status(COMMAND_DONE);
@@ -914,6 +888,13 @@ void process_provision_command(void)
 			return;
 		}
 
+		// Commit the root key hash, offsets and status in a single erase/program
+		Status = ufm_flush(PROVISION_UFM);
+		if (Status != Success) {
+			set_provision_status(COMMAND_ERROR);
+			return;
+		}
+
 		set_provision_status(COMMAND_DONE | UFM_PROVISIONED);
 
 		CPLD_STATUS cpld_status;
@@ -1154,7 +1135,6 @@ bool WatchDogTimer(int ImageType)
 	return true;
 }
 
-static unsigned int mailBox_index;
 uint8_t PchBmcCommands(unsigned char *CipherText, uint8_t ReadFlag)
 {
 
@@ -1210,24 +1190,19 @@ uint8_t PchBmcCommands(unsigned char *CipherText, uint8_t ReadFlag)
 				// Execute command specified at UFM/Provisioning Command register
 				process_provision_command();
 			} else if (CipherText[1] & FLUSH_WRITE_FIFO) {// Flush Write FIFO
-				// Need to read UFM Write FIFO offest
-				memset(&gUfmFifoData, 0, sizeof(gUfmFifoData));
-				gFifoData = 0;
+				pfr_mailbox_fifo_flush(&gUfmWriteFifo);
 			} else if (CipherText[1] & FLUSH_READ_FIFO) {// flush Read FIFO
-				// Need to read UFM Read FIFO offest
-				memset(&gReadFifoData, 0, sizeof(gReadFifoData));
-				gFifoData = 0;
-				mailBox_index = 0;
+				pfr_mailbox_fifo_flush(&gUfmReadFifo);
 			}
 		}
 
 		break;
 	case UfmWriteFIFO:
-		gUfmFifoData[gFifoData++] = CipherText[1];
+		// A byte that does not fit is dropped, the same as a full block
+		pfr_mailbox_fifo_push(&gUfmWriteFifo, &CipherText[1], 1);
 		break;
 	case UfmReadFIFO:
-		DataToSend = gReadFifoData[mailBox_index];
-		mailBox_index++;
+		DataToSend = pfr_mailbox_fifo_pop(&gUfmReadFifo);
 		break;
 	case BmcCheckpoint:
 		UpdateBmcCheckpoint(CipherText[1]);
@@ -1300,3 +1275,45 @@ uint8_t PchBmcCommands(unsigned char *CipherText, uint8_t ReadFlag)
 	return DataToSend;
 }
 
+/**
+    Function to handle an SMBus block write to the mailbox.  The block is added to the UFM
+    write FIFO in one step, so no event is needed for each byte.
+
+    @Param  Address  7-bit target address the block was written to
+    @Param  Data     Bytes received after the address: command, count, data and optional PEC
+    @Param  Length   Number of bytes received
+
+    @retval 0 if the block was accepted or an error code
+ **/
+int SmbusMailboxBlockWrite(uint8_t Address, const uint8_t *Data, size_t Length)
+{
+	int Status;
+
+	if (Data[0] != UFM_WRITE_FIFO_BLOCK)
+		return PFR_MAILBOX_INVALID_ARGUMENT;
+
+	Status = pfr_mailbox_block_write(&gUfmWriteFifo, Address, Data, Length);
+	if (Status != 0)
+		set_provision_status(COMMAND_ERROR);
+
+	return Status;
+}
+
+/**
+    Function to build the response to an SMBus block read of the mailbox.  All unread bytes
+    of the UFM read FIFO are returned in one transaction.
+
+    @Param  Address  7-bit target address being read
+    @Param  Command  Command written before the read
+    @Param  Data     Output for the count, data and PEC
+    @Param  Length   Size of the output buffer
+
+    @retval Length of the response or an error code
+ **/
+int SmbusMailboxBlockRead(uint8_t Address, uint8_t Command, uint8_t *Data, size_t Length)
+{
+	if (Command != UFM_READ_FIFO_BLOCK)
+		return PFR_MAILBOX_INVALID_ARGUMENT;
+
+	return pfr_mailbox_block_read(&gUfmReadFifo, Address, Command, Data, Length);
+}
@@ -10,6 +10,7 @@
 #define PFR_SMBUS_MAILBOX_H_
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 // #include <HrotStateMachine.h>
 #include "include/SmbusMailBoxCom.h"
 #include "state_machine/common_smc.h"
@@ -44,6 +45,11 @@ typedef char byte;
 #define READ_ONLY 24
 #define WRITE_ONLY 6
 
+// SMBus block access to the UFM FIFOs, in the reserved part of the register file.  The
+// UfmWriteFIFO and UfmReadFIFO byte registers keep working for existing tools.
+#define UFM_WRITE_FIFO_BLOCK 0x70
+#define UFM_READ_FIFO_BLOCK 0x71
+
 typedef struct _SMBUS_MAIL_BOX_ {
 	byte CpldIdentifier;
 	byte CpldReleaseVersion;
@@ -322,6 +328,9 @@ bool WatchDogTimer(int ImageType);
 uint8_t PchBmcCommands(unsigned char *CipherText, uint8_t ReadFlag);
 void get_image_svn(uint8_t image_id, uint32_t address, uint8_t *SVN, uint8_t *MajorVersion, uint8_t *MinorVersion);
 
+int SmbusMailboxBlockWrite(uint8_t Address, const uint8_t *Data, size_t Length);
+int SmbusMailboxBlockRead(uint8_t Address, uint8_t Command, uint8_t *Data, size_t Length);
+
 #define ROOT_KEY_HASH_PROVISION_FLAG 1
 #define PCH_OFFSET_PROVISION_FLAG 2
 #define BMC_OFFSET_PROVISION_FLAG 3
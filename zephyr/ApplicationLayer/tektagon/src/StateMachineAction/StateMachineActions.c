@@ -13,10 +13,16 @@
 #include "include/SmbusMailBoxCom.h"
 #include "pfr/pfr_verifcation.h"
 #include "pfr/pfr_update.h"
+#include "pfr/pfr_measurement_cache.h"
+#include "pfr/pfr_ufm.h"
+#include "pfr/pfr_printk.h"
+#include "pfr/pfr_log.h"
 #include "flash/flash_aspeed.h"
 #include <watchdog/watchdog_aspeed.h>
 #include "Smbus_mailbox/Smbus_mailbox.h"
 #include "SpiFilter/SpiFilter.h"
+#include "I2c_Handler/BmcI2C_handler.h"
+#include "I2c_Handler/PchI2c_handler.h"
 #include "logging/debug_log.h"// State Machine log saving
 #include <gpio/gpio_aspeed.h>
 
@@ -44,7 +50,7 @@
 #define SMBUS_WRITE 0x45
 
 #if PF_STATUS_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_STATUS, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -251,6 +257,12 @@ void PublishInitialEvents(void)
 
 	if (provision_state == UFM_PROVISIONED) {
 		check_staging_area();
+#ifdef CONFIG_INTEL_PFR_SUPPORT
+		// Reached when the RoT starts or after an update, never for a host reset alone.
+		// Host resets are verified in handleVerifyInitState with a trusted reset
+		apply_spi_monitor_log(0, PFR_MEASUREMENT_CACHE_ROT_RESET);
+		apply_spi_monitor_log(1, PFR_MEASUREMENT_CACHE_ROT_RESET);
+#endif
 #if BMC_SUPPORT
 		PublishBmcEvents();
 #else
@@ -274,6 +286,7 @@ void handleLockDownState(void *AoData)
 	SetPlatformState(LOCKDOWN_ON_AUTH_FAIL);
 	#endif
 	// Perform Any Other Cleanup
+	pfr_log_drain();
 }
 
 /**
@@ -410,6 +423,10 @@ int handleImageVerification(void *AoData, void *EventContext)
 			BMCBootHold();
 		 	PCHBootHold();
 		}
+#ifdef CONFIG_INTEL_PFR_SUPPORT
+		if (EventData->operation == VERIFY_ACTIVE)
+			apply_spi_monitor_log((ActiveObjectData->type == BMC_EVENT) ? 0 : 1, PFR_MEASUREMENT_CACHE_HOST_RESET);
+#endif
 		status = authentication_image(AoData, EventContext);
 		imageType = ActiveObjectData->type;
 
@@ -487,6 +504,8 @@ void handleRecoveryEntryState(void *data)
 	int type = ao_data->type;
 
 	// Tektagon_DisableTimer(type);
+	// Recovery rewrites the active image, so its measurements no longer apply
+	pfr_measurement_cache_clear(get_measurement_cache((type == BMC_EVENT) ? BMC_TYPE : PCH_TYPE));
 	#if SMBUS_MAILBOX_SUPPORT
 	SetPlatformState(T_MINUS_1_FW_RECOVERY);
 	SetLastRecoveryReason(lastRecoveryReason(type, data));
@@ -636,6 +655,8 @@ void handleUpdateEntryState(void *data)
 	int type = ao_data->type;
 
 	// Tektagon_DisableTimer(type);
+	if (type == BMC_EVENT || type == PCH_EVENT)
+		pfr_measurement_cache_clear(get_measurement_cache((type == BMC_EVENT) ? BMC_TYPE : PCH_TYPE));
 	#if SMBUS_MAILBOX_SUPPORT
 	SetPlatformState(type == BMC_EVENT ? BMC_FW_UPDATE : (PCH_EVENT ? PCH_FW_UPDATE : CPLD_FW_UPDATE));
 	if (type != CPLD_FW_UPDATE) {
@@ -778,21 +799,34 @@ void platform_monitor_init(void)
 void T0Transition(int releaseBmc, int releasePCH)
 {
 	int provision_status;
+	int filter_failed = 0;
 
 	SetPlatformState(ENTER_T0);
 	
 	provision_status = get_provision_status();
 	if (provision_status == UFM_PROVISIONED) {
 		platform_monitor_init();
-		// enable spi filtering
+		// enable spi filtering, a host without a working filter stays in reset
 		if (releaseBmc) {
-			init_SPI_RW_region(0);
-			Tektagon_EnableTimer(BMC_EVENT);
+			if (init_SPI_RW_region(0) == 0) {
+				Tektagon_EnableTimer(BMC_EVENT);
+			} else {
+				DEBUG_PRINTF("BMC SPI filter not enabled, keep BMC in reset\r\n");
+				releaseBmc = 0;
+				filter_failed = 1;
+			}
 		}
 		if (releasePCH) {
-			init_SPI_RW_region(1);
-			Tektagon_EnableTimer(PCH_EVENT);
+			if (init_SPI_RW_region(1) == 0) {
+				Tektagon_EnableTimer(PCH_EVENT);
+			} else {
+				DEBUG_PRINTF("PCH SPI filter not enabled, keep PCH in reset\r\n");
+				releasePCH = 0;
+				filter_failed = 1;
+			}
 		}
+		if (filter_failed)
+			SetPlatformState(LOCKDOWN_ON_AUTH_FAIL);
 	}
 	if (releaseBmc) {
 		BMCBootRelease();
@@ -834,12 +868,9 @@ void LockDownPlatform(void *AoData)
 
 int process_i2c_command(void *static_data, void *event_context)
 {
-	AO_DATA *I2CActiveObjectData = (AO_DATA *) static_data;
-	EVENT_CONTEXT *I2CData = (EVENT_CONTEXT *) event_context;
-	if (I2CActiveObjectData->ProcessNewCommand) {
-		// printk("I2CData->i2c_data[0]: %x, I2CData->i2c_data[1]: %x\n", I2CData->i2c_data[0], I2CData->i2c_data[1]);
-		PchBmcCommands(I2CData->i2c_data, 0);
-		I2CActiveObjectData->ProcessNewCommand = 0;
-	}
+	// The target callbacks only queue the writes, every write queued since the event is decoded here
+	BmcI2cProcessCommands();
+	PchI2cProcessCommands();
+
 	return 0;
 }
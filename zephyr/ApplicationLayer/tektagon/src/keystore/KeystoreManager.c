@@ -16,6 +16,12 @@
 #include <storage/flash_map.h>
 #include "pfr/pfr_ufm.h"
 #include "pfr/pfr_util.h"
+#ifdef CONFIG_INTEL_PFR_SUPPORT
+#include "intel_2.0/intel_pfr_definitions.h"
+#endif
+#ifdef CONFIG_CERBERUS_PFR_SUPPORT
+#include "cerberus/cerberus_pfr_definitions.h"
+#endif
 
 int keystore_save_key(struct keystore *store, int id, const uint8_t *key, size_t length)
 {
@@ -284,13 +290,12 @@ int keystore_save_root_key(struct rsa_public_key *pub_key)
 	StoreBufIndex = pub_key->mod_length + 5;
 	StoreBuf[StoreBufIndex] = ((pub_key->exponent >> 24) & 0xFF);
 
-    struct SpiEngine *spi_flash = getSpiEngineWrapper();
+	// The root key shares the provisioning sector, so it goes through the UFM cache
+	status = ufm_write(PROVISION_UFM, BaseAddr, StoreBuf, rootkey_contain_size);
+	if (status == Success)
+		status = ufm_flush(PROVISION_UFM);
 
-	spi_flash->spi.device_id[0] = ROT_INTERNAL_INTEL_STATE; // Root Key save to Intel State
-	
-	status = spi_flash->spi.base.write(&spi_flash->spi, BaseAddr, StoreBuf, rootkey_contain_size);
-	
-	if(status != rootkey_contain_size)
+	if(status != Success)
 	{
         printk("key write error \n");
 		status = KEYSTORE_SAVE_FAILED;
@@ -313,25 +318,22 @@ int keystore_get_root_key(struct rsa_public_key *pub_key)
     uint8_t exponent_length;
     uint32_t modules_address,exponent_address;
 
-	struct SpiEngine *spi_flash = getSpiEngineWrapper();
-
-	spi_flash->spi.device_id[0] = ROT_INTERNAL_INTEL_STATE; // Root Key save to Intel State
-
     //Key Length
-    status = spi_flash->spi.base.read(&spi_flash->spi, BaseAddr, &key_length, sizeof(key_length));
+    status = ufm_read(PROVISION_UFM, BaseAddr, (uint8_t *)&key_length, sizeof(key_length));
     if (status != Success){
         return Failure;
     }	
 	pub_key->mod_length = key_length;
     modules_address = BaseAddr + sizeof(key_length);
     //rsa_key_module
-    status = spi_flash->spi.base.read(&spi_flash->spi, modules_address, pub_key->modulus, key_length);
+    status = ufm_read(PROVISION_UFM, modules_address, pub_key->modulus, key_length);
 
     pub_key->mod_length = key_length;
     exponent_address = BaseAddr + sizeof(key_length) + key_length;
     
     //rsa_key_exponent
-    status = spi_flash->spi.base.read(&spi_flash->spi, exponent_address, &pub_key->exponent, sizeof(pub_key->exponent));
+    status = ufm_read(PROVISION_UFM, exponent_address, (uint8_t *)&pub_key->exponent,
+        sizeof(pub_key->exponent));
 
     return status;
 }
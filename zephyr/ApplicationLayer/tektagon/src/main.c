@@ -13,6 +13,7 @@
 #include "include/SmbusMailBoxCom.h"
 #include "Smbus_mailbox/Smbus_mailbox.h"
 #include "pfr/pfr_common.h"
+#include "pfr/pfr_log.h"
 #include <CommonLogging/CommonLogging.h>
 #include <I2c/I2c.h>
 
@@ -46,6 +47,7 @@ void main(void)
 	status = initializeEngines();
 	status = initializeManifestProcessor();
 	DebugInit();//State Machine log saving
+	pfr_log_init();
 
 	BMCBootHold();
 	PCHBootHold();
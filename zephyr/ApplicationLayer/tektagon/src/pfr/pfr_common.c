@@ -10,6 +10,7 @@
 #include "CommonFlash/CommonFlash.h"
 #include "recovery/recovery_image.h"
 #include "pfr_util.h"
+#include "pfr_sig_block.h"
 
 #ifdef CONFIG_INTEL_PFR_SUPPORT
 #include "intel_2.0/intel_pfr_common.h"
@@ -47,6 +48,7 @@ struct pfr_keystore pfr_keystore;
 
 struct pfr_authentication pfr_authentication;
 struct pfr_hash pfr_hash;
+static struct pfr_sig_block pfr_sig_block;
 
 struct pfr_manifest *get_pfr_manifest(){
     return &pfr_manifest;
@@ -140,5 +142,7 @@ void init_pfr_manifest(){
                             get_update_fw_base(),
                             get_active_image());
 
+    pfr_manifest.sig_block = &pfr_sig_block;
+
 }
 
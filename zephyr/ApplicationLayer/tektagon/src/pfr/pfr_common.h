@@ -15,6 +15,8 @@
 #include "recovery/recovery_image.h"
 #include "firmware/firmware_image.h"
 
+struct pfr_sig_block;
+
 struct pfr_manifest {
     // struct manifest_flash *base;
     struct manifest *base;
@@ -30,6 +32,7 @@ struct pfr_manifest {
     struct pfr_keystore *keystore;
     struct pfr_authentication *pfr_authentication;
     struct pfr_hash *pfr_hash;
+    struct pfr_sig_block *sig_block;                    // signature block being verified
 
     uint32_t image_type;                                // BMC or PCH
     uint32_t state;                                     // VERIFY, UPDATE, RECOVERY
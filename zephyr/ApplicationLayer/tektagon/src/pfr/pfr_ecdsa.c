@@ -0,0 +1,71 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include "pfr_ecdsa.h"
+
+/**
+ * Get the length of the key, digest and signature components for a curve.
+ *
+ * @param curve The curve to query.
+ *
+ * @return The component length in bytes or 0 for an unknown curve.
+ */
+size_t pfr_ecdsa_curve_length(enum pfr_ecdsa_curve curve)
+{
+	switch (curve) {
+	case PFR_ECDSA_CURVE_P256:
+		return PFR_ECDSA_P256_LENGTH;
+
+	case PFR_ECDSA_CURVE_P384:
+		return PFR_ECDSA_P384_LENGTH;
+
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Verify an ECDSA signature using the first backend that can service the request.
+ *
+ * Backends are tried in the order given.  A backend that does not handle the curve is skipped,
+ * and a backend that reports PFR_ECDSA_BACKEND_UNAVAILABLE passes the request on to the next one.
+ * Any other result, including a signature mismatch, is final so a failed verification is never
+ * retried on a different engine.
+ *
+ * @param backends The backends to use, in priority order.
+ * @param count The number of backends.
+ * @param curve The curve of the key and signature.
+ * @param x, y The public key coordinates.
+ * @param digest The message digest.
+ * @param r, s The signature.
+ *
+ * @return 0 if the signature is valid or an error code.
+ */
+int pfr_ecdsa_verify(const struct pfr_ecdsa_backend *const *backends, size_t count,
+		enum pfr_ecdsa_curve curve, const uint8_t *x, const uint8_t *y, const uint8_t *digest,
+		const uint8_t *r, const uint8_t *s)
+{
+	int status;
+	size_t i;
+
+	if ((backends == NULL) || (x == NULL) || (y == NULL) || (digest == NULL) || (r == NULL) ||
+		(s == NULL) || (pfr_ecdsa_curve_length(curve) == 0)) {
+		return PFR_ECDSA_INVALID_ARGUMENT;
+	}
+
+	for (i = 0; i < count; i++) {
+		if ((backends[i] == NULL) || !(backends[i]->curves & PFR_ECDSA_CURVE_MASK(curve)))
+			continue;
+
+		status = backends[i]->verify(backends[i], curve, x, y, digest, r, s);
+		if (status != PFR_ECDSA_BACKEND_UNAVAILABLE)
+			return status;
+	}
+
+	return PFR_ECDSA_NO_BACKEND;
+}
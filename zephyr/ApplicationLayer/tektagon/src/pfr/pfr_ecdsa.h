@@ -0,0 +1,67 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_ECDSA_H
+#define PFR_ECDSA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PFR_ECDSA_P256_LENGTH			32
+#define PFR_ECDSA_P384_LENGTH			48
+
+/* Status codes returned by the ECDSA backends and the dispatcher. */
+#define PFR_ECDSA_VERIFY_FAILED			-1	// Signature does not match the digest
+#define PFR_ECDSA_INVALID_ARGUMENT		-2	// Null or malformed input
+#define PFR_ECDSA_BACKEND_UNAVAILABLE	-3	// Backend cannot service this request, try the next one
+#define PFR_ECDSA_NO_BACKEND			-4	// No backend was able to service the request
+
+enum pfr_ecdsa_curve {
+	PFR_ECDSA_CURVE_P256 = 0,
+	PFR_ECDSA_CURVE_P384,
+	PFR_ECDSA_CURVE_MAX,
+};
+
+#define PFR_ECDSA_CURVE_MASK(curve)		(1U << (curve))
+
+/**
+ * An ECDSA verification backend.  All key, digest and signature values are raw big-endian
+ * integers of the curve length.
+ */
+struct pfr_ecdsa_backend {
+	const char *name;			/**< Backend name for logging. */
+	uint32_t curves;			/**< Mask of PFR_ECDSA_CURVE_MASK() values handled by the backend. */
+
+	/**
+	 * Verify an ECDSA signature.
+	 *
+	 * @param backend The backend performing the verification.
+	 * @param curve The curve of the key and signature.
+	 * @param x, y The public key coordinates.
+	 * @param digest The message digest, which must be the same length as the curve.
+	 * @param r, s The signature.
+	 *
+	 * @return 0 if the signature is valid, PFR_ECDSA_BACKEND_UNAVAILABLE if the backend could
+	 * not perform the operation, or another error code.
+	 */
+	int (*verify) (const struct pfr_ecdsa_backend *backend, enum pfr_ecdsa_curve curve,
+		const uint8_t *x, const uint8_t *y, const uint8_t *digest, const uint8_t *r,
+		const uint8_t *s);
+
+	void *context;				/**< Backend private data. */
+};
+
+extern const struct pfr_ecdsa_backend pfr_ecdsa_mbedtls_backend;
+
+size_t pfr_ecdsa_curve_length(enum pfr_ecdsa_curve curve);
+
+int pfr_ecdsa_verify(const struct pfr_ecdsa_backend *const *backends, size_t count,
+		enum pfr_ecdsa_curve curve, const uint8_t *x, const uint8_t *y, const uint8_t *digest,
+		const uint8_t *r, const uint8_t *s);
+
+#endif /*PFR_ECDSA_H*/
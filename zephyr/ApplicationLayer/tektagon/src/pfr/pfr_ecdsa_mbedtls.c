@@ -0,0 +1,91 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include "mbedtls/ecdsa.h"
+#include "pfr_ecdsa.h"
+
+/**
+ * Software ECDSA verification for both PFR curves.
+ */
+static int pfr_ecdsa_mbedtls_verify(const struct pfr_ecdsa_backend *backend,
+		enum pfr_ecdsa_curve curve, const uint8_t *x, const uint8_t *y, const uint8_t *digest,
+		const uint8_t *r, const uint8_t *s)
+{
+	mbedtls_ecp_group_id group_id;
+	mbedtls_ecp_group grp;
+	mbedtls_ecp_point q;
+	mbedtls_mpi sig_r;
+	mbedtls_mpi sig_s;
+	size_t length;
+	int ret;
+
+	switch (curve) {
+	case PFR_ECDSA_CURVE_P256:
+		group_id = MBEDTLS_ECP_DP_SECP256R1;
+		break;
+
+	case PFR_ECDSA_CURVE_P384:
+		group_id = MBEDTLS_ECP_DP_SECP384R1;
+		break;
+
+	default:
+		return PFR_ECDSA_BACKEND_UNAVAILABLE;
+	}
+
+	length = pfr_ecdsa_curve_length(curve);
+
+	mbedtls_ecp_group_init(&grp);
+	mbedtls_ecp_point_init(&q);
+	mbedtls_mpi_init(&sig_r);
+	mbedtls_mpi_init(&sig_s);
+
+	ret = mbedtls_ecp_group_load(&grp, group_id);
+	if (ret != 0) {
+		ret = PFR_ECDSA_BACKEND_UNAVAILABLE;
+		goto exit;
+	}
+
+	ret = mbedtls_mpi_read_binary(&q.X, x, length);
+	ret |= mbedtls_mpi_read_binary(&q.Y, y, length);
+	ret |= mbedtls_mpi_lset(&q.Z, 1);
+	ret |= mbedtls_mpi_read_binary(&sig_r, r, length);
+	ret |= mbedtls_mpi_read_binary(&sig_s, s, length);
+	if (ret != 0) {
+		ret = PFR_ECDSA_INVALID_ARGUMENT;
+		goto exit;
+	}
+
+	// Reject keys that are not on the curve before running the verification
+	ret = mbedtls_ecp_check_pubkey(&grp, &q);
+	if (ret == 0)
+		ret = mbedtls_ecdsa_verify(&grp, digest, length, &q, &sig_r, &sig_s);
+
+	if (ret != 0)
+		ret = PFR_ECDSA_VERIFY_FAILED;
+
+exit:
+	mbedtls_mpi_free(&sig_s);
+	mbedtls_mpi_free(&sig_r);
+	mbedtls_ecp_point_free(&q);
+	mbedtls_ecp_group_free(&grp);
+
+	return ret;
+}
+
+const struct pfr_ecdsa_backend pfr_ecdsa_mbedtls_backend = {
+	.name = "mbedtls",
+	.curves = PFR_ECDSA_CURVE_MASK(PFR_ECDSA_CURVE_P256) | PFR_ECDSA_CURVE_MASK(PFR_ECDSA_CURVE_P384),
+	.verify = pfr_ecdsa_mbedtls_verify,
+	.context = NULL,
+};
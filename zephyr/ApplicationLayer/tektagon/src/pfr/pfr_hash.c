@@ -0,0 +1,121 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stdbool.h>
+#include "flash/flash_util.h"
+#include "pfr_hash.h"
+
+/**
+ * Get the digest length for a hash type used by PFR images.
+ *
+ * @param type The hash type.
+ *
+ * @return The digest length in bytes or 0 if PFR does not use the hash type.
+ */
+size_t pfr_hash_digest_length(enum hash_type type)
+{
+	switch (type) {
+	case HASH_TYPE_SHA256:
+		return SHA256_HASH_LENGTH;
+
+	case HASH_TYPE_SHA384:
+		return SHA384_HASH_LENGTH;
+
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Check that a hash engine implements a hash type.
+ */
+static bool pfr_hash_supported(struct hash_engine *hash, enum hash_type type)
+{
+	switch (type) {
+	case HASH_TYPE_SHA256:
+		return (hash->calculate_sha256 != NULL) && (hash->start_sha256 != NULL);
+
+#ifdef HASH_ENABLE_SHA384
+	case HASH_TYPE_SHA384:
+		return (hash->calculate_sha384 != NULL) && (hash->start_sha384 != NULL);
+#endif
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * Calculate the SHA-256 or SHA-384 digest of a buffer.
+ *
+ * @param hash The hash engine to use.
+ * @param type The hash type.
+ * @param data The data to hash.
+ * @param length The length of the data.
+ * @param hash_out Output for the digest.
+ * @param hash_length The size of the output buffer.
+ *
+ * @return 0 if the digest was calculated or an error code.
+ */
+int pfr_hash_buffer(struct hash_engine *hash, enum hash_type type, const uint8_t *data,
+		size_t length, uint8_t *hash_out, size_t hash_length)
+{
+	size_t digest_length = pfr_hash_digest_length(type);
+	int status;
+
+	if ((hash == NULL) || (data == NULL) || (hash_out == NULL))
+		return PFR_HASH_INVALID_ARGUMENT;
+
+	if (digest_length == 0)
+		return PFR_HASH_UNSUPPORTED;
+
+	if (hash_length < digest_length)
+		return PFR_HASH_INVALID_ARGUMENT;
+
+	if (!pfr_hash_supported(hash, type))
+		return PFR_HASH_UNSUPPORTED;
+
+	status = hash_calculate(hash, type, data, length, hash_out, hash_length);
+
+	return (status < 0) ? status : 0;
+}
+
+/**
+ * Calculate the SHA-256 or SHA-384 digest of a flash region.  Flash reads are overlapped with
+ * the hash engine when it supports asynchronous updates.
+ *
+ * @param flash The flash containing the region.
+ * @param hash The hash engine to use.
+ * @param type The hash type.
+ * @param start_addr The first address of the region.
+ * @param length The number of bytes in the region.
+ * @param hash_out Output for the digest.
+ * @param hash_length The size of the output buffer.
+ *
+ * @return 0 if the digest was calculated or an error code.
+ */
+int pfr_hash_region(struct flash *flash, struct hash_engine *hash, enum hash_type type,
+		uint32_t start_addr, uint32_t length, uint8_t *hash_out, size_t hash_length)
+{
+	size_t digest_length = pfr_hash_digest_length(type);
+
+	if ((flash == NULL) || (hash == NULL) || (hash_out == NULL))
+		return PFR_HASH_INVALID_ARGUMENT;
+
+	if (digest_length == 0)
+		return PFR_HASH_UNSUPPORTED;
+
+	if (hash_length < digest_length)
+		return PFR_HASH_INVALID_ARGUMENT;
+
+	if (!pfr_hash_supported(hash, type))
+		return PFR_HASH_UNSUPPORTED;
+
+	return flash_hash_contents_pipelined(flash, start_addr, length, hash, type,
+			FLASH_HASH_PIPELINE_DEPTH, hash_out, digest_length);
+}
@@ -0,0 +1,29 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_HASH_H
+#define PFR_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "flash/flash.h"
+#include "crypto/hash.h"
+
+/* Status codes returned in addition to the hash and flash engine errors. */
+#define PFR_HASH_INVALID_ARGUMENT		-1	// Null input or output buffer too small
+#define PFR_HASH_UNSUPPORTED			-2	// Digest type is not used by PFR
+
+size_t pfr_hash_digest_length(enum hash_type type);
+
+int pfr_hash_buffer(struct hash_engine *hash, enum hash_type type, const uint8_t *data,
+		size_t length, uint8_t *hash_out, size_t hash_length);
+
+int pfr_hash_region(struct flash *flash, struct hash_engine *hash, enum hash_type type,
+		uint32_t start_addr, uint32_t length, uint8_t *hash_out, size_t hash_length);
+
+#endif /*PFR_HASH_H*/
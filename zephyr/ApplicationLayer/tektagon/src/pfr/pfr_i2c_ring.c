@@ -0,0 +1,192 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <string.h>
+#include "pfr_i2c_ring.h"
+
+#define PFR_I2C_RING_INDEX(pos)		((pos) & (PFR_I2C_RING_SIZE - 1))
+
+/**
+ * Initialize an empty receive ring.
+ *
+ * @param ring The ring to initialize.
+ */
+void pfr_i2c_ring_init(struct pfr_i2c_ring *ring)
+{
+	if (ring == NULL)
+		return;
+
+	memset(ring, 0, sizeof(*ring));
+}
+
+/**
+ * Begin receiving a write transaction.  Called by the target callbacks when the controller
+ * addresses the target for a write.
+ *
+ * @param ring The ring receiving the write.
+ */
+void pfr_i2c_ring_start(struct pfr_i2c_ring *ring)
+{
+	if (ring == NULL)
+		return;
+
+	// Leave room for the length of the record in front of the data
+	ring->write = ring->head + 1;
+	ring->length = 0;
+	ring->receiving = true;
+	ring->overflow = false;
+}
+
+/**
+ * Add a byte written by the controller to the current write.
+ *
+ * @param ring The ring receiving the write.
+ * @param val The byte that was received.
+ */
+void pfr_i2c_ring_put(struct pfr_i2c_ring *ring, uint8_t val)
+{
+	uint32_t tail;
+
+	if ((ring == NULL) || !ring->receiving)
+		return;
+
+	if (ring->length == 0)
+		ring->command = val;
+
+	if (ring->overflow) {
+		ring->length++;
+		return;
+	}
+
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if ((ring->length == PFR_I2C_RING_MSG_MAX) || ((ring->write - tail) >= PFR_I2C_RING_SIZE)) {
+		ring->overflow = true;
+		ring->length++;
+		return;
+	}
+
+	ring->data[PFR_I2C_RING_INDEX(ring->write)] = val;
+	ring->write++;
+	ring->length++;
+}
+
+/**
+ * Discard the current write, such as when the controller turns it into a register read with a
+ * repeated start.  The first byte is still kept as the command for the read.
+ *
+ * @param ring The ring receiving the write.
+ */
+void pfr_i2c_ring_abort(struct pfr_i2c_ring *ring)
+{
+	if (ring == NULL)
+		return;
+
+	ring->receiving = false;
+}
+
+/**
+ * End the current write and publish it to the decoder.
+ *
+ * @param ring The ring receiving the write.
+ *
+ * @return true if the decoder needs to be woken to handle the write.  The decoder is only woken
+ * when the ring was empty, since it keeps going until it has taken out every record.
+ */
+bool pfr_i2c_ring_stop(struct pfr_i2c_ring *ring)
+{
+	if ((ring == NULL) || !ring->receiving)
+		return false;
+
+	ring->receiving = false;
+	if (ring->length == 0)
+		return false;
+
+	if (ring->overflow) {
+		PFR_I2C_TRACE(ring, PFR_I2C_TRACE_DROPPED,
+			(ring->length < 0xff) ? ring->length : 0xff);
+		ring->dropped++;
+		return false;
+	}
+
+	ring->data[PFR_I2C_RING_INDEX(ring->head)] = ring->length;
+	__atomic_store_n(&ring->head, ring->write, __ATOMIC_SEQ_CST);
+
+	return (__atomic_exchange_n(&ring->pending, 1, __ATOMIC_SEQ_CST) == 0);
+}
+
+/**
+ * Let the next write wake the decoder again.  Called when the decoder could not be woken after
+ * pfr_i2c_ring_stop asked for it, so the ring is not left waiting for a decoder that never runs.
+ *
+ * @param ring The ring that could not wake the decoder.
+ */
+void pfr_i2c_ring_rearm(struct pfr_i2c_ring *ring)
+{
+	if (ring == NULL)
+		return;
+
+	__atomic_store_n(&ring->pending, 0, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Take the oldest write out of the ring.  Called by the decoder until it returns 0.
+ *
+ * @param ring The ring to read.
+ * @param msg Output for the bytes of the write.
+ * @param length Size of the output buffer.  A longer write is truncated.
+ *
+ * @return Number of bytes copied to the output or 0 if the ring is empty.
+ */
+size_t pfr_i2c_ring_get(struct pfr_i2c_ring *ring, uint8_t *msg, size_t length)
+{
+	uint32_t head;
+	uint32_t tail;
+	size_t count;
+	size_t i;
+
+	if ((ring == NULL) || (msg == NULL))
+		return 0;
+
+	tail = ring->tail;
+	head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	if (head == tail) {
+		// Any write published after this point wakes the decoder again
+		__atomic_store_n(&ring->pending, 0, __ATOMIC_SEQ_CST);
+		head = __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST);
+		if (head == tail)
+			return 0;
+	}
+
+	count = ring->data[PFR_I2C_RING_INDEX(tail)];
+	if (count > length)
+		count = length;
+
+	for (i = 0; i < count; i++)
+		msg[i] = ring->data[PFR_I2C_RING_INDEX(tail + 1 + i)];
+
+	__atomic_store_n(&ring->tail, tail + 1 + ring->data[PFR_I2C_RING_INDEX(tail)],
+		__ATOMIC_RELEASE);
+
+	return count;
+}
+
+#if PFR_I2C_TRACE_SIZE
+/**
+ * Record a target callback event in the trace of a ring.
+ *
+ * @param ring The ring of the bus the event happened on.
+ * @param event The event to record.
+ * @param value The byte transferred or other event detail.
+ */
+void pfr_i2c_ring_trace(struct pfr_i2c_ring *ring, uint8_t event, uint8_t value)
+{
+	ring->trace[ring->trace_count % PFR_I2C_TRACE_SIZE] =
+		((ring->trace_count & 0xffff) << 16) | (event << 8) | value;
+	ring->trace_count++;
+}
+#endif
@@ -0,0 +1,86 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_I2C_RING_H
+#define PFR_I2C_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Bytes of each receive ring.  Must be a power of two. */
+#define PFR_I2C_RING_SIZE					512
+
+/* Longest write transaction kept in the ring.  Longer transactions are dropped. */
+#define PFR_I2C_RING_MSG_MAX				255
+
+/* Number of target callback events kept in the trace of each ring, 0 to build without a trace.
+ * The trace is a RAM buffer of 32-bit records that is read with a debugger or by the tests, so
+ * nothing is printed from the ISR. */
+#ifndef PFR_I2C_TRACE_SIZE
+#define PFR_I2C_TRACE_SIZE					0
+#endif
+
+/* Events recorded in the trace.  Each record is (sequence << 16) | (event << 8) | value. */
+#define PFR_I2C_TRACE_WRITE_REQUESTED		1	// Controller addressed the target for a write
+#define PFR_I2C_TRACE_WRITE_RECEIVED		2	// Byte written by the controller
+#define PFR_I2C_TRACE_READ_REQUESTED		3	// First byte read by the controller
+#define PFR_I2C_TRACE_READ_PROCESSED		4	// Next byte read by the controller
+#define PFR_I2C_TRACE_STOP					5	// Stop condition
+#define PFR_I2C_TRACE_DROPPED				6	// Write that did not fit in the ring, value is its length
+
+#if PFR_I2C_TRACE_SIZE
+#define PFR_I2C_TRACE(ring, event, value)	pfr_i2c_ring_trace (ring, event, value)
+#else
+#define PFR_I2C_TRACE(ring, event, value)
+#endif
+
+/**
+ * Receive ring for the write transactions of one I2C target bus.
+ *
+ * The target callbacks run in the ISR and are the only writer.  They only copy bytes into the
+ * ring, and a write is published as one record when its stop is seen, so the decoder never sees
+ * part of a transaction.  A thread takes the records out with pfr_i2c_ring_get and does all of the
+ * command handling.  The ring needs no lock: the ISR only moves the head and the thread only moves
+ * the tail.
+ *
+ * A write that does not fit is dropped as a whole and counted.  Register reads are not queued,
+ * since the target has to return the value while the controller is clocking it out.
+ */
+struct pfr_i2c_ring {
+	uint8_t data[PFR_I2C_RING_SIZE];	/**< Records, each a length byte and the bytes written. */
+	uint32_t head;						/**< End of the published records.  Written by the ISR. */
+	uint32_t tail;						/**< Start of the oldest record.  Written by the thread. */
+	uint32_t write;						/**< End of the write being received.  ISR only. */
+	size_t length;						/**< Bytes of the write being received.  ISR only. */
+	uint8_t command;					/**< First byte of the last write.  ISR only. */
+	bool receiving;						/**< A write is being received.  ISR only. */
+	bool overflow;						/**< The write being received did not fit.  ISR only. */
+	uint32_t pending;					/**< The decoder has been woken and not yet emptied the ring. */
+	uint32_t dropped;					/**< Number of writes dropped because they did not fit. */
+#if PFR_I2C_TRACE_SIZE
+	uint32_t trace[PFR_I2C_TRACE_SIZE];	/**< Most recent callback events. */
+	uint32_t trace_count;				/**< Number of events recorded. */
+#endif
+};
+
+void pfr_i2c_ring_init(struct pfr_i2c_ring *ring);
+
+void pfr_i2c_ring_start(struct pfr_i2c_ring *ring);
+void pfr_i2c_ring_put(struct pfr_i2c_ring *ring, uint8_t val);
+void pfr_i2c_ring_abort(struct pfr_i2c_ring *ring);
+bool pfr_i2c_ring_stop(struct pfr_i2c_ring *ring);
+void pfr_i2c_ring_rearm(struct pfr_i2c_ring *ring);
+
+size_t pfr_i2c_ring_get(struct pfr_i2c_ring *ring, uint8_t *msg, size_t length);
+
+#if PFR_I2C_TRACE_SIZE
+void pfr_i2c_ring_trace(struct pfr_i2c_ring *ring, uint8_t event, uint8_t value);
+#endif
+
+#endif /*PFR_I2C_RING_H*/
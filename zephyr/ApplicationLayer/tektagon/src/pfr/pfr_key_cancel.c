@@ -0,0 +1,146 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <string.h>
+#include "status/rot_status.h"
+#include "pfr_key_cancel.h"
+
+/**
+ * Read the policies from flash the first time they are needed.
+ */
+static int pfr_key_cancel_load(struct pfr_key_cancel *kc)
+{
+	int status;
+
+	if (kc->loaded)
+		return 0;
+
+	status = kc->flash->read(kc->flash, kc->base_addr, &kc->policy[0][0], sizeof(kc->policy));
+	if (status != 0)
+		return status;
+
+	kc->loaded = true;
+
+	return 0;
+}
+
+/**
+ * Initialize the cancellation policies.  Nothing is read from flash until the first lookup.
+ *
+ * @param kc The policies to initialize.
+ * @param flash The flash that holds the policies.
+ * @param base_addr Address of the PCH PFM policy.  The other policies follow it.
+ *
+ * @return 0 if the policies were initialized or an error code.
+ */
+int pfr_key_cancel_init(struct pfr_key_cancel *kc, struct flash *flash, uint32_t base_addr)
+{
+	if ((kc == NULL) || (flash == NULL))
+		return PFR_KEY_CANCEL_INVALID_ARGUMENT;
+
+	memset(kc, 0, sizeof(*kc));
+
+	kc->flash = flash;
+	kc->base_addr = base_addr;
+
+	return 0;
+}
+
+/**
+ * Drop the RAM copy so the policies are read from flash again, such as after the UFM has been
+ * erased or provisioned.
+ *
+ * @param kc The policies to invalidate.
+ */
+void pfr_key_cancel_invalidate(struct pfr_key_cancel *kc)
+{
+	if (kc)
+		kc->loaded = false;
+}
+
+/**
+ * Check if a CSK has been cancelled.
+ *
+ * A key that can't be checked, because the policy or key ID is not valid or the policies can't
+ * be read, is treated as cancelled.
+ *
+ * @param kc The policies to check.
+ * @param policy The policy for the image signed by the key.
+ * @param key_id The ID of the CSK.
+ *
+ * @return true if the key must not be used.
+ */
+bool pfr_key_cancel_is_cancelled(struct pfr_key_cancel *kc, int policy, uint32_t key_id)
+{
+	if ((kc == NULL) || (policy < 0) || (policy >= PFR_KEY_CANCEL_POLICIES) ||
+		(key_id >= PFR_KEY_CANCEL_KEY_IDS))
+		return true;
+
+	if (pfr_key_cancel_load(kc) != 0)
+		return true;
+
+	return !(kc->policy[policy][key_id / 8] & (0x80 >> (key_id % 8)));
+}
+
+/**
+ * Cancel a CSK.  The bit is programmed and read back before the RAM copy is updated, so lookups
+ * never report a cancellation that is not on flash.  On failure the copy is reloaded from flash
+ * on the next lookup.
+ *
+ * @param kc The policies to update.
+ * @param policy The policy for the images signed by the key.
+ * @param key_id The ID of the CSK to cancel.
+ *
+ * @return 0 if the key is cancelled or an error code.
+ */
+int pfr_key_cancel_cancel(struct pfr_key_cancel *kc, int policy, uint32_t key_id)
+{
+	uint32_t address;
+	uint8_t data;
+	uint8_t verify;
+	int status;
+
+	if ((kc == NULL) || (policy < 0) || (policy >= PFR_KEY_CANCEL_POLICIES) ||
+		(key_id >= PFR_KEY_CANCEL_KEY_IDS))
+		return PFR_KEY_CANCEL_INVALID_ARGUMENT;
+
+	status = pfr_key_cancel_load(kc);
+	if (status != 0)
+		return status;
+
+	data = kc->policy[policy][key_id / 8] & ~(0x80 >> (key_id % 8));
+	if (data == kc->policy[policy][key_id / 8])
+		return 0;
+
+	address = kc->base_addr + (policy * PFR_KEY_CANCEL_POLICY_SIZE) + (key_id / 8);
+
+	status = kc->flash->write(kc->flash, address, &data, sizeof(data));
+	if (ROT_IS_ERROR(status))
+		goto fail;
+	if (status != sizeof(data)) {
+		status = PFR_KEY_CANCEL_WRITE_FAILED;
+		goto fail;
+	}
+
+	status = kc->flash->read(kc->flash, address, &verify, sizeof(verify));
+	if (status != 0)
+		goto fail;
+
+	if (verify != data) {
+		status = PFR_KEY_CANCEL_WRITE_FAILED;
+		goto fail;
+	}
+
+	kc->policy[policy][key_id / 8] = data;
+
+	return 0;
+
+fail:
+	kc->loaded = false;
+	return status;
+}
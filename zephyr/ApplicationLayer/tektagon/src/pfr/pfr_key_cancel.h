@@ -0,0 +1,52 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_KEY_CANCEL_H
+#define PFR_KEY_CANCEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "flash/flash.h"
+
+/* Each signed image type has its own 128-bit cancellation policy.  The policies are consecutive
+ * in the UFM in this order. */
+#define PFR_KEY_CANCEL_POLICY_PCH_PFM		0
+#define PFR_KEY_CANCEL_POLICY_PCH_CAPSULE	1
+#define PFR_KEY_CANCEL_POLICY_BMC_PFM		2
+#define PFR_KEY_CANCEL_POLICY_BMC_CAPSULE	3
+#define PFR_KEY_CANCEL_POLICY_CPLD_CAPSULE	4
+#define PFR_KEY_CANCEL_POLICIES				5
+
+#define PFR_KEY_CANCEL_KEY_IDS				128
+#define PFR_KEY_CANCEL_POLICY_SIZE			(PFR_KEY_CANCEL_KEY_IDS / 8)
+
+/* Status codes returned in addition to the flash errors. */
+#define PFR_KEY_CANCEL_INVALID_ARGUMENT		-1	// Null policies, an unknown policy or key ID
+#define PFR_KEY_CANCEL_WRITE_FAILED			-2	// Flash does not hold the cancelled key
+
+/**
+ * RAM copy of the CSK cancellation policies.
+ *
+ * A key is cancelled by clearing its bit, most significant bit of the first byte for key 0, so
+ * cancelling never needs an erase.  Every policy is read once on first use and each lookup after
+ * that is a single bit test.  The copy only changes after flash holds the same data.
+ */
+struct pfr_key_cancel {
+	struct flash *flash;				/**< Flash that holds the policies. */
+	uint32_t base_addr;					/**< Address of the first policy. */
+	bool loaded;						/**< The copy holds the policies from flash. */
+	uint8_t policy[PFR_KEY_CANCEL_POLICIES][PFR_KEY_CANCEL_POLICY_SIZE];	/**< Policy bitmaps. */
+};
+
+int pfr_key_cancel_init(struct pfr_key_cancel *kc, struct flash *flash, uint32_t base_addr);
+void pfr_key_cancel_invalidate(struct pfr_key_cancel *kc);
+
+bool pfr_key_cancel_is_cancelled(struct pfr_key_cancel *kc, int policy, uint32_t key_id);
+int pfr_key_cancel_cancel(struct pfr_key_cancel *kc, int policy, uint32_t key_id);
+
+#endif /*PFR_KEY_CANCEL_H*/
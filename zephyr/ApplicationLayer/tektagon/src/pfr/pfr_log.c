@@ -0,0 +1,143 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <zephyr.h>
+#include <stdlib.h>
+#include "logging/debug_log.h"
+#include "pfr_log.h"
+
+#ifdef CONFIG_SHELL
+#include <shell/shell.h>
+#endif
+
+static struct pfr_log_batch pfr_log_batch;
+static bool pfr_log_started;
+
+K_SEM_DEFINE(pfr_log_sem, 0, 1);
+K_THREAD_STACK_DEFINE(pfr_log_stack, PFR_LOG_THREAD_STACK_SIZE);
+static struct k_thread pfr_log_thread_data;
+
+static void pfr_log_wake(void *context)
+{
+	ARG_UNUSED(context);
+
+	k_sem_give(&pfr_log_sem);
+}
+
+static void pfr_log_thread(void *arg1, void *arg2, void *arg3)
+{
+	k_timeout_t timeout;
+	int rc;
+
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+	ARG_UNUSED(arg3);
+
+	while (1) {
+		// Only wait for the system to go idle while there is something to flush
+		timeout = pfr_log_batch_pending(&pfr_log_batch) ? K_MSEC(PFR_LOG_IDLE_MS) : K_FOREVER;
+		rc = k_sem_take(&pfr_log_sem, timeout);
+
+		pfr_log_batch_process(&pfr_log_batch, rc != 0);
+	}
+}
+
+/**
+ * Put a RAM queue in front of the debug log and start the thread that writes it to flash.  The
+ * debug log must already be initialized.
+ *
+ * @return 0 if logging is batched or an error code.  On failure, entries keep going straight to
+ * the flash log.
+ */
+int pfr_log_init(void)
+{
+	k_tid_t tid;
+	int status;
+
+	if (debug_log == NULL)
+		return LOGGING_NO_LOG_AVAILABLE;
+
+	status = pfr_log_batch_init(&pfr_log_batch, debug_log, pfr_log_wake, NULL);
+	if (status != 0)
+		return status;
+
+	// The flusher only runs when nothing else is ready, so logging never delays verification
+	tid = k_thread_create(&pfr_log_thread_data, pfr_log_stack,
+		K_THREAD_STACK_SIZEOF(pfr_log_stack), pfr_log_thread, NULL, NULL, NULL,
+		K_LOWEST_APPLICATION_THREAD_PRIO, 0, K_NO_WAIT);
+	if (tid == NULL) {
+		pfr_log_batch_release(&pfr_log_batch);
+		return LOGGING_NO_MEMORY;
+	}
+
+	k_thread_name_set(tid, "pfr_log");
+
+	debug_log = &pfr_log_batch.base;
+	pfr_log_started = true;
+
+	return 0;
+}
+
+/**
+ * Write every queued log entry to flash.  Call this before a reset or lockdown.
+ *
+ * @return 0 if the log was drained or an error code.
+ */
+int pfr_log_drain(void)
+{
+	if (!pfr_log_started)
+		return debug_log_flush();
+
+	return pfr_log_batch_drain(&pfr_log_batch);
+}
+
+#ifdef CONFIG_SHELL
+static int pfr_log_cmd_printk(const struct shell *shell, size_t argc, char **argv)
+{
+	uint32_t modules;
+	char *end;
+
+	if (argc > 1) {
+		modules = strtoul(argv[1], &end, 0);
+		if (*end != '\0') {
+			shell_error(shell, "Invalid module mask: %s", argv[1]);
+			return -EINVAL;
+		}
+
+		pfr_printk_set_modules(modules);
+	}
+
+	shell_print(shell, "printk modules: 0x%02x (status 0x%x, update 0x%x, auth 0x%x, mailbox 0x%x, "
+		"manifest 0x%x, util 0x%x)", pfr_printk_modules, PFR_PRINTK_STATUS, PFR_PRINTK_UPDATE,
+		PFR_PRINTK_AUTHENTICATION, PFR_PRINTK_MAILBOX, PFR_PRINTK_MANIFEST, PFR_PRINTK_UTIL);
+
+	return 0;
+}
+
+static int pfr_log_cmd_drain(const struct shell *shell, size_t argc, char **argv)
+{
+	int status;
+
+	status = pfr_log_drain();
+	if (status != 0) {
+		shell_error(shell, "Drain failed: 0x%x", status);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(pfr_log_cmds,
+	SHELL_CMD_ARG(printk, NULL, "Show or set the modules that print: printk [mask]",
+		pfr_log_cmd_printk, 1, 1),
+	SHELL_CMD(drain, NULL, "Write queued log entries to flash", pfr_log_cmd_drain),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(pfr_log, &pfr_log_cmds, "PFR logging", NULL);
+#endif
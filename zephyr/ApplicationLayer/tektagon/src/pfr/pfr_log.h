@@ -0,0 +1,27 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_LOG_H
+#define PFR_LOG_H
+
+#include "pfr_log_batch.h"
+#include "pfr_printk.h"
+
+/*
+ * Stack for the thread that writes queued log entries to flash.  A flush runs the whole flash write
+ * path, from the batch entry copy through logging_flash and the Flash Wrapper down to the SPI driver.
+ */
+#define PFR_LOG_THREAD_STACK_SIZE	4096
+
+/* The log is flushed once nothing has been logged for this long. */
+#define PFR_LOG_IDLE_MS				200
+
+int pfr_log_init(void);
+int pfr_log_drain(void);
+
+#endif /*PFR_LOG_H*/
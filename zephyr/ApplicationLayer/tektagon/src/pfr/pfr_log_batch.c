@@ -0,0 +1,373 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <string.h>
+#include "pfr_log_batch.h"
+
+/* Each queued entry starts with its length. */
+#define PFR_LOG_BATCH_LENGTH_SIZE		2
+
+static void pfr_log_batch_ring_write(struct pfr_log_batch *batch, size_t offset,
+		const uint8_t *data, size_t length)
+{
+	size_t first;
+
+	offset %= PFR_LOG_BATCH_RING_SIZE;
+	first = PFR_LOG_BATCH_RING_SIZE - offset;
+	if (first > length)
+		first = length;
+
+	memcpy(&batch->ring[offset], data, first);
+	memcpy(batch->ring, &data[first], length - first);
+}
+
+static void pfr_log_batch_ring_read(struct pfr_log_batch *batch, size_t offset, uint8_t *data,
+		size_t length)
+{
+	size_t first;
+
+	offset %= PFR_LOG_BATCH_RING_SIZE;
+	first = PFR_LOG_BATCH_RING_SIZE - offset;
+	if (first > length)
+		first = length;
+
+	memcpy(data, &batch->ring[offset], first);
+	memcpy(&data[first], batch->ring, length - first);
+}
+
+/**
+ * Hand every queued entry to the backing log.  The caller must hold the flush lock.
+ *
+ * Entries are taken out of the ring one at a time, so the ring is not locked while the backing log
+ * runs and new entries can be queued in the meantime.
+ *
+ * @param batch The log to empty.
+ *
+ * @return 0 if all entries were added to the backing log or an error code.
+ */
+static int pfr_log_batch_move(struct pfr_log_batch *batch)
+{
+	uint8_t entry[PFR_LOG_BATCH_MAX_ENTRY];
+	uint8_t header[PFR_LOG_BATCH_LENGTH_SIZE];
+	size_t length;
+	int status;
+
+	while (1) {
+		platform_mutex_lock(&batch->lock);
+
+		if (batch->used == 0) {
+			platform_mutex_unlock(&batch->lock);
+			return 0;
+		}
+
+		pfr_log_batch_ring_read(batch, batch->head, header, sizeof(header));
+		length = header[0] | (header[1] << 8);
+		pfr_log_batch_ring_read(batch, batch->head + sizeof(header), entry, length);
+
+		batch->head = (batch->head + sizeof(header) + length) % PFR_LOG_BATCH_RING_SIZE;
+		batch->used -= sizeof(header) + length;
+		batch->unflushed += sizeof(struct logging_entry_header) + length;
+
+		platform_mutex_unlock(&batch->lock);
+
+		status = batch->backing->create_entry(batch->backing, entry, length);
+		if (status != 0)
+			return status;
+	}
+}
+
+/**
+ * Hand queued entries to the backing log and flush it if enough data has built up.  The caller must
+ * hold the flush lock.
+ *
+ * @param batch The log to write out.
+ * @param force Flush the backing log even if less than a page is waiting.
+ *
+ * @return 0 if the entries were written out or an error code.
+ */
+static int pfr_log_batch_write_out(struct pfr_log_batch *batch, bool force)
+{
+	size_t unflushed;
+	int status;
+
+	status = pfr_log_batch_move(batch);
+	if (status != 0)
+		return status;
+
+	platform_mutex_lock(&batch->lock);
+	unflushed = batch->unflushed;
+	platform_mutex_unlock(&batch->lock);
+
+	if ((unflushed == 0) || (!force && (unflushed < PFR_LOG_BATCH_PAGE_SIZE)))
+		return 0;
+
+	status = batch->backing->flush(batch->backing);
+	if (status != 0)
+		return status;
+
+	platform_mutex_lock(&batch->lock);
+	batch->unflushed -= unflushed;
+	platform_mutex_unlock(&batch->lock);
+
+	return 0;
+}
+
+static int pfr_log_batch_create_entry(struct logging *logging, uint8_t *entry, size_t length)
+{
+	struct pfr_log_batch *batch = (struct pfr_log_batch *) logging;
+	uint8_t header[PFR_LOG_BATCH_LENGTH_SIZE];
+	size_t record = sizeof(header) + length;
+	bool wake;
+	int status;
+
+	if ((batch == NULL) || (entry == NULL))
+		return LOGGING_INVALID_ARGUMENT;
+
+	if ((length == 0) || (length > PFR_LOG_BATCH_MAX_ENTRY))
+		return LOGGING_BAD_ENTRY_LENGTH;
+
+	platform_mutex_lock(&batch->lock);
+
+	while ((batch->used + record) > PFR_LOG_BATCH_RING_SIZE) {
+		// The flusher has fallen behind, so empty the ring from here rather than lose entries
+		batch->overflows++;
+		platform_mutex_unlock(&batch->lock);
+
+		platform_mutex_lock(&batch->flush_lock);
+		status = pfr_log_batch_move(batch);
+		platform_mutex_unlock(&batch->flush_lock);
+		if (status != 0)
+			return status;
+
+		platform_mutex_lock(&batch->lock);
+	}
+
+	header[0] = length;
+	header[1] = length >> 8;
+	pfr_log_batch_ring_write(batch, batch->head + batch->used, header, sizeof(header));
+	pfr_log_batch_ring_write(batch, batch->head + batch->used + sizeof(header), entry, length);
+	batch->used += record;
+
+	wake = (batch->used + batch->unflushed) >= PFR_LOG_BATCH_PAGE_SIZE;
+
+	platform_mutex_unlock(&batch->lock);
+
+	if (wake && batch->wake)
+		batch->wake(batch->context);
+
+	return 0;
+}
+
+static int pfr_log_batch_flush(struct logging *logging)
+{
+	struct pfr_log_batch *batch = (struct pfr_log_batch *) logging;
+
+	if (batch == NULL)
+		return LOGGING_INVALID_ARGUMENT;
+
+	// Entries are made persistent by the flusher, which batches them until the system is idle
+	if (batch->wake)
+		batch->wake(batch->context);
+
+	return 0;
+}
+
+static int pfr_log_batch_clear(struct logging *logging)
+{
+	struct pfr_log_batch *batch = (struct pfr_log_batch *) logging;
+	int status;
+
+	if (batch == NULL)
+		return LOGGING_INVALID_ARGUMENT;
+
+	platform_mutex_lock(&batch->flush_lock);
+
+	platform_mutex_lock(&batch->lock);
+	batch->head = 0;
+	batch->used = 0;
+	batch->unflushed = 0;
+	platform_mutex_unlock(&batch->lock);
+
+	status = batch->backing->clear(batch->backing);
+
+	platform_mutex_unlock(&batch->flush_lock);
+
+	return status;
+}
+
+static int pfr_log_batch_get_size(struct logging *logging)
+{
+	struct pfr_log_batch *batch = (struct pfr_log_batch *) logging;
+	int status;
+
+	if (batch == NULL)
+		return LOGGING_INVALID_ARGUMENT;
+
+	platform_mutex_lock(&batch->flush_lock);
+
+	status = pfr_log_batch_move(batch);
+	if (status == 0)
+		status = batch->backing->get_size(batch->backing);
+
+	platform_mutex_unlock(&batch->flush_lock);
+
+	return status;
+}
+
+static int pfr_log_batch_read_contents(struct logging *logging, uint32_t offset, uint8_t *contents,
+		size_t length)
+{
+	struct pfr_log_batch *batch = (struct pfr_log_batch *) logging;
+	int status;
+
+	if (batch == NULL)
+		return LOGGING_INVALID_ARGUMENT;
+
+	platform_mutex_lock(&batch->flush_lock);
+
+	status = pfr_log_batch_move(batch);
+	if (status == 0)
+		status = batch->backing->read_contents(batch->backing, offset, contents, length);
+
+	platform_mutex_unlock(&batch->flush_lock);
+
+	return status;
+}
+
+/**
+ * Initialize a log that queues entries in RAM ahead of a persistent log.
+ *
+ * @param batch The log to initialize.
+ * @param backing The log that stores the entries.
+ * @param wake Called when there is enough queued data for the flusher to write out, or when the
+ * log is flushed.  It may be called from any thread that logs, so it must only signal the flusher.
+ * @param context Context passed to the wake callback.
+ *
+ * @return 0 if the log was initialized or an error code.
+ */
+int pfr_log_batch_init(struct pfr_log_batch *batch, struct logging *backing,
+		void (*wake) (void *context), void *context)
+{
+	int status;
+
+	if ((batch == NULL) || (backing == NULL))
+		return LOGGING_INVALID_ARGUMENT;
+
+	memset(batch, 0, sizeof(*batch));
+
+	status = platform_mutex_init(&batch->lock);
+	if (status != 0)
+		return status;
+
+	status = platform_mutex_init(&batch->flush_lock);
+	if (status != 0) {
+		platform_mutex_free(&batch->lock);
+		return status;
+	}
+
+	batch->backing = backing;
+	batch->wake = wake;
+	batch->context = context;
+
+	batch->base.create_entry = pfr_log_batch_create_entry;
+	batch->base.flush = pfr_log_batch_flush;
+	batch->base.clear = pfr_log_batch_clear;
+	batch->base.get_size = pfr_log_batch_get_size;
+	batch->base.read_contents = pfr_log_batch_read_contents;
+
+	return 0;
+}
+
+/**
+ * Release the resources of a batched log.  Queued entries are discarded.
+ *
+ * @param batch The log to release.
+ */
+void pfr_log_batch_release(struct pfr_log_batch *batch)
+{
+	if (batch) {
+		platform_mutex_free(&batch->lock);
+		platform_mutex_free(&batch->flush_lock);
+	}
+}
+
+/**
+ * Run the flusher once: hand queued entries to the backing log and flush it when a page has built
+ * up, or when the system is idle and anything is waiting.
+ *
+ * @param batch The log to write out.
+ * @param idle Nothing has been logged for a while, so flush whatever is waiting.
+ *
+ * @return 0 if the queued entries were written out or an error code.
+ */
+int pfr_log_batch_process(struct pfr_log_batch *batch, bool idle)
+{
+	int status;
+
+	if (batch == NULL)
+		return LOGGING_INVALID_ARGUMENT;
+
+	platform_mutex_lock(&batch->flush_lock);
+	status = pfr_log_batch_write_out(batch, idle);
+	platform_mutex_unlock(&batch->flush_lock);
+
+	return status;
+}
+
+/**
+ * Write every queued entry to persistent storage.  This must be called before a reset or anything
+ * else that would stop the flusher, such as lockdown.
+ *
+ * @param batch The log to drain.
+ *
+ * @return 0 if the log was drained or an error code.
+ */
+int pfr_log_batch_drain(struct pfr_log_batch *batch)
+{
+	int status;
+
+	if (batch == NULL)
+		return LOGGING_INVALID_ARGUMENT;
+
+	platform_mutex_lock(&batch->flush_lock);
+
+	status = pfr_log_batch_move(batch);
+	if (status == 0)
+		status = batch->backing->flush(batch->backing);
+
+	if (status == 0) {
+		platform_mutex_lock(&batch->lock);
+		batch->unflushed = 0;
+		platform_mutex_unlock(&batch->lock);
+	}
+
+	platform_mutex_unlock(&batch->flush_lock);
+
+	return status;
+}
+
+/**
+ * Get the amount of logged data that is not yet persistent.
+ *
+ * @param batch The log to query.
+ *
+ * @return The number of bytes waiting in the ring or in the backing log's buffer.
+ */
+size_t pfr_log_batch_pending(struct pfr_log_batch *batch)
+{
+	size_t pending;
+
+	if (batch == NULL)
+		return 0;
+
+	platform_mutex_lock(&batch->lock);
+	pending = batch->used + batch->unflushed;
+	platform_mutex_unlock(&batch->lock);
+
+	return pending;
+}
@@ -0,0 +1,58 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_LOG_BATCH_H
+#define PFR_LOG_BATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "platform.h"
+#include "logging/logging.h"
+
+/* Entries wait in a RAM ring and reach flash a page at a time. */
+#define PFR_LOG_BATCH_RING_SIZE			2048
+#define PFR_LOG_BATCH_PAGE_SIZE			256
+#define PFR_LOG_BATCH_MAX_ENTRY			128
+
+/**
+ * Log that queues entries in RAM in front of a persistent log, so the code creating entries never
+ * waits on flash.
+ *
+ * Creating an entry only copies it into the ring.  A low priority flusher moves queued entries to
+ * the backing log with pfr_log_batch_process and has the backing log program them once a page has
+ * built up or the system is idle.  Flushing this log only asks the flusher to run.  Before a reset
+ * or lockdown, pfr_log_batch_drain writes out everything that is queued.
+ *
+ * If the ring fills because the flusher has not run, the entry creating the overflow moves the
+ * queue to the backing log itself, so no entries are lost.
+ */
+struct pfr_log_batch {
+	struct logging base;				/**< The base logging instance. */
+	struct logging *backing;			/**< The persistent log the entries are written to. */
+	void (*wake) (void *context);		/**< Notify the flusher there is work, or null. */
+	void *context;						/**< Context for the flusher notification. */
+	platform_mutex lock;				/**< Synchronization for the ring. */
+	platform_mutex flush_lock;			/**< Serializes access to the backing log. */
+	uint8_t ring[PFR_LOG_BATCH_RING_SIZE];	/**< Queued entries, each after a 16-bit length. */
+	size_t head;						/**< Ring offset of the oldest queued entry. */
+	size_t used;						/**< Number of bytes queued in the ring. */
+	size_t unflushed;					/**< Bytes given to the backing log since its last flush. */
+	uint32_t overflows;					/**< Entries that had to be written out synchronously. */
+};
+
+int pfr_log_batch_init(struct pfr_log_batch *batch, struct logging *backing,
+		void (*wake) (void *context), void *context);
+void pfr_log_batch_release(struct pfr_log_batch *batch);
+
+int pfr_log_batch_process(struct pfr_log_batch *batch, bool idle);
+int pfr_log_batch_drain(struct pfr_log_batch *batch);
+
+size_t pfr_log_batch_pending(struct pfr_log_batch *batch);
+
+#endif /*PFR_LOG_BATCH_H*/
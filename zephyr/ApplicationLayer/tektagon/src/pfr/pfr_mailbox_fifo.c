@@ -0,0 +1,186 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <string.h>
+#include "pfr_mailbox_fifo.h"
+
+/**
+ * Empty a FIFO.
+ *
+ * @param fifo The FIFO to flush.
+ */
+void pfr_mailbox_fifo_flush(struct pfr_mailbox_fifo *fifo)
+{
+	if (fifo == NULL)
+		return;
+
+	memset(fifo, 0, sizeof(*fifo));
+}
+
+/**
+ * Add data to the end of a FIFO.  Nothing is added if all of the data does not fit.
+ *
+ * @param fifo The FIFO to add to.
+ * @param data The data to add.
+ * @param length Length of the data.
+ *
+ * @return 0 if the data was added or an error code.
+ */
+int pfr_mailbox_fifo_push(struct pfr_mailbox_fifo *fifo, const uint8_t *data, size_t length)
+{
+	if ((fifo == NULL) || ((data == NULL) && (length != 0)))
+		return PFR_MAILBOX_INVALID_ARGUMENT;
+
+	if (length == 0)
+		return 0;
+
+	if (length > (sizeof(fifo->data) - fifo->length))
+		return PFR_MAILBOX_FIFO_FULL;
+
+	memcpy(&fifo->data[fifo->length], data, length);
+	fifo->length += length;
+
+	return 0;
+}
+
+/**
+ * Read the next byte of a FIFO, as for a read of the UFM Read FIFO register.
+ *
+ * @param fifo The FIFO to read.
+ *
+ * @return The next byte or 0 if the FIFO is empty.
+ */
+uint8_t pfr_mailbox_fifo_pop(struct pfr_mailbox_fifo *fifo)
+{
+	if ((fifo == NULL) || (fifo->index >= fifo->length))
+		return 0;
+
+	return fifo->data[fifo->index++];
+}
+
+/**
+ * Replace the contents of a FIFO, such as with the result of a UFM read command.
+ *
+ * @param fifo The FIFO to load.
+ * @param data The new contents.
+ * @param length Length of the contents.
+ *
+ * @return 0 if the FIFO was loaded or an error code.
+ */
+int pfr_mailbox_fifo_load(struct pfr_mailbox_fifo *fifo, const uint8_t *data, size_t length)
+{
+	if (fifo == NULL)
+		return PFR_MAILBOX_INVALID_ARGUMENT;
+
+	pfr_mailbox_fifo_flush(fifo);
+
+	return pfr_mailbox_fifo_push(fifo, data, length);
+}
+
+/**
+ * Update an SMBus packet error code, a CRC-8 with the polynomial x^8 + x^2 + x + 1.
+ *
+ * @param crc The current PEC, 0 for a new transaction.
+ * @param data The bytes to add.
+ * @param length Number of bytes to add.
+ *
+ * @return The updated PEC.
+ */
+uint8_t pfr_mailbox_pec(uint8_t crc, const uint8_t *data, size_t length)
+{
+	size_t i;
+	int bit;
+
+	for (i = 0; i < length; i++) {
+		crc ^= data[i];
+		for (bit = 0; bit < 8; bit++)
+			crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+	}
+
+	return crc;
+}
+
+/**
+ * Add the data of an SMBus block write to a FIFO.
+ *
+ * The transaction is the command, the byte count, the data and an optional PEC.  If the PEC is
+ * there, it covers the target address as well, so a corrupted block is rejected as a whole.
+ *
+ * @param fifo The FIFO to add to.
+ * @param address The 7-bit target address the block was written to.
+ * @param msg The bytes received after the address.
+ * @param length Number of bytes received.
+ *
+ * @return 0 if the data was added or an error code.
+ */
+int pfr_mailbox_block_write(struct pfr_mailbox_fifo *fifo, uint8_t address, const uint8_t *msg,
+		size_t length)
+{
+	uint8_t write_addr = address << 1;
+	uint8_t count;
+	uint8_t pec;
+
+	if ((fifo == NULL) || (msg == NULL))
+		return PFR_MAILBOX_INVALID_ARGUMENT;
+
+	if (length < 2)
+		return PFR_MAILBOX_BAD_LENGTH;
+
+	count = msg[1];
+	if ((count == 0) || ((length != (size_t) (count + 2)) && (length != (size_t) (count + 3))))
+		return PFR_MAILBOX_BAD_LENGTH;
+
+	if (length == (size_t) (count + 3)) {
+		pec = pfr_mailbox_pec(0, &write_addr, 1);
+		pec = pfr_mailbox_pec(pec, msg, count + 2);
+		if (pec != msg[count + 2])
+			return PFR_MAILBOX_BAD_PEC;
+	}
+
+	return pfr_mailbox_fifo_push(fifo, &msg[2], count);
+}
+
+/**
+ * Build the response to an SMBus block read from the unread bytes of a FIFO.
+ *
+ * The response is the byte count, the data and the PEC.  The PEC covers the write address, the
+ * command and the read address sent by the host, so the host can check the whole transaction.  A
+ * host that does not use PEC stops reading before it.
+ *
+ * @param fifo The FIFO to read.
+ * @param address The 7-bit target address being read.
+ * @param command The command the host wrote before the read.
+ * @param msg Output for the response.
+ * @param length Size of the output buffer.
+ *
+ * @return Length of the response or an error code.
+ */
+int pfr_mailbox_block_read(struct pfr_mailbox_fifo *fifo, uint8_t address, uint8_t command,
+		uint8_t *msg, size_t length)
+{
+	uint8_t header[3];
+	uint8_t count;
+
+	if ((fifo == NULL) || (msg == NULL) || (length < 2))
+		return PFR_MAILBOX_INVALID_ARGUMENT;
+
+	count = fifo->length - fifo->index;
+	if (count > (length - 2))
+		count = length - 2;
+
+	msg[0] = count;
+	memcpy(&msg[1], &fifo->data[fifo->index], count);
+	fifo->index += count;
+
+	header[0] = address << 1;
+	header[1] = command;
+	header[2] = (address << 1) | 1;
+	msg[count + 1] = pfr_mailbox_pec(pfr_mailbox_pec(0, header, sizeof(header)), msg, count + 1);
+
+	return count + 2;
+}
@@ -0,0 +1,52 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_MAILBOX_FIFO_H
+#define PFR_MAILBOX_FIFO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Each FIFO holds the largest provisioning item, a SHA-384 root key hash with room to spare. */
+#define PFR_MAILBOX_FIFO_SIZE				64
+
+/* Longest SMBus block transaction: command, byte count, a full FIFO and the PEC. */
+#define PFR_MAILBOX_BLOCK_MAX				(PFR_MAILBOX_FIFO_SIZE + 3)
+
+/* Status codes returned by the FIFO and block transfers. */
+#define PFR_MAILBOX_INVALID_ARGUMENT		-1	// Null FIFO or buffer
+#define PFR_MAILBOX_FIFO_FULL				-2	// The data does not fit in the FIFO
+#define PFR_MAILBOX_BAD_LENGTH				-3	// The byte count does not match the transaction
+#define PFR_MAILBOX_BAD_PEC					-4	// Packet error code mismatch
+
+/**
+ * A UFM FIFO of the SMBus mailbox.
+ *
+ * The byte registers push or pop one byte per transaction.  The block transfers move the whole
+ * item with a single SMBus block write or block read, so a root key hash costs one transaction
+ * instead of one per byte.
+ */
+struct pfr_mailbox_fifo {
+	uint8_t data[PFR_MAILBOX_FIFO_SIZE];	/**< FIFO contents. */
+	uint8_t length;						/**< Number of bytes in the FIFO. */
+	uint8_t index;						/**< Next byte to be read. */
+};
+
+void pfr_mailbox_fifo_flush(struct pfr_mailbox_fifo *fifo);
+int pfr_mailbox_fifo_push(struct pfr_mailbox_fifo *fifo, const uint8_t *data, size_t length);
+uint8_t pfr_mailbox_fifo_pop(struct pfr_mailbox_fifo *fifo);
+int pfr_mailbox_fifo_load(struct pfr_mailbox_fifo *fifo, const uint8_t *data, size_t length);
+
+uint8_t pfr_mailbox_pec(uint8_t crc, const uint8_t *data, size_t length);
+
+int pfr_mailbox_block_write(struct pfr_mailbox_fifo *fifo, uint8_t address, const uint8_t *msg,
+		size_t length);
+int pfr_mailbox_block_read(struct pfr_mailbox_fifo *fifo, uint8_t address, uint8_t command,
+		uint8_t *msg, size_t length);
+
+#endif /*PFR_MAILBOX_FIFO_H*/
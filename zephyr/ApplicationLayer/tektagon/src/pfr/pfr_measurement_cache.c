@@ -0,0 +1,538 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <string.h>
+#include "status/rot_status.h"
+#include "pfr_measurement_cache.h"
+
+/* Record header, followed by the region entries. */
+#define PFR_MEASUREMENT_CACHE_MAGIC			0x4D534D43
+#define PFR_MEASUREMENT_CACHE_HEADER_SIZE	64
+#define PFR_MEASUREMENT_CACHE_MAGIC_OFFSET	0
+#define PFR_MEASUREMENT_CACHE_COUNT_OFFSET	4
+#define PFR_MEASUREMENT_CACHE_KEY_LEN_OFFSET	6
+#define PFR_MEASUREMENT_CACHE_KEY_OFFSET	8
+#define PFR_MEASUREMENT_CACHE_CHECK_OFFSET	56
+
+/* Region entry. */
+#define PFR_MEASUREMENT_CACHE_ENTRY_SIZE	60
+#define PFR_MEASUREMENT_CACHE_START_OFFSET	0
+#define PFR_MEASUREMENT_CACHE_END_OFFSET	4
+#define PFR_MEASUREMENT_CACHE_DIGEST_LEN_OFFSET	8
+#define PFR_MEASUREMENT_CACHE_STATE_OFFSET	9
+#define PFR_MEASUREMENT_CACHE_DIGEST_OFFSET	12
+
+/* Entry states.  Going from clean to dirty only clears bits. */
+#define PFR_MEASUREMENT_CACHE_CLEAN			0xff
+#define PFR_MEASUREMENT_CACHE_DIRTY			0x00
+
+#define PFR_MEASUREMENT_CACHE_ENTRY(cache, i)	\
+	(&(cache)->data[PFR_MEASUREMENT_CACHE_HEADER_SIZE + ((i) * PFR_MEASUREMENT_CACHE_ENTRY_SIZE)])
+
+static uint32_t pfr_measurement_cache_get32(const uint8_t *data)
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+static void pfr_measurement_cache_put32(uint8_t *data, uint32_t value)
+{
+	data[0] = value;
+	data[1] = value >> 8;
+	data[2] = value >> 16;
+	data[3] = value >> 24;
+}
+
+static size_t pfr_measurement_cache_get_count(struct pfr_measurement_cache *cache)
+{
+	return cache->data[PFR_MEASUREMENT_CACHE_COUNT_OFFSET] |
+		(cache->data[PFR_MEASUREMENT_CACHE_COUNT_OFFSET + 1] << 8);
+}
+
+static void pfr_measurement_cache_set_count(struct pfr_measurement_cache *cache, size_t count)
+{
+	cache->data[PFR_MEASUREMENT_CACHE_COUNT_OFFSET] = count;
+	cache->data[PFR_MEASUREMENT_CACHE_COUNT_OFFSET + 1] = count >> 8;
+}
+
+static bool pfr_measurement_cache_has_record(struct pfr_measurement_cache *cache)
+{
+	return cache->loaded &&
+		(pfr_measurement_cache_get32(&cache->data[PFR_MEASUREMENT_CACHE_MAGIC_OFFSET]) ==
+			PFR_MEASUREMENT_CACHE_MAGIC);
+}
+
+/**
+ * FNV-1a over the record, skipping the entry states so marking an entry dirty does not break it.
+ */
+static uint32_t pfr_measurement_cache_checksum(struct pfr_measurement_cache *cache, size_t count)
+{
+	uint32_t check = 0x811c9dc5;
+	size_t end;
+	size_t i;
+
+	end = PFR_MEASUREMENT_CACHE_HEADER_SIZE + (count * PFR_MEASUREMENT_CACHE_ENTRY_SIZE);
+	for (i = PFR_MEASUREMENT_CACHE_COUNT_OFFSET; i < end; i++) {
+		if ((i >= PFR_MEASUREMENT_CACHE_CHECK_OFFSET) && (i < PFR_MEASUREMENT_CACHE_HEADER_SIZE))
+			continue;
+
+		if ((i >= PFR_MEASUREMENT_CACHE_HEADER_SIZE) &&
+			(((i - PFR_MEASUREMENT_CACHE_HEADER_SIZE) % PFR_MEASUREMENT_CACHE_ENTRY_SIZE) ==
+				PFR_MEASUREMENT_CACHE_STATE_OFFSET))
+			continue;
+
+		check ^= cache->data[i];
+		check *= 0x01000193;
+	}
+
+	return check;
+}
+
+/**
+ * Check the record read from flash.  Anything that was not completely written is rejected.
+ */
+static bool pfr_measurement_cache_record_is_valid(struct pfr_measurement_cache *cache)
+{
+	size_t count = pfr_measurement_cache_get_count(cache);
+
+	if (pfr_measurement_cache_get32(&cache->data[PFR_MEASUREMENT_CACHE_MAGIC_OFFSET]) !=
+		PFR_MEASUREMENT_CACHE_MAGIC)
+		return false;
+
+	if ((count > PFR_MEASUREMENT_CACHE_MAX_REGIONS) ||
+		(cache->data[PFR_MEASUREMENT_CACHE_KEY_LEN_OFFSET] > PFR_MEASUREMENT_CACHE_MAX_KEY))
+		return false;
+
+	return pfr_measurement_cache_get32(&cache->data[PFR_MEASUREMENT_CACHE_CHECK_OFFSET]) ==
+		pfr_measurement_cache_checksum(cache, count);
+}
+
+/**
+ * Initialize a measurement cache.  Nothing is read from flash until the first access.
+ *
+ * @param cache The cache to initialize.
+ * @param flash The flash that holds the measurement sector.
+ * @param base_addr The sector aligned address of the measurements.
+ *
+ * @return 0 if the cache was initialized or an error code.
+ */
+int pfr_measurement_cache_init(struct pfr_measurement_cache *cache, struct flash *flash,
+		uint32_t base_addr)
+{
+	if ((cache == NULL) || (flash == NULL) ||
+		((base_addr & (PFR_MEASUREMENT_CACHE_SIZE - 1)) != 0))
+		return PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT;
+
+	memset(cache, 0, sizeof(*cache));
+	cache->flash = flash;
+	cache->base_addr = base_addr;
+
+	return 0;
+}
+
+/**
+ * Read the sector into RAM if it has not been loaded yet.  A record that is not valid is treated as
+ * an empty cache.
+ */
+static int pfr_measurement_cache_load(struct pfr_measurement_cache *cache)
+{
+	int status;
+
+	if (cache->loaded)
+		return 0;
+
+	status = cache->flash->read(cache->flash, cache->base_addr, cache->data, sizeof(cache->data));
+	if (status != 0)
+		return status;
+
+	if (!pfr_measurement_cache_record_is_valid(cache))
+		memset(cache->data, 0xff, sizeof(cache->data));
+
+	cache->loaded = true;
+	cache->stored = true;
+
+	return 0;
+}
+
+/**
+ * Program part of the sector from the RAM copy.
+ */
+static int pfr_measurement_cache_program(struct pfr_measurement_cache *cache, uint32_t offset,
+	const uint8_t *data, uint32_t length)
+{
+	int status;
+
+	status = cache->flash->write(cache->flash, cache->base_addr + offset, data, length);
+	if (ROT_IS_ERROR(status))
+		return status;
+
+	return ((uint32_t) status == length) ? 0 : PFR_MEASUREMENT_CACHE_WRITE_FAILED;
+}
+
+/**
+ * Drop the record on flash by clearing its magic number.
+ */
+static int pfr_measurement_cache_drop(struct pfr_measurement_cache *cache)
+{
+	uint8_t zero[4] = {0};
+
+	return pfr_measurement_cache_program(cache, PFR_MEASUREMENT_CACHE_MAGIC_OFFSET, zero,
+		sizeof(zero));
+}
+
+/**
+ * Select the measurements for a PFM.  If the cache holds measurements for a different PFM, they are
+ * dropped and an empty record is started for this one.
+ *
+ * @param cache The cache to use.
+ * @param key Digest that identifies the active PFM.
+ * @param key_length Length of the key.
+ *
+ * @return 0 if the cache is ready for the PFM or an error code.
+ */
+int pfr_measurement_cache_select(struct pfr_measurement_cache *cache, const uint8_t *key,
+		size_t key_length)
+{
+	int status;
+
+	if ((cache == NULL) || (key == NULL) || (key_length > PFR_MEASUREMENT_CACHE_MAX_KEY))
+		return PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT;
+
+	status = pfr_measurement_cache_load(cache);
+	if (status != 0)
+		return status;
+
+	if (pfr_measurement_cache_has_record(cache) &&
+		(cache->data[PFR_MEASUREMENT_CACHE_KEY_LEN_OFFSET] == key_length) &&
+		(memcmp(&cache->data[PFR_MEASUREMENT_CACHE_KEY_OFFSET], key, key_length) == 0))
+		return 0;
+
+	if (pfr_measurement_cache_has_record(cache)) {
+		status = pfr_measurement_cache_drop(cache);
+		if (status != 0) {
+			cache->loaded = false;
+			return status;
+		}
+	}
+
+	memset(cache->data, 0xff, sizeof(cache->data));
+	pfr_measurement_cache_put32(&cache->data[PFR_MEASUREMENT_CACHE_MAGIC_OFFSET],
+		PFR_MEASUREMENT_CACHE_MAGIC);
+	pfr_measurement_cache_set_count(cache, 0);
+	cache->data[PFR_MEASUREMENT_CACHE_KEY_LEN_OFFSET] = key_length;
+	memcpy(&cache->data[PFR_MEASUREMENT_CACHE_KEY_OFFSET], key, key_length);
+	cache->stored = false;
+
+	return 0;
+}
+
+/**
+ * Find the entry for a region.
+ *
+ * @return The entry index or -1 if the region has no entry.
+ */
+static int pfr_measurement_cache_find(struct pfr_measurement_cache *cache, uint32_t start_address,
+	uint32_t end_address)
+{
+	size_t count = pfr_measurement_cache_get_count(cache);
+	const uint8_t *entry;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		entry = PFR_MEASUREMENT_CACHE_ENTRY(cache, i);
+		if ((pfr_measurement_cache_get32(&entry[PFR_MEASUREMENT_CACHE_START_OFFSET]) ==
+				start_address) &&
+			(pfr_measurement_cache_get32(&entry[PFR_MEASUREMENT_CACHE_END_OFFSET]) ==
+				end_address))
+			return i;
+	}
+
+	return -1;
+}
+
+/**
+ * Check if a region was verified with the expected digest and nothing could have written to it
+ * since.
+ *
+ * @param cache The cache to check.
+ * @param start_address First byte of the region.
+ * @param end_address End of the region.
+ * @param digest The digest the region must have.
+ * @param digest_length Length of the digest.
+ *
+ * @return true if hashing the region can be skipped.
+ */
+bool pfr_measurement_cache_is_clean(struct pfr_measurement_cache *cache, uint32_t start_address,
+		uint32_t end_address, const uint8_t *digest, size_t digest_length)
+{
+	const uint8_t *entry;
+	int i;
+
+	if ((cache == NULL) || (digest == NULL) || !pfr_measurement_cache_has_record(cache))
+		return false;
+
+	i = pfr_measurement_cache_find(cache, start_address, end_address);
+	if (i < 0)
+		return false;
+
+	entry = PFR_MEASUREMENT_CACHE_ENTRY(cache, i);
+
+	return (entry[PFR_MEASUREMENT_CACHE_STATE_OFFSET] == PFR_MEASUREMENT_CACHE_CLEAN) &&
+		(entry[PFR_MEASUREMENT_CACHE_DIGEST_LEN_OFFSET] == digest_length) &&
+		(memcmp(&entry[PFR_MEASUREMENT_CACHE_DIGEST_OFFSET], digest, digest_length) == 0);
+}
+
+/**
+ * Record the digest of a region that was just hashed and verified.  The change reaches flash on the
+ * next commit.
+ *
+ * @param cache The cache to update.
+ * @param start_address First byte of the region.
+ * @param end_address End of the region.
+ * @param digest The verified digest of the region.
+ * @param digest_length Length of the digest.
+ *
+ * @return 0 if the region was recorded or an error code.
+ */
+int pfr_measurement_cache_update(struct pfr_measurement_cache *cache, uint32_t start_address,
+		uint32_t end_address, const uint8_t *digest, size_t digest_length)
+{
+	size_t count;
+	uint8_t *entry;
+	int i;
+
+	if ((cache == NULL) || (digest == NULL) || (digest_length == 0) ||
+		(digest_length > PFR_MEASUREMENT_CACHE_MAX_DIGEST) ||
+		!pfr_measurement_cache_has_record(cache))
+		return PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT;
+
+	if (pfr_measurement_cache_is_clean(cache, start_address, end_address, digest, digest_length))
+		return 0;
+
+	i = pfr_measurement_cache_find(cache, start_address, end_address);
+	if (i < 0) {
+		count = pfr_measurement_cache_get_count(cache);
+		if (count >= PFR_MEASUREMENT_CACHE_MAX_REGIONS)
+			return PFR_MEASUREMENT_CACHE_FULL;
+
+		i = count;
+		pfr_measurement_cache_set_count(cache, count + 1);
+	}
+
+	entry = PFR_MEASUREMENT_CACHE_ENTRY(cache, i);
+	memset(entry, 0xff, PFR_MEASUREMENT_CACHE_ENTRY_SIZE);
+	pfr_measurement_cache_put32(&entry[PFR_MEASUREMENT_CACHE_START_OFFSET], start_address);
+	pfr_measurement_cache_put32(&entry[PFR_MEASUREMENT_CACHE_END_OFFSET], end_address);
+	entry[PFR_MEASUREMENT_CACHE_DIGEST_LEN_OFFSET] = digest_length;
+	entry[PFR_MEASUREMENT_CACHE_STATE_OFFSET] = PFR_MEASUREMENT_CACHE_CLEAN;
+	memcpy(&entry[PFR_MEASUREMENT_CACHE_DIGEST_OFFSET], digest, digest_length);
+	cache->stored = false;
+
+	return 0;
+}
+
+/**
+ * Write new measurements to flash.  The sector is erased and the header is programmed last, so the
+ * record only becomes valid once everything else is on flash.
+ *
+ * @param cache The cache to commit.
+ *
+ * @return 0 if the flash holds the measurements or an error code.
+ */
+int pfr_measurement_cache_commit(struct pfr_measurement_cache *cache)
+{
+	uint32_t entries;
+	int status;
+
+	if (cache == NULL)
+		return PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT;
+
+	if (!cache->loaded || cache->stored)
+		return 0;
+
+	status = cache->flash->sector_erase(cache->flash, cache->base_addr);
+	if (status != 0)
+		return status;
+
+	if (pfr_measurement_cache_has_record(cache)) {
+		pfr_measurement_cache_put32(&cache->data[PFR_MEASUREMENT_CACHE_CHECK_OFFSET],
+			pfr_measurement_cache_checksum(cache, pfr_measurement_cache_get_count(cache)));
+
+		entries = pfr_measurement_cache_get_count(cache) * PFR_MEASUREMENT_CACHE_ENTRY_SIZE;
+		if (entries != 0) {
+			status = pfr_measurement_cache_program(cache, PFR_MEASUREMENT_CACHE_HEADER_SIZE,
+				PFR_MEASUREMENT_CACHE_ENTRY(cache, 0), entries);
+			if (status != 0)
+				return status;
+		}
+
+		status = pfr_measurement_cache_program(cache, PFR_MEASUREMENT_CACHE_COUNT_OFFSET,
+			&cache->data[PFR_MEASUREMENT_CACHE_COUNT_OFFSET],
+			PFR_MEASUREMENT_CACHE_HEADER_SIZE - PFR_MEASUREMENT_CACHE_COUNT_OFFSET);
+		if (status != 0)
+			return status;
+
+		status = pfr_measurement_cache_program(cache, PFR_MEASUREMENT_CACHE_MAGIC_OFFSET,
+			&cache->data[PFR_MEASUREMENT_CACHE_MAGIC_OFFSET], 4);
+		if (status != 0)
+			return status;
+	}
+
+	cache->stored = true;
+
+	return 0;
+}
+
+/**
+ * Mark every region that overlaps an address range as dirty, so it is hashed on the next
+ * verification.  The change is programmed to flash immediately.
+ *
+ * @param cache The cache to update.
+ * @param start_address First byte that may have changed.
+ * @param end_address End of the range that may have changed.
+ *
+ * @return 0 if the regions were marked or an error code.
+ */
+int pfr_measurement_cache_mark_dirty(struct pfr_measurement_cache *cache, uint32_t start_address,
+		uint32_t end_address)
+{
+	uint8_t state = PFR_MEASUREMENT_CACHE_DIRTY;
+	uint8_t *entry;
+	size_t count;
+	size_t i;
+	int status;
+
+	if (cache == NULL)
+		return PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT;
+
+	status = pfr_measurement_cache_load(cache);
+	if (status != 0)
+		return status;
+
+	if (!pfr_measurement_cache_has_record(cache))
+		return 0;
+
+	count = pfr_measurement_cache_get_count(cache);
+	for (i = 0; i < count; i++) {
+		entry = PFR_MEASUREMENT_CACHE_ENTRY(cache, i);
+		if ((entry[PFR_MEASUREMENT_CACHE_STATE_OFFSET] != PFR_MEASUREMENT_CACHE_CLEAN) ||
+			(pfr_measurement_cache_get32(&entry[PFR_MEASUREMENT_CACHE_START_OFFSET]) >=
+				end_address) ||
+			(pfr_measurement_cache_get32(&entry[PFR_MEASUREMENT_CACHE_END_OFFSET]) <=
+				start_address))
+			continue;
+
+		entry[PFR_MEASUREMENT_CACHE_STATE_OFFSET] = PFR_MEASUREMENT_CACHE_DIRTY;
+
+		// Entries that are not committed yet may still be clean in the old record on flash
+		status = pfr_measurement_cache_program(cache,
+			(entry - cache->data) + PFR_MEASUREMENT_CACHE_STATE_OFFSET, &state, sizeof(state));
+		if (status != 0) {
+			pfr_measurement_cache_clear(cache);
+			return status;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Apply an entry from the SPI monitor log.
+ *
+ * The monitor only logs requests it blocked, which never reach the flash, and writes to regions
+ * the PFM allows are not logged at all.  Such regions must never be skipped.  A blocked write is
+ * still taken as a sign that someone tried to modify a region, so the region is hashed again.  A
+ * blocked command, like an erase or status register write, drops all measurements.
+ *
+ * @param cache The cache to update.
+ * @param entry The log entry.
+ *
+ * @return 0 if the entry was applied or an error code.
+ */
+int pfr_measurement_cache_log_event(struct pfr_measurement_cache *cache, uint32_t entry)
+{
+	uint32_t address = PFR_MEASUREMENT_CACHE_LOG_ADDRESS(entry);
+	uint32_t end = address + PFR_MEASUREMENT_CACHE_LOG_GRANULE;
+
+	if (cache == NULL)
+		return PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT;
+
+	switch (PFR_MEASUREMENT_CACHE_LOG_TYPE(entry)) {
+	case PFR_MEASUREMENT_CACHE_LOG_BLOCKED_READ:
+		return 0;
+
+	case PFR_MEASUREMENT_CACHE_LOG_BLOCKED_WRITE:
+		// The last 16kB of a 4GB address space ends past the 32-bit range
+		if (end < address)
+			end = UINT32_MAX;
+
+		return pfr_measurement_cache_mark_dirty(cache, address, end);
+
+	default:
+		return pfr_measurement_cache_clear(cache);
+	}
+}
+
+/**
+ * Apply the reset policy before the first verification after a reset.  Measurements are dropped
+ * unless the reset type is trusted to keep them.
+ *
+ * @param cache The cache to update.
+ * @param reset The type of reset that was seen.
+ * @param policy The reset types that may reuse measurements.
+ *
+ * @return 0 if the policy was applied or an error code.
+ */
+int pfr_measurement_cache_reset(struct pfr_measurement_cache *cache, uint32_t reset,
+		uint32_t policy)
+{
+	if (cache == NULL)
+		return PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT;
+
+	if (reset & policy)
+		return 0;
+
+	return pfr_measurement_cache_clear(cache);
+}
+
+/**
+ * Drop all measurements, in RAM and on flash.  This is needed whenever the RoT itself writes to the
+ * image, like during recovery or update, or a region fails verification.
+ *
+ * @param cache The cache to clear.
+ *
+ * @return 0 if the measurements were dropped or an error code.
+ */
+int pfr_measurement_cache_clear(struct pfr_measurement_cache *cache)
+{
+	if (cache == NULL)
+		return PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT;
+
+	memset(cache->data, 0xff, sizeof(cache->data));
+	cache->loaded = true;
+	cache->stored = true;
+
+	if (pfr_measurement_cache_drop(cache) == 0)
+		return 0;
+
+	return cache->flash->sector_erase(cache->flash, cache->base_addr);
+}
+
+/**
+ * Get the number of regions with measurements.
+ *
+ * @param cache The cache to query.
+ *
+ * @return The number of regions.
+ */
+size_t pfr_measurement_cache_count(struct pfr_measurement_cache *cache)
+{
+	if ((cache == NULL) || !pfr_measurement_cache_has_record(cache))
+		return 0;
+
+	return pfr_measurement_cache_get_count(cache);
+}
@@ -0,0 +1,81 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_MEASUREMENT_CACHE_H
+#define PFR_MEASUREMENT_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "flash/flash.h"
+
+/* The measurements of one image occupy a single 4kB erase sector. */
+#define PFR_MEASUREMENT_CACHE_SIZE			(4 * 1024)
+#define PFR_MEASUREMENT_CACHE_MAX_REGIONS	64
+#define PFR_MEASUREMENT_CACHE_MAX_DIGEST	48
+#define PFR_MEASUREMENT_CACHE_MAX_KEY		48
+
+/* SPI monitor log entries: the type is in bits 19:18 and addresses are in 16kB units. */
+#define PFR_MEASUREMENT_CACHE_LOG_TYPE(entry)		(((entry) >> 18) & 0x3)
+#define PFR_MEASUREMENT_CACHE_LOG_ADDRESS(entry)	(((entry) & 0x3FFFF) << 14)
+#define PFR_MEASUREMENT_CACHE_LOG_GRANULE			0x4000
+#define PFR_MEASUREMENT_CACHE_LOG_BLOCKED_CMD		0x0
+#define PFR_MEASUREMENT_CACHE_LOG_BLOCKED_WRITE		0x1
+#define PFR_MEASUREMENT_CACHE_LOG_BLOCKED_READ		0x2
+
+/* Reset types, also combined into the policy of resets that may reuse measurements. */
+#define PFR_MEASUREMENT_CACHE_HOST_RESET	(1U << 0)	// Host reset, the SPI filter stayed armed
+#define PFR_MEASUREMENT_CACHE_ROT_RESET		(1U << 1)	// RoT restart, the filter was not armed throughout
+
+/* Status codes returned in addition to the flash errors. */
+#define PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT	-1	// Null cache or buffer, or a length too long
+#define PFR_MEASUREMENT_CACHE_FULL				-2	// No room for another region
+#define PFR_MEASUREMENT_CACHE_WRITE_FAILED		-3	// Flash did not take all of the data
+
+/**
+ * Digests of the protected SPI regions of one image that were verified against the active PFM,
+ * kept in a dedicated flash sector so they survive warm resets.
+ *
+ * A region is only skipped during T-1 verification while its entry is clean.  Entries are marked
+ * dirty from the SPI monitor log and the whole record is dropped on resets the policy does not
+ * trust, so any path that could have modified a region forces it to be hashed again.
+ *
+ * The RAM copy is the sector image.  Marking entries dirty or dropping the record only clears bits
+ * on flash, so it takes effect immediately without an erase.  New measurements are written by
+ * erasing the sector and programming the record header last, so a commit interrupted by power
+ * loss leaves no valid record behind.
+ */
+struct pfr_measurement_cache {
+	struct flash *flash;				/**< Flash that holds the measurement sector. */
+	uint32_t base_addr;					/**< Start of the sector on the flash. */
+	bool loaded;						/**< The RAM copy holds the sector contents. */
+	bool stored;						/**< The record on flash matches the RAM copy. */
+	uint8_t data[PFR_MEASUREMENT_CACHE_SIZE];	/**< RAM copy of the sector. */
+};
+
+int pfr_measurement_cache_init(struct pfr_measurement_cache *cache, struct flash *flash,
+		uint32_t base_addr);
+
+int pfr_measurement_cache_select(struct pfr_measurement_cache *cache, const uint8_t *key,
+		size_t key_length);
+bool pfr_measurement_cache_is_clean(struct pfr_measurement_cache *cache, uint32_t start_address,
+		uint32_t end_address, const uint8_t *digest, size_t digest_length);
+int pfr_measurement_cache_update(struct pfr_measurement_cache *cache, uint32_t start_address,
+		uint32_t end_address, const uint8_t *digest, size_t digest_length);
+int pfr_measurement_cache_commit(struct pfr_measurement_cache *cache);
+
+int pfr_measurement_cache_mark_dirty(struct pfr_measurement_cache *cache, uint32_t start_address,
+		uint32_t end_address);
+int pfr_measurement_cache_log_event(struct pfr_measurement_cache *cache, uint32_t entry);
+int pfr_measurement_cache_reset(struct pfr_measurement_cache *cache, uint32_t reset,
+		uint32_t policy);
+int pfr_measurement_cache_clear(struct pfr_measurement_cache *cache);
+
+size_t pfr_measurement_cache_count(struct pfr_measurement_cache *cache);
+
+#endif /*PFR_MEASUREMENT_CACHE_H*/
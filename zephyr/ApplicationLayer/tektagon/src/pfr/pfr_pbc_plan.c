@@ -0,0 +1,172 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include "pfr_pbc_plan.h"
+
+#define PFR_PBC_PAGE_MASK(page)			(0x80 >> ((page) & 7))
+
+static bool pfr_pbc_page_set(const uint8_t *bitmap, uint32_t page)
+{
+	return (bitmap[page / 8] & PFR_PBC_PAGE_MASK(page)) != 0;
+}
+
+/**
+ * Find the next run of set pages in a PBC bitmap.  Whole bytes are skipped or consumed at once,
+ * so sparse and dense maps are scanned quickly.
+ *
+ * @param bitmap The bitmap to scan.
+ * @param pages The number of pages covered by the bitmap.
+ * @param page The page to start scanning from.  This is updated to the page after the run.
+ * @param run Output for the run.
+ *
+ * @return true if a run was found or false if there are no more set pages.
+ */
+bool pfr_pbc_next_run(const uint8_t *bitmap, uint32_t pages, uint32_t *page,
+		struct pfr_pbc_run *run)
+{
+	uint32_t pos;
+	uint32_t start;
+
+	if ((bitmap == NULL) || (page == NULL) || (run == NULL))
+		return false;
+
+	pos = *page;
+	while (pos < pages) {
+		if (((pos & 7) == 0) && (bitmap[pos / 8] == 0x00))
+			pos += 8;
+		else if (!pfr_pbc_page_set(bitmap, pos))
+			pos++;
+		else
+			break;
+	}
+
+	if (pos >= pages) {
+		*page = pages;
+		return false;
+	}
+
+	start = pos;
+	while (pos < pages) {
+		if (((pos & 7) == 0) && ((pages - pos) >= 8) && (bitmap[pos / 8] == 0xff))
+			pos += 8;
+		else if (pfr_pbc_page_set(bitmap, pos))
+			pos++;
+		else
+			break;
+	}
+
+	run->first_page = start;
+	run->page_count = pos - start;
+	*page = pos;
+
+	return true;
+}
+
+/**
+ * Get the largest supported erase that starts at an address and stays within a region.
+ */
+static uint32_t pfr_pbc_erase_length(uint32_t address, uint32_t end, uint32_t erase_sizes)
+{
+	static const struct {
+		uint32_t flag;
+		uint32_t length;
+	} sizes[] = {
+		{PFR_PBC_ERASE_64K, 0x10000},
+		{PFR_PBC_ERASE_32K, 0x8000},
+	};
+	size_t i;
+
+	for (i = 0; i < (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		if ((erase_sizes & sizes[i].flag) && ((address & (sizes[i].length - 1)) == 0) &&
+			((end - address) >= sizes[i].length)) {
+			return sizes[i].length;
+		}
+	}
+
+	return PFR_PBC_PAGE_SIZE;
+}
+
+/**
+ * Erase every page set in a PBC erase bitmap.  Consecutive pages are merged so aligned 32kB and
+ * 64kB blocks that are completely covered are erased with a single command.
+ *
+ * @param bitmap The erase bitmap.
+ * @param pages The number of pages covered by the bitmap.
+ * @param erase_sizes The PFR_PBC_ERASE_* sizes the flash supports.  4kB erase is required.
+ * @param erase The handler that erases the flash.
+ * @param context Context passed to the handler.
+ *
+ * @return 0 if all pages were erased or an error code.
+ */
+int pfr_pbc_plan_erase(const uint8_t *bitmap, uint32_t pages, uint32_t erase_sizes,
+		pfr_pbc_erase_fn erase, void *context)
+{
+	struct pfr_pbc_run run;
+	uint32_t page = 0;
+	uint32_t address;
+	uint32_t end;
+	uint32_t length;
+	int status;
+
+	if ((bitmap == NULL) || (erase == NULL) || !(erase_sizes & PFR_PBC_ERASE_4K))
+		return PFR_PBC_PLAN_INVALID_ARGUMENT;
+
+	while (pfr_pbc_next_run(bitmap, pages, &page, &run)) {
+		address = run.first_page * PFR_PBC_PAGE_SIZE;
+		end = address + (run.page_count * PFR_PBC_PAGE_SIZE);
+
+		while (address < end) {
+			length = pfr_pbc_erase_length(address, end, erase_sizes);
+
+			status = erase(context, address, length);
+			if (status != 0)
+				return status;
+
+			address += length;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Copy every page set in a PBC compression bitmap from the capsule payload.  The payload holds
+ * the set pages back to back, so each run of set pages is copied with one call.
+ *
+ * @param bitmap The compression bitmap.
+ * @param pages The number of pages covered by the bitmap.
+ * @param copy The handler that copies the data.
+ * @param context Context passed to the handler.
+ *
+ * @return 0 if all pages were copied or an error code.
+ */
+int pfr_pbc_plan_copy(const uint8_t *bitmap, uint32_t pages, pfr_pbc_copy_fn copy,
+		void *context)
+{
+	struct pfr_pbc_run run;
+	uint32_t payload_offset = 0;
+	uint32_t page = 0;
+	uint32_t length;
+	int status;
+
+	if ((bitmap == NULL) || (copy == NULL))
+		return PFR_PBC_PLAN_INVALID_ARGUMENT;
+
+	while (pfr_pbc_next_run(bitmap, pages, &page, &run)) {
+		length = run.page_count * PFR_PBC_PAGE_SIZE;
+
+		status = copy(context, payload_offset, run.first_page * PFR_PBC_PAGE_SIZE, length);
+		if (status != 0)
+			return status;
+
+		payload_offset += length;
+	}
+
+	return 0;
+}
@@ -0,0 +1,67 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_PBC_PLAN_H
+#define PFR_PBC_PLAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Each PBC bitmap bit covers one 4kB page, most significant bit first. */
+#define PFR_PBC_PAGE_SIZE				0x1000
+#define PFR_PBC_BITMAP_SIZE(pages)		(((pages) + 7) / 8)
+
+/* Erase sizes a flash device can be asked to use. */
+#define PFR_PBC_ERASE_4K				(1U << 0)
+#define PFR_PBC_ERASE_32K				(1U << 1)
+#define PFR_PBC_ERASE_64K				(1U << 2)
+
+/* Status codes returned in addition to the callback errors. */
+#define PFR_PBC_PLAN_INVALID_ARGUMENT	-1	// Null bitmap or callback, or no 4kB erase
+
+/**
+ * A run of consecutive pages that are set in a PBC bitmap.
+ */
+struct pfr_pbc_run {
+	uint32_t first_page;				/**< First page in the run. */
+	uint32_t page_count;				/**< Number of pages in the run. */
+};
+
+/**
+ * Erase part of the destination flash.
+ *
+ * @param context The caller context.
+ * @param address The start of the region.  It is aligned to the length.
+ * @param length The erase size, 4kB, 32kB or 64kB.
+ *
+ * @return 0 if the region was erased or an error code.
+ */
+typedef int (*pfr_pbc_erase_fn)(void *context, uint32_t address, uint32_t length);
+
+/**
+ * Copy pages from the capsule payload to the destination flash.
+ *
+ * @param context The caller context.
+ * @param payload_offset The offset of the data in the compressed payload.
+ * @param address The destination address.
+ * @param length The number of bytes to copy, a multiple of the page size.
+ *
+ * @return 0 if the data was copied or an error code.
+ */
+typedef int (*pfr_pbc_copy_fn)(void *context, uint32_t payload_offset, uint32_t address,
+		uint32_t length);
+
+bool pfr_pbc_next_run(const uint8_t *bitmap, uint32_t pages, uint32_t *page,
+		struct pfr_pbc_run *run);
+
+int pfr_pbc_plan_erase(const uint8_t *bitmap, uint32_t pages, uint32_t erase_sizes,
+		pfr_pbc_erase_fn erase, void *context);
+int pfr_pbc_plan_copy(const uint8_t *bitmap, uint32_t pages, pfr_pbc_copy_fn copy,
+		void *context);
+
+#endif /*PFR_PBC_PLAN_H*/
@@ -0,0 +1,92 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <string.h>
+#include "pfr_pbc_tag.h"
+
+#define PFR_PBC_TAG_LENGTH				4
+
+/**
+ * Find the PBC tag in a window that has been read from flash.
+ *
+ * @return Offset of the first match in the window or -1 if there is none.
+ */
+static int32_t pfr_pbc_tag_search(const uint8_t *window, uint32_t length, const uint8_t *tag)
+{
+	const uint8_t *pos = window;
+	const uint8_t *last = window + length - PFR_PBC_TAG_LENGTH;
+
+	while (pos <= last) {
+		pos = memchr(pos, tag[0], (last - pos) + 1);
+		if (pos == NULL)
+			return -1;
+
+		if (memcmp(pos, tag, PFR_PBC_TAG_LENGTH) == 0)
+			return pos - window;
+
+		pos++;
+	}
+
+	return -1;
+}
+
+/**
+ * Search flash for the first address that holds a 32-bit tag, stored little endian.  The area is
+ * read in windows that overlap by three bytes, so a tag that crosses a window boundary is still
+ * found and the result matches a search that reads four bytes at every address.
+ *
+ * @param start First address to check.
+ * @param end End of the search area.  The tag must end at or before this address.
+ * @param tag The tag to find.
+ * @param read The handler that reads flash.
+ * @param context Context passed to the handler.
+ * @param window Buffer for the flash data.
+ * @param window_size Size of the buffer.  It must be larger than the tag.
+ * @param address Output for the address of the tag.
+ *
+ * @return 0 if the tag was found or an error code.
+ */
+int pfr_pbc_tag_find(uint32_t start, uint32_t end, uint32_t tag, pfr_pbc_tag_read_fn read,
+		void *context, uint8_t *window, uint32_t window_size, uint32_t *address)
+{
+	uint8_t tag_bytes[PFR_PBC_TAG_LENGTH];
+	uint32_t length;
+	int32_t match;
+	int status;
+
+	if ((read == NULL) || (window == NULL) || (address == NULL) ||
+		(window_size <= PFR_PBC_TAG_LENGTH))
+		return PFR_PBC_TAG_INVALID_ARGUMENT;
+
+	tag_bytes[0] = tag & 0xff;
+	tag_bytes[1] = (tag >> 8) & 0xff;
+	tag_bytes[2] = (tag >> 16) & 0xff;
+	tag_bytes[3] = tag >> 24;
+
+	while ((start < end) && ((end - start) >= PFR_PBC_TAG_LENGTH)) {
+		length = end - start;
+		if (length > window_size)
+			length = window_size;
+
+		status = read(context, start, window, length);
+		if (status != 0)
+			return status;
+
+		match = pfr_pbc_tag_search(window, length, tag_bytes);
+		if (match >= 0) {
+			*address = start + match;
+			return 0;
+		}
+
+		// Keep the last three bytes so a tag split across windows is not missed
+		start += length - (PFR_PBC_TAG_LENGTH - 1);
+	}
+
+	return PFR_PBC_TAG_NOT_FOUND;
+}
@@ -0,0 +1,37 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_PBC_TAG_H
+#define PFR_PBC_TAG_H
+
+#include <stdint.h>
+
+/* Bytes read from flash at a time while searching for the PBC header. */
+#define PFR_PBC_TAG_WINDOW_SIZE			0x1000
+
+/* Status codes returned in addition to the read errors. */
+#define PFR_PBC_TAG_INVALID_ARGUMENT	-1	// Null handler or output, or window too small
+#define PFR_PBC_TAG_NOT_FOUND			-2	// The tag is not in the search area
+
+/**
+ * Read capsule data from flash.
+ *
+ * @param context The caller context.
+ * @param address The flash address to read.
+ * @param data Output for the data.
+ * @param length The number of bytes to read.
+ *
+ * @return 0 if the data was read or an error code.
+ */
+typedef int (*pfr_pbc_tag_read_fn)(void *context, uint32_t address, uint8_t *data,
+		uint32_t length);
+
+int pfr_pbc_tag_find(uint32_t start, uint32_t end, uint32_t tag, pfr_pbc_tag_read_fn read,
+		void *context, uint8_t *window, uint32_t window_size, uint32_t *address);
+
+#endif /*PFR_PBC_TAG_H*/
@@ -0,0 +1,327 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <string.h>
+#include "pfr_pfm_index.h"
+
+#define PFR_PFM_INDEX_SHA256_SIZE		32
+#define PFR_PFM_INDEX_SHA384_SIZE		48
+
+/**
+ * Buffered reader that walks the PFM in large reads instead of one read per field.
+ */
+struct pfr_pfm_index_reader {
+	pfr_pfm_index_read_fn read;
+	void *context;
+	uint32_t end;
+	uint32_t window_start;
+	uint32_t window_length;
+	uint8_t window[PFR_PFM_INDEX_READ_CHUNK];
+};
+
+static uint16_t pfr_pfm_index_get16(const uint8_t *data)
+{
+	return data[0] | (data[1] << 8);
+}
+
+static uint32_t pfr_pfm_index_get32(const uint8_t *data)
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/**
+ * Get a pointer to PFM data, reading the next chunk of the PFM if it is not already buffered.
+ */
+static int pfr_pfm_index_fetch(struct pfr_pfm_index_reader *reader, uint32_t address,
+		uint32_t length, const uint8_t **data)
+{
+	uint32_t chunk;
+	int status;
+
+	if ((address > reader->end) || (length > (reader->end - address)))
+		return PFR_PFM_INDEX_BAD_DEFINITION;
+
+	if ((reader->window_length == 0) || (address < reader->window_start) ||
+		((address + length) > (reader->window_start + reader->window_length))) {
+		chunk = reader->end - address;
+		if (chunk > sizeof(reader->window))
+			chunk = sizeof(reader->window);
+
+		status = reader->read(reader->context, address, reader->window, chunk);
+		if (status != 0)
+			return status;
+
+		reader->window_start = address;
+		reader->window_length = chunk;
+	}
+
+	*data = &reader->window[address - reader->window_start];
+
+	return 0;
+}
+
+static int pfr_pfm_index_add_spi_region(struct pfr_pfm_index *index,
+		struct pfr_pfm_index_reader *reader, uint32_t address, bool prefer_sha384,
+		uint32_t *length)
+{
+	struct pfr_pfm_spi_region *region;
+	const uint8_t *data;
+	uint32_t hash_offset = 0;
+	uint32_t hash_size = 0;
+	bool sha256;
+	bool sha384;
+	int status;
+
+	status = pfr_pfm_index_fetch(reader, address, PFR_PFM_INDEX_SPI_REGION_SIZE, &data);
+	if (status != 0)
+		return status;
+
+	if (index->spi_region_count >= PFR_PFM_INDEX_MAX_SPI_REGIONS)
+		return PFR_PFM_INDEX_TABLE_FULL;
+
+	region = &index->spi_region[index->spi_region_count];
+	region->protect_level_mask = data[1];
+	region->start_address = pfr_pfm_index_get32(&data[8]);
+	region->end_address = pfr_pfm_index_get32(&data[12]);
+	sha256 = (data[2] & 0x01) != 0;
+	sha384 = (data[2] & 0x02) != 0;
+
+	// The SHA-256 digest is stored ahead of the SHA-384 digest when both are present
+	if (sha384 && (!sha256 || prefer_sha384)) {
+		region->hash_type = PFR_PFM_INDEX_HASH_SHA384;
+		hash_offset = sha256 ? PFR_PFM_INDEX_SHA256_SIZE : 0;
+		hash_size = PFR_PFM_INDEX_SHA384_SIZE;
+	}
+	else if (sha256) {
+		region->hash_type = PFR_PFM_INDEX_HASH_SHA256;
+		hash_size = PFR_PFM_INDEX_SHA256_SIZE;
+	}
+	else {
+		region->hash_type = PFR_PFM_INDEX_HASH_NONE;
+	}
+
+	*length = PFR_PFM_INDEX_SPI_REGION_SIZE;
+	*length += sha256 ? PFR_PFM_INDEX_SHA256_SIZE : 0;
+	*length += sha384 ? PFR_PFM_INDEX_SHA384_SIZE : 0;
+
+	memset(region->hash, 0, sizeof(region->hash));
+	if (hash_size) {
+		status = pfr_pfm_index_fetch(reader,
+			address + PFR_PFM_INDEX_SPI_REGION_SIZE + hash_offset, hash_size, &data);
+		if (status != 0)
+			return status;
+
+		memcpy(region->hash, data, hash_size);
+	}
+
+	index->spi_region_count++;
+
+	return 0;
+}
+
+static int pfr_pfm_index_add_smbus_rule(struct pfr_pfm_index *index,
+		struct pfr_pfm_index_reader *reader, uint32_t address)
+{
+	struct pfr_pfm_smbus_rule *rule;
+	const uint8_t *data;
+	int status;
+
+	status = pfr_pfm_index_fetch(reader, address, PFR_PFM_INDEX_SMBUS_RULE_SIZE, &data);
+	if (status != 0)
+		return status;
+
+	if (index->smbus_rule_count >= PFR_PFM_INDEX_MAX_SMBUS_RULES)
+		return PFR_PFM_INDEX_TABLE_FULL;
+
+	rule = &index->smbus_rule[index->smbus_rule_count++];
+	rule->bus_id = data[5];
+	rule->rule_id = data[6];
+	rule->device_address = data[7];
+	memcpy(rule->cmd_passlist, &data[8], sizeof(rule->cmd_passlist));
+
+	return 0;
+}
+
+static int pfr_pfm_index_add_fvm(struct pfr_pfm_index *index,
+		struct pfr_pfm_index_reader *reader, uint32_t address)
+{
+	struct pfr_pfm_fvm *fvm;
+	const uint8_t *data;
+	int status;
+
+	status = pfr_pfm_index_fetch(reader, address, PFR_PFM_INDEX_FVM_ADDRESS_SIZE, &data);
+	if (status != 0)
+		return status;
+
+	if (index->fvm_count >= PFR_PFM_INDEX_MAX_FVMS)
+		return PFR_PFM_INDEX_TABLE_FULL;
+
+	fvm = &index->fvm[index->fvm_count++];
+	fvm->fv_type = pfr_pfm_index_get16(&data[1]);
+	fvm->address = pfr_pfm_index_get32(&data[8]);
+
+	return 0;
+}
+
+/**
+ * Build the index of a PFM.  The PFM is read once, front to back, in chunks of
+ * PFR_PFM_INDEX_READ_CHUNK bytes.  The walk stops at the end of the PFM or at the first byte that
+ * is not a known definition type, such as padding.
+ *
+ * The PFM must already have been verified.  Its hash is stored as the key for the index.
+ *
+ * @param index The index to build.  It is left invalid if the PFM cannot be indexed.
+ * @param pfm_address Address of the PFM header, after the signature block.
+ * @param prefer_sha384 Keep the SHA-384 digest of regions that carry both digests.
+ * @param key Hash of the PFM.
+ * @param key_length Length of the PFM hash.
+ * @param read The handler that reads flash.
+ * @param context Context passed to the handler.
+ *
+ * @return 0 if the index was built or an error code.
+ */
+int pfr_pfm_index_build(struct pfr_pfm_index *index, uint32_t pfm_address, bool prefer_sha384,
+		const uint8_t *key, size_t key_length, pfr_pfm_index_read_fn read, void *context)
+{
+	struct pfr_pfm_index_reader reader;
+	uint8_t header[PFR_PFM_INDEX_HEADER_SIZE];
+	const uint8_t *type;
+	uint32_t address;
+	uint32_t length;
+	int status;
+
+	if ((index == NULL) || (read == NULL) || ((key == NULL) && (key_length != 0)) ||
+		(key_length > sizeof(index->key)))
+		return PFR_PFM_INDEX_INVALID_ARGUMENT;
+
+	pfr_pfm_index_invalidate(index);
+
+	status = read(context, pfm_address, header, sizeof(header));
+	if (status != 0)
+		return status;
+
+	if (pfr_pfm_index_get32(header) != PFR_PFM_INDEX_TAG)
+		return PFR_PFM_INDEX_BAD_TAG;
+
+	index->pfm_address = pfm_address;
+	index->svn = header[4];
+	index->revision = pfr_pfm_index_get16(&header[6]);
+	index->length = pfr_pfm_index_get32(&header[0x1c]);
+
+	reader.read = read;
+	reader.context = context;
+	reader.window_start = 0;
+	reader.window_length = 0;
+	reader.end = pfm_address;
+	if (index->length > PFR_PFM_INDEX_HEADER_SIZE)
+		reader.end += index->length;
+
+	address = pfm_address + PFR_PFM_INDEX_HEADER_SIZE;
+	while (address < reader.end) {
+		status = pfr_pfm_index_fetch(&reader, address, 1, &type);
+		if (status != 0)
+			return status;
+
+		switch (*type) {
+		case PFR_PFM_INDEX_SPI_REGION:
+			status = pfr_pfm_index_add_spi_region(index, &reader, address, prefer_sha384,
+				&length);
+			break;
+
+		case PFR_PFM_INDEX_SMBUS_RULE:
+			status = pfr_pfm_index_add_smbus_rule(index, &reader, address);
+			length = PFR_PFM_INDEX_SMBUS_RULE_SIZE;
+			break;
+
+		case PFR_PFM_INDEX_FVM_ADDRESS:
+			status = pfr_pfm_index_add_fvm(index, &reader, address);
+			length = PFR_PFM_INDEX_FVM_ADDRESS_SIZE;
+			break;
+
+		default:
+			length = reader.end - address;
+			break;
+		}
+
+		if (status != 0) {
+			pfr_pfm_index_invalidate(index);
+			return status;
+		}
+
+		address += length;
+	}
+
+	if (key_length != 0)
+		memcpy(index->key, key, key_length);
+	index->key_length = key_length;
+	index->valid = true;
+
+	return 0;
+}
+
+/**
+ * Discard the contents of a PFM index.
+ *
+ * @param index The index to clear.
+ */
+void pfr_pfm_index_invalidate(struct pfr_pfm_index *index)
+{
+	if (index) {
+		index->valid = false;
+		index->key_length = 0;
+		index->spi_region_count = 0;
+		index->smbus_rule_count = 0;
+		index->fvm_count = 0;
+	}
+}
+
+/**
+ * Check if an index was built from a specific PFM.
+ *
+ * @param index The index to check.
+ * @param pfm_address Address of the PFM header.
+ * @param key Hash of the PFM, or null to only check the address.
+ * @param key_length Length of the PFM hash.
+ *
+ * @return true if the index is valid for the PFM.
+ */
+bool pfr_pfm_index_matches(const struct pfr_pfm_index *index, uint32_t pfm_address,
+		const uint8_t *key, size_t key_length)
+{
+	if ((index == NULL) || !index->valid || (index->pfm_address != pfm_address))
+		return false;
+
+	if (key == NULL)
+		return true;
+
+	return (key_length == index->key_length) && (memcmp(key, index->key, key_length) == 0);
+}
+
+/**
+ * Find the FVM for a firmware volume type.
+ *
+ * @param index The index to search.
+ * @param fv_type The firmware volume type.
+ *
+ * @return The FVM address definition or null if there is none.
+ */
+const struct pfr_pfm_fvm *pfr_pfm_index_find_fvm(const struct pfr_pfm_index *index,
+		uint16_t fv_type)
+{
+	size_t i;
+
+	if ((index == NULL) || !index->valid)
+		return NULL;
+
+	for (i = 0; i < index->fvm_count; i++) {
+		if (index->fvm[i].fv_type == fv_type)
+			return &index->fvm[i];
+	}
+
+	return NULL;
+}
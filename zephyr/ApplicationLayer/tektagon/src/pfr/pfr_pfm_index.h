@@ -0,0 +1,125 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_PFM_INDEX_H
+#define PFR_PFM_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* PFM layout, following the 1kB signature block. */
+#define PFR_PFM_INDEX_TAG				0x02B3CE1D
+#define PFR_PFM_INDEX_HEADER_SIZE		0x20
+#define PFR_PFM_INDEX_SPI_REGION		0x01
+#define PFR_PFM_INDEX_SMBUS_RULE		0x02
+#define PFR_PFM_INDEX_FVM_ADDRESS		0x03
+#define PFR_PFM_INDEX_SPI_REGION_SIZE	16
+#define PFR_PFM_INDEX_SMBUS_RULE_SIZE	40
+#define PFR_PFM_INDEX_FVM_ADDRESS_SIZE	12
+
+/* Protect level mask bits of an SPI region definition. */
+#define PFR_PFM_INDEX_READ_ALLOWED		(1U << 0)
+#define PFR_PFM_INDEX_WRITE_ALLOWED		(1U << 1)
+
+/* Table sizes, enough for hundreds of definitions. */
+#define PFR_PFM_INDEX_MAX_SPI_REGIONS	128
+#define PFR_PFM_INDEX_MAX_SMBUS_RULES	128
+#define PFR_PFM_INDEX_MAX_FVMS			16
+#define PFR_PFM_INDEX_MAX_HASH			48
+#define PFR_PFM_INDEX_MAX_KEY			48
+
+/* Bytes read from flash at a time while walking the PFM. */
+#define PFR_PFM_INDEX_READ_CHUNK		512
+
+/* Status codes returned in addition to the read errors. */
+#define PFR_PFM_INDEX_INVALID_ARGUMENT	-1	// Null index or handler, or key too long
+#define PFR_PFM_INDEX_BAD_TAG			-2	// The PFM header tag does not match
+#define PFR_PFM_INDEX_BAD_DEFINITION	-3	// A definition runs past the end of the PFM
+#define PFR_PFM_INDEX_TABLE_FULL		-4	// The PFM has more definitions than the tables hold
+
+/* Digest stored for an SPI region. */
+enum pfr_pfm_index_hash {
+	PFR_PFM_INDEX_HASH_NONE,			/**< The region is not hashed. */
+	PFR_PFM_INDEX_HASH_SHA256,			/**< SHA-256 digest. */
+	PFR_PFM_INDEX_HASH_SHA384,			/**< SHA-384 digest. */
+};
+
+/**
+ * An SPI region definition.
+ */
+struct pfr_pfm_spi_region {
+	uint32_t start_address;				/**< First byte of the region. */
+	uint32_t end_address;				/**< End of the region. */
+	uint8_t protect_level_mask;			/**< Access and recovery policy for the region. */
+	uint8_t hash_type;					/**< Digest to check, a pfr_pfm_index_hash value. */
+	uint8_t hash[PFR_PFM_INDEX_MAX_HASH];	/**< Expected digest of the region. */
+};
+
+/**
+ * An SMBus rule definition.
+ */
+struct pfr_pfm_smbus_rule {
+	uint8_t bus_id;						/**< Bus the rule applies to. */
+	uint8_t rule_id;					/**< Rule number. */
+	uint8_t device_address;				/**< Device address on the bus. */
+	uint8_t cmd_passlist[32];			/**< Commands allowed for the device. */
+};
+
+/**
+ * An FVM address definition.
+ */
+struct pfr_pfm_fvm {
+	uint16_t fv_type;					/**< Firmware volume type. */
+	uint32_t address;					/**< Address of the FVM. */
+};
+
+/**
+ * RAM index of the definitions in a verified PFM.  It is built in one pass over the PFM and keyed
+ * by the PFM hash, so verification, SPI filter setup and FVM lookup share it without reading the
+ * PFM again.
+ */
+struct pfr_pfm_index {
+	bool valid;							/**< The index holds a parsed PFM. */
+	uint8_t key[PFR_PFM_INDEX_MAX_KEY];	/**< Hash of the PFM the index was built from. */
+	size_t key_length;					/**< Length of the key. */
+	uint32_t pfm_address;				/**< Address of the PFM header. */
+	uint32_t length;					/**< PFM length from the header. */
+	uint8_t svn;						/**< PFM SVN. */
+	uint16_t revision;					/**< PFM revision. */
+	size_t spi_region_count;			/**< Number of SPI region definitions. */
+	size_t smbus_rule_count;			/**< Number of SMBus rule definitions. */
+	size_t fvm_count;					/**< Number of FVM address definitions. */
+	struct pfr_pfm_spi_region spi_region[PFR_PFM_INDEX_MAX_SPI_REGIONS];	/**< SPI regions. */
+	struct pfr_pfm_smbus_rule smbus_rule[PFR_PFM_INDEX_MAX_SMBUS_RULES];	/**< SMBus rules. */
+	struct pfr_pfm_fvm fvm[PFR_PFM_INDEX_MAX_FVMS];	/**< FVM addresses. */
+};
+
+/**
+ * Read PFM data from flash.
+ *
+ * @param context The caller context.
+ * @param address The flash address to read.
+ * @param data Output for the data.
+ * @param length The number of bytes to read.
+ *
+ * @return 0 if the data was read or an error code.
+ */
+typedef int (*pfr_pfm_index_read_fn)(void *context, uint32_t address, uint8_t *data,
+		uint32_t length);
+
+int pfr_pfm_index_build(struct pfr_pfm_index *index, uint32_t pfm_address, bool prefer_sha384,
+		const uint8_t *key, size_t key_length, pfr_pfm_index_read_fn read, void *context);
+void pfr_pfm_index_invalidate(struct pfr_pfm_index *index);
+
+bool pfr_pfm_index_matches(const struct pfr_pfm_index *index, uint32_t pfm_address,
+		const uint8_t *key, size_t key_length);
+const struct pfr_pfm_fvm *pfr_pfm_index_find_fvm(const struct pfr_pfm_index *index,
+		uint16_t fv_type);
+
+#endif /*PFR_PFM_INDEX_H*/
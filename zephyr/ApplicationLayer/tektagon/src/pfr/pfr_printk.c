@@ -0,0 +1,27 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include "pfr_printk.h"
+
+uint32_t pfr_printk_modules = PFR_PRINTK_DEFAULT;
+
+/**
+ * Select the modules that print console messages.
+ *
+ * @param modules PFR_PRINTK_* flags for the modules to enable.
+ *
+ * @return The modules that were enabled before.
+ */
+uint32_t pfr_printk_set_modules(uint32_t modules)
+{
+	uint32_t previous = pfr_printk_modules;
+
+	pfr_printk_modules = modules & PFR_PRINTK_ALL;
+
+	return previous;
+}
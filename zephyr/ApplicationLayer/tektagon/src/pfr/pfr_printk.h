@@ -0,0 +1,41 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_PRINTK_H
+#define PFR_PRINTK_H
+
+#include <stdint.h>
+
+/* Modules whose console messages can be turned on and off at runtime. */
+#define PFR_PRINTK_STATUS			(1U << 0)	// State machine and platform state
+#define PFR_PRINTK_UPDATE			(1U << 1)	// Update, recovery and capsule decompression
+#define PFR_PRINTK_AUTHENTICATION	(1U << 2)	// Signature, key and SVN checks, provisioning
+#define PFR_PRINTK_MAILBOX			(1U << 3)	// SMBus mailbox
+#define PFR_PRINTK_MANIFEST			(1U << 4)	// PFM parsing and SPI region verification
+#define PFR_PRINTK_UTIL				(1U << 5)	// SPI and UFM helpers
+#define PFR_PRINTK_ALL				0x3f
+
+/* Each message goes out over the UART before the caller continues, so the chatty per-region
+ * modules are off unless they are turned on for debugging. */
+#ifndef PFR_PRINTK_DEFAULT
+#define PFR_PRINTK_DEFAULT			(PFR_PRINTK_STATUS | PFR_PRINTK_UPDATE)
+#endif
+
+extern uint32_t pfr_printk_modules;
+
+/* Print a console message if its module is enabled.  The DEBUG tokens in intel_pfr_definitions.h
+ * still remove a module's messages from the build entirely. */
+#define PFR_PRINTK(module, ...) \
+	do { \
+		if (pfr_printk_modules & (module)) \
+			printk(__VA_ARGS__); \
+	} while (0)
+
+uint32_t pfr_printk_set_modules(uint32_t modules);
+
+#endif /*PFR_PRINTK_H*/
@@ -17,9 +17,11 @@
 #ifdef CONFIG_CERBERUS_PFR_SUPPORT
 #include "cerberus/cerberus_pfr_definitions.h"
 #endif
+#include "pfr_printk.h"
+
 #undef DEBUG_PRINTF
 #if PF_UPDATE_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_UPDATE, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -71,7 +73,8 @@ int recover_image(void *AoData, void *EventContext){
                 return Failure;               
         }
 
-        status = pfr_recover_recovery_region(pfr_manifest->image_type, pfr_manifest->address, pfr_manifest->recovery_address);
+        // A repair usually finds most sectors intact, compare before rewriting
+        status = pfr_recover_recovery_region(pfr_manifest->image_type, pfr_manifest->address, pfr_manifest->recovery_address, true);
         if(status != Success)
             return Failure;
         ActiveObjectData->RecoveryImageStatus = Success;
@@ -0,0 +1,135 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include "pfr_sig_block.h"
+
+/**
+ * Read a little endian word from the signature block.  The caller makes sure it is in bounds.
+ */
+static uint32_t pfr_sig_block_word(const struct pfr_sig_block *block, size_t offset)
+{
+	const uint8_t *data = &block->data[offset];
+
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+/**
+ * Parse a public key entry.
+ */
+static int pfr_sig_block_parse_key(const struct pfr_sig_block *block, size_t offset,
+		uint32_t tag, struct pfr_sig_block_key *key)
+{
+	uint32_t magic;
+
+	if (pfr_sig_block_word(block, offset) != tag)
+		return PFR_SIG_BLOCK_BAD_TAG;
+
+	magic = pfr_sig_block_word(block, offset + 4);
+	if (magic == PFR_SIG_BLOCK_PUBLIC_SECP256)
+		key->curve = PFR_SIG_BLOCK_CURVE_SECP256;
+	else if (magic == PFR_SIG_BLOCK_PUBLIC_SECP384)
+		key->curve = PFR_SIG_BLOCK_CURVE_SECP384;
+	else
+		return PFR_SIG_BLOCK_BAD_CURVE;
+
+	key->permissions = pfr_sig_block_word(block, offset + 8);
+	key->key_id = pfr_sig_block_word(block, offset + 12);
+	key->x = &block->data[offset + 16];
+	key->y = &block->data[offset + 16 + PFR_SIG_BLOCK_KEY_SIZE];
+
+	return 0;
+}
+
+/**
+ * Parse a signature, which starts with the magic number of its curve.
+ */
+static int pfr_sig_block_parse_signature(const struct pfr_sig_block *block, size_t offset,
+		struct pfr_sig_block_signature *signature)
+{
+	uint32_t magic;
+
+	magic = pfr_sig_block_word(block, offset);
+	if (magic == PFR_SIG_BLOCK_SIGNATURE_SECP256)
+		signature->curve = PFR_SIG_BLOCK_CURVE_SECP256;
+	else if (magic == PFR_SIG_BLOCK_SIGNATURE_SECP384)
+		signature->curve = PFR_SIG_BLOCK_CURVE_SECP384;
+	else
+		return PFR_SIG_BLOCK_BAD_CURVE;
+
+	signature->r = &block->data[offset + 4];
+	signature->s = &block->data[offset + 4 + PFR_SIG_BLOCK_KEY_SIZE];
+
+	return 0;
+}
+
+/**
+ * Check the structure of a signature block that has been read into RAM and set up the views of
+ * its fields.  Every field is at a fixed offset inside the block, so a malformed block can't
+ * lead to a read outside of it.
+ *
+ * Only the structure is checked.  The signatures, digests and key policy are left to the caller.
+ *
+ * @param block The signature block to parse.  The data must already hold the raw block.
+ *
+ * @return 0 if the block is well formed or an error code.
+ */
+int pfr_sig_block_parse(struct pfr_sig_block *block)
+{
+	size_t entry;
+	bool has_csk = false;
+	int status;
+
+	if (block == NULL)
+		return PFR_SIG_BLOCK_INVALID_ARGUMENT;
+
+	block->has_csk = false;
+
+	if (pfr_sig_block_word(block, 0) != PFR_SIG_BLOCK_BLOCK0_TAG)
+		return PFR_SIG_BLOCK_BAD_TAG;
+
+	block->pc_length = pfr_sig_block_word(block, 4);
+	block->pc_type = pfr_sig_block_word(block, 8);
+	block->sha256_pc = &block->data[16];
+	block->sha384_pc = &block->data[48];
+
+	if (pfr_sig_block_word(block, PFR_SIG_BLOCK_BLOCK1_OFFSET) != PFR_SIG_BLOCK_BLOCK1_TAG)
+		return PFR_SIG_BLOCK_BAD_TAG;
+
+	status = pfr_sig_block_parse_key(block, PFR_SIG_BLOCK_ROOT_OFFSET, PFR_SIG_BLOCK_ROOT_TAG,
+		&block->root);
+	if (status != 0)
+		return status;
+
+	/* Cancellation capsules are signed by the root key, so Block0 entry takes the CSK's place. */
+	entry = PFR_SIG_BLOCK_CSK_OFFSET;
+	if (pfr_sig_block_word(block, entry) == PFR_SIG_BLOCK_CSK_TAG) {
+		status = pfr_sig_block_parse_key(block, entry, PFR_SIG_BLOCK_CSK_TAG, &block->csk);
+		if (status != 0)
+			return status;
+
+		status = pfr_sig_block_parse_signature(block, entry + PFR_SIG_BLOCK_KEY_ENTRY_SIZE,
+			&block->csk_signature);
+		if (status != 0)
+			return status;
+
+		block->csk_signed = &block->data[entry + 4];
+		has_csk = true;
+		entry += PFR_SIG_BLOCK_CSK_SIZE;
+	}
+
+	if (pfr_sig_block_word(block, entry) != PFR_SIG_BLOCK_B0_ENTRY_TAG)
+		return PFR_SIG_BLOCK_BAD_TAG;
+
+	status = pfr_sig_block_parse_signature(block, entry + 4, &block->block0_signature);
+	if (status != 0)
+		return status;
+
+	block->has_csk = has_csk;
+
+	return 0;
+}
@@ -0,0 +1,91 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_SIG_BLOCK_H
+#define PFR_SIG_BLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Layout of the 1kB signature block in front of every PFM and capsule. */
+#define PFR_SIG_BLOCK_SIZE					1024
+#define PFR_SIG_BLOCK_BLOCK0_SIZE			128
+#define PFR_SIG_BLOCK_BLOCK1_OFFSET			PFR_SIG_BLOCK_BLOCK0_SIZE
+#define PFR_SIG_BLOCK_ROOT_OFFSET			(PFR_SIG_BLOCK_BLOCK1_OFFSET + 16)
+#define PFR_SIG_BLOCK_KEY_ENTRY_SIZE		132
+#define PFR_SIG_BLOCK_CSK_OFFSET			(PFR_SIG_BLOCK_ROOT_OFFSET + PFR_SIG_BLOCK_KEY_ENTRY_SIZE)
+#define PFR_SIG_BLOCK_CSK_SIZE				(PFR_SIG_BLOCK_KEY_ENTRY_SIZE + 100)
+#define PFR_SIG_BLOCK_CSK_SIGNED_SIZE		128	// The CSK entry after its tag
+#define PFR_SIG_BLOCK_B0_ENTRY_SIZE			104
+#define PFR_SIG_BLOCK_KEY_SIZE				48	// Room for each public key and signature coordinate
+
+/* Magic numbers of the signature block. */
+#define PFR_SIG_BLOCK_BLOCK0_TAG			0xB6EAFD19
+#define PFR_SIG_BLOCK_BLOCK1_TAG			0xF27F28D7
+#define PFR_SIG_BLOCK_ROOT_TAG				0xA757A046
+#define PFR_SIG_BLOCK_CSK_TAG				0x14711C2F
+#define PFR_SIG_BLOCK_B0_ENTRY_TAG			0x15364367
+#define PFR_SIG_BLOCK_PUBLIC_SECP256		0xC7B88C74
+#define PFR_SIG_BLOCK_PUBLIC_SECP384		0x08F07B47
+#define PFR_SIG_BLOCK_SIGNATURE_SECP256		0xDE64437D
+#define PFR_SIG_BLOCK_SIGNATURE_SECP384		0xEA2A50E9
+
+/* Status codes returned while parsing a signature block. */
+#define PFR_SIG_BLOCK_INVALID_ARGUMENT		-1	// Null block
+#define PFR_SIG_BLOCK_BAD_TAG				-2	// A block or entry tag does not match
+#define PFR_SIG_BLOCK_BAD_CURVE				-3	// A key or signature uses an unknown curve
+
+/* Curve of a key or signature. */
+enum pfr_sig_block_curve {
+	PFR_SIG_BLOCK_CURVE_UNKNOWN,		/**< The magic number is not a supported curve. */
+	PFR_SIG_BLOCK_CURVE_SECP256,		/**< NIST P-256 with SHA-256. */
+	PFR_SIG_BLOCK_CURVE_SECP384,		/**< NIST P-384 with SHA-384. */
+};
+
+/**
+ * A public key entry of Block1.
+ */
+struct pfr_sig_block_key {
+	uint8_t curve;						/**< Curve of the key, a pfr_sig_block_curve value. */
+	uint32_t permissions;				/**< Images the key may sign. */
+	uint32_t key_id;					/**< ID checked against the cancellation policy. */
+	const uint8_t *x;					/**< X coordinate of the key. */
+	const uint8_t *y;					/**< Y coordinate of the key. */
+};
+
+/**
+ * A signature in Block1.
+ */
+struct pfr_sig_block_signature {
+	uint8_t curve;						/**< Curve of the signature, a pfr_sig_block_curve value. */
+	const uint8_t *r;					/**< R value of the signature. */
+	const uint8_t *s;					/**< S value of the signature. */
+};
+
+/**
+ * A signature block read into RAM with a single transaction.  Once it is parsed, the views point
+ * into the data, so nothing needs to be read from flash again while it is verified.
+ */
+struct pfr_sig_block {
+	uint8_t data[PFR_SIG_BLOCK_SIZE];	/**< Raw signature block. */
+	uint32_t pc_length;					/**< Length of the protected content. */
+	uint32_t pc_type;					/**< Type of the protected content. */
+	const uint8_t *sha256_pc;			/**< SHA-256 digest of the protected content. */
+	const uint8_t *sha384_pc;			/**< SHA-384 digest of the protected content. */
+	struct pfr_sig_block_key root;		/**< Root key entry. */
+	bool has_csk;						/**< There is a CSK entry.  Cancellation capsules have none. */
+	struct pfr_sig_block_key csk;		/**< CSK entry, if there is one. */
+	struct pfr_sig_block_signature csk_signature;	/**< Root key signature of the CSK entry. */
+	const uint8_t *csk_signed;			/**< The part of the CSK entry that is signed. */
+	struct pfr_sig_block_signature block0_signature;	/**< Signature of Block0. */
+};
+
+int pfr_sig_block_parse(struct pfr_sig_block *block);
+
+#endif /*PFR_SIG_BLOCK_H*/
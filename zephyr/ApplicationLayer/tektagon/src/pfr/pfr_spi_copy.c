@@ -0,0 +1,116 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include "status/rot_status.h"
+#include "pfr_spi_copy.h"
+
+/**
+ * Erase the destination up to an address, using 64kB erases for aligned blocks that are
+ * completely inside the copy.
+ *
+ * @param target The destination flash.
+ * @param erased The first address that is not erased yet.  This is updated to the new end.
+ * @param until The address the erase must reach.
+ * @param end The end of the copy.  Nothing past it is erased.
+ * @param erase_sizes The erase sizes the destination supports.
+ *
+ * @return 0 if the region was erased or an error code.
+ */
+static int pfr_spi_copy_erase_ahead(struct flash *target, uint32_t *erased, uint32_t until,
+		uint32_t end, uint32_t erase_sizes)
+{
+	int status;
+
+	while (*erased < until) {
+		if ((erase_sizes & PFR_SPI_COPY_ERASE_64K) &&
+			((*erased & (PFR_SPI_COPY_BLOCK_SIZE - 1)) == 0) &&
+			((end - *erased) >= PFR_SPI_COPY_BLOCK_SIZE)) {
+			status = target->block_erase(target, *erased);
+			if (status != 0)
+				return status;
+
+			*erased += PFR_SPI_COPY_BLOCK_SIZE;
+		}
+		else {
+			status = target->sector_erase(target, *erased);
+			if (status != 0)
+				return status;
+
+			*erased += PFR_SPI_COPY_SECTOR_SIZE;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Copy a region from one flash device to another, replacing what the destination held.
+ *
+ * The source is read in chunks as large as the buffer, so each read can be a single DMA
+ * transfer, and each chunk is programmed with one write that the driver splits into pages.  The
+ * destination is erased just ahead of the data being programmed rather than all up front, so a
+ * failure leaves the rest of the destination untouched.
+ *
+ * The source and destination may be the same device as long as the regions do not overlap.
+ *
+ * @param source The flash to copy from.
+ * @param source_address The start of the data to copy.
+ * @param target The flash to copy to.
+ * @param target_address The start of the destination.  It must be sector aligned.
+ * @param length The number of bytes to copy, a multiple of the sector size.
+ * @param erase_sizes The erase sizes the destination supports, PFR_SPI_COPY_ERASE_* flags.
+ * @param buffer Buffer for the data in flight.  Aligning it for DMA lets reads skip the bounce
+ * buffer.
+ * @param buffer_size Size of the buffer, at least one sector.  Only whole sectors are used.
+ *
+ * @return 0 if the region was copied or an error code.
+ */
+int pfr_spi_copy(struct flash *source, uint32_t source_address, struct flash *target,
+		uint32_t target_address, uint32_t length, uint32_t erase_sizes, uint8_t *buffer,
+		size_t buffer_size)
+{
+	uint32_t erased = target_address;
+	uint32_t end = target_address + length;
+	uint32_t chunk;
+	int status;
+
+	if ((source == NULL) || (target == NULL) || (buffer == NULL) ||
+		(buffer_size < PFR_SPI_COPY_SECTOR_SIZE) ||
+		(target_address & (PFR_SPI_COPY_SECTOR_SIZE - 1)) ||
+		(length & (PFR_SPI_COPY_SECTOR_SIZE - 1)) || (end < target_address)) {
+		return PFR_SPI_COPY_INVALID_ARGUMENT;
+	}
+
+	buffer_size &= ~((size_t) PFR_SPI_COPY_SECTOR_SIZE - 1);
+
+	while (length) {
+		chunk = (length < buffer_size) ? length : buffer_size;
+
+		status = pfr_spi_copy_erase_ahead(target, &erased, target_address + chunk, end,
+			erase_sizes);
+		if (status != 0)
+			return status;
+
+		status = source->read(source, source_address, buffer, chunk);
+		if (status != 0)
+			return status;
+
+		status = target->write(target, target_address, buffer, chunk);
+		if (ROT_IS_ERROR(status))
+			return status;
+
+		if ((uint32_t) status != chunk)
+			return PFR_SPI_COPY_WRITE_FAILED;
+
+		source_address += chunk;
+		target_address += chunk;
+		length -= chunk;
+	}
+
+	return 0;
+}
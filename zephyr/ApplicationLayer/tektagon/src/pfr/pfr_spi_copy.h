@@ -0,0 +1,32 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_SPI_COPY_H
+#define PFR_SPI_COPY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "flash/flash.h"
+
+/* Copies are erased and programmed in whole 4kB sectors. */
+#define PFR_SPI_COPY_SECTOR_SIZE		0x1000
+#define PFR_SPI_COPY_BLOCK_SIZE			0x10000
+
+/* Erase sizes the destination flash can be asked to use.  4kB erases are always allowed. */
+#define PFR_SPI_COPY_ERASE_4K			(1U << 0)
+#define PFR_SPI_COPY_ERASE_64K			(1U << 2)
+
+/* Status codes returned in addition to the flash errors. */
+#define PFR_SPI_COPY_INVALID_ARGUMENT	-1	// Null flash or buffer, or a region not sector aligned
+#define PFR_SPI_COPY_WRITE_FAILED		-2	// Flash did not take all of the data
+
+int pfr_spi_copy(struct flash *source, uint32_t source_address, struct flash *target,
+		uint32_t target_address, uint32_t length, uint32_t erase_sizes, uint8_t *buffer,
+		size_t buffer_size);
+
+#endif /*PFR_SPI_COPY_H*/
@@ -0,0 +1,204 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <string.h>
+#include "pfr_spi_filter.h"
+
+/**
+ * Set or clear the bits for a range of 16kB blocks in a privilege table.
+ *
+ * @param table The table to update.
+ * @param first The first block in the range.
+ * @param last One past the last block in the range.
+ * @param allowed Set the bits to allow access, or clear them to block it.
+ */
+static void pfr_spi_filter_set_blocks(uint32_t *table, uint32_t first, uint32_t last, bool allowed)
+{
+	uint32_t mask;
+
+	while (first < last) {
+		if (((first % 32) == 0) && ((last - first) >= 32)) {
+			table[first / 32] = (allowed) ? 0xffffffff : 0;
+			first += 32;
+			continue;
+		}
+
+		mask = 1U << (first % 32);
+		if (allowed)
+			table[first / 32] |= mask;
+		else
+			table[first / 32] &= ~mask;
+		first++;
+	}
+}
+
+/**
+ * Start the privilege tables for a SPI monitor with every address readable and no address
+ * writable.
+ *
+ * @param tables The tables to initialize.
+ */
+void pfr_spi_filter_tables_init(struct pfr_spi_filter_tables *tables)
+{
+	if (tables == NULL)
+		return;
+
+	memset(tables->table[PFR_SPI_FILTER_READ_TABLE], 0xff,
+		sizeof(tables->table[PFR_SPI_FILTER_READ_TABLE]));
+	memset(tables->table[PFR_SPI_FILTER_WRITE_TABLE], 0,
+		sizeof(tables->table[PFR_SPI_FILTER_WRITE_TABLE]));
+}
+
+/**
+ * Add a SPI region from the PFM to the privilege tables.  Regions that touch or overlap merge
+ * into a single range of the table.
+ *
+ * The monitor works on 16kB blocks, so a region that is not aligned is widened to whole blocks,
+ * the same way the driver does for a single region.
+ *
+ * @param tables The tables to update.
+ * @param start_address The first address in the region.
+ * @param end_address One past the last address in the region.
+ * @param read_allowed The host may read the region.
+ * @param write_allowed The host may write the region.
+ *
+ * @return 0 if the region was added or an error code.
+ */
+int pfr_spi_filter_tables_add_region(struct pfr_spi_filter_tables *tables, uint32_t start_address,
+		uint32_t end_address, bool read_allowed, bool write_allowed)
+{
+	uint32_t first;
+	uint32_t last;
+
+	if ((tables == NULL) || (start_address >= end_address) ||
+		(start_address >= PFR_SPI_FILTER_MAX_ADDRESS))
+		return PFR_SPI_FILTER_INVALID_ARGUMENT;
+
+	if (end_address > PFR_SPI_FILTER_MAX_ADDRESS)
+		end_address = PFR_SPI_FILTER_MAX_ADDRESS;
+
+	first = start_address / PFR_SPI_FILTER_BLOCK_SIZE;
+	last = (end_address / PFR_SPI_FILTER_BLOCK_SIZE) +
+		((end_address % PFR_SPI_FILTER_BLOCK_SIZE) ? 1 : 0);
+
+	if (write_allowed)
+		pfr_spi_filter_set_blocks(tables->table[PFR_SPI_FILTER_WRITE_TABLE], first, last, true);
+
+	if (!read_allowed)
+		pfr_spi_filter_set_blocks(tables->table[PFR_SPI_FILTER_READ_TABLE], first, last, false);
+
+	return 0;
+}
+
+/**
+ * Bring one privilege table of a SPI monitor to the expected contents, writing only the
+ * registers that differ.
+ *
+ * @param regs The SPI monitor to update.
+ * @param table The table to update.
+ * @param expected The register values the table should hold.
+ *
+ * @return 0 if the table was updated or an error code.
+ */
+static int pfr_spi_filter_update_table(struct pfr_spi_filter_regs *regs, int table,
+		const uint32_t *expected)
+{
+	uint32_t current[PFR_SPI_FILTER_CHUNK_REGS];
+	uint32_t chunk;
+	uint32_t run;
+	uint32_t i;
+	int status;
+
+	for (chunk = 0; chunk < PFR_SPI_FILTER_TABLE_REGS; chunk += PFR_SPI_FILTER_CHUNK_REGS) {
+		status = regs->read(regs, table, chunk, current, PFR_SPI_FILTER_CHUNK_REGS);
+		if (status != 0)
+			return status;
+
+		i = 0;
+		while (i < PFR_SPI_FILTER_CHUNK_REGS) {
+			if (current[i] == expected[chunk + i]) {
+				i++;
+				continue;
+			}
+
+			run = i;
+			while ((i < PFR_SPI_FILTER_CHUNK_REGS) && (current[i] != expected[chunk + i]))
+				i++;
+
+			status = regs->write(regs, table, chunk + run, &expected[chunk + run], i - run);
+			if (status != 0)
+				return status;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Check that a privilege table of a SPI monitor holds the expected contents.
+ *
+ * @param regs The SPI monitor to check.
+ * @param table The table to check.
+ * @param expected The register values the table should hold.
+ *
+ * @return 0 if the table matches or an error code.
+ */
+static int pfr_spi_filter_verify_table(struct pfr_spi_filter_regs *regs, int table,
+		const uint32_t *expected)
+{
+	uint32_t current[PFR_SPI_FILTER_CHUNK_REGS];
+	uint32_t chunk;
+	int status;
+
+	for (chunk = 0; chunk < PFR_SPI_FILTER_TABLE_REGS; chunk += PFR_SPI_FILTER_CHUNK_REGS) {
+		status = regs->read(regs, table, chunk, current, PFR_SPI_FILTER_CHUNK_REGS);
+		if (status != 0)
+			return status;
+
+		if (memcmp(current, &expected[chunk], sizeof(current)) != 0)
+			return PFR_SPI_FILTER_VERIFY_FAILED;
+	}
+
+	return 0;
+}
+
+/**
+ * Program the privilege tables of a SPI monitor in one pass and read them back to verify them.
+ *
+ * Each table is compared with what the monitor already holds and only the registers that
+ * differ are written, in runs of consecutive registers.  A monitor that already enforces the
+ * same PFM, such as after a warm reset, needs no writes at all.
+ *
+ * @param regs The SPI monitor to program.
+ * @param tables The privilege tables the monitor should enforce.
+ *
+ * @return 0 if the tables were programmed and verified or an error code.
+ */
+int pfr_spi_filter_program(struct pfr_spi_filter_regs *regs,
+		const struct pfr_spi_filter_tables *tables)
+{
+	int table;
+	int status;
+
+	if ((regs == NULL) || (tables == NULL))
+		return PFR_SPI_FILTER_INVALID_ARGUMENT;
+
+	for (table = 0; table < PFR_SPI_FILTER_TABLES; table++) {
+		status = pfr_spi_filter_update_table(regs, table, tables->table[table]);
+		if (status != 0)
+			return status;
+	}
+
+	for (table = 0; table < PFR_SPI_FILTER_TABLES; table++) {
+		status = pfr_spi_filter_verify_table(regs, table, tables->table[table]);
+		if (status != 0)
+			return status;
+	}
+
+	return 0;
+}
@@ -0,0 +1,80 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_SPI_FILTER_H
+#define PFR_SPI_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Each bit of a privilege table covers 16kB, so 512 registers cover 256MB. */
+#define PFR_SPI_FILTER_BLOCK_SIZE		0x4000
+#define PFR_SPI_FILTER_TABLE_REGS		512
+#define PFR_SPI_FILTER_MAX_ADDRESS		(PFR_SPI_FILTER_TABLE_REGS * 32 * PFR_SPI_FILTER_BLOCK_SIZE)
+
+/* Privilege tables of a SPI monitor.  A set bit allows the access. */
+#define PFR_SPI_FILTER_READ_TABLE		0
+#define PFR_SPI_FILTER_WRITE_TABLE		1
+#define PFR_SPI_FILTER_TABLES			2
+
+/* Registers compared and verified per access, which bounds the stack used when programming. */
+#define PFR_SPI_FILTER_CHUNK_REGS		64
+
+/* Status codes returned in addition to the register access errors. */
+#define PFR_SPI_FILTER_INVALID_ARGUMENT	-1	// Null tables or accessor, or an empty region
+#define PFR_SPI_FILTER_VERIFY_FAILED	-2	// The table read back does not match what was written
+
+/**
+ * Access to the address privilege tables of one SPI monitor.
+ */
+struct pfr_spi_filter_regs {
+	/**
+	 * Read consecutive registers of a privilege table.
+	 *
+	 * @param regs The SPI monitor to read.
+	 * @param table PFR_SPI_FILTER_READ_TABLE or PFR_SPI_FILTER_WRITE_TABLE.
+	 * @param first The first register to read.
+	 * @param values Output for the register values.
+	 * @param count The number of registers to read.
+	 *
+	 * @return 0 if the registers were read or an error code.
+	 */
+	int (*read) (struct pfr_spi_filter_regs *regs, int table, uint32_t first, uint32_t *values,
+		size_t count);
+
+	/**
+	 * Write consecutive registers of a privilege table.
+	 *
+	 * @param regs The SPI monitor to update.
+	 * @param table PFR_SPI_FILTER_READ_TABLE or PFR_SPI_FILTER_WRITE_TABLE.
+	 * @param first The first register to write.
+	 * @param values The register values.
+	 * @param count The number of registers to write.
+	 *
+	 * @return 0 if the registers were written or an error code.
+	 */
+	int (*write) (struct pfr_spi_filter_regs *regs, int table, uint32_t first,
+		const uint32_t *values, size_t count);
+};
+
+/**
+ * The privilege tables a SPI monitor should hold.
+ */
+struct pfr_spi_filter_tables {
+	uint32_t table[PFR_SPI_FILTER_TABLES][PFR_SPI_FILTER_TABLE_REGS];	/**< Register values. */
+};
+
+void pfr_spi_filter_tables_init(struct pfr_spi_filter_tables *tables);
+int pfr_spi_filter_tables_add_region(struct pfr_spi_filter_tables *tables, uint32_t start_address,
+		uint32_t end_address, bool read_allowed, bool write_allowed);
+
+int pfr_spi_filter_program(struct pfr_spi_filter_regs *regs,
+		const struct pfr_spi_filter_tables *tables);
+
+#endif /*PFR_SPI_FILTER_H*/
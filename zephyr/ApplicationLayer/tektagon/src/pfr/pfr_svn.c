@@ -0,0 +1,244 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <string.h>
+#include "status/rot_status.h"
+#include "pfr_svn.h"
+
+/**
+ * Get the SVN a bitmap holds: the number of cleared bits before the first set bit.
+ */
+static uint8_t pfr_svn_decode(const uint8_t *bitmap)
+{
+	uint8_t value = 0;
+	int i;
+	int bit;
+
+	for (i = 0; i < PFR_SVN_BITMAP_SIZE; i++) {
+		if (bitmap[i] != 0) {
+			for (bit = 0; !(bitmap[i] & (1U << bit)); bit++)
+				value++;
+
+			return value;
+		}
+
+		value += 8;
+	}
+
+	return value;
+}
+
+/**
+ * Clear the first bits of a bitmap so it holds at least an SVN.  Bits that are already cleared
+ * stay cleared.
+ */
+static void pfr_svn_encode(uint8_t *bitmap, uint32_t value)
+{
+	int i;
+
+	for (i = 0; (i < PFR_SVN_BITMAP_SIZE) && (value >= 8); i++, value -= 8)
+		bitmap[i] = 0;
+
+	if (i < PFR_SVN_BITMAP_SIZE)
+		bitmap[i] &= (uint8_t) (0xff << value);
+}
+
+/**
+ * Read the policies from flash the first time they are needed.
+ */
+static int pfr_svn_load(struct pfr_svn *svn)
+{
+	int policy;
+	int status;
+
+	if (svn->loaded)
+		return 0;
+
+	status = svn->flash->read(svn->flash, svn->base_addr, &svn->bitmap[0][0],
+		sizeof(svn->bitmap));
+	if (status != 0)
+		return status;
+
+	for (policy = 0; policy < PFR_SVN_POLICIES; policy++)
+		svn->svn[policy] = pfr_svn_decode(svn->bitmap[policy]);
+
+	svn->dirty = 0;
+	svn->loaded = true;
+
+	return 0;
+}
+
+/**
+ * Initialize the SVN policies.  Nothing is read from flash until the first access.
+ *
+ * @param svn The policies to initialize.
+ * @param flash The flash that holds the policy bitmaps.
+ * @param base_addr Address of the CPLD policy.  The PCH and BMC policies follow it.
+ *
+ * @return 0 if the policies were initialized or an error code.
+ */
+int pfr_svn_init(struct pfr_svn *svn, struct flash *flash, uint32_t base_addr)
+{
+	if ((svn == NULL) || (flash == NULL))
+		return PFR_SVN_INVALID_ARGUMENT;
+
+	memset(svn, 0, sizeof(*svn));
+
+	svn->flash = flash;
+	svn->base_addr = base_addr;
+
+	return 0;
+}
+
+/**
+ * Drop the shadow so the policies are read from flash again, such as after the UFM has been
+ * erased or provisioned.  Uncommitted changes are lost.
+ *
+ * @param svn The policies to invalidate.
+ */
+void pfr_svn_invalidate(struct pfr_svn *svn)
+{
+	if (svn) {
+		svn->loaded = false;
+		svn->dirty = 0;
+	}
+}
+
+/**
+ * Get the current SVN of a policy.
+ *
+ * @param svn The policies to query.
+ * @param policy The policy to get.
+ * @param value Output for the SVN.  This is PFR_SVN_BITMAP_FULL if every bit is cleared.
+ *
+ * @return 0 if the SVN was read or an error code.
+ */
+int pfr_svn_get(struct pfr_svn *svn, int policy, uint8_t *value)
+{
+	int status;
+
+	if ((svn == NULL) || (value == NULL) || (policy < 0) || (policy >= PFR_SVN_POLICIES))
+		return PFR_SVN_INVALID_ARGUMENT;
+
+	status = pfr_svn_load(svn);
+	if (status != 0)
+		return status;
+
+	*value = svn->svn[policy];
+
+	return 0;
+}
+
+/**
+ * Check if an image with an SVN is allowed by a policy.
+ *
+ * @param svn The policies to check against.
+ * @param policy The policy of the image.
+ * @param value The SVN of the image.
+ *
+ * @return 0 if the image is allowed, PFR_SVN_ROLLBACK if it is older than the policy,
+ * PFR_SVN_OUT_OF_RANGE if the SVN is not valid or an error code.
+ */
+int pfr_svn_check(struct pfr_svn *svn, int policy, uint32_t value)
+{
+	uint8_t current;
+	int status;
+
+	status = pfr_svn_get(svn, policy, &current);
+	if (status != 0)
+		return status;
+
+	if (value > PFR_SVN_MAX)
+		return PFR_SVN_OUT_OF_RANGE;
+
+	if (value < current)
+		return PFR_SVN_ROLLBACK;
+
+	return 0;
+}
+
+/**
+ * Raise the SVN of a policy in the shadow.  The change reaches flash with pfr_svn_commit.
+ *
+ * An SVN can never go down.  Asking for the current SVN changes nothing.
+ *
+ * @param svn The policies to update.
+ * @param policy The policy to raise.
+ * @param value The new SVN.
+ *
+ * @return 0 if the policy holds the SVN, PFR_SVN_ROLLBACK if it already holds a higher SVN,
+ * PFR_SVN_OUT_OF_RANGE if the SVN is not valid or an error code.
+ */
+int pfr_svn_advance(struct pfr_svn *svn, int policy, uint32_t value)
+{
+	int status;
+
+	status = pfr_svn_check(svn, policy, value);
+	if (status != 0)
+		return status;
+
+	if (value == svn->svn[policy])
+		return 0;
+
+	pfr_svn_encode(svn->bitmap[policy], value);
+	svn->svn[policy] = value;
+	svn->dirty |= (1U << policy);
+
+	return 0;
+}
+
+/**
+ * Write the raised SVNs to flash.  The changed bitmaps, and any policy between them, are
+ * programmed with a single write and read back.  Flash is never erased.
+ *
+ * The shadow keeps the raised SVNs if the commit fails, so images are still checked against them
+ * and a later commit can retry.
+ *
+ * @param svn The policies to commit.
+ *
+ * @return 0 if flash holds every SVN in the shadow or an error code.
+ */
+int pfr_svn_commit(struct pfr_svn *svn)
+{
+	uint8_t verify[PFR_SVN_POLICIES][PFR_SVN_BITMAP_SIZE];
+	uint32_t offset;
+	uint32_t length;
+	int first;
+	int last;
+	int status;
+
+	if (svn == NULL)
+		return PFR_SVN_INVALID_ARGUMENT;
+
+	if (!svn->loaded || (svn->dirty == 0))
+		return 0;
+
+	for (first = 0; !(svn->dirty & (1U << first)); first++);
+	for (last = PFR_SVN_POLICIES - 1; !(svn->dirty & (1U << last)); last--);
+
+	offset = first * PFR_SVN_BITMAP_SIZE;
+	length = (last - first + 1) * PFR_SVN_BITMAP_SIZE;
+
+	status = svn->flash->write(svn->flash, svn->base_addr + offset, &svn->bitmap[first][0],
+		length);
+	if (ROT_IS_ERROR(status))
+		return status;
+	if ((uint32_t) status != length)
+		return PFR_SVN_WRITE_FAILED;
+
+	status = svn->flash->read(svn->flash, svn->base_addr + offset, &verify[first][0], length);
+	if (status != 0)
+		return status;
+
+	if (memcmp(&verify[first][0], &svn->bitmap[first][0], length) != 0)
+		return PFR_SVN_WRITE_FAILED;
+
+	svn->dirty = 0;
+
+	return 0;
+}
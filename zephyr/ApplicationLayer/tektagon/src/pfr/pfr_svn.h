@@ -0,0 +1,59 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_SVN_H
+#define PFR_SVN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "flash/flash.h"
+
+/* The SVN policies for the CPLD, PCH and BMC are consecutive 64-bit bitmaps in the UFM. */
+#define PFR_SVN_POLICY_CPLD				0
+#define PFR_SVN_POLICY_PCH				1
+#define PFR_SVN_POLICY_BMC				2
+#define PFR_SVN_POLICIES				3
+
+#define PFR_SVN_BITMAP_SIZE				8
+#define PFR_SVN_MAX						63	// Highest SVN an image may carry
+#define PFR_SVN_BITMAP_FULL				64	// Every bit of the bitmap is cleared
+
+/* Status codes returned in addition to the flash errors. */
+#define PFR_SVN_INVALID_ARGUMENT		-1	// Null manager or output, or an unknown policy
+#define PFR_SVN_OUT_OF_RANGE			-2	// The SVN is above PFR_SVN_MAX
+#define PFR_SVN_ROLLBACK				-3	// The SVN is older than the policy allows
+#define PFR_SVN_WRITE_FAILED			-4	// Flash does not hold the committed bitmaps
+
+/**
+ * RAM shadow of the anti-rollback SVN policies.
+ *
+ * An SVN of n is stored as a bitmap with the first n bits cleared, so raising it only clears bits
+ * and never needs an erase.  The bitmaps are read once on first use and every check after that is
+ * answered from RAM.  Raising an SVN updates the shadow; pfr_svn_commit then programs every
+ * changed bitmap with a single write.  If power is lost before the commit, the policy on flash
+ * still holds the previous SVN, and a torn commit can only leave an SVN between the old and the
+ * new value.
+ */
+struct pfr_svn {
+	struct flash *flash;				/**< Flash that holds the policies. */
+	uint32_t base_addr;					/**< Address of the first policy bitmap. */
+	bool loaded;						/**< The shadow holds the policies from flash. */
+	uint8_t dirty;						/**< Policies changed since the last commit, one bit each. */
+	uint8_t svn[PFR_SVN_POLICIES];		/**< Current SVN of each policy. */
+	uint8_t bitmap[PFR_SVN_POLICIES][PFR_SVN_BITMAP_SIZE];	/**< Shadow of the bitmaps. */
+};
+
+int pfr_svn_init(struct pfr_svn *svn, struct flash *flash, uint32_t base_addr);
+void pfr_svn_invalidate(struct pfr_svn *svn);
+
+int pfr_svn_get(struct pfr_svn *svn, int policy, uint8_t *value);
+int pfr_svn_check(struct pfr_svn *svn, int policy, uint32_t value);
+int pfr_svn_advance(struct pfr_svn *svn, int policy, uint32_t value);
+int pfr_svn_commit(struct pfr_svn *svn);
+
+#endif /*PFR_SVN_H*/
@@ -11,10 +11,190 @@
 #include "Definition.h"
 #ifdef CONFIG_INTEL_PFR_SUPPORT
 #include "intel_2.0/intel_pfr_definitions.h"
+#include "intel_2.0/intel_pfr_provision.h"
 #endif
 #ifdef CONFIG_CERBERUS_PFR_SUPPORT
 #include "cerberus/cerberus_pfr_definitions.h"
+#include "cerberus/cerberus_pfr_provision.h"
 #endif
+#include "pfr_ufm.h"
+#include "pfr_ufm_cache.h"
+#include "pfr_measurement_cache.h"
+#include "pfr_svn.h"
+#include "pfr_key_cancel.h"
+
+/* Sectors of the state UFM that hold the verified SPI region measurements of each image.  The
+ * update status uses sector 0. */
+#define BMC_MEASUREMENT_CACHE_OFFSET	0x1000
+#define PCH_MEASUREMENT_CACHE_OFFSET	0x2000
+
+/**
+ * Flash API over the internal UFM SPI that holds the provisioning data.
+ */
+static int provision_flash_read(struct flash *flash, uint32_t address, uint8_t *data, size_t length)
+{
+	struct SpiEngine *spi_flash = getSpiEngineWrapper();
+
+	spi_flash->spi.device_id[0] = ROT_INTERNAL_INTEL_STATE;
+	return spi_flash->spi.base.read(&spi_flash->spi.base, address, data, length);
+}
+
+static int provision_flash_write(struct flash *flash, uint32_t address, const uint8_t *data,
+		size_t length)
+{
+	struct SpiEngine *spi_flash = getSpiEngineWrapper();
+
+	spi_flash->spi.device_id[0] = ROT_INTERNAL_INTEL_STATE;
+	return spi_flash->spi.base.write(&spi_flash->spi.base, address, data, length);
+}
+
+static int provision_flash_sector_erase(struct flash *flash, uint32_t sector_addr)
+{
+	struct SpiEngine *spi_flash = getSpiEngineWrapper();
+
+	spi_flash->spi.device_id[0] = ROT_INTERNAL_INTEL_STATE;
+	return spi_flash->spi.base.sector_erase(&spi_flash->spi.base, sector_addr);
+}
+
+static struct flash provision_flash = {
+	.read = provision_flash_read,
+	.write = provision_flash_write,
+	.sector_erase = provision_flash_sector_erase,
+};
+
+static struct pfr_ufm_cache provision_cache;
+
+static struct pfr_ufm_cache *get_provision_cache(void)
+{
+	if (provision_cache.flash == NULL)
+		pfr_ufm_cache_init(&provision_cache, &provision_flash, 0);
+
+	return &provision_cache;
+}
+
+/**
+ * Flash API for the SVN and key cancellation policies.  Reads come from the provisioning cache and
+ * every write is programmed right away, so a raised SVN or cancelled key is on flash before the
+ * update that needs it continues.  Only the policy bytes are programmed, other provisioning
+ * changes pending in the cache are left alone and the sector is never erased.
+ */
+static int policy_flash_read(struct flash *flash, uint32_t address, uint8_t *data, size_t length)
+{
+	return pfr_ufm_cache_read(get_provision_cache(), address, data, length);
+}
+
+static int policy_flash_write(struct flash *flash, uint32_t address, const uint8_t *data,
+		size_t length)
+{
+	int status;
+
+	status = pfr_ufm_cache_write_through(get_provision_cache(), address, data, length);
+	if (status != 0)
+		return status;
+
+	return length;
+}
+
+static struct flash policy_flash = {
+	.read = policy_flash_read,
+	.write = policy_flash_write,
+};
+
+static struct pfr_svn svn_policies;
+
+/**
+ * Get the anti-rollback SVN policies stored in the provisioning UFM.
+ *
+ * @return The SVN policies.
+ */
+struct pfr_svn *get_svn_policies(void)
+{
+	if (svn_policies.flash == NULL)
+		pfr_svn_init(&svn_policies, &policy_flash, SVN_POLICY_FOR_CPLD_UPDATE);
+
+	return &svn_policies;
+}
+
+static struct pfr_key_cancel key_cancel_policies;
+
+/**
+ * Get the CSK cancellation policies stored in the provisioning UFM.
+ *
+ * @return The key cancellation policies.
+ */
+struct pfr_key_cancel *get_key_cancel_policies(void)
+{
+	if (key_cancel_policies.flash == NULL)
+		pfr_key_cancel_init(&key_cancel_policies, &policy_flash,
+			KEY_CANCELLATION_POLICY_FOR_SIGNING_PCH_PFM);
+
+	return &key_cancel_policies;
+}
+
+/**
+ * Flash API over the internal state SPI that holds the SPI region measurements.
+ */
+static int state_flash_read(struct flash *flash, uint32_t address, uint8_t *data, size_t length)
+{
+	struct SpiEngine *spi_flash = getSpiEngineWrapper();
+
+	spi_flash->spi.device_id[0] = ROT_INTERNAL_STATE;
+	return spi_flash->spi.base.read(&spi_flash->spi.base, address, data, length);
+}
+
+static int state_flash_write(struct flash *flash, uint32_t address, const uint8_t *data,
+		size_t length)
+{
+	struct SpiEngine *spi_flash = getSpiEngineWrapper();
+
+	spi_flash->spi.device_id[0] = ROT_INTERNAL_STATE;
+	return spi_flash->spi.base.write(&spi_flash->spi.base, address, data, length);
+}
+
+static int state_flash_sector_erase(struct flash *flash, uint32_t sector_addr)
+{
+	struct SpiEngine *spi_flash = getSpiEngineWrapper();
+
+	spi_flash->spi.device_id[0] = ROT_INTERNAL_STATE;
+	return spi_flash->spi.base.sector_erase(&spi_flash->spi.base, sector_addr);
+}
+
+static struct flash state_flash = {
+	.read = state_flash_read,
+	.write = state_flash_write,
+	.sector_erase = state_flash_sector_erase,
+};
+
+static struct pfr_measurement_cache bmc_measurement_cache;
+static struct pfr_measurement_cache pch_measurement_cache;
+
+/**
+ * Get the SPI region measurements of an image.
+ *
+ * @param image_type BMC_TYPE or PCH_TYPE.
+ *
+ * @return The measurement cache of the image or NULL for other images.
+ */
+struct pfr_measurement_cache *get_measurement_cache(uint32_t image_type)
+{
+	if (image_type == BMC_TYPE) {
+		if (bmc_measurement_cache.flash == NULL)
+			pfr_measurement_cache_init(&bmc_measurement_cache, &state_flash,
+				BMC_MEASUREMENT_CACHE_OFFSET);
+
+		return &bmc_measurement_cache;
+	}
+	else if (image_type == PCH_TYPE) {
+		if (pch_measurement_cache.flash == NULL)
+			pfr_measurement_cache_init(&pch_measurement_cache, &state_flash,
+				PCH_MEASUREMENT_CACHE_OFFSET);
+
+		return &pch_measurement_cache;
+	}
+
+	return NULL;
+}
+
 int get_cpld_status(uint8_t *data, uint32_t data_length){
     
     int status;
@@ -39,7 +219,7 @@ int set_cpld_status(uint8_t *data,uint32_t data_length){
 int ufm_read(uint32_t ufm_id, uint32_t offset, uint8_t *data, uint32_t data_length){
     
     if(ufm_id == PROVISION_UFM)
-        return get_provision_data_in_flash(offset, data, data_length);
+        return (pfr_ufm_cache_read(get_provision_cache(), offset, data, data_length) == 0) ? Success : Failure;
     else if (ufm_id == UPDATE_STATUS_UFM)
         return get_cpld_status(data, data_length);
     else
@@ -50,8 +230,20 @@ int ufm_read(uint32_t ufm_id, uint32_t offset, uint8_t *data, uint32_t data_leng
 
 int ufm_write(uint32_t ufm_id, uint32_t offset, uint8_t *data, uint32_t data_length){
    
-    if(ufm_id == PROVISION_UFM)
-        return set_provision_data_in_flash(offset, data, data_length);
+    if(ufm_id == PROVISION_UFM) {
+        // Writes that touch the SVN or key cancellation policies bypass the RAM copies, so
+        // reload them on next use
+        if ((offset < SVN_POLICY_FOR_CPLD_UPDATE + (PFR_SVN_POLICIES * PFR_SVN_BITMAP_SIZE)) &&
+            (offset + data_length > SVN_POLICY_FOR_CPLD_UPDATE))
+            pfr_svn_invalidate(&svn_policies);
+
+        if ((offset < KEY_CANCELLATION_POLICY_FOR_SIGNING_PCH_PFM +
+                (PFR_KEY_CANCEL_POLICIES * PFR_KEY_CANCEL_POLICY_SIZE)) &&
+            (offset + data_length > KEY_CANCELLATION_POLICY_FOR_SIGNING_PCH_PFM))
+            pfr_key_cancel_invalidate(&key_cancel_policies);
+
+        return (pfr_ufm_cache_write(get_provision_cache(), offset, data, data_length) == 0) ? Success : Failure;
+    }
     else if (ufm_id == UPDATE_STATUS_UFM)
         return set_cpld_status(data, data_length);
     else
@@ -62,8 +254,11 @@ int ufm_write(uint32_t ufm_id, uint32_t offset, uint8_t *data, uint32_t data_len
 }
 
 int ufm_erase(uint32_t ufm_id){
-    if(ufm_id == PROVISION_UFM)
-        return pfr_spi_erase_4k(ROT_INTERNAL_INTEL_STATE, 0);
+    if(ufm_id == PROVISION_UFM) {
+        pfr_svn_invalidate(&svn_policies);
+        pfr_key_cancel_invalidate(&key_cancel_policies);
+        return (pfr_ufm_cache_erase(get_provision_cache()) == 0) ? Success : Failure;
+    }
     else if(ufm_id == UPDATE_STATUS_UFM)
         return pfr_spi_erase_4k(ROT_INTERNAL_STATE, 0);
     else
@@ -72,5 +267,17 @@ int ufm_erase(uint32_t ufm_id){
     return Success;
 }
 
+/**
+ * Commit buffered UFM writes to flash.  Provisioning writes are held in RAM until this is called,
+ * so it must run before lockdown, reset or any point where the data needs to survive power loss.
+ * Other UFMs are written through and need no flush.
+ */
+int ufm_flush(uint32_t ufm_id){
 
-
+    if(ufm_id == PROVISION_UFM)
+        return (pfr_ufm_cache_flush(get_provision_cache()) == 0) ? Success : Failure;
+    else if (ufm_id == UPDATE_STATUS_UFM)
+        return Success;
+    else
+        return Failure;
+}
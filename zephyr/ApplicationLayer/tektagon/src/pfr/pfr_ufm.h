@@ -9,7 +9,19 @@
 #ifndef PFR_UFM_H
 #define PFR_UFM_H
 
+#include <stdint.h>
+
+struct pfr_measurement_cache;
+struct pfr_svn;
+struct pfr_key_cancel;
+
 int ufm_read(uint32_t ufm_id, uint32_t offset, uint8_t *data, uint32_t data_length);
 int ufm_write(uint32_t ufm_id, uint32_t offset, uint8_t *data, uint32_t data_length);
+int ufm_erase(uint32_t ufm_id);
+int ufm_flush(uint32_t ufm_id);
+
+struct pfr_measurement_cache *get_measurement_cache(uint32_t image_type);
+struct pfr_svn *get_svn_policies(void);
+struct pfr_key_cancel *get_key_cancel_policies(void);
 
 #endif /*PFR_UFM_H*/
\ No newline at end of file
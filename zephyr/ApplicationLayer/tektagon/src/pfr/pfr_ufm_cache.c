@@ -0,0 +1,346 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <string.h>
+#include "status/rot_status.h"
+#include "pfr_ufm_cache.h"
+
+/**
+ * Initialize a cache for the provisioning sector.  Nothing is read from flash until the first
+ * access.
+ *
+ * @param cache The cache to initialize.
+ * @param flash The flash that holds the provisioning sector.
+ * @param base_addr The sector aligned address of the provisioning data.
+ *
+ * @return 0 if the cache was initialized or an error code.
+ */
+int pfr_ufm_cache_init(struct pfr_ufm_cache *cache, struct flash *flash, uint32_t base_addr)
+{
+	if ((cache == NULL) || (flash == NULL) || ((base_addr & (PFR_UFM_CACHE_SIZE - 1)) != 0))
+		return PFR_UFM_CACHE_INVALID_ARGUMENT;
+
+	memset(cache, 0, sizeof(*cache));
+	cache->flash = flash;
+	cache->base_addr = base_addr;
+
+	return 0;
+}
+
+/**
+ * Drop the RAM copy so the next access reloads the sector.  Pending changes are discarded, so this
+ * is only for use after the sector was modified outside of the cache.
+ *
+ * @param cache The cache to invalidate.
+ */
+void pfr_ufm_cache_invalidate(struct pfr_ufm_cache *cache)
+{
+	if (cache == NULL)
+		return;
+
+	cache->loaded = false;
+	cache->dirty = false;
+	cache->needs_erase = false;
+}
+
+/**
+ * Read the sector into RAM if it has not been loaded yet.
+ */
+static int pfr_ufm_cache_load(struct pfr_ufm_cache *cache)
+{
+	int status;
+
+	if (cache->loaded)
+		return 0;
+
+	status = cache->flash->read(cache->flash, cache->base_addr, cache->data, sizeof(cache->data));
+	if (status != 0)
+		return status;
+
+	cache->loaded = true;
+	cache->dirty = false;
+	cache->needs_erase = false;
+
+	return 0;
+}
+
+static int pfr_ufm_cache_check_range(struct pfr_ufm_cache *cache, uint32_t offset, uint32_t length)
+{
+	if ((offset > PFR_UFM_CACHE_SIZE) || (length > (PFR_UFM_CACHE_SIZE - offset)))
+		return PFR_UFM_CACHE_OUT_OF_RANGE;
+
+	return pfr_ufm_cache_load(cache);
+}
+
+/**
+ * Read provisioning data.  Only the first access after boot, invalidation or a failed load reads
+ * the flash.
+ *
+ * @param cache The cache to read from.
+ * @param offset The offset within the provisioning sector.
+ * @param data Output for the data.
+ * @param length The number of bytes to read.
+ *
+ * @return 0 if the data was read or an error code.
+ */
+int pfr_ufm_cache_read(struct pfr_ufm_cache *cache, uint32_t offset, uint8_t *data,
+		uint32_t length)
+{
+	int status;
+
+	if ((cache == NULL) || (data == NULL))
+		return PFR_UFM_CACHE_INVALID_ARGUMENT;
+
+	status = pfr_ufm_cache_check_range(cache, offset, length);
+	if (status != 0)
+		return status;
+
+	memcpy(data, &cache->data[offset], length);
+
+	return 0;
+}
+
+/**
+ * Update provisioning data in RAM.  The change reaches flash on the next flush.  Writing data that
+ * matches the current contents leaves the cache clean.
+ *
+ * @param cache The cache to update.
+ * @param offset The offset within the provisioning sector.
+ * @param data The new data.
+ * @param length The number of bytes to write.
+ *
+ * @return 0 if the cache was updated or an error code.
+ */
+int pfr_ufm_cache_write(struct pfr_ufm_cache *cache, uint32_t offset, const uint8_t *data,
+		uint32_t length)
+{
+	uint32_t i;
+	int status;
+
+	if ((cache == NULL) || (data == NULL))
+		return PFR_UFM_CACHE_INVALID_ARGUMENT;
+
+	status = pfr_ufm_cache_check_range(cache, offset, length);
+	if (status != 0)
+		return status;
+
+	for (i = offset; i < (offset + length); i++) {
+		uint8_t old = cache->data[i];
+		uint8_t new = data[i - offset];
+
+		if (old == new)
+			continue;
+
+		// Programming can only clear bits, anything else needs the sector erased first
+		if (new & ~old)
+			cache->needs_erase = true;
+
+		cache->data[i] = new;
+
+		if (!cache->dirty) {
+			cache->dirty = true;
+			cache->dirty_start = i;
+			cache->dirty_end = i + 1;
+		} else {
+			if (i < cache->dirty_start)
+				cache->dirty_start = i;
+			if (i >= cache->dirty_end)
+				cache->dirty_end = i + 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Erase the provisioning sector.  The erase is applied to flash immediately and drops any pending
+ * changes.
+ *
+ * @param cache The cache to erase.
+ *
+ * @return 0 if the sector was erased or an error code.
+ */
+int pfr_ufm_cache_erase(struct pfr_ufm_cache *cache)
+{
+	int status;
+
+	if (cache == NULL)
+		return PFR_UFM_CACHE_INVALID_ARGUMENT;
+
+	status = cache->flash->sector_erase(cache->flash, cache->base_addr);
+	if (status != 0) {
+		pfr_ufm_cache_invalidate(cache);
+		return status;
+	}
+
+	memset(cache->data, 0xff, sizeof(cache->data));
+	cache->loaded = true;
+	cache->dirty = false;
+	cache->needs_erase = false;
+
+	return 0;
+}
+
+/**
+ * Program part of the RAM copy and read it back to confirm the flash holds the expected data.
+ */
+static int pfr_ufm_cache_program(struct pfr_ufm_cache *cache, uint32_t offset, uint32_t length)
+{
+	uint8_t verify[PFR_UFM_CACHE_VERIFY_CHUNK];
+	uint32_t chunk;
+	int status;
+
+	if (length != 0) {
+		status = cache->flash->write(cache->flash, cache->base_addr + offset,
+			&cache->data[offset], length);
+		if (ROT_IS_ERROR(status))
+			return status;
+		if ((uint32_t) status != length)
+			return PFR_UFM_CACHE_VERIFY_FAILED;
+	}
+
+	while (length) {
+		chunk = (length < sizeof(verify)) ? length : sizeof(verify);
+
+		status = cache->flash->read(cache->flash, cache->base_addr + offset, verify, chunk);
+		if (status != 0)
+			return status;
+
+		if (memcmp(verify, &cache->data[offset], chunk) != 0)
+			return PFR_UFM_CACHE_VERIFY_FAILED;
+
+		offset += chunk;
+		length -= chunk;
+	}
+
+	return 0;
+}
+
+/**
+ * Write pending changes to flash and verify them.
+ *
+ * Changes that only clear bits are programmed in place.  Otherwise, or if the in place update does
+ * not verify, the sector is erased once and the used part of the RAM copy is programmed and read
+ * back.  The cache stays dirty if the flush fails so a later flush can retry.
+ *
+ * @param cache The cache to flush.
+ *
+ * @return 0 if the flash matches the cache or an error code.
+ */
+int pfr_ufm_cache_flush(struct pfr_ufm_cache *cache)
+{
+	uint32_t used;
+	int status;
+
+	if (cache == NULL)
+		return PFR_UFM_CACHE_INVALID_ARGUMENT;
+
+	if (!cache->dirty)
+		return 0;
+
+	if (!cache->needs_erase) {
+		status = pfr_ufm_cache_program(cache, cache->dirty_start,
+			cache->dirty_end - cache->dirty_start);
+		if (status == 0)
+			goto done;
+	}
+
+	// Once the sector is erased only a full rewrite can bring it back in sync
+	cache->needs_erase = true;
+
+	status = cache->flash->sector_erase(cache->flash, cache->base_addr);
+	if (status != 0)
+		return status;
+
+	// Erased bytes at the end of the sector don't need programming
+	used = PFR_UFM_CACHE_SIZE;
+	while ((used != 0) && (cache->data[used - 1] == 0xff))
+		used--;
+
+	status = pfr_ufm_cache_program(cache, 0, used);
+	if (status != 0)
+		return status;
+
+done:
+	cache->dirty = false;
+	cache->needs_erase = false;
+
+	return 0;
+}
+
+/**
+ * Update provisioning data and program only that range to flash, in place.  Other changes pending
+ * in the cache stay pending and the sector is never erased, so the data may only clear bits.
+ *
+ * A range that overlaps changes still pending in the cache is not written, since the flash no
+ * longer holds what the cache compares against.
+ *
+ * If the flash does not hold the expected data afterwards, the range is left pending and the next
+ * flush rewrites the sector.
+ *
+ * @param cache The cache to update.
+ * @param offset The offset within the provisioning sector.
+ * @param data The new data.
+ * @param length The number of bytes to write.
+ *
+ * @return 0 if the flash holds the data, PFR_UFM_CACHE_NEEDS_ERASE if the data sets bits or overlaps
+ * pending changes, or an error code.
+ */
+int pfr_ufm_cache_write_through(struct pfr_ufm_cache *cache, uint32_t offset, const uint8_t *data,
+		uint32_t length)
+{
+	uint32_t i;
+	int status;
+
+	if ((cache == NULL) || (data == NULL))
+		return PFR_UFM_CACHE_INVALID_ARGUMENT;
+
+	status = pfr_ufm_cache_check_range(cache, offset, length);
+	if (status != 0)
+		return status;
+
+	if (cache->dirty && (offset < cache->dirty_end) && ((offset + length) > cache->dirty_start))
+		return PFR_UFM_CACHE_NEEDS_ERASE;
+
+	for (i = 0; i < length; i++) {
+		if (data[i] & ~cache->data[offset + i])
+			return PFR_UFM_CACHE_NEEDS_ERASE;
+	}
+
+	memcpy(&cache->data[offset], data, length);
+
+	status = pfr_ufm_cache_program(cache, offset, length);
+	if (status != 0) {
+		// The flash state of the range is unknown, only a full rewrite can fix it
+		if (!cache->dirty) {
+			cache->dirty = true;
+			cache->dirty_start = offset;
+			cache->dirty_end = offset + length;
+		} else {
+			if (offset < cache->dirty_start)
+				cache->dirty_start = offset;
+			if ((offset + length) > cache->dirty_end)
+				cache->dirty_end = offset + length;
+		}
+		cache->needs_erase = true;
+	}
+
+	return status;
+}
+
+/**
+ * Check if the cache holds changes that have not been flushed.
+ *
+ * @param cache The cache to query.
+ *
+ * @return true if a flush is pending.
+ */
+bool pfr_ufm_cache_is_dirty(struct pfr_ufm_cache *cache)
+{
+	return (cache != NULL) && cache->dirty;
+}
@@ -0,0 +1,55 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_UFM_CACHE_H
+#define PFR_UFM_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "flash/flash.h"
+
+/* The provisioning data occupies a single 4kB erase sector. */
+#define PFR_UFM_CACHE_SIZE				(4 * 1024)
+#define PFR_UFM_CACHE_VERIFY_CHUNK		256
+
+/* Status codes returned in addition to the flash errors. */
+#define PFR_UFM_CACHE_INVALID_ARGUMENT	-1	// Null cache or buffer
+#define PFR_UFM_CACHE_OUT_OF_RANGE		-2	// Access crosses the end of the sector
+#define PFR_UFM_CACHE_VERIFY_FAILED		-3	// Flash contents do not match after a flush
+#define PFR_UFM_CACHE_NEEDS_ERASE		-4	// A write through would set bits on flash
+
+/**
+ * Write-back RAM copy of the UFM provisioning sector.  The sector is read once on first use, reads
+ * are served from RAM and writes only touch flash when the cache is flushed.
+ */
+struct pfr_ufm_cache {
+	struct flash *flash;				/**< Flash that holds the provisioning sector. */
+	uint32_t base_addr;					/**< Start of the sector on the flash. */
+	bool loaded;						/**< The RAM copy holds the sector contents. */
+	bool dirty;							/**< The RAM copy has changes not yet on flash. */
+	bool needs_erase;					/**< A pending change sets bits and needs an erase. */
+	uint32_t dirty_start;				/**< First changed offset. */
+	uint32_t dirty_end;					/**< End of the changed offsets. */
+	uint8_t data[PFR_UFM_CACHE_SIZE];	/**< RAM copy of the sector. */
+};
+
+int pfr_ufm_cache_init(struct pfr_ufm_cache *cache, struct flash *flash, uint32_t base_addr);
+void pfr_ufm_cache_invalidate(struct pfr_ufm_cache *cache);
+
+int pfr_ufm_cache_read(struct pfr_ufm_cache *cache, uint32_t offset, uint8_t *data,
+		uint32_t length);
+int pfr_ufm_cache_write(struct pfr_ufm_cache *cache, uint32_t offset, const uint8_t *data,
+		uint32_t length);
+int pfr_ufm_cache_erase(struct pfr_ufm_cache *cache);
+int pfr_ufm_cache_flush(struct pfr_ufm_cache *cache);
+int pfr_ufm_cache_write_through(struct pfr_ufm_cache *cache, uint32_t offset, const uint8_t *data,
+		uint32_t length);
+
+bool pfr_ufm_cache_is_dirty(struct pfr_ufm_cache *cache);
+
+#endif /*PFR_UFM_CACHE_H*/
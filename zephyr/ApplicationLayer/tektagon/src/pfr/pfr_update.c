@@ -22,9 +22,11 @@
 #include "cerberus/cerberus_pfr_provision.h"
 #endif
 
+#include "pfr_printk.h"
+
 #undef DEBUG_PRINTF
 #if PF_UPDATE_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_UPDATE, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
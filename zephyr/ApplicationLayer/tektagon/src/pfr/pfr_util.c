@@ -6,21 +6,21 @@
 //*                                                                     *//
 //***********************************************************************//
 
-#if !defined(MBEDTLS_CONFIG_FILE)
-#include "mbedtls/config.h"
-#else
-#include MBEDTLS_CONFIG_FILE
-#endif
-
 //#include "pfr_util.h"
 #include "CommonFlash/CommonFlash.h"
 #include "flash/flash_util.h"
+#include "flash/flash_aspeed.h"
 #include "state_machine/common_smc.h"
 #include "pfr_common.h"
 #include <sys/reboot.h>
 #include <crypto/ecdsa_structs.h>
 #include <crypto/ecdsa.h>
-#include "mbedtls/ecdsa.h"
+#include <crypto/ecdsa_aspeed.h>
+#include "pfr_ecdsa.h"
+#include "pfr_hash.h"
+#include "pfr_ufm.h"
+#include "pfr_spi_copy.h"
+#include "pfr_log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -34,7 +34,7 @@
 
 #undef DEBUG_PRINTF
 #if 1
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_UTIL, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -44,7 +44,14 @@ int pfr_spi_read(unsigned int device_id, unsigned int address, unsigned int data
 	int status = 0;
 	struct SpiEngine *spi_flash = getSpiEngineWrapper();
 	spi_flash->spi.device_id[0] = device_id; // assign the flash device id,  0:spi1_cs0, 1:spi2_cs0 , 2:spi2_cs1, 3:spi2_cs2, 4:fmc_cs0, 5:fmc_cs1
-	spi_flash->spi.base.read(&spi_flash->spi,address,data,data_length);
+
+	// Read straight into the caller buffer, bypassing the flash wrapper hop
+	status = SPI_Flash_Read(device_id, address, data, data_length);
+	if (status) {
+		DEBUG_PRINTF("SPI read failed: device %d address %x status %d\r\n", device_id, address, status);
+		return Failure;
+	}
+
 	return Success;
 }
 
@@ -65,6 +72,46 @@ int pfr_spi_erase_4k(unsigned int device_id, unsigned int address){
 	return Success;
 }
 
+int pfr_spi_erase_64k(unsigned int device_id, unsigned int address)
+{
+	int status = 0;
+	struct SpiEngine *spi_flash = getSpiEngineWrapper();
+	spi_flash->spi.device_id[0] = device_id;
+	status = spi_flash->spi.base.block_erase(&spi_flash->spi.base, address);
+	if (status) {
+		DEBUG_PRINTF("SPI block erase failed: device %d address %x status %d\r\n", device_id, address, status);
+		return Failure;
+	}
+
+	return Success;
+}
+
+/**
+ * Erase a region of one flash device.  Aligned 32kB and 64kB blocks, or the whole device, are
+ * erased with a single command and only the edges of the region a sector at a time.
+ *
+ * @param device_id The flash device to erase.
+ * @param address Start of the region, sector aligned.
+ * @param length Number of bytes to erase, a multiple of PAGE_SIZE.
+ *
+ * @return Success or Failure.
+ */
+int pfr_spi_erase_region(unsigned int device_id, uint32_t address, uint32_t length)
+{
+	int status;
+	struct SpiEngine *spi_flash = getSpiEngineWrapper();
+
+	spi_flash->spi.device_id[0] = device_id;
+	status = SpiFlashEraseRegion(&spi_flash->spi, address, length);
+	if (status) {
+		DEBUG_PRINTF("SPI region erase failed: device %d address %x length %x status %x\r\n",
+			device_id, address, length, status);
+		return Failure;
+	}
+
+	return Success;
+}
+
 int pfr_spi_page_read_write(unsigned int device_id, uint32_t *source_address,uint32_t *target_address)
 {
 	int status = 0;
@@ -113,19 +160,121 @@ int pfr_spi_page_read_write_between_spi(int source_flash, uint32_t *source_addre
 	return Success;
 }
 
-// calculates sha for dataBuffer
-int get_buffer_hash(struct pfr_manifest *manifest, uint8_t *data_buffer, uint8_t length, unsigned char *hash_out) {
+/**
+ * Data in flight during a copy.  It is word aligned so flash reads go straight to it by DMA.
+ * Copies only run from the state machine thread, so a single buffer is enough.
+ */
+#define SPI_COPY_BUFFER_SIZE	0x8000
+
+static uint8_t spi_copy_buffer[SPI_COPY_BUFFER_SIZE] __aligned(4);
 
+/**
+ * Flash API over one device of the SPI engine.
+ */
+struct spi_copy_device {
+	struct flash base;
+	unsigned int device_id;
+};
+
+static int spi_copy_device_read(struct flash *flash, uint32_t address, uint8_t *data, size_t length)
+{
+	struct spi_copy_device *device = (struct spi_copy_device *)flash;
+
+	return SPI_Flash_Read(device->device_id, address, data, length);
+}
+
+static int spi_copy_device_write(struct flash *flash, uint32_t address, const uint8_t *data,
+		size_t length)
+{
+	struct spi_copy_device *device = (struct spi_copy_device *)flash;
 	struct SpiEngine *spi_flash = getSpiEngineWrapper();
-	
+
+	spi_flash->spi.device_id[0] = device->device_id;
+	return spi_flash->spi.base.write(&spi_flash->spi.base, address, data, length);
+}
+
+static int spi_copy_device_sector_erase(struct flash *flash, uint32_t sector_addr)
+{
+	struct spi_copy_device *device = (struct spi_copy_device *)flash;
+	struct SpiEngine *spi_flash = getSpiEngineWrapper();
+
+	spi_flash->spi.device_id[0] = device->device_id;
+	return spi_flash->spi.base.sector_erase(&spi_flash->spi.base, sector_addr);
+}
+
+static int spi_copy_device_block_erase(struct flash *flash, uint32_t block_addr)
+{
+	struct spi_copy_device *device = (struct spi_copy_device *)flash;
+	struct SpiEngine *spi_flash = getSpiEngineWrapper();
+
+	spi_flash->spi.device_id[0] = device->device_id;
+	return spi_flash->spi.base.block_erase(&spi_flash->spi.base, block_addr);
+}
+
+static void spi_copy_device_init(struct spi_copy_device *device, unsigned int device_id)
+{
+	memset(device, 0, sizeof(*device));
+	device->base.read = spi_copy_device_read;
+	device->base.write = spi_copy_device_write;
+	device->base.sector_erase = spi_copy_device_sector_erase;
+	device->base.block_erase = spi_copy_device_block_erase;
+	device->device_id = device_id;
+}
+
+/**
+ * Replace a region of one flash device with data from another, or from elsewhere on the same
+ * device.  The destination is erased as the copy goes, so callers must not erase it first.
+ *
+ * @param source_flash Device to copy from.
+ * @param source_address Start of the data to copy.
+ * @param target_flash Device to copy to.
+ * @param target_address Start of the destination, sector aligned.
+ * @param length Number of bytes to copy, a multiple of PAGE_SIZE.
+ *
+ * @return Success or Failure.
+ */
+int pfr_spi_copy_between_spi(int source_flash, uint32_t source_address, int target_flash,
+		uint32_t target_address, uint32_t length)
+{
+	struct spi_copy_device source;
+	struct spi_copy_device target;
+	uint32_t erase_sizes = PFR_SPI_COPY_ERASE_4K | PFR_SPI_COPY_ERASE_64K;
+	int status;
+
+	spi_copy_device_init(&source, source_flash);
+	spi_copy_device_init(&target, target_flash);
+
+	status = pfr_spi_copy(&source.base, source_address, &target.base, target_address, length,
+		erase_sizes, spi_copy_buffer, sizeof(spi_copy_buffer));
+	if (status) {
+		DEBUG_PRINTF("SPI copy failed: device %d address %x to device %d address %x status %x\r\n",
+			source_flash, source_address, target_flash, target_address, status);
+		return Failure;
+	}
+
+	return Success;
+}
+
+// calculates sha for dataBuffer
+int get_buffer_hash(struct pfr_manifest *manifest, uint8_t *data_buffer, uint32_t length, unsigned char *hash_out) {
+	int status = 0;
+	enum hash_type type;
+
 	if(manifest->hash_curve == secp256r1) {
-		manifest->hash->start_sha256(manifest->hash); 
-		manifest->hash->calculate_sha256 (manifest->hash,data_buffer, length, hash_out, SHA256_HASH_LENGTH);
+		type = HASH_TYPE_SHA256;
 	}else if(manifest->hash_curve == secp384r1) {
+		type = HASH_TYPE_SHA384;
 	}else{
 		return Failure;
 	}
 
+	status = pfr_hash_buffer(manifest->hash, type, data_buffer, length, hash_out,
+			pfr_hash_digest_length(type));
+	if (status != 0) {
+		DEBUG_PRINTF("Buffer hash failed: %x\r\n", status);
+		return Failure;
+	}
+
 	return Success;
 }
 
@@ -142,12 +291,18 @@ int get_hash(struct manifest *manifest, struct hash_engine *hash_engine, uint8_t
 
 	struct pfr_manifest *pfr_manifest = (struct pfr_manifest *)manifest;
 	
-	if(pfr_manifest == NULL || hash_engine == NULL ||
-		hash_out == NULL || hash_length < SHA256_HASH_LENGTH ||
-		(hash_length > SHA256_HASH_LENGTH && hash_length < SHA384_HASH_LENGTH))
+	if(pfr_manifest == NULL)
 		return Failure;
-	flash_hash_contents(pfr_manifest->flash, pfr_manifest->pfr_hash->start_address, pfr_manifest->pfr_hash->length, pfr_manifest->hash, pfr_manifest->pfr_hash->type, hash_out, hash_length);
-	
+
+	// Overlap SPI reads with HACE digests while hashing the region
+	status = pfr_hash_region(pfr_manifest->flash, hash_engine, pfr_manifest->pfr_hash->type,
+			pfr_manifest->pfr_hash->start_address, pfr_manifest->pfr_hash->length, hash_out,
+			hash_length);
+	if (status != 0) {
+		DEBUG_PRINTF("Flash hash failed: %x\r\n", status);
+		return Failure;
+	}
+
 	return Success;
 }
 
@@ -183,50 +338,45 @@ void reverse_byte_array(uint8_t *data_buffer, uint32_t length){
 	}
 }
 
-static int mbedtls_ecdsa_verify_middlelayer(struct pfr_pubkey *pubkey,
-				const uint8_t *digest, uint8_t *signature_r,
-				uint8_t *signature_s)
+#ifdef CONFIG_ECDSA_ASPEED
+/**
+ * ECDSA verification on the AST1060 crypto engine.  The engine only implements P-384, so
+ * P-256 requests never reach it and are serviced by mbedtls instead.
+ */
+static int pfr_ecdsa_aspeed_verify(const struct pfr_ecdsa_backend *backend,
+		enum pfr_ecdsa_curve curve, const uint8_t *x, const uint8_t *y, const uint8_t *digest,
+		const uint8_t *r, const uint8_t *s)
 {
-	mbedtls_ecdsa_context ctx_verify;
-	mbedtls_mpi r, s;
-	unsigned char hash[SHA256_HASH_LENGTH];
-	int ret = 0;
-	char z = 1;
-
-	mbedtls_ecdsa_init(&ctx_verify);
-	mbedtls_mpi_init(&r);
-	mbedtls_mpi_init(&s);
-
-	// print_buffer("ECDSA X: ", pubkey->x, pubkey->length);
-	// print_buffer("ECDSA Y: ", pubkey->y, pubkey->length);
-	// print_buffer("ECDSA R: ", signature_r, pubkey->length);
-	// print_buffer("ECDSA S: ", signature_s, pubkey->length);
-	// print_buffer("ECDSA D: ", digest, pubkey->length);
+	int status;
 
-	mbedtls_mpi_read_binary(&ctx_verify.Q.X, pubkey->x, pubkey->length/*SHA256_HASH_LENGTH*/);
+	if (curve != PFR_ECDSA_CURVE_P384)
+		return PFR_ECDSA_BACKEND_UNAVAILABLE;
 
-	mbedtls_mpi_read_binary(&ctx_verify.Q.Y, pubkey->y, pubkey->length/*SHA256_HASH_LENGTH*/);
-
-	mbedtls_mpi_read_binary(&ctx_verify.Q.Z, &z, 1);
-
-	mbedtls_mpi_read_binary(&r, signature_r, pubkey->length /*SHA256_HASH_LENGTH*/);
-
-	mbedtls_mpi_read_binary(&s, signature_s, pubkey->length /*SHA256_HASH_LENGTH*/);
-
-	mbedtls_ecp_group_load(&ctx_verify.grp, MBEDTLS_ECP_DP_SECP256R1);
-	memcpy(hash, digest, pubkey->length /*SHA256_HASH_LENGTH*/);
-	ret = mbedtls_ecdsa_verify(&ctx_verify.grp, hash, SHA256_HASH_LENGTH,
-							   &ctx_verify.Q, &r, &s);
+	status = aspeed_ecdsa_verify_middlelayer(ECC_CURVE_NIST_P384, PFR_ECDSA_P384_LENGTH,
+			(uint8_t *)x, (uint8_t *)y, digest, (uint8_t *)r, (uint8_t *)s);
+	if ((status == -ENODEV) || (status == -EBUSY) || (status == -EINVAL)) {
+		// Engine missing, in use or rejecting the request, let the next backend handle it
+		return PFR_ECDSA_BACKEND_UNAVAILABLE;
+	}
 
-	mbedtls_ecdsa_free(&ctx_verify);
-	mbedtls_mpi_free(&r);
-	mbedtls_mpi_free(&s);
-	
-	// printk("ECDSA:%d\r\n", ret);
+	return (status == 0) ? 0 : PFR_ECDSA_VERIFY_FAILED;
+}
 
-	return ret;
+static const struct pfr_ecdsa_backend pfr_ecdsa_aspeed_backend = {
+	.name = "aspeed",
+	.curves = PFR_ECDSA_CURVE_MASK(PFR_ECDSA_CURVE_P384),
+	.verify = pfr_ecdsa_aspeed_verify,
+	.context = NULL,
+};
+#endif
 
-}
+// ECDSA backends in priority order, hardware first with mbedtls as the fallback
+static const struct pfr_ecdsa_backend *const pfr_ecdsa_backends[] = {
+#ifdef CONFIG_ECDSA_ASPEED
+	&pfr_ecdsa_aspeed_backend,
+#endif
+	&pfr_ecdsa_mbedtls_backend,
+};
 
 /**
  * Verify that a calculated digest matches a signature.
@@ -244,17 +394,27 @@ int verify_signature(struct signature_verification *verification, const uint8_t
 	int status = Success;
 
 	struct pfr_manifest *manifest = (struct pfr_manifest *)verification;
-	// uint8_t signature_r[SHA256_HASH_LENGTH];
-	// uint8_t signature_s[SHA256_HASH_LENGTH];
-	// memcpy(&signature_r[0],&signature[0],length);
-	// memcpy(&signature_s[0],&signature[length],length);
+	struct pfr_pubkey *pubkey = manifest->verification->pubkey;
+	enum pfr_ecdsa_curve curve;
+
+	if(manifest->hash_curve == secp256r1)
+		curve = PFR_ECDSA_CURVE_P256;
+	else if(manifest->hash_curve == secp384r1)
+		curve = PFR_ECDSA_CURVE_P384;
+	else
+		return Failure;
+
+	if(length != pfr_ecdsa_curve_length(curve))
+		return Failure;
 
-	status =  mbedtls_ecdsa_verify_middlelayer(manifest->verification->pubkey,
-														digest,
-														manifest->verification->pubkey->signature_r,
-														manifest->verification->pubkey->signature_s);
+	status = pfr_ecdsa_verify(pfr_ecdsa_backends, ARRAY_SIZE(pfr_ecdsa_backends), curve,
+			pubkey->x, pubkey->y, digest, pubkey->signature_r, pubkey->signature_s);
+	if(status != 0){
+		DEBUG_PRINTF("ECDSA verification failed: %d\r\n", status);
+		return Failure;
+	}
 
-	return status;
+	return Success;
 }
 
 
@@ -262,6 +422,10 @@ int pfr_cpld_update_reboot (void)
 {
 	DEBUG_PRINTF("system going reboot ...\n");
 
+	// Don't lose buffered provisioning data or log entries across the reset
+	ufm_flush(PROVISION_UFM);
+	pfr_log_drain();
+
 #if (CONFIG_KERNEL_SHELL_REBOOT_DELAY > 0)
 	k_sleep(K_MSEC(CONFIG_KERNEL_SHELL_REBOOT_DELAY));
 #endif
@@ -19,12 +19,19 @@ int pfr_spi_write(unsigned int device_id,unsigned int address,
 
 int pfr_spi_page_read_write(unsigned int device_id, uint32_t *source_address,uint32_t *target_address);
 
+int pfr_spi_copy_between_spi(int source_flash, uint32_t source_address, int target_flash,
+						uint32_t target_address, uint32_t length);
+
 int pfr_spi_erase_4k(unsigned int device_id,unsigned int address);
 
+int pfr_spi_erase_64k(unsigned int device_id, unsigned int address);
+
+int pfr_spi_erase_region(unsigned int device_id, uint32_t address, uint32_t length);
+
 int esb_ecdsa_verify(struct pfr_manifest *manifest, unsigned int digest[], unsigned char pub_key[], 
 							unsigned char signature[], unsigned char *auth_pass);
 
-int get_buffer_hash(struct pfr_manifest *manifest,uint8_t *data_buffer, uint8_t length, unsigned char *hash_out);
+int get_buffer_hash(struct pfr_manifest *manifest,uint8_t *data_buffer, uint32_t length, unsigned char *hash_out);
 
 int get_hash(struct manifest *manifest, struct hash_engine *hash_engine, uint8_t *hash_out,
 	size_t hash_length);
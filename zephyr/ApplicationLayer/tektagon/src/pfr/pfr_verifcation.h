@@ -9,10 +9,13 @@
 #ifndef PFR_VERIFICATION_H
 #define PFR_VERIFICATION_H
 
+#include "pfr/pfr_common.h"
+
 // Add Active and Recovery verifcation
 // Read address from UFM for active
 // Set AoData
 int authentication_image(void *AoData, void *EventContext);
+int authentication_pfr_image(struct pfr_manifest *pfr_manifest, uint32_t image_type, int operation);
 
 // -- Active Region
 int ActivePfmVerification(unsigned int ImageType,unsigned int ReadAddress);
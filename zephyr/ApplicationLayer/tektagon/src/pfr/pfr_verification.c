@@ -25,40 +25,56 @@
 #endif
 
 
+#include "pfr_printk.h"
+
 #undef DEBUG_PRINTF
 #if PFR_AUTHENTICATION_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_AUTHENTICATION, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
 
+/**
+    Function to verify one region of an image using the given PFR context
+
+    @Param struct pfr_manifest *	PFR context used for the verification
+    @Param uint32_t		Image type, BMC_TYPE or PCH_TYPE
+    @Param int			VERIFY_ACTIVE or VERIFY_BACKUP
+
+    @retval int		Return Status
+**/
+int authentication_pfr_image(struct pfr_manifest *pfr_manifest, uint32_t image_type, int operation){
+
+    int status = 0;
+
+    pfr_manifest->state = VERIFY;
+    pfr_manifest->image_type = image_type;
+
+    if(operation == VERIFY_BACKUP){  
+        status = pfr_manifest->recovery_base->verify(pfr_manifest, pfr_manifest->hash, pfr_manifest->verification->base, pfr_manifest->pfr_hash->hash_out, pfr_manifest->pfr_hash->length, pfr_manifest->recovery_pfm);
+    }else if(operation == VERIFY_ACTIVE){
+        status = pfr_manifest->active_image_base->verify(pfr_manifest);
+    }
+    
+    return status;
+}
+
 int authentication_image(void *AoData, void *EventContext){
     
-    int status = 0;
-    AO_DATA *ActiveObjectData = (AO_DATA *) AoData;
 	EVENT_CONTEXT *EventData = (EVENT_CONTEXT *) EventContext;
+    uint32_t image_type;
 
     // init_pfr_manifest();
-	struct pfr_manifest *pfr_manifest = get_pfr_manifest();
-	
-    pfr_manifest->state = VERIFY;
-
     if(EventData->image == BMC_EVENT){
         //BMC SPI
         DEBUG_PRINTF("Image Type: BMC \r\n");
-        pfr_manifest->image_type = BMC_TYPE;
+        image_type = BMC_TYPE;
 
     }else{
         //PCH SPI
         DEBUG_PRINTF("Image Type: PCH \r\n");
-        pfr_manifest->image_type = PCH_TYPE;
+        image_type = PCH_TYPE;
     }
     
-    if(EventData->operation == VERIFY_BACKUP){  
-        status = pfr_manifest->recovery_base->verify(pfr_manifest, pfr_manifest->hash, pfr_manifest->verification->base, pfr_manifest->pfr_hash->hash_out, pfr_manifest->pfr_hash->length, pfr_manifest->recovery_pfm);
-    }else if(EventData->operation == VERIFY_ACTIVE){
-        status = pfr_manifest->active_image_base->verify(pfr_manifest);
-    }
-    
-    return status;
+    return authentication_pfr_image(get_pfr_manifest(), image_type, EventData->operation);
 }
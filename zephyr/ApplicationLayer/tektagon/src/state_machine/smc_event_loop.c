@@ -0,0 +1,59 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include "smc_event_loop.h"
+
+/**
+ * Indicate the state machine has moved to a new state that needs to be run.  This is called when
+ * an event is dispatched or when a state handler selects the next state directly.
+ *
+ * @param loop The event loop.
+ */
+void smc_event_loop_transition(struct smc_event_loop *loop)
+{
+	if (loop)
+		loop->transition_pending = true;
+}
+
+/**
+ * Run the state machine until it terminates.  While a transition is pending the new state is run
+ * straight away.  Otherwise the loop blocks until the next event is posted, so an event is handled
+ * with no polling delay and a state is never run again without a new event.
+ *
+ * @param loop The event loop.
+ *
+ * @return The non-zero value that stopped the loop, or -1 for a null loop.
+ */
+int smc_event_loop_run(struct smc_event_loop *loop)
+{
+	void *event;
+	int status;
+
+	if ((loop == NULL) || (loop->wait_event == NULL) || (loop->dispatch == NULL) ||
+		(loop->run_state == NULL))
+		return -1;
+
+	do {
+		// Sleep until an event selects the next state to run
+		while (!loop->transition_pending) {
+			status = loop->wait_event(loop, &event);
+			if (status != 0)
+				return status;
+
+			loop->dispatch(loop, event);
+		}
+
+		loop->transition_pending = false;
+
+		// State machine terminates if a non-zero value is returned
+		status = loop->run_state(loop);
+	} while (status == 0);
+
+	return status;
+}
@@ -0,0 +1,54 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef SMC_EVENT_LOOP_H
+#define SMC_EVENT_LOOP_H
+
+#include <stdbool.h>
+
+/**
+ * Event driven dispatcher for the HRoT state machine.  The loop sleeps on the event queue and only
+ * runs the state machine when an event selects a new state, so queued events are handled as soon
+ * as they are posted and nothing runs while the system is idle.
+ */
+struct smc_event_loop {
+	/**
+	 * Wait for the next event to be posted.
+	 *
+	 * @param loop The event loop.
+	 * @param event Output for the event.
+	 *
+	 * @return 0 if an event was received or an error code to stop the loop.
+	 */
+	int (*wait_event)(struct smc_event_loop *loop, void **event);
+
+	/**
+	 * Handle an event.  Events that select a state call smc_event_loop_transition().
+	 *
+	 * @param loop The event loop.
+	 * @param event The event to handle.  The handler owns the event.
+	 */
+	void (*dispatch)(struct smc_event_loop *loop, void *event);
+
+	/**
+	 * Run one iteration of the state machine.
+	 *
+	 * @param loop The event loop.
+	 *
+	 * @return 0 to keep running or a non-zero value to stop the loop.
+	 */
+	int (*run_state)(struct smc_event_loop *loop);
+
+	void *context;						/**< Context for the handlers. */
+	bool transition_pending;			/**< A new state is waiting to be run. */
+};
+
+void smc_event_loop_transition(struct smc_event_loop *loop);
+int smc_event_loop_run(struct smc_event_loop *loop);
+
+#endif /*SMC_EVENT_LOOP_H*/
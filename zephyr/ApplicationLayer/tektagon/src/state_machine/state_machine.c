@@ -10,6 +10,7 @@
 #include <smf.h>
 
 #include "state_machine.h"
+#include "smc_event_loop.h"
 #include "StateMachineAction/StateMachineActions.h"
 #include "include/SmbusMailBoxCom.h"
 #include "Smbus_mailbox/Smbus_mailbox.h"
@@ -21,10 +22,29 @@ K_FIFO_DEFINE(evt_q);
 static const struct smf_state hrot_states[];
 static struct hrot_smc_context context = { 0 };
 
-int StartHrotStateMachine(void)
+static void dispatch_smc_event(struct smc_event_loop *loop, void *event);
+
+static int wait_smc_event(struct smc_event_loop *loop, void **event)
 {
-	int32_t ret = 0;
+	*event = k_fifo_get(&evt_q, K_FOREVER);
+
+	return (*event == NULL) ? EAGAIN : 0;
+}
+
+static int run_smc_state(struct smc_event_loop *loop)
+{
+	return smf_run_state(SMF_CTX(loop->context));
+}
+
+static struct smc_event_loop event_loop = {
+	.wait_event = wait_smc_event,
+	.dispatch = dispatch_smc_event,
+	.run_state = run_smc_state,
+	.context = &context,
+};
 
+int StartHrotStateMachine(void)
+{
 	smf_set_initial(SMF_CTX(&context), &hrot_states[IDLE]);
 	struct _smc_fifo_event *initial_event = (struct _smc_fifo_event *)k_malloc(sizeof(struct _smc_fifo_event));
 	if (initial_event == NULL) {
@@ -36,62 +56,52 @@ int StartHrotStateMachine(void)
 	initial_event->new_sm_static_data = NULL;
 	k_fifo_put(&evt_q, initial_event);
 
-	/* Run the state machine */
-	do {
+	/* Run the state machine, blocking on the event queue while idle */
+	return smc_event_loop_run(&event_loop);
+}
+
+static void dispatch_smc_event(struct smc_event_loop *loop, void *event)
+{
+	struct _smc_fifo_event *hrot_event = (struct _smc_fifo_event *)event;
+	struct hrot_smc_context *sm_context = (struct hrot_smc_context *)loop->context;
 
-		/* State machine terminates if a non-zero value is returned */
-		ret = smf_run_state(SMF_CTX(&context));
-		if (ret) {
-			/* handle return code and terminate state machine */
-			break;
-		}
-		k_msleep(10);
-	} while (true);
+	/* Lockdown is a root state, no further events are handled once it is entered */
+	if (SMF_CTX(sm_context)->current == &hrot_states[LOCKDOWN]) {
+		k_free(hrot_event);
+		return;
+	}
 
-	if (initial_event) {
-		k_free(initial_event);
+	sm_context->sm_static_data = hrot_event->new_sm_static_data;
+	sm_context->event_ctx = hrot_event->new_event_ctx;
+
+	switch (hrot_event->new_event_state) {
+	case INITIALIZE:
+		PublishInitialEvents();
+		break;
+	case VERIFY:
+	case RECOVERY:
+	case UPDATE:
+	case I2C:
+	case LOCKDOWN:
+		smf_set_state(SMF_CTX(sm_context), &hrot_states[hrot_event->new_event_state]);
+		smc_event_loop_transition(loop);
+		break;
+	default:
+		break;
 	}
 
-	return ret;
+	k_free(hrot_event);
 }
 
 static void run_idle(void *context)
 {
 	// printk("Executing run_idle\r\n");
 
-	if (!k_fifo_is_empty(&evt_q)) {
-		int new_state = 0;
-		struct _smc_fifo_event *hrot_event = k_fifo_get(&evt_q, K_NO_WAIT);
-		struct hrot_smc_context *sm_context = (struct hrot_smc_context *)context;
-
-		sm_context->sm_static_data = hrot_event->new_sm_static_data;
-		sm_context->event_ctx = hrot_event->new_event_ctx;
-
-		switch (hrot_event->new_event_state) {
-		case INITIALIZE:
-			PublishInitialEvents();
-			break;
-		case VERIFY:
-			smf_set_state(SMF_CTX(sm_context), &hrot_states[VERIFY]);
-			break;
-		case RECOVERY:
-			smf_set_state(SMF_CTX(sm_context), &hrot_states[RECOVERY]);
-			break;
-		case UPDATE:
-			smf_set_state(SMF_CTX(sm_context), &hrot_states[UPDATE]);
-			break;
-		case I2C:
-			smf_set_state(SMF_CTX(sm_context), &hrot_states[I2C]);
-			break;
-		case LOCKDOWN:
-			smf_set_state(SMF_CTX(sm_context), &hrot_states[LOCKDOWN]);
-			break;
-		default:
-			break;
-		}
+	/* Pick up an event queued while the current state was running */
+	struct _smc_fifo_event *hrot_event = k_fifo_get(&evt_q, K_NO_WAIT);
 
-		k_free(hrot_event);
-		
+	if (hrot_event) {
+		dispatch_smc_event(&event_loop, hrot_event);
 	}
 }
 
@@ -305,6 +315,7 @@ int execute_next_smc_action(int new_state, void *static_data, void *event_ctx)
 	context.sm_static_data = static_data;
 
 	smf_set_state(SMF_CTX(&context), &hrot_states[new_state]);
+	smc_event_loop_transition(&event_loop);
 	return 0;
 }
 
@@ -11,9 +11,11 @@
 **/
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "AmiSmbusInterfaceSrcLib.h"
+#include "AmiSmbusLinkTiming.h"
 #include <openbmc/obmc-i2c.h>
 #include <openbmc/kv.h>
 
@@ -26,10 +28,15 @@ int SmbusWriteBlockExecute(
     int verbose) {
   int ret = -1;
   int retry_count = 5;
+  unsigned int delay = 1000;
   do {
     ret = i2c_smbus_write_block_data(fd, command, length, data);
     retry_count--;
-    MicroSecondDelay(100000, verbose);
+    if (ret && retry_count) {
+      // The peer is polled for its answer, so only a failed write waits
+      MicroSecondDelay(delay, verbose);
+      delay = (delay < 50000) ? (delay * 2) : 100000;
+    }
   } while (ret && retry_count);
 
   if (ret) {
@@ -40,11 +47,82 @@ int SmbusWriteBlockExecute(
 }
 
 
+typedef struct {
+  int fd;
+  unsigned char session_id;
+  unsigned char* buffer;
+  int first_packet;
+  int verbose;
+} LINK_LAYER_POLL_CONTEXT;
+
+static int DataLayerReceive(
+    unsigned char fru_id,
+    int fd,
+    unsigned char command,
+    unsigned char* DataLayerAckBuffer,
+    int verbose);
+
+/**
+  Poll for the link layer ack of the packet just sent
+
+  @param  IN void *context - LINK_LAYER_POLL_CONTEXT
+
+  @retval int AMI_SMBUS_POLL_DONE, AMI_SMBUS_POLL_AGAIN or AMI_SMBUS_POLL_FAIL
+
+**/
+static int PollLinkLayerAck(void* context) {
+  LINK_LAYER_POLL_CONTEXT* poll = (LINK_LAYER_POLL_CONTEXT*)context;
+  LINK_LAYER_PACKET_ACK_MASTER* ack = (LINK_LAYER_PACKET_ACK_MASTER*)poll->buffer;
+  int verbose = poll->verbose;
+
+  if (LinkLayerReceiveAcknowldgement(
+          poll->fd, poll->session_id, poll->buffer, poll->verbose)) {
+    return AMI_SMBUS_POLL_AGAIN;
+  }
+
+  if (ack->Length && ack->AckFlag == 1) { // ACK=0x1, NoACK=0x2
+    return AMI_SMBUS_POLL_DONE;
+  }
+
+  // An explicit NoACK asks for the packet again, so stop waiting for it
+  DEBUG("LinkLayer NAck, or content check fail \n");
+  return (ack->Length && ack->AckFlag == 2) ? AMI_SMBUS_POLL_FAIL
+                                            : AMI_SMBUS_POLL_AGAIN;
+}
+
+/**
+  Poll for the next packet of the data layer response
+
+  @param  IN void *context - LINK_LAYER_POLL_CONTEXT
+
+  @retval int AMI_SMBUS_POLL_DONE or AMI_SMBUS_POLL_AGAIN
+
+**/
+static int PollLinkLayerPacket(void* context) {
+  LINK_LAYER_POLL_CONTEXT* poll = (LINK_LAYER_POLL_CONTEXT*)context;
+  LINK_LAYER_PACKET_ACK_MASTER* packet = (LINK_LAYER_PACKET_ACK_MASTER*)poll->buffer;
+
+  if (LinkLayerReceiveAcknowldgement(
+          poll->fd, poll->session_id, poll->buffer, poll->verbose)) {
+    return AMI_SMBUS_POLL_AGAIN;
+  }
+
+  // Until the response is ready the peer can still return the ack of the
+  // last packet sent, which has no data layer header
+  if (poll->first_packet &&
+      ((packet->SubPackageIndex != 0) || (packet->PayLoad[0] < 4))) {
+    return AMI_SMBUS_POLL_AGAIN;
+  }
+
+  return AMI_SMBUS_POLL_DONE;
+}
 
 /**
   Sending data by splitting into Number of LinkLayer Packets
 
   @param  DataPacket
+  @param  linklayer_ack_delay - time allowed for each link layer ack in ms,
+          0 for the deadline of the command
 
   @param  int Status
 
@@ -66,7 +144,7 @@ int SendDataPacketThroughLinkLayer(
   int RemainLength = 0;
   int ThisPackageLength = 0;
   int package_retry_count = 0;
-  int ack_retry_count = 0;
+  LINK_LAYER_POLL_CONTEXT poll_context;
   int ret = 0;
   // This is datalayer session id will increment for every data layer
   // transaction
@@ -151,33 +229,26 @@ int SendDataPacketThroughLinkLayer(
       DEBUG("SendPacketThroughLinkLayer ret : %d\n", ret);
 
       if (ret == 0) {
-        ack_retry_count = 0;
         if (AckNeeded == 1) {
-          do {
-            MicroSecondDelay(linklayer_ack_delay * 1000, verbose);
-            DEBUG(
-                "Get command LinkLayer Ack %s \n",
-                (ack_retry_count ? "retry..." : ""));
-            ret = LinkLayerReceiveAcknowldgement(
-                fd, session_id, LinkLayerAckBuffer, verbose);
-            if (ret) {
-              DEBUG("LinkLayerReceiveAcknowldgement fail \n");
-              ack_retry_count++;
-              continue;
-            }
-
-            if (((LINK_LAYER_PACKET_ACK_MASTER*)LinkLayerAckBuffer)
-                    ->Length && // Length should be valid
-                ((LINK_LAYER_PACKET_ACK_MASTER*)LinkLayerAckBuffer)->AckFlag ==
-                    1) { // ACK=0x1, NoACK=0x2
-              ReSendNeeded = 0;
-              break;
-            } else {
-              DEBUG("LinkLayer NAck, or content check fail \n");
-            }
-
-            ack_retry_count++;
-          } while (ack_retry_count < 3);
+          DEBUG("Get command LinkLayer Ack \n");
+          poll_context.fd = fd;
+          poll_context.session_id = session_id;
+          poll_context.buffer = LinkLayerAckBuffer;
+          poll_context.first_packet = 0;
+          poll_context.verbose = verbose;
+          ret = AmiSmbusTimingPoll(
+              fru_id,
+              DataPacket[0],
+              AMI_SMBUS_WAIT_ACK,
+              linklayer_ack_delay * 1000,
+              PollLinkLayerAck,
+              &poll_context,
+              verbose);
+          if (ret == 0) {
+            ReSendNeeded = 0;
+          } else {
+            DEBUG("LinkLayer NAck, or no ack before the deadline \n");
+          }
           package_retry_count++;
 
         } else {
@@ -272,18 +343,6 @@ int SendPacketThroughLinkLayer(
   return ret;
 }
 
-static int
-get_linklayer_ack_delay(unsigned char command)
-{
-  //unit ms
-  switch (command) {
-    case CMD_DECOMMSION_REQUST:
-      return 2000; //ami request 2s
-    default:
-      return 100; //ami default 100ms
-  }
-}
-
 static unsigned char
 command_mapping_flag(unsigned char command) {
 	
@@ -307,40 +366,23 @@ datalayer_send_receive(unsigned char slot_id,
 {
 	int ret = -1;
   int retry = 3;
-  int delay = 0;
   
   do {
     ret = sent_data_packet(slot_id, fd, command, data_payload, data_payload_length, verbose);
     if (ret) {
       printf("sent_data_packet fail \n");
       retry--;
-      sleep(1);
+      AmiSmbusTimingDelay(1000 * 1000);
       continue;
     }
     
-    switch (command) {
-      case CMD_DECOMMSION_REQUST:
-        delay = 70; //ami request
-        break;
-        
-      case CMD_RECOMMISSION_REQUST:
-        delay = 15; //ami request 2022-01-11
-        break;
-        
-      default:
-        delay = 0;
-    }
-    
-    if (delay > 0) {
-      sleep(delay);
-      printf("sleep %ds \n", delay); 
-    }
-    
-    ret = DataLayerReceiveFromPlatFire(slot_id, fd, DataLayerAckBuffer, verbose);
+    // Slow commands such as decommission have a longer response deadline
+    // instead of a fixed sleep before the response is read
+    ret = DataLayerReceive(slot_id, fd, command, DataLayerAckBuffer, verbose);
     if (ret) {
       printf("DataLayerReceiveFromPlatFire fail \n");
       retry--;
-      sleep(1);
+      AmiSmbusTimingDelay(1000 * 1000);
       continue;
     }
     
@@ -363,7 +405,6 @@ sent_data_packet(unsigned char slot_id,
 {
   unsigned char data[DATA_LAYER_EXTEND_MAX_PACKET] = {0};
   int index = 0;
-  unsigned int linklayer_ack_delay = get_linklayer_ack_delay(command);
   
   if (data_payload_length > DATA_LAYER_EXTEND_MAX_PACKET) {
     printf("the data length > DATA_LAYER_EXTEND_MAX_PACKET(%d) \n", DATA_LAYER_EXTEND_MAX_PACKET);
@@ -413,7 +454,7 @@ sent_data_packet(unsigned char slot_id,
     DEBUG("\n");
   }
   
-	return SendDataPacketThroughLinkLayer(slot_id, fd, data, data_payload_length, linklayer_ack_delay, verbose);
+	return SendDataPacketThroughLinkLayer(slot_id, fd, data, data_payload_length, 0, verbose);
 }
 
 /**
@@ -430,6 +471,21 @@ int DataLayerReceiveFromPlatFire(
     int fd,
     unsigned char* DataLayerAckBuffer,
     int verbose) {
+  return DataLayerReceive(fru_id, fd, 0, DataLayerAckBuffer, verbose);
+}
+
+/**
+  Receive the data layer response to a command
+
+  @param  IN unsigned char command - command being answered, 0 if not known
+
+**/
+static int DataLayerReceive(
+    unsigned char fru_id,
+    int fd,
+    unsigned char command,
+    unsigned char* DataLayerAckBuffer,
+    int verbose) {
   DEBUG(
       "\n--------------------------DataLayerReceive--------------------------\n");
   unsigned char RecieveDataBuffer[512] = {0};
@@ -442,7 +498,8 @@ int DataLayerReceiveFromPlatFire(
   char value[128] = {0};
   unsigned char session_id = 0;
   unsigned char checksum = 0;
-  int retry = 0;
+  LINK_LAYER_POLL_CONTEXT poll_context;
+  int packets = 0;
 
   snprintf(key, sizeof(key), PROT_SESSION_KEY, fru_id);
   if (kv_get(key, value, NULL, 0)) {
@@ -456,22 +513,26 @@ int DataLayerReceiveFromPlatFire(
     kv_set(key, value, 0, 0);
   }
 
+  poll_context.fd = fd;
+  poll_context.session_id = session_id;
+  poll_context.buffer = RecieveBuffer;
+  poll_context.verbose = verbose;
+
   do {
-    MicroSecondDelay(
-        200 * 1000,
-        verbose); 
-    ret =
-        LinkLayerReceiveAcknowldgement(fd, session_id, RecieveBuffer, verbose);
+    // The first packet takes as long as the command, the others are ready
+    // as soon as the previous one is acknowledged
+    poll_context.first_packet = (packets++ == 0);
+    ret = AmiSmbusTimingPoll(
+        fru_id,
+        command,
+        poll_context.first_packet ? AMI_SMBUS_WAIT_RESPONSE : AMI_SMBUS_WAIT_ACK,
+        0,
+        PollLinkLayerPacket,
+        &poll_context,
+        verbose);
     if (ret) {
-      DEBUG("LinkLayerReceiveAcknowldgement fail \n");
-      if (retry < 5) {
-        retry++;
-        continue;
-      } else {
-        printf("get response fail after 5 retry \n");
-        return -1;
-      }
-
+      printf("get response fail before the deadline \n");
+      return -1;
     }
     DEBUG(
         "LinkLayerPkgBuffer->AckNeeded = %u...", LinkLayerPkgBuffer->AckNeeded);
@@ -673,7 +734,7 @@ unsigned char CalculateCheckSum(unsigned char* Buffer, int Length) {
 **/
 void MicroSecondDelay(int delay, int verbose) {
   DEBUG("sleep %d ms \n", delay / 1000);
-  usleep(delay);
+  AmiSmbusTimingDelay(delay);
 }
 
 
@@ -0,0 +1,383 @@
+//***********************************************************************
+//*                                                                     *
+//*                 Copyright (c) 1985-2022, AMI                        *
+//*                                                                     *
+//*      All rights reserved. Subject to AMI licensing agreement.       *
+//*                                                                     *
+//***********************************************************************
+/** @file AmiSmbusLinkTiming.c
+    Adaptive wait timing for the AmiSmbus link layer
+
+    Instead of sleeping a fixed time before reading an ack or a response, the
+    link layer polls the peer.  The first poll is made when the peer has
+    answered the same command before, and the following polls back off
+    exponentially until the deadline of the command.  The response time of
+    each command is learned per peer with the same smoothing TCP uses for its
+    round trip time.
+
+**/
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "AmiSmbusInterfaceSrcLib.h"
+#include "AmiSmbusLinkTiming.h"
+
+typedef struct {
+  int used;
+  unsigned char fru_id;
+  uint32_t last_use;
+  AMI_SMBUS_TIMING_ESTIMATE estimate[AMI_SMBUS_WAIT_TYPES][AMI_SMBUS_TIMING_COMMANDS];
+} AMI_SMBUS_TIMING_PEER;
+
+static uint64_t DefaultNow(void);
+static void DefaultDelay(unsigned int delay_us);
+
+static AMI_SMBUS_TIMING_CONFIG gTimingConfig = {
+    .min_poll_us = 1000,
+    .max_poll_us = 100 * 1000,
+    .ack_deadline_us = 300 * 1000,
+    .response_deadline_us = 1200 * 1000,
+    .adaptive = 1,
+    .now_us = DefaultNow,
+    .delay_us = DefaultDelay,
+};
+
+//
+// Deadlines that differ from the configured ones, 0 for the configured
+// deadline.  The built-in ones keep the worst case waits of the fixed delays
+// these commands used to have.
+//
+static unsigned int gDeadlineUs[AMI_SMBUS_WAIT_TYPES][AMI_SMBUS_TIMING_COMMANDS] = {
+    [AMI_SMBUS_WAIT_ACK] = {
+        [CMD_DECOMMSION_REQUST - 0x80] = 6000 * 1000,
+    },
+    [AMI_SMBUS_WAIT_RESPONSE] = {
+        [CMD_DECOMMSION_REQUST - 0x80] = 71200 * 1000,
+        [CMD_RECOMMISSION_REQUST - 0x80] = 16200 * 1000,
+    },
+};
+
+static AMI_SMBUS_TIMING_PEER gTimingPeers[AMI_SMBUS_TIMING_MAX_PEERS];
+static uint32_t gTimingUseCount;
+
+static uint64_t DefaultNow(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+}
+
+static void DefaultDelay(unsigned int delay_us) {
+  usleep(delay_us);
+}
+
+static int CommandIndex(unsigned char command) {
+  if ((command & 0xE0) == 0x80) {
+    return command - 0x80;
+  }
+
+  return AMI_SMBUS_TIMING_COMMANDS - 1;
+}
+
+static int ValidWait(int wait) {
+  return (wait >= 0) && (wait < AMI_SMBUS_WAIT_TYPES);
+}
+
+/**
+  Find the timing of a peer, taking over the least recently used entry if
+  the peer has not been seen before
+
+  @param  IN unsigned char fru_id
+
+  @retval AMI_SMBUS_TIMING_PEER*
+
+**/
+static AMI_SMBUS_TIMING_PEER* FindPeer(unsigned char fru_id) {
+  AMI_SMBUS_TIMING_PEER* peer = NULL;
+  int index;
+
+  for (index = 0; index < AMI_SMBUS_TIMING_MAX_PEERS; index++) {
+    if (gTimingPeers[index].used && (gTimingPeers[index].fru_id == fru_id)) {
+      peer = &gTimingPeers[index];
+      break;
+    }
+    if ((peer == NULL) || (peer->used && (!gTimingPeers[index].used ||
+        (gTimingPeers[index].last_use < peer->last_use)))) {
+      peer = &gTimingPeers[index];
+    }
+  }
+
+  if (!peer->used || (peer->fru_id != fru_id)) {
+    memset(peer, 0, sizeof(*peer));
+    peer->used = 1;
+    peer->fru_id = fru_id;
+  }
+  peer->last_use = ++gTimingUseCount;
+
+  return peer;
+}
+
+/**
+  Add a measured response time to an estimate
+
+  @param  IN AMI_SMBUS_TIMING_ESTIMATE *estimate
+  @param  IN uint32_t sample_us
+
+  @retval void
+
+**/
+static void UpdateEstimate(
+    AMI_SMBUS_TIMING_ESTIMATE* estimate,
+    uint32_t sample_us) {
+  uint32_t error;
+
+  if (estimate->samples == 0) {
+    estimate->srtt_us = sample_us;
+    estimate->rttvar_us = sample_us / 2;
+  } else {
+    error = (sample_us > estimate->srtt_us) ? (sample_us - estimate->srtt_us)
+                                            : (estimate->srtt_us - sample_us);
+    estimate->rttvar_us = estimate->rttvar_us - (estimate->rttvar_us / 4) + (error / 4);
+    estimate->srtt_us = estimate->srtt_us - (estimate->srtt_us / 8) + (sample_us / 8);
+  }
+  estimate->samples++;
+}
+
+/**
+  Get the default link layer timing
+
+  @param  OUT AMI_SMBUS_TIMING_CONFIG *config
+
+  @retval void
+
+**/
+void AmiSmbusTimingGetDefaults(AMI_SMBUS_TIMING_CONFIG* config) {
+  config->min_poll_us = 1000;
+  config->max_poll_us = 100 * 1000;
+  config->ack_deadline_us = 300 * 1000;
+  config->response_deadline_us = 1200 * 1000;
+  config->adaptive = 1;
+  config->now_us = DefaultNow;
+  config->delay_us = DefaultDelay;
+}
+
+/**
+  Set the link layer timing and forget the learned response times.  The
+  deadlines set for single commands are kept.
+
+  @param  IN AMI_SMBUS_TIMING_CONFIG *config - NULL for the defaults
+
+  @retval void
+
+**/
+void AmiSmbusTimingInit(const AMI_SMBUS_TIMING_CONFIG* config) {
+  if (config == NULL) {
+    AmiSmbusTimingGetDefaults(&gTimingConfig);
+  } else {
+    gTimingConfig = *config;
+    if (gTimingConfig.now_us == NULL) {
+      gTimingConfig.now_us = DefaultNow;
+    }
+    if (gTimingConfig.delay_us == NULL) {
+      gTimingConfig.delay_us = DefaultDelay;
+    }
+    if (gTimingConfig.min_poll_us == 0) {
+      gTimingConfig.min_poll_us = 1;
+    }
+    if (gTimingConfig.max_poll_us < gTimingConfig.min_poll_us) {
+      gTimingConfig.max_poll_us = gTimingConfig.min_poll_us;
+    }
+  }
+
+  memset(gTimingPeers, 0, sizeof(gTimingPeers));
+  gTimingUseCount = 0;
+}
+
+/**
+  Set the time allowed for an ack or response to one command
+
+  @param  IN unsigned char command
+  @param  IN int wait - AMI_SMBUS_WAIT_ACK or AMI_SMBUS_WAIT_RESPONSE
+  @param  IN unsigned int deadline_us - 0 for the configured deadline
+
+  @retval int 0 - SUCCESS, -1 - FAIL
+
+**/
+int AmiSmbusTimingSetDeadline(
+    unsigned char command,
+    int wait,
+    unsigned int deadline_us) {
+  if (!ValidWait(wait)) {
+    return -1;
+  }
+
+  gDeadlineUs[wait][CommandIndex(command)] = deadline_us;
+  return 0;
+}
+
+/**
+  Get the time allowed for an ack or response to one command
+
+  @param  IN unsigned char command
+  @param  IN int wait - AMI_SMBUS_WAIT_ACK or AMI_SMBUS_WAIT_RESPONSE
+
+  @retval unsigned int deadline in microseconds
+
+**/
+unsigned int AmiSmbusTimingGetDeadline(unsigned char command, int wait) {
+  if (!ValidWait(wait)) {
+    return 0;
+  }
+
+  if (gDeadlineUs[wait][CommandIndex(command)]) {
+    return gDeadlineUs[wait][CommandIndex(command)];
+  }
+
+  return (wait == AMI_SMBUS_WAIT_ACK) ? gTimingConfig.ack_deadline_us
+                                      : gTimingConfig.response_deadline_us;
+}
+
+/**
+  Get the learned response time of a command on a peer
+
+  @param  IN unsigned char fru_id
+  @param  IN unsigned char command
+  @param  IN int wait
+  @param  OUT AMI_SMBUS_TIMING_ESTIMATE *estimate
+
+  @retval int 0 - SUCCESS, -1 - FAIL
+
+**/
+int AmiSmbusTimingGetEstimate(
+    unsigned char fru_id,
+    unsigned char command,
+    int wait,
+    AMI_SMBUS_TIMING_ESTIMATE* estimate) {
+  int index;
+
+  if (!ValidWait(wait) || (estimate == NULL)) {
+    return -1;
+  }
+
+  for (index = 0; index < AMI_SMBUS_TIMING_MAX_PEERS; index++) {
+    if (gTimingPeers[index].used && (gTimingPeers[index].fru_id == fru_id)) {
+      *estimate = gTimingPeers[index].estimate[wait][CommandIndex(command)];
+      return 0;
+    }
+  }
+
+  memset(estimate, 0, sizeof(*estimate));
+  return 0;
+}
+
+/**
+  Poll the peer until it answers or the deadline passes
+
+  The first poll is made after the learned response time of the command,
+  less twice its deviation, or after the shortest poll interval for a command
+  the peer has not answered yet.  Starting that early keeps a faster than usual
+  answer from waiting for a late first poll.  The interval then doubles up to
+  the longest poll interval.
+
+  @param  IN unsigned char fru_id
+  @param  IN unsigned char command - data layer command being waited on
+  @param  IN int wait - AMI_SMBUS_WAIT_ACK or AMI_SMBUS_WAIT_RESPONSE
+  @param  IN unsigned int deadline_us - 0 for the deadline of the command
+  @param  IN int (*poll)(void *context) - returns an AMI_SMBUS_POLL_* value
+  @param  IN void *context
+
+  @retval int 0 - SUCCESS, -1 - FAIL
+
+**/
+int AmiSmbusTimingPoll(
+    unsigned char fru_id,
+    unsigned char command,
+    int wait,
+    unsigned int deadline_us,
+    int (*poll)(void* context),
+    void* context,
+    int verbose) {
+  AMI_SMBUS_TIMING_ESTIMATE* estimate;
+  uint64_t start;
+  uint64_t elapsed;
+  unsigned int delay;
+  unsigned int backoff;
+  int status;
+
+  if (!ValidWait(wait) || (poll == NULL)) {
+    return -1;
+  }
+
+  if (deadline_us == 0) {
+    deadline_us = AmiSmbusTimingGetDeadline(command, wait);
+  }
+
+  estimate = &FindPeer(fru_id)->estimate[wait][CommandIndex(command)];
+  if (gTimingConfig.adaptive && estimate->samples) {
+    delay = (estimate->srtt_us > (2 * estimate->rttvar_us))
+        ? (estimate->srtt_us - (2 * estimate->rttvar_us))
+        : 0;
+  } else {
+    delay = gTimingConfig.min_poll_us;
+  }
+  backoff = gTimingConfig.min_poll_us;
+
+  start = gTimingConfig.now_us();
+  do {
+    elapsed = gTimingConfig.now_us() - start;
+    if ((elapsed + delay) > deadline_us) {
+      delay = (elapsed < deadline_us) ? (unsigned int)(deadline_us - elapsed) : 0;
+    }
+    if (delay) {
+      gTimingConfig.delay_us(delay);
+    }
+
+    //
+    // The peer had answered by the time the poll was started, so that time is
+    // learned rather than the end of the read.  Otherwise the bus time of each
+    // read would be added to the estimate on every exchange.
+    //
+    elapsed = gTimingConfig.now_us() - start;
+    status = poll(context);
+    if (status == AMI_SMBUS_POLL_DONE) {
+      DEBUG("peer answered after %u us \n", (unsigned int)elapsed);
+      UpdateEstimate(estimate, (elapsed > UINT32_MAX) ? UINT32_MAX : (uint32_t)elapsed);
+      return 0;
+    }
+    elapsed = gTimingConfig.now_us() - start;
+
+    delay = backoff;
+    backoff = (backoff > (gTimingConfig.max_poll_us / 2)) ? gTimingConfig.max_poll_us
+                                                          : (backoff * 2);
+  } while ((status == AMI_SMBUS_POLL_AGAIN) && (elapsed < deadline_us));
+
+  DEBUG("peer did not answer within %u us \n", deadline_us);
+  return -1;
+}
+
+/**
+  Read the clock used for the link layer timing
+
+  @param  none
+
+  @retval uint64_t time in microseconds
+
+**/
+uint64_t AmiSmbusTimingNow(void) {
+  return gTimingConfig.now_us();
+}
+
+/**
+  Sleep with the delay used for the link layer timing
+
+  @param  IN unsigned int delay_us
+
+  @retval void
+
+**/
+void AmiSmbusTimingDelay(unsigned int delay_us) {
+  gTimingConfig.delay_us(delay_us);
+}
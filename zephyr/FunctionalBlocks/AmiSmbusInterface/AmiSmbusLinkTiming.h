@@ -0,0 +1,101 @@
+//***********************************************************************
+//*                                                                     *
+//*                 Copyright (c) 1985-2022, AMI                        *
+//*                                                                     *
+//*      All rights reserved. Subject to AMI licensing agreement.       *
+//*                                                                     *
+//***********************************************************************
+/** @file AmiSmbusLinkTiming.h
+    Adaptive wait timing for the AmiSmbus link layer
+
+**/
+#include <stdint.h>
+
+#ifndef _AMI_SMBUS_LINK_TIMING_
+#define _AMI_SMBUS_LINK_TIMING_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AMI_SMBUS_TIMING_MAX_PEERS (8)
+#define AMI_SMBUS_TIMING_COMMANDS (33) // 0x80-0x9F, and one slot for any other command
+
+///
+///  What is being waited for after a write to the peer
+///
+enum {
+  AMI_SMBUS_WAIT_ACK = 0,      // link layer ack of one packet
+  AMI_SMBUS_WAIT_RESPONSE = 1, // first packet of the data layer response
+  AMI_SMBUS_WAIT_TYPES = 2,
+};
+
+///
+///  Result of one poll of the peer
+///
+enum {
+  AMI_SMBUS_POLL_DONE = 0,   // the peer answered
+  AMI_SMBUS_POLL_AGAIN = 1,  // nothing yet, poll again later
+  AMI_SMBUS_POLL_FAIL = -1,  // the peer refused, stop waiting
+};
+
+///
+///  Link layer timing.  Times are in microseconds.
+///
+typedef struct {
+  unsigned int min_poll_us;          // first retry interval of the backoff
+  unsigned int max_poll_us;          // longest interval between two polls
+  unsigned int ack_deadline_us;      // time allowed for a link layer ack
+  unsigned int response_deadline_us; // time allowed for a data layer response
+  int adaptive;                      // first poll at the learned response time of the peer
+  uint64_t (*now_us)(void);          // monotonic clock
+  void (*delay_us)(unsigned int us); // sleep
+} AMI_SMBUS_TIMING_CONFIG;
+
+///
+///  Learned response time of one command on one peer
+///
+typedef struct {
+  uint32_t srtt_us;   // smoothed response time
+  uint32_t rttvar_us; // smoothed deviation of the response time
+  uint32_t samples;   // number of responses measured
+} AMI_SMBUS_TIMING_ESTIMATE;
+
+// Function Declarations
+//
+
+void AmiSmbusTimingGetDefaults(AMI_SMBUS_TIMING_CONFIG* config);
+
+void AmiSmbusTimingInit(const AMI_SMBUS_TIMING_CONFIG* config);
+
+int AmiSmbusTimingSetDeadline(
+    unsigned char command,
+    int wait,
+    unsigned int deadline_us);
+
+unsigned int AmiSmbusTimingGetDeadline(unsigned char command, int wait);
+
+int AmiSmbusTimingGetEstimate(
+    unsigned char fru_id,
+    unsigned char command,
+    int wait,
+    AMI_SMBUS_TIMING_ESTIMATE* estimate);
+
+int AmiSmbusTimingPoll(
+    unsigned char fru_id,
+    unsigned char command,
+    int wait,
+    unsigned int deadline_us,
+    int (*poll)(void* context),
+    void* context,
+    int verbose);
+
+uint64_t AmiSmbusTimingNow(void);
+
+void AmiSmbusTimingDelay(unsigned int delay_us);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif   /* _AMI_SMBUS_LINK_TIMING_ */
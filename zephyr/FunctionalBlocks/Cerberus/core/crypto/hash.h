@@ -199,6 +199,33 @@ struct hash_engine {
 	 * @param engine The hash engine to cancel.
 	 */
 	void (*cancel) (struct hash_engine *engine);
+
+	/**
+	 * Start updating the current hash operation with a block of data without waiting for the
+	 * engine to finish processing it.  The data buffer must not be modified until update_wait
+	 * has been called.
+	 *
+	 * This is optional and can be null if the engine only supports blocking updates.
+	 *
+	 * @param engine The hash engine to update.
+	 * @param data The data that should be added to generate the final hash.
+	 * @param length The length of the data.
+	 *
+	 * @return 0 if the hash update was started successfully or an error code.
+	 */
+	int (*update_async) (struct hash_engine *engine, const uint8_t *data, size_t length);
+
+	/**
+	 * Wait for a hash update started with update_async to complete.  Calling this with no update
+	 * in progress has no effect.
+	 *
+	 * This must be provided if update_async is provided.
+	 *
+	 * @param engine The hash engine to wait on.
+	 *
+	 * @return 0 if the hash operation was updated successfully or an error code.
+	 */
+	int (*update_wait) (struct hash_engine *engine);
 };
 
 
@@ -2,6 +2,8 @@
 // Licensed under the MIT license.
 
 #include <stdbool.h>
+#include <string.h>
+#include "platform.h"
 #include "flash_util.h"
 #include "flash_common.h"
 
@@ -458,6 +460,182 @@ int flash_hash_update_noncontiguous_contents_at_offset (struct flash *flash, uin
 	return 0;
 }
 
+/**
+ * Generate a hash for a contiguous block of data stored in a flash device.  Flash reads are
+ * overlapped with hash processing when the hash engine supports asynchronous updates.
+ *
+ * @param flash The flash device that contains the data to hash.
+ * @param start_addr The first address of the data that should be hashed.
+ * @param length The number of bytes to hash.
+ * @param hash The hashing engine to use to generate the hash.
+ * @param type The type of hash to generate.
+ * @param depth The number of read buffers to cycle through.  A depth of 1 disables overlap.
+ * @param hash_out The buffer to hold the generated hash value.
+ * @param hash_length The length of the hash output buffer.
+ *
+ * @return 0 if the hash was generated successfully or an error code.
+ */
+int flash_hash_contents_pipelined (struct flash *flash, uint32_t start_addr, size_t length,
+	struct hash_engine *hash, enum hash_type type, size_t depth, uint8_t *hash_out,
+	size_t hash_length)
+{
+	struct flash_region region;
+
+	if (length == 0) {
+		return FLASH_UTIL_INVALID_ARGUMENT;
+	}
+
+	region.start_addr = start_addr;
+	region.length = length;
+
+	return flash_hash_noncontiguous_contents_pipelined_at_offset (flash, 0, &region, 1, hash, type,
+		depth, hash_out, hash_length);
+}
+
+/**
+ * Generate a hash for a group of noncontiguous blocks of data stored in a flash device.  All
+ * regions will be hashed starting at a fixed offset in flash.  Flash reads are overlapped with
+ * hash processing when the hash engine supports asynchronous updates.
+ *
+ * @param flash The flash device that contains the data to hash.
+ * @param offset An offset to apply to each region address.
+ * @param regions The group of regions that should be hashed as a single region.
+ * @param count The number of regions defined in the group.
+ * @param hash The hashing engine to use to generate the hash.
+ * @param type The type of hash to generate.
+ * @param depth The number of read buffers to cycle through.  A depth of 1 disables overlap.
+ * @param hash_out The buffer to hold the generated hash value.
+ * @param hash_length The length of the hash output buffer.
+ *
+ * @return 0 if the hash was generated successfully or an error code.
+ */
+int flash_hash_noncontiguous_contents_pipelined_at_offset (struct flash *flash, uint32_t offset,
+	const struct flash_region *regions, size_t count, struct hash_engine *hash, enum hash_type type,
+	size_t depth, uint8_t *hash_out, size_t hash_length)
+{
+	int status;
+
+	if ((flash == NULL) || (regions == NULL) || (hash == NULL) || (hash_out == NULL) ||
+		(count == 0) || (hash_length == 0)) {
+		return FLASH_UTIL_INVALID_ARGUMENT;
+	}
+
+	status = hash_start_new_hash (hash, type);
+	if (status != 0) {
+		return status;
+	}
+
+	status = flash_hash_update_noncontiguous_contents_pipelined_at_offset (flash, offset, regions,
+		count, hash, depth);
+	if (status != 0) {
+		goto fail;
+	}
+
+	status = hash->finish (hash, hash_out, hash_length);
+	if (status != 0) {
+		goto fail;
+	}
+
+	return 0;
+
+fail:
+	hash->cancel (hash);
+	return status;
+}
+
+/**
+ * Update a hash for a group of noncontiguous blocks of data stored in a flash device.  All regions
+ * will be hashed starting at a fixed offset in flash.
+ *
+ * Data is read into a ring of buffers.  While the hash engine digests one buffer, the next block
+ * of flash is read into another, so the flash and hash hardware run at the same time.  If the hash
+ * engine does not support asynchronous updates, this behaves the same as
+ * flash_hash_update_noncontiguous_contents_at_offset.
+ *
+ * The hash context must already be started prior to this call.  The hashing context will not be
+ * canceled on failure.
+ *
+ * @param flash The flash device that contains the data to hash.
+ * @param offset An offset to apply to each region address.
+ * @param regions The group of regions that should be hashed as a single region.
+ * @param count The number of regions defined in the group.
+ * @param hash The hashing engine to use to generate the hash.
+ * @param depth The number of read buffers to cycle through.  A depth of 1 disables overlap.
+ *
+ * @return 0 if the hash was updated successfully or an error code.
+ */
+int flash_hash_update_noncontiguous_contents_pipelined_at_offset (struct flash *flash,
+	uint32_t offset, const struct flash_region *regions, size_t count, struct hash_engine *hash,
+	size_t depth)
+{
+	uint8_t *buffers;
+	uint8_t *data;
+	size_t next_read;
+	uint32_t current_addr;
+	size_t remaining;
+	size_t current = 0;
+	bool pending = false;
+	size_t i;
+	int wait_status;
+	int status = 0;
+
+	if ((flash == NULL) || (regions == NULL) || (count == 0) || (hash == NULL) ||
+		(depth == 0) || (depth > FLASH_HASH_PIPELINE_MAX_DEPTH)) {
+		return FLASH_UTIL_INVALID_ARGUMENT;
+	}
+
+	if ((depth == 1) || (hash->update_async == NULL) || (hash->update_wait == NULL)) {
+		return flash_hash_update_noncontiguous_contents_at_offset (flash, offset, regions, count,
+			hash);
+	}
+
+	buffers = platform_malloc (depth * FLASH_VERIFICATION_BLOCK);
+	if (buffers == NULL) {
+		return FLASH_UTIL_NO_MEMORY;
+	}
+
+	for (i = 0; (i < count) && (status == 0); i++) {
+		current_addr = regions[i].start_addr + offset;
+		remaining = regions[i].length;
+
+		while ((remaining > 0) && (status == 0)) {
+			next_read = (remaining < FLASH_VERIFICATION_BLOCK) ?
+				remaining : FLASH_VERIFICATION_BLOCK;
+			data = &buffers[current * FLASH_VERIFICATION_BLOCK];
+
+			status = flash->read (flash, current_addr, data, next_read);
+
+			if (pending) {
+				wait_status = hash->update_wait (hash);
+				pending = false;
+				if (status == 0) {
+					status = wait_status;
+				}
+			}
+
+			if (status == 0) {
+				status = hash->update_async (hash, data, next_read);
+				pending = (status == 0);
+			}
+
+			remaining -= next_read;
+			current_addr += next_read;
+			current = (current + 1) % depth;
+		}
+	}
+
+	/* The engine may still be reading from a buffer, so it must finish before the ring is freed. */
+	if (pending) {
+		wait_status = hash->update_wait (hash);
+		if (status == 0) {
+			status = wait_status;
+		}
+	}
+
+	platform_free (buffers);
+	return status;
+}
+
 /**
  * Erase a region of flash.
  *
@@ -1399,3 +1577,249 @@ int flash_copy_ext_to_blank_and_verify (struct flash *dest_flash, uint32_t dest_
 {
 	return flash_copy_data_region (dest_flash, dest_addr, src_flash, src_addr, length, NULL, 1);
 }
+
+/**
+ * Check that two regions of flash contain the same data by comparing a hash of each region.  The
+ * regions can be on the same or different flash devices.
+ *
+ * @param flash1 The flash device for the first region.
+ * @param addr1 The starting address of the first region.
+ * @param flash2 The flash device for the second region.
+ * @param addr2 The starting address of the second region.
+ * @param length The size of the region to verify.
+ * @param hash The hashing engine to use to compare the regions.
+ *
+ * @return 0 if the two regions contain the same data or an error code.  If the regions do not
+ * match, FLASH_UTIL_DATA_MISMATCH is returned.
+ */
+int flash_hash_verify_copy_ext (struct flash *flash1, uint32_t addr1, struct flash *flash2,
+	uint32_t addr2, size_t length, struct hash_engine *hash)
+{
+	uint8_t digest1[SHA256_HASH_LENGTH];
+	uint8_t digest2[SHA256_HASH_LENGTH];
+	int status;
+
+	if ((flash1 == NULL) || (flash2 == NULL) || (hash == NULL)) {
+		return FLASH_UTIL_INVALID_ARGUMENT;
+	}
+
+	status = flash_hash_contents (flash1, addr1, length, hash, HASH_TYPE_SHA256, digest1,
+		sizeof (digest1));
+	if (status != 0) {
+		return status;
+	}
+
+	status = flash_hash_contents (flash2, addr2, length, hash, HASH_TYPE_SHA256, digest2,
+		sizeof (digest2));
+	if (status != 0) {
+		return status;
+	}
+
+	return (memcmp (digest1, digest2, sizeof (digest1)) == 0) ? 0 : FLASH_UTIL_DATA_MISMATCH;
+}
+
+/**
+ * Copy data stored at one flash location to another flash location, only updating erase blocks
+ * where the destination does not already match the source.  Each erase block is compared by hash
+ * and only blocks that differ are erased, programmed, and verified.
+ *
+ * @param dest_flash The flash device to copy data to.
+ * @param dest_addr The starting address of the region to copy to.  If this is not aligned to an
+ * erase block, data before this address in the first block will be lost when the block is updated.
+ * @param src_flash The flash device to copy data from.
+ * @param src_addr The starting address of the region to copy from.
+ * @param length The size of the region to copy.
+ * @param hash The hashing engine to use to compare the regions.
+ * @param erase Function to use to erase flash region prior to copying the data.
+ * @param block_size Function to determine the size of the flash erase block.
+ * @param updated Optional output for the number of erase blocks that were updated.
+ *
+ * @return 0 if the destination matches the source or an error code.
+ */
+static int flash_copy_changed_data_region_ext (struct flash *dest_flash, uint32_t dest_addr,
+	struct flash *src_flash, uint32_t src_addr, size_t length, struct hash_engine *hash,
+	int (*erase) (struct flash*, uint32_t, size_t), int (*block_size) (struct flash*, uint32_t*),
+	size_t *updated)
+{
+	uint32_t block;
+	uint32_t page;
+	size_t block_len;
+	int status;
+
+	if ((dest_flash == NULL) || (src_flash == NULL) || (hash == NULL)) {
+		return FLASH_UTIL_INVALID_ARGUMENT;
+	}
+
+	if (updated) {
+		*updated = 0;
+	}
+
+	if (length == 0) {
+		return 0;
+	}
+
+	status = block_size (dest_flash, &block);
+	if (status != 0) {
+		return status;
+	}
+
+	if (dest_flash == src_flash) {
+		status = flash_check_copy_region (dest_addr, src_addr, length, FLASH_REGION_MASK (block));
+		if (status != 0) {
+			return status;
+		}
+	}
+
+	status = dest_flash->get_page_size (dest_flash, &page);
+	if (status != 0) {
+		return status;
+	}
+
+	if (page > FLASH_MAX_COPY_BLOCK) {
+		return FLASH_UTIL_UNSUPPORTED_PAGE_SIZE;
+	}
+
+	while (length != 0) {
+		block_len = block - FLASH_REGION_OFFSET (dest_addr, block);
+		block_len = (length > block_len) ? block_len : length;
+
+		status = flash_hash_verify_copy_ext (dest_flash, dest_addr, src_flash, src_addr,
+			block_len, hash);
+		if (status == FLASH_UTIL_DATA_MISMATCH) {
+			status = flash_erase_region_and_verify_ext (dest_flash, dest_addr, block_len, erase);
+			if (status == 0) {
+				status = flash_copy_data_to_blank_region (dest_flash, dest_addr, src_flash,
+					src_addr, block_len, page, 1);
+			}
+
+			if ((status == 0) && updated) {
+				*updated += 1;
+			}
+		}
+
+		if (status != 0) {
+			return status;
+		}
+
+		length -= block_len;
+		src_addr += block_len;
+		dest_addr += block_len;
+	}
+
+	return 0;
+}
+
+/**
+ * Copy data stored at one location in a flash device to another location in the same flash device,
+ * skipping erase blocks that already hold the source data.  The source and destination regions
+ * must not overlap or be within the same erase block.  Updated blocks are verified after the copy.
+ *
+ * Erase blocks are on 64kB boundaries.
+ *
+ * @param flash The flash device to use for the copy.
+ * @param dest_addr The flash address where the copy will be stored.
+ * @param src_addr The flash address where the data will be copied from.
+ * @param length The number of bytes to copy.
+ * @param hash The hashing engine to use to compare erase blocks.
+ * @param updated Optional output for the number of erase blocks that were updated.
+ *
+ * @return 0 if the data was successfully copied or an error code.
+ */
+int flash_copy_changed_and_verify (struct flash *flash, uint32_t dest_addr, uint32_t src_addr,
+	size_t length, struct hash_engine *hash, size_t *updated)
+{
+	if (flash == NULL) {
+		return FLASH_UTIL_INVALID_ARGUMENT;
+	}
+
+	return flash_copy_changed_data_region_ext (flash, dest_addr, flash, src_addr, length, hash,
+		flash_erase_region, flash->get_block_size, updated);
+}
+
+/**
+ * Copy data stored at one location in a flash device to another location in the same flash device,
+ * skipping erase sectors that already hold the source data.  The source and destination regions
+ * must not overlap or be within the same erase sector.  Updated sectors are verified after the
+ * copy.
+ *
+ * Erase blocks are on 4kB boundaries.
+ *
+ * @param flash The flash device to use for the copy.
+ * @param dest_addr The flash address where the copy will be stored.
+ * @param src_addr The flash address where the data will be copied from.
+ * @param length The number of bytes to copy.
+ * @param hash The hashing engine to use to compare erase sectors.
+ * @param updated Optional output for the number of erase sectors that were updated.
+ *
+ * @return 0 if the data was successfully copied or an error code.
+ */
+int flash_sector_copy_changed_and_verify (struct flash *flash, uint32_t dest_addr,
+	uint32_t src_addr, size_t length, struct hash_engine *hash, size_t *updated)
+{
+	if (flash == NULL) {
+		return FLASH_UTIL_INVALID_ARGUMENT;
+	}
+
+	return flash_copy_changed_data_region_ext (flash, dest_addr, flash, src_addr, length, hash,
+		flash_sector_erase_region, flash->get_sector_size, updated);
+}
+
+/**
+ * Copy data stored at a location in flash to another flash location, skipping erase blocks that
+ * already hold the source data.  The source and destination flash devices can be the same or
+ * different devices.  If they are the same, then the source and destination regions must not
+ * overlap or be within the same erase block.  Updated blocks are verified after the copy.
+ *
+ * Erase blocks are on 64kB boundaries.
+ *
+ * @param dest_flash The flash device to write the copy to.
+ * @param dest_addr The flash address where the copy will be stored.
+ * @param src_flash The flash device to read the copy from.
+ * @param src_addr The flash address where the data will be copied from.
+ * @param length The number of bytes to copy.
+ * @param hash The hashing engine to use to compare erase blocks.
+ * @param updated Optional output for the number of erase blocks that were updated.
+ *
+ * @return 0 if the data was successfully copied or an error code.
+ */
+int flash_copy_ext_changed_and_verify (struct flash *dest_flash, uint32_t dest_addr,
+	struct flash *src_flash, uint32_t src_addr, size_t length, struct hash_engine *hash,
+	size_t *updated)
+{
+	if (dest_flash == NULL) {
+		return FLASH_UTIL_INVALID_ARGUMENT;
+	}
+
+	return flash_copy_changed_data_region_ext (dest_flash, dest_addr, src_flash, src_addr, length,
+		hash, flash_erase_region, dest_flash->get_block_size, updated);
+}
+
+/**
+ * Copy data stored at a location in flash to another flash location, skipping erase sectors that
+ * already hold the source data.  The source and destination flash devices can be the same or
+ * different devices.  If they are the same, then the source and destination regions must not
+ * overlap or be within the same erase sector.  Updated sectors are verified after the copy.
+ *
+ * Erase blocks are on 4kB boundaries.
+ *
+ * @param dest_flash The flash device to write the copy to.
+ * @param dest_addr The flash address where the copy will be stored.
+ * @param src_flash The flash device to read the copy from.
+ * @param src_addr The flash address where the data will be copied from.
+ * @param length The number of bytes to copy.
+ * @param hash The hashing engine to use to compare erase sectors.
+ * @param updated Optional output for the number of erase sectors that were updated.
+ *
+ * @return 0 if the data was successfully copied or an error code.
+ */
+int flash_sector_copy_ext_changed_and_verify (struct flash *dest_flash, uint32_t dest_addr,
+	struct flash *src_flash, uint32_t src_addr, size_t length, struct hash_engine *hash,
+	size_t *updated)
+{
+	if (dest_flash == NULL) {
+		return FLASH_UTIL_INVALID_ARGUMENT;
+	}
+
+	return flash_copy_changed_data_region_ext (dest_flash, dest_addr, src_flash, src_addr, length,
+		hash, flash_sector_erase_region, dest_flash->get_sector_size, updated);
+}
@@ -23,6 +23,17 @@
  */
 #define	FLASH_MAX_COPY_BLOCK		512
 
+/**
+ * The maximum number of read buffers used when pipelining flash reads with hash updates.
+ */
+#define	FLASH_HASH_PIPELINE_MAX_DEPTH	3
+
+/**
+ * The default number of read buffers used when pipelining flash reads with hash updates.  With
+ * one hash update in flight at a time, a second buffer is enough to keep both engines busy.
+ */
+#define	FLASH_HASH_PIPELINE_DEPTH		2
+
 
 /**
  * Defines a single region of flash memory.
@@ -73,6 +84,16 @@ int flash_hash_update_noncontiguous_contents (struct flash *flash,
 int flash_hash_update_noncontiguous_contents_at_offset (struct flash *flash, uint32_t offset,
 	const struct flash_region *regions, size_t count, struct hash_engine *hash);
 
+int flash_hash_contents_pipelined (struct flash *flash, uint32_t start_addr, size_t length,
+	struct hash_engine *hash, enum hash_type type, size_t depth, uint8_t *hash_out,
+	size_t hash_length);
+int flash_hash_noncontiguous_contents_pipelined_at_offset (struct flash *flash, uint32_t offset,
+	const struct flash_region *regions, size_t count, struct hash_engine *hash, enum hash_type type,
+	size_t depth, uint8_t *hash_out, size_t hash_length);
+int flash_hash_update_noncontiguous_contents_pipelined_at_offset (struct flash *flash,
+	uint32_t offset, const struct flash_region *regions, size_t count, struct hash_engine *hash,
+	size_t depth);
+
 int flash_erase_region (struct flash *flash, uint32_t start_addr, size_t length);
 int flash_sector_erase_region (struct flash *flash, uint32_t start_addr, size_t length);
 int flash_blank_check (struct flash *flash, uint32_t start_addr, size_t length);
@@ -125,6 +146,21 @@ int flash_copy_ext_to_blank (struct flash *dest_flash, uint32_t dest_addr, struc
 int flash_copy_ext_to_blank_and_verify (struct flash *dest_flash, uint32_t dest_addr,
 	struct flash *src_flash, uint32_t src_addr, size_t length);
 
+int flash_hash_verify_copy_ext (struct flash *flash1, uint32_t addr1, struct flash *flash2,
+	uint32_t addr2, size_t length, struct hash_engine *hash);
+
+int flash_copy_changed_and_verify (struct flash *flash, uint32_t dest_addr, uint32_t src_addr,
+	size_t length, struct hash_engine *hash, size_t *updated);
+int flash_sector_copy_changed_and_verify (struct flash *flash, uint32_t dest_addr,
+	uint32_t src_addr, size_t length, struct hash_engine *hash, size_t *updated);
+
+int flash_copy_ext_changed_and_verify (struct flash *dest_flash, uint32_t dest_addr,
+	struct flash *src_flash, uint32_t src_addr, size_t length, struct hash_engine *hash,
+	size_t *updated);
+int flash_sector_copy_ext_changed_and_verify (struct flash *dest_flash, uint32_t dest_addr,
+	struct flash *src_flash, uint32_t src_addr, size_t length, struct hash_engine *hash,
+	size_t *updated);
+
 
 #define	FLASH_UTIL_ERROR(code)		ROT_ERROR (ROT_MODULE_FLASH_UTIL, code)
 
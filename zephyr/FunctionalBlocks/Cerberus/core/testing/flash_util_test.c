@@ -5,6 +5,8 @@
 #include <stdint.h>
 #include <string.h>
 #include "testing.h"
+#include "platform.h"
+#include "platform_io.h"
 #include "flash/flash_util.h"
 #include "flash/flash_common.h"
 #include "crypto/ecc.h"
@@ -22,6 +24,165 @@
 static const char *SUITE = "flash_util";
 
 
+/**
+ * Cost model used to exercise pipelined hashing.  These approximate a quad SPI read at 25 MB/s and
+ * a SHA-256 hash engine at 40 MB/s, and only need to be representative, not exact.
+ */
+#define	FLASH_UTIL_MODEL_READ_NS_PER_BYTE		40
+#define	FLASH_UTIL_MODEL_HASH_NS_PER_BYTE		25
+
+/**
+ * Flash device backed by a RAM image that charges simulated time for each read.
+ */
+struct flash_util_model_flash {
+	struct flash base;					/**< Flash API. */
+	const uint8_t *image;				/**< Contents of the flash. */
+	size_t size;						/**< Size of the flash image. */
+	uint64_t *clock;					/**< Simulated time, in nanoseconds. */
+	uint32_t fail_addr;					/**< Address that fails to read. */
+	int reads;							/**< Number of reads issued. */
+};
+
+/**
+ * Hash engine that models an asynchronous hash accelerator on top of a real hash engine.  Updates
+ * are only applied when the engine is waited on, so a caller that modifies a buffer while an
+ * update is in flight will produce the wrong digest.
+ */
+struct flash_util_model_hash {
+	struct hash_engine base;			/**< Hash API. */
+	struct hash_engine *engine;			/**< Engine that calculates the digest. */
+	uint64_t *clock;					/**< Simulated time, in nanoseconds. */
+	uint64_t busy_until;				/**< Time the accelerator finishes the current update. */
+	const uint8_t *pending;				/**< Data for the update in flight. */
+	size_t pending_len;					/**< Length of the update in flight. */
+	int async_updates;					/**< Number of asynchronous updates started. */
+};
+
+static int flash_util_model_flash_read (struct flash *flash, uint32_t address, uint8_t *data,
+	size_t length)
+{
+	struct flash_util_model_flash *model = (struct flash_util_model_flash*) flash;
+
+	model->reads++;
+	if ((address == model->fail_addr) || ((address + length) > model->size)) {
+		return FLASH_READ_FAILED;
+	}
+
+	memcpy (data, &model->image[address], length);
+	*model->clock += length * FLASH_UTIL_MODEL_READ_NS_PER_BYTE;
+
+	return 0;
+}
+
+static void flash_util_model_flash_init (struct flash_util_model_flash *model,
+	const uint8_t *image, size_t size, uint64_t *clock)
+{
+	memset (model, 0, sizeof (*model));
+
+	model->base.read = flash_util_model_flash_read;
+	model->image = image;
+	model->size = size;
+	model->clock = clock;
+	model->fail_addr = 0xffffffff;
+}
+
+static void flash_util_model_hash_sync (struct flash_util_model_hash *model)
+{
+	if (*model->clock < model->busy_until) {
+		*model->clock = model->busy_until;
+	}
+}
+
+static int flash_util_model_hash_start_sha256 (struct hash_engine *engine)
+{
+	struct flash_util_model_hash *model = (struct flash_util_model_hash*) engine;
+
+	return model->engine->start_sha256 (model->engine);
+}
+
+static int flash_util_model_hash_update (struct hash_engine *engine, const uint8_t *data,
+	size_t length)
+{
+	struct flash_util_model_hash *model = (struct flash_util_model_hash*) engine;
+
+	flash_util_model_hash_sync (model);
+	*model->clock += length * FLASH_UTIL_MODEL_HASH_NS_PER_BYTE;
+
+	return model->engine->update (model->engine, data, length);
+}
+
+static int flash_util_model_hash_update_async (struct hash_engine *engine, const uint8_t *data,
+	size_t length)
+{
+	struct flash_util_model_hash *model = (struct flash_util_model_hash*) engine;
+
+	if (model->pending != NULL) {
+		return HASH_ENGINE_UPDATE_FAILED;
+	}
+
+	flash_util_model_hash_sync (model);
+	model->busy_until = *model->clock + (length * FLASH_UTIL_MODEL_HASH_NS_PER_BYTE);
+	model->pending = data;
+	model->pending_len = length;
+	model->async_updates++;
+
+	return 0;
+}
+
+static int flash_util_model_hash_update_wait (struct hash_engine *engine)
+{
+	struct flash_util_model_hash *model = (struct flash_util_model_hash*) engine;
+	int status = 0;
+
+	flash_util_model_hash_sync (model);
+	if (model->pending != NULL) {
+		status = model->engine->update (model->engine, model->pending, model->pending_len);
+		model->pending = NULL;
+	}
+
+	return status;
+}
+
+static int flash_util_model_hash_finish (struct hash_engine *engine, uint8_t *hash,
+	size_t hash_length)
+{
+	struct flash_util_model_hash *model = (struct flash_util_model_hash*) engine;
+
+	return model->engine->finish (model->engine, hash, hash_length);
+}
+
+static void flash_util_model_hash_cancel (struct hash_engine *engine)
+{
+	struct flash_util_model_hash *model = (struct flash_util_model_hash*) engine;
+
+	model->engine->cancel (model->engine);
+}
+
+static void flash_util_model_hash_init (struct flash_util_model_hash *model,
+	struct hash_engine *engine, uint64_t *clock)
+{
+	memset (model, 0, sizeof (*model));
+
+	model->base.start_sha256 = flash_util_model_hash_start_sha256;
+	model->base.update = flash_util_model_hash_update;
+	model->base.finish = flash_util_model_hash_finish;
+	model->base.cancel = flash_util_model_hash_cancel;
+	model->base.update_async = flash_util_model_hash_update_async;
+	model->base.update_wait = flash_util_model_hash_update_wait;
+	model->engine = engine;
+	model->clock = clock;
+}
+
+static void flash_util_model_fill_image (uint8_t *image, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		image[i] = (uint8_t) ((i * 31) ^ (i >> 8));
+	}
+}
+
+
 /*******************
  * Test cases
  *******************/
@@ -16994,6 +17155,247 @@ static void flash_hash_update_noncontiguous_contents_at_offset_test_hash_update_
 	CuAssertIntEquals (test, 0, status);
 }
 
+static void flash_hash_contents_pipelined_test_sha256 (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct flash_mock flash;
+	int status;
+	uint8_t data[] = {0x31, 0x32, 0x33, 0x34};
+	uint8_t hash_expected[] = {
+		0x03,0xac,0x67,0x42,0x16,0xf3,0xe1,0x5c,0x76,0x1e,0xe1,0xa5,0xe2,0x55,0xf0,0x67,
+		0x95,0x36,0x23,0xc8,0xb3,0x88,0xb4,0x45,0x9e,0x13,0xf9,0x78,0xd7,0xc8,0x46,0xf4
+	};
+	uint8_t hash_actual[SHA256_HASH_LENGTH];
+
+	TEST_START;
+
+	status = HASH_TESTING_ENGINE_INIT (&hash);
+	CuAssertIntEquals (test, 0, status);
+
+	status = flash_mock_init (&flash);
+	CuAssertIntEquals (test, 0, status);
+
+	status = mock_expect (&flash.mock, flash.base.read, &flash, 0, MOCK_ARG (0x1122),
+		MOCK_ARG_NOT_NULL, MOCK_ARG (4));
+	status |= mock_expect_output (&flash.mock, 1, data, sizeof (data), 2);
+
+	CuAssertIntEquals (test, 0, status);
+
+	status = flash_hash_contents_pipelined (&flash.base, 0x1122, 4, &hash.base, HASH_TYPE_SHA256,
+		FLASH_HASH_PIPELINE_DEPTH, hash_actual, sizeof (hash_actual));
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing_validate_array (hash_expected, hash_actual, sizeof (hash_expected));
+	CuAssertIntEquals (test, 0, status);
+
+	status = flash_mock_validate_and_release (&flash);
+	CuAssertIntEquals (test, 0, status);
+
+	HASH_TESTING_ENGINE_RELEASE (&hash);
+}
+
+static void flash_hash_contents_pipelined_test_async_multiple_blocks (CuTest *test)
+{
+	HASH_TESTING_ENGINE engine;
+	struct flash_util_model_hash hash;
+	struct flash_util_model_flash flash;
+	uint8_t image[(FLASH_VERIFICATION_BLOCK * 3) + 32];
+	uint8_t hash_expected[SHA256_HASH_LENGTH];
+	uint8_t hash_actual[SHA256_HASH_LENGTH];
+	uint64_t clock = 0;
+	size_t depth;
+	int status;
+
+	TEST_START;
+
+	flash_util_model_fill_image (image, sizeof (image));
+
+	status = HASH_TESTING_ENGINE_INIT (&engine);
+	CuAssertIntEquals (test, 0, status);
+
+	status = engine.base.calculate_sha256 (&engine.base, &image[0x10], sizeof (image) - 0x10,
+		hash_expected, sizeof (hash_expected));
+	CuAssertIntEquals (test, 0, status);
+
+	for (depth = 2; depth <= FLASH_HASH_PIPELINE_MAX_DEPTH; depth++) {
+		flash_util_model_flash_init (&flash, image, sizeof (image), &clock);
+		flash_util_model_hash_init (&hash, &engine.base, &clock);
+
+		status = flash_hash_contents_pipelined (&flash.base, 0x10, sizeof (image) - 0x10,
+			&hash.base, HASH_TYPE_SHA256, depth, hash_actual, sizeof (hash_actual));
+		CuAssertIntEquals (test, 0, status);
+		CuAssertIntEquals (test, 4, flash.reads);
+		CuAssertIntEquals (test, 4, hash.async_updates);
+		CuAssertPtrEquals (test, NULL, (void*) hash.pending);
+
+		status = testing_validate_array (hash_expected, hash_actual, sizeof (hash_expected));
+		CuAssertIntEquals (test, 0, status);
+	}
+
+	HASH_TESTING_ENGINE_RELEASE (&engine);
+}
+
+static void flash_hash_contents_pipelined_test_no_pipeline (CuTest *test)
+{
+	HASH_TESTING_ENGINE engine;
+	struct flash_util_model_hash hash;
+	struct flash_util_model_flash flash;
+	uint8_t image[FLASH_VERIFICATION_BLOCK * 2];
+	uint8_t hash_expected[SHA256_HASH_LENGTH];
+	uint8_t hash_actual[SHA256_HASH_LENGTH];
+	uint64_t clock = 0;
+	int status;
+
+	TEST_START;
+
+	flash_util_model_fill_image (image, sizeof (image));
+
+	status = HASH_TESTING_ENGINE_INIT (&engine);
+	CuAssertIntEquals (test, 0, status);
+
+	status = engine.base.calculate_sha256 (&engine.base, image, sizeof (image), hash_expected,
+		sizeof (hash_expected));
+	CuAssertIntEquals (test, 0, status);
+
+	flash_util_model_flash_init (&flash, image, sizeof (image), &clock);
+	flash_util_model_hash_init (&hash, &engine.base, &clock);
+
+	status = flash_hash_contents_pipelined (&flash.base, 0, sizeof (image), &hash.base,
+		HASH_TYPE_SHA256, 1, hash_actual, sizeof (hash_actual));
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 2, flash.reads);
+	CuAssertIntEquals (test, 0, hash.async_updates);
+
+	status = testing_validate_array (hash_expected, hash_actual, sizeof (hash_expected));
+	CuAssertIntEquals (test, 0, status);
+
+	HASH_TESTING_ENGINE_RELEASE (&engine);
+}
+
+static void flash_hash_contents_pipelined_test_null (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct flash_mock flash;
+	int status;
+	uint8_t hash_actual[SHA256_HASH_LENGTH];
+
+	TEST_START;
+
+	status = HASH_TESTING_ENGINE_INIT (&hash);
+	CuAssertIntEquals (test, 0, status);
+
+	status = flash_mock_init (&flash);
+	CuAssertIntEquals (test, 0, status);
+
+	status = flash_hash_contents_pipelined (NULL, 0x1122, 4, &hash.base, HASH_TYPE_SHA256,
+		FLASH_HASH_PIPELINE_DEPTH, hash_actual, sizeof (hash_actual));
+	CuAssertIntEquals (test, FLASH_UTIL_INVALID_ARGUMENT, status);
+
+	status = flash_hash_contents_pipelined (&flash.base, 0x1122, 4, NULL, HASH_TYPE_SHA256,
+		FLASH_HASH_PIPELINE_DEPTH, hash_actual, sizeof (hash_actual));
+	CuAssertIntEquals (test, FLASH_UTIL_INVALID_ARGUMENT, status);
+
+	status = flash_hash_contents_pipelined (&flash.base, 0x1122, 4, &hash.base, HASH_TYPE_SHA256,
+		FLASH_HASH_PIPELINE_DEPTH, NULL, sizeof (hash_actual));
+	CuAssertIntEquals (test, FLASH_UTIL_INVALID_ARGUMENT, status);
+
+	status = flash_hash_contents_pipelined (&flash.base, 0x1122, 0, &hash.base, HASH_TYPE_SHA256,
+		FLASH_HASH_PIPELINE_DEPTH, hash_actual, sizeof (hash_actual));
+	CuAssertIntEquals (test, FLASH_UTIL_INVALID_ARGUMENT, status);
+
+	status = flash_hash_contents_pipelined (&flash.base, 0x1122, 4, &hash.base, HASH_TYPE_SHA256,
+		0, hash_actual, sizeof (hash_actual));
+	CuAssertIntEquals (test, FLASH_UTIL_INVALID_ARGUMENT, status);
+
+	status = flash_hash_contents_pipelined (&flash.base, 0x1122, 4, &hash.base, HASH_TYPE_SHA256,
+		FLASH_HASH_PIPELINE_MAX_DEPTH + 1, hash_actual, sizeof (hash_actual));
+	CuAssertIntEquals (test, FLASH_UTIL_INVALID_ARGUMENT, status);
+
+	status = flash_mock_validate_and_release (&flash);
+	CuAssertIntEquals (test, 0, status);
+
+	HASH_TESTING_ENGINE_RELEASE (&hash);
+}
+
+static void flash_hash_contents_pipelined_test_read_error (CuTest *test)
+{
+	HASH_TESTING_ENGINE engine;
+	struct flash_util_model_hash hash;
+	struct flash_util_model_flash flash;
+	uint8_t image[FLASH_VERIFICATION_BLOCK * 4];
+	uint8_t hash_actual[SHA256_HASH_LENGTH];
+	uint64_t clock = 0;
+	int status;
+
+	TEST_START;
+
+	flash_util_model_fill_image (image, sizeof (image));
+
+	status = HASH_TESTING_ENGINE_INIT (&engine);
+	CuAssertIntEquals (test, 0, status);
+
+	flash_util_model_flash_init (&flash, image, sizeof (image), &clock);
+	flash_util_model_hash_init (&hash, &engine.base, &clock);
+	flash.fail_addr = FLASH_VERIFICATION_BLOCK * 2;
+
+	status = flash_hash_contents_pipelined (&flash.base, 0, sizeof (image), &hash.base,
+		HASH_TYPE_SHA256, FLASH_HASH_PIPELINE_DEPTH, hash_actual, sizeof (hash_actual));
+	CuAssertIntEquals (test, FLASH_READ_FAILED, status);
+	CuAssertIntEquals (test, 3, flash.reads);
+	CuAssertIntEquals (test, 2, hash.async_updates);
+	CuAssertPtrEquals (test, NULL, (void*) hash.pending);
+
+	HASH_TESTING_ENGINE_RELEASE (&engine);
+}
+
+static void flash_hash_contents_pipelined_test_model_throughput (CuTest *test)
+{
+	HASH_TESTING_ENGINE engine;
+	struct flash_util_model_hash hash;
+	struct flash_util_model_flash flash;
+	size_t length = FLASH_VERIFICATION_BLOCK * 256;
+	uint8_t *image;
+	uint8_t hash_actual[SHA256_HASH_LENGTH];
+	uint64_t elapsed[FLASH_HASH_PIPELINE_MAX_DEPTH + 1];
+	uint64_t clock;
+	uint64_t bound;
+	size_t depth;
+	int status;
+
+	TEST_START;
+
+	image = platform_malloc (length);
+	CuAssertPtrNotNull (test, image);
+
+	flash_util_model_fill_image (image, length);
+
+	status = HASH_TESTING_ENGINE_INIT (&engine);
+	CuAssertIntEquals (test, 0, status);
+
+	for (depth = 1; depth <= FLASH_HASH_PIPELINE_MAX_DEPTH; depth++) {
+		clock = 0;
+		flash_util_model_flash_init (&flash, image, length, &clock);
+		flash_util_model_hash_init (&hash, &engine.base, &clock);
+
+		status = flash_hash_contents_pipelined (&flash.base, 0, length, &hash.base,
+			HASH_TYPE_SHA256, depth, hash_actual, sizeof (hash_actual));
+		CuAssertIntEquals (test, 0, status);
+
+		elapsed[depth] = clock;
+		platform_printf ("flash_hash_contents_pipelined: %d buffer(s), %d.%02d MB/s" NEWLINE,
+			(int) depth, (int) ((length * 1000) / clock), (int) (((length * 100000) / clock) % 100));
+	}
+
+	/* Overlap hides the hash time behind flash reads, except for the last block. */
+	bound = (length * FLASH_UTIL_MODEL_READ_NS_PER_BYTE) +
+		(FLASH_VERIFICATION_BLOCK * FLASH_UTIL_MODEL_HASH_NS_PER_BYTE);
+	CuAssertTrue (test, elapsed[2] < elapsed[1]);
+	CuAssertTrue (test, elapsed[2] == bound);
+	CuAssertTrue (test, elapsed[3] == elapsed[2]);
+
+	HASH_TESTING_ENGINE_RELEASE (&engine);
+	platform_free (image);
+}
 
 CuSuite* get_flash_util_suite ()
 {
@@ -17428,6 +17830,12 @@ CuSuite* get_flash_util_suite ()
 		flash_hash_update_noncontiguous_contents_at_offset_test_multiple_regions_read_error);
 	SUITE_ADD_TEST (suite,
 		flash_hash_update_noncontiguous_contents_at_offset_test_hash_update_error);
+	SUITE_ADD_TEST (suite, flash_hash_contents_pipelined_test_sha256);
+	SUITE_ADD_TEST (suite, flash_hash_contents_pipelined_test_async_multiple_blocks);
+	SUITE_ADD_TEST (suite, flash_hash_contents_pipelined_test_no_pipeline);
+	SUITE_ADD_TEST (suite, flash_hash_contents_pipelined_test_null);
+	SUITE_ADD_TEST (suite, flash_hash_contents_pipelined_test_read_error);
+	SUITE_ADD_TEST (suite, flash_hash_contents_pipelined_test_model_throughput);
 
 	return suite;
 }
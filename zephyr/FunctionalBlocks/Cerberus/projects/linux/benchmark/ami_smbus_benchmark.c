@@ -0,0 +1,256 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "testing.h"
+#include "AmiSmbusInterfaceSrcLib.h"
+#include "AmiSmbusLinkTiming.h"
+#include "ami_smbus_loopback.h"
+
+
+static const char *SUITE = "ami_smbus_benchmark";
+
+
+/**
+ * Number of times each command is sent.
+ */
+#define	AMI_SMBUS_BENCHMARK_RUNS		200
+
+/**
+ * Poll interval of the fixed timing, the delay the link layer used to sleep after each write.
+ */
+#define	AMI_SMBUS_BENCHMARK_FIXED_POLL_US	(100 * 1000)
+
+/**
+ * Time for the peer to ack one link packet.
+ */
+#define	AMI_SMBUS_BENCHMARK_ACK_US		2000
+
+/**
+ * Seed of the processing time jitter, the same for both timings.
+ */
+#define	AMI_SMBUS_BENCHMARK_SEED		0x5eed1234
+
+/**
+ * FRU and file descriptor passed to the interface.  The loopback peer ignores the descriptor.
+ */
+#define	AMI_SMBUS_BENCHMARK_FRU			1
+#define	AMI_SMBUS_BENCHMARK_FD			3
+
+
+/**
+ * Latency totals of one command.
+ */
+struct ami_smbus_benchmark_stats {
+	uint64_t p50_us;					/**< Median command latency. */
+	uint64_t p90_us;					/**< 90th percentile command latency. */
+	uint64_t p99_us;					/**< 99th percentile command latency. */
+	double reads;						/**< Reads of the peer for each command. */
+	double busy_reads;					/**< Reads made before the peer had an answer. */
+};
+
+
+static int ami_smbus_benchmark_compare_latency (const void *a, const void *b)
+{
+	uint64_t x = *((const uint64_t*) a);
+	uint64_t y = *((const uint64_t*) b);
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * Send one command repeatedly through the data layer and measure the latency of each exchange on
+ * the virtual clock of the loopback peer.
+ *
+ * @param test The test framework.
+ * @param command The data layer command.
+ * @param request_length Bytes of request payload.
+ * @param timing Timing of the command in the peer.
+ * @param adaptive true for the adaptive polling, false to poll at a fixed interval.
+ * @param stats Output for the latency totals.
+ */
+static void ami_smbus_benchmark_run (CuTest *test, uint8_t command, size_t request_length,
+	const struct ami_smbus_loopback_command *timing, bool adaptive,
+	struct ami_smbus_benchmark_stats *stats)
+{
+	AMI_SMBUS_TIMING_CONFIG config;
+	struct ami_smbus_loopback_stats bus;
+	uint8_t request[SMBUS_MSK_DATA_LENGTH];
+	uint8_t response[sizeof (DATA_LAYER_PACKET_ACK)];
+	DATA_LAYER_PACKET_ACK *ack = (DATA_LAYER_PACKET_ACK*) response;
+	uint64_t latency[AMI_SMBUS_BENCHMARK_RUNS];
+	uint64_t start;
+	size_t i;
+	int status;
+
+	for (i = 0; i < request_length; i++) {
+		request[i] = 0xa5 ^ i;
+	}
+
+	AmiSmbusTimingGetDefaults (&config);
+	config.now_us = ami_smbus_loopback_now;
+	config.delay_us = ami_smbus_loopback_delay;
+	if (!adaptive) {
+		config.min_poll_us = AMI_SMBUS_BENCHMARK_FIXED_POLL_US;
+		config.max_poll_us = AMI_SMBUS_BENCHMARK_FIXED_POLL_US;
+		config.adaptive = 0;
+	}
+	AmiSmbusTimingInit (&config);
+
+	ami_smbus_loopback_init (AMI_SMBUS_BENCHMARK_ACK_US, AMI_SMBUS_BENCHMARK_SEED);
+	ami_smbus_loopback_set_command (command, timing);
+
+	for (i = 0; i < AMI_SMBUS_BENCHMARK_RUNS; i++) {
+		start = ami_smbus_loopback_now ();
+		status = datalayer_send_receive (AMI_SMBUS_BENCHMARK_FRU, AMI_SMBUS_BENCHMARK_FD, command,
+			request, request_length, response, 0);
+		latency[i] = ami_smbus_loopback_now () - start;
+
+		CuAssertIntEquals (test, 0, status);
+		CuAssertIntEquals (test, command, ack->AckCommand);
+		CuAssertIntEquals (test, ACK_FLAG, ack->Flag);
+		CuAssertIntEquals (test, timing->response_length + 4, ack->Length);
+	}
+
+	qsort (latency, AMI_SMBUS_BENCHMARK_RUNS, sizeof (latency[0]),
+		ami_smbus_benchmark_compare_latency);
+	ami_smbus_loopback_get_stats (&bus);
+
+	stats->p50_us = latency[(AMI_SMBUS_BENCHMARK_RUNS * 50) / 100];
+	stats->p90_us = latency[(AMI_SMBUS_BENCHMARK_RUNS * 90) / 100];
+	stats->p99_us = latency[(AMI_SMBUS_BENCHMARK_RUNS * 99) / 100];
+	stats->reads = (double) (bus.reads + bus.busy_reads) / AMI_SMBUS_BENCHMARK_RUNS;
+	stats->busy_reads = (double) bus.busy_reads / AMI_SMBUS_BENCHMARK_RUNS;
+}
+
+/**
+ * Print the fixed and adaptive results of one command.
+ */
+static void ami_smbus_benchmark_print (const char *name,
+	const struct ami_smbus_benchmark_stats *fixed, const struct ami_smbus_benchmark_stats *adaptive)
+{
+	static bool header = false;
+	const struct ami_smbus_benchmark_stats *stats[] = {fixed, adaptive};
+	const char *mode[] = {"fixed", "adapt"};
+	int i;
+
+	if (!header) {
+		printf ("\n%-22s %6s %10s %10s %10s %8s %8s\n", "smbus command", "mode", "p50 ms",
+			"p90 ms", "p99 ms", "reads", "busy");
+		header = true;
+	}
+
+	for (i = 0; i < 2; i++) {
+		printf ("%-22s %6s %10.1f %10.1f %10.1f %8.1f %8.1f\n", name, mode[i],
+			stats[i]->p50_us / 1000.0, stats[i]->p90_us / 1000.0, stats[i]->p99_us / 1000.0,
+			stats[i]->reads, stats[i]->busy_reads);
+	}
+}
+
+/**
+ * Benchmark one command with fixed interval polling and then with the adaptive timing.
+ */
+static void ami_smbus_benchmark_compare (CuTest *test, const char *name, uint8_t command,
+	size_t request_length, uint32_t processing_us, uint32_t jitter_us, size_t response_length)
+{
+	struct ami_smbus_loopback_command timing;
+	struct ami_smbus_benchmark_stats fixed;
+	struct ami_smbus_benchmark_stats adaptive;
+
+	timing.processing_us = processing_us;
+	timing.jitter_us = jitter_us;
+	timing.response_length = response_length;
+
+	ami_smbus_benchmark_run (test, command, request_length, &timing, false, &fixed);
+	ami_smbus_benchmark_run (test, command, request_length, &timing, true, &adaptive);
+	ami_smbus_benchmark_print (name, &fixed, &adaptive);
+
+	// Short commands are answered sooner.  For commands that take seconds the jitter of the peer
+	// is much longer than the poll interval, so the gain is in the number of reads instead.
+	CuAssertTrue (test, (adaptive.p50_us < fixed.p50_us) || (adaptive.reads < fixed.reads));
+	CuAssertTrue (test, adaptive.p50_us < (fixed.p50_us + AMI_SMBUS_BENCHMARK_FIXED_POLL_US));
+	CuAssertTrue (test, adaptive.p90_us < (fixed.p90_us + AMI_SMBUS_BENCHMARK_FIXED_POLL_US));
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void ami_smbus_benchmark_test_boot_status (CuTest *test)
+{
+	TEST_START;
+
+	ami_smbus_benchmark_compare (test, "Boot status", CMD_BOOT_STATUS, 0, 3000, 2000, 8);
+}
+
+static void ami_smbus_benchmark_test_serial_number (CuTest *test)
+{
+	TEST_START;
+
+	ami_smbus_benchmark_compare (test, "Read serial number", CMD_READ_UNIQUE_SERIAL_NUMBER, 0,
+		2000, 1000, 16);
+}
+
+static void ami_smbus_benchmark_test_log_readout (CuTest *test)
+{
+	TEST_START;
+
+	ami_smbus_benchmark_compare (test, "UFM log readout", CMD_UFM_LOG_READOUT_ENTRY, 2, 10000,
+		5000, 64);
+}
+
+static void ami_smbus_benchmark_test_fw_attestation (CuTest *test)
+{
+	TEST_START;
+
+	ami_smbus_benchmark_compare (test, "FW attestation", CMD_FW_ATTESTATION, 32, 45000, 15000,
+		104);
+}
+
+static void ami_smbus_benchmark_test_msk_provision (CuTest *test)
+{
+	TEST_START;
+
+	ami_smbus_benchmark_compare (test, "SMBus MSK provision", CMD_SMBUS_FILTER_MSK_PROVISION,
+		SMBUS_MSK_DATA_LENGTH, 20000, 10000, 0);
+}
+
+static void ami_smbus_benchmark_test_recommission (CuTest *test)
+{
+	TEST_START;
+
+	ami_smbus_benchmark_compare (test, "Recommission", CMD_RECOMMISSION_REQUST, 0, 8000000,
+		2000000, 0);
+}
+
+static void ami_smbus_benchmark_test_decommission (CuTest *test)
+{
+	TEST_START;
+
+	ami_smbus_benchmark_compare (test, "Decommission", CMD_DECOMMSION_REQUST, 0, 40000000,
+		10000000, 0);
+}
+
+
+CuSuite* get_ami_smbus_benchmark_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, ami_smbus_benchmark_test_boot_status);
+	SUITE_ADD_TEST (suite, ami_smbus_benchmark_test_serial_number);
+	SUITE_ADD_TEST (suite, ami_smbus_benchmark_test_log_readout);
+	SUITE_ADD_TEST (suite, ami_smbus_benchmark_test_fw_attestation);
+	SUITE_ADD_TEST (suite, ami_smbus_benchmark_test_msk_provision);
+	SUITE_ADD_TEST (suite, ami_smbus_benchmark_test_recommission);
+	SUITE_ADD_TEST (suite, ami_smbus_benchmark_test_decommission);
+
+	return suite;
+}
@@ -0,0 +1,337 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+/*
+ * Model of a PlatFire peer for the AmiSmbus interface.  The OpenBMC I2C and key-value calls the
+ * interface makes are answered here on a virtual clock, so the waits for acks and responses can
+ * be measured without a bus and without sleeping.
+ *
+ * The peer acks each data packet after a fixed time and starts running the command when the last
+ * packet has been received.  Until an answer is ready, reads are refused the way the device NAKs
+ * its address.  An ack is returned by the first read after it is ready, and the response after
+ * that, one link packet at a time.  The next packet is ready a fixed time after the host acks the
+ * previous one.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "AmiSmbusInterfaceSrcLib.h"
+#include "ami_smbus_loopback.h"
+#include "openbmc/obmc-i2c.h"
+#include "openbmc/kv.h"
+
+
+/**
+ * Number of keys kept in the key-value store.
+ */
+#define	AMI_SMBUS_LOOPBACK_KV_ENTRIES	8
+
+/**
+ * Longest key or value kept in the key-value store.
+ */
+#define	AMI_SMBUS_LOOPBACK_KV_LENGTH	128
+
+/**
+ * Size of the response buffer, padded to a whole number of link packets.
+ */
+#define	AMI_SMBUS_LOOPBACK_RESPONSE_SIZE	(sizeof (DATA_LAYER_PACKET_ACK) + LINK_LAYER_MAX_RECEIVE_LOAD)
+
+
+/**
+ * One entry of the key-value store.
+ */
+struct ami_smbus_loopback_kv {
+	char key[AMI_SMBUS_LOOPBACK_KV_LENGTH];		/**< Key, empty if the entry is free. */
+	char value[AMI_SMBUS_LOOPBACK_KV_LENGTH];	/**< Value of the key. */
+};
+
+/**
+ * State of the PlatFire model.
+ */
+static struct {
+	uint64_t now_ns;										/**< Virtual clock. */
+	uint32_t seed;											/**< State of the jitter generator. */
+	uint64_t ack_ns;										/**< Time to ack one packet. */
+	struct ami_smbus_loopback_command command[256];			/**< Timing of each command. */
+	uint8_t request[DATA_LAYER_EXTEND_MAX_PACKET];			/**< Data layer request received. */
+	uint8_t session;										/**< Session of the last packet. */
+	bool ack_needed;										/**< The last packet asked for an ack. */
+	uint8_t ack_index;										/**< Index of the packet to ack. */
+	uint64_t ack_ready_ns;									/**< Time the ack is ready. */
+	bool responding;										/**< A response is being returned. */
+	uint8_t response[AMI_SMBUS_LOOPBACK_RESPONSE_SIZE];		/**< Data layer response. */
+	int packet;												/**< Response packet being returned. */
+	int packets;											/**< Number of response packets. */
+	uint64_t packet_ready_ns;								/**< Time the packet is ready. */
+	struct ami_smbus_loopback_stats stats;					/**< Transfer totals. */
+	struct ami_smbus_loopback_kv kv[AMI_SMBUS_LOOPBACK_KV_ENTRIES];	/**< Key-value store. */
+} loopback;
+
+
+/**
+ * Reset the PlatFire model.  Every command answers with no payload right after it is received
+ * until it is given a timing.
+ *
+ * @param ack_us Time for the peer to ack one packet.
+ * @param seed Seed of the processing time jitter.
+ */
+void ami_smbus_loopback_init (uint32_t ack_us, uint32_t seed)
+{
+	memset (&loopback, 0, sizeof (loopback));
+	loopback.ack_ns = ack_us * 1000ULL;
+	loopback.seed = (seed != 0) ? seed : 1;
+}
+
+/**
+ * Set the timing of one command.
+ *
+ * @param command The data layer command.
+ * @param timing Timing and response size of the command.
+ */
+void ami_smbus_loopback_set_command (uint8_t command,
+	const struct ami_smbus_loopback_command *timing)
+{
+	loopback.command[command] = *timing;
+	if (loopback.command[command].response_length > (DATA_LAYER_MAX_ACK_PAYLOAD - 1)) {
+		loopback.command[command].response_length = DATA_LAYER_MAX_ACK_PAYLOAD - 1;
+	}
+}
+
+/**
+ * Get the transfer totals since the model was reset.
+ *
+ * @param stats Output for the totals.
+ */
+void ami_smbus_loopback_get_stats (struct ami_smbus_loopback_stats *stats)
+{
+	*stats = loopback.stats;
+}
+
+/**
+ * Clock for the link layer timing.
+ *
+ * @return The virtual time in microseconds.
+ */
+uint64_t ami_smbus_loopback_now (void)
+{
+	return loopback.now_ns / 1000;
+}
+
+/**
+ * Delay for the link layer timing.  Only the virtual clock moves.
+ *
+ * @param delay_us Time to wait.
+ */
+void ami_smbus_loopback_delay (unsigned int delay_us)
+{
+	loopback.now_ns += delay_us * 1000ULL;
+}
+
+/**
+ * Account for bytes moved on the bus.
+ */
+static void ami_smbus_loopback_bus (size_t bytes)
+{
+	uint64_t ns = bytes * (uint64_t) AMI_SMBUS_LOOPBACK_NS_PER_BYTE;
+
+	loopback.now_ns += ns;
+	loopback.stats.bus_ns += ns;
+}
+
+/**
+ * Sum of a buffer, which is 0 for a buffer that ends with a valid checksum.
+ */
+static uint8_t ami_smbus_loopback_sum (const uint8_t *data, size_t length)
+{
+	uint8_t sum = 0;
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		sum += data[i];
+	}
+
+	return sum;
+}
+
+/**
+ * Start running the data layer request that was just received.
+ */
+static void ami_smbus_loopback_run (void)
+{
+	const struct ami_smbus_loopback_command *timing = &loopback.command[loopback.request[0]];
+	DATA_LAYER_PACKET_ACK *response = (DATA_LAYER_PACKET_ACK*) loopback.response;
+	uint64_t processing_ns = timing->processing_us * 1000ULL;
+	size_t i;
+
+	if (timing->jitter_us) {
+		loopback.seed ^= loopback.seed << 13;
+		loopback.seed ^= loopback.seed >> 17;
+		loopback.seed ^= loopback.seed << 5;
+		processing_ns += (loopback.seed % (timing->jitter_us + 1)) * 1000ULL;
+	}
+
+	memset (loopback.response, 0, sizeof (loopback.response));
+	response->Length = timing->response_length + 4;
+	response->AckCommand = loopback.request[0];
+	response->Flag = ACK_FLAG;
+	for (i = 0; i < timing->response_length; i++) {
+		response->PayLoad[i] = response->AckCommand ^ i;
+	}
+	response->PayLoad[i] = 0x100 - ami_smbus_loopback_sum (loopback.response,
+		response->Length - 1);
+
+	loopback.responding = true;
+	loopback.packet = 0;
+	loopback.packets = (response->Length + LINK_LAYER_MAX_RECEIVE_LOAD - 1) /
+		LINK_LAYER_MAX_RECEIVE_LOAD;
+	loopback.packet_ready_ns = (loopback.ack_needed ? loopback.ack_ready_ns : loopback.now_ns) +
+		processing_ns;
+}
+
+int i2c_smbus_write_block_data (int file, uint8_t command, uint8_t length, const uint8_t *values)
+{
+	uint8_t data[sizeof (LINK_LAYER_PACKET_MASTER) + 0x100];
+	LINK_LAYER_PACKET_MASTER *packet = (LINK_LAYER_PACKET_MASTER*) data;
+	size_t offset;
+
+	// Address, command, count and the block
+	ami_smbus_loopback_bus (3 + length);
+	loopback.stats.writes++;
+
+	memset (data, 0, sizeof (data));
+	data[0] = command;
+	data[1] = length;
+	memcpy (&data[2], values, length);
+	if ((length < 2) || (ami_smbus_loopback_sum (data, length + 2) != 0)) {
+		return -1;
+	}
+
+	if (packet->PackageType) {
+		// The host acks a response packet
+		if (loopback.responding && (packet->SubPackageIndex == loopback.packet)) {
+			loopback.packet++;
+			loopback.packet_ready_ns = loopback.now_ns + loopback.ack_ns;
+			loopback.responding = (loopback.packet < loopback.packets);
+		}
+		return 0;
+	}
+
+	offset = packet->SubPackageIndex * LINK_LAYER_MAX_LOAD;
+	if ((offset + length - 2) > sizeof (loopback.request)) {
+		return -1;
+	}
+
+	if (packet->SubPackageIndex == 0) {
+		loopback.responding = false;
+	}
+	memcpy (&loopback.request[offset], packet->PayLoad, length - 2);
+
+	loopback.session = packet->Command;
+	loopback.ack_needed = packet->AckNeeded;
+	loopback.ack_index = packet->SubPackageIndex;
+	loopback.ack_ready_ns = loopback.now_ns + loopback.ack_ns;
+
+	if ((packet->SubPackageIndex + 1) == packet->LastPackageIndex) {
+		ami_smbus_loopback_run ();
+	}
+
+	return 0;
+}
+
+int i2c_rdwr_msg_transfer (int file, uint8_t addr, uint8_t *tbuf, uint8_t tcount, uint8_t *rbuf,
+	uint8_t rcount)
+{
+	uint8_t data[sizeof (LINK_LAYER_PACKET_ACK_MASTER)];
+	LINK_LAYER_PACKET_ACK_MASTER *packet = (LINK_LAYER_PACKET_ACK_MASTER*) data;
+
+	// Address and command, then the address again for the read
+	ami_smbus_loopback_bus (tcount + 2);
+
+	memset (data, 0, sizeof (data));
+	packet->Length = sizeof (LINK_LAYER_PACKET_ACK_MASTER) - 1;
+	packet->Command = loopback.session;
+
+	if ((addr != (PLATFIRE_SLAVE_ADDRESS << 1)) || (tcount != 1) ||
+		(tbuf[0] != SMBUS_READ_COMMAND)) {
+		return -1;
+	}
+	else if (loopback.ack_needed && (loopback.now_ns >= loopback.ack_ready_ns)) {
+		packet->PackageType = 1;
+		packet->SubPackageIndex = loopback.ack_index;
+		packet->AckFlag = 1;
+		loopback.ack_needed = false;
+	}
+	else if (loopback.responding && (loopback.now_ns >= loopback.packet_ready_ns)) {
+		packet->AckNeeded = 1;
+		packet->SubPackageIndex = loopback.packet;
+		packet->AckFlag = loopback.packets;
+		memcpy (packet->PayLoad, &loopback.response[loopback.packet * LINK_LAYER_MAX_RECEIVE_LOAD],
+			LINK_LAYER_MAX_RECEIVE_LOAD);
+	}
+	else {
+		loopback.stats.busy_reads++;
+		return -1;
+	}
+
+	packet->CheckSum = 0x100 - ami_smbus_loopback_sum (data, sizeof (data) - 1);
+
+	ami_smbus_loopback_bus (rcount);
+	loopback.stats.reads++;
+	memcpy (rbuf, data, (rcount < sizeof (data)) ? rcount : sizeof (data));
+
+	return 0;
+}
+
+int kv_get (const char *key, char *value, size_t *len, unsigned int flags)
+{
+	int i;
+
+	for (i = 0; i < AMI_SMBUS_LOOPBACK_KV_ENTRIES; i++) {
+		if (strcmp (loopback.kv[i].key, key) == 0) {
+			strcpy (value, loopback.kv[i].value);
+			if (len) {
+				*len = strlen (value);
+			}
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+int kv_set (const char *key, const char *value, size_t len, unsigned int flags)
+{
+	struct ami_smbus_loopback_kv *entry = NULL;
+	int i;
+
+	if (len == 0) {
+		len = strlen (value);
+	}
+	if ((strlen (key) >= AMI_SMBUS_LOOPBACK_KV_LENGTH) || (len >= AMI_SMBUS_LOOPBACK_KV_LENGTH)) {
+		return -1;
+	}
+
+	for (i = 0; i < AMI_SMBUS_LOOPBACK_KV_ENTRIES; i++) {
+		if (strcmp (loopback.kv[i].key, key) == 0) {
+			entry = &loopback.kv[i];
+			break;
+		}
+		if ((entry == NULL) && (loopback.kv[i].key[0] == '\0')) {
+			entry = &loopback.kv[i];
+		}
+	}
+	if (entry == NULL) {
+		return -1;
+	}
+
+	strcpy (entry->key, key);
+	memcpy (entry->value, value, len);
+	entry->value[len] = '\0';
+
+	return 0;
+}
@@ -0,0 +1,51 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef AMI_SMBUS_LOOPBACK_H_
+#define AMI_SMBUS_LOOPBACK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Time to move one byte on the 100kHz SMBus, with its ack bit.
+ */
+#define	AMI_SMBUS_LOOPBACK_NS_PER_BYTE	90000
+
+
+/**
+ * Timing of one data layer command in the PlatFire model.
+ */
+struct ami_smbus_loopback_command {
+	uint32_t processing_us;				/**< Shortest time to run the command. */
+	uint32_t jitter_us;					/**< Most extra time added at random to each run. */
+	size_t response_length;				/**< Bytes of response payload. */
+};
+
+/**
+ * Transfer totals of the PlatFire model.
+ */
+struct ami_smbus_loopback_stats {
+	uint32_t writes;					/**< Number of block writes from the host. */
+	uint32_t reads;						/**< Number of reads the peer answered. */
+	uint32_t busy_reads;				/**< Number of reads made before the peer had an answer. */
+	uint64_t bus_ns;					/**< Modeled time the bus was busy. */
+};
+
+
+void ami_smbus_loopback_init (uint32_t ack_us, uint32_t seed);
+void ami_smbus_loopback_set_command (uint8_t command,
+	const struct ami_smbus_loopback_command *timing);
+void ami_smbus_loopback_get_stats (struct ami_smbus_loopback_stats *stats);
+
+uint64_t ami_smbus_loopback_now (void);
+void ami_smbus_loopback_delay (unsigned int delay_us);
+
+
+#endif /* AMI_SMBUS_LOOPBACK_H_ */
@@ -0,0 +1,23 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+/*
+ * Host stand-in for the OpenBMC key-value store, kept in memory by ami_smbus_loopback.c.
+ */
+
+#ifndef OBMC_KV_LOOPBACK_H_
+#define OBMC_KV_LOOPBACK_H_
+
+#include <stddef.h>
+
+
+int kv_get (const char *key, char *value, size_t *len, unsigned int flags);
+int kv_set (const char *key, const char *value, size_t len, unsigned int flags);
+
+
+#endif /* OBMC_KV_LOOPBACK_H_ */
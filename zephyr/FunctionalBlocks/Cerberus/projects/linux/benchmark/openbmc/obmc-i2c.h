@@ -0,0 +1,27 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+/*
+ * Host stand-in for the OpenBMC I2C library.  The AmiSmbus interface is built against it for the
+ * benchmark, and the transfers go to the PlatFire model in ami_smbus_loopback.c.
+ */
+
+#ifndef OBMC_I2C_LOOPBACK_H_
+#define OBMC_I2C_LOOPBACK_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+int i2c_smbus_write_block_data (int file, uint8_t command, uint8_t length, const uint8_t *values);
+int i2c_rdwr_msg_transfer (int file, uint8_t addr, uint8_t *tbuf, uint8_t tcount, uint8_t *rbuf,
+	uint8_t rcount);
+
+
+#endif /* OBMC_I2C_LOOPBACK_H_ */
@@ -0,0 +1,100 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+/*
+ * Debug log for the benchmark: the flash log on an emulated device of its own, so the time spent
+ * logging can be told apart from the flows' own flash accesses.
+ *
+ * This is separate from the rest of the platform because the flash log headers and the SPI engine
+ * wrapper headers cannot be used together.
+ */
+
+#include <string.h>
+#include "logging/logging_flash.h"
+#include "pfr_benchmark_platform.h"
+
+
+static struct emulated_flash pfr_benchmark_log_flash;
+static struct spi_flash pfr_benchmark_log_spi;
+static struct logging_flash pfr_benchmark_log;
+
+
+static int pfr_benchmark_log_read (struct flash *flash, uint32_t address, uint8_t *data,
+	size_t length)
+{
+	return pfr_benchmark_log_flash.base.read (&pfr_benchmark_log_flash.base, address, data, length);
+}
+
+static int pfr_benchmark_log_write (struct flash *flash, uint32_t address, const uint8_t *data,
+	size_t length)
+{
+	return pfr_benchmark_log_flash.base.write (&pfr_benchmark_log_flash.base, address, data,
+		length);
+}
+
+static int pfr_benchmark_log_sector_erase (struct flash *flash, uint32_t sector_addr)
+{
+	return pfr_benchmark_log_flash.base.sector_erase (&pfr_benchmark_log_flash.base, sector_addr);
+}
+
+/**
+ * Create an empty debug log on its own flash device.
+ *
+ * @param timing The flash timing model.
+ *
+ * @return 0 if the log was created or an error code.
+ */
+int pfr_benchmark_log_init (const struct emulated_flash_timing *timing)
+{
+	int status;
+
+	status = emulated_flash_init (&pfr_benchmark_log_flash, PFR_BENCHMARK_LOG_SIZE);
+	if (status != 0) {
+		return status;
+	}
+
+	pfr_benchmark_log_flash.timing = *timing;
+
+	memset (&pfr_benchmark_log_spi, 0, sizeof (pfr_benchmark_log_spi));
+	pfr_benchmark_log_spi.base.read = pfr_benchmark_log_read;
+	pfr_benchmark_log_spi.base.write = pfr_benchmark_log_write;
+	pfr_benchmark_log_spi.base.sector_erase = pfr_benchmark_log_sector_erase;
+
+	status = logging_flash_init (&pfr_benchmark_log, &pfr_benchmark_log_spi, 0);
+	if (status != 0) {
+		emulated_flash_release (&pfr_benchmark_log_flash);
+		return status;
+	}
+
+	return 0;
+}
+
+/**
+ * Release the debug log and its flash.
+ */
+void pfr_benchmark_log_release (void)
+{
+	logging_flash_release (&pfr_benchmark_log);
+	emulated_flash_release (&pfr_benchmark_log_flash);
+}
+
+/**
+ * Get the debug log.
+ */
+struct logging* pfr_benchmark_get_log (void)
+{
+	return &pfr_benchmark_log.base;
+}
+
+/**
+ * Get the flash device that holds the debug log.
+ */
+struct emulated_flash* pfr_benchmark_get_log_flash (void)
+{
+	return &pfr_benchmark_log_flash;
+}
@@ -0,0 +1,111 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CuTest/CuTest.h"
+#include "pfr_benchmark_platform.h"
+
+
+CuSuite* get_pfr_flow_benchmark_suite ();
+CuSuite* get_pfr_mailbox_benchmark_suite ();
+CuSuite* get_ami_smbus_benchmark_suite ();
+CuSuite* get_smc_event_loop_benchmark_suite ();
+CuSuite* get_pfr_pfm_index_benchmark_suite ();
+#ifdef PFR_BENCHMARK_ECDSA
+CuSuite* get_pfr_ecdsa_benchmark_suite ();
+#endif
+
+
+/**
+ * Command line option that overrides one field of the flash timing model.
+ */
+struct pfr_benchmark_option {
+	const char *name;					/**< Option name. */
+	uint32_t *value;					/**< Timing field set by the option. */
+	const char *help;					/**< Description of the option. */
+};
+
+
+static void pfr_benchmark_usage (const char *name, const struct pfr_benchmark_option *options)
+{
+	int i;
+
+	printf ("Usage: %s [option value]...\n\n", name);
+	printf ("Run the PFR flows on emulated flash.  Options set the flash timing model:\n");
+	for (i = 0; options[i].name; i++) {
+		printf ("  %-20s %s (default %u)\n", options[i].name, options[i].help,
+			*options[i].value);
+	}
+}
+
+int main (int argc, char **argv)
+{
+	struct emulated_flash_timing timing = emulated_flash_spi_nor_timing;
+	const struct pfr_benchmark_option options[] = {
+		{"--command-ns", &timing.command_ns, "Fixed cost of each command in ns"},
+		{"--read-ns-per-byte", &timing.read_ns_per_byte, "Read time for each byte in ns"},
+		{"--page-program-us", &timing.page_program_us, "Program time for a 256 byte page in us"},
+		{"--sector-erase-us", &timing.sector_erase_us, "4kB erase time in us"},
+		{"--block-erase-us", &timing.block_erase_us, "64kB erase time in us"},
+		{"--chip-erase-ms", &timing.chip_erase_ms, "Chip erase time in ms"},
+		{NULL, NULL, NULL}
+	};
+	CuString *output;
+	CuSuite *suite;
+	char *end;
+	int fail;
+	int i;
+	int j;
+
+	for (i = 1; i < argc; i += 2) {
+		for (j = 0; options[j].name; j++) {
+			if (strcmp (argv[i], options[j].name) == 0) {
+				break;
+			}
+		}
+
+		if (!options[j].name || ((i + 1) >= argc)) {
+			pfr_benchmark_usage (argv[0], options);
+			return 1;
+		}
+
+		*options[j].value = strtoul (argv[i + 1], &end, 0);
+		if (*end != '\0') {
+			pfr_benchmark_usage (argv[0], options);
+			return 1;
+		}
+	}
+
+	pfr_benchmark_set_timing (&timing);
+
+	setvbuf (stdout, NULL, _IONBF, 0);
+
+	output = CuStringNew ();
+	suite = CuSuiteNew ();
+	CuSuiteAddSuite (suite, get_pfr_flow_benchmark_suite ());
+	CuSuiteAddSuite (suite, get_pfr_mailbox_benchmark_suite ());
+	CuSuiteAddSuite (suite, get_ami_smbus_benchmark_suite ());
+	CuSuiteAddSuite (suite, get_smc_event_loop_benchmark_suite ());
+	CuSuiteAddSuite (suite, get_pfr_pfm_index_benchmark_suite ());
+#ifdef PFR_BENCHMARK_ECDSA
+	CuSuiteAddSuite (suite, get_pfr_ecdsa_benchmark_suite ());
+#endif
+
+	pfr_benchmark_print_header ();
+	CuSuiteRun (suite);
+	CuSuiteSummary (suite, output);
+	CuSuiteDetails (suite, output);
+	printf ("\n%s\n", output->buffer);
+	fail = suite->failCount;
+
+	CuStringDelete (output);
+	CuSuiteDelete (suite);
+	return fail;
+}
@@ -0,0 +1,634 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+/*
+ * Host implementation of the services the Intel PFR 2.0 modules expect from the board: the SPI
+ * engine wrapper and pfr_util flash helpers over emulated flash, the provisioning UFM, the hash
+ * engine, the SMBus mailbox registers and the console.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "platform.h"
+#include "pfr_benchmark_platform.h"
+#include "crypto/hash_openssl.h"
+#include "CommonFlash/CommonFlash.h"
+#include "pfr/pfr_common.h"
+#include "pfr/pfr_util.h"
+#include "pfr/pfr_hash.h"
+#include "pfr/pfr_measurement_cache.h"
+#include "pfr/pfr_spi_copy.h"
+#include "pfr/pfr_ufm.h"
+#include "state_machine/common_smc.h"
+#include "intel_pfr_definitions.h"
+#include "intel_pfr_verification.h"
+
+
+static struct emulated_flash pfr_benchmark_flash[PFR_BENCHMARK_DEVICES];
+static struct SpiEngine pfr_benchmark_spi;
+static struct hash_engine_openssl pfr_benchmark_hash;
+static uint8_t pfr_benchmark_ufm[PFR_BENCHMARK_UFM_SIZE];
+static struct timespec pfr_benchmark_start_time;
+static struct emulated_flash_timing pfr_benchmark_timing;
+static struct emulated_flash pfr_benchmark_state;
+static struct pfr_measurement_cache pfr_benchmark_measurement[PFR_BENCHMARK_DEVICES];
+static uint64_t pfr_benchmark_console_bytes;
+
+static uint8_t pfr_benchmark_pfm_active_svn[PFR_BENCHMARK_DEVICES];
+
+
+/*******************
+ * SPI engine wrapper
+ *******************/
+
+/**
+ * Get the emulated flash the SPI engine is currently pointed at.
+ */
+static struct flash* pfr_benchmark_spi_target (void)
+{
+	return &pfr_benchmark_flash[pfr_benchmark_spi.spi.device_id[0] % PFR_BENCHMARK_DEVICES].base;
+}
+
+static int pfr_benchmark_spi_get_device_size (struct flash *flash, uint32_t *bytes)
+{
+	struct flash *target = pfr_benchmark_spi_target ();
+
+	return target->get_device_size (target, bytes);
+}
+
+static int pfr_benchmark_spi_read (struct flash *flash, uint32_t address, uint8_t *data,
+	size_t length)
+{
+	struct flash *target = pfr_benchmark_spi_target ();
+
+	return target->read (target, address, data, length);
+}
+
+static int pfr_benchmark_spi_get_page_size (struct flash *flash, uint32_t *bytes)
+{
+	struct flash *target = pfr_benchmark_spi_target ();
+
+	return target->get_page_size (target, bytes);
+}
+
+static int pfr_benchmark_spi_minimum_write_per_page (struct flash *flash, uint32_t *bytes)
+{
+	struct flash *target = pfr_benchmark_spi_target ();
+
+	return target->minimum_write_per_page (target, bytes);
+}
+
+static int pfr_benchmark_spi_write (struct flash *flash, uint32_t address, const uint8_t *data,
+	size_t length)
+{
+	struct flash *target = pfr_benchmark_spi_target ();
+
+	return target->write (target, address, data, length);
+}
+
+static int pfr_benchmark_spi_get_sector_size (struct flash *flash, uint32_t *bytes)
+{
+	struct flash *target = pfr_benchmark_spi_target ();
+
+	return target->get_sector_size (target, bytes);
+}
+
+static int pfr_benchmark_spi_sector_erase (struct flash *flash, uint32_t sector_addr)
+{
+	struct flash *target = pfr_benchmark_spi_target ();
+
+	return target->sector_erase (target, sector_addr);
+}
+
+static int pfr_benchmark_spi_get_block_size (struct flash *flash, uint32_t *bytes)
+{
+	struct flash *target = pfr_benchmark_spi_target ();
+
+	return target->get_block_size (target, bytes);
+}
+
+static int pfr_benchmark_spi_block_erase (struct flash *flash, uint32_t block_addr)
+{
+	struct flash *target = pfr_benchmark_spi_target ();
+
+	return target->block_erase (target, block_addr);
+}
+
+static int pfr_benchmark_spi_chip_erase (struct flash *flash)
+{
+	struct flash *target = pfr_benchmark_spi_target ();
+
+	return target->chip_erase (target);
+}
+
+
+struct SpiEngine* getSpiEngineWrapper (void)
+{
+	return &pfr_benchmark_spi;
+}
+
+struct hash_engine* get_hash_engine_instance (void)
+{
+	return &pfr_benchmark_hash.base;
+}
+
+
+/*******************
+ * pfr_util
+ *******************/
+
+int pfr_spi_read (unsigned int device_id, unsigned int address, unsigned int data_length,
+	unsigned char *data)
+{
+	pfr_benchmark_spi.spi.device_id[0] = device_id;
+	if (pfr_benchmark_spi.spi.base.read (&pfr_benchmark_spi.spi.base, address, data,
+		data_length) != 0) {
+		return Failure;
+	}
+
+	return Success;
+}
+
+int pfr_spi_write (unsigned int device_id, unsigned int address, unsigned int data_length,
+	unsigned char *data)
+{
+	pfr_benchmark_spi.spi.device_id[0] = device_id;
+	if (pfr_benchmark_spi.spi.base.write (&pfr_benchmark_spi.spi.base, address, data,
+		data_length) != (int) data_length) {
+		return Failure;
+	}
+
+	return Success;
+}
+
+int pfr_spi_erase_4k (unsigned int device_id, unsigned int address)
+{
+	pfr_benchmark_spi.spi.device_id[0] = device_id;
+	if (pfr_benchmark_spi.spi.base.sector_erase (&pfr_benchmark_spi.spi.base, address) != 0) {
+		return Failure;
+	}
+
+	return Success;
+}
+
+int pfr_spi_erase_64k (unsigned int device_id, unsigned int address)
+{
+	pfr_benchmark_spi.spi.device_id[0] = device_id;
+	if (pfr_benchmark_spi.spi.base.block_erase (&pfr_benchmark_spi.spi.base, address) != 0) {
+		return Failure;
+	}
+
+	return Success;
+}
+
+int pfr_spi_page_read_write_between_spi (int source_flash, uint32_t *source_address,
+	int target_flash, uint32_t *target_address)
+{
+	uint8_t buffer[PAGE_SIZE];
+
+	if (pfr_spi_read (source_flash, *source_address, sizeof (buffer), buffer) != Success) {
+		return Failure;
+	}
+
+	if (pfr_spi_write (target_flash, *target_address, sizeof (buffer), buffer) != Success) {
+		return Failure;
+	}
+
+	*source_address += sizeof (buffer);
+	*target_address += sizeof (buffer);
+
+	return Success;
+}
+
+int pfr_spi_page_read_write (unsigned int device_id, uint32_t *source_address,
+	uint32_t *target_address)
+{
+	return pfr_spi_page_read_write_between_spi (device_id, source_address, device_id,
+		target_address);
+}
+
+int pfr_spi_copy_between_spi (int source_flash, uint32_t source_address, int target_flash,
+	uint32_t target_address, uint32_t length)
+{
+	static uint8_t buffer[PFR_BENCHMARK_COPY_BUFFER_SIZE];
+
+	if (pfr_spi_copy (&pfr_benchmark_flash[source_flash % PFR_BENCHMARK_DEVICES].base,
+		source_address, &pfr_benchmark_flash[target_flash % PFR_BENCHMARK_DEVICES].base,
+		target_address, length, PFR_SPI_COPY_ERASE_4K | PFR_SPI_COPY_ERASE_64K, buffer,
+		sizeof (buffer)) != 0) {
+		return Failure;
+	}
+
+	return Success;
+}
+
+int get_buffer_hash (struct pfr_manifest *manifest, uint8_t *data_buffer, uint32_t length,
+	unsigned char *hash_out)
+{
+	enum hash_type type;
+
+	if (manifest->hash_curve == secp256r1) {
+		type = HASH_TYPE_SHA256;
+	}
+	else if (manifest->hash_curve == secp384r1) {
+		type = HASH_TYPE_SHA384;
+	}
+	else {
+		return Failure;
+	}
+
+	if (pfr_hash_buffer (manifest->hash, type, data_buffer, length, hash_out,
+		pfr_hash_digest_length (type)) != 0) {
+		return Failure;
+	}
+
+	return Success;
+}
+
+int get_hash (struct manifest *manifest, struct hash_engine *hash_engine, uint8_t *hash_out,
+	size_t hash_length)
+{
+	struct pfr_manifest *pfr_manifest = (struct pfr_manifest*) manifest;
+
+	if (pfr_manifest == NULL) {
+		return Failure;
+	}
+
+	if (pfr_hash_region (&pfr_manifest->flash->base, hash_engine, pfr_manifest->pfr_hash->type,
+		pfr_manifest->pfr_hash->start_address, pfr_manifest->pfr_hash->length, hash_out,
+		hash_length) != 0) {
+		return Failure;
+	}
+
+	return Success;
+}
+
+int compare_buffer (uint8_t *buffer1, uint8_t *buffer2, uint32_t length)
+{
+	return (memcmp (buffer1, buffer2, length) == 0) ? Success : Failure;
+}
+
+
+/*******************
+ * Provisioning, keys and mailbox
+ *******************/
+
+int ufm_read (uint32_t ufm_id, uint32_t offset, uint8_t *data, uint32_t data_length)
+{
+	if ((ufm_id != PROVISION_UFM) || (offset > sizeof (pfr_benchmark_ufm)) ||
+		(data_length > (sizeof (pfr_benchmark_ufm) - offset))) {
+		return Failure;
+	}
+
+	memcpy (data, &pfr_benchmark_ufm[offset], data_length);
+
+	return Success;
+}
+
+/**
+ * The measurements are kept on a separate RoT flash, so they are not counted with the host
+ * flash accesses.
+ */
+struct pfr_measurement_cache* get_measurement_cache (uint32_t image_type)
+{
+	return &pfr_benchmark_measurement[image_type % PFR_BENCHMARK_DEVICES];
+}
+
+void get_provision_data_in_flash (uint32_t addr, uint8_t *DataBuffer, uint32_t length)
+{
+	ufm_read (PROVISION_UFM, addr, DataBuffer, length);
+}
+
+int get_ufm_svn (struct pfr_manifest *manifest, uint8_t offset)
+{
+	return 0;
+}
+
+int set_ufm_svn (struct pfr_manifest *manifest, uint8_t ufm_location, uint8_t svn_number)
+{
+	return Success;
+}
+
+/* The root key hash and key cancellation policy are not part of the modeled flows. */
+int verify_root_key_entry (struct pfr_manifest *manifest,
+	PFR_AUTHENTICATION_BLOCK1 *block1_buffer)
+{
+	return Success;
+}
+
+int validate_key_cancellation_flag (struct pfr_manifest *manifest)
+{
+	manifest->kc_flag = 0;
+
+	return Success;
+}
+
+/* Recovery capsule authentication is driven directly by the benchmark flows. */
+int pfr_recovery_verify (struct pfr_manifest *manifest)
+{
+	return Failure;
+}
+
+uint8_t GetBmcPfmActiveSvn (void)
+{
+	return pfr_benchmark_pfm_active_svn[BMC_TYPE];
+}
+
+uint8_t GetPchPfmActiveSvn (void)
+{
+	return pfr_benchmark_pfm_active_svn[PCH_TYPE];
+}
+
+void SetBmcPfmActiveSvn (uint8_t svn)
+{
+	pfr_benchmark_pfm_active_svn[BMC_TYPE] = svn;
+}
+
+void SetPchPfmActiveSvn (uint8_t svn)
+{
+	pfr_benchmark_pfm_active_svn[PCH_TYPE] = svn;
+}
+
+void SetBmcPfmActiveMajorVersion (uint8_t version)
+{
+}
+
+void SetBmcPfmActiveMinorVersion (uint8_t version)
+{
+}
+
+void SetPchPfmActiveMajorVersion (uint8_t version)
+{
+}
+
+void SetPchPfmActiveMinorVersion (uint8_t version)
+{
+}
+
+void SetBmcPfmRecoverSvn (uint8_t svn)
+{
+}
+
+void SetBmcPfmRecoverMajorVersion (uint8_t version)
+{
+}
+
+void SetBmcPfmRecoverMinorVersion (uint8_t version)
+{
+}
+
+void SetPchPfmRecoverSvn (uint8_t svn)
+{
+}
+
+void SetPchPfmRecoverMajorVersion (uint8_t version)
+{
+}
+
+void SetPchPfmRecoverMinorVersion (uint8_t version)
+{
+}
+
+void SetCpldFpgaRotHash (uint8_t *hash)
+{
+}
+
+int printk (const char *format, ...)
+{
+	va_list args;
+	int length;
+
+	/* Count what would go out on the console instead of printing it. */
+	va_start (args, format);
+	length = vsnprintf (NULL, 0, format, args);
+	va_end (args);
+
+	if (length > 0) {
+		pfr_benchmark_console_bytes += length;
+	}
+
+	return length;
+}
+
+
+/*******************
+ * Benchmark platform
+ *******************/
+
+/**
+ * Set the timing model used by flash devices created after this call.
+ *
+ * @param timing The flash timing model.
+ */
+void pfr_benchmark_set_timing (const struct emulated_flash_timing *timing)
+{
+	pfr_benchmark_timing = *timing;
+}
+
+/**
+ * Create the host flash devices and engines used by the PFR modules.
+ *
+ * @param sizes Size of the flash for each image type.
+ *
+ * @return 0 if the platform was initialized or an error code.
+ */
+int pfr_benchmark_platform_init (const uint32_t *sizes)
+{
+	int status;
+	int i;
+
+	memset (pfr_benchmark_ufm, 0xff, sizeof (pfr_benchmark_ufm));
+
+	for (i = 0; i < PFR_BENCHMARK_DEVICES; i++) {
+		status = emulated_flash_init (&pfr_benchmark_flash[i], sizes[i]);
+		if (status != 0) {
+			while (i--) {
+				emulated_flash_release (&pfr_benchmark_flash[i]);
+			}
+			return status;
+		}
+
+		pfr_benchmark_flash[i].timing = pfr_benchmark_timing;
+	}
+
+	status = emulated_flash_init (&pfr_benchmark_state, PFR_BENCHMARK_STATE_SIZE);
+	if (status != 0) {
+		for (i = 0; i < PFR_BENCHMARK_DEVICES; i++) {
+			emulated_flash_release (&pfr_benchmark_flash[i]);
+		}
+		return status;
+	}
+
+	for (i = 0; i < PFR_BENCHMARK_DEVICES; i++) {
+		pfr_measurement_cache_init (&pfr_benchmark_measurement[i], &pfr_benchmark_state.base,
+			(i + 1) * PFR_MEASUREMENT_CACHE_SIZE);
+	}
+
+	status = pfr_benchmark_log_init (&pfr_benchmark_timing);
+	if (status != 0) {
+		for (i = 0; i < PFR_BENCHMARK_DEVICES; i++) {
+			emulated_flash_release (&pfr_benchmark_flash[i]);
+		}
+		emulated_flash_release (&pfr_benchmark_state);
+		return status;
+	}
+
+	status = hash_openssl_init (&pfr_benchmark_hash);
+	if (status != 0) {
+		pfr_benchmark_platform_release ();
+		return status;
+	}
+
+	memset (&pfr_benchmark_spi, 0, sizeof (pfr_benchmark_spi));
+	pfr_benchmark_spi.spi.base.get_device_size = pfr_benchmark_spi_get_device_size;
+	pfr_benchmark_spi.spi.base.read = pfr_benchmark_spi_read;
+	pfr_benchmark_spi.spi.base.get_page_size = pfr_benchmark_spi_get_page_size;
+	pfr_benchmark_spi.spi.base.minimum_write_per_page = pfr_benchmark_spi_minimum_write_per_page;
+	pfr_benchmark_spi.spi.base.write = pfr_benchmark_spi_write;
+	pfr_benchmark_spi.spi.base.get_sector_size = pfr_benchmark_spi_get_sector_size;
+	pfr_benchmark_spi.spi.base.sector_erase = pfr_benchmark_spi_sector_erase;
+	pfr_benchmark_spi.spi.base.get_block_size = pfr_benchmark_spi_get_block_size;
+	pfr_benchmark_spi.spi.base.block_erase = pfr_benchmark_spi_block_erase;
+	pfr_benchmark_spi.spi.base.chip_erase = pfr_benchmark_spi_chip_erase;
+
+	return 0;
+}
+
+/**
+ * Release the host flash devices and engines.
+ */
+void pfr_benchmark_platform_release (void)
+{
+	int i;
+
+	for (i = 0; i < PFR_BENCHMARK_DEVICES; i++) {
+		emulated_flash_release (&pfr_benchmark_flash[i]);
+	}
+
+	emulated_flash_release (&pfr_benchmark_state);
+	pfr_benchmark_log_release ();
+	hash_openssl_release (&pfr_benchmark_hash);
+}
+
+/**
+ * Get the emulated flash that holds an image.
+ *
+ * @param image_type BMC_TYPE or PCH_TYPE.
+ *
+ * @return The flash device.
+ */
+struct emulated_flash* pfr_benchmark_get_flash (uint32_t image_type)
+{
+	return &pfr_benchmark_flash[image_type % PFR_BENCHMARK_DEVICES];
+}
+
+/**
+ * Get the hash engine used by the PFR modules.
+ */
+struct hash_engine* pfr_benchmark_get_hash (void)
+{
+	return &pfr_benchmark_hash.base;
+}
+
+/**
+ * Get the SPI flash interface that follows the device selected by the last pfr_util access.
+ */
+struct spi_flash* pfr_benchmark_get_spi (void)
+{
+	return &pfr_benchmark_spi.spi;
+}
+
+/**
+ * Store a 32-bit provisioning value in the UFM.
+ *
+ * @param offset Offset of the value, such as PCH_ACTIVE_PFM_OFFSET.
+ * @param value The value to store.
+ */
+void pfr_benchmark_set_provision (uint32_t offset, uint32_t value)
+{
+	if (offset <= (sizeof (pfr_benchmark_ufm) - sizeof (value))) {
+		memcpy (&pfr_benchmark_ufm[offset], &value, sizeof (value));
+	}
+}
+
+/**
+ * Start measuring a flow.  All access counters are cleared.
+ */
+void pfr_benchmark_start (void)
+{
+	int i;
+
+	for (i = 0; i < PFR_BENCHMARK_DEVICES; i++) {
+		emulated_flash_reset_counters (&pfr_benchmark_flash[i]);
+	}
+
+	emulated_flash_reset_counters (pfr_benchmark_get_log_flash ());
+	pfr_benchmark_console_bytes = 0;
+
+	clock_gettime (CLOCK_MONOTONIC, &pfr_benchmark_start_time);
+}
+
+/**
+ * Stop measuring a flow.
+ *
+ * @param stats Output for the totals across the host flash devices, the log and the console.
+ */
+void pfr_benchmark_stop (struct pfr_benchmark_stats *stats)
+{
+	struct timespec now;
+	int i;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+
+	memset (stats, 0, sizeof (struct pfr_benchmark_stats));
+	stats->wall_ns = ((now.tv_sec - pfr_benchmark_start_time.tv_sec) * 1000000000ULL) +
+		now.tv_nsec - pfr_benchmark_start_time.tv_nsec;
+
+	for (i = 0; i < PFR_BENCHMARK_DEVICES; i++) {
+		stats->flash_ns += pfr_benchmark_flash[i].busy_ns;
+		stats->reads += pfr_benchmark_flash[i].reads;
+		stats->bytes_read += pfr_benchmark_flash[i].bytes_read;
+		stats->writes += pfr_benchmark_flash[i].writes;
+		stats->bytes_written += pfr_benchmark_flash[i].bytes_written;
+		stats->sector_erases += pfr_benchmark_flash[i].sector_erases;
+		stats->block_erases += pfr_benchmark_flash[i].block_erases;
+		stats->chip_erases += pfr_benchmark_flash[i].chip_erases;
+	}
+
+	stats->log_ns = pfr_benchmark_get_log_flash ()->busy_ns;
+	stats->console_bytes = pfr_benchmark_console_bytes;
+	stats->console_ns = pfr_benchmark_console_bytes * PFR_BENCHMARK_CONSOLE_NS_PER_BYTE;
+}
+
+/**
+ * Print the column headings of the benchmark report.
+ */
+void pfr_benchmark_print_header (void)
+{
+	printf ("%-28s %10s %12s %9s %12s %8s %12s %7s %7s %5s %8s %10s\n", "flow", "wall ms",
+		"flash ms", "reads", "read bytes", "writes", "write bytes", "4k ers", "64k ers", "chip",
+		"log ms", "console ms");
+}
+
+/**
+ * Print the totals of one flow as a row of the benchmark report.
+ *
+ * @param flow Name of the flow.
+ * @param stats The totals to print.
+ */
+void pfr_benchmark_print (const char *flow, const struct pfr_benchmark_stats *stats)
+{
+	printf ("%-28s %10.2f %12.2f %9u %12llu %8u %12llu %7u %7u %5u %8.2f %10.2f\n", flow,
+		stats->wall_ns / 1000000.0, stats->flash_ns / 1000000.0, stats->reads,
+		(unsigned long long) stats->bytes_read, stats->writes,
+		(unsigned long long) stats->bytes_written, stats->sector_erases, stats->block_erases,
+		stats->chip_erases, stats->log_ns / 1000000.0, stats->console_ns / 1000000.0);
+}
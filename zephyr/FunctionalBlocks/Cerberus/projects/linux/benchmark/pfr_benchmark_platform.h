@@ -0,0 +1,92 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef PFR_BENCHMARK_PLATFORM_H_
+#define PFR_BENCHMARK_PLATFORM_H_
+
+#include <stdint.h>
+#include "crypto/hash.h"
+#include "emulated_flash.h"
+#include "logging/logging.h"
+
+
+struct spi_flash;
+
+
+/**
+ * Number of host flash devices, indexed by image type.
+ */
+#define	PFR_BENCHMARK_DEVICES			2
+
+/**
+ * Size of the provisioning UFM.
+ */
+#define	PFR_BENCHMARK_UFM_SIZE			256
+
+/**
+ * Size of the RoT state flash that holds the SPI region measurements.
+ */
+#define	PFR_BENCHMARK_STATE_SIZE		0x10000
+
+/**
+ * Size of the buffer for bulk copies between flash devices, the same as the target.
+ */
+#define	PFR_BENCHMARK_COPY_BUFFER_SIZE	0x8000
+
+/**
+ * Size of the RoT flash that holds the debug log.
+ */
+#define	PFR_BENCHMARK_LOG_SIZE			0x10000
+
+/**
+ * Time to send one character on the 115200 baud console, with start and stop bits.
+ */
+#define	PFR_BENCHMARK_CONSOLE_NS_PER_BYTE	86806
+
+
+/**
+ * Access totals for one benchmarked flow.
+ */
+struct pfr_benchmark_stats {
+	uint64_t wall_ns;					/**< Host time spent running the flow. */
+	uint64_t flash_ns;					/**< Modeled time the flash devices were busy. */
+	uint32_t reads;						/**< Number of SPI read transactions. */
+	uint64_t bytes_read;				/**< Number of bytes read. */
+	uint32_t writes;					/**< Number of SPI program transactions. */
+	uint64_t bytes_written;				/**< Number of bytes programmed. */
+	uint32_t sector_erases;				/**< Number of 4kB erases. */
+	uint32_t block_erases;				/**< Number of 64kB erases. */
+	uint32_t chip_erases;				/**< Number of chip erases. */
+	uint64_t log_ns;					/**< Modeled time the log flash was busy. */
+	uint64_t console_bytes;				/**< Number of characters printed to the console. */
+	uint64_t console_ns;				/**< Modeled time spent printing to the console. */
+};
+
+
+void pfr_benchmark_set_timing (const struct emulated_flash_timing *timing);
+int pfr_benchmark_platform_init (const uint32_t *sizes);
+void pfr_benchmark_platform_release (void);
+
+struct emulated_flash* pfr_benchmark_get_flash (uint32_t image_type);
+struct hash_engine* pfr_benchmark_get_hash (void);
+struct spi_flash* pfr_benchmark_get_spi (void);
+
+int pfr_benchmark_log_init (const struct emulated_flash_timing *timing);
+void pfr_benchmark_log_release (void);
+struct logging* pfr_benchmark_get_log (void);
+struct emulated_flash* pfr_benchmark_get_log_flash (void);
+
+void pfr_benchmark_set_provision (uint32_t offset, uint32_t value);
+
+void pfr_benchmark_start (void);
+void pfr_benchmark_stop (struct pfr_benchmark_stats *stats);
+void pfr_benchmark_print_header (void);
+void pfr_benchmark_print (const char *flow, const struct pfr_benchmark_stats *stats);
+
+
+#endif /* PFR_BENCHMARK_PLATFORM_H_ */
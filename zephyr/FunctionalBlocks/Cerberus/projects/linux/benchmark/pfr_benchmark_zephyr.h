@@ -0,0 +1,22 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+/*
+ * Zephyr utility macros used by the Intel PFR modules, for building them on the host.  This is
+ * included ahead of each Intel PFR source file.
+ */
+
+#ifndef PFR_BENCHMARK_ZEPHYR_H_
+#define PFR_BENCHMARK_ZEPHYR_H_
+
+#ifndef ARG_UNUSED
+#define	ARG_UNUSED(x)		(void) (x)
+#endif
+
+
+#endif /* PFR_BENCHMARK_ZEPHYR_H_ */
@@ -0,0 +1,223 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+/*
+ * Times ECDSA verification with mbedTLS alone and through the backend dispatcher, with P-384
+ * routed to a pass-through backend that stands in for the crypto engine.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include "testing.h"
+#include "pfr_ecdsa.h"
+
+
+static const char *SUITE = "pfr_ecdsa_benchmark";
+
+
+/**
+ * Number of verifications timed for each curve and backend list.
+ */
+#define	PFR_ECDSA_BENCHMARK_LOOPS		32
+
+
+/* Raw big-endian key, digest and signature values generated with OpenSSL. */
+static const uint8_t pfr_ecdsa_benchmark_p256_x[] = {
+	0x7f, 0x76, 0xde, 0x8c, 0x41, 0x67, 0x3a, 0xe4,
+	0xbe, 0x2f, 0xd6, 0xa9, 0x15, 0x66, 0xe8, 0x22,
+	0xc7, 0xf6, 0x21, 0x5d, 0x70, 0x95, 0x8e, 0xb4,
+	0x5f, 0x08, 0x35, 0xbc, 0x8a, 0xf6, 0x33, 0xb6
+};
+
+static const uint8_t pfr_ecdsa_benchmark_p256_y[] = {
+	0x7c, 0xd8, 0xbc, 0x23, 0xa6, 0x57, 0x7b, 0x88,
+	0xcd, 0x2e, 0x15, 0x1e, 0x69, 0xc7, 0xf0, 0x3d,
+	0x81, 0x45, 0xde, 0x4c, 0x43, 0x39, 0x9e, 0x06,
+	0xe1, 0x3b, 0xa1, 0xac, 0x6d, 0x73, 0xad, 0xea
+};
+
+static const uint8_t pfr_ecdsa_benchmark_p256_digest[] = {
+	0x9f, 0x41, 0x6d, 0xc4, 0xfd, 0xf8, 0xbb, 0x31,
+	0xa6, 0xc2, 0x8a, 0x25, 0x03, 0xf2, 0x0e, 0x96,
+	0x5c, 0x6f, 0x5f, 0xb2, 0x75, 0x59, 0xc2, 0x03,
+	0xd7, 0x67, 0xea, 0xd3, 0x1c, 0x44, 0x13, 0x71
+};
+
+static const uint8_t pfr_ecdsa_benchmark_p256_r[] = {
+	0xe1, 0xf2, 0xbf, 0x2a, 0xc1, 0x80, 0x96, 0x45,
+	0x21, 0x46, 0x43, 0x3f, 0x2d, 0x30, 0x13, 0x5b,
+	0xbd, 0x89, 0x6d, 0xdd, 0xdc, 0xbb, 0x08, 0x3c,
+	0x7b, 0x07, 0x4b, 0x70, 0xd8, 0xc8, 0xac, 0xcf
+};
+
+static const uint8_t pfr_ecdsa_benchmark_p256_s[] = {
+	0x0d, 0x05, 0x6d, 0xb4, 0x9a, 0xa7, 0x1a, 0xe9,
+	0x11, 0x57, 0xd1, 0x05, 0xc5, 0x32, 0x1e, 0xa5,
+	0x2f, 0x0b, 0xd6, 0x77, 0x85, 0x80, 0x43, 0x4b,
+	0xe6, 0x24, 0xfd, 0x0e, 0x65, 0x33, 0xe2, 0x7b
+};
+
+static const uint8_t pfr_ecdsa_benchmark_p384_x[] = {
+	0xc8, 0x3d, 0x4f, 0xcc, 0x99, 0xca, 0x7a, 0xe6,
+	0x8c, 0x59, 0x93, 0x8f, 0xa5, 0x77, 0xdb, 0x85,
+	0x39, 0x9e, 0x78, 0x06, 0x2c, 0x03, 0xbc, 0x08,
+	0x47, 0x8d, 0xd7, 0x52, 0x19, 0x71, 0xd0, 0x0b,
+	0x6e, 0x46, 0x08, 0x0c, 0x7a, 0x76, 0xb7, 0xa8,
+	0x74, 0xe6, 0xb7, 0x35, 0x33, 0xb0, 0x59, 0x8f
+};
+
+static const uint8_t pfr_ecdsa_benchmark_p384_y[] = {
+	0x8d, 0x8b, 0x4f, 0x21, 0xaa, 0xe8, 0x6e, 0x9f,
+	0x55, 0x7c, 0xb4, 0x1a, 0x94, 0x4c, 0x60, 0x70,
+	0xf6, 0x6b, 0x65, 0x04, 0xfb, 0x27, 0x8f, 0x1f,
+	0xfd, 0x5f, 0xf2, 0x48, 0xfe, 0xf8, 0xe4, 0x9d,
+	0x11, 0xe6, 0x07, 0x2e, 0x2d, 0x9d, 0xd6, 0x9a,
+	0x12, 0xfb, 0xe6, 0xc8, 0xdb, 0x7a, 0x54, 0x0c
+};
+
+static const uint8_t pfr_ecdsa_benchmark_p384_digest[] = {
+	0xbb, 0x63, 0xc7, 0xe3, 0x5d, 0x6f, 0x51, 0x91,
+	0x09, 0x36, 0x4f, 0x4d, 0x0b, 0x55, 0xe7, 0x1b,
+	0x88, 0x38, 0x8a, 0xe1, 0xb9, 0x92, 0x4b, 0x27,
+	0x3e, 0xff, 0xbb, 0x3c, 0xcc, 0xc3, 0x87, 0x29,
+	0x8f, 0x37, 0x2e, 0x40, 0x94, 0x45, 0xbb, 0x2d,
+	0x5f, 0x6d, 0x24, 0xfb, 0xf5, 0x2f, 0x5c, 0xbf
+};
+
+static const uint8_t pfr_ecdsa_benchmark_p384_r[] = {
+	0x8f, 0xa2, 0x4b, 0x92, 0x34, 0x37, 0x78, 0xb6,
+	0x79, 0x7e, 0x57, 0x15, 0x21, 0xbf, 0x10, 0xef,
+	0x48, 0x69, 0x72, 0x00, 0x7f, 0x23, 0x96, 0xd7,
+	0xf6, 0x2e, 0xbd, 0xf9, 0xa9, 0xc4, 0x04, 0xcd,
+	0x51, 0x43, 0xd3, 0xac, 0x57, 0x0c, 0x26, 0x7c,
+	0x6a, 0x1f, 0x94, 0xb7, 0x2a, 0x4c, 0x54, 0x8b
+};
+
+static const uint8_t pfr_ecdsa_benchmark_p384_s[] = {
+	0xca, 0xdc, 0xa2, 0x66, 0x99, 0x1f, 0x54, 0x61,
+	0x83, 0xc8, 0xba, 0xa7, 0x24, 0x9d, 0x03, 0xa1,
+	0x0e, 0x68, 0x51, 0x4d, 0x56, 0x0f, 0x21, 0xb8,
+	0xd9, 0x39, 0x54, 0x6c, 0x8c, 0xec, 0x46, 0x89,
+	0xcb, 0x9f, 0xf6, 0xf5, 0x7b, 0x43, 0xd8, 0xb6,
+	0x4a, 0x64, 0x6f, 0x3b, 0x9c, 0xeb, 0xe1, 0xee
+};
+
+
+/**
+ * Signature to verify for one curve.
+ */
+struct pfr_ecdsa_benchmark_vector {
+	enum pfr_ecdsa_curve curve;
+	const char *name;
+	const uint8_t *x;
+	const uint8_t *y;
+	const uint8_t *digest;
+	const uint8_t *r;
+	const uint8_t *s;
+};
+
+static const struct pfr_ecdsa_benchmark_vector pfr_ecdsa_benchmark_vectors[] = {
+	{
+		PFR_ECDSA_CURVE_P256, "P-256", pfr_ecdsa_benchmark_p256_x, pfr_ecdsa_benchmark_p256_y,
+		pfr_ecdsa_benchmark_p256_digest, pfr_ecdsa_benchmark_p256_r, pfr_ecdsa_benchmark_p256_s
+	},
+	{
+		PFR_ECDSA_CURVE_P384, "P-384", pfr_ecdsa_benchmark_p384_x, pfr_ecdsa_benchmark_p384_y,
+		pfr_ecdsa_benchmark_p384_digest, pfr_ecdsa_benchmark_p384_r, pfr_ecdsa_benchmark_p384_s
+	},
+};
+
+#define	PFR_ECDSA_BENCHMARK_VECTOR_COUNT	\
+	(sizeof (pfr_ecdsa_benchmark_vectors) / sizeof (pfr_ecdsa_benchmark_vectors[0]))
+
+
+/**
+ * Engine stand-in that hands the verification to mbedTLS.
+ */
+static int pfr_ecdsa_benchmark_engine_verify (const struct pfr_ecdsa_backend *backend,
+	enum pfr_ecdsa_curve curve, const uint8_t *x, const uint8_t *y, const uint8_t *digest,
+	const uint8_t *r, const uint8_t *s)
+{
+	return pfr_ecdsa_mbedtls_backend.verify (&pfr_ecdsa_mbedtls_backend, curve, x, y, digest, r,
+		s);
+}
+
+static const struct pfr_ecdsa_backend pfr_ecdsa_benchmark_engine = {
+	.name = "engine",
+	.curves = PFR_ECDSA_CURVE_MASK (PFR_ECDSA_CURVE_P384),
+	.verify = pfr_ecdsa_benchmark_engine_verify,
+};
+
+/**
+ * Verify a signature repeatedly and get the average time for one verification.
+ *
+ * @param test The test framework.
+ * @param backends The backends to use.
+ * @param count The number of backends.
+ * @param vector The signature to verify.
+ *
+ * @return The time for one verification in ns.
+ */
+static uint64_t pfr_ecdsa_benchmark_run (CuTest *test,
+	const struct pfr_ecdsa_backend *const *backends, size_t count,
+	const struct pfr_ecdsa_benchmark_vector *vector)
+{
+	struct timespec start;
+	struct timespec end;
+	int status;
+	int i;
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+	for (i = 0; i < PFR_ECDSA_BENCHMARK_LOOPS; i++) {
+		status = pfr_ecdsa_verify (backends, count, vector->curve, vector->x, vector->y,
+			vector->digest, vector->r, vector->s);
+		CuAssertIntEquals (test, 0, status);
+	}
+	clock_gettime (CLOCK_MONOTONIC, &end);
+
+	return (((uint64_t) (end.tv_sec - start.tv_sec) * 1000000000ULL) + end.tv_nsec -
+		start.tv_nsec) / PFR_ECDSA_BENCHMARK_LOOPS;
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_ecdsa_benchmark_test_verify (CuTest *test)
+{
+	const struct pfr_ecdsa_backend *sw_backends[] = {&pfr_ecdsa_mbedtls_backend};
+	const struct pfr_ecdsa_backend *hw_backends[] = {
+		&pfr_ecdsa_benchmark_engine, &pfr_ecdsa_mbedtls_backend
+	};
+	uint64_t sw_ns;
+	uint64_t hw_ns;
+	size_t i;
+
+	TEST_START;
+
+	printf ("\n%-22s %12s %12s\n", "ecdsa verify", "mbedtls us", "dispatch us");
+
+	for (i = 0; i < PFR_ECDSA_BENCHMARK_VECTOR_COUNT; i++) {
+		sw_ns = pfr_ecdsa_benchmark_run (test, sw_backends, 1, &pfr_ecdsa_benchmark_vectors[i]);
+		hw_ns = pfr_ecdsa_benchmark_run (test, hw_backends, 2, &pfr_ecdsa_benchmark_vectors[i]);
+
+		printf ("%-22s %12.1f %12.1f\n", pfr_ecdsa_benchmark_vectors[i].name, sw_ns / 1000.0,
+			hw_ns / 1000.0);
+	}
+}
+
+
+CuSuite* get_pfr_ecdsa_benchmark_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_ecdsa_benchmark_test_verify);
+
+	return suite;
+}
@@ -0,0 +1,949 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+/*
+ * Runs the Intel PFR 2.0 T-1 verification, recovery and update flows against a PCH image on
+ * emulated flash and reports the flash traffic of each flow.
+ *
+ * Root key, key cancellation and ECDSA checks are not modeled.  They do not touch SPI on the
+ * device, so signature verification always passes and only the hashing of the signed data is
+ * measured.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "testing.h"
+#include "pfr_benchmark_platform.h"
+#include "state_machine/common_smc.h"
+#include "intel_pfr_definitions.h"
+#include "intel_pfr_provision.h"
+#include "intel_pfr_verification.h"
+#include "intel_pfr_pfm_manifest.h"
+#include "pfr/pfr_util.h"
+#include "pfr/pfr_measurement_cache.h"
+#include "pfr/pfr_ufm.h"
+#include "pfr/pfr_printk.h"
+#include "pfr/pfr_log_batch.h"
+#include "pfr/pfr_sig_block.h"
+#include "logging/debug_log.h"
+
+
+static const char *SUITE = "pfr_flow_benchmark";
+
+
+/* Flow entry points of the Intel PFR modules that have no public prototype. */
+int pfm_version_set (struct pfr_manifest *manifest, uint32_t read_address);
+int get_recover_pfm_version_details (struct pfr_manifest *manifest, uint32_t address);
+int pfm_spi_region_verification (struct pfr_manifest *manifest);
+int capsule_decompression (uint32_t image_type, uint32_t read_address, uint32_t area_size,
+	bool skip_unchanged);
+int active_region_pfm_update (struct pfr_manifest *manifest);
+int pfr_recover_active_region (struct pfr_manifest *manifest);
+int pfr_recover_recovery_region (int image_type, uint32_t source_address, uint32_t target_address,
+	bool skip_unchanged);
+int pfr_spi_page_read_write_between_spi (int source_flash, uint32_t *source_address,
+	int target_flash, uint32_t *target_address);
+
+
+/**
+ * Size of the BMC flash.  The flows only run on the PCH image.
+ */
+#define	PFR_FLOW_BENCHMARK_BMC_FLASH_SIZE		0x00100000
+
+/**
+ * Size of the PCH flash.
+ */
+#define	PFR_FLOW_BENCHMARK_PCH_FLASH_SIZE		0x04000000
+
+/**
+ * Size of the PCH active firmware, at the start of flash.
+ */
+#define	PFR_FLOW_BENCHMARK_ACTIVE_SIZE			0x01000000
+
+/**
+ * Size of each SPI region defined in the PFM.
+ */
+#define	PFR_FLOW_BENCHMARK_REGION_SIZE			0x00080000
+
+/**
+ * Number of SPI regions in the active firmware.
+ */
+#define	PFR_FLOW_BENCHMARK_REGIONS				\
+	(PFR_FLOW_BENCHMARK_ACTIVE_SIZE / PFR_FLOW_BENCHMARK_REGION_SIZE)
+
+/**
+ * Every eighth region is writable and not hashed.  It is blank in the capsule.
+ */
+#define	PFR_FLOW_BENCHMARK_IS_RW(region)		(((region) % 8) == 7)
+
+/**
+ * Number of SMBus rules in the PFM.
+ */
+#define	PFR_FLOW_BENCHMARK_SMBUS_RULES			20
+
+/**
+ * PCH flash layout.
+ */
+#define	PFR_FLOW_BENCHMARK_RECOVERY_ADDR		0x01000000
+#define	PFR_FLOW_BENCHMARK_STAGING_ADDR			0x02400000
+#define	PFR_FLOW_BENCHMARK_ACTIVE_PFM_ADDR		0x03ff0000
+
+/**
+ * Offset of the compression header in a capsule, after the capsule signature and signed PFM.
+ */
+#define	PFR_FLOW_BENCHMARK_PBC_OFFSET			(PFM_SIG_BLOCK_SIZE + PAGE_SIZE)
+
+/**
+ * Size of the compression header.
+ */
+#define	PFR_FLOW_BENCHMARK_PBC_HEADER_SIZE		128
+
+/**
+ * Number of flash pages covered by the compression bitmaps.
+ */
+#define	PFR_FLOW_BENCHMARK_PBC_PAGES			(PFR_FLOW_BENCHMARK_PCH_FLASH_SIZE / PAGE_SIZE)
+
+/**
+ * Alignment of protected content.
+ */
+#define	PFR_FLOW_BENCHMARK_PC_ALIGN				128
+
+
+/**
+ * Dependencies for running the PFR flows.
+ */
+struct pfr_flow_benchmark_testing {
+	struct pfr_manifest manifest;						/**< PFR manifest context. */
+	struct manifest base;								/**< Manifest API. */
+	struct pfr_signature_verification verification;		/**< PFR signature verification. */
+	struct signature_verification signature;			/**< Signature verification API. */
+	struct pfr_pubkey pubkey;							/**< Key storage for verification. */
+	struct pfr_authentication authentication;			/**< Authentication steps. */
+	struct pfr_hash hash;								/**< Hash request. */
+	struct pfr_sig_block sig_block;						/**< Signature block being verified. */
+	struct emulated_flash *flash;						/**< The PCH flash. */
+	uint8_t *image[2];									/**< Firmware for the two PFM versions. */
+};
+
+
+static int pfr_flow_benchmark_testing_verify_signature (struct signature_verification *verification,
+	const uint8_t *digest, size_t length, const uint8_t *signature, size_t sig_length)
+{
+	return Success;
+}
+
+static int pfr_flow_benchmark_testing_verify (struct manifest *manifest, struct hash_engine *hash,
+	struct signature_verification *verification, uint8_t *hash_out, size_t hash_length)
+{
+	return intel_pfr_manifest_verify (manifest, hash, verification, hash_out, hash_length);
+}
+
+/**
+ * Generate firmware for the active region.  Writable regions are left blank.
+ *
+ * @param image Output for the firmware.
+ * @param seed Seed for the firmware contents.
+ */
+static void pfr_flow_benchmark_testing_generate (uint8_t *image, uint32_t seed)
+{
+	uint32_t state = seed | 1;
+	uint32_t i;
+
+	memset (image, 0xff, PFR_FLOW_BENCHMARK_ACTIVE_SIZE);
+
+	for (i = 0; i < PFR_FLOW_BENCHMARK_ACTIVE_SIZE; i++) {
+		/* xorshift32 */
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+
+		if (!PFR_FLOW_BENCHMARK_IS_RW (i / PFR_FLOW_BENCHMARK_REGION_SIZE)) {
+			image[i] = state >> 24;
+		}
+	}
+}
+
+/**
+ * Build a PFM that describes the firmware.
+ *
+ * @param test The test framework.
+ * @param pfm Output for the PFM, without its signature.
+ * @param image The firmware described by the PFM.
+ * @param svn SVN of the PFM.
+ *
+ * @return Length of the PFM, padded to protected content alignment.
+ */
+static uint32_t pfr_flow_benchmark_testing_build_pfm (CuTest *test, uint8_t *pfm,
+	const uint8_t *image, uint8_t svn)
+{
+	struct hash_engine *hash = pfr_benchmark_get_hash ();
+	PFM_STRUCTURE_1 *header = (PFM_STRUCTURE_1*) pfm;
+	PFM_SPI_DEFINITION *region;
+	PFM_SMBUS_RULE *rule;
+	uint32_t length = sizeof (PFM_STRUCTURE_1);
+	uint32_t i;
+	int status;
+
+	for (i = 0; i < PFR_FLOW_BENCHMARK_REGIONS; i++) {
+		region = (PFM_SPI_DEFINITION*) &pfm[length];
+		memset (region, 0, sizeof (*region));
+		region->PFMDefinitionType = PCH_PFM_SPI_REGION;
+		region->ProtectLevelMask.ReadAllowed = 1;
+		region->RegionStartAddress = i * PFR_FLOW_BENCHMARK_REGION_SIZE;
+		region->RegionEndAddress = region->RegionStartAddress + PFR_FLOW_BENCHMARK_REGION_SIZE;
+		length += sizeof (*region);
+
+		if (PFR_FLOW_BENCHMARK_IS_RW (i)) {
+			region->ProtectLevelMask.WriteAllowed = 1;
+		}
+		else {
+			region->ProtectLevelMask.RecoverOnFirstRecovery = 1;
+			region->ProtectLevelMask.RecoverOnSecondRecovery = 1;
+			region->ProtectLevelMask.RecoverOnThirdRecovery = 1;
+			region->HashAlgorithmInfo.SHA256HashPresent = 1;
+
+			status = hash->calculate_sha256 (hash, &image[region->RegionStartAddress],
+				PFR_FLOW_BENCHMARK_REGION_SIZE, &pfm[length], SHA256_SIZE);
+			CuAssertIntEquals (test, 0, status);
+			length += SHA256_SIZE;
+		}
+	}
+
+	for (i = 0; i < PFR_FLOW_BENCHMARK_SMBUS_RULES; i++) {
+		rule = (PFM_SMBUS_RULE*) &pfm[length];
+		memset (rule, 0, sizeof (*rule));
+		rule->PFMDefinitionType = SMBUS_RULE;
+		rule->BusId = i % 3;
+		rule->RuleID = i;
+		rule->DeviceAddress = 0x20 + (i * 2);
+		memset (rule->CmdPasslist, 0xff, sizeof (rule->CmdPasslist));
+		length += sizeof (*rule);
+	}
+
+	while (length % PFR_FLOW_BENCHMARK_PC_ALIGN) {
+		pfm[length++] = 0xff;
+	}
+
+	memset (header, 0, sizeof (*header));
+	header->PfmTag = PFMTAG;
+	header->SVN = svn;
+	header->BkcVersion = 1;
+	header->PfmRevision = 0x0100 | svn;
+	header->Length = length;
+
+	CuAssertTrue (test, length <= (PAGE_SIZE - PFM_SIG_BLOCK_SIZE));
+
+	return length;
+}
+
+/**
+ * Write the signature block for protected content.  The signatures themselves are not checked.
+ *
+ * @param test The test framework.
+ * @param sig Output for the 1kB signature block.
+ * @param pc The protected content.
+ * @param length Length of the protected content.
+ * @param pc_type Type of the protected content.
+ */
+static void pfr_flow_benchmark_testing_sign (CuTest *test, uint8_t *sig, const uint8_t *pc,
+	uint32_t length, uint32_t pc_type)
+{
+	struct hash_engine *hash = pfr_benchmark_get_hash ();
+	PFR_AUTHENTICATION_BLOCK0 *block0 = (PFR_AUTHENTICATION_BLOCK0*) sig;
+	PFR_AUTHENTICATION_BLOCK1 *block1 =
+		(PFR_AUTHENTICATION_BLOCK1*) &sig[sizeof (PFR_AUTHENTICATION_BLOCK0)];
+	int status;
+
+	memset (sig, 0, PFM_SIG_BLOCK_SIZE);
+
+	block0->Block0Tag = BLOCK0TAG;
+	block0->PcLength = length;
+	block0->PcType = pc_type;
+
+	status = hash->calculate_sha256 (hash, pc, length, block0->Sha256Pc, sizeof (block0->Sha256Pc));
+	CuAssertIntEquals (test, 0, status);
+
+	status = hash->calculate_sha384 (hash, pc, length, block0->Sha384Pc, sizeof (block0->Sha384Pc));
+	CuAssertIntEquals (test, 0, status);
+
+	block1->TagBlock1 = BLOCK1TAG;
+	block1->RootEntry.Tag = BLOCK1_ROOTENTRY_TAG;
+	block1->RootEntry.PubCurveMagic = PUBLIC_SECP256_TAG;
+	block1->RootEntry.KeyPermission = 0xffffffff;
+	block1->RootEntry.KeyId = 0xffffffff;
+	block1->CskEntry.CskEntryInitial.Tag = BLOCK1CSKTAG;
+	block1->CskEntry.CskEntryInitial.PubCurveMagic = PUBLIC_SECP256_TAG;
+	block1->CskEntry.CskEntryInitial.KeyPermission = SIGN_PCH_PFM_BIT0 | SIGN_PCH_UPDATE_BIT1;
+	block1->CskEntry.CskSignatureMagic = SIGNATURE_SECP256_TAG;
+	block1->Block0Entry.TagBlock0Entry = BLOCK1_BLOCK0ENTRYTAG;
+	block1->Block0Entry.Block0SignatureMagic = SIGNATURE_SECP256_TAG;
+}
+
+/**
+ * Write a signed PFM.
+ *
+ * @param test The test framework.
+ * @param data Flash contents at the signature block of the PFM.
+ * @param image The firmware described by the PFM.
+ * @param svn SVN of the PFM.
+ */
+static void pfr_flow_benchmark_testing_write_pfm (CuTest *test, uint8_t *data,
+	const uint8_t *image, uint8_t svn)
+{
+	uint32_t length;
+
+	length = pfr_flow_benchmark_testing_build_pfm (test, &data[PFM_SIG_BLOCK_SIZE], image, svn);
+	pfr_flow_benchmark_testing_sign (test, data, &data[PFM_SIG_BLOCK_SIZE], length, PFR_PCH_PFM);
+}
+
+/**
+ * Write a signed update capsule with a compressed image of the active region and the PFM page.
+ *
+ * @param test The test framework.
+ * @param data Flash contents at the capsule.
+ * @param image The firmware in the capsule.
+ * @param svn SVN of the capsule PFM.
+ */
+static void pfr_flow_benchmark_testing_write_capsule (CuTest *test, uint8_t *data,
+	const uint8_t *image, uint8_t svn)
+{
+	uint8_t *pbc = &data[PFR_FLOW_BENCHMARK_PBC_OFFSET];
+	uint32_t bitmap_size = PFR_FLOW_BENCHMARK_PBC_PAGES / 8;
+	uint8_t *active_map = &pbc[PFR_FLOW_BENCHMARK_PBC_HEADER_SIZE];
+	uint8_t *compression_map = &active_map[bitmap_size];
+	uint8_t *payload = &compression_map[bitmap_size];
+	uint32_t pfm_page = PFR_FLOW_BENCHMARK_ACTIVE_PFM_ADDR / PAGE_SIZE;
+	uint32_t header[7];
+	uint32_t page;
+	uint32_t i;
+	uint32_t length;
+
+	memset (data, 0xff, PCH_STAGING_SIZE);
+	pfr_flow_benchmark_testing_write_pfm (test, &data[PFM_SIG_BLOCK_SIZE], image, svn);
+
+	memset (active_map, 0, 2 * bitmap_size);
+	active_map[pfm_page / 8] |= 0x80 >> (pfm_page & 7);
+
+	for (page = 0; page < (PFR_FLOW_BENCHMARK_ACTIVE_SIZE / PAGE_SIZE); page++) {
+		active_map[page / 8] |= 0x80 >> (page & 7);
+
+		for (i = 0; i < PAGE_SIZE; i++) {
+			if (image[(page * PAGE_SIZE) + i] != 0xff) {
+				break;
+			}
+		}
+
+		if (i != PAGE_SIZE) {
+			compression_map[page / 8] |= 0x80 >> (page & 7);
+			memcpy (payload, &image[page * PAGE_SIZE], PAGE_SIZE);
+			payload += PAGE_SIZE;
+		}
+	}
+
+	memset (pbc, 0, PFR_FLOW_BENCHMARK_PBC_HEADER_SIZE);
+	header[0] = COMPRESSION_TAG;
+	header[1] = 2;
+	header[2] = PAGE_SIZE;
+	header[3] = 1;
+	header[4] = 0xff;
+	header[5] = PFR_FLOW_BENCHMARK_PBC_PAGES;
+	header[6] = payload - &compression_map[bitmap_size];
+	memcpy (pbc, header, sizeof (header));
+
+	length = payload - &data[PFM_SIG_BLOCK_SIZE];
+	length = (length + PFR_FLOW_BENCHMARK_PC_ALIGN - 1) & ~(PFR_FLOW_BENCHMARK_PC_ALIGN - 1);
+	CuAssertTrue (test, (length + PFM_SIG_BLOCK_SIZE) <= PCH_STAGING_SIZE);
+
+	pfr_flow_benchmark_testing_sign (test, data, &data[PFM_SIG_BLOCK_SIZE], length,
+		PFR_PCH_UPDATE_CAPSULE);
+}
+
+/**
+ * Create the PCH flash: active firmware and PFM from version 1, a version 1 recovery capsule and a
+ * version 2 update capsule in staging.
+ *
+ * @param test The test framework.
+ * @param bench The testing dependencies to initialize.
+ */
+static void pfr_flow_benchmark_testing_init (CuTest *test, struct pfr_flow_benchmark_testing *bench)
+{
+	uint32_t sizes[PFR_BENCHMARK_DEVICES];
+	int status;
+
+	memset (bench, 0, sizeof (*bench));
+
+	sizes[BMC_TYPE] = PFR_FLOW_BENCHMARK_BMC_FLASH_SIZE;
+	sizes[PCH_TYPE] = PFR_FLOW_BENCHMARK_PCH_FLASH_SIZE;
+
+	status = pfr_benchmark_platform_init (sizes);
+	CuAssertIntEquals (test, 0, status);
+
+	bench->flash = pfr_benchmark_get_flash (PCH_TYPE);
+
+	bench->image[0] = malloc (PFR_FLOW_BENCHMARK_ACTIVE_SIZE);
+	CuAssertPtrNotNull (test, bench->image[0]);
+
+	bench->image[1] = malloc (PFR_FLOW_BENCHMARK_ACTIVE_SIZE);
+	CuAssertPtrNotNull (test, bench->image[1]);
+
+	pfr_flow_benchmark_testing_generate (bench->image[0], 0x1234);
+	pfr_flow_benchmark_testing_generate (bench->image[1], 0x5678);
+
+	memcpy (bench->flash->data, bench->image[0], PFR_FLOW_BENCHMARK_ACTIVE_SIZE);
+	pfr_flow_benchmark_testing_write_pfm (test,
+		&bench->flash->data[PFR_FLOW_BENCHMARK_ACTIVE_PFM_ADDR], bench->image[0], 1);
+	pfr_flow_benchmark_testing_write_capsule (test,
+		&bench->flash->data[PFR_FLOW_BENCHMARK_RECOVERY_ADDR], bench->image[0], 1);
+	pfr_flow_benchmark_testing_write_capsule (test,
+		&bench->flash->data[PFR_FLOW_BENCHMARK_STAGING_ADDR], bench->image[1], 2);
+
+	pfr_benchmark_set_provision (PCH_ACTIVE_PFM_OFFSET, PFR_FLOW_BENCHMARK_ACTIVE_PFM_ADDR);
+	pfr_benchmark_set_provision (PCH_RECOVERY_REGION_OFFSET, PFR_FLOW_BENCHMARK_RECOVERY_ADDR);
+	pfr_benchmark_set_provision (PCH_STAGING_REGION_OFFSET, PFR_FLOW_BENCHMARK_STAGING_ADDR);
+
+	bench->base.verify = pfr_flow_benchmark_testing_verify;
+	bench->base.get_hash = get_hash;
+	bench->signature.verify_signature = pfr_flow_benchmark_testing_verify_signature;
+	bench->verification.base = &bench->signature;
+	bench->verification.pubkey = &bench->pubkey;
+
+	bench->manifest.base = &bench->base;
+	bench->manifest.hash = pfr_benchmark_get_hash ();
+	bench->manifest.verification = &bench->verification;
+	bench->manifest.flash = pfr_benchmark_get_spi ();
+	bench->manifest.pfr_authentication = &bench->authentication;
+	bench->manifest.pfr_hash = &bench->hash;
+	bench->manifest.sig_block = &bench->sig_block;
+	bench->manifest.image_type = PCH_TYPE;
+	bench->manifest.hash_curve = secp256r1;
+
+	/* Each flow starts from a cold boot, with nothing cached from a previous flow. */
+	pfr_pfm_index_invalidate (get_pfm_index (PCH_TYPE));
+}
+
+/**
+ * Release the testing dependencies.
+ *
+ * @param bench The testing dependencies to release.
+ */
+static void pfr_flow_benchmark_testing_release (struct pfr_flow_benchmark_testing *bench)
+{
+	free (bench->image[0]);
+	free (bench->image[1]);
+	pfr_benchmark_platform_release ();
+}
+
+/**
+ * Authenticate a capsule and the PFM it carries.
+ *
+ * @param bench The testing dependencies.
+ * @param address Address of the capsule.
+ *
+ * @return Success if the capsule is valid.
+ */
+static int pfr_flow_benchmark_testing_verify_capsule (struct pfr_flow_benchmark_testing *bench,
+	uint32_t address)
+{
+	struct pfr_manifest *manifest = &bench->manifest;
+	int status;
+
+	manifest->address = address;
+	manifest->pc_type = PFR_PCH_UPDATE_CAPSULE;
+	status = manifest->base->verify ((struct manifest*) manifest, manifest->hash,
+		manifest->verification->base, manifest->pfr_hash->hash_out, manifest->pfr_hash->length);
+	if (status != Success) {
+		return status;
+	}
+
+	manifest->address += PFM_SIG_BLOCK_SIZE;
+	manifest->pc_type = PFR_PCH_PFM;
+	return manifest->base->verify ((struct manifest*) manifest, manifest->hash,
+		manifest->verification->base, manifest->pfr_hash->hash_out, manifest->pfr_hash->length);
+}
+
+/**
+ * Authenticate the active PFM and check every hashed SPI region against it.
+ *
+ * @param bench The testing dependencies.
+ *
+ * @return Success if the active firmware is valid.
+ */
+static int pfr_flow_benchmark_testing_verify_active (struct pfr_flow_benchmark_testing *bench)
+{
+	struct pfr_manifest *manifest = &bench->manifest;
+	int status;
+
+	manifest->address = PFR_FLOW_BENCHMARK_ACTIVE_PFM_ADDR;
+	manifest->pc_type = PFR_PCH_PFM;
+	status = manifest->base->verify ((struct manifest*) manifest, manifest->hash,
+		manifest->verification->base, manifest->pfr_hash->hash_out, manifest->pfr_hash->length);
+	if (status != Success) {
+		return status;
+	}
+
+	status = pfm_version_set (manifest, PFR_FLOW_BENCHMARK_ACTIVE_PFM_ADDR + PFM_SIG_BLOCK_SIZE);
+	if (status != Success) {
+		return status;
+	}
+
+	return pfm_spi_region_verification (manifest);
+}
+
+/**
+ * Check that the active region holds a firmware version and its PFM.
+ *
+ * @param test The test framework.
+ * @param bench The testing dependencies.
+ * @param capsule Address of the capsule the firmware came from.
+ * @param version Index of the firmware that should be active.
+ */
+static void pfr_flow_benchmark_testing_check_active (CuTest *test,
+	struct pfr_flow_benchmark_testing *bench, uint32_t capsule, int version)
+{
+	int status;
+
+	status = memcmp (bench->flash->data, bench->image[version], PFR_FLOW_BENCHMARK_ACTIVE_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = memcmp (&bench->flash->data[PFR_FLOW_BENCHMARK_ACTIVE_PFM_ADDR],
+		&bench->flash->data[capsule + PFM_SIG_BLOCK_SIZE], PAGE_SIZE);
+	CuAssertIntEquals (test, 0, status);
+}
+
+/**
+ * Corrupt one byte in a number of sectors of hashed regions.
+ *
+ * @param bench The testing dependencies.
+ * @param count The number of sectors to corrupt.
+ */
+static void pfr_flow_benchmark_testing_corrupt (struct pfr_flow_benchmark_testing *bench,
+	int count)
+{
+	uint32_t address;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		address = (i * 5 * PFR_FLOW_BENCHMARK_REGION_SIZE) + (i * 0x3000) + 0x123;
+		bench->flash->data[address] ^= 0x5a;
+	}
+}
+
+/**
+ * Run T-1 verification the way the state machine does, with an entry in the debug log at each
+ * step.
+ *
+ * @param bench The testing dependencies.
+ *
+ * @return Success if the recovery and active images verified.
+ */
+static int pfr_flow_benchmark_testing_verify_logged (struct pfr_flow_benchmark_testing *bench)
+{
+	int status;
+
+	debug_log_create_entry (DEBUG_LOG_SEVERITY_INFO, DEBUG_LOG_COMPONENT_VERIFY,
+		VERIFY_LOG_COMPONENT_ENTRY_START, 0, 0);
+	debug_log_flush ();
+
+	debug_log_create_entry (DEBUG_LOG_SEVERITY_INFO, DEBUG_LOG_COMPONENT_VERIFY,
+		VERIFY_LOG_COMPONENT_RUN_START, 0, 0);
+	debug_log_flush ();
+
+	status = pfr_flow_benchmark_testing_verify_capsule (bench, PFR_FLOW_BENCHMARK_RECOVERY_ADDR);
+	if (status == Success) {
+		debug_log_create_entry (DEBUG_LOG_SEVERITY_INFO, DEBUG_LOG_COMPONENT_VERIFY,
+			VERIFY_LOG_COMPONENT_RUN_AUTHEN_RECOVERY_SUCCESS, 0, 0);
+		debug_log_flush ();
+
+		status = get_recover_pfm_version_details (&bench->manifest,
+			PFR_FLOW_BENCHMARK_RECOVERY_ADDR);
+	}
+	if (status == Success) {
+		status = pfr_flow_benchmark_testing_verify_active (bench);
+	}
+	if (status == Success) {
+		debug_log_create_entry (DEBUG_LOG_SEVERITY_INFO, DEBUG_LOG_COMPONENT_VERIFY,
+			VERIFY_LOG_COMPONENT_RUN_AUTHEN_ACTIVE_SUCCESS, 0, 0);
+		debug_log_flush ();
+	}
+
+	return status;
+}
+
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_flow_benchmark_test_t_minus_1_verify (CuTest *test)
+{
+	struct pfr_flow_benchmark_testing bench;
+	struct pfr_benchmark_stats stats;
+	int status;
+
+	TEST_START;
+
+	pfr_flow_benchmark_testing_init (test, &bench);
+
+	pfr_benchmark_start ();
+
+	status = pfr_flow_benchmark_testing_verify_capsule (&bench, PFR_FLOW_BENCHMARK_RECOVERY_ADDR);
+	if (status == Success) {
+		status = get_recover_pfm_version_details (&bench.manifest,
+			PFR_FLOW_BENCHMARK_RECOVERY_ADDR);
+	}
+	if (status == Success) {
+		status = pfr_flow_benchmark_testing_verify_active (&bench);
+	}
+
+	pfr_benchmark_stop (&stats);
+	pfr_benchmark_print ("T-1 verify", &stats);
+
+	CuAssertIntEquals (test, Success, status);
+	CuAssertIntEquals (test, 0, stats.writes);
+	CuAssertIntEquals (test, 0, stats.sector_erases + stats.block_erases + stats.chip_erases);
+
+	pfr_flow_benchmark_testing_release (&bench);
+}
+
+static void pfr_flow_benchmark_test_t_minus_1_verify_log_per_entry (CuTest *test)
+{
+	struct pfr_flow_benchmark_testing bench;
+	struct pfr_benchmark_stats stats;
+	uint32_t modules;
+	int status;
+
+	TEST_START;
+
+	pfr_flow_benchmark_testing_init (test, &bench);
+
+	modules = pfr_printk_set_modules (PFR_PRINTK_ALL);
+	debug_log = pfr_benchmark_get_log ();
+
+	pfr_benchmark_start ();
+
+	status = pfr_flow_benchmark_testing_verify_logged (&bench);
+
+	pfr_benchmark_stop (&stats);
+	pfr_benchmark_print ("T-1 verify, log per entry", &stats);
+
+	debug_log = NULL;
+	pfr_printk_set_modules (modules);
+
+	CuAssertIntEquals (test, Success, status);
+
+	pfr_flow_benchmark_testing_release (&bench);
+}
+
+static void pfr_flow_benchmark_test_t_minus_1_verify_log_batched (CuTest *test)
+{
+	struct pfr_flow_benchmark_testing bench;
+	struct pfr_benchmark_stats stats;
+	struct pfr_log_batch batch;
+	uint32_t modules;
+	int status;
+
+	TEST_START;
+
+	pfr_flow_benchmark_testing_init (test, &bench);
+
+	status = pfr_log_batch_init (&batch, pfr_benchmark_get_log (), NULL, NULL);
+	CuAssertIntEquals (test, 0, status);
+
+	modules = pfr_printk_set_modules (PFR_PRINTK_DEFAULT);
+	debug_log = &batch.base;
+
+	pfr_benchmark_start ();
+
+	status = pfr_flow_benchmark_testing_verify_logged (&bench);
+
+	pfr_benchmark_stop (&stats);
+	pfr_benchmark_print ("T-1 verify, log batched", &stats);
+
+	CuAssertIntEquals (test, Success, status);
+	CuAssertTrue (test, (pfr_log_batch_pending (&batch) != 0));
+
+	pfr_benchmark_start ();
+
+	status = pfr_log_batch_process (&batch, true);
+
+	pfr_benchmark_stop (&stats);
+	pfr_benchmark_print ("Log flush when idle", &stats);
+
+	debug_log = NULL;
+	pfr_printk_set_modules (modules);
+
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, pfr_log_batch_pending (&batch));
+
+	pfr_log_batch_release (&batch);
+	pfr_flow_benchmark_testing_release (&bench);
+}
+
+static void pfr_flow_benchmark_test_t_minus_1_verify_corrupt (CuTest *test)
+{
+	struct pfr_flow_benchmark_testing bench;
+	struct pfr_benchmark_stats stats;
+	int status;
+
+	TEST_START;
+
+	pfr_flow_benchmark_testing_init (test, &bench);
+	pfr_flow_benchmark_testing_corrupt (&bench, 1);
+
+	pfr_benchmark_start ();
+
+	status = pfr_flow_benchmark_testing_verify_active (&bench);
+
+	pfr_benchmark_stop (&stats);
+	pfr_benchmark_print ("T-1 verify, corrupt", &stats);
+
+	CuAssertIntEquals (test, Failure, status);
+
+	pfr_flow_benchmark_testing_release (&bench);
+}
+
+static void pfr_flow_benchmark_test_t_minus_1_verify_warm_reset (CuTest *test)
+{
+	struct pfr_flow_benchmark_testing bench;
+	struct pfr_benchmark_stats stats;
+	int status;
+
+	TEST_START;
+
+	pfr_flow_benchmark_testing_init (test, &bench);
+
+	status = pfr_flow_benchmark_testing_verify_active (&bench);
+	CuAssertIntEquals (test, Success, status);
+
+	pfr_benchmark_start ();
+
+	status = pfr_measurement_cache_reset (get_measurement_cache (PCH_TYPE),
+		PFR_MEASUREMENT_CACHE_HOST_RESET, PFR_MEASUREMENT_CACHE_HOST_RESET);
+	if (status == 0) {
+		status = pfr_flow_benchmark_testing_verify_active (&bench);
+	}
+
+	pfr_benchmark_stop (&stats);
+	pfr_benchmark_print ("T-1 verify, warm reset", &stats);
+
+	CuAssertIntEquals (test, Success, status);
+	CuAssertIntEquals (test, 0, stats.writes);
+
+	pfr_flow_benchmark_testing_release (&bench);
+}
+
+static void pfr_flow_benchmark_test_t_minus_1_verify_warm_reset_corrupt (CuTest *test)
+{
+	struct pfr_flow_benchmark_testing bench;
+	struct pfr_benchmark_stats stats;
+	int status;
+
+	TEST_START;
+
+	pfr_flow_benchmark_testing_init (test, &bench);
+
+	status = pfr_flow_benchmark_testing_verify_active (&bench);
+	CuAssertIntEquals (test, Success, status);
+
+	/* The SPI monitor logged the blocked write to the first corrupted sector. */
+	pfr_flow_benchmark_testing_corrupt (&bench, 1);
+	status = pfr_measurement_cache_log_event (get_measurement_cache (PCH_TYPE),
+		(PFR_MEASUREMENT_CACHE_LOG_BLOCKED_WRITE << 18) | (0x123 >> 14));
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_benchmark_start ();
+
+	status = pfr_flow_benchmark_testing_verify_active (&bench);
+
+	pfr_benchmark_stop (&stats);
+	pfr_benchmark_print ("T-1 verify, warm reset, corrupt", &stats);
+
+	CuAssertIntEquals (test, Failure, status);
+
+	pfr_flow_benchmark_testing_release (&bench);
+}
+
+static void pfr_flow_benchmark_test_full_recovery (CuTest *test)
+{
+	struct pfr_flow_benchmark_testing bench;
+	struct pfr_benchmark_stats stats;
+	int status;
+
+	TEST_START;
+
+	pfr_flow_benchmark_testing_init (test, &bench);
+	memset (bench.flash->data, 0, PFR_FLOW_BENCHMARK_ACTIVE_SIZE);
+	memset (&bench.flash->data[PFR_FLOW_BENCHMARK_ACTIVE_PFM_ADDR], 0, PAGE_SIZE);
+
+	pfr_benchmark_start ();
+
+	bench.manifest.state = RECOVERY;
+	status = pfr_recover_active_region (&bench.manifest);
+	if (status == Success) {
+		status = pfr_flow_benchmark_testing_verify_active (&bench);
+	}
+
+	pfr_benchmark_stop (&stats);
+	pfr_benchmark_print ("Full recovery", &stats);
+
+	CuAssertIntEquals (test, Success, status);
+	pfr_flow_benchmark_testing_check_active (test, &bench, PFR_FLOW_BENCHMARK_RECOVERY_ADDR, 0);
+
+	pfr_flow_benchmark_testing_release (&bench);
+}
+
+static void pfr_flow_benchmark_test_partial_recovery (CuTest *test)
+{
+	struct pfr_flow_benchmark_testing bench;
+	struct pfr_benchmark_stats stats;
+	int status;
+
+	TEST_START;
+
+	pfr_flow_benchmark_testing_init (test, &bench);
+	pfr_flow_benchmark_testing_corrupt (&bench, 3);
+
+	pfr_benchmark_start ();
+
+	bench.manifest.state = RECOVERY;
+	status = pfr_recover_active_region (&bench.manifest);
+	if (status == Success) {
+		status = pfr_flow_benchmark_testing_verify_active (&bench);
+	}
+
+	pfr_benchmark_stop (&stats);
+	pfr_benchmark_print ("Partial recovery", &stats);
+
+	CuAssertIntEquals (test, Success, status);
+	pfr_flow_benchmark_testing_check_active (test, &bench, PFR_FLOW_BENCHMARK_RECOVERY_ADDR, 0);
+
+	pfr_flow_benchmark_testing_release (&bench);
+}
+
+static void pfr_flow_benchmark_test_update (CuTest *test)
+{
+	struct pfr_flow_benchmark_testing bench;
+	struct pfr_benchmark_stats stats;
+	int status;
+
+	TEST_START;
+
+	pfr_flow_benchmark_testing_init (test, &bench);
+
+	pfr_benchmark_start ();
+
+	status = pfr_flow_benchmark_testing_verify_capsule (&bench, PFR_FLOW_BENCHMARK_STAGING_ADDR);
+	if (status == Success) {
+		bench.manifest.state = UPDATE;
+		status = capsule_decompression (PCH_TYPE, PFR_FLOW_BENCHMARK_STAGING_ADDR,
+			PCH_STAGING_SIZE, false);
+	}
+	if (status == Success) {
+		status = active_region_pfm_update (&bench.manifest);
+	}
+	if (status == Success) {
+		status = pfr_recover_recovery_region (PCH_TYPE, PFR_FLOW_BENCHMARK_STAGING_ADDR,
+			PFR_FLOW_BENCHMARK_RECOVERY_ADDR, false);
+	}
+
+	pfr_benchmark_stop (&stats);
+	pfr_benchmark_print ("Update", &stats);
+
+	CuAssertIntEquals (test, Success, status);
+	pfr_flow_benchmark_testing_check_active (test, &bench, PFR_FLOW_BENCHMARK_STAGING_ADDR, 1);
+
+	status = memcmp (&bench.flash->data[PFR_FLOW_BENCHMARK_RECOVERY_ADDR],
+		&bench.flash->data[PFR_FLOW_BENCHMARK_STAGING_ADDR], PCH_STAGING_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_flow_benchmark_testing_release (&bench);
+}
+
+static void pfr_flow_benchmark_test_staging_copy_per_page (CuTest *test)
+{
+	struct pfr_flow_benchmark_testing bench;
+	struct pfr_benchmark_stats stats;
+	uint32_t source = PFR_FLOW_BENCHMARK_RECOVERY_ADDR;
+	uint32_t target = PFR_FLOW_BENCHMARK_STAGING_ADDR;
+	uint32_t i;
+	int status = Success;
+
+	TEST_START;
+
+	pfr_flow_benchmark_testing_init (test, &bench);
+
+	pfr_benchmark_start ();
+
+	/* The erase and copy loops staging and RoT updates used before the bulk copy. */
+	for (i = 0; (status == Success) && (i < (PCH_STAGING_SIZE / PAGE_SIZE)); i++) {
+		status = pfr_spi_erase_4k (PCH_TYPE, target + (i * PAGE_SIZE));
+	}
+	for (i = 0; (status == Success) && (i < (PCH_STAGING_SIZE / PAGE_SIZE)); i++) {
+		status = pfr_spi_page_read_write_between_spi (PCH_TYPE, &source, PCH_TYPE, &target);
+	}
+
+	pfr_benchmark_stop (&stats);
+	pfr_benchmark_print ("Staging copy, per page", &stats);
+
+	CuAssertIntEquals (test, Success, status);
+
+	status = memcmp (&bench.flash->data[PFR_FLOW_BENCHMARK_STAGING_ADDR],
+		&bench.flash->data[PFR_FLOW_BENCHMARK_RECOVERY_ADDR], PCH_STAGING_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_flow_benchmark_testing_release (&bench);
+}
+
+static void pfr_flow_benchmark_test_staging_copy (CuTest *test)
+{
+	struct pfr_flow_benchmark_testing bench;
+	struct pfr_benchmark_stats stats;
+	int status;
+
+	TEST_START;
+
+	pfr_flow_benchmark_testing_init (test, &bench);
+
+	pfr_benchmark_start ();
+
+	status = pfr_spi_copy_between_spi (PCH_TYPE, PFR_FLOW_BENCHMARK_RECOVERY_ADDR, PCH_TYPE,
+		PFR_FLOW_BENCHMARK_STAGING_ADDR, PCH_STAGING_SIZE);
+
+	pfr_benchmark_stop (&stats);
+	pfr_benchmark_print ("Staging copy", &stats);
+
+	CuAssertIntEquals (test, Success, status);
+
+	status = memcmp (&bench.flash->data[PFR_FLOW_BENCHMARK_STAGING_ADDR],
+		&bench.flash->data[PFR_FLOW_BENCHMARK_RECOVERY_ADDR], PCH_STAGING_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_flow_benchmark_testing_release (&bench);
+}
+
+
+CuSuite* get_pfr_flow_benchmark_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_flow_benchmark_test_t_minus_1_verify);
+	SUITE_ADD_TEST (suite, pfr_flow_benchmark_test_t_minus_1_verify_log_per_entry);
+	SUITE_ADD_TEST (suite, pfr_flow_benchmark_test_t_minus_1_verify_log_batched);
+	SUITE_ADD_TEST (suite, pfr_flow_benchmark_test_t_minus_1_verify_corrupt);
+	SUITE_ADD_TEST (suite, pfr_flow_benchmark_test_t_minus_1_verify_warm_reset);
+	SUITE_ADD_TEST (suite, pfr_flow_benchmark_test_t_minus_1_verify_warm_reset_corrupt);
+	SUITE_ADD_TEST (suite, pfr_flow_benchmark_test_full_recovery);
+	SUITE_ADD_TEST (suite, pfr_flow_benchmark_test_partial_recovery);
+	SUITE_ADD_TEST (suite, pfr_flow_benchmark_test_update);
+	SUITE_ADD_TEST (suite, pfr_flow_benchmark_test_staging_copy_per_page);
+	SUITE_ADD_TEST (suite, pfr_flow_benchmark_test_staging_copy);
+
+	return suite;
+}
@@ -0,0 +1,406 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+/*
+ * Moves provisioning data through a model of the SMBus mailbox I2C target and reports the
+ * throughput of the byte registers and the block transfers.
+ *
+ * The model is driven the way the I2C controller driver drives the target callbacks, one byte at
+ * a time.  Time on the bus is modeled from the bytes on the wire at 100 kHz.  The time spent in
+ * the target code is measured on the host.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "testing.h"
+#include "pfr/pfr_mailbox_fifo.h"
+
+
+static const char *SUITE = "pfr_mailbox_benchmark";
+
+
+/**
+ * Time for one bit on a 100 kHz SMBus.  Each byte is 9 bits with the acknowledge, and each start,
+ * repeated start and stop is counted as one bit.
+ */
+#define	PFR_MAILBOX_BENCHMARK_BIT_NS			10000
+
+/**
+ * Number of times each transfer is repeated to measure the time in the target code.
+ */
+#define	PFR_MAILBOX_BENCHMARK_REPEAT			10000
+
+/**
+ * 7-bit address of the mailbox target.
+ */
+#define	PFR_MAILBOX_BENCHMARK_ADDRESS			0x38
+
+/**
+ * Mailbox registers used by the model.
+ */
+#define	PFR_MAILBOX_BENCHMARK_WRITE_FIFO		0x0d
+#define	PFR_MAILBOX_BENCHMARK_READ_FIFO			0x0e
+#define	PFR_MAILBOX_BENCHMARK_WRITE_BLOCK		0x70
+#define	PFR_MAILBOX_BENCHMARK_READ_BLOCK		0x71
+
+
+/**
+ * Model of the mailbox I2C target and the bus it is attached to.
+ */
+struct pfr_mailbox_benchmark_target {
+	struct pfr_mailbox_fifo write_fifo;			/**< UFM write FIFO. */
+	struct pfr_mailbox_fifo read_fifo;			/**< UFM read FIFO. */
+	uint8_t buf[PFR_MAILBOX_BLOCK_MAX];			/**< Transaction being received or sent. */
+	size_t length;								/**< Bytes in the transaction buffer. */
+	size_t index;								/**< Next byte of a block read. */
+	uint32_t transactions;						/**< Number of bus transactions. */
+	uint64_t bus_bits;							/**< Bit times used on the bus. */
+	uint32_t events;							/**< State machine events the target posts. */
+};
+
+/**
+ * Totals for one benchmarked transfer.
+ */
+struct pfr_mailbox_benchmark_stats {
+	uint64_t host_ns;							/**< Measured time in the target code. */
+	uint64_t bus_ns;							/**< Modeled time on the bus. */
+	uint32_t transactions;						/**< Bus transactions for one transfer. */
+	uint32_t events;							/**< State machine events for one transfer. */
+};
+
+
+/**
+ * Target callback for a write from the host.
+ */
+static void pfr_mailbox_benchmark_write_requested (struct pfr_mailbox_benchmark_target *target)
+{
+	target->length = 0;
+}
+
+/**
+ * Target callback for each byte written by the host.  A byte register write posts an event once
+ * the command and data have been received, which the state machine handles later.
+ */
+static void pfr_mailbox_benchmark_write_received (struct pfr_mailbox_benchmark_target *target,
+	uint8_t val)
+{
+	if (target->length < sizeof (target->buf)) {
+		target->buf[target->length] = val;
+	}
+	target->length++;
+
+	if ((target->buf[0] != PFR_MAILBOX_BENCHMARK_WRITE_BLOCK) && (target->length == 2)) {
+		target->events++;
+		if (target->buf[0] == PFR_MAILBOX_BENCHMARK_WRITE_FIFO) {
+			pfr_mailbox_fifo_push (&target->write_fifo, &target->buf[1], 1);
+		}
+	}
+}
+
+/**
+ * Target callback for the first byte of a read.
+ */
+static uint8_t pfr_mailbox_benchmark_read_requested (struct pfr_mailbox_benchmark_target *target)
+{
+	int length;
+
+	if (target->buf[0] == PFR_MAILBOX_BENCHMARK_READ_BLOCK) {
+		length = pfr_mailbox_block_read (&target->read_fifo, PFR_MAILBOX_BENCHMARK_ADDRESS,
+			PFR_MAILBOX_BENCHMARK_READ_BLOCK, target->buf, sizeof (target->buf));
+		target->length = (length > 0) ? length : 0;
+		target->index = 1;
+
+		return target->buf[0];
+	}
+
+	target->length = 0;
+	return pfr_mailbox_fifo_pop (&target->read_fifo);
+}
+
+/**
+ * Target callback for each further byte of a read.
+ */
+static uint8_t pfr_mailbox_benchmark_read_processed (struct pfr_mailbox_benchmark_target *target)
+{
+	return (target->index < target->length) ? target->buf[target->index++] : 0xff;
+}
+
+/**
+ * Target callback for the end of a transaction.
+ */
+static void pfr_mailbox_benchmark_stop (struct pfr_mailbox_benchmark_target *target)
+{
+	if ((target->length > 0) && (target->buf[0] == PFR_MAILBOX_BENCHMARK_WRITE_BLOCK)) {
+		pfr_mailbox_block_write (&target->write_fifo, PFR_MAILBOX_BENCHMARK_ADDRESS, target->buf,
+			(target->length <= sizeof (target->buf)) ? target->length : 0);
+	}
+
+	target->length = 0;
+}
+
+/**
+ * Host write transaction: start, address, the bytes and stop.
+ */
+static void pfr_mailbox_benchmark_host_write (struct pfr_mailbox_benchmark_target *target,
+	const uint8_t *data, size_t length)
+{
+	size_t i;
+
+	pfr_mailbox_benchmark_write_requested (target);
+	for (i = 0; i < length; i++) {
+		pfr_mailbox_benchmark_write_received (target, data[i]);
+	}
+	pfr_mailbox_benchmark_stop (target);
+
+	target->transactions++;
+	target->bus_bits += ((length + 1) * 9) + 2;
+}
+
+/**
+ * Host read transaction: start, address, command, repeated start, address, the bytes read and
+ * stop.
+ */
+static void pfr_mailbox_benchmark_host_read (struct pfr_mailbox_benchmark_target *target,
+	uint8_t command, uint8_t *data, size_t length)
+{
+	size_t i;
+
+	pfr_mailbox_benchmark_write_requested (target);
+	pfr_mailbox_benchmark_write_received (target, command);
+	data[0] = pfr_mailbox_benchmark_read_requested (target);
+	for (i = 1; i < length; i++) {
+		data[i] = pfr_mailbox_benchmark_read_processed (target);
+	}
+	pfr_mailbox_benchmark_stop (target);
+
+	target->transactions++;
+	target->bus_bits += ((length + 3) * 9) + 3;
+}
+
+/**
+ * Write data to the UFM write FIFO one byte register write at a time.
+ */
+static void pfr_mailbox_benchmark_write_bytes (struct pfr_mailbox_benchmark_target *target,
+	const uint8_t *data, size_t length)
+{
+	uint8_t msg[2] = {PFR_MAILBOX_BENCHMARK_WRITE_FIFO};
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		msg[1] = data[i];
+		pfr_mailbox_benchmark_host_write (target, msg, sizeof (msg));
+	}
+}
+
+/**
+ * Write data to the UFM write FIFO with one block write and PEC.
+ */
+static void pfr_mailbox_benchmark_write_block (struct pfr_mailbox_benchmark_target *target,
+	const uint8_t *data, size_t length)
+{
+	uint8_t addr = PFR_MAILBOX_BENCHMARK_ADDRESS << 1;
+	uint8_t msg[PFR_MAILBOX_BLOCK_MAX];
+
+	msg[0] = PFR_MAILBOX_BENCHMARK_WRITE_BLOCK;
+	msg[1] = length;
+	memcpy (&msg[2], data, length);
+	msg[length + 2] = pfr_mailbox_pec (pfr_mailbox_pec (0, &addr, 1), msg, length + 2);
+
+	pfr_mailbox_benchmark_host_write (target, msg, length + 3);
+}
+
+/**
+ * Read data from the UFM read FIFO one byte register read at a time.
+ */
+static void pfr_mailbox_benchmark_read_bytes (struct pfr_mailbox_benchmark_target *target,
+	uint8_t *data, size_t length)
+{
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		pfr_mailbox_benchmark_host_read (target, PFR_MAILBOX_BENCHMARK_READ_FIFO, &data[i], 1);
+	}
+}
+
+/**
+ * Read data from the UFM read FIFO with one block read, including the count and PEC.
+ */
+static void pfr_mailbox_benchmark_read_block (struct pfr_mailbox_benchmark_target *target,
+	uint8_t *data, size_t length)
+{
+	uint8_t msg[PFR_MAILBOX_BLOCK_MAX];
+
+	pfr_mailbox_benchmark_host_read (target, PFR_MAILBOX_BENCHMARK_READ_BLOCK, msg, length + 2);
+	memcpy (data, &msg[1], length);
+}
+
+/**
+ * Run one transfer repeatedly and collect the totals for a single transfer.
+ *
+ * @param test The test framework.
+ * @param write true to write the data to the write FIFO, false to read it from the read FIFO.
+ * @param block true to use the block transfers, false for the byte registers.
+ * @param length Number of bytes to transfer.
+ * @param stats Output for the totals.
+ */
+static void pfr_mailbox_benchmark_run (CuTest *test, bool write, bool block, size_t length,
+	struct pfr_mailbox_benchmark_stats *stats)
+{
+	struct pfr_mailbox_benchmark_target target;
+	struct timespec start;
+	struct timespec end;
+	uint8_t data[PFR_MAILBOX_FIFO_SIZE];
+	uint8_t out[PFR_MAILBOX_FIFO_SIZE];
+	size_t i;
+	int status;
+
+	for (i = 0; i < length; i++) {
+		data[i] = 0x5a ^ i;
+	}
+
+	memset (&target, 0, sizeof (target));
+	memset (out, 0, sizeof (out));
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+	for (i = 0; i < PFR_MAILBOX_BENCHMARK_REPEAT; i++) {
+		if (write) {
+			pfr_mailbox_fifo_flush (&target.write_fifo);
+			if (block) {
+				pfr_mailbox_benchmark_write_block (&target, data, length);
+			}
+			else {
+				pfr_mailbox_benchmark_write_bytes (&target, data, length);
+			}
+		}
+		else {
+			pfr_mailbox_fifo_load (&target.read_fifo, data, length);
+			if (block) {
+				pfr_mailbox_benchmark_read_block (&target, out, length);
+			}
+			else {
+				pfr_mailbox_benchmark_read_bytes (&target, out, length);
+			}
+		}
+	}
+	clock_gettime (CLOCK_MONOTONIC, &end);
+
+	if (write) {
+		CuAssertIntEquals (test, length, target.write_fifo.length);
+		status = testing_validate_array (data, target.write_fifo.data, length);
+	}
+	else {
+		status = testing_validate_array (data, out, length);
+	}
+	CuAssertIntEquals (test, 0, status);
+
+	stats->host_ns = (((end.tv_sec - start.tv_sec) * 1000000000ULL) + end.tv_nsec -
+		start.tv_nsec) / PFR_MAILBOX_BENCHMARK_REPEAT;
+	stats->bus_ns = (target.bus_bits * PFR_MAILBOX_BENCHMARK_BIT_NS) /
+		PFR_MAILBOX_BENCHMARK_REPEAT;
+	stats->transactions = target.transactions / PFR_MAILBOX_BENCHMARK_REPEAT;
+	stats->events = target.events / PFR_MAILBOX_BENCHMARK_REPEAT;
+}
+
+/**
+ * Print the byte register and block results of one transfer.
+ */
+static void pfr_mailbox_benchmark_print (const char *transfer, size_t length,
+	const struct pfr_mailbox_benchmark_stats *bytes, const struct pfr_mailbox_benchmark_stats *block)
+{
+	static bool header = false;
+	const struct pfr_mailbox_benchmark_stats *stats[] = {bytes, block};
+	const char *mode[] = {"bytes", "block"};
+	int i;
+
+	if (!header) {
+		printf ("\n%-22s %6s %6s %6s %7s %10s %10s %12s\n", "mailbox transfer", "mode", "length",
+			"xfers", "events", "bus us", "target us", "bytes/s");
+		header = true;
+	}
+
+	for (i = 0; i < 2; i++) {
+		printf ("%-22s %6s %6zu %6u %7u %10.1f %10.3f %12.0f\n", transfer, mode[i], length,
+			stats[i]->transactions, stats[i]->events, stats[i]->bus_ns / 1000.0,
+			stats[i]->host_ns / 1000.0,
+			(length * 1000000000.0) / (stats[i]->bus_ns + stats[i]->host_ns));
+	}
+}
+
+/**
+ * Benchmark one transfer with the byte registers and then with a block transfer.
+ */
+static void pfr_mailbox_benchmark_compare (CuTest *test, const char *transfer, bool write,
+	size_t length)
+{
+	struct pfr_mailbox_benchmark_stats bytes;
+	struct pfr_mailbox_benchmark_stats block;
+
+	pfr_mailbox_benchmark_run (test, write, false, length, &bytes);
+	pfr_mailbox_benchmark_run (test, write, true, length, &block);
+	pfr_mailbox_benchmark_print (transfer, length, &bytes, &block);
+
+	CuAssertIntEquals (test, length, bytes.transactions);
+	CuAssertIntEquals (test, 1, block.transactions);
+	CuAssertTrue (test, block.bus_ns < bytes.bus_ns);
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_mailbox_benchmark_test_write_root_key (CuTest *test)
+{
+	TEST_START;
+
+	pfr_mailbox_benchmark_compare (test, "Write root key hash", true, 32);
+}
+
+static void pfr_mailbox_benchmark_test_write_offsets (CuTest *test)
+{
+	TEST_START;
+
+	pfr_mailbox_benchmark_compare (test, "Write PFM offsets", true, 12);
+}
+
+static void pfr_mailbox_benchmark_test_write_full_fifo (CuTest *test)
+{
+	TEST_START;
+
+	pfr_mailbox_benchmark_compare (test, "Write full FIFO", true, PFR_MAILBOX_FIFO_SIZE);
+}
+
+static void pfr_mailbox_benchmark_test_read_root_key (CuTest *test)
+{
+	TEST_START;
+
+	pfr_mailbox_benchmark_compare (test, "Read root key hash", false, 32);
+}
+
+static void pfr_mailbox_benchmark_test_read_offsets (CuTest *test)
+{
+	TEST_START;
+
+	pfr_mailbox_benchmark_compare (test, "Read PFM offsets", false, 12);
+}
+
+
+CuSuite* get_pfr_mailbox_benchmark_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_mailbox_benchmark_test_write_root_key);
+	SUITE_ADD_TEST (suite, pfr_mailbox_benchmark_test_write_offsets);
+	SUITE_ADD_TEST (suite, pfr_mailbox_benchmark_test_write_full_fifo);
+	SUITE_ADD_TEST (suite, pfr_mailbox_benchmark_test_read_root_key);
+	SUITE_ADD_TEST (suite, pfr_mailbox_benchmark_test_read_offsets);
+
+	return suite;
+}
@@ -0,0 +1,259 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+/*
+ * Counts the SPI reads used to look up the definitions of a large PFM, parsing the PFM from flash
+ * for every use as the verification, FVM lookup and SPI filter setup did, and with the PFM index
+ * built once when the PFM is verified.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "testing.h"
+#include "pfr_pfm_index.h"
+
+
+static const char *SUITE = "pfr_pfm_index_benchmark";
+
+
+/**
+ * Size of the flash holding the PFM.
+ */
+#define	PFR_PFM_INDEX_BENCHMARK_FLASH_SIZE		0x10000
+
+/**
+ * Address of the PFM header, after the signature block.
+ */
+#define	PFR_PFM_INDEX_BENCHMARK_PFM_ADDR		0x1400
+
+/**
+ * Size of the Block 0 read that checks the index key.
+ */
+#define	PFR_PFM_INDEX_BENCHMARK_BLOCK0_SIZE		128
+
+/**
+ * Definitions of each type in the PFM.
+ */
+#define	PFR_PFM_INDEX_BENCHMARK_SPI_REGIONS		120
+#define	PFR_PFM_INDEX_BENCHMARK_SMBUS_RULES		100
+#define	PFR_PFM_INDEX_BENCHMARK_FVMS			8
+
+
+/**
+ * Flash that counts the SPI transactions used to read it.
+ */
+struct pfr_pfm_index_benchmark {
+	uint8_t flash[PFR_PFM_INDEX_BENCHMARK_FLASH_SIZE];	/**< Flash contents. */
+	uint32_t end;										/**< End of the PFM being built. */
+	int reads;											/**< Number of read transactions. */
+	size_t bytes;										/**< Number of bytes read. */
+};
+
+static struct pfr_pfm_index_benchmark pfr_pfm_index_benchmark_flash;
+
+
+static int pfr_pfm_index_benchmark_read (void *context, uint32_t address, uint8_t *data,
+	uint32_t length)
+{
+	struct pfr_pfm_index_benchmark *bench = (struct pfr_pfm_index_benchmark*) context;
+
+	if ((address > sizeof (bench->flash)) || (length > (sizeof (bench->flash) - address))) {
+		return -1;
+	}
+
+	memcpy (data, &bench->flash[address], length);
+	bench->reads++;
+	bench->bytes += length;
+
+	return 0;
+}
+
+static void pfr_pfm_index_benchmark_put32 (uint8_t *data, uint32_t value)
+{
+	data[0] = value;
+	data[1] = value >> 8;
+	data[2] = value >> 16;
+	data[3] = value >> 24;
+}
+
+/**
+ * Add one definition to the end of the PFM.
+ *
+ * @param bench The flash holding the PFM.
+ * @param type The definition type.
+ * @param size The size of the definition.
+ *
+ * @return The new definition.
+ */
+static uint8_t* pfr_pfm_index_benchmark_add (struct pfr_pfm_index_benchmark *bench, uint8_t type,
+	size_t size)
+{
+	uint8_t *def = &bench->flash[bench->end];
+
+	memset (def, 0, size);
+	def[0] = type;
+	bench->end += size;
+
+	return def;
+}
+
+/**
+ * Build a PFM with hundreds of definitions, with a mix of SHA-256 and SHA-384 region hashes.
+ */
+static void pfr_pfm_index_benchmark_build_pfm (struct pfr_pfm_index_benchmark *bench)
+{
+	uint8_t *header = &bench->flash[PFR_PFM_INDEX_BENCHMARK_PFM_ADDR];
+	uint8_t *def;
+	int i;
+
+	memset (bench->flash, 0xff, sizeof (bench->flash));
+	memset (header, 0, PFR_PFM_INDEX_HEADER_SIZE);
+	pfr_pfm_index_benchmark_put32 (header, PFR_PFM_INDEX_TAG);
+	header[4] = 3;
+	header[6] = 0x02;
+	header[7] = 0x01;
+	bench->end = PFR_PFM_INDEX_BENCHMARK_PFM_ADDR + PFR_PFM_INDEX_HEADER_SIZE;
+
+	for (i = 0; i < PFR_PFM_INDEX_BENCHMARK_SPI_REGIONS; i++) {
+		def = pfr_pfm_index_benchmark_add (bench, PFR_PFM_INDEX_SPI_REGION,
+			PFR_PFM_INDEX_SPI_REGION_SIZE);
+		def[1] = (i & 1) ? 0x01 : 0x03;
+		def[2] = (i % 3) ? 0x01 : 0x02;
+		pfr_pfm_index_benchmark_put32 (&def[8], i * 0x10000);
+		pfr_pfm_index_benchmark_put32 (&def[12], (i + 1) * 0x10000);
+
+		memset (&bench->flash[bench->end], i, (def[2] & 0x02) ? 48 : 32);
+		bench->end += (def[2] & 0x02) ? 48 : 32;
+	}
+	for (i = 0; i < PFR_PFM_INDEX_BENCHMARK_SMBUS_RULES; i++) {
+		def = pfr_pfm_index_benchmark_add (bench, PFR_PFM_INDEX_SMBUS_RULE,
+			PFR_PFM_INDEX_SMBUS_RULE_SIZE);
+		def[5] = i % 4;
+		def[6] = i;
+		def[7] = 0x10 + i;
+	}
+	for (i = 0; i < PFR_PFM_INDEX_BENCHMARK_FVMS; i++) {
+		def = pfr_pfm_index_benchmark_add (bench, PFR_PFM_INDEX_FVM_ADDRESS,
+			PFR_PFM_INDEX_FVM_ADDRESS_SIZE);
+		def[1] = i + 1;
+		pfr_pfm_index_benchmark_put32 (&def[8], 0x2000000 + (i * 0x100000));
+	}
+
+	pfr_pfm_index_benchmark_put32 (&bench->flash[PFR_PFM_INDEX_BENCHMARK_PFM_ADDR + 0x1c],
+		bench->end - PFR_PFM_INDEX_BENCHMARK_PFM_ADDR);
+}
+
+/**
+ * Walk a PFM the way the definition-at-a-time parser does: a one byte read for each definition
+ * type, then a read for each definition and region hash of interest.
+ *
+ * @return The number of definitions of the requested type.
+ */
+static int pfr_pfm_index_benchmark_walk (struct pfr_pfm_index_benchmark *bench, uint8_t wanted)
+{
+	uint8_t header[PFR_PFM_INDEX_HEADER_SIZE];
+	uint8_t def[PFR_PFM_INDEX_SMBUS_RULE_SIZE];
+	uint8_t hash[48];
+	uint32_t address = PFR_PFM_INDEX_BENCHMARK_PFM_ADDR;
+	uint32_t end;
+	int found = 0;
+
+	pfr_pfm_index_benchmark_read (bench, address, header, sizeof (header));
+	end = address + (header[0x1c] | (header[0x1d] << 8) | (header[0x1e] << 16));
+	address += PFR_PFM_INDEX_HEADER_SIZE;
+
+	while (address < end) {
+		pfr_pfm_index_benchmark_read (bench, address, def, 1);
+		if (def[0] == PFR_PFM_INDEX_SPI_REGION) {
+			pfr_pfm_index_benchmark_read (bench, address, def, PFR_PFM_INDEX_SPI_REGION_SIZE);
+			address += PFR_PFM_INDEX_SPI_REGION_SIZE;
+			if ((wanted == def[0]) && (def[2] & 0x03)) {
+				pfr_pfm_index_benchmark_read (bench, address, hash, (def[2] & 0x02) ? 48 : 32);
+			}
+			address += ((def[2] & 0x01) ? 32 : 0) + ((def[2] & 0x02) ? 48 : 0);
+		}
+		else if (def[0] == PFR_PFM_INDEX_SMBUS_RULE) {
+			if (wanted == def[0]) {
+				pfr_pfm_index_benchmark_read (bench, address, def, PFR_PFM_INDEX_SMBUS_RULE_SIZE);
+			}
+			address += PFR_PFM_INDEX_SMBUS_RULE_SIZE;
+		}
+		else if (def[0] == PFR_PFM_INDEX_FVM_ADDRESS) {
+			if (wanted == def[0]) {
+				pfr_pfm_index_benchmark_read (bench, address, def, PFR_PFM_INDEX_FVM_ADDRESS_SIZE);
+			}
+			address += PFR_PFM_INDEX_FVM_ADDRESS_SIZE;
+		}
+		else {
+			break;
+		}
+
+		if (wanted == def[0]) {
+			found++;
+		}
+	}
+
+	return found;
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_pfm_index_benchmark_test_lookup (CuTest *test)
+{
+	struct pfr_pfm_index_benchmark *bench = &pfr_pfm_index_benchmark_flash;
+	struct pfr_pfm_index index;
+	uint8_t block0[PFR_PFM_INDEX_BENCHMARK_BLOCK0_SIZE];
+	int parse_reads;
+	size_t parse_bytes;
+	int status;
+
+	TEST_START;
+
+	pfr_pfm_index_benchmark_build_pfm (bench);
+
+	/* Region verification, FVM lookup and SPI filter setup each parse the PFM from flash. */
+	bench->reads = 0;
+	bench->bytes = 0;
+	CuAssertIntEquals (test, PFR_PFM_INDEX_BENCHMARK_SPI_REGIONS,
+		pfr_pfm_index_benchmark_walk (bench, PFR_PFM_INDEX_SPI_REGION));
+	CuAssertIntEquals (test, PFR_PFM_INDEX_BENCHMARK_FVMS,
+		pfr_pfm_index_benchmark_walk (bench, PFR_PFM_INDEX_FVM_ADDRESS));
+	CuAssertIntEquals (test, PFR_PFM_INDEX_BENCHMARK_SPI_REGIONS,
+		pfr_pfm_index_benchmark_walk (bench, PFR_PFM_INDEX_SPI_REGION));
+	parse_reads = bench->reads;
+	parse_bytes = bench->bytes;
+
+	/* The index is built once, then each user only checks Block 0 to confirm the key. */
+	bench->reads = 0;
+	bench->bytes = 0;
+	pfr_pfm_index_benchmark_read (bench, 0, block0, sizeof (block0));
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_BENCHMARK_PFM_ADDR, false, block0, 48,
+		pfr_pfm_index_benchmark_read, bench);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_BENCHMARK_SPI_REGIONS, index.spi_region_count);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_BENCHMARK_FVMS, index.fvm_count);
+	pfr_pfm_index_benchmark_read (bench, 0, block0, sizeof (block0));
+	pfr_pfm_index_benchmark_read (bench, 0, block0, sizeof (block0));
+
+	printf ("\n%-30s %10s %10s\n", "pfm lookup, 228 definitions", "reads", "bytes");
+	printf ("%-30s %10d %10zu\n", "Parse per use", parse_reads, parse_bytes);
+	printf ("%-30s %10d %10zu\n", "Index", bench->reads, bench->bytes);
+}
+
+
+CuSuite* get_pfr_pfm_index_benchmark_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_pfm_index_benchmark_test_lookup);
+
+	return suite;
+}
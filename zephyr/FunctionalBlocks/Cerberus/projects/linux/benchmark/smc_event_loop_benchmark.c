@@ -0,0 +1,202 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+/*
+ * Posts bursts of events to the state machine event loop running on its own thread and reports
+ * the time from posting each event to running the state it selects.  The 10ms polling loop the
+ * event loop replaced added up to 10ms to every event.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "platform.h"
+#include "testing.h"
+#include "smc_event_loop.h"
+
+
+static const char *SUITE = "smc_event_loop_benchmark";
+
+
+/**
+ * Shape of the bursts of events.
+ */
+#define	SMC_EVENT_LOOP_BENCHMARK_BURSTS			20
+#define	SMC_EVENT_LOOP_BENCHMARK_BURST_SIZE		16
+#define	SMC_EVENT_LOOP_BENCHMARK_BURST_GAP_MS	3
+
+#define	SMC_EVENT_LOOP_BENCHMARK_EVENTS	\
+	(SMC_EVENT_LOOP_BENCHMARK_BURSTS * SMC_EVENT_LOOP_BENCHMARK_BURST_SIZE)
+
+/**
+ * Status returned by the queue once it has been closed and drained.
+ */
+#define	SMC_EVENT_LOOP_BENCHMARK_CLOSED			0x7f
+
+
+/**
+ * Event queue and state handler for the benchmarked loop.
+ */
+struct smc_event_loop_benchmark {
+	struct smc_event_loop loop;			/**< The loop being measured. */
+	pthread_mutex_t lock;				/**< Protects the queue. */
+	pthread_cond_t posted;				/**< Signaled when an event is queued. */
+	struct timespec *queue[SMC_EVENT_LOOP_BENCHMARK_EVENTS];	/**< Post time of each queued event. */
+	int head;							/**< Next event to remove. */
+	int count;							/**< Number of queued events. */
+	int closed;							/**< No more events will be posted. */
+	struct timespec *current;			/**< Event that selected the current state. */
+	int runs;							/**< Number of state runs. */
+	uint64_t latency[SMC_EVENT_LOOP_BENCHMARK_EVENTS];	/**< Post to run time for each state. */
+};
+
+
+static int smc_event_loop_benchmark_wait_event (struct smc_event_loop *loop, void **event)
+{
+	struct smc_event_loop_benchmark *bench = (struct smc_event_loop_benchmark*) loop->context;
+	int status = 0;
+
+	pthread_mutex_lock (&bench->lock);
+
+	while ((bench->count == 0) && !bench->closed) {
+		pthread_cond_wait (&bench->posted, &bench->lock);
+	}
+
+	if (bench->count == 0) {
+		status = SMC_EVENT_LOOP_BENCHMARK_CLOSED;
+	}
+	else {
+		*event = bench->queue[bench->head];
+		bench->head = (bench->head + 1) % SMC_EVENT_LOOP_BENCHMARK_EVENTS;
+		bench->count--;
+	}
+
+	pthread_mutex_unlock (&bench->lock);
+	return status;
+}
+
+static void smc_event_loop_benchmark_dispatch (struct smc_event_loop *loop, void *event)
+{
+	struct smc_event_loop_benchmark *bench = (struct smc_event_loop_benchmark*) loop->context;
+
+	bench->current = (struct timespec*) event;
+	smc_event_loop_transition (loop);
+}
+
+static int smc_event_loop_benchmark_run_state (struct smc_event_loop *loop)
+{
+	struct smc_event_loop_benchmark *bench = (struct smc_event_loop_benchmark*) loop->context;
+	struct timespec now;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	if (bench->runs < SMC_EVENT_LOOP_BENCHMARK_EVENTS) {
+		bench->latency[bench->runs] =
+			((int64_t) (now.tv_sec - bench->current->tv_sec) * 1000000000LL) +
+			(now.tv_nsec - bench->current->tv_nsec);
+	}
+	bench->runs++;
+
+	return 0;
+}
+
+static void* smc_event_loop_benchmark_thread (void *arg)
+{
+	struct smc_event_loop_benchmark *bench = (struct smc_event_loop_benchmark*) arg;
+
+	return (void*) (intptr_t) smc_event_loop_run (&bench->loop);
+}
+
+static int smc_event_loop_benchmark_compare_latency (const void *a, const void *b)
+{
+	uint64_t x = *((const uint64_t*) a);
+	uint64_t y = *((const uint64_t*) b);
+
+	return (x > y) - (x < y);
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void smc_event_loop_benchmark_test_burst_latency (CuTest *test)
+{
+	struct smc_event_loop_benchmark *bench;
+	struct timespec *posted;
+	pthread_t thread;
+	void *result;
+	int total = SMC_EVENT_LOOP_BENCHMARK_EVENTS;
+	int status;
+	int i;
+
+	TEST_START;
+
+	bench = calloc (1, sizeof (*bench));
+	CuAssertPtrNotNull (test, bench);
+
+	posted = calloc (total, sizeof (*posted));
+	CuAssertPtrNotNull (test, posted);
+
+	pthread_mutex_init (&bench->lock, NULL);
+	pthread_cond_init (&bench->posted, NULL);
+	bench->loop.wait_event = smc_event_loop_benchmark_wait_event;
+	bench->loop.dispatch = smc_event_loop_benchmark_dispatch;
+	bench->loop.run_state = smc_event_loop_benchmark_run_state;
+	bench->loop.context = bench;
+
+	status = pthread_create (&thread, NULL, smc_event_loop_benchmark_thread, bench);
+	CuAssertIntEquals (test, 0, status);
+
+	for (i = 0; i < total; i++) {
+		pthread_mutex_lock (&bench->lock);
+		clock_gettime (CLOCK_MONOTONIC, &posted[i]);
+		bench->queue[(bench->head + bench->count) % total] = &posted[i];
+		bench->count++;
+		pthread_cond_signal (&bench->posted);
+		pthread_mutex_unlock (&bench->lock);
+
+		if (((i + 1) % SMC_EVENT_LOOP_BENCHMARK_BURST_SIZE) == 0) {
+			platform_msleep (SMC_EVENT_LOOP_BENCHMARK_BURST_GAP_MS);
+		}
+	}
+
+	pthread_mutex_lock (&bench->lock);
+	bench->closed = 1;
+	pthread_cond_signal (&bench->posted);
+	pthread_mutex_unlock (&bench->lock);
+
+	pthread_join (thread, &result);
+	CuAssertIntEquals (test, SMC_EVENT_LOOP_BENCHMARK_CLOSED, (int) (intptr_t) result);
+	CuAssertIntEquals (test, total, bench->runs);
+
+	qsort (bench->latency, total, sizeof (bench->latency[0]),
+		smc_event_loop_benchmark_compare_latency);
+
+	printf ("\n%-22s %10s %10s %10s %10s %10s\n", "smc event loop", "events", "p50 us", "p90 us",
+		"p99 us", "max us");
+	printf ("%-22s %10d %10.1f %10.1f %10.1f %10.1f\n", "Post to state run", total,
+		bench->latency[(total * 50) / 100] / 1000.0, bench->latency[(total * 90) / 100] / 1000.0,
+		bench->latency[(total * 99) / 100] / 1000.0, bench->latency[total - 1] / 1000.0);
+
+	pthread_mutex_destroy (&bench->lock);
+	pthread_cond_destroy (&bench->posted);
+	free (posted);
+	free (bench);
+}
+
+
+CuSuite* get_smc_event_loop_benchmark_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, smc_event_loop_benchmark_test_burst_latency);
+
+	return suite;
+}
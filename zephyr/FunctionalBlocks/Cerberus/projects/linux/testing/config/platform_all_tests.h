@@ -128,6 +128,24 @@
 #define	TESTING_RUN_AES_OPENSSL_SUITE
 #define	TESTING_RUN_BASE64_OPENSSL_SUITE
 #define	TESTING_RUN_RNG_OPENSSL_SUITE
+#define	TESTING_RUN_PFR_ECDSA_SUITE
+#define	TESTING_RUN_PFR_HASH_SUITE
+#define	TESTING_RUN_PFR_UFM_CACHE_SUITE
+#define	TESTING_RUN_PFR_PBC_PLAN_SUITE
+#define	TESTING_RUN_FLASH_COPY_CHANGED_SUITE
+#define	TESTING_RUN_SMC_EVENT_LOOP_SUITE
+#define	TESTING_RUN_PFR_PFM_INDEX_SUITE
+#define	TESTING_RUN_PFR_PBC_TAG_SUITE
+#define	TESTING_RUN_PFR_MEASUREMENT_CACHE_SUITE
+#define	TESTING_RUN_PFR_SPI_COPY_SUITE
+#define	TESTING_RUN_PFR_LOG_BATCH_SUITE
+#define	TESTING_RUN_PFR_SPI_FILTER_SUITE
+#define	TESTING_RUN_PFR_SVN_SUITE
+#define	TESTING_RUN_PFR_KEY_CANCEL_SUITE
+#define	TESTING_RUN_PFR_SIG_BLOCK_SUITE
+#define	TESTING_RUN_PFR_MAILBOX_FIFO_SUITE
+#define	TESTING_RUN_PFR_I2C_RING_SUITE
+#define	TESTING_RUN_FLASH_GEOMETRY_SUITE
 
 
 #include "testing/linux_all_tests.h"
@@ -0,0 +1,271 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stdlib.h>
+#include <string.h>
+#include "platform.h"
+#include "flash/flash_common.h"
+#include "emulated_flash.h"
+
+
+/**
+ * Typical timing of a 50MHz SPI NOR flash, such as the parts on the BMC and PCH buses.
+ */
+const struct emulated_flash_timing emulated_flash_spi_nor_timing = {
+	.command_ns = 1000,
+	.read_ns_per_byte = 160,
+	.page_program_us = 700,
+	.sector_erase_us = 45000,
+	.block_erase_us = 150000,
+	.chip_erase_ms = 80000,
+};
+
+static int emulated_flash_get_device_size (struct flash *flash, uint32_t *bytes)
+{
+	struct emulated_flash *emu = (struct emulated_flash*) flash;
+
+	if ((emu == NULL) || (bytes == NULL)) {
+		return FLASH_INVALID_ARGUMENT;
+	}
+
+	*bytes = emu->size;
+	return 0;
+}
+
+static int emulated_flash_read (struct flash *flash, uint32_t address, uint8_t *data,
+	size_t length)
+{
+	struct emulated_flash *emu = (struct emulated_flash*) flash;
+
+	if ((emu == NULL) || (data == NULL)) {
+		return FLASH_INVALID_ARGUMENT;
+	}
+
+	if ((address >= emu->size) || (length > (emu->size - address))) {
+		return FLASH_ADDRESS_OUT_OF_RANGE;
+	}
+
+	memcpy (data, &emu->data[address], length);
+	emu->reads++;
+	emu->bytes_read += length;
+	emu->busy_ns += emu->timing.command_ns + ((uint64_t) emu->timing.read_ns_per_byte * length);
+
+	return 0;
+}
+
+static int emulated_flash_get_page_size (struct flash *flash, uint32_t *bytes)
+{
+	if ((flash == NULL) || (bytes == NULL)) {
+		return FLASH_INVALID_ARGUMENT;
+	}
+
+	*bytes = FLASH_PAGE_SIZE;
+	return 0;
+}
+
+static int emulated_flash_minimum_write_per_page (struct flash *flash, uint32_t *bytes)
+{
+	if ((flash == NULL) || (bytes == NULL)) {
+		return FLASH_INVALID_ARGUMENT;
+	}
+
+	*bytes = 1;
+	return 0;
+}
+
+static int emulated_flash_write (struct flash *flash, uint32_t address, const uint8_t *data,
+	size_t length)
+{
+	struct emulated_flash *emu = (struct emulated_flash*) flash;
+	uint64_t pages;
+	size_t i;
+
+	if ((emu == NULL) || (data == NULL)) {
+		return FLASH_INVALID_ARGUMENT;
+	}
+
+	if ((address >= emu->size) || (length > (emu->size - address))) {
+		return FLASH_ADDRESS_OUT_OF_RANGE;
+	}
+
+	/* NOR programming can only clear bits. */
+	for (i = 0; i < length; i++) {
+		emu->data[address + i] &= data[i];
+	}
+
+	emu->writes++;
+	emu->bytes_written += length;
+	if (length) {
+		pages = ((address + length - 1) / FLASH_PAGE_SIZE) - (address / FLASH_PAGE_SIZE) + 1;
+		emu->busy_ns += emu->timing.command_ns +
+			(pages * emu->timing.page_program_us * 1000ULL);
+	}
+
+	return length;
+}
+
+static int emulated_flash_get_sector_size (struct flash *flash, uint32_t *bytes)
+{
+	if ((flash == NULL) || (bytes == NULL)) {
+		return FLASH_INVALID_ARGUMENT;
+	}
+
+	*bytes = FLASH_SECTOR_SIZE;
+	return 0;
+}
+
+static int emulated_flash_sector_erase (struct flash *flash, uint32_t sector_addr)
+{
+	struct emulated_flash *emu = (struct emulated_flash*) flash;
+
+	if (emu == NULL) {
+		return FLASH_INVALID_ARGUMENT;
+	}
+
+	if (sector_addr >= emu->size) {
+		return FLASH_ADDRESS_OUT_OF_RANGE;
+	}
+
+	memset (&emu->data[sector_addr & FLASH_SECTOR_MASK], 0xff, FLASH_SECTOR_SIZE);
+	emu->sector_erases++;
+	emu->busy_ns += emu->timing.command_ns + (emu->timing.sector_erase_us * 1000ULL);
+
+	return 0;
+}
+
+static int emulated_flash_get_block_size (struct flash *flash, uint32_t *bytes)
+{
+	if ((flash == NULL) || (bytes == NULL)) {
+		return FLASH_INVALID_ARGUMENT;
+	}
+
+	*bytes = FLASH_BLOCK_SIZE;
+	return 0;
+}
+
+static int emulated_flash_block_erase (struct flash *flash, uint32_t block_addr)
+{
+	struct emulated_flash *emu = (struct emulated_flash*) flash;
+
+	if (emu == NULL) {
+		return FLASH_INVALID_ARGUMENT;
+	}
+
+	if (block_addr >= emu->size) {
+		return FLASH_ADDRESS_OUT_OF_RANGE;
+	}
+
+	memset (&emu->data[block_addr & FLASH_BLOCK_MASK], 0xff, FLASH_BLOCK_SIZE);
+	emu->block_erases++;
+	emu->busy_ns += emu->timing.command_ns + (emu->timing.block_erase_us * 1000ULL);
+
+	return 0;
+}
+
+static int emulated_flash_chip_erase (struct flash *flash)
+{
+	struct emulated_flash *emu = (struct emulated_flash*) flash;
+
+	if (emu == NULL) {
+		return FLASH_INVALID_ARGUMENT;
+	}
+
+	memset (emu->data, 0xff, emu->size);
+	emu->chip_erases++;
+	emu->busy_ns += emu->timing.command_ns + (emu->timing.chip_erase_ms * 1000000ULL);
+
+	return 0;
+}
+
+/**
+ * Initialize an erased emulated flash device.
+ *
+ * @param flash The flash to initialize.
+ * @param size The size of the device.  This must be a multiple of the 64kB block size.
+ *
+ * @return 0 if the flash was initialized or an error code.
+ */
+int emulated_flash_init (struct emulated_flash *flash, uint32_t size)
+{
+	if ((flash == NULL) || (size == 0) || (size & (FLASH_BLOCK_SIZE - 1))) {
+		return FLASH_INVALID_ARGUMENT;
+	}
+
+	memset (flash, 0, sizeof (struct emulated_flash));
+
+	flash->data = platform_malloc (size);
+	if (flash->data == NULL) {
+		return FLASH_NO_MEMORY;
+	}
+
+	memset (flash->data, 0xff, size);
+	flash->size = size;
+
+	flash->base.get_device_size = emulated_flash_get_device_size;
+	flash->base.read = emulated_flash_read;
+	flash->base.get_page_size = emulated_flash_get_page_size;
+	flash->base.minimum_write_per_page = emulated_flash_minimum_write_per_page;
+	flash->base.write = emulated_flash_write;
+	flash->base.get_sector_size = emulated_flash_get_sector_size;
+	flash->base.sector_erase = emulated_flash_sector_erase;
+	flash->base.get_block_size = emulated_flash_get_block_size;
+	flash->base.block_erase = emulated_flash_block_erase;
+	flash->base.chip_erase = emulated_flash_chip_erase;
+
+	return 0;
+}
+
+/**
+ * Release the resources used by an emulated flash device.
+ *
+ * @param flash The flash to release.
+ */
+void emulated_flash_release (struct emulated_flash *flash)
+{
+	if (flash) {
+		platform_free (flash->data);
+		flash->data = NULL;
+	}
+}
+
+/**
+ * Fill the whole device with a repeatable pseudo-random pattern.
+ *
+ * @param flash The flash to fill.
+ * @param seed Seed for the pattern.
+ */
+void emulated_flash_fill_pattern (struct emulated_flash *flash, uint32_t seed)
+{
+	uint32_t state = seed | 1;
+	uint32_t i;
+
+	for (i = 0; i < flash->size; i++) {
+		/* xorshift32 */
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		flash->data[i] = state >> 24;
+	}
+}
+
+/**
+ * Clear the access counters of an emulated flash device.
+ *
+ * @param flash The flash to update.
+ */
+void emulated_flash_reset_counters (struct emulated_flash *flash)
+{
+	flash->reads = 0;
+	flash->bytes_read = 0;
+	flash->writes = 0;
+	flash->bytes_written = 0;
+	flash->sector_erases = 0;
+	flash->block_erases = 0;
+	flash->chip_erases = 0;
+	flash->busy_ns = 0;
+}
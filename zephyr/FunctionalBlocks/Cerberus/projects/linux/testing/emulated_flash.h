@@ -0,0 +1,60 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#ifndef EMULATED_FLASH_H_
+#define EMULATED_FLASH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "flash/flash.h"
+
+
+/**
+ * Time taken by the flash device for each operation.  It is used to model how long a flow keeps the
+ * flash busy without sleeping, so it does not slow down the host.
+ */
+struct emulated_flash_timing {
+	uint32_t command_ns;				/**< Fixed cost of every command, including the address phase. */
+	uint32_t read_ns_per_byte;			/**< Time to clock out each byte that is read. */
+	uint32_t page_program_us;			/**< Time to program each 256 byte page. */
+	uint32_t sector_erase_us;			/**< Time for a 4kB sector erase. */
+	uint32_t block_erase_us;			/**< Time for a 64kB block erase. */
+	uint32_t chip_erase_ms;				/**< Time for a chip erase. */
+};
+
+/**
+ * A RAM backed SPI NOR flash used to run PFR flows on the host.  Programming can only clear bits
+ * and erases set whole 4kB sectors or 64kB blocks back to 0xff.
+ */
+struct emulated_flash {
+	struct flash base;					/**< Flash API. */
+	uint8_t *data;						/**< Contents of the flash. */
+	uint32_t size;						/**< Size of the flash device. */
+	uint32_t reads;						/**< Number of read requests. */
+	uint64_t bytes_read;				/**< Total number of bytes read. */
+	uint32_t writes;					/**< Number of write requests. */
+	uint64_t bytes_written;				/**< Total number of bytes programmed. */
+	uint32_t sector_erases;				/**< Number of 4kB sector erases. */
+	uint32_t block_erases;				/**< Number of 64kB block erases. */
+	uint32_t chip_erases;				/**< Number of chip erases. */
+	struct emulated_flash_timing timing;	/**< Timing model of the device.  All zero by default. */
+	uint64_t busy_ns;					/**< Modeled time the device has been busy. */
+};
+
+
+extern const struct emulated_flash_timing emulated_flash_spi_nor_timing;
+
+
+int emulated_flash_init (struct emulated_flash *flash, uint32_t size);
+void emulated_flash_release (struct emulated_flash *flash);
+
+void emulated_flash_fill_pattern (struct emulated_flash *flash, uint32_t seed);
+void emulated_flash_reset_counters (struct emulated_flash *flash);
+
+
+#endif /* EMULATED_FLASH_H_ */
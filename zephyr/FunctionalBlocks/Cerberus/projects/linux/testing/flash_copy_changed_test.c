@@ -0,0 +1,390 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "platform.h"
+#include "testing.h"
+#include "testing/engines/hash_testing_engine.h"
+#include "flash/flash_common.h"
+#include "flash/flash_util.h"
+#include "emulated_flash.h"
+
+
+static const char *SUITE = "flash_copy_changed";
+
+
+/**
+ * Layout of the emulated BMC flash.  The recovery region is refreshed from the staging region.
+ */
+#define	FLASH_COPY_CHANGED_TESTING_FLASH_SIZE		(64 * 1024 * 1024)
+#define	FLASH_COPY_CHANGED_TESTING_RECOVERY			0x0000000
+#define	FLASH_COPY_CHANGED_TESTING_STAGING			0x2000000
+#define	FLASH_COPY_CHANGED_TESTING_IMAGE_SIZE		(32 * 1024 * 1024)
+
+
+/**
+ * Set up an emulated flash where the recovery region is an exact copy of the staging region.
+ *
+ * @param test The test framework.
+ * @param flash The emulated flash to initialize.
+ * @param hash The hash engine to initialize.
+ */
+static void flash_copy_changed_testing_init (CuTest *test, struct emulated_flash *flash,
+	HASH_TESTING_ENGINE *hash)
+{
+	int status;
+
+	status = emulated_flash_init (flash, FLASH_COPY_CHANGED_TESTING_FLASH_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = HASH_TESTING_ENGINE_INIT (hash);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_fill_pattern (flash, 0x5a5a);
+	memcpy (&flash->data[FLASH_COPY_CHANGED_TESTING_RECOVERY],
+		&flash->data[FLASH_COPY_CHANGED_TESTING_STAGING], FLASH_COPY_CHANGED_TESTING_IMAGE_SIZE);
+
+	emulated_flash_reset_counters (flash);
+}
+
+static void flash_copy_changed_testing_release (struct emulated_flash *flash,
+	HASH_TESTING_ENGINE *hash)
+{
+	emulated_flash_release (flash);
+	HASH_TESTING_ENGINE_RELEASE (hash);
+}
+
+/**
+ * Corrupt one byte in each of a number of recovery sectors.  The sectors are spread across the
+ * image so each one is in a different 64kB block.
+ *
+ * @param flash The emulated flash.
+ * @param count The number of sectors to corrupt.
+ */
+static void flash_copy_changed_testing_corrupt (struct emulated_flash *flash, uint32_t count)
+{
+	uint32_t stride;
+	uint32_t addr;
+	uint32_t i;
+
+	if (count == 0) {
+		return;
+	}
+
+	stride = FLASH_COPY_CHANGED_TESTING_IMAGE_SIZE / count;
+	for (i = 0; i < count; i++) {
+		addr = FLASH_COPY_CHANGED_TESTING_RECOVERY + (i * stride) + FLASH_SECTOR_SIZE +
+			((i * 0x123) % FLASH_SECTOR_SIZE);
+		flash->data[addr] ^= 0x01;
+	}
+}
+
+/**
+ * Check that the recovery region matches the staging region.
+ */
+static void flash_copy_changed_testing_check_image (CuTest *test, struct emulated_flash *flash)
+{
+	int status;
+
+	status = testing_validate_array (&flash->data[FLASH_COPY_CHANGED_TESTING_STAGING],
+		&flash->data[FLASH_COPY_CHANGED_TESTING_RECOVERY], FLASH_COPY_CHANGED_TESTING_IMAGE_SIZE);
+	CuAssertIntEquals (test, 0, status);
+}
+
+/**
+ * Refresh the recovery region after corrupting a number of sectors and check that the amount of
+ * flash that was erased and programmed only depends on the number of corrupted sectors.
+ */
+static void flash_copy_changed_testing_sector_recovery (CuTest *test, uint32_t count)
+{
+	HASH_TESTING_ENGINE hash;
+	struct emulated_flash flash;
+	size_t updated;
+	int status;
+
+	flash_copy_changed_testing_init (test, &flash, &hash);
+	flash_copy_changed_testing_corrupt (&flash, count);
+
+	status = flash_sector_copy_changed_and_verify (&flash.base,
+		FLASH_COPY_CHANGED_TESTING_RECOVERY, FLASH_COPY_CHANGED_TESTING_STAGING,
+		FLASH_COPY_CHANGED_TESTING_IMAGE_SIZE, &hash.base, &updated);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, count, updated);
+	CuAssertIntEquals (test, count, flash.sector_erases);
+	CuAssertIntEquals (test, 0, flash.block_erases);
+	CuAssertIntEquals (test, count * FLASH_SECTOR_SIZE, flash.bytes_written);
+
+	flash_copy_changed_testing_check_image (test, &flash);
+
+	flash_copy_changed_testing_release (&flash, &hash);
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void flash_copy_changed_test_hash_verify_copy_ext (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct emulated_flash flash;
+	int status;
+
+	TEST_START;
+
+	flash_copy_changed_testing_init (test, &flash, &hash);
+
+	status = flash_hash_verify_copy_ext (&flash.base, FLASH_COPY_CHANGED_TESTING_RECOVERY,
+		&flash.base, FLASH_COPY_CHANGED_TESTING_STAGING, FLASH_BLOCK_SIZE, &hash.base);
+	CuAssertIntEquals (test, 0, status);
+
+	flash.data[FLASH_COPY_CHANGED_TESTING_RECOVERY + FLASH_BLOCK_SIZE - 1] ^= 0x80;
+
+	status = flash_hash_verify_copy_ext (&flash.base, FLASH_COPY_CHANGED_TESTING_RECOVERY,
+		&flash.base, FLASH_COPY_CHANGED_TESTING_STAGING, FLASH_BLOCK_SIZE, &hash.base);
+	CuAssertIntEquals (test, FLASH_UTIL_DATA_MISMATCH, status);
+
+	CuAssertIntEquals (test, 0, flash.writes);
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+
+	flash_copy_changed_testing_release (&flash, &hash);
+}
+
+static void flash_copy_changed_test_identical (CuTest *test)
+{
+	TEST_START;
+
+	flash_copy_changed_testing_sector_recovery (test, 0);
+}
+
+static void flash_copy_changed_test_one_sector (CuTest *test)
+{
+	TEST_START;
+
+	flash_copy_changed_testing_sector_recovery (test, 1);
+}
+
+static void flash_copy_changed_test_scales_with_corruption (CuTest *test)
+{
+	TEST_START;
+
+	flash_copy_changed_testing_sector_recovery (test, 4);
+	flash_copy_changed_testing_sector_recovery (test, 16);
+	flash_copy_changed_testing_sector_recovery (test, 64);
+}
+
+static void flash_copy_changed_test_block_erase (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct emulated_flash flash;
+	size_t updated;
+	int status;
+
+	TEST_START;
+
+	flash_copy_changed_testing_init (test, &flash, &hash);
+	flash_copy_changed_testing_corrupt (&flash, 8);
+
+	status = flash_copy_changed_and_verify (&flash.base, FLASH_COPY_CHANGED_TESTING_RECOVERY,
+		FLASH_COPY_CHANGED_TESTING_STAGING, FLASH_COPY_CHANGED_TESTING_IMAGE_SIZE, &hash.base,
+		&updated);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 8, updated);
+	CuAssertIntEquals (test, 8, flash.block_erases);
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+	CuAssertIntEquals (test, 8 * FLASH_BLOCK_SIZE, flash.bytes_written);
+
+	flash_copy_changed_testing_check_image (test, &flash);
+
+	flash_copy_changed_testing_release (&flash, &hash);
+}
+
+static void flash_copy_changed_test_blank_destination (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct emulated_flash flash;
+	size_t updated;
+	int status;
+
+	TEST_START;
+
+	flash_copy_changed_testing_init (test, &flash, &hash);
+	memset (&flash.data[FLASH_COPY_CHANGED_TESTING_RECOVERY], 0xff, 0x100000);
+
+	status = flash_sector_copy_changed_and_verify (&flash.base,
+		FLASH_COPY_CHANGED_TESTING_RECOVERY, FLASH_COPY_CHANGED_TESTING_STAGING,
+		FLASH_COPY_CHANGED_TESTING_IMAGE_SIZE, &hash.base, &updated);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 0x100000 / FLASH_SECTOR_SIZE, updated);
+	CuAssertIntEquals (test, 0x100000 / FLASH_SECTOR_SIZE, flash.sector_erases);
+
+	flash_copy_changed_testing_check_image (test, &flash);
+
+	flash_copy_changed_testing_release (&flash, &hash);
+}
+
+static void flash_copy_changed_test_partial_sector (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct emulated_flash flash;
+	uint32_t length = (3 * FLASH_SECTOR_SIZE) + 0x345;
+	size_t updated;
+	int status;
+
+	TEST_START;
+
+	flash_copy_changed_testing_init (test, &flash, &hash);
+	flash.data[FLASH_COPY_CHANGED_TESTING_RECOVERY + length - 1] ^= 0xff;
+	flash.data[FLASH_COPY_CHANGED_TESTING_RECOVERY + length] ^= 0xff;
+
+	status = flash_sector_copy_changed_and_verify (&flash.base,
+		FLASH_COPY_CHANGED_TESTING_RECOVERY, FLASH_COPY_CHANGED_TESTING_STAGING, length,
+		&hash.base, &updated);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 1, updated);
+	CuAssertIntEquals (test, 1, flash.sector_erases);
+	CuAssertIntEquals (test, 0x345, flash.bytes_written);
+
+	status = testing_validate_array (&flash.data[FLASH_COPY_CHANGED_TESTING_STAGING],
+		&flash.data[FLASH_COPY_CHANGED_TESTING_RECOVERY], length);
+	CuAssertIntEquals (test, 0, status);
+
+	flash_copy_changed_testing_release (&flash, &hash);
+}
+
+static void flash_copy_changed_test_ext (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct emulated_flash flash;
+	struct emulated_flash dest;
+	size_t updated;
+	int status;
+
+	TEST_START;
+
+	flash_copy_changed_testing_init (test, &flash, &hash);
+
+	status = emulated_flash_init (&dest, FLASH_COPY_CHANGED_TESTING_IMAGE_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	memcpy (dest.data, &flash.data[FLASH_COPY_CHANGED_TESTING_STAGING],
+		FLASH_COPY_CHANGED_TESTING_IMAGE_SIZE);
+	dest.data[0x123456] ^= 0x10;
+	dest.data[0x1abcdef] ^= 0x20;
+
+	status = flash_sector_copy_ext_changed_and_verify (&dest.base, 0, &flash.base,
+		FLASH_COPY_CHANGED_TESTING_STAGING, FLASH_COPY_CHANGED_TESTING_IMAGE_SIZE, &hash.base,
+		&updated);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 2, updated);
+	CuAssertIntEquals (test, 2, dest.sector_erases);
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+	CuAssertIntEquals (test, 0, flash.writes);
+
+	status = testing_validate_array (&flash.data[FLASH_COPY_CHANGED_TESTING_STAGING], dest.data,
+		FLASH_COPY_CHANGED_TESTING_IMAGE_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = flash_copy_ext_changed_and_verify (&dest.base, 0, &flash.base,
+		FLASH_COPY_CHANGED_TESTING_STAGING, FLASH_COPY_CHANGED_TESTING_IMAGE_SIZE, &hash.base,
+		NULL);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, dest.block_erases);
+
+	emulated_flash_release (&dest);
+	flash_copy_changed_testing_release (&flash, &hash);
+}
+
+static void flash_copy_changed_test_same_erase_block (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct emulated_flash flash;
+	int status;
+
+	TEST_START;
+
+	flash_copy_changed_testing_init (test, &flash, &hash);
+
+	status = flash_copy_changed_and_verify (&flash.base, 0x10000, 0x18000, 0x1000, &hash.base,
+		NULL);
+	CuAssertIntEquals (test, FLASH_UTIL_SAME_ERASE_BLOCK, status);
+
+	status = flash_sector_copy_changed_and_verify (&flash.base, 0x10000, 0x10800, 0x800,
+		&hash.base, NULL);
+	CuAssertIntEquals (test, FLASH_UTIL_SAME_ERASE_BLOCK, status);
+
+	status = flash_sector_copy_changed_and_verify (&flash.base, 0x10000, 0x11000, 0x2000,
+		&hash.base, NULL);
+	CuAssertIntEquals (test, FLASH_UTIL_COPY_OVERLAP, status);
+
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+	CuAssertIntEquals (test, 0, flash.block_erases);
+
+	flash_copy_changed_testing_release (&flash, &hash);
+}
+
+static void flash_copy_changed_test_null (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct emulated_flash flash;
+	size_t updated = 5;
+	int status;
+
+	TEST_START;
+
+	flash_copy_changed_testing_init (test, &flash, &hash);
+
+	status = flash_sector_copy_changed_and_verify (NULL, FLASH_COPY_CHANGED_TESTING_RECOVERY,
+		FLASH_COPY_CHANGED_TESTING_STAGING, FLASH_SECTOR_SIZE, &hash.base, &updated);
+	CuAssertIntEquals (test, FLASH_UTIL_INVALID_ARGUMENT, status);
+
+	status = flash_copy_changed_and_verify (&flash.base, FLASH_COPY_CHANGED_TESTING_RECOVERY,
+		FLASH_COPY_CHANGED_TESTING_STAGING, FLASH_SECTOR_SIZE, NULL, &updated);
+	CuAssertIntEquals (test, FLASH_UTIL_INVALID_ARGUMENT, status);
+
+	status = flash_sector_copy_ext_changed_and_verify (&flash.base,
+		FLASH_COPY_CHANGED_TESTING_RECOVERY, NULL, FLASH_COPY_CHANGED_TESTING_STAGING,
+		FLASH_SECTOR_SIZE, &hash.base, &updated);
+	CuAssertIntEquals (test, FLASH_UTIL_INVALID_ARGUMENT, status);
+
+	status = flash_hash_verify_copy_ext (&flash.base, 0, &flash.base, 0x10000, FLASH_SECTOR_SIZE,
+		NULL);
+	CuAssertIntEquals (test, FLASH_UTIL_INVALID_ARGUMENT, status);
+
+	status = flash_copy_changed_and_verify (&flash.base, FLASH_COPY_CHANGED_TESTING_RECOVERY,
+		FLASH_COPY_CHANGED_TESTING_STAGING, 0, &hash.base, &updated);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, updated);
+
+	flash_copy_changed_testing_release (&flash, &hash);
+}
+
+
+CuSuite* get_flash_copy_changed_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, flash_copy_changed_test_hash_verify_copy_ext);
+	SUITE_ADD_TEST (suite, flash_copy_changed_test_identical);
+	SUITE_ADD_TEST (suite, flash_copy_changed_test_one_sector);
+	SUITE_ADD_TEST (suite, flash_copy_changed_test_scales_with_corruption);
+	SUITE_ADD_TEST (suite, flash_copy_changed_test_block_erase);
+	SUITE_ADD_TEST (suite, flash_copy_changed_test_blank_destination);
+	SUITE_ADD_TEST (suite, flash_copy_changed_test_partial_sector);
+	SUITE_ADD_TEST (suite, flash_copy_changed_test_ext);
+	SUITE_ADD_TEST (suite, flash_copy_changed_test_same_erase_block);
+	SUITE_ADD_TEST (suite, flash_copy_changed_test_null);
+
+	return suite;
+}
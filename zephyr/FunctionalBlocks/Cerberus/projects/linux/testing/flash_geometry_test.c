@@ -0,0 +1,1006 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "testing.h"
+#include "flash/flash_common.h"
+#include "FlashGeometry.h"
+
+
+static const char *SUITE = "flash_geometry";
+
+
+/**
+ * Bytes of device memory kept by the mock for programs.
+ */
+#define	FLASH_GEOMETRY_TESTING_MEMORY	0x20000
+
+/**
+ * Size of the device used for erase tests, small enough to track every sector.
+ */
+#define	FLASH_GEOMETRY_TESTING_ERASE_DEVICE		0x100000
+
+/**
+ * Number of sectors tracked for erase tests.
+ */
+#define	FLASH_GEOMETRY_TESTING_SECTORS	(FLASH_GEOMETRY_TESTING_ERASE_DEVICE / 0x1000)
+
+/**
+ * Error returned by the mock when an injected fault hits.
+ */
+#define	FLASH_GEOMETRY_TESTING_ERROR	-20
+
+
+/**
+ * Mock of the driver commands, counting what is sent to the devices.
+ */
+struct flash_geometry_testing {
+	uint32_t device_size[FLASH_GEOMETRY_DEVICES];	/**< Size reported by each device, or 0. */
+	uint32_t sector_size;							/**< Sector size erased by the devices. */
+	uint32_t block_size;							/**< Block size reported by the devices. */
+	int queries[FLASH_GEOMETRY_DEVICES];			/**< Geometry queries sent to each device. */
+	int programs;									/**< Program commands sent. */
+	int program_fail;								/**< Programs before one fails, or -1. */
+	uint32_t max_length;							/**< Longest program command. */
+	int unaligned;									/**< Programs after the first not on a page. */
+	uint16_t flags;									/**< Flags of the last program command. */
+	int erases[4];									/**< 4kB, 32kB, 64kB and chip erases sent. */
+	int erase_fail;									/**< Erases before one fails, or -1. */
+	int misaligned;									/**< Erases not aligned to their size. */
+	uint8_t erased[FLASH_GEOMETRY_TESTING_SECTORS];	/**< Times each sector was erased. */
+	uint8_t memory[FLASH_GEOMETRY_TESTING_MEMORY];	/**< Programmed data. */
+};
+
+/**
+ * The active mock, for the command handler.
+ */
+static struct flash_geometry_testing *flash_geometry_testing_active;
+
+static int flash_geometry_testing_erase (struct flash_geometry_testing *testing,
+	struct flash_xfer *xfer, int type, uint32_t length)
+{
+	uint32_t address = (type == 3) ? 0 : xfer->address;
+	uint32_t i;
+
+	if (testing->erase_fail == 0) {
+		return FLASH_GEOMETRY_TESTING_ERROR;
+	}
+	if (testing->erase_fail > 0) {
+		testing->erase_fail--;
+	}
+
+	if (address % length) {
+		testing->misaligned++;
+	}
+	for (i = address / testing->sector_size;
+		(i < ((address + length) / testing->sector_size)) && (i < FLASH_GEOMETRY_TESTING_SECTORS);
+		i++) {
+		testing->erased[i]++;
+	}
+	testing->flags = xfer->flags;
+	testing->erases[type]++;
+
+	return 0;
+}
+
+static int flash_geometry_testing_xfer (struct spi_flash *flash, struct flash_xfer *xfer)
+{
+	struct flash_geometry_testing *testing = flash_geometry_testing_active;
+	uint8_t device_id = flash->device_id[0];
+
+	switch (xfer->cmd) {
+		case FLASH_GEOMETRY_CMD_DEVICE_SIZE:
+			testing->queries[device_id]++;
+			return (testing->device_size[device_id]) ? (int) testing->device_size[device_id] : -19;
+
+		case FLASH_GEOMETRY_CMD_BLOCK_SIZE:
+			testing->queries[device_id]++;
+			return testing->block_size;
+
+		case FLASH_CMD_PP:
+			if (testing->program_fail == 0) {
+				return FLASH_GEOMETRY_TESTING_ERROR;
+			}
+			if (testing->program_fail > 0) {
+				testing->program_fail--;
+			}
+
+			if (testing->programs && FLASH_PAGE_OFFSET (xfer->address)) {
+				testing->unaligned++;
+			}
+			if (xfer->length > testing->max_length) {
+				testing->max_length = xfer->length;
+			}
+			if ((xfer->address + xfer->length) <= FLASH_GEOMETRY_TESTING_MEMORY) {
+				memcpy (&testing->memory[xfer->address], xfer->data, xfer->length);
+			}
+			testing->flags = xfer->flags;
+			testing->programs++;
+			return 0;
+
+		case FLASH_CMD_4K_ERASE:
+			return flash_geometry_testing_erase (testing, xfer, 0, testing->sector_size);
+
+		case FLASH_GEOMETRY_CMD_32K_ERASE:
+			return flash_geometry_testing_erase (testing, xfer, 1, testing->block_size / 2);
+
+		case FLASH_CMD_64K_ERASE:
+			return flash_geometry_testing_erase (testing, xfer, 2, testing->block_size);
+
+		case FLASH_CMD_CE:
+			return flash_geometry_testing_erase (testing, xfer, 3, testing->device_size[device_id]);
+
+		default:
+			return FLASH_GEOMETRY_TESTING_ERROR;
+	}
+}
+
+static void flash_geometry_testing_init (struct flash_geometry_testing *testing,
+	struct flash_geometry_cache *cache, struct spi_flash *flash)
+{
+	int i;
+
+	memset (testing, 0, sizeof (*testing));
+	for (i = 0; i < FLASH_GEOMETRY_DEVICES; i++) {
+		testing->device_size[i] = 0x1000000;
+	}
+	testing->sector_size = 0x1000;
+	testing->block_size = 0x10000;
+	testing->program_fail = -1;
+	testing->erase_fail = -1;
+	memset (testing->memory, 0xff, sizeof (testing->memory));
+
+	flash_geometry_testing_active = testing;
+
+	memset (flash, 0, sizeof (*flash));
+	Wrapper_flash_geometry_init (cache, flash_geometry_testing_xfer);
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void flash_geometry_test_get (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	const struct flash_geometry *geometry;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	testing.device_size[0] = 0x2000000;
+	testing.block_size = 0x8000;
+
+	status = Wrapper_flash_geometry_get (&cache, &flash, &geometry);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0x2000000, geometry->device_size);
+	CuAssertIntEquals (test, FLASH_PAGE_SIZE, geometry->page_size);
+	CuAssertIntEquals (test, 0x1000, geometry->sector_size);
+	CuAssertIntEquals (test, 0x8000, geometry->block_size);
+	CuAssertIntEquals (test, FLASH_FLAG_4BYTE_ADDRESS, geometry->addr_mode);
+	CuAssertIntEquals (test, FLASH_GEOMETRY_MAX_PROGRAM, geometry->max_program);
+
+	CuAssertIntEquals (test, 0x2000000, flash.device_size);
+	CuAssertIntEquals (test, FLASH_FLAG_4BYTE_ADDRESS, flash.addr_mode);
+	CuAssertIntEquals (test, 2, testing.queries[0]);
+}
+
+static void flash_geometry_test_get_3byte_address (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	const struct flash_geometry *geometry;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+
+	status = Wrapper_flash_geometry_get (&cache, &flash, &geometry);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0x1000000, geometry->device_size);
+	CuAssertIntEquals (test, 0, geometry->addr_mode);
+	CuAssertIntEquals (test, 0, flash.addr_mode);
+}
+
+static void flash_geometry_test_get_default_erase_sizes (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	const struct flash_geometry *geometry;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	testing.block_size = 0;
+
+	status = Wrapper_flash_geometry_get (&cache, &flash, &geometry);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, FLASH_GEOMETRY_SECTOR_SIZE, geometry->sector_size);
+	CuAssertIntEquals (test, FLASH_GEOMETRY_BLOCK_SIZE, geometry->block_size);
+}
+
+static void flash_geometry_test_get_probes_once (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	const struct flash_geometry *geometry;
+	int status;
+	int i;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+
+	for (i = 0; i < 1000; i++) {
+		status = Wrapper_flash_geometry_get (&cache, &flash, &geometry);
+		CuAssertIntEquals (test, 0, status);
+
+		status = Wrapper_flash_geometry_check (geometry, i * FLASH_PAGE_SIZE, FLASH_PAGE_SIZE);
+		CuAssertIntEquals (test, 0, status);
+	}
+
+	CuAssertIntEquals (test, 2, testing.queries[0]);
+}
+
+static void flash_geometry_test_get_per_device (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	const struct flash_geometry *geometry;
+	int status;
+	int i;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	for (i = 0; i < FLASH_GEOMETRY_DEVICES; i++) {
+		testing.device_size[i] = 0x100000 << (i % 8);
+	}
+
+	for (i = 0; i < (FLASH_GEOMETRY_DEVICES * 4); i++) {
+		flash.device_id[0] = i % FLASH_GEOMETRY_DEVICES;
+
+		status = Wrapper_flash_geometry_get (&cache, &flash, &geometry);
+		CuAssertIntEquals (test, 0, status);
+		CuAssertIntEquals (test, testing.device_size[flash.device_id[0]], geometry->device_size);
+		CuAssertIntEquals (test, testing.device_size[flash.device_id[0]], flash.device_size);
+	}
+
+	for (i = 0; i < FLASH_GEOMETRY_DEVICES; i++) {
+		CuAssertIntEquals (test, 2, testing.queries[i]);
+	}
+}
+
+static void flash_geometry_test_get_no_device (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	const struct flash_geometry *geometry;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	testing.device_size[0] = 0;
+
+	status = Wrapper_flash_geometry_get (&cache, &flash, &geometry);
+	CuAssertIntEquals (test, SPI_FLASH_NO_DEVICE, status);
+	CuAssertIntEquals (test, 1, testing.queries[0]);
+
+	/* A failed probe is not cached. */
+	testing.device_size[0] = 0x1000000;
+
+	status = Wrapper_flash_geometry_get (&cache, &flash, &geometry);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0x1000000, geometry->device_size);
+	CuAssertIntEquals (test, 3, testing.queries[0]);
+}
+
+static void flash_geometry_test_get_unsupported_device (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	const struct flash_geometry *geometry;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	flash.device_id[0] = FLASH_GEOMETRY_DEVICES;
+
+	status = Wrapper_flash_geometry_get (&cache, &flash, &geometry);
+	CuAssertIntEquals (test, SPI_FLASH_UNSUPPORTED_DEVICE, status);
+}
+
+static void flash_geometry_test_get_null (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	const struct flash_geometry *geometry;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+
+	status = Wrapper_flash_geometry_get (NULL, &flash, &geometry);
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+
+	status = Wrapper_flash_geometry_get (&cache, NULL, &geometry);
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+
+	status = Wrapper_flash_geometry_get (&cache, &flash, NULL);
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+
+	Wrapper_flash_geometry_init (&cache, NULL);
+
+	status = Wrapper_flash_geometry_get (&cache, &flash, &geometry);
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+}
+
+static void flash_geometry_test_invalidate (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	const struct flash_geometry *geometry;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+
+	status = Wrapper_flash_geometry_get (&cache, &flash, &geometry);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0x1000000, geometry->device_size);
+
+	testing.device_size[0] = 0x4000000;
+	Wrapper_flash_geometry_invalidate (&cache, 0);
+	Wrapper_flash_geometry_invalidate (&cache, FLASH_GEOMETRY_DEVICES);
+	Wrapper_flash_geometry_invalidate (NULL, 0);
+
+	status = Wrapper_flash_geometry_get (&cache, &flash, &geometry);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0x4000000, geometry->device_size);
+	CuAssertIntEquals (test, FLASH_FLAG_4BYTE_ADDRESS, flash.addr_mode);
+	CuAssertIntEquals (test, 4, testing.queries[0]);
+}
+
+static void flash_geometry_test_check (CuTest *test)
+{
+	struct flash_geometry geometry;
+	int status;
+
+	TEST_START;
+
+	memset (&geometry, 0, sizeof (geometry));
+	geometry.device_size = 0x1000000;
+
+	status = Wrapper_flash_geometry_check (&geometry, 0, 0x1000000);
+	CuAssertIntEquals (test, 0, status);
+
+	status = Wrapper_flash_geometry_check (&geometry, 0xfffff0, 0x10);
+	CuAssertIntEquals (test, 0, status);
+
+	status = Wrapper_flash_geometry_check (&geometry, 0x1000000, 1);
+	CuAssertIntEquals (test, SPI_FLASH_ADDRESS_OUT_OF_RANGE, status);
+
+	status = Wrapper_flash_geometry_check (&geometry, 0xfffff0, 0x11);
+	CuAssertIntEquals (test, SPI_FLASH_OPERATION_OUT_OF_RANGE, status);
+
+	/* The end of the access wraps past the top of the address space. */
+	status = Wrapper_flash_geometry_check (&geometry, 0xfffff0, 0xffffff20);
+	CuAssertIntEquals (test, SPI_FLASH_OPERATION_OUT_OF_RANGE, status);
+
+	status = Wrapper_flash_geometry_check (NULL, 0, 1);
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+}
+
+static void flash_geometry_test_program_aligned (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	uint8_t data[0x10000];
+	size_t i;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	for (i = 0; i < sizeof (data); i++) {
+		data[i] = i * 7;
+	}
+
+	status = Wrapper_flash_geometry_program (&cache, &flash, 0x10000, data, sizeof (data));
+	CuAssertIntEquals (test, sizeof (data), status);
+
+	/* 16 commands instead of one for each of the 256 pages. */
+	CuAssertIntEquals (test, sizeof (data) / FLASH_GEOMETRY_MAX_PROGRAM, testing.programs);
+	CuAssertIntEquals (test, FLASH_GEOMETRY_MAX_PROGRAM, testing.max_length);
+	CuAssertIntEquals (test, 0, testing.unaligned);
+	CuAssertIntEquals (test, 0, testing.flags & FLASH_FLAG_4BYTE_ADDRESS);
+
+	status = testing_validate_array (data, &testing.memory[0x10000], sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+}
+
+static void flash_geometry_test_program_unaligned (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	uint8_t data[10000];
+	size_t i;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	for (i = 0; i < sizeof (data); i++) {
+		data[i] = i * 13;
+	}
+
+	status = Wrapper_flash_geometry_program (&cache, &flash, 0x1010, data, sizeof (data));
+	CuAssertIntEquals (test, sizeof (data), status);
+
+	/* 0x1010-0x1fff, 0x2000-0x2fff, 0x3000-0x3720 */
+	CuAssertIntEquals (test, 3, testing.programs);
+	CuAssertIntEquals (test, FLASH_GEOMETRY_MAX_PROGRAM, testing.max_length);
+	CuAssertIntEquals (test, 0, testing.unaligned);
+
+	status = testing_validate_array (data, &testing.memory[0x1010], sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0xff, testing.memory[0x100f]);
+	CuAssertIntEquals (test, 0xff, testing.memory[0x1010 + sizeof (data)]);
+}
+
+static void flash_geometry_test_program_mid_page (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	uint8_t data[FLASH_GEOMETRY_MAX_PROGRAM];
+	size_t i;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	for (i = 0; i < sizeof (data); i++) {
+		data[i] = i * 3;
+	}
+
+	/* The first command ends on a page boundary, so later ones start on one. */
+	status = Wrapper_flash_geometry_program (&cache, &flash, 0x180, data, sizeof (data));
+	CuAssertIntEquals (test, sizeof (data), status);
+	CuAssertIntEquals (test, 2, testing.programs);
+	CuAssertIntEquals (test, 0, testing.unaligned);
+
+	status = testing_validate_array (data, &testing.memory[0x180], sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+}
+
+static void flash_geometry_test_program_small (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	uint8_t data[] = {0x01, 0x02, 0x03, 0x04};
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+
+	status = Wrapper_flash_geometry_program (&cache, &flash, 0x1ff, data, sizeof (data));
+	CuAssertIntEquals (test, sizeof (data), status);
+	CuAssertIntEquals (test, 1, testing.programs);
+
+	status = testing_validate_array (data, &testing.memory[0x1ff], sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+}
+
+static void flash_geometry_test_program_4byte_address (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	uint8_t data[] = {0x01, 0x02, 0x03, 0x04};
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	testing.device_size[0] = 0x4000000;
+
+	status = Wrapper_flash_geometry_program (&cache, &flash, 0, data, sizeof (data));
+	CuAssertIntEquals (test, sizeof (data), status);
+	CuAssertIntEquals (test, FLASH_FLAG_4BYTE_ADDRESS, testing.flags & FLASH_FLAG_4BYTE_ADDRESS);
+}
+
+static void flash_geometry_test_program_out_of_range (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	uint8_t data[0x20];
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	memset (data, 0x55, sizeof (data));
+
+	status = Wrapper_flash_geometry_program (&cache, &flash, 0x1000000, data, sizeof (data));
+	CuAssertIntEquals (test, SPI_FLASH_ADDRESS_OUT_OF_RANGE, status);
+
+	status = Wrapper_flash_geometry_program (&cache, &flash, 0xfffff0, data, sizeof (data));
+	CuAssertIntEquals (test, SPI_FLASH_OPERATION_OUT_OF_RANGE, status);
+
+	CuAssertIntEquals (test, 0, testing.programs);
+}
+
+static void flash_geometry_test_program_zero_length (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+
+	status = Wrapper_flash_geometry_program (&cache, &flash, 0, NULL, 0);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, testing.programs);
+}
+
+static void flash_geometry_test_program_null (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	uint8_t data[0x20];
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+
+	status = Wrapper_flash_geometry_program (&cache, &flash, 0, NULL, sizeof (data));
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+
+	status = Wrapper_flash_geometry_program (NULL, &flash, 0, data, sizeof (data));
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+
+	status = Wrapper_flash_geometry_program (&cache, NULL, 0, data, sizeof (data));
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+
+	CuAssertIntEquals (test, 0, testing.programs);
+}
+
+static void flash_geometry_test_program_error (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	uint8_t data[0x3000];
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	memset (data, 0x55, sizeof (data));
+	testing.program_fail = 0;
+
+	status = Wrapper_flash_geometry_program (&cache, &flash, 0, data, sizeof (data));
+	CuAssertIntEquals (test, FLASH_GEOMETRY_TESTING_ERROR, status);
+}
+
+static void flash_geometry_test_program_partial (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	uint8_t data[0x3000];
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	memset (data, 0x55, sizeof (data));
+	testing.program_fail = 2;
+
+	status = Wrapper_flash_geometry_program (&cache, &flash, 0, data, sizeof (data));
+	CuAssertIntEquals (test, 2 * FLASH_GEOMETRY_MAX_PROGRAM, status);
+	CuAssertIntEquals (test, 0xff, testing.memory[2 * FLASH_GEOMETRY_MAX_PROGRAM]);
+}
+
+
+/**
+ * Erase a region and check that exactly the sectors containing it were erased once each.
+ */
+static void flash_geometry_testing_erase_region (CuTest *test,
+	struct flash_geometry_testing *testing, struct flash_geometry_cache *cache,
+	struct spi_flash *flash, uint32_t address, uint32_t length)
+{
+	uint32_t first = address / testing->sector_size;
+	uint32_t last = (address + length + testing->sector_size - 1) / testing->sector_size;
+	uint32_t i;
+	int status;
+
+	memset (testing->erased, 0, sizeof (testing->erased));
+	memset (testing->erases, 0, sizeof (testing->erases));
+
+	status = Wrapper_flash_geometry_erase (cache, flash, address, length);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, testing->misaligned);
+
+	for (i = 0; i < FLASH_GEOMETRY_TESTING_SECTORS; i++) {
+		CuAssertIntEquals (test, ((i >= first) && (i < last)) ? 1 : 0, testing->erased[i]);
+	}
+}
+
+static void flash_geometry_test_get_erase_sizes (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	const struct flash_geometry *geometry;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+
+	status = Wrapper_flash_geometry_get (&cache, &flash, &geometry);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, FLASH_GEOMETRY_ERASE_4K | FLASH_GEOMETRY_ERASE_32K |
+		FLASH_GEOMETRY_ERASE_64K | FLASH_GEOMETRY_ERASE_CHIP, geometry->erase_sizes);
+
+	/* Half a block is no larger than a sector, so there is no 32kB erase. */
+	testing.block_size = 0x2000;
+	Wrapper_flash_geometry_invalidate (&cache, 0);
+
+	status = Wrapper_flash_geometry_get (&cache, &flash, &geometry);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, FLASH_GEOMETRY_ERASE_4K | FLASH_GEOMETRY_ERASE_64K |
+		FLASH_GEOMETRY_ERASE_CHIP, geometry->erase_sizes);
+}
+
+static void flash_geometry_test_erase_step (CuTest *test)
+{
+	struct flash_geometry geometry;
+	struct flash_geometry_erase erase;
+	int status;
+
+	TEST_START;
+
+	memset (&geometry, 0, sizeof (geometry));
+	geometry.device_size = 0x1000000;
+	geometry.sector_size = 0x1000;
+	geometry.block_size = 0x10000;
+	geometry.erase_sizes = FLASH_GEOMETRY_ERASE_4K | FLASH_GEOMETRY_ERASE_32K |
+		FLASH_GEOMETRY_ERASE_64K | FLASH_GEOMETRY_ERASE_CHIP;
+
+	status = Wrapper_flash_geometry_erase_step (&geometry, 0, 0x1000000, &erase);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, FLASH_CMD_CE, erase.cmd);
+	CuAssertIntEquals (test, 0, erase.address);
+	CuAssertIntEquals (test, 0x1000000, erase.length);
+
+	status = Wrapper_flash_geometry_erase_step (&geometry, 0, 0xfff000, &erase);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, FLASH_CMD_64K_ERASE, erase.cmd);
+	CuAssertIntEquals (test, 0, erase.address);
+	CuAssertIntEquals (test, 0x10000, erase.length);
+
+	status = Wrapper_flash_geometry_erase_step (&geometry, 0x18000, 0x30000, &erase);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, FLASH_GEOMETRY_CMD_32K_ERASE, erase.cmd);
+	CuAssertIntEquals (test, 0x18000, erase.address);
+	CuAssertIntEquals (test, 0x8000, erase.length);
+
+	status = Wrapper_flash_geometry_erase_step (&geometry, 0x10000, 0x18000, &erase);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, FLASH_GEOMETRY_CMD_32K_ERASE, erase.cmd);
+
+	status = Wrapper_flash_geometry_erase_step (&geometry, 0x10000, 0x17000, &erase);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, FLASH_CMD_4K_ERASE, erase.cmd);
+	CuAssertIntEquals (test, 0x10000, erase.address);
+	CuAssertIntEquals (test, 0x1000, erase.length);
+
+	status = Wrapper_flash_geometry_erase_step (&geometry, 0x1000, 0x100000, &erase);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, FLASH_CMD_4K_ERASE, erase.cmd);
+
+	geometry.erase_sizes &= ~FLASH_GEOMETRY_ERASE_64K;
+
+	status = Wrapper_flash_geometry_erase_step (&geometry, 0, 0x10000, &erase);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, FLASH_GEOMETRY_CMD_32K_ERASE, erase.cmd);
+}
+
+static void flash_geometry_test_erase_step_invalid (CuTest *test)
+{
+	struct flash_geometry geometry;
+	struct flash_geometry_erase erase;
+	int status;
+
+	TEST_START;
+
+	memset (&geometry, 0, sizeof (geometry));
+	geometry.device_size = 0x1000000;
+	geometry.sector_size = 0x1000;
+	geometry.block_size = 0x10000;
+	geometry.erase_sizes = FLASH_GEOMETRY_ERASE_4K | FLASH_GEOMETRY_ERASE_64K;
+
+	status = Wrapper_flash_geometry_erase_step (NULL, 0, 0x1000, &erase);
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+
+	status = Wrapper_flash_geometry_erase_step (&geometry, 0, 0x1000, NULL);
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+
+	status = Wrapper_flash_geometry_erase_step (&geometry, 0x800, 0x2000, &erase);
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+
+	status = Wrapper_flash_geometry_erase_step (&geometry, 0x1000, 0x1800, &erase);
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+
+	status = Wrapper_flash_geometry_erase_step (&geometry, 0x2000, 0x1000, &erase);
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+}
+
+static void flash_geometry_test_erase_mix (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	testing.device_size[0] = FLASH_GEOMETRY_TESTING_ERASE_DEVICE;
+
+	/* 0x3000-0x7fff, 0x8000-0xffff, 0x10000-0x2ffff, 0x30000-0x37fff, 0x38000-0x39fff */
+	flash_geometry_testing_erase_region (test, &testing, &cache, &flash, 0x3000, 0x37000);
+	CuAssertIntEquals (test, 7, testing.erases[0]);
+	CuAssertIntEquals (test, 2, testing.erases[1]);
+	CuAssertIntEquals (test, 2, testing.erases[2]);
+	CuAssertIntEquals (test, 0, testing.erases[3]);
+	CuAssertIntEquals (test, 0, testing.flags & FLASH_FLAG_4BYTE_ADDRESS);
+
+	/* A whole 64kB block */
+	flash_geometry_testing_erase_region (test, &testing, &cache, &flash, 0x40000, 0x10000);
+	CuAssertIntEquals (test, 0, testing.erases[0]);
+	CuAssertIntEquals (test, 0, testing.erases[1]);
+	CuAssertIntEquals (test, 1, testing.erases[2]);
+
+	/* The whole device */
+	flash_geometry_testing_erase_region (test, &testing, &cache, &flash, 0,
+		FLASH_GEOMETRY_TESTING_ERASE_DEVICE);
+	CuAssertIntEquals (test, 0, testing.erases[0]);
+	CuAssertIntEquals (test, 0, testing.erases[1]);
+	CuAssertIntEquals (test, 0, testing.erases[2]);
+	CuAssertIntEquals (test, 1, testing.erases[3]);
+
+	/* All but the last sector of the device */
+	flash_geometry_testing_erase_region (test, &testing, &cache, &flash, 0,
+		FLASH_GEOMETRY_TESTING_ERASE_DEVICE - 0x1000);
+	CuAssertIntEquals (test, 7, testing.erases[0]);
+	CuAssertIntEquals (test, 1, testing.erases[1]);
+	CuAssertIntEquals (test, 15, testing.erases[2]);
+	CuAssertIntEquals (test, 0, testing.erases[3]);
+}
+
+static void flash_geometry_test_erase_unaligned (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	testing.device_size[0] = FLASH_GEOMETRY_TESTING_ERASE_DEVICE;
+
+	/* The erase covers the sectors that contain the region. */
+	flash_geometry_testing_erase_region (test, &testing, &cache, &flash, 0x1234, 0x10);
+	CuAssertIntEquals (test, 1, testing.erases[0]);
+
+	flash_geometry_testing_erase_region (test, &testing, &cache, &flash, 0xfff, 0x2);
+	CuAssertIntEquals (test, 2, testing.erases[0]);
+
+	/* 0x7000-0x7fff, 0x8000-0xffff, 0x10000-0x1ffff, 0x20000-0x20fff */
+	flash_geometry_testing_erase_region (test, &testing, &cache, &flash, 0x7fff, 0x18002);
+	CuAssertIntEquals (test, 2, testing.erases[0]);
+	CuAssertIntEquals (test, 1, testing.erases[1]);
+	CuAssertIntEquals (test, 1, testing.erases[2]);
+
+	/* The sectors of the region are the whole device. */
+	flash_geometry_testing_erase_region (test, &testing, &cache, &flash, 0x10,
+		FLASH_GEOMETRY_TESTING_ERASE_DEVICE - 0x10);
+	CuAssertIntEquals (test, 1, testing.erases[3]);
+
+	/* Reaching the end of the device without starting at 0 is not a chip erase. */
+	flash_geometry_testing_erase_region (test, &testing, &cache, &flash, 0x1010,
+		FLASH_GEOMETRY_TESTING_ERASE_DEVICE - 0x1010);
+	CuAssertIntEquals (test, 7, testing.erases[0]);
+	CuAssertIntEquals (test, 1, testing.erases[1]);
+	CuAssertIntEquals (test, 15, testing.erases[2]);
+	CuAssertIntEquals (test, 0, testing.erases[3]);
+}
+
+static void flash_geometry_test_erase_exact_coverage (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	uint32_t start;
+	uint32_t length;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	testing.device_size[0] = FLASH_GEOMETRY_TESTING_ERASE_DEVICE;
+
+	for (start = 0; start < FLASH_GEOMETRY_TESTING_ERASE_DEVICE; start += 0x3100) {
+		for (length = 1; length <= (FLASH_GEOMETRY_TESTING_ERASE_DEVICE - start);
+			length += 0x4f00) {
+			flash_geometry_testing_erase_region (test, &testing, &cache, &flash, start, length);
+		}
+	}
+}
+
+static void flash_geometry_test_erase_no_32k (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	testing.device_size[0] = FLASH_GEOMETRY_TESTING_ERASE_DEVICE;
+	testing.block_size = 0x2000;
+
+	flash_geometry_testing_erase_region (test, &testing, &cache, &flash, 0x1000, 0x6000);
+	CuAssertIntEquals (test, 2, testing.erases[0]);
+	CuAssertIntEquals (test, 0, testing.erases[1]);
+	CuAssertIntEquals (test, 2, testing.erases[2]);
+}
+
+static void flash_geometry_test_erase_4byte_address (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	testing.device_size[0] = 0x4000000;
+
+	status = Wrapper_flash_geometry_erase (&cache, &flash, 0, 0x1000);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, testing.erases[0]);
+	CuAssertIntEquals (test, FLASH_FLAG_4BYTE_ADDRESS, testing.flags & FLASH_FLAG_4BYTE_ADDRESS);
+}
+
+static void flash_geometry_test_erase_zero_length (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+
+	status = Wrapper_flash_geometry_erase (&cache, &flash, 0x1000, 0);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, testing.erases[0]);
+}
+
+static void flash_geometry_test_erase_out_of_range (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+
+	status = Wrapper_flash_geometry_erase (&cache, &flash, 0x1000000, 0x1000);
+	CuAssertIntEquals (test, SPI_FLASH_ADDRESS_OUT_OF_RANGE, status);
+
+	status = Wrapper_flash_geometry_erase (&cache, &flash, 0xfff000, 0x2000);
+	CuAssertIntEquals (test, SPI_FLASH_OPERATION_OUT_OF_RANGE, status);
+
+	status = Wrapper_flash_geometry_erase (NULL, &flash, 0, 0x1000);
+	CuAssertIntEquals (test, SPI_FLASH_INVALID_ARGUMENT, status);
+
+	CuAssertIntEquals (test, 0, testing.erases[0]);
+}
+
+static void flash_geometry_test_erase_error (CuTest *test)
+{
+	struct flash_geometry_testing testing;
+	struct flash_geometry_cache cache;
+	struct spi_flash flash;
+	int status;
+
+	TEST_START;
+
+	flash_geometry_testing_init (&testing, &cache, &flash);
+	testing.erase_fail = 1;
+
+	status = Wrapper_flash_geometry_erase (&cache, &flash, 0, 0x20000);
+	CuAssertIntEquals (test, FLASH_GEOMETRY_TESTING_ERROR, status);
+	CuAssertIntEquals (test, 1, testing.erases[2]);
+}
+
+CuSuite* get_flash_geometry_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, flash_geometry_test_get);
+	SUITE_ADD_TEST (suite, flash_geometry_test_get_3byte_address);
+	SUITE_ADD_TEST (suite, flash_geometry_test_get_default_erase_sizes);
+	SUITE_ADD_TEST (suite, flash_geometry_test_get_probes_once);
+	SUITE_ADD_TEST (suite, flash_geometry_test_get_per_device);
+	SUITE_ADD_TEST (suite, flash_geometry_test_get_no_device);
+	SUITE_ADD_TEST (suite, flash_geometry_test_get_unsupported_device);
+	SUITE_ADD_TEST (suite, flash_geometry_test_get_null);
+	SUITE_ADD_TEST (suite, flash_geometry_test_invalidate);
+	SUITE_ADD_TEST (suite, flash_geometry_test_check);
+	SUITE_ADD_TEST (suite, flash_geometry_test_program_aligned);
+	SUITE_ADD_TEST (suite, flash_geometry_test_program_unaligned);
+	SUITE_ADD_TEST (suite, flash_geometry_test_program_mid_page);
+	SUITE_ADD_TEST (suite, flash_geometry_test_program_small);
+	SUITE_ADD_TEST (suite, flash_geometry_test_program_4byte_address);
+	SUITE_ADD_TEST (suite, flash_geometry_test_program_out_of_range);
+	SUITE_ADD_TEST (suite, flash_geometry_test_program_zero_length);
+	SUITE_ADD_TEST (suite, flash_geometry_test_program_null);
+	SUITE_ADD_TEST (suite, flash_geometry_test_program_error);
+	SUITE_ADD_TEST (suite, flash_geometry_test_program_partial);
+	SUITE_ADD_TEST (suite, flash_geometry_test_get_erase_sizes);
+	SUITE_ADD_TEST (suite, flash_geometry_test_erase_step);
+	SUITE_ADD_TEST (suite, flash_geometry_test_erase_step_invalid);
+	SUITE_ADD_TEST (suite, flash_geometry_test_erase_mix);
+	SUITE_ADD_TEST (suite, flash_geometry_test_erase_unaligned);
+	SUITE_ADD_TEST (suite, flash_geometry_test_erase_exact_coverage);
+	SUITE_ADD_TEST (suite, flash_geometry_test_erase_no_32k);
+	SUITE_ADD_TEST (suite, flash_geometry_test_erase_4byte_address);
+	SUITE_ADD_TEST (suite, flash_geometry_test_erase_zero_length);
+	SUITE_ADD_TEST (suite, flash_geometry_test_erase_out_of_range);
+	SUITE_ADD_TEST (suite, flash_geometry_test_erase_error);
+
+	return suite;
+}
@@ -19,6 +19,24 @@ const char *SUITE = "linux";
 //#define	TESTING_RUN_AES_OPENSSL_SUITE
 //#define	TESTING_RUN_BASE64_OPENSSL_SUITE
 //#define	TESTING_RUN_RNG_OPENSSL_SUITE
+//#define	TESTING_RUN_PFR_ECDSA_SUITE
+//#define	TESTING_RUN_PFR_HASH_SUITE
+//#define	TESTING_RUN_PFR_UFM_CACHE_SUITE
+//#define	TESTING_RUN_PFR_PBC_PLAN_SUITE
+//#define	TESTING_RUN_FLASH_COPY_CHANGED_SUITE
+//#define	TESTING_RUN_SMC_EVENT_LOOP_SUITE
+//#define	TESTING_RUN_PFR_PFM_INDEX_SUITE
+//#define	TESTING_RUN_PFR_PBC_TAG_SUITE
+//#define	TESTING_RUN_PFR_MEASUREMENT_CACHE_SUITE
+//#define	TESTING_RUN_PFR_SPI_COPY_SUITE
+//#define	TESTING_RUN_PFR_LOG_BATCH_SUITE
+//#define	TESTING_RUN_PFR_SPI_FILTER_SUITE
+//#define	TESTING_RUN_PFR_SVN_SUITE
+//#define	TESTING_RUN_PFR_KEY_CANCEL_SUITE
+//#define	TESTING_RUN_PFR_SIG_BLOCK_SUITE
+//#define	TESTING_RUN_PFR_MAILBOX_FIFO_SUITE
+//#define	TESTING_RUN_PFR_I2C_RING_SUITE
+//#define	TESTING_RUN_FLASH_GEOMETRY_SUITE
 
 
 CuSuite* get_hash_openssl_suite (void);
@@ -28,6 +46,24 @@ CuSuite* get_x509_openssl_suite (void);
 CuSuite* get_aes_openssl_suite (void);
 CuSuite* get_base64_openssl_suite (void);
 CuSuite* get_rng_openssl_suite (void);
+CuSuite* get_pfr_ecdsa_suite (void);
+CuSuite* get_pfr_hash_suite (void);
+CuSuite* get_pfr_ufm_cache_suite (void);
+CuSuite* get_pfr_pbc_plan_suite (void);
+CuSuite* get_flash_copy_changed_suite (void);
+CuSuite* get_smc_event_loop_suite (void);
+CuSuite* get_pfr_pfm_index_suite (void);
+CuSuite* get_pfr_pbc_tag_suite (void);
+CuSuite* get_pfr_measurement_cache_suite (void);
+CuSuite* get_pfr_spi_copy_suite (void);
+CuSuite* get_pfr_log_batch_suite (void);
+CuSuite* get_pfr_spi_filter_suite (void);
+CuSuite* get_pfr_svn_suite (void);
+CuSuite* get_pfr_key_cancel_suite (void);
+CuSuite* get_pfr_sig_block_suite (void);
+CuSuite* get_pfr_mailbox_fifo_suite (void);
+CuSuite* get_pfr_i2c_ring_suite (void);
+CuSuite* get_flash_geometry_suite (void);
 
 void linux_teardown (CuTest *test)
 {
@@ -61,6 +97,60 @@ void add_all_linux_tests (CuSuite *suite)
 #ifdef TESTING_RUN_RNG_OPENSSL_SUITE
 	CuSuiteAddSuite (suite, get_rng_openssl_suite ());
 #endif
+#ifdef TESTING_RUN_PFR_ECDSA_SUITE
+	CuSuiteAddSuite (suite, get_pfr_ecdsa_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_HASH_SUITE
+	CuSuiteAddSuite (suite, get_pfr_hash_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_UFM_CACHE_SUITE
+	CuSuiteAddSuite (suite, get_pfr_ufm_cache_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_PBC_PLAN_SUITE
+	CuSuiteAddSuite (suite, get_pfr_pbc_plan_suite ());
+#endif
+#ifdef TESTING_RUN_FLASH_COPY_CHANGED_SUITE
+	CuSuiteAddSuite (suite, get_flash_copy_changed_suite ());
+#endif
+#ifdef TESTING_RUN_SMC_EVENT_LOOP_SUITE
+	CuSuiteAddSuite (suite, get_smc_event_loop_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_PFM_INDEX_SUITE
+	CuSuiteAddSuite (suite, get_pfr_pfm_index_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_PBC_TAG_SUITE
+	CuSuiteAddSuite (suite, get_pfr_pbc_tag_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_MEASUREMENT_CACHE_SUITE
+	CuSuiteAddSuite (suite, get_pfr_measurement_cache_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_SPI_COPY_SUITE
+	CuSuiteAddSuite (suite, get_pfr_spi_copy_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_LOG_BATCH_SUITE
+	CuSuiteAddSuite (suite, get_pfr_log_batch_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_SPI_FILTER_SUITE
+	CuSuiteAddSuite (suite, get_pfr_spi_filter_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_SVN_SUITE
+	CuSuiteAddSuite (suite, get_pfr_svn_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_KEY_CANCEL_SUITE
+	CuSuiteAddSuite (suite, get_pfr_key_cancel_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_SIG_BLOCK_SUITE
+	CuSuiteAddSuite (suite, get_pfr_sig_block_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_MAILBOX_FIFO_SUITE
+	CuSuiteAddSuite (suite, get_pfr_mailbox_fifo_suite ());
+#endif
+#ifdef TESTING_RUN_PFR_I2C_RING_SUITE
+	CuSuiteAddSuite (suite, get_pfr_i2c_ring_suite ());
+#endif
+#ifdef TESTING_RUN_FLASH_GEOMETRY_SUITE
+	CuSuiteAddSuite (suite, get_flash_geometry_suite ());
+#endif
 
 	SUITE_ADD_TEST (suite, linux_teardown);
 }
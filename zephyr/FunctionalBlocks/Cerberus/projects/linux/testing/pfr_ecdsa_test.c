@@ -0,0 +1,468 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "testing.h"
+#include "pfr_ecdsa.h"
+
+
+static const char *SUITE = "pfr_ecdsa";
+
+
+/* Raw big-endian key, digest and signature values generated with OpenSSL. */
+static const uint8_t pfr_ecdsa_testing_p256_x[] = {
+	0x7f, 0x76, 0xde, 0x8c, 0x41, 0x67, 0x3a, 0xe4,
+	0xbe, 0x2f, 0xd6, 0xa9, 0x15, 0x66, 0xe8, 0x22,
+	0xc7, 0xf6, 0x21, 0x5d, 0x70, 0x95, 0x8e, 0xb4,
+	0x5f, 0x08, 0x35, 0xbc, 0x8a, 0xf6, 0x33, 0xb6
+};
+
+static const uint8_t pfr_ecdsa_testing_p256_y[] = {
+	0x7c, 0xd8, 0xbc, 0x23, 0xa6, 0x57, 0x7b, 0x88,
+	0xcd, 0x2e, 0x15, 0x1e, 0x69, 0xc7, 0xf0, 0x3d,
+	0x81, 0x45, 0xde, 0x4c, 0x43, 0x39, 0x9e, 0x06,
+	0xe1, 0x3b, 0xa1, 0xac, 0x6d, 0x73, 0xad, 0xea
+};
+
+static const uint8_t pfr_ecdsa_testing_p256_digest[] = {
+	0x9f, 0x41, 0x6d, 0xc4, 0xfd, 0xf8, 0xbb, 0x31,
+	0xa6, 0xc2, 0x8a, 0x25, 0x03, 0xf2, 0x0e, 0x96,
+	0x5c, 0x6f, 0x5f, 0xb2, 0x75, 0x59, 0xc2, 0x03,
+	0xd7, 0x67, 0xea, 0xd3, 0x1c, 0x44, 0x13, 0x71
+};
+
+static const uint8_t pfr_ecdsa_testing_p256_r[] = {
+	0xe1, 0xf2, 0xbf, 0x2a, 0xc1, 0x80, 0x96, 0x45,
+	0x21, 0x46, 0x43, 0x3f, 0x2d, 0x30, 0x13, 0x5b,
+	0xbd, 0x89, 0x6d, 0xdd, 0xdc, 0xbb, 0x08, 0x3c,
+	0x7b, 0x07, 0x4b, 0x70, 0xd8, 0xc8, 0xac, 0xcf
+};
+
+static const uint8_t pfr_ecdsa_testing_p256_s[] = {
+	0x0d, 0x05, 0x6d, 0xb4, 0x9a, 0xa7, 0x1a, 0xe9,
+	0x11, 0x57, 0xd1, 0x05, 0xc5, 0x32, 0x1e, 0xa5,
+	0x2f, 0x0b, 0xd6, 0x77, 0x85, 0x80, 0x43, 0x4b,
+	0xe6, 0x24, 0xfd, 0x0e, 0x65, 0x33, 0xe2, 0x7b
+};
+
+static const uint8_t pfr_ecdsa_testing_p384_x[] = {
+	0xc8, 0x3d, 0x4f, 0xcc, 0x99, 0xca, 0x7a, 0xe6,
+	0x8c, 0x59, 0x93, 0x8f, 0xa5, 0x77, 0xdb, 0x85,
+	0x39, 0x9e, 0x78, 0x06, 0x2c, 0x03, 0xbc, 0x08,
+	0x47, 0x8d, 0xd7, 0x52, 0x19, 0x71, 0xd0, 0x0b,
+	0x6e, 0x46, 0x08, 0x0c, 0x7a, 0x76, 0xb7, 0xa8,
+	0x74, 0xe6, 0xb7, 0x35, 0x33, 0xb0, 0x59, 0x8f
+};
+
+static const uint8_t pfr_ecdsa_testing_p384_y[] = {
+	0x8d, 0x8b, 0x4f, 0x21, 0xaa, 0xe8, 0x6e, 0x9f,
+	0x55, 0x7c, 0xb4, 0x1a, 0x94, 0x4c, 0x60, 0x70,
+	0xf6, 0x6b, 0x65, 0x04, 0xfb, 0x27, 0x8f, 0x1f,
+	0xfd, 0x5f, 0xf2, 0x48, 0xfe, 0xf8, 0xe4, 0x9d,
+	0x11, 0xe6, 0x07, 0x2e, 0x2d, 0x9d, 0xd6, 0x9a,
+	0x12, 0xfb, 0xe6, 0xc8, 0xdb, 0x7a, 0x54, 0x0c
+};
+
+static const uint8_t pfr_ecdsa_testing_p384_digest[] = {
+	0xbb, 0x63, 0xc7, 0xe3, 0x5d, 0x6f, 0x51, 0x91,
+	0x09, 0x36, 0x4f, 0x4d, 0x0b, 0x55, 0xe7, 0x1b,
+	0x88, 0x38, 0x8a, 0xe1, 0xb9, 0x92, 0x4b, 0x27,
+	0x3e, 0xff, 0xbb, 0x3c, 0xcc, 0xc3, 0x87, 0x29,
+	0x8f, 0x37, 0x2e, 0x40, 0x94, 0x45, 0xbb, 0x2d,
+	0x5f, 0x6d, 0x24, 0xfb, 0xf5, 0x2f, 0x5c, 0xbf
+};
+
+static const uint8_t pfr_ecdsa_testing_p384_r[] = {
+	0x8f, 0xa2, 0x4b, 0x92, 0x34, 0x37, 0x78, 0xb6,
+	0x79, 0x7e, 0x57, 0x15, 0x21, 0xbf, 0x10, 0xef,
+	0x48, 0x69, 0x72, 0x00, 0x7f, 0x23, 0x96, 0xd7,
+	0xf6, 0x2e, 0xbd, 0xf9, 0xa9, 0xc4, 0x04, 0xcd,
+	0x51, 0x43, 0xd3, 0xac, 0x57, 0x0c, 0x26, 0x7c,
+	0x6a, 0x1f, 0x94, 0xb7, 0x2a, 0x4c, 0x54, 0x8b
+};
+
+static const uint8_t pfr_ecdsa_testing_p384_s[] = {
+	0xca, 0xdc, 0xa2, 0x66, 0x99, 0x1f, 0x54, 0x61,
+	0x83, 0xc8, 0xba, 0xa7, 0x24, 0x9d, 0x03, 0xa1,
+	0x0e, 0x68, 0x51, 0x4d, 0x56, 0x0f, 0x21, 0xb8,
+	0xd9, 0x39, 0x54, 0x6c, 0x8c, 0xec, 0x46, 0x89,
+	0xcb, 0x9f, 0xf6, 0xf5, 0x7b, 0x43, 0xd8, 0xb6,
+	0x4a, 0x64, 0x6f, 0x3b, 0x9c, 0xeb, 0xe1, 0xee
+};
+
+
+/**
+ * Test vector for one curve.
+ */
+struct pfr_ecdsa_testing_vector {
+	enum pfr_ecdsa_curve curve;
+	const uint8_t *x;
+	const uint8_t *y;
+	const uint8_t *digest;
+	const uint8_t *r;
+	const uint8_t *s;
+};
+
+static const struct pfr_ecdsa_testing_vector pfr_ecdsa_testing_vectors[] = {
+	{
+		PFR_ECDSA_CURVE_P256, pfr_ecdsa_testing_p256_x, pfr_ecdsa_testing_p256_y,
+		pfr_ecdsa_testing_p256_digest, pfr_ecdsa_testing_p256_r, pfr_ecdsa_testing_p256_s
+	},
+	{
+		PFR_ECDSA_CURVE_P384, pfr_ecdsa_testing_p384_x, pfr_ecdsa_testing_p384_y,
+		pfr_ecdsa_testing_p384_digest, pfr_ecdsa_testing_p384_r, pfr_ecdsa_testing_p384_s
+	},
+};
+
+#define	PFR_ECDSA_TESTING_VECTOR_COUNT	\
+	(sizeof (pfr_ecdsa_testing_vectors) / sizeof (pfr_ecdsa_testing_vectors[0]))
+
+/**
+ * State for a mock backend.  The mock stands in for a crypto engine by delegating the math to
+ * another backend and recording how it was used.
+ */
+struct pfr_ecdsa_testing_mock {
+	const struct pfr_ecdsa_backend *delegate;	/**< Backend performing the verification. */
+	int unavailable;							/**< Report the engine as unavailable. */
+	int calls;									/**< Number of verify calls. */
+};
+
+static int pfr_ecdsa_testing_mock_verify (const struct pfr_ecdsa_backend *backend,
+	enum pfr_ecdsa_curve curve, const uint8_t *x, const uint8_t *y, const uint8_t *digest,
+	const uint8_t *r, const uint8_t *s)
+{
+	struct pfr_ecdsa_testing_mock *mock = backend->context;
+
+	mock->calls++;
+	if (mock->unavailable) {
+		return PFR_ECDSA_BACKEND_UNAVAILABLE;
+	}
+
+	return mock->delegate->verify (mock->delegate, curve, x, y, digest, r, s);
+}
+
+/**
+ * Initialize a mock backend.
+ *
+ * @param backend The backend to initialize.
+ * @param mock The mock state to attach to the backend.
+ * @param curves The curves the mock handles.
+ */
+static void pfr_ecdsa_testing_init_mock (struct pfr_ecdsa_backend *backend,
+	struct pfr_ecdsa_testing_mock *mock, uint32_t curves)
+{
+	memset (mock, 0, sizeof (*mock));
+	mock->delegate = &pfr_ecdsa_mbedtls_backend;
+
+	backend->name = "mock";
+	backend->curves = curves;
+	backend->verify = pfr_ecdsa_testing_mock_verify;
+	backend->context = mock;
+}
+
+/**
+ * Verify a test vector with one component corrupted.
+ *
+ * @param backends The backends to use.
+ * @param count The number of backends.
+ * @param vector The test vector.
+ * @param corrupt Index of the component to corrupt:  0 for none, then x, y, digest, r and s.
+ *
+ * @return The verification result.
+ */
+static int pfr_ecdsa_testing_verify_corrupted (const struct pfr_ecdsa_backend *const *backends,
+	size_t count, const struct pfr_ecdsa_testing_vector *vector, int corrupt)
+{
+	uint8_t values[5][PFR_ECDSA_P384_LENGTH];
+	size_t length = pfr_ecdsa_curve_length (vector->curve);
+
+	memcpy (values[0], vector->x, length);
+	memcpy (values[1], vector->y, length);
+	memcpy (values[2], vector->digest, length);
+	memcpy (values[3], vector->r, length);
+	memcpy (values[4], vector->s, length);
+
+	if (corrupt) {
+		values[corrupt - 1][length / 2] ^= 0x01;
+	}
+
+	return pfr_ecdsa_verify (backends, count, vector->curve, values[0], values[1], values[2],
+		values[3], values[4]);
+}
+
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_ecdsa_test_curve_length (CuTest *test)
+{
+	TEST_START;
+
+	CuAssertIntEquals (test, 32, pfr_ecdsa_curve_length (PFR_ECDSA_CURVE_P256));
+	CuAssertIntEquals (test, 48, pfr_ecdsa_curve_length (PFR_ECDSA_CURVE_P384));
+	CuAssertIntEquals (test, 0, pfr_ecdsa_curve_length (PFR_ECDSA_CURVE_MAX));
+}
+
+static void pfr_ecdsa_test_mbedtls_p256 (CuTest *test)
+{
+	const struct pfr_ecdsa_backend *backends[] = {&pfr_ecdsa_mbedtls_backend};
+	int status;
+
+	TEST_START;
+
+	status = pfr_ecdsa_verify (backends, 1, PFR_ECDSA_CURVE_P256, pfr_ecdsa_testing_p256_x,
+		pfr_ecdsa_testing_p256_y, pfr_ecdsa_testing_p256_digest, pfr_ecdsa_testing_p256_r,
+		pfr_ecdsa_testing_p256_s);
+	CuAssertIntEquals (test, 0, status);
+}
+
+static void pfr_ecdsa_test_mbedtls_p384 (CuTest *test)
+{
+	const struct pfr_ecdsa_backend *backends[] = {&pfr_ecdsa_mbedtls_backend};
+	int status;
+
+	TEST_START;
+
+	status = pfr_ecdsa_verify (backends, 1, PFR_ECDSA_CURVE_P384, pfr_ecdsa_testing_p384_x,
+		pfr_ecdsa_testing_p384_y, pfr_ecdsa_testing_p384_digest, pfr_ecdsa_testing_p384_r,
+		pfr_ecdsa_testing_p384_s);
+	CuAssertIntEquals (test, 0, status);
+}
+
+static void pfr_ecdsa_test_mbedtls_bad_signature (CuTest *test)
+{
+	const struct pfr_ecdsa_backend *backends[] = {&pfr_ecdsa_mbedtls_backend};
+	size_t i;
+	int corrupt;
+	int status;
+
+	TEST_START;
+
+	for (i = 0; i < PFR_ECDSA_TESTING_VECTOR_COUNT; i++) {
+		for (corrupt = 1; corrupt <= 5; corrupt++) {
+			status = pfr_ecdsa_testing_verify_corrupted (backends, 1,
+				&pfr_ecdsa_testing_vectors[i], corrupt);
+			CuAssertTrue (test, (status == PFR_ECDSA_VERIFY_FAILED) ||
+				(status == PFR_ECDSA_INVALID_ARGUMENT));
+		}
+	}
+}
+
+static void pfr_ecdsa_test_mbedtls_curve_mismatch (CuTest *test)
+{
+	const struct pfr_ecdsa_backend *backends[] = {&pfr_ecdsa_mbedtls_backend};
+	int status;
+
+	TEST_START;
+
+	status = pfr_ecdsa_verify (backends, 1, PFR_ECDSA_CURVE_P256, pfr_ecdsa_testing_p384_x,
+		pfr_ecdsa_testing_p384_y, pfr_ecdsa_testing_p384_digest, pfr_ecdsa_testing_p384_r,
+		pfr_ecdsa_testing_p384_s);
+	CuAssertTrue (test, (status != 0));
+}
+
+static void pfr_ecdsa_test_hardware_selected_by_curve (CuTest *test)
+{
+	struct pfr_ecdsa_testing_mock hw_mock;
+	struct pfr_ecdsa_testing_mock sw_mock;
+	struct pfr_ecdsa_backend hw;
+	struct pfr_ecdsa_backend sw;
+	const struct pfr_ecdsa_backend *backends[] = {&hw, &sw};
+	int status;
+
+	TEST_START;
+
+	pfr_ecdsa_testing_init_mock (&hw, &hw_mock, PFR_ECDSA_CURVE_MASK (PFR_ECDSA_CURVE_P384));
+	pfr_ecdsa_testing_init_mock (&sw, &sw_mock,
+		PFR_ECDSA_CURVE_MASK (PFR_ECDSA_CURVE_P256) | PFR_ECDSA_CURVE_MASK (PFR_ECDSA_CURVE_P384));
+
+	status = pfr_ecdsa_verify (backends, 2, PFR_ECDSA_CURVE_P384, pfr_ecdsa_testing_p384_x,
+		pfr_ecdsa_testing_p384_y, pfr_ecdsa_testing_p384_digest, pfr_ecdsa_testing_p384_r,
+		pfr_ecdsa_testing_p384_s);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, hw_mock.calls);
+	CuAssertIntEquals (test, 0, sw_mock.calls);
+
+	status = pfr_ecdsa_verify (backends, 2, PFR_ECDSA_CURVE_P256, pfr_ecdsa_testing_p256_x,
+		pfr_ecdsa_testing_p256_y, pfr_ecdsa_testing_p256_digest, pfr_ecdsa_testing_p256_r,
+		pfr_ecdsa_testing_p256_s);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, hw_mock.calls);
+	CuAssertIntEquals (test, 1, sw_mock.calls);
+}
+
+static void pfr_ecdsa_test_hardware_unavailable_fallback (CuTest *test)
+{
+	struct pfr_ecdsa_testing_mock hw_mock;
+	struct pfr_ecdsa_testing_mock sw_mock;
+	struct pfr_ecdsa_backend hw;
+	struct pfr_ecdsa_backend sw;
+	const struct pfr_ecdsa_backend *backends[] = {&hw, &sw};
+	int status;
+
+	TEST_START;
+
+	pfr_ecdsa_testing_init_mock (&hw, &hw_mock, PFR_ECDSA_CURVE_MASK (PFR_ECDSA_CURVE_P384));
+	pfr_ecdsa_testing_init_mock (&sw, &sw_mock,
+		PFR_ECDSA_CURVE_MASK (PFR_ECDSA_CURVE_P256) | PFR_ECDSA_CURVE_MASK (PFR_ECDSA_CURVE_P384));
+	hw_mock.unavailable = 1;
+
+	status = pfr_ecdsa_verify (backends, 2, PFR_ECDSA_CURVE_P384, pfr_ecdsa_testing_p384_x,
+		pfr_ecdsa_testing_p384_y, pfr_ecdsa_testing_p384_digest, pfr_ecdsa_testing_p384_r,
+		pfr_ecdsa_testing_p384_s);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, hw_mock.calls);
+	CuAssertIntEquals (test, 1, sw_mock.calls);
+}
+
+static void pfr_ecdsa_test_hardware_failure_not_retried (CuTest *test)
+{
+	struct pfr_ecdsa_testing_mock hw_mock;
+	struct pfr_ecdsa_testing_mock sw_mock;
+	struct pfr_ecdsa_backend hw;
+	struct pfr_ecdsa_backend sw;
+	const struct pfr_ecdsa_backend *backends[] = {&hw, &sw};
+	int status;
+
+	TEST_START;
+
+	pfr_ecdsa_testing_init_mock (&hw, &hw_mock, PFR_ECDSA_CURVE_MASK (PFR_ECDSA_CURVE_P384));
+	pfr_ecdsa_testing_init_mock (&sw, &sw_mock,
+		PFR_ECDSA_CURVE_MASK (PFR_ECDSA_CURVE_P256) | PFR_ECDSA_CURVE_MASK (PFR_ECDSA_CURVE_P384));
+
+	status = pfr_ecdsa_testing_verify_corrupted (backends, 2, &pfr_ecdsa_testing_vectors[1], 3);
+	CuAssertIntEquals (test, PFR_ECDSA_VERIFY_FAILED, status);
+	CuAssertIntEquals (test, 1, hw_mock.calls);
+	CuAssertIntEquals (test, 0, sw_mock.calls);
+}
+
+static void pfr_ecdsa_test_backend_equivalence (CuTest *test)
+{
+	struct pfr_ecdsa_testing_mock hw_mock;
+	struct pfr_ecdsa_backend hw;
+	const struct pfr_ecdsa_backend *hw_backends[] = {&hw};
+	const struct pfr_ecdsa_backend *sw_backends[] = {&pfr_ecdsa_mbedtls_backend};
+	size_t i;
+	int corrupt;
+	int hw_status;
+	int sw_status;
+
+	TEST_START;
+
+	pfr_ecdsa_testing_init_mock (&hw, &hw_mock,
+		PFR_ECDSA_CURVE_MASK (PFR_ECDSA_CURVE_P256) | PFR_ECDSA_CURVE_MASK (PFR_ECDSA_CURVE_P384));
+
+	for (i = 0; i < PFR_ECDSA_TESTING_VECTOR_COUNT; i++) {
+		for (corrupt = 0; corrupt <= 5; corrupt++) {
+			hw_status = pfr_ecdsa_testing_verify_corrupted (hw_backends, 1,
+				&pfr_ecdsa_testing_vectors[i], corrupt);
+			sw_status = pfr_ecdsa_testing_verify_corrupted (sw_backends, 1,
+				&pfr_ecdsa_testing_vectors[i], corrupt);
+
+			CuAssertIntEquals (test, sw_status, hw_status);
+			CuAssertIntEquals (test, (corrupt == 0), (sw_status == 0));
+		}
+	}
+}
+
+static void pfr_ecdsa_test_no_backend (CuTest *test)
+{
+	struct pfr_ecdsa_testing_mock hw_mock;
+	struct pfr_ecdsa_backend hw;
+	const struct pfr_ecdsa_backend *backends[] = {&hw};
+	int status;
+
+	TEST_START;
+
+	pfr_ecdsa_testing_init_mock (&hw, &hw_mock, PFR_ECDSA_CURVE_MASK (PFR_ECDSA_CURVE_P384));
+
+	status = pfr_ecdsa_verify (backends, 1, PFR_ECDSA_CURVE_P256, pfr_ecdsa_testing_p256_x,
+		pfr_ecdsa_testing_p256_y, pfr_ecdsa_testing_p256_digest, pfr_ecdsa_testing_p256_r,
+		pfr_ecdsa_testing_p256_s);
+	CuAssertIntEquals (test, PFR_ECDSA_NO_BACKEND, status);
+	CuAssertIntEquals (test, 0, hw_mock.calls);
+
+	hw_mock.unavailable = 1;
+
+	status = pfr_ecdsa_verify (backends, 1, PFR_ECDSA_CURVE_P384, pfr_ecdsa_testing_p384_x,
+		pfr_ecdsa_testing_p384_y, pfr_ecdsa_testing_p384_digest, pfr_ecdsa_testing_p384_r,
+		pfr_ecdsa_testing_p384_s);
+	CuAssertIntEquals (test, PFR_ECDSA_NO_BACKEND, status);
+	CuAssertIntEquals (test, 1, hw_mock.calls);
+
+	status = pfr_ecdsa_verify (backends, 0, PFR_ECDSA_CURVE_P384, pfr_ecdsa_testing_p384_x,
+		pfr_ecdsa_testing_p384_y, pfr_ecdsa_testing_p384_digest, pfr_ecdsa_testing_p384_r,
+		pfr_ecdsa_testing_p384_s);
+	CuAssertIntEquals (test, PFR_ECDSA_NO_BACKEND, status);
+}
+
+static void pfr_ecdsa_test_null (CuTest *test)
+{
+	const struct pfr_ecdsa_backend *backends[] = {&pfr_ecdsa_mbedtls_backend};
+	int status;
+
+	TEST_START;
+
+	status = pfr_ecdsa_verify (NULL, 1, PFR_ECDSA_CURVE_P256, pfr_ecdsa_testing_p256_x,
+		pfr_ecdsa_testing_p256_y, pfr_ecdsa_testing_p256_digest, pfr_ecdsa_testing_p256_r,
+		pfr_ecdsa_testing_p256_s);
+	CuAssertIntEquals (test, PFR_ECDSA_INVALID_ARGUMENT, status);
+
+	status = pfr_ecdsa_verify (backends, 1, PFR_ECDSA_CURVE_P256, NULL,
+		pfr_ecdsa_testing_p256_y, pfr_ecdsa_testing_p256_digest, pfr_ecdsa_testing_p256_r,
+		pfr_ecdsa_testing_p256_s);
+	CuAssertIntEquals (test, PFR_ECDSA_INVALID_ARGUMENT, status);
+
+	status = pfr_ecdsa_verify (backends, 1, PFR_ECDSA_CURVE_P256, pfr_ecdsa_testing_p256_x,
+		NULL, pfr_ecdsa_testing_p256_digest, pfr_ecdsa_testing_p256_r,
+		pfr_ecdsa_testing_p256_s);
+	CuAssertIntEquals (test, PFR_ECDSA_INVALID_ARGUMENT, status);
+
+	status = pfr_ecdsa_verify (backends, 1, PFR_ECDSA_CURVE_P256, pfr_ecdsa_testing_p256_x,
+		pfr_ecdsa_testing_p256_y, NULL, pfr_ecdsa_testing_p256_r,
+		pfr_ecdsa_testing_p256_s);
+	CuAssertIntEquals (test, PFR_ECDSA_INVALID_ARGUMENT, status);
+
+	status = pfr_ecdsa_verify (backends, 1, PFR_ECDSA_CURVE_P256, pfr_ecdsa_testing_p256_x,
+		pfr_ecdsa_testing_p256_y, pfr_ecdsa_testing_p256_digest, NULL,
+		pfr_ecdsa_testing_p256_s);
+	CuAssertIntEquals (test, PFR_ECDSA_INVALID_ARGUMENT, status);
+
+	status = pfr_ecdsa_verify (backends, 1, PFR_ECDSA_CURVE_P256, pfr_ecdsa_testing_p256_x,
+		pfr_ecdsa_testing_p256_y, pfr_ecdsa_testing_p256_digest, pfr_ecdsa_testing_p256_r,
+		NULL);
+	CuAssertIntEquals (test, PFR_ECDSA_INVALID_ARGUMENT, status);
+
+	status = pfr_ecdsa_verify (backends, 1, PFR_ECDSA_CURVE_MAX, pfr_ecdsa_testing_p256_x,
+		pfr_ecdsa_testing_p256_y, pfr_ecdsa_testing_p256_digest, pfr_ecdsa_testing_p256_r,
+		pfr_ecdsa_testing_p256_s);
+	CuAssertIntEquals (test, PFR_ECDSA_INVALID_ARGUMENT, status);
+}
+
+
+CuSuite* get_pfr_ecdsa_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_ecdsa_test_curve_length);
+	SUITE_ADD_TEST (suite, pfr_ecdsa_test_mbedtls_p256);
+	SUITE_ADD_TEST (suite, pfr_ecdsa_test_mbedtls_p384);
+	SUITE_ADD_TEST (suite, pfr_ecdsa_test_mbedtls_bad_signature);
+	SUITE_ADD_TEST (suite, pfr_ecdsa_test_mbedtls_curve_mismatch);
+	SUITE_ADD_TEST (suite, pfr_ecdsa_test_hardware_selected_by_curve);
+	SUITE_ADD_TEST (suite, pfr_ecdsa_test_hardware_unavailable_fallback);
+	SUITE_ADD_TEST (suite, pfr_ecdsa_test_hardware_failure_not_retried);
+	SUITE_ADD_TEST (suite, pfr_ecdsa_test_backend_equivalence);
+	SUITE_ADD_TEST (suite, pfr_ecdsa_test_no_backend);
+	SUITE_ADD_TEST (suite, pfr_ecdsa_test_null);
+
+	return suite;
+}
@@ -0,0 +1,419 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <openssl/sha.h>
+#include "platform.h"
+#include "testing.h"
+#include "testing/engines/hash_testing_engine.h"
+#include "flash/flash_common.h"
+#include "emulated_flash.h"
+#include "pfr_hash.h"
+
+
+static const char *SUITE = "pfr_hash";
+
+
+/**
+ * Size of the emulated SPI image hashed by the tests.
+ */
+#define	PFR_HASH_TESTING_FLASH_SIZE		(8 * 1024 * 1024)
+
+
+/**
+ * Calculate the reference digest for a region of the emulated flash with OpenSSL.
+ *
+ * @param flash The emulated flash.
+ * @param type The hash type.
+ * @param start The start of the region.
+ * @param length The length of the region.
+ * @param digest Output for the digest.
+ */
+static void pfr_hash_testing_openssl_digest (struct emulated_flash *flash, enum hash_type type,
+	uint32_t start, uint32_t length, uint8_t *digest)
+{
+	if (type == HASH_TYPE_SHA384) {
+		SHA384 (&flash->data[start], length, digest);
+	}
+	else {
+		SHA256 (&flash->data[start], length, digest);
+	}
+}
+
+/**
+ * Hash a region with the PFR path and check it against OpenSSL.
+ *
+ * @param test The test framework.
+ * @param flash The emulated flash.
+ * @param type The hash type.
+ * @param start The start of the region.
+ * @param length The length of the region.
+ */
+static void pfr_hash_testing_check_region (CuTest *test, struct emulated_flash *flash,
+	enum hash_type type, uint32_t start, uint32_t length)
+{
+	HASH_TESTING_ENGINE hash;
+	uint8_t expected[SHA384_HASH_LENGTH];
+	uint8_t actual[SHA384_HASH_LENGTH];
+	size_t digest_length = pfr_hash_digest_length (type);
+	int status;
+
+	status = HASH_TESTING_ENGINE_INIT (&hash);
+	CuAssertIntEquals (test, 0, status);
+
+	memset (actual, 0, sizeof (actual));
+	pfr_hash_testing_openssl_digest (flash, type, start, length, expected);
+
+	status = pfr_hash_region (&flash->base, &hash.base, type, start, length, actual,
+		sizeof (actual));
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing_validate_array (expected, actual, digest_length);
+	CuAssertIntEquals (test, 0, status);
+
+	HASH_TESTING_ENGINE_RELEASE (&hash);
+}
+
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_hash_test_digest_length (CuTest *test)
+{
+	TEST_START;
+
+	CuAssertIntEquals (test, SHA256_HASH_LENGTH, pfr_hash_digest_length (HASH_TYPE_SHA256));
+	CuAssertIntEquals (test, SHA384_HASH_LENGTH, pfr_hash_digest_length (HASH_TYPE_SHA384));
+	CuAssertIntEquals (test, 0, pfr_hash_digest_length (HASH_TYPE_SHA1));
+	CuAssertIntEquals (test, 0, pfr_hash_digest_length (HASH_TYPE_SHA512));
+}
+
+static void pfr_hash_test_region_sha256_full_image (CuTest *test)
+{
+	struct emulated_flash flash;
+	int status;
+
+	TEST_START;
+
+	status = emulated_flash_init (&flash, PFR_HASH_TESTING_FLASH_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_fill_pattern (&flash, 0x256);
+
+	pfr_hash_testing_check_region (test, &flash, HASH_TYPE_SHA256, 0,
+		PFR_HASH_TESTING_FLASH_SIZE);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_hash_test_region_sha384_full_image (CuTest *test)
+{
+	struct emulated_flash flash;
+	int status;
+
+	TEST_START;
+
+	status = emulated_flash_init (&flash, PFR_HASH_TESTING_FLASH_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_fill_pattern (&flash, 0x384);
+
+	pfr_hash_testing_check_region (test, &flash, HASH_TYPE_SHA384, 0,
+		PFR_HASH_TESTING_FLASH_SIZE);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_hash_test_region_unaligned (CuTest *test)
+{
+	struct emulated_flash flash;
+	int status;
+
+	TEST_START;
+
+	status = emulated_flash_init (&flash, PFR_HASH_TESTING_FLASH_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_fill_pattern (&flash, 0x1234);
+
+	pfr_hash_testing_check_region (test, &flash, HASH_TYPE_SHA256, 0x1235, 0x300567);
+	pfr_hash_testing_check_region (test, &flash, HASH_TYPE_SHA384, 0x1235, 0x300567);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_hash_test_region_pfm_layout (CuTest *test)
+{
+	/* Typical BMC regions: boot, u-boot env, rootfs, recovery */
+	const uint32_t regions[][2] = {
+		{0x000000, 0x0e0000},
+		{0x0e0000, 0x100000},
+		{0x100000, 0x500000},
+		{0x500000, 0x7f0000},
+	};
+	struct emulated_flash flash;
+	size_t i;
+	int status;
+
+	TEST_START;
+
+	status = emulated_flash_init (&flash, PFR_HASH_TESTING_FLASH_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_fill_pattern (&flash, 0xa5a5);
+
+	for (i = 0; i < sizeof (regions) / sizeof (regions[0]); i++) {
+		pfr_hash_testing_check_region (test, &flash, HASH_TYPE_SHA256, regions[i][0],
+			regions[i][1] - regions[i][0]);
+		pfr_hash_testing_check_region (test, &flash, HASH_TYPE_SHA384, regions[i][0],
+			regions[i][1] - regions[i][0]);
+	}
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_hash_test_region_sha256_sha384_differ (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct emulated_flash flash;
+	uint8_t sha256[SHA384_HASH_LENGTH];
+	uint8_t sha384[SHA384_HASH_LENGTH];
+	int status;
+
+	TEST_START;
+
+	status = emulated_flash_init (&flash, FLASH_BLOCK_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = HASH_TESTING_ENGINE_INIT (&hash);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_hash_region (&flash.base, &hash.base, HASH_TYPE_SHA256, 0, FLASH_BLOCK_SIZE,
+		sha256, sizeof (sha256));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_hash_region (&flash.base, &hash.base, HASH_TYPE_SHA384, 0, FLASH_BLOCK_SIZE,
+		sha384, sizeof (sha384));
+	CuAssertIntEquals (test, 0, status);
+
+	status = memcmp (sha256, sha384, SHA256_HASH_LENGTH);
+	CuAssertTrue (test, (status != 0));
+
+	HASH_TESTING_ENGINE_RELEASE (&hash);
+	emulated_flash_release (&flash);
+}
+
+static void pfr_hash_test_region_small_hash_buffer (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct emulated_flash flash;
+	uint8_t digest[SHA384_HASH_LENGTH];
+	int status;
+
+	TEST_START;
+
+	status = emulated_flash_init (&flash, FLASH_BLOCK_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = HASH_TESTING_ENGINE_INIT (&hash);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_hash_region (&flash.base, &hash.base, HASH_TYPE_SHA256, 0, FLASH_BLOCK_SIZE,
+		digest, SHA256_HASH_LENGTH - 1);
+	CuAssertIntEquals (test, PFR_HASH_INVALID_ARGUMENT, status);
+
+	status = pfr_hash_region (&flash.base, &hash.base, HASH_TYPE_SHA384, 0, FLASH_BLOCK_SIZE,
+		digest, SHA256_HASH_LENGTH);
+	CuAssertIntEquals (test, PFR_HASH_INVALID_ARGUMENT, status);
+
+	HASH_TESTING_ENGINE_RELEASE (&hash);
+	emulated_flash_release (&flash);
+}
+
+static void pfr_hash_test_region_unsupported_type (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct emulated_flash flash;
+	uint8_t digest[SHA512_HASH_LENGTH];
+	int status;
+
+	TEST_START;
+
+	status = emulated_flash_init (&flash, FLASH_BLOCK_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = HASH_TESTING_ENGINE_INIT (&hash);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_hash_region (&flash.base, &hash.base, HASH_TYPE_SHA1, 0, FLASH_BLOCK_SIZE,
+		digest, sizeof (digest));
+	CuAssertIntEquals (test, PFR_HASH_UNSUPPORTED, status);
+
+	status = pfr_hash_region (&flash.base, &hash.base, HASH_TYPE_SHA512, 0, FLASH_BLOCK_SIZE,
+		digest, sizeof (digest));
+	CuAssertIntEquals (test, PFR_HASH_UNSUPPORTED, status);
+
+	HASH_TESTING_ENGINE_RELEASE (&hash);
+	emulated_flash_release (&flash);
+}
+
+static void pfr_hash_test_region_out_of_range (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct emulated_flash flash;
+	uint8_t digest[SHA384_HASH_LENGTH];
+	int status;
+
+	TEST_START;
+
+	status = emulated_flash_init (&flash, FLASH_BLOCK_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = HASH_TESTING_ENGINE_INIT (&hash);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_hash_region (&flash.base, &hash.base, HASH_TYPE_SHA384, 0x100,
+		FLASH_BLOCK_SIZE, digest, sizeof (digest));
+	CuAssertIntEquals (test, FLASH_ADDRESS_OUT_OF_RANGE, status);
+
+	HASH_TESTING_ENGINE_RELEASE (&hash);
+	emulated_flash_release (&flash);
+}
+
+static void pfr_hash_test_region_null (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	struct emulated_flash flash;
+	uint8_t digest[SHA384_HASH_LENGTH];
+	int status;
+
+	TEST_START;
+
+	status = emulated_flash_init (&flash, FLASH_BLOCK_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = HASH_TESTING_ENGINE_INIT (&hash);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_hash_region (NULL, &hash.base, HASH_TYPE_SHA384, 0, FLASH_BLOCK_SIZE, digest,
+		sizeof (digest));
+	CuAssertIntEquals (test, PFR_HASH_INVALID_ARGUMENT, status);
+
+	status = pfr_hash_region (&flash.base, NULL, HASH_TYPE_SHA384, 0, FLASH_BLOCK_SIZE, digest,
+		sizeof (digest));
+	CuAssertIntEquals (test, PFR_HASH_INVALID_ARGUMENT, status);
+
+	status = pfr_hash_region (&flash.base, &hash.base, HASH_TYPE_SHA384, 0, FLASH_BLOCK_SIZE,
+		NULL, sizeof (digest));
+	CuAssertIntEquals (test, PFR_HASH_INVALID_ARGUMENT, status);
+
+	HASH_TESTING_ENGINE_RELEASE (&hash);
+	emulated_flash_release (&flash);
+}
+
+static void pfr_hash_test_buffer (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	/* Block 0 is 128 bytes and a P-384 root key is 96 bytes; also check lengths above 255. */
+	const size_t lengths[] = {96, 128, 300, 4096};
+	uint8_t data[4096];
+	uint8_t expected[SHA384_HASH_LENGTH];
+	uint8_t actual[SHA384_HASH_LENGTH];
+	size_t i;
+	int status;
+
+	TEST_START;
+
+	for (i = 0; i < sizeof (data); i++) {
+		data[i] = i * 7;
+	}
+
+	status = HASH_TESTING_ENGINE_INIT (&hash);
+	CuAssertIntEquals (test, 0, status);
+
+	for (i = 0; i < sizeof (lengths) / sizeof (lengths[0]); i++) {
+		SHA256 (data, lengths[i], expected);
+		status = pfr_hash_buffer (&hash.base, HASH_TYPE_SHA256, data, lengths[i], actual,
+			sizeof (actual));
+		CuAssertIntEquals (test, 0, status);
+
+		status = testing_validate_array (expected, actual, SHA256_HASH_LENGTH);
+		CuAssertIntEquals (test, 0, status);
+
+		SHA384 (data, lengths[i], expected);
+		status = pfr_hash_buffer (&hash.base, HASH_TYPE_SHA384, data, lengths[i], actual,
+			sizeof (actual));
+		CuAssertIntEquals (test, 0, status);
+
+		status = testing_validate_array (expected, actual, SHA384_HASH_LENGTH);
+		CuAssertIntEquals (test, 0, status);
+	}
+
+	HASH_TESTING_ENGINE_RELEASE (&hash);
+}
+
+static void pfr_hash_test_buffer_invalid (CuTest *test)
+{
+	HASH_TESTING_ENGINE hash;
+	uint8_t data[128];
+	uint8_t digest[SHA384_HASH_LENGTH];
+	int status;
+
+	TEST_START;
+
+	memset (data, 0x55, sizeof (data));
+
+	status = HASH_TESTING_ENGINE_INIT (&hash);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_hash_buffer (NULL, HASH_TYPE_SHA384, data, sizeof (data), digest,
+		sizeof (digest));
+	CuAssertIntEquals (test, PFR_HASH_INVALID_ARGUMENT, status);
+
+	status = pfr_hash_buffer (&hash.base, HASH_TYPE_SHA384, NULL, sizeof (data), digest,
+		sizeof (digest));
+	CuAssertIntEquals (test, PFR_HASH_INVALID_ARGUMENT, status);
+
+	status = pfr_hash_buffer (&hash.base, HASH_TYPE_SHA384, data, sizeof (data), NULL,
+		sizeof (digest));
+	CuAssertIntEquals (test, PFR_HASH_INVALID_ARGUMENT, status);
+
+	status = pfr_hash_buffer (&hash.base, HASH_TYPE_SHA384, data, sizeof (data), digest,
+		SHA256_HASH_LENGTH);
+	CuAssertIntEquals (test, PFR_HASH_INVALID_ARGUMENT, status);
+
+	status = pfr_hash_buffer (&hash.base, HASH_TYPE_SHA1, data, sizeof (data), digest,
+		sizeof (digest));
+	CuAssertIntEquals (test, PFR_HASH_UNSUPPORTED, status);
+
+	HASH_TESTING_ENGINE_RELEASE (&hash);
+}
+
+
+CuSuite* get_pfr_hash_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_hash_test_digest_length);
+	SUITE_ADD_TEST (suite, pfr_hash_test_region_sha256_full_image);
+	SUITE_ADD_TEST (suite, pfr_hash_test_region_sha384_full_image);
+	SUITE_ADD_TEST (suite, pfr_hash_test_region_unaligned);
+	SUITE_ADD_TEST (suite, pfr_hash_test_region_pfm_layout);
+	SUITE_ADD_TEST (suite, pfr_hash_test_region_sha256_sha384_differ);
+	SUITE_ADD_TEST (suite, pfr_hash_test_region_small_hash_buffer);
+	SUITE_ADD_TEST (suite, pfr_hash_test_region_unsupported_type);
+	SUITE_ADD_TEST (suite, pfr_hash_test_region_out_of_range);
+	SUITE_ADD_TEST (suite, pfr_hash_test_region_null);
+	SUITE_ADD_TEST (suite, pfr_hash_test_buffer);
+	SUITE_ADD_TEST (suite, pfr_hash_test_buffer_invalid);
+
+	return suite;
+}
@@ -0,0 +1,631 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <unistd.h>
+#include "testing.h"
+#include "pfr_i2c_ring.h"
+
+
+static const char *SUITE = "pfr_i2c_ring";
+
+
+/* Number of write transactions sent by each stress run. */
+#define PFR_I2C_RING_TESTING_STRESS_COUNT		200000
+
+/**
+ * Emulated I2C target driver.  The callbacks are called in the order the ASPEED driver calls them
+ * from its ISR, and the decoder is woken with a semaphore in place of the state machine event.
+ */
+struct pfr_i2c_ring_testing_target {
+	struct pfr_i2c_ring ring;			/**< Receive ring of the emulated bus. */
+	sem_t wake;							/**< Decoder wake-up. */
+	uint32_t wakes;						/**< Number of times the decoder was woken. */
+	uint32_t sent;						/**< Writes sent by the controller. */
+	bool done;							/**< The controller has sent everything and it was decoded. */
+	uint32_t received;					/**< Writes taken out by the decoder. */
+	uint32_t corrupt;					/**< Writes that did not match what was sent. */
+	uint32_t out_of_order;				/**< Writes received after a later write. */
+	uint32_t stalled;					/**< Writes were left in the ring with the decoder waiting. */
+	bool slow;							/**< Yield after each decoded write. */
+};
+
+/**
+ * Length of a stress write.  Most writes are byte writes, with a block write now and then and an
+ * occasional write that is too long for the ring.
+ */
+static size_t pfr_i2c_ring_testing_length (uint32_t seq)
+{
+	if ((seq % 1000) == 999) {
+		return PFR_I2C_RING_MSG_MAX + 1;
+	}
+	if ((seq % 8) == 7) {
+		return 3 + (seq % 64);
+	}
+
+	return 6;
+}
+
+/**
+ * Contents of a stress write: the sequence number followed by a pattern derived from it.
+ */
+static uint8_t pfr_i2c_ring_testing_byte (uint32_t seq, size_t i)
+{
+	if (i < 4) {
+		return (seq >> (8 * i)) & 0xff;
+	}
+
+	return (seq + i) & 0xff;
+}
+
+static bool pfr_i2c_ring_testing_empty (struct pfr_i2c_ring_testing_target *target)
+{
+	return (__atomic_load_n (&target->ring.head, __ATOMIC_SEQ_CST) ==
+		__atomic_load_n (&target->ring.tail, __ATOMIC_SEQ_CST));
+}
+
+static void pfr_i2c_ring_testing_write (struct pfr_i2c_ring_testing_target *target,
+	const uint8_t *msg, size_t length)
+{
+	size_t i;
+
+	pfr_i2c_ring_start (&target->ring);
+	for (i = 0; i < length; i++) {
+		pfr_i2c_ring_put (&target->ring, msg[i]);
+	}
+	if (pfr_i2c_ring_stop (&target->ring)) {
+		target->wakes++;
+		sem_post (&target->wake);
+	}
+}
+
+static void* pfr_i2c_ring_testing_controller (void *arg)
+{
+	struct pfr_i2c_ring_testing_target *target = arg;
+	uint8_t msg[PFR_I2C_RING_MSG_MAX + 1];
+	uint32_t seq;
+	size_t length;
+	size_t i;
+	int wait;
+
+	for (seq = 0; seq < PFR_I2C_RING_TESTING_STRESS_COUNT; seq++) {
+		length = pfr_i2c_ring_testing_length (seq);
+		for (i = 0; i < length; i++) {
+			msg[i] = pfr_i2c_ring_testing_byte (seq, i);
+		}
+
+		pfr_i2c_ring_testing_write (target, msg, length);
+		target->sent++;
+
+		// Register reads between the writes must not reach the decoder
+		if ((seq % 4) == 0) {
+			pfr_i2c_ring_start (&target->ring);
+			pfr_i2c_ring_put (&target->ring, 0x08);
+			pfr_i2c_ring_abort (&target->ring);
+			pfr_i2c_ring_stop (&target->ring);
+		}
+	}
+
+	// Every write published so far has to be decoded without another wake-up
+	for (wait = 0; (wait < 2000) && !pfr_i2c_ring_testing_empty (target); wait++) {
+		usleep (1000);
+	}
+	if (!pfr_i2c_ring_testing_empty (target)) {
+		target->stalled++;
+	}
+
+	__atomic_store_n (&target->done, true, __ATOMIC_SEQ_CST);
+	sem_post (&target->wake);
+
+	return NULL;
+}
+
+static void* pfr_i2c_ring_testing_decoder (void *arg)
+{
+	struct pfr_i2c_ring_testing_target *target = arg;
+	uint8_t msg[PFR_I2C_RING_MSG_MAX];
+	struct timespec timeout;
+	int64_t last = -1;
+	uint32_t seq;
+	size_t length;
+	size_t i;
+
+	while (1) {
+		clock_gettime (CLOCK_REALTIME, &timeout);
+		timeout.tv_sec += 5;
+		if (sem_timedwait (&target->wake, &timeout) != 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			target->stalled++;
+			return NULL;
+		}
+
+		while ((length = pfr_i2c_ring_get (&target->ring, msg, sizeof (msg))) != 0) {
+			seq = msg[0] | (msg[1] << 8) | (msg[2] << 16) | ((uint32_t) msg[3] << 24);
+			if (length != pfr_i2c_ring_testing_length (seq)) {
+				target->corrupt++;
+			}
+			for (i = 4; i < length; i++) {
+				if (msg[i] != pfr_i2c_ring_testing_byte (seq, i)) {
+					target->corrupt++;
+					break;
+				}
+			}
+			if ((int64_t) seq <= last) {
+				target->out_of_order++;
+			}
+
+			last = seq;
+			target->received++;
+			if (target->slow) {
+				sched_yield ();
+			}
+		}
+
+		if (__atomic_load_n (&target->done, __ATOMIC_SEQ_CST) &&
+			pfr_i2c_ring_testing_empty (target)) {
+			return NULL;
+		}
+	}
+}
+
+static void pfr_i2c_ring_testing_stress (CuTest *test, bool slow)
+{
+	struct pfr_i2c_ring_testing_target target;
+	pthread_t controller;
+	pthread_t decoder;
+	int status;
+
+	memset (&target, 0, sizeof (target));
+	pfr_i2c_ring_init (&target.ring);
+	target.slow = slow;
+
+	status = sem_init (&target.wake, 0, 0);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pthread_create (&decoder, NULL, pfr_i2c_ring_testing_decoder, &target);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pthread_create (&controller, NULL, pfr_i2c_ring_testing_controller, &target);
+	CuAssertIntEquals (test, 0, status);
+
+	pthread_join (controller, NULL);
+	pthread_join (decoder, NULL);
+	sem_destroy (&target.wake);
+
+	CuAssertIntEquals (test, 0, target.stalled);
+	CuAssertIntEquals (test, 0, target.corrupt);
+	CuAssertIntEquals (test, 0, target.out_of_order);
+	CuAssertIntEquals (test, PFR_I2C_RING_TESTING_STRESS_COUNT, target.sent);
+	CuAssertIntEquals (test, target.sent, target.received + target.ring.dropped);
+	CuAssertTrue (test, target.ring.dropped >= (PFR_I2C_RING_TESTING_STRESS_COUNT / 1000));
+	CuAssertTrue (test, target.wakes <= target.received);
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_i2c_ring_test_write (CuTest *test)
+{
+	struct pfr_i2c_ring ring;
+	uint8_t write[] = {0x0b, 0x05};
+	uint8_t msg[PFR_I2C_RING_MSG_MAX];
+	size_t length;
+	bool wake;
+	int status;
+
+	TEST_START;
+
+	pfr_i2c_ring_init (&ring);
+
+	pfr_i2c_ring_start (&ring);
+	pfr_i2c_ring_put (&ring, write[0]);
+	pfr_i2c_ring_put (&ring, write[1]);
+
+	length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+	CuAssertIntEquals (test, 0, length);
+
+	wake = pfr_i2c_ring_stop (&ring);
+	CuAssertIntEquals (test, true, wake);
+	CuAssertIntEquals (test, write[0], ring.command);
+
+	length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+	CuAssertIntEquals (test, sizeof (write), length);
+
+	status = testing_validate_array (write, msg, sizeof (write));
+	CuAssertIntEquals (test, 0, status);
+
+	length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+	CuAssertIntEquals (test, 0, length);
+	CuAssertIntEquals (test, 0, ring.dropped);
+}
+
+static void pfr_i2c_ring_test_wake_once (CuTest *test)
+{
+	struct pfr_i2c_ring ring;
+	uint8_t msg[PFR_I2C_RING_MSG_MAX];
+	size_t length;
+	bool wake;
+	int i;
+
+	TEST_START;
+
+	pfr_i2c_ring_init (&ring);
+
+	for (i = 0; i < 10; i++) {
+		pfr_i2c_ring_start (&ring);
+		pfr_i2c_ring_put (&ring, 0x0b);
+		pfr_i2c_ring_put (&ring, i);
+		wake = pfr_i2c_ring_stop (&ring);
+		CuAssertIntEquals (test, (i == 0), wake);
+	}
+
+	for (i = 0; i < 10; i++) {
+		length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+		CuAssertIntEquals (test, 2, length);
+		CuAssertIntEquals (test, i, msg[1]);
+	}
+
+	// The decoder only goes back to waiting once it has found the ring empty
+	pfr_i2c_ring_start (&ring);
+	pfr_i2c_ring_put (&ring, 0x0b);
+	pfr_i2c_ring_put (&ring, 0x01);
+	wake = pfr_i2c_ring_stop (&ring);
+	CuAssertIntEquals (test, false, wake);
+
+	length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+	CuAssertIntEquals (test, 2, length);
+
+	length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+	CuAssertIntEquals (test, 0, length);
+
+	pfr_i2c_ring_start (&ring);
+	pfr_i2c_ring_put (&ring, 0x0b);
+	pfr_i2c_ring_put (&ring, 0x02);
+	wake = pfr_i2c_ring_stop (&ring);
+	CuAssertIntEquals (test, true, wake);
+}
+
+static void pfr_i2c_ring_test_rearm (CuTest *test)
+{
+	struct pfr_i2c_ring ring;
+	bool wake;
+
+	TEST_START;
+
+	pfr_i2c_ring_init (&ring);
+
+	pfr_i2c_ring_start (&ring);
+	pfr_i2c_ring_put (&ring, 0x0b);
+	pfr_i2c_ring_put (&ring, 0x01);
+	wake = pfr_i2c_ring_stop (&ring);
+	CuAssertIntEquals (test, true, wake);
+
+	// The wake-up could not be delivered, so the next write has to try again
+	pfr_i2c_ring_rearm (&ring);
+
+	pfr_i2c_ring_start (&ring);
+	pfr_i2c_ring_put (&ring, 0x0b);
+	pfr_i2c_ring_put (&ring, 0x02);
+	wake = pfr_i2c_ring_stop (&ring);
+	CuAssertIntEquals (test, true, wake);
+}
+
+static void pfr_i2c_ring_test_register_read (CuTest *test)
+{
+	struct pfr_i2c_ring ring;
+	uint8_t msg[PFR_I2C_RING_MSG_MAX];
+	size_t length;
+	bool wake;
+
+	TEST_START;
+
+	pfr_i2c_ring_init (&ring);
+
+	// Command byte, repeated start and read
+	pfr_i2c_ring_start (&ring);
+	pfr_i2c_ring_put (&ring, 0x08);
+	pfr_i2c_ring_abort (&ring);
+	CuAssertIntEquals (test, 0x08, ring.command);
+	CuAssertIntEquals (test, 1, ring.length);
+
+	wake = pfr_i2c_ring_stop (&ring);
+	CuAssertIntEquals (test, false, wake);
+
+	length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+	CuAssertIntEquals (test, 0, length);
+	CuAssertIntEquals (test, 0, ring.head);
+}
+
+static void pfr_i2c_ring_test_empty_write (CuTest *test)
+{
+	struct pfr_i2c_ring ring;
+	uint8_t msg[PFR_I2C_RING_MSG_MAX];
+	size_t length;
+	bool wake;
+
+	TEST_START;
+
+	pfr_i2c_ring_init (&ring);
+
+	pfr_i2c_ring_start (&ring);
+	wake = pfr_i2c_ring_stop (&ring);
+	CuAssertIntEquals (test, false, wake);
+
+	// A stop without a write, such as the end of a read
+	wake = pfr_i2c_ring_stop (&ring);
+	CuAssertIntEquals (test, false, wake);
+
+	// Bytes outside of a write are ignored
+	pfr_i2c_ring_put (&ring, 0x01);
+
+	length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+	CuAssertIntEquals (test, 0, length);
+}
+
+static void pfr_i2c_ring_test_longest_write (CuTest *test)
+{
+	struct pfr_i2c_ring ring;
+	uint8_t write[PFR_I2C_RING_MSG_MAX];
+	uint8_t msg[PFR_I2C_RING_MSG_MAX];
+	size_t length;
+	bool wake;
+	size_t i;
+	int status;
+
+	TEST_START;
+
+	pfr_i2c_ring_init (&ring);
+
+	for (i = 0; i < sizeof (write); i++) {
+		write[i] = i;
+	}
+
+	pfr_i2c_ring_start (&ring);
+	for (i = 0; i < sizeof (write); i++) {
+		pfr_i2c_ring_put (&ring, write[i]);
+	}
+	wake = pfr_i2c_ring_stop (&ring);
+	CuAssertIntEquals (test, true, wake);
+
+	length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+	CuAssertIntEquals (test, sizeof (write), length);
+
+	status = testing_validate_array (write, msg, sizeof (write));
+	CuAssertIntEquals (test, 0, status);
+}
+
+static void pfr_i2c_ring_test_too_long (CuTest *test)
+{
+	struct pfr_i2c_ring ring;
+	uint8_t msg[PFR_I2C_RING_MSG_MAX];
+	size_t length;
+	bool wake;
+	size_t i;
+
+	TEST_START;
+
+	pfr_i2c_ring_init (&ring);
+
+	pfr_i2c_ring_start (&ring);
+	for (i = 0; i < (PFR_I2C_RING_MSG_MAX + 1); i++) {
+		pfr_i2c_ring_put (&ring, i);
+	}
+	wake = pfr_i2c_ring_stop (&ring);
+	CuAssertIntEquals (test, false, wake);
+	CuAssertIntEquals (test, 1, ring.dropped);
+
+	length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+	CuAssertIntEquals (test, 0, length);
+
+	// The ring is still usable after the dropped write
+	pfr_i2c_ring_start (&ring);
+	pfr_i2c_ring_put (&ring, 0x0b);
+	pfr_i2c_ring_put (&ring, 0x01);
+	wake = pfr_i2c_ring_stop (&ring);
+	CuAssertIntEquals (test, true, wake);
+
+	length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+	CuAssertIntEquals (test, 2, length);
+	CuAssertIntEquals (test, 0x0b, msg[0]);
+	CuAssertIntEquals (test, 0x01, msg[1]);
+}
+
+static void pfr_i2c_ring_test_full (CuTest *test)
+{
+	struct pfr_i2c_ring ring;
+	uint8_t msg[PFR_I2C_RING_MSG_MAX];
+	size_t length;
+	int queued = 0;
+	int i;
+
+	TEST_START;
+
+	pfr_i2c_ring_init (&ring);
+
+	// Each byte write takes three bytes of the ring
+	for (i = 0; i < (PFR_I2C_RING_SIZE / 3) + 10; i++) {
+		pfr_i2c_ring_start (&ring);
+		pfr_i2c_ring_put (&ring, 0x0b);
+		pfr_i2c_ring_put (&ring, i);
+		pfr_i2c_ring_stop (&ring);
+		if (ring.dropped == 0) {
+			queued++;
+		}
+	}
+
+	CuAssertIntEquals (test, PFR_I2C_RING_SIZE / 3, queued);
+	CuAssertIntEquals (test, 10, ring.dropped);
+
+	for (i = 0; i < queued; i++) {
+		length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+		CuAssertIntEquals (test, 2, length);
+		CuAssertIntEquals (test, i, msg[1]);
+	}
+
+	length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+	CuAssertIntEquals (test, 0, length);
+
+	// Space is reused once the decoder catches up, across the end of the buffer
+	for (i = 0; i < (PFR_I2C_RING_SIZE / 3); i++) {
+		pfr_i2c_ring_start (&ring);
+		pfr_i2c_ring_put (&ring, 0x0c);
+		pfr_i2c_ring_put (&ring, i);
+		pfr_i2c_ring_stop (&ring);
+
+		length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+		CuAssertIntEquals (test, 2, length);
+		CuAssertIntEquals (test, 0x0c, msg[0]);
+		CuAssertIntEquals (test, i, msg[1]);
+	}
+	CuAssertIntEquals (test, 10, ring.dropped);
+}
+
+static void pfr_i2c_ring_test_get_small_buffer (CuTest *test)
+{
+	struct pfr_i2c_ring ring;
+	uint8_t msg[2];
+	size_t length;
+	int i;
+
+	TEST_START;
+
+	pfr_i2c_ring_init (&ring);
+
+	for (i = 0; i < 2; i++) {
+		pfr_i2c_ring_start (&ring);
+		pfr_i2c_ring_put (&ring, 0x70);
+		pfr_i2c_ring_put (&ring, 0x02);
+		pfr_i2c_ring_put (&ring, 0xa0 + i);
+		pfr_i2c_ring_put (&ring, 0xb0 + i);
+		pfr_i2c_ring_stop (&ring);
+	}
+
+	// The rest of a truncated write is skipped
+	for (i = 0; i < 2; i++) {
+		length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+		CuAssertIntEquals (test, sizeof (msg), length);
+		CuAssertIntEquals (test, 0x70, msg[0]);
+		CuAssertIntEquals (test, 0x02, msg[1]);
+	}
+
+	length = pfr_i2c_ring_get (&ring, msg, sizeof (msg));
+	CuAssertIntEquals (test, 0, length);
+}
+
+static void pfr_i2c_ring_test_null (CuTest *test)
+{
+	struct pfr_i2c_ring ring;
+	uint8_t msg[PFR_I2C_RING_MSG_MAX];
+	size_t length;
+	bool wake;
+
+	TEST_START;
+
+	pfr_i2c_ring_init (&ring);
+	pfr_i2c_ring_init (NULL);
+
+	pfr_i2c_ring_start (NULL);
+	pfr_i2c_ring_put (NULL, 0x01);
+	pfr_i2c_ring_abort (NULL);
+	pfr_i2c_ring_rearm (NULL);
+
+	wake = pfr_i2c_ring_stop (NULL);
+	CuAssertIntEquals (test, false, wake);
+
+	length = pfr_i2c_ring_get (NULL, msg, sizeof (msg));
+	CuAssertIntEquals (test, 0, length);
+
+	length = pfr_i2c_ring_get (&ring, NULL, sizeof (msg));
+	CuAssertIntEquals (test, 0, length);
+}
+
+#if PFR_I2C_TRACE_SIZE
+static void pfr_i2c_ring_test_trace (CuTest *test)
+{
+	struct pfr_i2c_ring ring;
+	uint32_t i;
+
+	TEST_START;
+
+	pfr_i2c_ring_init (&ring);
+
+	PFR_I2C_TRACE (&ring, PFR_I2C_TRACE_WRITE_REQUESTED, 0x38);
+	PFR_I2C_TRACE (&ring, PFR_I2C_TRACE_WRITE_RECEIVED, 0x0b);
+
+	CuAssertIntEquals (test, 2, ring.trace_count);
+	CuAssertIntEquals (test, (PFR_I2C_TRACE_WRITE_REQUESTED << 8) | 0x38, ring.trace[0]);
+	CuAssertIntEquals (test, (1 << 16) | (PFR_I2C_TRACE_WRITE_RECEIVED << 8) | 0x0b,
+		ring.trace[1]);
+
+	// The trace keeps the most recent events
+	for (i = 2; i < (PFR_I2C_TRACE_SIZE + 2); i++) {
+		PFR_I2C_TRACE (&ring, PFR_I2C_TRACE_STOP, i);
+	}
+	CuAssertIntEquals (test, ((PFR_I2C_TRACE_SIZE + 1) << 16) | (PFR_I2C_TRACE_STOP << 8) |
+		((PFR_I2C_TRACE_SIZE + 1) & 0xff), ring.trace[1]);
+
+	// A dropped write is traced with its length
+	pfr_i2c_ring_start (&ring);
+	for (i = 0; i < (PFR_I2C_RING_MSG_MAX + 1); i++) {
+		pfr_i2c_ring_put (&ring, i);
+	}
+	pfr_i2c_ring_stop (&ring);
+	CuAssertIntEquals (test, ((PFR_I2C_TRACE_SIZE + 2) << 16) | (PFR_I2C_TRACE_DROPPED << 8) | 0xff,
+		ring.trace[(PFR_I2C_TRACE_SIZE + 2) % PFR_I2C_TRACE_SIZE]);
+}
+#endif
+
+static void pfr_i2c_ring_test_stress (CuTest *test)
+{
+	TEST_START;
+
+	pfr_i2c_ring_testing_stress (test, false);
+}
+
+static void pfr_i2c_ring_test_stress_slow_decoder (CuTest *test)
+{
+	TEST_START;
+
+	pfr_i2c_ring_testing_stress (test, true);
+}
+
+
+CuSuite* get_pfr_i2c_ring_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_i2c_ring_test_write);
+	SUITE_ADD_TEST (suite, pfr_i2c_ring_test_wake_once);
+	SUITE_ADD_TEST (suite, pfr_i2c_ring_test_rearm);
+	SUITE_ADD_TEST (suite, pfr_i2c_ring_test_register_read);
+	SUITE_ADD_TEST (suite, pfr_i2c_ring_test_empty_write);
+	SUITE_ADD_TEST (suite, pfr_i2c_ring_test_longest_write);
+	SUITE_ADD_TEST (suite, pfr_i2c_ring_test_too_long);
+	SUITE_ADD_TEST (suite, pfr_i2c_ring_test_full);
+	SUITE_ADD_TEST (suite, pfr_i2c_ring_test_get_small_buffer);
+	SUITE_ADD_TEST (suite, pfr_i2c_ring_test_null);
+#if PFR_I2C_TRACE_SIZE
+	SUITE_ADD_TEST (suite, pfr_i2c_ring_test_trace);
+#endif
+	SUITE_ADD_TEST (suite, pfr_i2c_ring_test_stress);
+	SUITE_ADD_TEST (suite, pfr_i2c_ring_test_stress_slow_decoder);
+
+	return suite;
+}
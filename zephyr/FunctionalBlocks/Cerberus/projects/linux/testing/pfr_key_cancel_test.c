@@ -0,0 +1,430 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "platform.h"
+#include "testing.h"
+#include "status/rot_status.h"
+#include "emulated_flash.h"
+#include "pfr_key_cancel.h"
+
+
+static const char *SUITE = "pfr_key_cancel";
+
+
+/**
+ * Size of the emulated internal flash.
+ */
+#define	PFR_KEY_CANCEL_TESTING_FLASH_SIZE		(64 * 1024)
+
+/**
+ * Address of the PCH PFM policy, the same offset it has in the provisioning UFM.
+ */
+#define	PFR_KEY_CANCEL_TESTING_BASE				0x9c
+
+/**
+ * Address of the policy byte that holds a key.
+ */
+#define	PFR_KEY_CANCEL_TESTING_ADDR(policy, key_id)	\
+	(PFR_KEY_CANCEL_TESTING_BASE + ((policy) * PFR_KEY_CANCEL_POLICY_SIZE) + ((key_id) / 8))
+
+
+/**
+ * Write handler of the emulated flash, saved while a test injects write faults.
+ */
+static int (*pfr_key_cancel_testing_write) (struct flash*, uint32_t, const uint8_t*, size_t);
+
+/**
+ * Flash write that always fails.
+ */
+static int pfr_key_cancel_testing_failed_write (struct flash *flash, uint32_t address,
+	const uint8_t *data, size_t length)
+{
+	return FLASH_NO_MEMORY;
+}
+
+/**
+ * Flash write that reports success without programming anything.
+ */
+static int pfr_key_cancel_testing_lost_write (struct flash *flash, uint32_t address,
+	const uint8_t *data, size_t length)
+{
+	return length;
+}
+
+/**
+ * Set up an erased emulated flash and cancellation policies that use it.
+ *
+ * @param test The test framework.
+ * @param flash The emulated flash to initialize.
+ * @param kc The policies to initialize.
+ */
+static void pfr_key_cancel_testing_init (CuTest *test, struct emulated_flash *flash,
+	struct pfr_key_cancel *kc)
+{
+	int status;
+
+	status = emulated_flash_init (flash, PFR_KEY_CANCEL_TESTING_FLASH_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_key_cancel_init (kc, &flash->base, PFR_KEY_CANCEL_TESTING_BASE);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_key_cancel_testing_write = flash->base.write;
+}
+
+/**
+ * Check if a key is cancelled as seen by a new instance, such as after a reset.
+ *
+ * @param test The test framework.
+ * @param flash The flash that holds the policies.
+ * @param policy The policy to check.
+ * @param key_id The key to check.
+ *
+ * @return true if flash holds the key as cancelled.
+ */
+static bool pfr_key_cancel_testing_reload (CuTest *test, struct emulated_flash *flash, int policy,
+	uint32_t key_id)
+{
+	struct pfr_key_cancel kc;
+	int status;
+
+	status = pfr_key_cancel_init (&kc, &flash->base, PFR_KEY_CANCEL_TESTING_BASE);
+	CuAssertIntEquals (test, 0, status);
+
+	return pfr_key_cancel_is_cancelled (&kc, policy, key_id);
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_key_cancel_test_init (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_key_cancel kc;
+	int status;
+
+	TEST_START;
+
+	pfr_key_cancel_testing_init (test, &flash, &kc);
+
+	/* Nothing is read until the first lookup. */
+	CuAssertIntEquals (test, 0, flash.reads);
+
+	status = pfr_key_cancel_init (NULL, &flash.base, PFR_KEY_CANCEL_TESTING_BASE);
+	CuAssertIntEquals (test, PFR_KEY_CANCEL_INVALID_ARGUMENT, status);
+
+	status = pfr_key_cancel_init (&kc, NULL, PFR_KEY_CANCEL_TESTING_BASE);
+	CuAssertIntEquals (test, PFR_KEY_CANCEL_INVALID_ARGUMENT, status);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_key_cancel_test_lookup_loads_once (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_key_cancel kc;
+	uint32_t key_id;
+	int policy;
+
+	TEST_START;
+
+	pfr_key_cancel_testing_init (test, &flash, &kc);
+
+	for (policy = 0; policy < PFR_KEY_CANCEL_POLICIES; policy++) {
+		for (key_id = 0; key_id < PFR_KEY_CANCEL_KEY_IDS; key_id++) {
+			CuAssertIntEquals (test, false, pfr_key_cancel_is_cancelled (&kc, policy, key_id));
+		}
+	}
+
+	/* Every policy is loaded with one read and lookups are answered from RAM. */
+	CuAssertIntEquals (test, 1, flash.reads);
+	CuAssertIntEquals (test, PFR_KEY_CANCEL_POLICIES * PFR_KEY_CANCEL_POLICY_SIZE,
+		flash.bytes_read);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_key_cancel_test_lookup_stored_policy (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_key_cancel kc;
+	uint32_t key_id;
+	int policy;
+
+	TEST_START;
+
+	pfr_key_cancel_testing_init (test, &flash, &kc);
+
+	/* Cancel every key with an ID that is a multiple of its policy number plus 3, as the
+	 * provisioning flow would have left it. */
+	for (policy = 0; policy < PFR_KEY_CANCEL_POLICIES; policy++) {
+		for (key_id = 0; key_id < PFR_KEY_CANCEL_KEY_IDS; key_id += policy + 3) {
+			flash.data[PFR_KEY_CANCEL_TESTING_ADDR (policy, key_id)] &= ~(0x80 >> (key_id % 8));
+		}
+	}
+
+	for (policy = 0; policy < PFR_KEY_CANCEL_POLICIES; policy++) {
+		for (key_id = 0; key_id < PFR_KEY_CANCEL_KEY_IDS; key_id++) {
+			CuAssertIntEquals (test, ((key_id % (policy + 3)) == 0),
+				pfr_key_cancel_is_cancelled (&kc, policy, key_id));
+		}
+	}
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_key_cancel_test_cancel_all_keys (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_key_cancel kc;
+	uint32_t key_id;
+	uint32_t other;
+	int policy;
+	int check;
+	int status;
+
+	TEST_START;
+
+	pfr_key_cancel_testing_init (test, &flash, &kc);
+
+	for (policy = 0; policy < PFR_KEY_CANCEL_POLICIES; policy++) {
+		for (key_id = 0; key_id < PFR_KEY_CANCEL_KEY_IDS; key_id++) {
+			status = pfr_key_cancel_cancel (&kc, policy, key_id);
+			CuAssertIntEquals (test, 0, status);
+
+			CuAssertIntEquals (test, true, pfr_key_cancel_is_cancelled (&kc, policy, key_id));
+			CuAssertIntEquals (test, true,
+				pfr_key_cancel_testing_reload (test, &flash, policy, key_id));
+
+			/* Only the one key is cancelled. */
+			for (check = 0; check < PFR_KEY_CANCEL_POLICIES; check++) {
+				for (other = 0; other < PFR_KEY_CANCEL_KEY_IDS; other++) {
+					CuAssertIntEquals (test,
+						(check < policy) || ((check == policy) && (other <= key_id)),
+						pfr_key_cancel_is_cancelled (&kc, check, other));
+				}
+			}
+		}
+	}
+
+	/* Each key took one single byte program and nothing was erased. */
+	CuAssertIntEquals (test, PFR_KEY_CANCEL_POLICIES * PFR_KEY_CANCEL_KEY_IDS, flash.writes);
+	CuAssertIntEquals (test, PFR_KEY_CANCEL_POLICIES * PFR_KEY_CANCEL_KEY_IDS,
+		flash.bytes_written);
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+	CuAssertIntEquals (test, 0, flash.block_erases);
+
+	for (policy = 0; policy < PFR_KEY_CANCEL_POLICIES; policy++) {
+		CuAssertIntEquals (test, 0, flash.data[PFR_KEY_CANCEL_TESTING_ADDR (policy, 0)]);
+		CuAssertIntEquals (test, 0,
+			flash.data[PFR_KEY_CANCEL_TESTING_ADDR (policy, PFR_KEY_CANCEL_KEY_IDS - 1)]);
+	}
+
+	/* The bytes around the policies are untouched. */
+	CuAssertIntEquals (test, 0xff, flash.data[PFR_KEY_CANCEL_TESTING_BASE - 1]);
+	CuAssertIntEquals (test, 0xff, flash.data[PFR_KEY_CANCEL_TESTING_BASE +
+		(PFR_KEY_CANCEL_POLICIES * PFR_KEY_CANCEL_POLICY_SIZE)]);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_key_cancel_test_cancel_bit_order (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_key_cancel kc;
+	int status;
+
+	TEST_START;
+
+	pfr_key_cancel_testing_init (test, &flash, &kc);
+
+	status = pfr_key_cancel_cancel (&kc, PFR_KEY_CANCEL_POLICY_BMC_PFM, 0);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_key_cancel_cancel (&kc, PFR_KEY_CANCEL_POLICY_BMC_PFM, 15);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_key_cancel_cancel (&kc, PFR_KEY_CANCEL_POLICY_CPLD_CAPSULE, 127);
+	CuAssertIntEquals (test, 0, status);
+
+	/* Key 0 is the most significant bit of the first byte. */
+	CuAssertIntEquals (test, 0x7f,
+		flash.data[PFR_KEY_CANCEL_TESTING_ADDR (PFR_KEY_CANCEL_POLICY_BMC_PFM, 0)]);
+	CuAssertIntEquals (test, 0xfe,
+		flash.data[PFR_KEY_CANCEL_TESTING_ADDR (PFR_KEY_CANCEL_POLICY_BMC_PFM, 15)]);
+	CuAssertIntEquals (test, 0xfe,
+		flash.data[PFR_KEY_CANCEL_TESTING_ADDR (PFR_KEY_CANCEL_POLICY_CPLD_CAPSULE, 127)]);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_key_cancel_test_cancel_already_cancelled (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_key_cancel kc;
+	int status;
+
+	TEST_START;
+
+	pfr_key_cancel_testing_init (test, &flash, &kc);
+
+	status = pfr_key_cancel_cancel (&kc, PFR_KEY_CANCEL_POLICY_PCH_CAPSULE, 42);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, flash.writes);
+
+	status = pfr_key_cancel_cancel (&kc, PFR_KEY_CANCEL_POLICY_PCH_CAPSULE, 42);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, flash.writes);
+
+	CuAssertIntEquals (test, true,
+		pfr_key_cancel_is_cancelled (&kc, PFR_KEY_CANCEL_POLICY_PCH_CAPSULE, 42));
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_key_cancel_test_cancel_write_error (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_key_cancel kc;
+	int status;
+
+	TEST_START;
+
+	pfr_key_cancel_testing_init (test, &flash, &kc);
+
+	flash.base.write = pfr_key_cancel_testing_failed_write;
+
+	status = pfr_key_cancel_cancel (&kc, PFR_KEY_CANCEL_POLICY_BMC_CAPSULE, 7);
+	CuAssertIntEquals (test, FLASH_NO_MEMORY, status);
+
+	/* RAM and flash still agree the key is valid. */
+	CuAssertIntEquals (test, false,
+		pfr_key_cancel_is_cancelled (&kc, PFR_KEY_CANCEL_POLICY_BMC_CAPSULE, 7));
+	CuAssertIntEquals (test, false,
+		pfr_key_cancel_testing_reload (test, &flash, PFR_KEY_CANCEL_POLICY_BMC_CAPSULE, 7));
+
+	flash.base.write = pfr_key_cancel_testing_write;
+
+	status = pfr_key_cancel_cancel (&kc, PFR_KEY_CANCEL_POLICY_BMC_CAPSULE, 7);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, true,
+		pfr_key_cancel_is_cancelled (&kc, PFR_KEY_CANCEL_POLICY_BMC_CAPSULE, 7));
+	CuAssertIntEquals (test, true,
+		pfr_key_cancel_testing_reload (test, &flash, PFR_KEY_CANCEL_POLICY_BMC_CAPSULE, 7));
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_key_cancel_test_cancel_verify_failure (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_key_cancel kc;
+	int status;
+
+	TEST_START;
+
+	pfr_key_cancel_testing_init (test, &flash, &kc);
+
+	flash.base.write = pfr_key_cancel_testing_lost_write;
+
+	status = pfr_key_cancel_cancel (&kc, PFR_KEY_CANCEL_POLICY_PCH_PFM, 100);
+	CuAssertIntEquals (test, PFR_KEY_CANCEL_WRITE_FAILED, status);
+
+	CuAssertIntEquals (test, false,
+		pfr_key_cancel_is_cancelled (&kc, PFR_KEY_CANCEL_POLICY_PCH_PFM, 100));
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_key_cancel_test_invalid_key (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_key_cancel kc;
+	int status;
+
+	TEST_START;
+
+	pfr_key_cancel_testing_init (test, &flash, &kc);
+
+	/* Keys that can't be checked are never accepted. */
+	CuAssertIntEquals (test, true,
+		pfr_key_cancel_is_cancelled (&kc, PFR_KEY_CANCEL_POLICY_PCH_PFM, PFR_KEY_CANCEL_KEY_IDS));
+	CuAssertIntEquals (test, true, pfr_key_cancel_is_cancelled (&kc, -1, 0));
+	CuAssertIntEquals (test, true, pfr_key_cancel_is_cancelled (&kc, PFR_KEY_CANCEL_POLICIES, 0));
+	CuAssertIntEquals (test, true,
+		pfr_key_cancel_is_cancelled (NULL, PFR_KEY_CANCEL_POLICY_PCH_PFM, 0));
+
+	/* Key 128 of one policy must not cancel key 0 of the next. */
+	status = pfr_key_cancel_cancel (&kc, PFR_KEY_CANCEL_POLICY_PCH_PFM, PFR_KEY_CANCEL_KEY_IDS);
+	CuAssertIntEquals (test, PFR_KEY_CANCEL_INVALID_ARGUMENT, status);
+
+	status = pfr_key_cancel_cancel (&kc, PFR_KEY_CANCEL_POLICIES, 0);
+	CuAssertIntEquals (test, PFR_KEY_CANCEL_INVALID_ARGUMENT, status);
+
+	status = pfr_key_cancel_cancel (NULL, PFR_KEY_CANCEL_POLICY_PCH_PFM, 0);
+	CuAssertIntEquals (test, PFR_KEY_CANCEL_INVALID_ARGUMENT, status);
+
+	CuAssertIntEquals (test, false,
+		pfr_key_cancel_is_cancelled (&kc, PFR_KEY_CANCEL_POLICY_PCH_CAPSULE, 0));
+	CuAssertIntEquals (test, 0, flash.writes);
+
+	pfr_key_cancel_invalidate (NULL);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_key_cancel_test_invalidate (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_key_cancel kc;
+
+	TEST_START;
+
+	pfr_key_cancel_testing_init (test, &flash, &kc);
+
+	CuAssertIntEquals (test, false,
+		pfr_key_cancel_is_cancelled (&kc, PFR_KEY_CANCEL_POLICY_BMC_PFM, 9));
+
+	/* The UFM is provisioned with a new policy. */
+	flash.data[PFR_KEY_CANCEL_TESTING_ADDR (PFR_KEY_CANCEL_POLICY_BMC_PFM, 9)] = 0xbf;
+
+	CuAssertIntEquals (test, false,
+		pfr_key_cancel_is_cancelled (&kc, PFR_KEY_CANCEL_POLICY_BMC_PFM, 9));
+
+	pfr_key_cancel_invalidate (&kc);
+
+	CuAssertIntEquals (test, true,
+		pfr_key_cancel_is_cancelled (&kc, PFR_KEY_CANCEL_POLICY_BMC_PFM, 9));
+	CuAssertIntEquals (test, 2, flash.reads);
+
+	emulated_flash_release (&flash);
+}
+
+
+CuSuite* get_pfr_key_cancel_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_key_cancel_test_init);
+	SUITE_ADD_TEST (suite, pfr_key_cancel_test_lookup_loads_once);
+	SUITE_ADD_TEST (suite, pfr_key_cancel_test_lookup_stored_policy);
+	SUITE_ADD_TEST (suite, pfr_key_cancel_test_cancel_all_keys);
+	SUITE_ADD_TEST (suite, pfr_key_cancel_test_cancel_bit_order);
+	SUITE_ADD_TEST (suite, pfr_key_cancel_test_cancel_already_cancelled);
+	SUITE_ADD_TEST (suite, pfr_key_cancel_test_cancel_write_error);
+	SUITE_ADD_TEST (suite, pfr_key_cancel_test_cancel_verify_failure);
+	SUITE_ADD_TEST (suite, pfr_key_cancel_test_invalid_key);
+	SUITE_ADD_TEST (suite, pfr_key_cancel_test_invalidate);
+
+	return suite;
+}
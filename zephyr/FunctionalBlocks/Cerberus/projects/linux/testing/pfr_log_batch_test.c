@@ -0,0 +1,772 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "testing.h"
+#include "pfr_log_batch.h"
+
+
+static const char *SUITE = "pfr_log_batch";
+
+
+/**
+ * Length of the entries used by most tests.  Eight of them make up a page in the ring.
+ */
+#define	PFR_LOG_BATCH_TESTING_ENTRY_LEN		30
+
+/**
+ * Space each entry takes in the ring.
+ */
+#define	PFR_LOG_BATCH_TESTING_RECORD_LEN	(PFR_LOG_BATCH_TESTING_ENTRY_LEN + 2)
+
+/**
+ * Space each entry takes in the buffer of the backing log.
+ */
+#define	PFR_LOG_BATCH_TESTING_BACKING_LEN	\
+	(PFR_LOG_BATCH_TESTING_ENTRY_LEN + sizeof (struct logging_entry_header))
+
+/**
+ * Error returned by the backing log when a fault is injected.
+ */
+#define	PFR_LOG_BATCH_TESTING_LOG_ERROR		-20
+
+
+/**
+ * Persistent log behind the batched log.  Entries are stored back to back without headers.
+ */
+struct pfr_log_batch_testing_backing {
+	struct logging base;				/**< The base logging instance. */
+	uint8_t data[8192];					/**< Entries added to the log. */
+	size_t length;						/**< Number of bytes in the log. */
+	int entries;						/**< Number of entries added. */
+	int flushes;						/**< Number of times the log was flushed. */
+	int clears;							/**< Number of times the log was cleared. */
+	int create_status;					/**< Status for adding entries. */
+	int flush_status;					/**< Status for flushing. */
+};
+
+/**
+ * Batched log and its dependencies.
+ */
+struct pfr_log_batch_testing {
+	struct pfr_log_batch batch;			/**< The log being tested. */
+	struct pfr_log_batch_testing_backing backing;	/**< The log that stores the entries. */
+	int wakes;							/**< Number of times the flusher was woken. */
+};
+
+static int pfr_log_batch_testing_create_entry (struct logging *logging, uint8_t *entry,
+	size_t length)
+{
+	struct pfr_log_batch_testing_backing *backing =
+		(struct pfr_log_batch_testing_backing*) logging;
+
+	if (backing->create_status != 0) {
+		return backing->create_status;
+	}
+
+	if ((backing->length + length) > sizeof (backing->data)) {
+		return LOGGING_CREATE_ENTRY_FAILED;
+	}
+
+	memcpy (&backing->data[backing->length], entry, length);
+	backing->length += length;
+	backing->entries++;
+
+	return 0;
+}
+
+static int pfr_log_batch_testing_flush (struct logging *logging)
+{
+	struct pfr_log_batch_testing_backing *backing =
+		(struct pfr_log_batch_testing_backing*) logging;
+
+	backing->flushes++;
+
+	return backing->flush_status;
+}
+
+static int pfr_log_batch_testing_clear (struct logging *logging)
+{
+	struct pfr_log_batch_testing_backing *backing =
+		(struct pfr_log_batch_testing_backing*) logging;
+
+	backing->length = 0;
+	backing->entries = 0;
+	backing->clears++;
+
+	return 0;
+}
+
+static int pfr_log_batch_testing_get_size (struct logging *logging)
+{
+	struct pfr_log_batch_testing_backing *backing =
+		(struct pfr_log_batch_testing_backing*) logging;
+
+	return backing->length;
+}
+
+static int pfr_log_batch_testing_read_contents (struct logging *logging, uint32_t offset,
+	uint8_t *contents, size_t length)
+{
+	struct pfr_log_batch_testing_backing *backing =
+		(struct pfr_log_batch_testing_backing*) logging;
+
+	if (offset >= backing->length) {
+		return 0;
+	}
+
+	if (length > (backing->length - offset)) {
+		length = backing->length - offset;
+	}
+
+	memcpy (contents, &backing->data[offset], length);
+
+	return length;
+}
+
+static void pfr_log_batch_testing_wake (void *context)
+{
+	struct pfr_log_batch_testing *testing = context;
+
+	testing->wakes++;
+}
+
+/**
+ * Fill an entry with data unique to its ID.
+ */
+static void pfr_log_batch_testing_entry (uint8_t *entry, int id, size_t length)
+{
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		entry[i] = id + i;
+	}
+}
+
+/**
+ * Add entries with consecutive IDs to the batched log.
+ */
+static void pfr_log_batch_testing_add (CuTest *test, struct pfr_log_batch_testing *testing,
+	int first, int count, size_t length)
+{
+	uint8_t entry[PFR_LOG_BATCH_MAX_ENTRY];
+	int status;
+	int i;
+
+	for (i = first; i < (first + count); i++) {
+		pfr_log_batch_testing_entry (entry, i, length);
+
+		status = testing->batch.base.create_entry (&testing->batch.base, entry, length);
+		CuAssertIntEquals (test, 0, status);
+	}
+}
+
+/**
+ * Check that the backing log holds entries with consecutive IDs, in order.
+ */
+static void pfr_log_batch_testing_check (CuTest *test, struct pfr_log_batch_testing *testing,
+	int count, size_t length)
+{
+	uint8_t entry[PFR_LOG_BATCH_MAX_ENTRY];
+	int status;
+	int i;
+
+	CuAssertIntEquals (test, count, testing->backing.entries);
+	CuAssertIntEquals (test, count * length, testing->backing.length);
+
+	for (i = 0; i < count; i++) {
+		pfr_log_batch_testing_entry (entry, i, length);
+
+		status = testing_validate_array (entry, &testing->backing.data[i * length], length);
+		CuAssertIntEquals (test, 0, status);
+	}
+}
+
+static void pfr_log_batch_testing_init (CuTest *test, struct pfr_log_batch_testing *testing)
+{
+	int status;
+
+	memset (&testing->backing, 0, sizeof (testing->backing));
+	testing->backing.base.create_entry = pfr_log_batch_testing_create_entry;
+	testing->backing.base.flush = pfr_log_batch_testing_flush;
+	testing->backing.base.clear = pfr_log_batch_testing_clear;
+	testing->backing.base.get_size = pfr_log_batch_testing_get_size;
+	testing->backing.base.read_contents = pfr_log_batch_testing_read_contents;
+	testing->wakes = 0;
+
+	status = pfr_log_batch_init (&testing->batch, &testing->backing.base,
+		pfr_log_batch_testing_wake, testing);
+	CuAssertIntEquals (test, 0, status);
+}
+
+static void pfr_log_batch_testing_release (struct pfr_log_batch_testing *testing)
+{
+	pfr_log_batch_release (&testing->batch);
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_log_batch_test_init (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	CuAssertPtrNotNull (test, testing.batch.base.create_entry);
+	CuAssertPtrNotNull (test, testing.batch.base.flush);
+	CuAssertPtrNotNull (test, testing.batch.base.clear);
+	CuAssertPtrNotNull (test, testing.batch.base.get_size);
+	CuAssertPtrNotNull (test, testing.batch.base.read_contents);
+
+	CuAssertIntEquals (test, 0, pfr_log_batch_pending (&testing.batch));
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_init_null (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int status;
+
+	TEST_START;
+
+	status = pfr_log_batch_init (NULL, &testing.backing.base, NULL, NULL);
+	CuAssertIntEquals (test, LOGGING_INVALID_ARGUMENT, status);
+
+	status = pfr_log_batch_init (&testing.batch, NULL, NULL, NULL);
+	CuAssertIntEquals (test, LOGGING_INVALID_ARGUMENT, status);
+
+	pfr_log_batch_release (NULL);
+}
+
+static void pfr_log_batch_test_create_entry_queues (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, 3, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	/* Nothing reaches the backing log until the flusher runs. */
+	CuAssertIntEquals (test, 0, testing.backing.entries);
+	CuAssertIntEquals (test, 0, testing.backing.flushes);
+	CuAssertIntEquals (test, 0, testing.wakes);
+	CuAssertIntEquals (test, 3 * PFR_LOG_BATCH_TESTING_RECORD_LEN,
+		pfr_log_batch_pending (&testing.batch));
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_create_entry_wakes_at_page (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, 7, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+	CuAssertIntEquals (test, 0, testing.wakes);
+
+	pfr_log_batch_testing_add (test, &testing, 7, 1, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+	CuAssertIntEquals (test, 1, testing.wakes);
+
+	pfr_log_batch_testing_add (test, &testing, 8, 1, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+	CuAssertIntEquals (test, 2, testing.wakes);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_create_entry_max_length (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, 1, PFR_LOG_BATCH_MAX_ENTRY);
+
+	status = pfr_log_batch_drain (&testing.batch);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_log_batch_testing_check (test, &testing, 1, PFR_LOG_BATCH_MAX_ENTRY);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_create_entry_bad_length (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	uint8_t entry[PFR_LOG_BATCH_MAX_ENTRY + 1];
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	status = testing.batch.base.create_entry (&testing.batch.base, entry, 0);
+	CuAssertIntEquals (test, LOGGING_BAD_ENTRY_LENGTH, status);
+
+	status = testing.batch.base.create_entry (&testing.batch.base, entry, sizeof (entry));
+	CuAssertIntEquals (test, LOGGING_BAD_ENTRY_LENGTH, status);
+
+	CuAssertIntEquals (test, 0, pfr_log_batch_pending (&testing.batch));
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_create_entry_null (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	uint8_t entry[PFR_LOG_BATCH_TESTING_ENTRY_LEN];
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	status = testing.batch.base.create_entry (NULL, entry, sizeof (entry));
+	CuAssertIntEquals (test, LOGGING_INVALID_ARGUMENT, status);
+
+	status = testing.batch.base.create_entry (&testing.batch.base, NULL, sizeof (entry));
+	CuAssertIntEquals (test, LOGGING_INVALID_ARGUMENT, status);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_create_entry_overflow (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int count = PFR_LOG_BATCH_RING_SIZE / PFR_LOG_BATCH_TESTING_RECORD_LEN;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, count, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+	CuAssertIntEquals (test, 0, testing.backing.entries);
+	CuAssertIntEquals (test, 0, testing.batch.overflows);
+
+	/* With the ring full, the next entry moves the queue to the backing log itself. */
+	pfr_log_batch_testing_add (test, &testing, count, 1, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+	CuAssertIntEquals (test, count, testing.backing.entries);
+	CuAssertIntEquals (test, 0, testing.backing.flushes);
+	CuAssertIntEquals (test, 1, testing.batch.overflows);
+
+	status = pfr_log_batch_drain (&testing.batch);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_log_batch_testing_check (test, &testing, count + 1, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_create_entry_overflow_error (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int count = PFR_LOG_BATCH_RING_SIZE / PFR_LOG_BATCH_TESTING_RECORD_LEN;
+	uint8_t entry[PFR_LOG_BATCH_TESTING_ENTRY_LEN];
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, count, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	testing.backing.create_status = PFR_LOG_BATCH_TESTING_LOG_ERROR;
+
+	status = testing.batch.base.create_entry (&testing.batch.base, entry, sizeof (entry));
+	CuAssertIntEquals (test, PFR_LOG_BATCH_TESTING_LOG_ERROR, status);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_process_below_page (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, 3, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	status = pfr_log_batch_process (&testing.batch, false);
+	CuAssertIntEquals (test, 0, status);
+
+	/* The entries are handed over but not programmed until a page builds up. */
+	pfr_log_batch_testing_check (test, &testing, 3, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+	CuAssertIntEquals (test, 0, testing.backing.flushes);
+	CuAssertIntEquals (test, 3 * PFR_LOG_BATCH_TESTING_BACKING_LEN,
+		pfr_log_batch_pending (&testing.batch));
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_process_page (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, 7, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	status = pfr_log_batch_process (&testing.batch, false);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_log_batch_testing_check (test, &testing, 7, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+	CuAssertIntEquals (test, 1, testing.backing.flushes);
+	CuAssertIntEquals (test, 0, pfr_log_batch_pending (&testing.batch));
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_process_idle (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, 1, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	status = pfr_log_batch_process (&testing.batch, true);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_log_batch_testing_check (test, &testing, 1, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+	CuAssertIntEquals (test, 1, testing.backing.flushes);
+	CuAssertIntEquals (test, 0, pfr_log_batch_pending (&testing.batch));
+
+	/* Nothing more to write. */
+	status = pfr_log_batch_process (&testing.batch, true);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, testing.backing.flushes);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_process_accumulates (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	/* Entries handed over on earlier runs count towards the page. */
+	pfr_log_batch_testing_add (test, &testing, 0, 4, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+	status = pfr_log_batch_process (&testing.batch, false);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, testing.backing.flushes);
+
+	pfr_log_batch_testing_add (test, &testing, 4, 3, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+	status = pfr_log_batch_process (&testing.batch, false);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, testing.backing.flushes);
+
+	pfr_log_batch_testing_check (test, &testing, 7, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_process_ring_wrap (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	size_t length = 45;
+	int count = (PFR_LOG_BATCH_RING_SIZE / (length + 2)) - 1;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	/* The second batch runs off the end of the ring, splitting lengths and entries. */
+	pfr_log_batch_testing_add (test, &testing, 0, count, length);
+	status = pfr_log_batch_process (&testing.batch, true);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_log_batch_testing_add (test, &testing, count, count, length);
+	status = pfr_log_batch_process (&testing.batch, true);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_log_batch_testing_add (test, &testing, 2 * count, count, length);
+	status = pfr_log_batch_drain (&testing.batch);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_log_batch_testing_check (test, &testing, 3 * count, length);
+	CuAssertIntEquals (test, 0, testing.batch.overflows);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_process_create_error (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, 2, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	testing.backing.create_status = PFR_LOG_BATCH_TESTING_LOG_ERROR;
+
+	status = pfr_log_batch_process (&testing.batch, true);
+	CuAssertIntEquals (test, PFR_LOG_BATCH_TESTING_LOG_ERROR, status);
+	CuAssertIntEquals (test, 0, testing.backing.flushes);
+
+	/* Only the entry the backing log rejected is lost. */
+	testing.backing.create_status = 0;
+
+	status = pfr_log_batch_drain (&testing.batch);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, testing.backing.entries);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_process_flush_error (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, 1, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	testing.backing.flush_status = PFR_LOG_BATCH_TESTING_LOG_ERROR;
+
+	status = pfr_log_batch_process (&testing.batch, true);
+	CuAssertIntEquals (test, PFR_LOG_BATCH_TESTING_LOG_ERROR, status);
+	CuAssertIntEquals (test, PFR_LOG_BATCH_TESTING_BACKING_LEN,
+		pfr_log_batch_pending (&testing.batch));
+
+	/* The flush is retried on the next run. */
+	testing.backing.flush_status = 0;
+
+	status = pfr_log_batch_process (&testing.batch, true);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 2, testing.backing.flushes);
+	CuAssertIntEquals (test, 0, pfr_log_batch_pending (&testing.batch));
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_process_null (CuTest *test)
+{
+	int status;
+
+	TEST_START;
+
+	status = pfr_log_batch_process (NULL, true);
+	CuAssertIntEquals (test, LOGGING_INVALID_ARGUMENT, status);
+
+	CuAssertIntEquals (test, 0, pfr_log_batch_pending (NULL));
+}
+
+static void pfr_log_batch_test_flush_wakes (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, 1, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	status = testing.batch.base.flush (&testing.batch.base);
+	CuAssertIntEquals (test, 0, status);
+
+	/* Flushing leaves the flash work to the flusher. */
+	CuAssertIntEquals (test, 1, testing.wakes);
+	CuAssertIntEquals (test, 0, testing.backing.entries);
+	CuAssertIntEquals (test, 0, testing.backing.flushes);
+
+	status = testing.batch.base.flush (NULL);
+	CuAssertIntEquals (test, LOGGING_INVALID_ARGUMENT, status);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_flush_no_wake (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+	testing.batch.wake = NULL;
+
+	pfr_log_batch_testing_add (test, &testing, 0, 8, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	status = testing.batch.base.flush (&testing.batch.base);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, testing.wakes);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_drain (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, 3, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	status = pfr_log_batch_drain (&testing.batch);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_log_batch_testing_check (test, &testing, 3, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+	CuAssertIntEquals (test, 1, testing.backing.flushes);
+	CuAssertIntEquals (test, 0, pfr_log_batch_pending (&testing.batch));
+
+	status = pfr_log_batch_drain (NULL);
+	CuAssertIntEquals (test, LOGGING_INVALID_ARGUMENT, status);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_get_size (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, 2, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	/* Queued entries are included. */
+	status = testing.batch.base.get_size (&testing.batch.base);
+	CuAssertIntEquals (test, 2 * PFR_LOG_BATCH_TESTING_ENTRY_LEN, status);
+	CuAssertIntEquals (test, 0, testing.backing.flushes);
+
+	status = testing.batch.base.get_size (NULL);
+	CuAssertIntEquals (test, LOGGING_INVALID_ARGUMENT, status);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_read_contents (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	uint8_t expected[PFR_LOG_BATCH_TESTING_ENTRY_LEN];
+	uint8_t contents[2 * PFR_LOG_BATCH_TESTING_ENTRY_LEN];
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, 2, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	status = testing.batch.base.read_contents (&testing.batch.base,
+		PFR_LOG_BATCH_TESTING_ENTRY_LEN, contents, sizeof (contents));
+	CuAssertIntEquals (test, PFR_LOG_BATCH_TESTING_ENTRY_LEN, status);
+
+	pfr_log_batch_testing_entry (expected, 1, sizeof (expected));
+	status = testing_validate_array (expected, contents, sizeof (expected));
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing.batch.base.read_contents (NULL, 0, contents, sizeof (contents));
+	CuAssertIntEquals (test, LOGGING_INVALID_ARGUMENT, status);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+static void pfr_log_batch_test_clear (CuTest *test)
+{
+	struct pfr_log_batch_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_log_batch_testing_init (test, &testing);
+
+	pfr_log_batch_testing_add (test, &testing, 0, 2, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+	status = pfr_log_batch_process (&testing.batch, false);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_log_batch_testing_add (test, &testing, 2, 2, PFR_LOG_BATCH_TESTING_ENTRY_LEN);
+
+	status = testing.batch.base.clear (&testing.batch.base);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, testing.backing.clears);
+	CuAssertIntEquals (test, 0, pfr_log_batch_pending (&testing.batch));
+
+	/* Queued entries are discarded with the rest of the log. */
+	status = pfr_log_batch_drain (&testing.batch);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, testing.backing.entries);
+
+	status = testing.batch.base.clear (NULL);
+	CuAssertIntEquals (test, LOGGING_INVALID_ARGUMENT, status);
+
+	pfr_log_batch_testing_release (&testing);
+}
+
+
+CuSuite* get_pfr_log_batch_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_init);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_init_null);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_create_entry_queues);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_create_entry_wakes_at_page);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_create_entry_max_length);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_create_entry_bad_length);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_create_entry_null);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_create_entry_overflow);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_create_entry_overflow_error);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_process_below_page);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_process_page);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_process_idle);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_process_accumulates);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_process_ring_wrap);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_process_create_error);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_process_flush_error);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_process_null);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_flush_wakes);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_flush_no_wake);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_drain);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_get_size);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_read_contents);
+	SUITE_ADD_TEST (suite, pfr_log_batch_test_clear);
+
+	return suite;
+}
@@ -0,0 +1,426 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "platform.h"
+#include "testing.h"
+#include "pfr_mailbox_fifo.h"
+
+
+static const char *SUITE = "pfr_mailbox_fifo";
+
+
+/**
+ * 7-bit address of the mailbox target.
+ */
+#define	PFR_MAILBOX_FIFO_TESTING_ADDRESS		0x38
+
+/**
+ * Block command used by the tests.
+ */
+#define	PFR_MAILBOX_FIFO_TESTING_COMMAND		0x70
+
+
+/**
+ * Build an SMBus block write of the given data.
+ *
+ * @param msg Output for the transaction after the address.
+ * @param data The data to write.
+ * @param length Length of the data.
+ * @param pec true to add the PEC.
+ *
+ * @return Length of the transaction.
+ */
+static size_t pfr_mailbox_fifo_testing_block (uint8_t *msg, const uint8_t *data, size_t length,
+	bool pec)
+{
+	uint8_t addr = PFR_MAILBOX_FIFO_TESTING_ADDRESS << 1;
+
+	msg[0] = PFR_MAILBOX_FIFO_TESTING_COMMAND;
+	msg[1] = length;
+	memcpy (&msg[2], data, length);
+
+	if (!pec)
+		return length + 2;
+
+	msg[length + 2] = pfr_mailbox_pec (pfr_mailbox_pec (0, &addr, 1), msg, length + 2);
+
+	return length + 3;
+}
+
+/**
+ * Fill a buffer with a counting pattern.
+ */
+static void pfr_mailbox_fifo_testing_pattern (uint8_t *data, size_t length, uint8_t start)
+{
+	size_t i;
+
+	for (i = 0; i < length; i++)
+		data[i] = start + i;
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_mailbox_fifo_test_pec (CuTest *test)
+{
+	const uint8_t check[] = "123456789";
+	uint8_t pec;
+
+	TEST_START;
+
+	/* Check value of CRC-8/SMBUS. */
+	pec = pfr_mailbox_pec (0, check, 9);
+	CuAssertIntEquals (test, 0xf4, pec);
+
+	/* The PEC can be built up a piece at a time. */
+	pec = pfr_mailbox_pec (pfr_mailbox_pec (0, check, 4), &check[4], 5);
+	CuAssertIntEquals (test, 0xf4, pec);
+}
+
+static void pfr_mailbox_fifo_test_byte_access (CuTest *test)
+{
+	struct pfr_mailbox_fifo fifo;
+	uint8_t data;
+	int status;
+	int i;
+
+	TEST_START;
+
+	pfr_mailbox_fifo_flush (&fifo);
+
+	for (i = 0; i < 3; i++) {
+		data = 0x10 + i;
+		status = pfr_mailbox_fifo_push (&fifo, &data, 1);
+		CuAssertIntEquals (test, 0, status);
+	}
+
+	CuAssertIntEquals (test, 3, fifo.length);
+	CuAssertIntEquals (test, 0x10, pfr_mailbox_fifo_pop (&fifo));
+	CuAssertIntEquals (test, 0x11, pfr_mailbox_fifo_pop (&fifo));
+	CuAssertIntEquals (test, 0x12, pfr_mailbox_fifo_pop (&fifo));
+
+	/* Reading past the data returns 0, as after a flush. */
+	CuAssertIntEquals (test, 0, pfr_mailbox_fifo_pop (&fifo));
+	CuAssertIntEquals (test, 0, pfr_mailbox_fifo_pop (NULL));
+
+	pfr_mailbox_fifo_flush (&fifo);
+	CuAssertIntEquals (test, 0, fifo.length);
+	CuAssertIntEquals (test, 0, fifo.index);
+}
+
+static void pfr_mailbox_fifo_test_push_full (CuTest *test)
+{
+	struct pfr_mailbox_fifo fifo;
+	uint8_t data[PFR_MAILBOX_FIFO_SIZE];
+	int status;
+
+	TEST_START;
+
+	pfr_mailbox_fifo_testing_pattern (data, sizeof (data), 0);
+	pfr_mailbox_fifo_flush (&fifo);
+
+	status = pfr_mailbox_fifo_push (&fifo, data, sizeof (data) - 1);
+	CuAssertIntEquals (test, 0, status);
+
+	/* Data that doesn't fit is not added at all. */
+	status = pfr_mailbox_fifo_push (&fifo, data, 2);
+	CuAssertIntEquals (test, PFR_MAILBOX_FIFO_FULL, status);
+	CuAssertIntEquals (test, sizeof (data) - 1, fifo.length);
+
+	status = pfr_mailbox_fifo_push (&fifo, data, 1);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_mailbox_fifo_push (&fifo, data, 1);
+	CuAssertIntEquals (test, PFR_MAILBOX_FIFO_FULL, status);
+	CuAssertIntEquals (test, sizeof (data), fifo.length);
+
+	status = pfr_mailbox_fifo_push (NULL, data, 1);
+	CuAssertIntEquals (test, PFR_MAILBOX_INVALID_ARGUMENT, status);
+
+	status = pfr_mailbox_fifo_push (&fifo, NULL, 1);
+	CuAssertIntEquals (test, PFR_MAILBOX_INVALID_ARGUMENT, status);
+}
+
+static void pfr_mailbox_fifo_test_load (CuTest *test)
+{
+	struct pfr_mailbox_fifo fifo;
+	uint8_t data[32];
+	int status;
+
+	TEST_START;
+
+	pfr_mailbox_fifo_testing_pattern (data, sizeof (data), 0x40);
+	pfr_mailbox_fifo_flush (&fifo);
+
+	status = pfr_mailbox_fifo_load (&fifo, data, 12);
+	CuAssertIntEquals (test, 0, status);
+	pfr_mailbox_fifo_pop (&fifo);
+
+	/* Loading replaces what was there and starts reading from the beginning. */
+	status = pfr_mailbox_fifo_load (&fifo, data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, sizeof (data), fifo.length);
+	CuAssertIntEquals (test, 0, fifo.index);
+	CuAssertIntEquals (test, 0x40, pfr_mailbox_fifo_pop (&fifo));
+
+	status = pfr_mailbox_fifo_load (NULL, data, sizeof (data));
+	CuAssertIntEquals (test, PFR_MAILBOX_INVALID_ARGUMENT, status);
+}
+
+static void pfr_mailbox_fifo_test_block_write (CuTest *test)
+{
+	struct pfr_mailbox_fifo fifo;
+	uint8_t data[32];
+	uint8_t msg[PFR_MAILBOX_BLOCK_MAX];
+	size_t length;
+	int status;
+
+	TEST_START;
+
+	pfr_mailbox_fifo_testing_pattern (data, sizeof (data), 0x80);
+	pfr_mailbox_fifo_flush (&fifo);
+
+	length = pfr_mailbox_fifo_testing_block (msg, data, sizeof (data), true);
+	status = pfr_mailbox_block_write (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS, msg, length);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, sizeof (data), fifo.length);
+	status = testing_validate_array (data, fifo.data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+}
+
+static void pfr_mailbox_fifo_test_block_write_no_pec (CuTest *test)
+{
+	struct pfr_mailbox_fifo fifo;
+	uint8_t data[12];
+	uint8_t msg[PFR_MAILBOX_BLOCK_MAX];
+	size_t length;
+	int status;
+
+	TEST_START;
+
+	pfr_mailbox_fifo_testing_pattern (data, sizeof (data), 0x20);
+	pfr_mailbox_fifo_flush (&fifo);
+
+	length = pfr_mailbox_fifo_testing_block (msg, data, sizeof (data), false);
+	status = pfr_mailbox_block_write (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS, msg, length);
+	CuAssertIntEquals (test, 0, status);
+
+	/* A second block is added after the first. */
+	status = pfr_mailbox_block_write (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS, msg, length);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, sizeof (data) * 2, fifo.length);
+	status = testing_validate_array (data, &fifo.data[sizeof (data)], sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+}
+
+static void pfr_mailbox_fifo_test_block_write_bad_pec (CuTest *test)
+{
+	struct pfr_mailbox_fifo fifo;
+	uint8_t data[32];
+	uint8_t msg[PFR_MAILBOX_BLOCK_MAX];
+	size_t length;
+	int status;
+
+	TEST_START;
+
+	pfr_mailbox_fifo_testing_pattern (data, sizeof (data), 0);
+	pfr_mailbox_fifo_flush (&fifo);
+
+	length = pfr_mailbox_fifo_testing_block (msg, data, sizeof (data), true);
+
+	msg[10] ^= 0x01;
+	status = pfr_mailbox_block_write (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS, msg, length);
+	CuAssertIntEquals (test, PFR_MAILBOX_BAD_PEC, status);
+	CuAssertIntEquals (test, 0, fifo.length);
+
+	/* The PEC covers the address, so a block for another target is rejected. */
+	msg[10] ^= 0x01;
+	status = pfr_mailbox_block_write (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS + 1, msg, length);
+	CuAssertIntEquals (test, PFR_MAILBOX_BAD_PEC, status);
+	CuAssertIntEquals (test, 0, fifo.length);
+}
+
+static void pfr_mailbox_fifo_test_block_write_bad_length (CuTest *test)
+{
+	struct pfr_mailbox_fifo fifo;
+	uint8_t data[PFR_MAILBOX_FIFO_SIZE];
+	uint8_t msg[PFR_MAILBOX_BLOCK_MAX + 1];
+	size_t length;
+	int status;
+
+	TEST_START;
+
+	pfr_mailbox_fifo_testing_pattern (data, sizeof (data), 0);
+	pfr_mailbox_fifo_flush (&fifo);
+
+	length = pfr_mailbox_fifo_testing_block (msg, data, 16, true);
+
+	/* Short and long transactions. */
+	status = pfr_mailbox_block_write (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS, msg, length - 2);
+	CuAssertIntEquals (test, PFR_MAILBOX_BAD_LENGTH, status);
+
+	status = pfr_mailbox_block_write (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS, msg, length + 1);
+	CuAssertIntEquals (test, PFR_MAILBOX_BAD_LENGTH, status);
+
+	status = pfr_mailbox_block_write (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS, msg, 1);
+	CuAssertIntEquals (test, PFR_MAILBOX_BAD_LENGTH, status);
+
+	/* A count of zero. */
+	msg[1] = 0;
+	status = pfr_mailbox_block_write (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS, msg, 2);
+	CuAssertIntEquals (test, PFR_MAILBOX_BAD_LENGTH, status);
+
+	CuAssertIntEquals (test, 0, fifo.length);
+
+	status = pfr_mailbox_block_write (NULL, PFR_MAILBOX_FIFO_TESTING_ADDRESS, msg, length);
+	CuAssertIntEquals (test, PFR_MAILBOX_INVALID_ARGUMENT, status);
+
+	status = pfr_mailbox_block_write (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS, NULL, length);
+	CuAssertIntEquals (test, PFR_MAILBOX_INVALID_ARGUMENT, status);
+}
+
+static void pfr_mailbox_fifo_test_block_write_full (CuTest *test)
+{
+	struct pfr_mailbox_fifo fifo;
+	uint8_t data[PFR_MAILBOX_FIFO_SIZE];
+	uint8_t msg[PFR_MAILBOX_BLOCK_MAX];
+	size_t length;
+	int status;
+
+	TEST_START;
+
+	pfr_mailbox_fifo_testing_pattern (data, sizeof (data), 0);
+	pfr_mailbox_fifo_flush (&fifo);
+
+	length = pfr_mailbox_fifo_testing_block (msg, data, sizeof (data), true);
+	status = pfr_mailbox_block_write (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS, msg, length);
+	CuAssertIntEquals (test, 0, status);
+
+	length = pfr_mailbox_fifo_testing_block (msg, data, 1, true);
+	status = pfr_mailbox_block_write (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS, msg, length);
+	CuAssertIntEquals (test, PFR_MAILBOX_FIFO_FULL, status);
+	CuAssertIntEquals (test, sizeof (data), fifo.length);
+}
+
+static void pfr_mailbox_fifo_test_block_read (CuTest *test)
+{
+	struct pfr_mailbox_fifo fifo;
+	uint8_t data[32];
+	uint8_t msg[PFR_MAILBOX_BLOCK_MAX];
+	uint8_t header[3];
+	uint8_t pec;
+	int length;
+	int status;
+
+	TEST_START;
+
+	pfr_mailbox_fifo_testing_pattern (data, sizeof (data), 0xa0);
+	pfr_mailbox_fifo_load (&fifo, data, sizeof (data));
+
+	length = pfr_mailbox_block_read (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS,
+		PFR_MAILBOX_FIFO_TESTING_COMMAND + 1, msg, sizeof (msg));
+	CuAssertIntEquals (test, sizeof (data) + 2, length);
+	CuAssertIntEquals (test, sizeof (data), msg[0]);
+
+	status = testing_validate_array (data, &msg[1], sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	header[0] = PFR_MAILBOX_FIFO_TESTING_ADDRESS << 1;
+	header[1] = PFR_MAILBOX_FIFO_TESTING_COMMAND + 1;
+	header[2] = (PFR_MAILBOX_FIFO_TESTING_ADDRESS << 1) | 1;
+	pec = pfr_mailbox_pec (pfr_mailbox_pec (0, header, sizeof (header)), msg, sizeof (data) + 1);
+	CuAssertIntEquals (test, pec, msg[sizeof (data) + 1]);
+
+	/* Everything has been read, so the next block is empty. */
+	length = pfr_mailbox_block_read (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS,
+		PFR_MAILBOX_FIFO_TESTING_COMMAND + 1, msg, sizeof (msg));
+	CuAssertIntEquals (test, 2, length);
+	CuAssertIntEquals (test, 0, msg[0]);
+}
+
+static void pfr_mailbox_fifo_test_block_read_after_byte_read (CuTest *test)
+{
+	struct pfr_mailbox_fifo fifo;
+	uint8_t data[12];
+	uint8_t msg[PFR_MAILBOX_BLOCK_MAX];
+	int length;
+	int status;
+
+	TEST_START;
+
+	pfr_mailbox_fifo_testing_pattern (data, sizeof (data), 0);
+	pfr_mailbox_fifo_load (&fifo, data, sizeof (data));
+
+	/* Byte and block reads share the read position. */
+	CuAssertIntEquals (test, 0, pfr_mailbox_fifo_pop (&fifo));
+	CuAssertIntEquals (test, 1, pfr_mailbox_fifo_pop (&fifo));
+
+	length = pfr_mailbox_block_read (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS,
+		PFR_MAILBOX_FIFO_TESTING_COMMAND + 1, msg, sizeof (msg));
+	CuAssertIntEquals (test, sizeof (data), length);
+	CuAssertIntEquals (test, sizeof (data) - 2, msg[0]);
+
+	status = testing_validate_array (&data[2], &msg[1], sizeof (data) - 2);
+	CuAssertIntEquals (test, 0, status);
+}
+
+static void pfr_mailbox_fifo_test_block_read_small_buffer (CuTest *test)
+{
+	struct pfr_mailbox_fifo fifo;
+	uint8_t data[32];
+	uint8_t msg[10];
+	int length;
+
+	TEST_START;
+
+	pfr_mailbox_fifo_testing_pattern (data, sizeof (data), 0);
+	pfr_mailbox_fifo_load (&fifo, data, sizeof (data));
+
+	/* What doesn't fit is left for the next read. */
+	length = pfr_mailbox_block_read (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS,
+		PFR_MAILBOX_FIFO_TESTING_COMMAND + 1, msg, sizeof (msg));
+	CuAssertIntEquals (test, sizeof (msg), length);
+	CuAssertIntEquals (test, sizeof (msg) - 2, msg[0]);
+	CuAssertIntEquals (test, sizeof (msg) - 2, pfr_mailbox_fifo_pop (&fifo));
+
+	length = pfr_mailbox_block_read (&fifo, PFR_MAILBOX_FIFO_TESTING_ADDRESS,
+		PFR_MAILBOX_FIFO_TESTING_COMMAND + 1, msg, 1);
+	CuAssertIntEquals (test, PFR_MAILBOX_INVALID_ARGUMENT, length);
+
+	length = pfr_mailbox_block_read (NULL, PFR_MAILBOX_FIFO_TESTING_ADDRESS,
+		PFR_MAILBOX_FIFO_TESTING_COMMAND + 1, msg, sizeof (msg));
+	CuAssertIntEquals (test, PFR_MAILBOX_INVALID_ARGUMENT, length);
+}
+
+
+CuSuite* get_pfr_mailbox_fifo_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_mailbox_fifo_test_pec);
+	SUITE_ADD_TEST (suite, pfr_mailbox_fifo_test_byte_access);
+	SUITE_ADD_TEST (suite, pfr_mailbox_fifo_test_push_full);
+	SUITE_ADD_TEST (suite, pfr_mailbox_fifo_test_load);
+	SUITE_ADD_TEST (suite, pfr_mailbox_fifo_test_block_write);
+	SUITE_ADD_TEST (suite, pfr_mailbox_fifo_test_block_write_no_pec);
+	SUITE_ADD_TEST (suite, pfr_mailbox_fifo_test_block_write_bad_pec);
+	SUITE_ADD_TEST (suite, pfr_mailbox_fifo_test_block_write_bad_length);
+	SUITE_ADD_TEST (suite, pfr_mailbox_fifo_test_block_write_full);
+	SUITE_ADD_TEST (suite, pfr_mailbox_fifo_test_block_read);
+	SUITE_ADD_TEST (suite, pfr_mailbox_fifo_test_block_read_after_byte_read);
+	SUITE_ADD_TEST (suite, pfr_mailbox_fifo_test_block_read_small_buffer);
+
+	return suite;
+}
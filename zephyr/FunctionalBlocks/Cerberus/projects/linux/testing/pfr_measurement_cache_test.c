@@ -0,0 +1,866 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "platform.h"
+#include "testing.h"
+#include "crypto/hash.h"
+#include "crypto/hash_openssl.h"
+#include "status/rot_status.h"
+#include "emulated_flash.h"
+#include "pfr_measurement_cache.h"
+
+
+static const char *SUITE = "pfr_measurement_cache";
+
+
+/**
+ * Size of the emulated host flash.
+ */
+#define	PFR_MEASUREMENT_CACHE_TESTING_HOST_SIZE		0x40000
+
+/**
+ * Size of the emulated RoT state flash.
+ */
+#define	PFR_MEASUREMENT_CACHE_TESTING_STATE_SIZE	0x10000
+
+/**
+ * Sector used for the measurements.  Keep it away from address 0 to catch base address bugs.
+ */
+#define	PFR_MEASUREMENT_CACHE_TESTING_BASE			0x2000
+
+/**
+ * Number of SPI regions in the test PFM.
+ */
+#define	PFR_MEASUREMENT_CACHE_TESTING_REGIONS		4
+
+/**
+ * Log entry for a blocked write to an address.
+ */
+#define	PFR_MEASUREMENT_CACHE_TESTING_LOG_WRITE(addr)	((1U << 18) | ((addr) >> 14))
+
+/**
+ * Log entry for a blocked read of an address.
+ */
+#define	PFR_MEASUREMENT_CACHE_TESTING_LOG_READ(addr)	((2U << 18) | ((addr) >> 14))
+
+/**
+ * Log entry for a blocked command.
+ */
+#define	PFR_MEASUREMENT_CACHE_TESTING_LOG_CMD(cmd)		(cmd)
+
+
+/**
+ * SPI regions of the test PFM.
+ */
+static const struct {
+	uint32_t start;						/**< First byte of the region. */
+	uint32_t end;						/**< End of the region. */
+	bool writable;						/**< The SPI filter allows the host to write the region. */
+} pfr_measurement_cache_testing_regions[PFR_MEASUREMENT_CACHE_TESTING_REGIONS] = {
+	{0x00000, 0x10000, false},
+	{0x10000, 0x24000, false},
+	{0x24000, 0x30000, true},
+	{0x30000, 0x40000, false},
+};
+
+/**
+ * A host image, its PFM digests and the RoT flash that holds the measurements.
+ */
+struct pfr_measurement_cache_testing {
+	struct emulated_flash host;			/**< Host flash with the protected regions. */
+	struct emulated_flash state;		/**< RoT flash with the measurement sector. */
+	struct hash_engine_openssl hash;	/**< Hash engine for region digests. */
+	struct pfr_measurement_cache cache;	/**< The cache under test. */
+	uint8_t key[SHA384_HASH_LENGTH];	/**< Digest of the active PFM. */
+	uint8_t expected[PFR_MEASUREMENT_CACHE_TESTING_REGIONS][SHA384_HASH_LENGTH];	/**< PFM digests. */
+	int hashed;							/**< Regions hashed by the last verification. */
+	int write_count;					/**< Writes to the state flash before one fails, or -1. */
+};
+
+/**
+ * Write handler of the emulated state flash, saved while a test injects write faults.
+ */
+static int (*pfr_measurement_cache_testing_write) (struct flash*, uint32_t, const uint8_t*, size_t);
+
+/**
+ * The active test context, for the fault injection handler.
+ */
+static struct pfr_measurement_cache_testing *pfr_measurement_cache_testing_active;
+
+/**
+ * State flash write that fails once a number of writes went through, like a power loss.
+ */
+static int pfr_measurement_cache_testing_failing_write (struct flash *flash, uint32_t address,
+	const uint8_t *data, size_t length)
+{
+	struct pfr_measurement_cache_testing *testing = pfr_measurement_cache_testing_active;
+
+	if (testing->write_count == 0) {
+		return FLASH_WRITE_FAILED;
+	}
+
+	if (testing->write_count > 0) {
+		testing->write_count--;
+	}
+
+	return pfr_measurement_cache_testing_write (flash, address, data, length);
+}
+
+/**
+ * Set up the host image, its PFM digests and an initialized cache over erased state flash.
+ *
+ * @param test The test framework.
+ * @param testing The test context to initialize.
+ */
+static void pfr_measurement_cache_testing_init (CuTest *test,
+	struct pfr_measurement_cache_testing *testing)
+{
+	int status;
+	int i;
+
+	memset (testing, 0, sizeof (*testing));
+
+	status = emulated_flash_init (&testing->host, PFR_MEASUREMENT_CACHE_TESTING_HOST_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_fill_pattern (&testing->host, 0x484f5354);
+
+	status = emulated_flash_init (&testing->state, PFR_MEASUREMENT_CACHE_TESTING_STATE_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = hash_openssl_init (&testing->hash);
+	CuAssertIntEquals (test, 0, status);
+
+	for (i = 0; i < PFR_MEASUREMENT_CACHE_TESTING_REGIONS; i++) {
+		status = testing->hash.base.calculate_sha384 (&testing->hash.base,
+			&testing->host.data[pfr_measurement_cache_testing_regions[i].start],
+			pfr_measurement_cache_testing_regions[i].end -
+				pfr_measurement_cache_testing_regions[i].start,
+			testing->expected[i], sizeof (testing->expected[i]));
+		CuAssertIntEquals (test, 0, status);
+	}
+
+	memset (testing->key, 0x3c, sizeof (testing->key));
+	testing->write_count = -1;
+
+	status = pfr_measurement_cache_init (&testing->cache, &testing->state.base,
+		PFR_MEASUREMENT_CACHE_TESTING_BASE);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_measurement_cache_testing_write = testing->state.base.write;
+	pfr_measurement_cache_testing_active = testing;
+	testing->state.base.write = pfr_measurement_cache_testing_failing_write;
+}
+
+static void pfr_measurement_cache_testing_release (struct pfr_measurement_cache_testing *testing)
+{
+	emulated_flash_release (&testing->host);
+	emulated_flash_release (&testing->state);
+	hash_openssl_release (&testing->hash);
+}
+
+/**
+ * Restart the RoT.  The RAM copy is lost and only the state flash is kept.
+ */
+static void pfr_measurement_cache_testing_reboot (CuTest *test,
+	struct pfr_measurement_cache_testing *testing)
+{
+	int status;
+
+	status = pfr_measurement_cache_init (&testing->cache, &testing->state.base,
+		PFR_MEASUREMENT_CACHE_TESTING_BASE);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_reset_counters (&testing->state);
+}
+
+/**
+ * Verify the host image the way T-1 verification does, skipping the regions the cache proves
+ * unchanged.  Writable regions are always hashed.
+ *
+ * @return 0 if every region matches the PFM or -1 if one does not.
+ */
+static int pfr_measurement_cache_testing_verify (CuTest *test,
+	struct pfr_measurement_cache_testing *testing)
+{
+	uint8_t digest[SHA384_HASH_LENGTH];
+	uint32_t start;
+	uint32_t end;
+	bool writable;
+	int status;
+	int i;
+
+	testing->hashed = 0;
+
+	status = pfr_measurement_cache_select (&testing->cache, testing->key, sizeof (testing->key));
+	CuAssertIntEquals (test, 0, status);
+
+	for (i = 0; i < PFR_MEASUREMENT_CACHE_TESTING_REGIONS; i++) {
+		start = pfr_measurement_cache_testing_regions[i].start;
+		end = pfr_measurement_cache_testing_regions[i].end;
+		writable = pfr_measurement_cache_testing_regions[i].writable;
+
+		if (!writable && pfr_measurement_cache_is_clean (&testing->cache, start, end,
+			testing->expected[i], sizeof (testing->expected[i]))) {
+			continue;
+		}
+
+		status = testing->hash.base.calculate_sha384 (&testing->hash.base,
+			&testing->host.data[start], end - start, digest, sizeof (digest));
+		CuAssertIntEquals (test, 0, status);
+		testing->hashed++;
+
+		if (memcmp (digest, testing->expected[i], sizeof (digest)) != 0) {
+			pfr_measurement_cache_clear (&testing->cache);
+			return -1;
+		}
+
+		if (!writable) {
+			status = pfr_measurement_cache_update (&testing->cache, start, end, digest,
+				sizeof (digest));
+			CuAssertIntEquals (test, 0, status);
+		}
+	}
+
+	pfr_measurement_cache_commit (&testing->cache);
+
+	return 0;
+}
+
+/**
+ * Verify an unmodified image on first boot and commit its measurements.
+ */
+static void pfr_measurement_cache_testing_first_boot (CuTest *test,
+	struct pfr_measurement_cache_testing *testing)
+{
+	int status;
+
+	status = pfr_measurement_cache_testing_verify (test, testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_TESTING_REGIONS, testing->hashed);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_TESTING_REGIONS - 1,
+		pfr_measurement_cache_count (&testing->cache));
+
+	emulated_flash_reset_counters (&testing->state);
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_measurement_cache_test_init (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_measurement_cache cache;
+	int status;
+
+	TEST_START;
+
+	status = emulated_flash_init (&flash, PFR_MEASUREMENT_CACHE_TESTING_STATE_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_measurement_cache_init (&cache, &flash.base, PFR_MEASUREMENT_CACHE_TESTING_BASE);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, pfr_measurement_cache_count (&cache));
+
+	/* Nothing is read until the first access. */
+	CuAssertIntEquals (test, 0, flash.reads);
+
+	status = pfr_measurement_cache_init (NULL, &flash.base, PFR_MEASUREMENT_CACHE_TESTING_BASE);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_measurement_cache_init (&cache, NULL, PFR_MEASUREMENT_CACHE_TESTING_BASE);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_measurement_cache_init (&cache, &flash.base,
+		PFR_MEASUREMENT_CACHE_TESTING_BASE + 0x100);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_measurement_cache_test_first_boot_hashes_all (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_TESTING_REGIONS, testing.hashed);
+
+	/* One sector load, one erase and the record programmed with the header last. */
+	CuAssertIntEquals (test, 1, testing.state.reads);
+	CuAssertIntEquals (test, 1, testing.state.sector_erases);
+	CuAssertIntEquals (test, 3, testing.state.writes);
+	CuAssertIntEquals (test, 3, pfr_measurement_cache_count (&testing.cache));
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_host_reset_skips_clean_regions (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+	int i;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+	pfr_measurement_cache_testing_first_boot (test, &testing);
+
+	for (i = 0; i < 4; i++) {
+		status = pfr_measurement_cache_reset (&testing.cache, PFR_MEASUREMENT_CACHE_HOST_RESET,
+			PFR_MEASUREMENT_CACHE_HOST_RESET);
+		CuAssertIntEquals (test, 0, status);
+
+		status = pfr_measurement_cache_testing_verify (test, &testing);
+		CuAssertIntEquals (test, 0, status);
+
+		/* Only the writable region is hashed again. */
+		CuAssertIntEquals (test, 1, testing.hashed);
+	}
+
+	/* Nothing changed, so nothing was read or written. */
+	CuAssertIntEquals (test, 0, testing.state.reads);
+	CuAssertIntEquals (test, 0, testing.state.writes);
+	CuAssertIntEquals (test, 0, testing.state.sector_erases);
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_writable_region_tamper_caught (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+	pfr_measurement_cache_testing_first_boot (test, &testing);
+
+	/* The filter lets the host write this region without logging it. */
+	testing.host.data[0x25000] ^= 0x01;
+
+	status = pfr_measurement_cache_reset (&testing.cache, PFR_MEASUREMENT_CACHE_HOST_RESET,
+		PFR_MEASUREMENT_CACHE_HOST_RESET);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, -1, status);
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_blocked_write_tamper_caught (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+	pfr_measurement_cache_testing_first_boot (test, &testing);
+
+	testing.host.data[0x20010] ^= 0x80;
+	status = pfr_measurement_cache_log_event (&testing.cache,
+		PFR_MEASUREMENT_CACHE_TESTING_LOG_WRITE (0x20010));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, -1, status);
+
+	/* The failure drops the measurements, so the next pass hashes everything. */
+	CuAssertIntEquals (test, 0, pfr_measurement_cache_count (&testing.cache));
+
+	testing.host.data[0x20010] ^= 0x80;
+	pfr_measurement_cache_testing_reboot (test, &testing);
+
+	status = pfr_measurement_cache_reset (&testing.cache, PFR_MEASUREMENT_CACHE_ROT_RESET,
+		PFR_MEASUREMENT_CACHE_HOST_RESET | PFR_MEASUREMENT_CACHE_ROT_RESET);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_TESTING_REGIONS, testing.hashed);
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_blocked_write_rehashes_region (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+	pfr_measurement_cache_testing_first_boot (test, &testing);
+
+	/* The 16kB granule at 0x20000 only overlaps the second region. */
+	status = pfr_measurement_cache_log_event (&testing.cache,
+		PFR_MEASUREMENT_CACHE_TESTING_LOG_WRITE (0x20000));
+	CuAssertIntEquals (test, 0, status);
+
+	/* Only the state byte is programmed. */
+	CuAssertIntEquals (test, 1, testing.state.writes);
+	CuAssertIntEquals (test, 1, testing.state.bytes_written);
+	CuAssertIntEquals (test, 0, testing.state.sector_erases);
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 2, testing.hashed);
+
+	/* The region is clean again after it was verified. */
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, testing.hashed);
+
+	/* A granule that only touches the end of a region. */
+	status = pfr_measurement_cache_log_event (&testing.cache,
+		PFR_MEASUREMENT_CACHE_TESTING_LOG_WRITE (0x0c000));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 2, testing.hashed);
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_blocked_read_ignored (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+	pfr_measurement_cache_testing_first_boot (test, &testing);
+
+	status = pfr_measurement_cache_log_event (&testing.cache,
+		PFR_MEASUREMENT_CACHE_TESTING_LOG_READ (0x30000));
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, testing.state.writes);
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, testing.hashed);
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_blocked_command_drops_all (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+	pfr_measurement_cache_testing_first_boot (test, &testing);
+
+	/* A blocked chip erase has no address. */
+	status = pfr_measurement_cache_log_event (&testing.cache,
+		PFR_MEASUREMENT_CACHE_TESTING_LOG_CMD (0xc7));
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, pfr_measurement_cache_count (&testing.cache));
+
+	testing.host.data[0x3ffff] ^= 0x01;
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, -1, status);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_TESTING_REGIONS, testing.hashed);
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_untrusted_rot_reset_tamper_caught (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+	pfr_measurement_cache_testing_first_boot (test, &testing);
+
+	/* The host flash is reprogrammed while the platform is off, so the monitor never sees it. */
+	testing.host.data[0x100] ^= 0x01;
+	pfr_measurement_cache_testing_reboot (test, &testing);
+
+	status = pfr_measurement_cache_reset (&testing.cache, PFR_MEASUREMENT_CACHE_ROT_RESET,
+		PFR_MEASUREMENT_CACHE_HOST_RESET);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, -1, status);
+	CuAssertIntEquals (test, 1, testing.hashed);
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_trusted_rot_reset_skips (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+	pfr_measurement_cache_testing_first_boot (test, &testing);
+	pfr_measurement_cache_testing_reboot (test, &testing);
+
+	status = pfr_measurement_cache_reset (&testing.cache, PFR_MEASUREMENT_CACHE_ROT_RESET,
+		PFR_MEASUREMENT_CACHE_HOST_RESET | PFR_MEASUREMENT_CACHE_ROT_RESET);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, testing.hashed);
+
+	CuAssertIntEquals (test, 1, testing.state.reads);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_SIZE, testing.state.bytes_read);
+	CuAssertIntEquals (test, 0, testing.state.writes);
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_dirty_survives_reboot (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+	pfr_measurement_cache_testing_first_boot (test, &testing);
+
+	status = pfr_measurement_cache_log_event (&testing.cache,
+		PFR_MEASUREMENT_CACHE_TESTING_LOG_WRITE (0x4000));
+	CuAssertIntEquals (test, 0, status);
+
+	/* The RoT restarts before the next verification. */
+	testing.host.data[0x4000] ^= 0x01;
+	pfr_measurement_cache_testing_reboot (test, &testing);
+
+	status = pfr_measurement_cache_reset (&testing.cache, PFR_MEASUREMENT_CACHE_ROT_RESET,
+		PFR_MEASUREMENT_CACHE_HOST_RESET | PFR_MEASUREMENT_CACHE_ROT_RESET);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, -1, status);
+	CuAssertIntEquals (test, 1, testing.hashed);
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_dirty_before_commit (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+	pfr_measurement_cache_testing_first_boot (test, &testing);
+
+	/* A new measurement for the region is pending when a write is logged. */
+	status = pfr_measurement_cache_update (&testing.cache, 0x00000, 0x10000, testing.expected[1],
+		sizeof (testing.expected[1]));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_measurement_cache_log_event (&testing.cache,
+		PFR_MEASUREMENT_CACHE_TESTING_LOG_WRITE (0x8000));
+	CuAssertIntEquals (test, 0, status);
+
+	/* The old record on flash must not vouch for the region either. */
+	testing.host.data[0x8000] ^= 0x01;
+	pfr_measurement_cache_testing_reboot (test, &testing);
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, -1, status);
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_power_loss_during_commit (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int fail_at;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+
+	/* Lose power before each of the entry, header and magic writes. */
+	for (fail_at = 0; fail_at < 3; fail_at++) {
+		testing.write_count = fail_at;
+		status = pfr_measurement_cache_testing_verify (test, &testing);
+		CuAssertIntEquals (test, 0, status);
+		testing.write_count = -1;
+
+		testing.host.data[0x30000] ^= 0x01;
+		pfr_measurement_cache_testing_reboot (test, &testing);
+
+		status = pfr_measurement_cache_reset (&testing.cache, PFR_MEASUREMENT_CACHE_ROT_RESET,
+			PFR_MEASUREMENT_CACHE_HOST_RESET | PFR_MEASUREMENT_CACHE_ROT_RESET);
+		CuAssertIntEquals (test, 0, status);
+
+		status = pfr_measurement_cache_testing_verify (test, &testing);
+		CuAssertIntEquals (test, -1, status);
+		CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_TESTING_REGIONS, testing.hashed);
+
+		testing.host.data[0x30000] ^= 0x01;
+	}
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_corrupt_record (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+	pfr_measurement_cache_testing_first_boot (test, &testing);
+
+	/* Flip a bit in the recorded digest of the first region. */
+	testing.state.data[PFR_MEASUREMENT_CACHE_TESTING_BASE + 64 + 20] ^= 0x04;
+	testing.host.data[0x30000] ^= 0x01;
+	pfr_measurement_cache_testing_reboot (test, &testing);
+
+	status = pfr_measurement_cache_reset (&testing.cache, PFR_MEASUREMENT_CACHE_ROT_RESET,
+		PFR_MEASUREMENT_CACHE_ROT_RESET);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, -1, status);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_TESTING_REGIONS, testing.hashed);
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_new_pfm (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+	pfr_measurement_cache_testing_first_boot (test, &testing);
+
+	/* An update installed a PFM with the same digests but a new key. */
+	testing.key[0] ^= 0xff;
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_TESTING_REGIONS, testing.hashed);
+
+	status = pfr_measurement_cache_testing_verify (test, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, testing.hashed);
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_digest_mismatch (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+	pfr_measurement_cache_testing_first_boot (test, &testing);
+
+	/* An entry only vouches for the digest and length it was recorded with. */
+	CuAssertIntEquals (test, false, pfr_measurement_cache_is_clean (&testing.cache, 0x00000,
+		0x10000, testing.expected[1], sizeof (testing.expected[1])));
+	CuAssertIntEquals (test, false, pfr_measurement_cache_is_clean (&testing.cache, 0x00000,
+		0x10000, testing.expected[0], SHA256_HASH_LENGTH));
+	CuAssertIntEquals (test, false, pfr_measurement_cache_is_clean (&testing.cache, 0x00000,
+		0x0f000, testing.expected[0], sizeof (testing.expected[0])));
+	CuAssertIntEquals (test, true, pfr_measurement_cache_is_clean (&testing.cache, 0x00000,
+		0x10000, testing.expected[0], sizeof (testing.expected[0])));
+
+	status = pfr_measurement_cache_clear (&testing.cache);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, false, pfr_measurement_cache_is_clean (&testing.cache, 0x00000,
+		0x10000, testing.expected[0], sizeof (testing.expected[0])));
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_top_of_address_space (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+
+	status = pfr_measurement_cache_select (&testing.cache, testing.key, sizeof (testing.key));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_measurement_cache_update (&testing.cache, 0xffff0000, 0xffffffff,
+		testing.expected[0], sizeof (testing.expected[0]));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_measurement_cache_log_event (&testing.cache,
+		PFR_MEASUREMENT_CACHE_TESTING_LOG_WRITE (0xffffc000));
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, false, pfr_measurement_cache_is_clean (&testing.cache, 0xffff0000,
+		0xffffffff, testing.expected[0], sizeof (testing.expected[0])));
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_full (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	uint32_t i;
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+
+	status = pfr_measurement_cache_select (&testing.cache, testing.key, sizeof (testing.key));
+	CuAssertIntEquals (test, 0, status);
+
+	for (i = 0; i < PFR_MEASUREMENT_CACHE_MAX_REGIONS; i++) {
+		status = pfr_measurement_cache_update (&testing.cache, i * 0x1000, (i + 1) * 0x1000,
+			testing.expected[i % 4], sizeof (testing.expected[0]));
+		CuAssertIntEquals (test, 0, status);
+	}
+
+	status = pfr_measurement_cache_update (&testing.cache, i * 0x1000, (i + 1) * 0x1000,
+		testing.expected[0], sizeof (testing.expected[0]));
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_FULL, status);
+
+	status = pfr_measurement_cache_commit (&testing.cache);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_measurement_cache_testing_reboot (test, &testing);
+
+	status = pfr_measurement_cache_select (&testing.cache, testing.key, sizeof (testing.key));
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_MAX_REGIONS,
+		pfr_measurement_cache_count (&testing.cache));
+	CuAssertIntEquals (test, true, pfr_measurement_cache_is_clean (&testing.cache,
+		(PFR_MEASUREMENT_CACHE_MAX_REGIONS - 1) * 0x1000, PFR_MEASUREMENT_CACHE_MAX_REGIONS * 0x1000,
+		testing.expected[3], sizeof (testing.expected[3])));
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+static void pfr_measurement_cache_test_null (CuTest *test)
+{
+	struct pfr_measurement_cache_testing testing;
+	uint8_t key[PFR_MEASUREMENT_CACHE_MAX_KEY + 1];
+	int status;
+
+	TEST_START;
+
+	pfr_measurement_cache_testing_init (test, &testing);
+
+	status = pfr_measurement_cache_select (NULL, testing.key, sizeof (testing.key));
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_measurement_cache_select (&testing.cache, NULL, sizeof (testing.key));
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_measurement_cache_select (&testing.cache, key, sizeof (key));
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	/* Nothing can be recorded before a PFM is selected. */
+	status = pfr_measurement_cache_update (&testing.cache, 0, 0x1000, testing.expected[0],
+		sizeof (testing.expected[0]));
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_measurement_cache_select (&testing.cache, testing.key, sizeof (testing.key));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_measurement_cache_update (NULL, 0, 0x1000, testing.expected[0],
+		sizeof (testing.expected[0]));
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_measurement_cache_update (&testing.cache, 0, 0x1000, NULL,
+		sizeof (testing.expected[0]));
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_measurement_cache_update (&testing.cache, 0, 0x1000, testing.expected[0],
+		PFR_MEASUREMENT_CACHE_MAX_DIGEST + 1);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	CuAssertIntEquals (test, false, pfr_measurement_cache_is_clean (NULL, 0, 0x1000,
+		testing.expected[0], sizeof (testing.expected[0])));
+	CuAssertIntEquals (test, false, pfr_measurement_cache_is_clean (&testing.cache, 0, 0x1000,
+		NULL, sizeof (testing.expected[0])));
+
+	status = pfr_measurement_cache_commit (NULL);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_measurement_cache_mark_dirty (NULL, 0, 0x1000);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_measurement_cache_log_event (NULL, 0);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_measurement_cache_reset (NULL, PFR_MEASUREMENT_CACHE_HOST_RESET,
+		PFR_MEASUREMENT_CACHE_HOST_RESET);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_measurement_cache_clear (NULL);
+	CuAssertIntEquals (test, PFR_MEASUREMENT_CACHE_INVALID_ARGUMENT, status);
+
+	CuAssertIntEquals (test, 0, pfr_measurement_cache_count (NULL));
+
+	pfr_measurement_cache_testing_release (&testing);
+}
+
+
+CuSuite* get_pfr_measurement_cache_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_init);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_first_boot_hashes_all);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_host_reset_skips_clean_regions);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_writable_region_tamper_caught);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_blocked_write_tamper_caught);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_blocked_write_rehashes_region);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_blocked_read_ignored);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_blocked_command_drops_all);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_untrusted_rot_reset_tamper_caught);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_trusted_rot_reset_skips);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_dirty_survives_reboot);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_dirty_before_commit);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_power_loss_during_commit);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_corrupt_record);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_new_pfm);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_digest_mismatch);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_top_of_address_space);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_full);
+	SUITE_ADD_TEST (suite, pfr_measurement_cache_test_null);
+
+	return suite;
+}
@@ -0,0 +1,600 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform.h"
+#include "testing.h"
+#include "pfr_pbc_plan.h"
+
+
+static const char *SUITE = "pfr_pbc_plan";
+
+
+/**
+ * Pages in a 32MB BMC active region.
+ */
+#define	PFR_PBC_PLAN_TESTING_32MB_PAGES		((32 * 1024 * 1024) / PFR_PBC_PAGE_SIZE)
+
+/**
+ * All erase sizes the planner knows about.
+ */
+#define	PFR_PBC_PLAN_TESTING_ALL_SIZES		\
+	(PFR_PBC_ERASE_4K | PFR_PBC_ERASE_32K | PFR_PBC_ERASE_64K)
+
+
+/**
+ * Erase and copy requests recorded by the test handlers.
+ */
+struct pfr_pbc_plan_testing {
+	uint8_t *covered;					/**< Pages touched by the requests. */
+	uint32_t pages;						/**< Number of pages tracked. */
+	uint32_t calls;						/**< Number of requests. */
+	uint32_t count_4k;					/**< Number of 4kB erases. */
+	uint32_t count_32k;					/**< Number of 32kB erases. */
+	uint32_t count_64k;					/**< Number of 64kB erases. */
+	uint32_t payload_offset;			/**< Next expected payload offset for copies. */
+	int overlap;						/**< A page was touched more than once. */
+	int misaligned;						/**< A request was not aligned to its length. */
+	int out_of_order;					/**< A copy did not continue the payload. */
+	uint32_t fail_at;					/**< Fail the request with this number, if not 0. */
+};
+
+/**
+ * Initialize request tracking for a bitmap.
+ */
+static void pfr_pbc_plan_testing_init (CuTest *test, struct pfr_pbc_plan_testing *testing,
+	uint32_t pages)
+{
+	memset (testing, 0, sizeof (*testing));
+
+	testing->covered = calloc (PFR_PBC_BITMAP_SIZE (pages), 1);
+	CuAssertPtrNotNull (test, testing->covered);
+	testing->pages = pages;
+}
+
+static void pfr_pbc_plan_testing_release (struct pfr_pbc_plan_testing *testing)
+{
+	free (testing->covered);
+}
+
+/**
+ * Mark a range of pages as touched.
+ */
+static void pfr_pbc_plan_testing_cover (struct pfr_pbc_plan_testing *testing, uint32_t address,
+	uint32_t length)
+{
+	uint32_t page;
+
+	for (page = address / PFR_PBC_PAGE_SIZE;
+		page < ((address + length) / PFR_PBC_PAGE_SIZE); page++) {
+		if (page >= testing->pages) {
+			testing->overlap = 1;
+			continue;
+		}
+
+		if (testing->covered[page / 8] & (0x80 >> (page % 8))) {
+			testing->overlap = 1;
+		}
+
+		testing->covered[page / 8] |= (0x80 >> (page % 8));
+	}
+}
+
+static int pfr_pbc_plan_testing_erase (void *context, uint32_t address, uint32_t length)
+{
+	struct pfr_pbc_plan_testing *testing = context;
+
+	testing->calls++;
+	if (testing->calls == testing->fail_at) {
+		return -5;
+	}
+
+	switch (length) {
+		case 0x1000:
+			testing->count_4k++;
+			break;
+
+		case 0x8000:
+			testing->count_32k++;
+			break;
+
+		case 0x10000:
+			testing->count_64k++;
+			break;
+
+		default:
+			testing->misaligned = 1;
+			break;
+	}
+
+	if (address & (length - 1)) {
+		testing->misaligned = 1;
+	}
+
+	pfr_pbc_plan_testing_cover (testing, address, length);
+
+	return 0;
+}
+
+static int pfr_pbc_plan_testing_copy (void *context, uint32_t payload_offset, uint32_t address,
+	uint32_t length)
+{
+	struct pfr_pbc_plan_testing *testing = context;
+
+	testing->calls++;
+	if (testing->calls == testing->fail_at) {
+		return -6;
+	}
+
+	if ((length == 0) || (length % PFR_PBC_PAGE_SIZE) || (address % PFR_PBC_PAGE_SIZE)) {
+		testing->misaligned = 1;
+	}
+
+	if (payload_offset != testing->payload_offset) {
+		testing->out_of_order = 1;
+	}
+	testing->payload_offset += length;
+
+	pfr_pbc_plan_testing_cover (testing, address, length);
+
+	return 0;
+}
+
+/**
+ * Set a range of pages in a bitmap.
+ */
+static void pfr_pbc_plan_testing_set (uint8_t *bitmap, uint32_t first, uint32_t count)
+{
+	uint32_t page;
+
+	for (page = first; page < (first + count); page++) {
+		bitmap[page / 8] |= (0x80 >> (page % 8));
+	}
+}
+
+/**
+ * Count the pages set in a bitmap.
+ */
+static uint32_t pfr_pbc_plan_testing_set_pages (const uint8_t *bitmap, uint32_t pages)
+{
+	uint32_t count = 0;
+	uint32_t page;
+
+	for (page = 0; page < pages; page++) {
+		if (bitmap[page / 8] & (0x80 >> (page % 8))) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * Build a synthetic bitmap with runs of random length and position, like a real firmware image
+ * where used regions are separated by erased gaps.
+ */
+static void pfr_pbc_plan_testing_random_bitmap (uint8_t *bitmap, uint32_t pages, uint32_t seed)
+{
+	uint32_t page = 0;
+	uint32_t length;
+
+	memset (bitmap, 0, PFR_PBC_BITMAP_SIZE (pages));
+
+	while (page < pages) {
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+
+		length = 1 + (seed % 300);
+		if (length > (pages - page)) {
+			length = pages - page;
+		}
+
+		if (seed & 0x10000) {
+			pfr_pbc_plan_testing_set (bitmap, page, length);
+		}
+
+		page += length;
+	}
+}
+
+/**
+ * Run the erase planner and check that exactly the set pages were erased with aligned commands.
+ */
+static void pfr_pbc_plan_testing_check_erase (CuTest *test, const uint8_t *bitmap,
+	uint32_t pages, uint32_t erase_sizes, struct pfr_pbc_plan_testing *testing)
+{
+	int status;
+
+	pfr_pbc_plan_testing_init (test, testing, pages);
+
+	status = pfr_pbc_plan_erase (bitmap, pages, erase_sizes, pfr_pbc_plan_testing_erase, testing);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 0, testing->overlap);
+	CuAssertIntEquals (test, 0, testing->misaligned);
+
+	status = testing_validate_array (bitmap, testing->covered, PFR_PBC_BITMAP_SIZE (pages));
+	CuAssertIntEquals (test, 0, status);
+
+	if (!(erase_sizes & PFR_PBC_ERASE_32K)) {
+		CuAssertIntEquals (test, 0, testing->count_32k);
+	}
+	if (!(erase_sizes & PFR_PBC_ERASE_64K)) {
+		CuAssertIntEquals (test, 0, testing->count_64k);
+	}
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_pbc_plan_test_next_run (CuTest *test)
+{
+	uint8_t bitmap[4] = {0x00, 0x3c, 0xff, 0x81};
+	struct pfr_pbc_run run;
+	uint32_t page = 0;
+	bool found;
+
+	TEST_START;
+
+	found = pfr_pbc_next_run (bitmap, 32, &page, &run);
+	CuAssertIntEquals (test, true, found);
+	CuAssertIntEquals (test, 10, run.first_page);
+	CuAssertIntEquals (test, 4, run.page_count);
+	CuAssertIntEquals (test, 14, page);
+
+	/* A run that continues into the next byte. */
+	found = pfr_pbc_next_run (bitmap, 32, &page, &run);
+	CuAssertIntEquals (test, true, found);
+	CuAssertIntEquals (test, 16, run.first_page);
+	CuAssertIntEquals (test, 9, run.page_count);
+
+	found = pfr_pbc_next_run (bitmap, 32, &page, &run);
+	CuAssertIntEquals (test, true, found);
+	CuAssertIntEquals (test, 31, run.first_page);
+	CuAssertIntEquals (test, 1, run.page_count);
+
+	found = pfr_pbc_next_run (bitmap, 32, &page, &run);
+	CuAssertIntEquals (test, false, found);
+	CuAssertIntEquals (test, 32, page);
+}
+
+static void pfr_pbc_plan_test_next_run_partial_byte (CuTest *test)
+{
+	uint8_t bitmap[2] = {0xff, 0xff};
+	struct pfr_pbc_run run;
+	uint32_t page = 0;
+	bool found;
+
+	TEST_START;
+
+	/* Bits past the end of the map are ignored. */
+	found = pfr_pbc_next_run (bitmap, 12, &page, &run);
+	CuAssertIntEquals (test, true, found);
+	CuAssertIntEquals (test, 0, run.first_page);
+	CuAssertIntEquals (test, 12, run.page_count);
+
+	found = pfr_pbc_next_run (bitmap, 12, &page, &run);
+	CuAssertIntEquals (test, false, found);
+}
+
+static void pfr_pbc_plan_test_next_run_empty (CuTest *test)
+{
+	uint8_t bitmap[64];
+	struct pfr_pbc_run run;
+	uint32_t page = 0;
+
+	TEST_START;
+
+	memset (bitmap, 0, sizeof (bitmap));
+
+	CuAssertIntEquals (test, false, pfr_pbc_next_run (bitmap, sizeof (bitmap) * 8, &page, &run));
+	CuAssertIntEquals (test, sizeof (bitmap) * 8, page);
+
+	page = 0;
+	CuAssertIntEquals (test, false, pfr_pbc_next_run (NULL, 8, &page, &run));
+	CuAssertIntEquals (test, false, pfr_pbc_next_run (bitmap, 8, NULL, &run));
+	CuAssertIntEquals (test, false, pfr_pbc_next_run (bitmap, 8, &page, NULL));
+}
+
+static void pfr_pbc_plan_test_erase_single_block (CuTest *test)
+{
+	uint8_t bitmap[4] = {0x00, 0x00, 0xff, 0xff};
+	struct pfr_pbc_plan_testing testing;
+
+	TEST_START;
+
+	/* 16 set bits that cover one aligned 64kB block are a single erase. */
+	pfr_pbc_plan_testing_check_erase (test, bitmap, 32, PFR_PBC_PLAN_TESTING_ALL_SIZES, &testing);
+	CuAssertIntEquals (test, 1, testing.calls);
+	CuAssertIntEquals (test, 1, testing.count_64k);
+
+	pfr_pbc_plan_testing_release (&testing);
+}
+
+static void pfr_pbc_plan_test_erase_unaligned_block (CuTest *test)
+{
+	uint8_t bitmap[4] = {0x00, 0xff, 0xff, 0x00};
+	struct pfr_pbc_plan_testing testing;
+
+	TEST_START;
+
+	/* 64kB that don't start on a block boundary split into two 32kB erases. */
+	pfr_pbc_plan_testing_check_erase (test, bitmap, 32, PFR_PBC_PLAN_TESTING_ALL_SIZES, &testing);
+	CuAssertIntEquals (test, 2, testing.calls);
+	CuAssertIntEquals (test, 2, testing.count_32k);
+	pfr_pbc_plan_testing_release (&testing);
+
+	/* Without 32kB erase, it takes 4kB erases. */
+	pfr_pbc_plan_testing_check_erase (test, bitmap, 32, PFR_PBC_ERASE_4K | PFR_PBC_ERASE_64K,
+		&testing);
+	CuAssertIntEquals (test, 16, testing.calls);
+	CuAssertIntEquals (test, 16, testing.count_4k);
+	pfr_pbc_plan_testing_release (&testing);
+}
+
+static void pfr_pbc_plan_test_erase_mixed_run (CuTest *test)
+{
+	uint8_t bitmap[8];
+	struct pfr_pbc_plan_testing testing;
+
+	TEST_START;
+
+	memset (bitmap, 0, sizeof (bitmap));
+	pfr_pbc_plan_testing_set (bitmap, 3, 38);
+
+	/* Pages 3-7 as 4kB, 8-15 as 32kB, 16-31 as 64kB, 32-39 as 32kB and 40 as 4kB. */
+	pfr_pbc_plan_testing_check_erase (test, bitmap, 64, PFR_PBC_PLAN_TESTING_ALL_SIZES, &testing);
+	CuAssertIntEquals (test, 6, testing.count_4k);
+	CuAssertIntEquals (test, 2, testing.count_32k);
+	CuAssertIntEquals (test, 1, testing.count_64k);
+	pfr_pbc_plan_testing_release (&testing);
+
+	pfr_pbc_plan_testing_check_erase (test, bitmap, 64, PFR_PBC_ERASE_4K | PFR_PBC_ERASE_64K,
+		&testing);
+	CuAssertIntEquals (test, 22, testing.count_4k);
+	CuAssertIntEquals (test, 1, testing.count_64k);
+	pfr_pbc_plan_testing_release (&testing);
+
+	pfr_pbc_plan_testing_check_erase (test, bitmap, 64, PFR_PBC_ERASE_4K, &testing);
+	CuAssertIntEquals (test, 38, testing.count_4k);
+	pfr_pbc_plan_testing_release (&testing);
+}
+
+static void pfr_pbc_plan_test_erase_full_32mb_region (CuTest *test)
+{
+	uint8_t *bitmap;
+	struct pfr_pbc_plan_testing testing;
+
+	TEST_START;
+
+	bitmap = malloc (PFR_PBC_BITMAP_SIZE (PFR_PBC_PLAN_TESTING_32MB_PAGES));
+	CuAssertPtrNotNull (test, bitmap);
+
+	memset (bitmap, 0xff, PFR_PBC_BITMAP_SIZE (PFR_PBC_PLAN_TESTING_32MB_PAGES));
+
+	/* 512 block erases instead of 8192 sector erases. */
+	pfr_pbc_plan_testing_check_erase (test, bitmap, PFR_PBC_PLAN_TESTING_32MB_PAGES,
+		PFR_PBC_ERASE_4K | PFR_PBC_ERASE_64K, &testing);
+	CuAssertIntEquals (test, 512, testing.calls);
+	CuAssertIntEquals (test, 512, testing.count_64k);
+
+	pfr_pbc_plan_testing_release (&testing);
+	free (bitmap);
+}
+
+static void pfr_pbc_plan_test_erase_synthetic_images (CuTest *test)
+{
+	uint8_t *bitmap;
+	struct pfr_pbc_plan_testing testing;
+	uint32_t set_pages;
+	uint32_t seed;
+
+	TEST_START;
+
+	bitmap = malloc (PFR_PBC_BITMAP_SIZE (PFR_PBC_PLAN_TESTING_32MB_PAGES));
+	CuAssertPtrNotNull (test, bitmap);
+
+	for (seed = 1; seed <= 8; seed++) {
+		pfr_pbc_plan_testing_random_bitmap (bitmap, PFR_PBC_PLAN_TESTING_32MB_PAGES,
+			seed * 0x9e3779b9);
+		set_pages = pfr_pbc_plan_testing_set_pages (bitmap, PFR_PBC_PLAN_TESTING_32MB_PAGES);
+
+		pfr_pbc_plan_testing_check_erase (test, bitmap, PFR_PBC_PLAN_TESTING_32MB_PAGES,
+			PFR_PBC_PLAN_TESTING_ALL_SIZES, &testing);
+		CuAssertTrue (test, testing.calls < set_pages);
+		CuAssertIntEquals (test, set_pages,
+			testing.count_4k + (testing.count_32k * 8) + (testing.count_64k * 16));
+		pfr_pbc_plan_testing_release (&testing);
+
+		pfr_pbc_plan_testing_check_erase (test, bitmap, PFR_PBC_PLAN_TESTING_32MB_PAGES,
+			PFR_PBC_ERASE_4K | PFR_PBC_ERASE_64K, &testing);
+		CuAssertTrue (test, testing.calls < set_pages);
+		pfr_pbc_plan_testing_release (&testing);
+	}
+
+	free (bitmap);
+}
+
+static void pfr_pbc_plan_test_erase_empty (CuTest *test)
+{
+	uint8_t bitmap[16];
+	struct pfr_pbc_plan_testing testing;
+
+	TEST_START;
+
+	memset (bitmap, 0, sizeof (bitmap));
+
+	pfr_pbc_plan_testing_check_erase (test, bitmap, sizeof (bitmap) * 8,
+		PFR_PBC_PLAN_TESTING_ALL_SIZES, &testing);
+	CuAssertIntEquals (test, 0, testing.calls);
+
+	pfr_pbc_plan_testing_release (&testing);
+}
+
+static void pfr_pbc_plan_test_erase_error (CuTest *test)
+{
+	uint8_t bitmap[8] = {0xff, 0x00, 0xf0, 0x0f, 0x00, 0x00, 0x00, 0x01};
+	struct pfr_pbc_plan_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_pbc_plan_testing_init (test, &testing, sizeof (bitmap) * 8);
+	testing.fail_at = 2;
+
+	status = pfr_pbc_plan_erase (bitmap, sizeof (bitmap) * 8, PFR_PBC_PLAN_TESTING_ALL_SIZES,
+		pfr_pbc_plan_testing_erase, &testing);
+	CuAssertIntEquals (test, -5, status);
+	CuAssertIntEquals (test, 2, testing.calls);
+
+	pfr_pbc_plan_testing_release (&testing);
+}
+
+static void pfr_pbc_plan_test_erase_invalid_arg (CuTest *test)
+{
+	uint8_t bitmap[2] = {0xff, 0xff};
+	struct pfr_pbc_plan_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_pbc_plan_testing_init (test, &testing, 16);
+
+	status = pfr_pbc_plan_erase (NULL, 16, PFR_PBC_PLAN_TESTING_ALL_SIZES,
+		pfr_pbc_plan_testing_erase, &testing);
+	CuAssertIntEquals (test, PFR_PBC_PLAN_INVALID_ARGUMENT, status);
+
+	status = pfr_pbc_plan_erase (bitmap, 16, PFR_PBC_PLAN_TESTING_ALL_SIZES, NULL, &testing);
+	CuAssertIntEquals (test, PFR_PBC_PLAN_INVALID_ARGUMENT, status);
+
+	status = pfr_pbc_plan_erase (bitmap, 16, PFR_PBC_ERASE_64K, pfr_pbc_plan_testing_erase,
+		&testing);
+	CuAssertIntEquals (test, PFR_PBC_PLAN_INVALID_ARGUMENT, status);
+
+	CuAssertIntEquals (test, 0, testing.calls);
+
+	pfr_pbc_plan_testing_release (&testing);
+}
+
+static void pfr_pbc_plan_test_copy (CuTest *test)
+{
+	uint8_t bitmap[4] = {0xc0, 0xff, 0x01, 0x80};
+	struct pfr_pbc_plan_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_pbc_plan_testing_init (test, &testing, 32);
+
+	status = pfr_pbc_plan_copy (bitmap, 32, pfr_pbc_plan_testing_copy, &testing);
+	CuAssertIntEquals (test, 0, status);
+
+	/* Pages 0-1, 8-15 and 23-24 are copied with one call per run. */
+	CuAssertIntEquals (test, 3, testing.calls);
+	CuAssertIntEquals (test, 12 * PFR_PBC_PAGE_SIZE, testing.payload_offset);
+	CuAssertIntEquals (test, 0, testing.overlap);
+	CuAssertIntEquals (test, 0, testing.misaligned);
+	CuAssertIntEquals (test, 0, testing.out_of_order);
+
+	status = testing_validate_array (bitmap, testing.covered, sizeof (bitmap));
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_pbc_plan_testing_release (&testing);
+}
+
+static void pfr_pbc_plan_test_copy_synthetic_images (CuTest *test)
+{
+	uint8_t *bitmap;
+	struct pfr_pbc_plan_testing testing;
+	uint32_t set_pages;
+	uint32_t seed;
+	int status;
+
+	TEST_START;
+
+	bitmap = malloc (PFR_PBC_BITMAP_SIZE (PFR_PBC_PLAN_TESTING_32MB_PAGES));
+	CuAssertPtrNotNull (test, bitmap);
+
+	for (seed = 1; seed <= 8; seed++) {
+		pfr_pbc_plan_testing_random_bitmap (bitmap, PFR_PBC_PLAN_TESTING_32MB_PAGES,
+			seed * 0x85ebca6b);
+		set_pages = pfr_pbc_plan_testing_set_pages (bitmap, PFR_PBC_PLAN_TESTING_32MB_PAGES);
+
+		pfr_pbc_plan_testing_init (test, &testing, PFR_PBC_PLAN_TESTING_32MB_PAGES);
+
+		status = pfr_pbc_plan_copy (bitmap, PFR_PBC_PLAN_TESTING_32MB_PAGES,
+			pfr_pbc_plan_testing_copy, &testing);
+		CuAssertIntEquals (test, 0, status);
+
+		CuAssertIntEquals (test, set_pages * PFR_PBC_PAGE_SIZE, testing.payload_offset);
+		CuAssertTrue (test, testing.calls < set_pages);
+		CuAssertIntEquals (test, 0, testing.overlap);
+		CuAssertIntEquals (test, 0, testing.misaligned);
+		CuAssertIntEquals (test, 0, testing.out_of_order);
+
+		status = testing_validate_array (bitmap, testing.covered,
+			PFR_PBC_BITMAP_SIZE (PFR_PBC_PLAN_TESTING_32MB_PAGES));
+		CuAssertIntEquals (test, 0, status);
+
+		pfr_pbc_plan_testing_release (&testing);
+	}
+
+	free (bitmap);
+}
+
+static void pfr_pbc_plan_test_copy_error (CuTest *test)
+{
+	uint8_t bitmap[2] = {0x81, 0x81};
+	struct pfr_pbc_plan_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_pbc_plan_testing_init (test, &testing, 16);
+	testing.fail_at = 3;
+
+	status = pfr_pbc_plan_copy (bitmap, 16, pfr_pbc_plan_testing_copy, &testing);
+	CuAssertIntEquals (test, -6, status);
+	CuAssertIntEquals (test, 3, testing.calls);
+
+	status = pfr_pbc_plan_copy (NULL, 16, pfr_pbc_plan_testing_copy, &testing);
+	CuAssertIntEquals (test, PFR_PBC_PLAN_INVALID_ARGUMENT, status);
+
+	status = pfr_pbc_plan_copy (bitmap, 16, NULL, &testing);
+	CuAssertIntEquals (test, PFR_PBC_PLAN_INVALID_ARGUMENT, status);
+
+	pfr_pbc_plan_testing_release (&testing);
+}
+
+
+CuSuite* get_pfr_pbc_plan_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_next_run);
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_next_run_partial_byte);
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_next_run_empty);
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_erase_single_block);
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_erase_unaligned_block);
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_erase_mixed_run);
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_erase_full_32mb_region);
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_erase_synthetic_images);
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_erase_empty);
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_erase_error);
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_erase_invalid_arg);
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_copy);
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_copy_synthetic_images);
+	SUITE_ADD_TEST (suite, pfr_pbc_plan_test_copy_error);
+
+	return suite;
+}
@@ -0,0 +1,422 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "testing.h"
+#include "pfr_pbc_tag.h"
+
+
+static const char *SUITE = "pfr_pbc_tag";
+
+
+/**
+ * The PBC header tag, "CBP_".
+ */
+#define	PFR_PBC_TAG_TESTING_TAG			0x5F504243
+
+/**
+ * Size of the flash holding the small test capsules.
+ */
+#define	PFR_PBC_TAG_TESTING_FLASH_SIZE	0x4000
+
+/**
+ * Size of the flash holding a capsule as large as the PCH staging area.
+ */
+#define	PFR_PBC_TAG_TESTING_LARGE_SIZE	0x01400000
+
+/**
+ * Error returned by the flash when a read fails.
+ */
+#define	PFR_PBC_TAG_TESTING_READ_ERROR	-20
+
+
+/**
+ * Flash that counts the SPI transactions used to read it.
+ */
+struct pfr_pbc_tag_testing {
+	uint8_t *flash;						/**< Flash contents. */
+	uint32_t size;						/**< Size of the flash. */
+	int reads;							/**< Number of read transactions. */
+	size_t bytes;						/**< Number of bytes read. */
+	int fail_read;						/**< Read transaction that fails, or -1. */
+	uint8_t window[PFR_PBC_TAG_WINDOW_SIZE];	/**< Search buffer. */
+};
+
+static int pfr_pbc_tag_testing_read (void *context, uint32_t address, uint8_t *data,
+	uint32_t length)
+{
+	struct pfr_pbc_tag_testing *testing = (struct pfr_pbc_tag_testing*) context;
+
+	if (testing->reads++ == testing->fail_read) {
+		return PFR_PBC_TAG_TESTING_READ_ERROR;
+	}
+
+	if ((address > testing->size) || (length > (testing->size - address))) {
+		return PFR_PBC_TAG_TESTING_READ_ERROR;
+	}
+
+	memcpy (data, &testing->flash[address], length);
+	testing->bytes += length;
+
+	return 0;
+}
+
+static void pfr_pbc_tag_testing_init (CuTest *test, struct pfr_pbc_tag_testing *testing,
+	uint32_t size)
+{
+	testing->flash = malloc (size);
+	CuAssertPtrNotNull (test, testing->flash);
+
+	memset (testing->flash, 0xff, size);
+	testing->size = size;
+	testing->reads = 0;
+	testing->bytes = 0;
+	testing->fail_read = -1;
+}
+
+static void pfr_pbc_tag_testing_release (struct pfr_pbc_tag_testing *testing)
+{
+	free (testing->flash);
+}
+
+static void pfr_pbc_tag_testing_put_tag (struct pfr_pbc_tag_testing *testing, uint32_t address)
+{
+	testing->flash[address] = PFR_PBC_TAG_TESTING_TAG & 0xff;
+	testing->flash[address + 1] = (PFR_PBC_TAG_TESTING_TAG >> 8) & 0xff;
+	testing->flash[address + 2] = (PFR_PBC_TAG_TESTING_TAG >> 16) & 0xff;
+	testing->flash[address + 3] = PFR_PBC_TAG_TESTING_TAG >> 24;
+}
+
+/**
+ * The search previously done by is_compression_tag_matched, reading four bytes at every address.
+ */
+static int pfr_pbc_tag_testing_legacy_find (struct pfr_pbc_tag_testing *testing, uint32_t start,
+	uint32_t end, uint32_t *address)
+{
+	uint8_t data[4];
+	uint32_t tag;
+	int status;
+
+	while ((start < end) && ((end - start) >= sizeof (data))) {
+		status = pfr_pbc_tag_testing_read (testing, start, data, sizeof (data));
+		if (status != 0) {
+			return status;
+		}
+
+		tag = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+		if (tag == PFR_PBC_TAG_TESTING_TAG) {
+			*address = start;
+			return 0;
+		}
+
+		start++;
+	}
+
+	return PFR_PBC_TAG_NOT_FOUND;
+}
+
+/**
+ * Run both searches over the same area and check they agree.
+ */
+static void pfr_pbc_tag_testing_check (CuTest *test, struct pfr_pbc_tag_testing *testing,
+	uint32_t start, uint32_t end, uint32_t window_size, int expected, uint32_t expected_addr)
+{
+	uint32_t address = 0;
+	uint32_t legacy_addr = 0;
+	int status;
+
+	status = pfr_pbc_tag_testing_legacy_find (testing, start, end, &legacy_addr);
+	CuAssertIntEquals (test, expected, status);
+
+	status = pfr_pbc_tag_find (start, end, PFR_PBC_TAG_TESTING_TAG, pfr_pbc_tag_testing_read,
+		testing, testing->window, window_size, &address);
+	CuAssertIntEquals (test, expected, status);
+
+	if (expected == 0) {
+		CuAssertIntEquals (test, expected_addr, legacy_addr);
+		CuAssertIntEquals (test, expected_addr, address);
+	}
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_pbc_tag_test_find_at_start (CuTest *test)
+{
+	struct pfr_pbc_tag_testing testing;
+
+	TEST_START;
+
+	pfr_pbc_tag_testing_init (test, &testing, PFR_PBC_TAG_TESTING_FLASH_SIZE);
+	pfr_pbc_tag_testing_put_tag (&testing, 0x800);
+
+	pfr_pbc_tag_testing_check (test, &testing, 0x800, PFR_PBC_TAG_TESTING_FLASH_SIZE,
+		PFR_PBC_TAG_WINDOW_SIZE, 0, 0x800);
+
+	testing.reads = 0;
+	pfr_pbc_tag_testing_check (test, &testing, 0x800, PFR_PBC_TAG_TESTING_FLASH_SIZE,
+		PFR_PBC_TAG_WINDOW_SIZE, 0, 0x800);
+	CuAssertIntEquals (test, 2, testing.reads);
+
+	pfr_pbc_tag_testing_release (&testing);
+}
+
+static void pfr_pbc_tag_test_find_at_end (CuTest *test)
+{
+	struct pfr_pbc_tag_testing testing;
+
+	TEST_START;
+
+	pfr_pbc_tag_testing_init (test, &testing, PFR_PBC_TAG_TESTING_FLASH_SIZE);
+	pfr_pbc_tag_testing_put_tag (&testing, PFR_PBC_TAG_TESTING_FLASH_SIZE - 4);
+
+	pfr_pbc_tag_testing_check (test, &testing, 0x800, PFR_PBC_TAG_TESTING_FLASH_SIZE,
+		PFR_PBC_TAG_WINDOW_SIZE, 0, PFR_PBC_TAG_TESTING_FLASH_SIZE - 4);
+
+	pfr_pbc_tag_testing_release (&testing);
+}
+
+static void pfr_pbc_tag_test_find_across_window (CuTest *test)
+{
+	struct pfr_pbc_tag_testing testing;
+	uint32_t offset;
+
+	TEST_START;
+
+	pfr_pbc_tag_testing_init (test, &testing, PFR_PBC_TAG_TESTING_FLASH_SIZE);
+
+	/* Every placement that crosses the end of the first window. */
+	for (offset = PFR_PBC_TAG_WINDOW_SIZE - 4; offset <= PFR_PBC_TAG_WINDOW_SIZE; offset++) {
+		memset (testing.flash, 0xff, testing.size);
+		pfr_pbc_tag_testing_put_tag (&testing, offset);
+
+		pfr_pbc_tag_testing_check (test, &testing, 0, PFR_PBC_TAG_TESTING_FLASH_SIZE,
+			PFR_PBC_TAG_WINDOW_SIZE, 0, offset);
+	}
+
+	pfr_pbc_tag_testing_release (&testing);
+}
+
+static void pfr_pbc_tag_test_find_first_match (CuTest *test)
+{
+	struct pfr_pbc_tag_testing testing;
+
+	TEST_START;
+
+	pfr_pbc_tag_testing_init (test, &testing, PFR_PBC_TAG_TESTING_FLASH_SIZE);
+	pfr_pbc_tag_testing_put_tag (&testing, 0x2345);
+	pfr_pbc_tag_testing_put_tag (&testing, 0x2801);
+	pfr_pbc_tag_testing_put_tag (&testing, 0x3000);
+
+	pfr_pbc_tag_testing_check (test, &testing, 0x800, PFR_PBC_TAG_TESTING_FLASH_SIZE,
+		PFR_PBC_TAG_WINDOW_SIZE, 0, 0x2345);
+
+	/* A tag before the start of the search is ignored. */
+	pfr_pbc_tag_testing_check (test, &testing, 0x2346, PFR_PBC_TAG_TESTING_FLASH_SIZE,
+		PFR_PBC_TAG_WINDOW_SIZE, 0, 0x2801);
+
+	pfr_pbc_tag_testing_release (&testing);
+}
+
+static void pfr_pbc_tag_test_find_partial_matches (CuTest *test)
+{
+	struct pfr_pbc_tag_testing testing;
+
+	TEST_START;
+
+	pfr_pbc_tag_testing_init (test, &testing, PFR_PBC_TAG_TESTING_FLASH_SIZE);
+
+	/* Prefixes of the tag, including a repeated first byte just before the real tag. */
+	memcpy (&testing.flash[0x900], "C", 1);
+	memcpy (&testing.flash[0xa00], "CB", 2);
+	memcpy (&testing.flash[0xb00], "CBP", 3);
+	memcpy (&testing.flash[0xc00], "CCBP_", 5);
+
+	pfr_pbc_tag_testing_check (test, &testing, 0x800, PFR_PBC_TAG_TESTING_FLASH_SIZE,
+		PFR_PBC_TAG_WINDOW_SIZE, 0, 0xc01);
+
+	pfr_pbc_tag_testing_release (&testing);
+}
+
+static void pfr_pbc_tag_test_find_truncated_at_end (CuTest *test)
+{
+	struct pfr_pbc_tag_testing testing;
+
+	TEST_START;
+
+	pfr_pbc_tag_testing_init (test, &testing, PFR_PBC_TAG_TESTING_FLASH_SIZE);
+	pfr_pbc_tag_testing_put_tag (&testing, PFR_PBC_TAG_TESTING_FLASH_SIZE - 4);
+
+	/* The tag ends one byte past the search area. */
+	pfr_pbc_tag_testing_check (test, &testing, 0x800, PFR_PBC_TAG_TESTING_FLASH_SIZE - 1,
+		PFR_PBC_TAG_WINDOW_SIZE, PFR_PBC_TAG_NOT_FOUND, 0);
+
+	pfr_pbc_tag_testing_release (&testing);
+}
+
+static void pfr_pbc_tag_test_find_not_found (CuTest *test)
+{
+	struct pfr_pbc_tag_testing testing;
+	uint32_t address = 0x1234;
+	int status;
+
+	TEST_START;
+
+	pfr_pbc_tag_testing_init (test, &testing, PFR_PBC_TAG_TESTING_FLASH_SIZE);
+
+	pfr_pbc_tag_testing_check (test, &testing, 0x800, PFR_PBC_TAG_TESTING_FLASH_SIZE,
+		PFR_PBC_TAG_WINDOW_SIZE, PFR_PBC_TAG_NOT_FOUND, 0);
+
+	/* Areas too small to hold the tag. */
+	pfr_pbc_tag_testing_check (test, &testing, 0x800, 0x803, PFR_PBC_TAG_WINDOW_SIZE,
+		PFR_PBC_TAG_NOT_FOUND, 0);
+	pfr_pbc_tag_testing_check (test, &testing, 0x800, 0x800, PFR_PBC_TAG_WINDOW_SIZE,
+		PFR_PBC_TAG_NOT_FOUND, 0);
+	pfr_pbc_tag_testing_check (test, &testing, 0x800, 0x400, PFR_PBC_TAG_WINDOW_SIZE,
+		PFR_PBC_TAG_NOT_FOUND, 0);
+
+	testing.reads = 0;
+	status = pfr_pbc_tag_find (0x800, 0x803, PFR_PBC_TAG_TESTING_TAG, pfr_pbc_tag_testing_read,
+		&testing, testing.window, sizeof (testing.window), &address);
+	CuAssertIntEquals (test, PFR_PBC_TAG_NOT_FOUND, status);
+	CuAssertIntEquals (test, 0, testing.reads);
+	CuAssertIntEquals (test, 0x1234, address);
+
+	pfr_pbc_tag_testing_release (&testing);
+}
+
+static void pfr_pbc_tag_test_find_small_window (CuTest *test)
+{
+	struct pfr_pbc_tag_testing testing;
+	uint32_t offset;
+
+	TEST_START;
+
+	pfr_pbc_tag_testing_init (test, &testing, PFR_PBC_TAG_TESTING_FLASH_SIZE);
+
+	/* The smallest window advances one byte at a time, like the legacy search. */
+	for (offset = 0x800; offset < 0x810; offset++) {
+		memset (testing.flash, 0xff, testing.size);
+		pfr_pbc_tag_testing_put_tag (&testing, offset);
+
+		pfr_pbc_tag_testing_check (test, &testing, 0x800, 0x900, 5, 0, offset);
+		pfr_pbc_tag_testing_check (test, &testing, 0x800, 0x900, 7, 0, offset);
+		pfr_pbc_tag_testing_check (test, &testing, 0x800, 0x900, 16, 0, offset);
+	}
+
+	pfr_pbc_tag_testing_release (&testing);
+}
+
+static void pfr_pbc_tag_test_find_read_error (CuTest *test)
+{
+	struct pfr_pbc_tag_testing testing;
+	uint32_t address;
+	int status;
+
+	TEST_START;
+
+	pfr_pbc_tag_testing_init (test, &testing, PFR_PBC_TAG_TESTING_FLASH_SIZE);
+	pfr_pbc_tag_testing_put_tag (&testing, PFR_PBC_TAG_TESTING_FLASH_SIZE - 4);
+
+	testing.fail_read = 1;
+	status = pfr_pbc_tag_find (0x800, PFR_PBC_TAG_TESTING_FLASH_SIZE, PFR_PBC_TAG_TESTING_TAG,
+		pfr_pbc_tag_testing_read, &testing, testing.window, sizeof (testing.window), &address);
+	CuAssertIntEquals (test, PFR_PBC_TAG_TESTING_READ_ERROR, status);
+	CuAssertIntEquals (test, 2, testing.reads);
+
+	pfr_pbc_tag_testing_release (&testing);
+}
+
+static void pfr_pbc_tag_test_find_invalid_arg (CuTest *test)
+{
+	struct pfr_pbc_tag_testing testing;
+	uint32_t address;
+	int status;
+
+	TEST_START;
+
+	pfr_pbc_tag_testing_init (test, &testing, PFR_PBC_TAG_TESTING_FLASH_SIZE);
+
+	status = pfr_pbc_tag_find (0x800, PFR_PBC_TAG_TESTING_FLASH_SIZE, PFR_PBC_TAG_TESTING_TAG,
+		NULL, &testing, testing.window, sizeof (testing.window), &address);
+	CuAssertIntEquals (test, PFR_PBC_TAG_INVALID_ARGUMENT, status);
+
+	status = pfr_pbc_tag_find (0x800, PFR_PBC_TAG_TESTING_FLASH_SIZE, PFR_PBC_TAG_TESTING_TAG,
+		pfr_pbc_tag_testing_read, &testing, NULL, sizeof (testing.window), &address);
+	CuAssertIntEquals (test, PFR_PBC_TAG_INVALID_ARGUMENT, status);
+
+	status = pfr_pbc_tag_find (0x800, PFR_PBC_TAG_TESTING_FLASH_SIZE, PFR_PBC_TAG_TESTING_TAG,
+		pfr_pbc_tag_testing_read, &testing, testing.window, 4, &address);
+	CuAssertIntEquals (test, PFR_PBC_TAG_INVALID_ARGUMENT, status);
+
+	status = pfr_pbc_tag_find (0x800, PFR_PBC_TAG_TESTING_FLASH_SIZE, PFR_PBC_TAG_TESTING_TAG,
+		pfr_pbc_tag_testing_read, &testing, testing.window, sizeof (testing.window), NULL);
+	CuAssertIntEquals (test, PFR_PBC_TAG_INVALID_ARGUMENT, status);
+
+	CuAssertIntEquals (test, 0, testing.reads);
+
+	pfr_pbc_tag_testing_release (&testing);
+}
+
+static void pfr_pbc_tag_test_find_large_capsule (CuTest *test)
+{
+	struct pfr_pbc_tag_testing testing;
+	uint32_t tag_addr = PFR_PBC_TAG_TESTING_LARGE_SIZE - 0x1000 + 0x123;
+	uint32_t address = 0;
+	uint32_t legacy_addr = 0;
+	int legacy_reads;
+	int status;
+
+	TEST_START;
+
+	/* A capsule the size of the PCH staging area, with the header near the end. */
+	pfr_pbc_tag_testing_init (test, &testing, PFR_PBC_TAG_TESTING_LARGE_SIZE);
+	pfr_pbc_tag_testing_put_tag (&testing, tag_addr);
+
+	status = pfr_pbc_tag_testing_legacy_find (&testing, 0x800, testing.size, &legacy_addr);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, tag_addr, legacy_addr);
+	legacy_reads = testing.reads;
+
+	testing.reads = 0;
+	testing.bytes = 0;
+	status = pfr_pbc_tag_find (0x800, testing.size, PFR_PBC_TAG_TESTING_TAG,
+		pfr_pbc_tag_testing_read, &testing, testing.window, sizeof (testing.window), &address);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, tag_addr, address);
+
+	/* Each window costs one transaction instead of one for every byte. */
+	CuAssertTrue (test, (testing.reads * 1000) < legacy_reads);
+	CuAssertTrue (test, testing.bytes < ((size_t) testing.size + (testing.reads * 3)));
+
+	pfr_pbc_tag_testing_release (&testing);
+}
+
+
+CuSuite* get_pfr_pbc_tag_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_pbc_tag_test_find_at_start);
+	SUITE_ADD_TEST (suite, pfr_pbc_tag_test_find_at_end);
+	SUITE_ADD_TEST (suite, pfr_pbc_tag_test_find_across_window);
+	SUITE_ADD_TEST (suite, pfr_pbc_tag_test_find_first_match);
+	SUITE_ADD_TEST (suite, pfr_pbc_tag_test_find_partial_matches);
+	SUITE_ADD_TEST (suite, pfr_pbc_tag_test_find_truncated_at_end);
+	SUITE_ADD_TEST (suite, pfr_pbc_tag_test_find_not_found);
+	SUITE_ADD_TEST (suite, pfr_pbc_tag_test_find_small_window);
+	SUITE_ADD_TEST (suite, pfr_pbc_tag_test_find_read_error);
+	SUITE_ADD_TEST (suite, pfr_pbc_tag_test_find_invalid_arg);
+	SUITE_ADD_TEST (suite, pfr_pbc_tag_test_find_large_capsule);
+
+	return suite;
+}
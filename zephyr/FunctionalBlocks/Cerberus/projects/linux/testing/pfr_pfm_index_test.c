@@ -0,0 +1,650 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "testing.h"
+#include "pfr_pfm_index.h"
+
+
+static const char *SUITE = "pfr_pfm_index";
+
+
+/**
+ * Size of the flash holding the test PFM.
+ */
+#define	PFR_PFM_INDEX_TESTING_FLASH_SIZE	0x10000
+
+/**
+ * Address of the PFM header, after the signature block.
+ */
+#define	PFR_PFM_INDEX_TESTING_PFM_ADDR		0x1400
+
+/**
+ * Error returned by the flash when a read fails.
+ */
+#define	PFR_PFM_INDEX_TESTING_READ_ERROR	-20
+
+/**
+ * Size of the Block 0 read that checks the index key.
+ */
+#define	PFR_PFM_INDEX_TESTING_BLOCK0_SIZE	128
+
+/**
+ * Flash that counts the SPI transactions used to read it.
+ */
+struct pfr_pfm_index_testing {
+	uint8_t flash[PFR_PFM_INDEX_TESTING_FLASH_SIZE];	/**< Flash contents. */
+	uint32_t end;										/**< End of the PFM being built. */
+	int reads;											/**< Number of read transactions. */
+	size_t bytes;										/**< Number of bytes read. */
+	int fail_read;										/**< Read transaction that fails, or -1. */
+};
+
+static int pfr_pfm_index_testing_read (void *context, uint32_t address, uint8_t *data,
+	uint32_t length)
+{
+	struct pfr_pfm_index_testing *testing = (struct pfr_pfm_index_testing*) context;
+
+	if (testing->reads++ == testing->fail_read) {
+		return PFR_PFM_INDEX_TESTING_READ_ERROR;
+	}
+
+	if ((address > sizeof (testing->flash)) || (length > (sizeof (testing->flash) - address))) {
+		return PFR_PFM_INDEX_TESTING_READ_ERROR;
+	}
+
+	memcpy (data, &testing->flash[address], length);
+	testing->bytes += length;
+
+	return 0;
+}
+
+static void pfr_pfm_index_testing_put32 (uint8_t *data, uint32_t value)
+{
+	data[0] = value;
+	data[1] = value >> 8;
+	data[2] = value >> 16;
+	data[3] = value >> 24;
+}
+
+static void pfr_pfm_index_testing_init (struct pfr_pfm_index_testing *testing)
+{
+	uint8_t *header = &testing->flash[PFR_PFM_INDEX_TESTING_PFM_ADDR];
+
+	memset (testing->flash, 0xff, sizeof (testing->flash));
+	memset (header, 0, PFR_PFM_INDEX_HEADER_SIZE);
+	pfr_pfm_index_testing_put32 (header, PFR_PFM_INDEX_TAG);
+	header[4] = 3;
+	header[6] = 0x02;
+	header[7] = 0x01;
+
+	testing->end = PFR_PFM_INDEX_TESTING_PFM_ADDR + PFR_PFM_INDEX_HEADER_SIZE;
+	testing->reads = 0;
+	testing->bytes = 0;
+	testing->fail_read = -1;
+}
+
+static void pfr_pfm_index_testing_finish (struct pfr_pfm_index_testing *testing)
+{
+	pfr_pfm_index_testing_put32 (&testing->flash[PFR_PFM_INDEX_TESTING_PFM_ADDR + 0x1c],
+		testing->end - PFR_PFM_INDEX_TESTING_PFM_ADDR);
+}
+
+static void pfr_pfm_index_testing_add_spi_region (struct pfr_pfm_index_testing *testing,
+	uint8_t mask, uint8_t hash_info, uint32_t start, uint32_t end)
+{
+	uint8_t *def = &testing->flash[testing->end];
+
+	memset (def, 0, PFR_PFM_INDEX_SPI_REGION_SIZE);
+	def[0] = PFR_PFM_INDEX_SPI_REGION;
+	def[1] = mask;
+	def[2] = hash_info;
+	pfr_pfm_index_testing_put32 (&def[8], start);
+	pfr_pfm_index_testing_put32 (&def[12], end);
+	testing->end += PFR_PFM_INDEX_SPI_REGION_SIZE;
+
+	if (hash_info & 0x01) {
+		memset (&testing->flash[testing->end], 0x25, 32);
+		testing->flash[testing->end] = start >> 12;
+		testing->end += 32;
+	}
+	if (hash_info & 0x02) {
+		memset (&testing->flash[testing->end], 0x38, 48);
+		testing->flash[testing->end] = start >> 12;
+		testing->end += 48;
+	}
+}
+
+static void pfr_pfm_index_testing_add_smbus_rule (struct pfr_pfm_index_testing *testing,
+	uint8_t bus, uint8_t rule, uint8_t addr)
+{
+	uint8_t *def = &testing->flash[testing->end];
+
+	memset (def, 0, PFR_PFM_INDEX_SMBUS_RULE_SIZE);
+	def[0] = PFR_PFM_INDEX_SMBUS_RULE;
+	def[5] = bus;
+	def[6] = rule;
+	def[7] = addr;
+	memset (&def[8], rule, 32);
+	testing->end += PFR_PFM_INDEX_SMBUS_RULE_SIZE;
+}
+
+static void pfr_pfm_index_testing_add_fvm (struct pfr_pfm_index_testing *testing,
+	uint16_t fv_type, uint32_t address)
+{
+	uint8_t *def = &testing->flash[testing->end];
+
+	memset (def, 0, PFR_PFM_INDEX_FVM_ADDRESS_SIZE);
+	def[0] = PFR_PFM_INDEX_FVM_ADDRESS;
+	def[1] = fv_type;
+	def[2] = fv_type >> 8;
+	pfr_pfm_index_testing_put32 (&def[8], address);
+	testing->end += PFR_PFM_INDEX_FVM_ADDRESS_SIZE;
+}
+
+/**
+ * Build a PFM with one definition of each type.
+ */
+static void pfr_pfm_index_testing_small_pfm (struct pfr_pfm_index_testing *testing)
+{
+	pfr_pfm_index_testing_init (testing);
+	pfr_pfm_index_testing_add_spi_region (testing, 0x03, 0x01, 0x0, 0x10000);
+	pfr_pfm_index_testing_add_spi_region (testing, 0x1d, 0x03, 0x10000, 0x40000);
+	pfr_pfm_index_testing_add_spi_region (testing, 0x00, 0x00, 0x40000, 0x50000);
+	pfr_pfm_index_testing_add_smbus_rule (testing, 2, 7, 0xb0);
+	pfr_pfm_index_testing_add_fvm (testing, 0x0001, 0x2000000);
+	pfr_pfm_index_testing_add_fvm (testing, 0x0002, 0x2400000);
+	pfr_pfm_index_testing_finish (testing);
+}
+
+/**
+ * Build a PFM with hundreds of definitions.
+ */
+static void pfr_pfm_index_testing_large_pfm (struct pfr_pfm_index_testing *testing)
+{
+	int i;
+
+	pfr_pfm_index_testing_init (testing);
+	for (i = 0; i < 120; i++) {
+		pfr_pfm_index_testing_add_spi_region (testing, (i & 1) ? 0x01 : 0x03, (i % 3) ? 0x01 : 0x02,
+			i * 0x10000, (i + 1) * 0x10000);
+	}
+	for (i = 0; i < 100; i++) {
+		pfr_pfm_index_testing_add_smbus_rule (testing, i % 4, i, 0x10 + i);
+	}
+	for (i = 0; i < 8; i++) {
+		pfr_pfm_index_testing_add_fvm (testing, i + 1, 0x2000000 + (i * 0x100000));
+	}
+	pfr_pfm_index_testing_finish (testing);
+}
+
+/**
+ * Walk a PFM the way the definition-at-a-time parser does: a one byte read for each definition
+ * type, then a read for each definition and region hash of interest.
+ *
+ * @return The number of definitions of the requested type.
+ */
+static int pfr_pfm_index_testing_legacy_walk (struct pfr_pfm_index_testing *testing,
+	uint8_t wanted)
+{
+	uint8_t header[PFR_PFM_INDEX_HEADER_SIZE];
+	uint8_t def[PFR_PFM_INDEX_SMBUS_RULE_SIZE];
+	uint8_t hash[48];
+	uint32_t address = PFR_PFM_INDEX_TESTING_PFM_ADDR;
+	uint32_t end;
+	int found = 0;
+
+	pfr_pfm_index_testing_read (testing, address, header, sizeof (header));
+	end = address + (header[0x1c] | (header[0x1d] << 8) | (header[0x1e] << 16));
+	address += PFR_PFM_INDEX_HEADER_SIZE;
+
+	while (address < end) {
+		pfr_pfm_index_testing_read (testing, address, def, 1);
+		if (def[0] == PFR_PFM_INDEX_SPI_REGION) {
+			pfr_pfm_index_testing_read (testing, address, def, PFR_PFM_INDEX_SPI_REGION_SIZE);
+			address += PFR_PFM_INDEX_SPI_REGION_SIZE;
+			if ((wanted == def[0]) && (def[2] & 0x03)) {
+				pfr_pfm_index_testing_read (testing, address, hash, (def[2] & 0x02) ? 48 : 32);
+			}
+			address += ((def[2] & 0x01) ? 32 : 0) + ((def[2] & 0x02) ? 48 : 0);
+		}
+		else if (def[0] == PFR_PFM_INDEX_SMBUS_RULE) {
+			if (wanted == def[0]) {
+				pfr_pfm_index_testing_read (testing, address, def, PFR_PFM_INDEX_SMBUS_RULE_SIZE);
+			}
+			address += PFR_PFM_INDEX_SMBUS_RULE_SIZE;
+		}
+		else if (def[0] == PFR_PFM_INDEX_FVM_ADDRESS) {
+			if (wanted == def[0]) {
+				pfr_pfm_index_testing_read (testing, address, def, PFR_PFM_INDEX_FVM_ADDRESS_SIZE);
+			}
+			address += PFR_PFM_INDEX_FVM_ADDRESS_SIZE;
+		}
+		else {
+			break;
+		}
+
+		if (wanted == def[0]) {
+			found++;
+		}
+	}
+
+	return found;
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_pfm_index_test_build (CuTest *test)
+{
+	struct pfr_pfm_index_testing testing;
+	struct pfr_pfm_index index;
+	uint8_t key[48];
+	int status;
+
+	TEST_START;
+
+	pfr_pfm_index_testing_small_pfm (&testing);
+	memset (key, 0x5a, sizeof (key));
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, key, 32,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, true, index.valid);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_TESTING_PFM_ADDR, index.pfm_address);
+	CuAssertIntEquals (test, testing.end - PFR_PFM_INDEX_TESTING_PFM_ADDR, index.length);
+	CuAssertIntEquals (test, 3, index.svn);
+	CuAssertIntEquals (test, 0x0102, index.revision);
+	CuAssertIntEquals (test, 32, index.key_length);
+
+	status = testing_validate_array (key, index.key, 32);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 3, index.spi_region_count);
+	CuAssertIntEquals (test, 0x0, index.spi_region[0].start_address);
+	CuAssertIntEquals (test, 0x10000, index.spi_region[0].end_address);
+	CuAssertIntEquals (test, 0x03, index.spi_region[0].protect_level_mask);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_HASH_SHA256, index.spi_region[0].hash_type);
+	CuAssertIntEquals (test, 0x00, index.spi_region[0].hash[0]);
+	CuAssertIntEquals (test, 0x25, index.spi_region[0].hash[31]);
+	CuAssertIntEquals (test, 0x10000, index.spi_region[1].start_address);
+	CuAssertIntEquals (test, 0x40000, index.spi_region[1].end_address);
+	CuAssertIntEquals (test, 0x1d, index.spi_region[1].protect_level_mask);
+	CuAssertIntEquals (test, 0x40000, index.spi_region[2].start_address);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_HASH_NONE, index.spi_region[2].hash_type);
+
+	CuAssertIntEquals (test, 1, index.smbus_rule_count);
+	CuAssertIntEquals (test, 2, index.smbus_rule[0].bus_id);
+	CuAssertIntEquals (test, 7, index.smbus_rule[0].rule_id);
+	CuAssertIntEquals (test, 0xb0, index.smbus_rule[0].device_address);
+	CuAssertIntEquals (test, 7, index.smbus_rule[0].cmd_passlist[31]);
+
+	CuAssertIntEquals (test, 2, index.fvm_count);
+	CuAssertIntEquals (test, 0x0001, index.fvm[0].fv_type);
+	CuAssertIntEquals (test, 0x2000000, index.fvm[0].address);
+	CuAssertIntEquals (test, 0x0002, index.fvm[1].fv_type);
+	CuAssertIntEquals (test, 0x2400000, index.fvm[1].address);
+
+	/* Header read, then the body in a single chunk. */
+	CuAssertIntEquals (test, 2, testing.reads);
+}
+
+static void pfr_pfm_index_test_build_hash_selection (CuTest *test)
+{
+	struct pfr_pfm_index_testing testing;
+	struct pfr_pfm_index index;
+	int status;
+
+	TEST_START;
+
+	pfr_pfm_index_testing_init (&testing);
+	pfr_pfm_index_testing_add_spi_region (&testing, 0x01, 0x03, 0x1000, 0x2000);
+	pfr_pfm_index_testing_add_spi_region (&testing, 0x01, 0x02, 0x3000, 0x4000);
+	pfr_pfm_index_testing_finish (&testing);
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, NULL, 0,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 2, index.spi_region_count);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_HASH_SHA256, index.spi_region[0].hash_type);
+	CuAssertIntEquals (test, 0x01, index.spi_region[0].hash[0]);
+	CuAssertIntEquals (test, 0x25, index.spi_region[0].hash[31]);
+	CuAssertIntEquals (test, 0x00, index.spi_region[0].hash[32]);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_HASH_SHA384, index.spi_region[1].hash_type);
+	CuAssertIntEquals (test, 0x03, index.spi_region[1].hash[0]);
+	CuAssertIntEquals (test, 0x38, index.spi_region[1].hash[47]);
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, true, NULL, 0,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_HASH_SHA384, index.spi_region[0].hash_type);
+	CuAssertIntEquals (test, 0x01, index.spi_region[0].hash[0]);
+	CuAssertIntEquals (test, 0x38, index.spi_region[0].hash[47]);
+	CuAssertIntEquals (test, 0x3000, index.spi_region[1].start_address);
+}
+
+static void pfr_pfm_index_test_build_stops_at_padding (CuTest *test)
+{
+	struct pfr_pfm_index_testing testing;
+	struct pfr_pfm_index index;
+	int status;
+
+	TEST_START;
+
+	pfr_pfm_index_testing_init (&testing);
+	pfr_pfm_index_testing_add_spi_region (&testing, 0x01, 0x01, 0x1000, 0x2000);
+	testing.end += 64;
+	pfr_pfm_index_testing_finish (&testing);
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, NULL, 0,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, true, index.valid);
+	CuAssertIntEquals (test, 1, index.spi_region_count);
+	CuAssertIntEquals (test, 0, index.smbus_rule_count);
+	CuAssertIntEquals (test, 0, index.fvm_count);
+}
+
+static void pfr_pfm_index_test_build_empty (CuTest *test)
+{
+	struct pfr_pfm_index_testing testing;
+	struct pfr_pfm_index index;
+	int status;
+
+	TEST_START;
+
+	pfr_pfm_index_testing_init (&testing);
+	pfr_pfm_index_testing_finish (&testing);
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, NULL, 0,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, true, index.valid);
+	CuAssertIntEquals (test, 0, index.spi_region_count);
+	CuAssertIntEquals (test, 1, testing.reads);
+}
+
+static void pfr_pfm_index_test_build_large_pfm (CuTest *test)
+{
+	struct pfr_pfm_index_testing testing;
+	struct pfr_pfm_index index;
+	int status;
+	int i;
+
+	TEST_START;
+
+	pfr_pfm_index_testing_large_pfm (&testing);
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, NULL, 0,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 120, index.spi_region_count);
+	CuAssertIntEquals (test, 100, index.smbus_rule_count);
+	CuAssertIntEquals (test, 8, index.fvm_count);
+
+	for (i = 0; i < 120; i++) {
+		CuAssertIntEquals (test, i * 0x10000, index.spi_region[i].start_address);
+		CuAssertIntEquals (test, (i + 1) * 0x10000, index.spi_region[i].end_address);
+		CuAssertIntEquals (test, (i % 3) ? PFR_PFM_INDEX_HASH_SHA256 : PFR_PFM_INDEX_HASH_SHA384,
+			index.spi_region[i].hash_type);
+		CuAssertIntEquals (test, (uint8_t) (i * 0x10), index.spi_region[i].hash[0]);
+	}
+	for (i = 0; i < 100; i++) {
+		CuAssertIntEquals (test, i, index.smbus_rule[i].rule_id);
+		CuAssertIntEquals (test, 0x10 + i, index.smbus_rule[i].device_address);
+	}
+}
+
+static void pfr_pfm_index_test_build_table_full (CuTest *test)
+{
+	struct pfr_pfm_index_testing testing;
+	struct pfr_pfm_index index;
+	int status;
+	int i;
+
+	TEST_START;
+
+	pfr_pfm_index_testing_init (&testing);
+	for (i = 0; i <= PFR_PFM_INDEX_MAX_FVMS; i++) {
+		pfr_pfm_index_testing_add_fvm (&testing, i, i * 0x1000);
+	}
+	pfr_pfm_index_testing_finish (&testing);
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, NULL, 0,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_TABLE_FULL, status);
+	CuAssertIntEquals (test, false, index.valid);
+}
+
+static void pfr_pfm_index_test_build_truncated_definition (CuTest *test)
+{
+	struct pfr_pfm_index_testing testing;
+	struct pfr_pfm_index index;
+	int status;
+
+	TEST_START;
+
+	pfr_pfm_index_testing_init (&testing);
+	pfr_pfm_index_testing_add_spi_region (&testing, 0x01, 0x02, 0x1000, 0x2000);
+	testing.end -= 8;
+	pfr_pfm_index_testing_finish (&testing);
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, NULL, 0,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_BAD_DEFINITION, status);
+	CuAssertIntEquals (test, false, index.valid);
+}
+
+static void pfr_pfm_index_test_build_bad_tag (CuTest *test)
+{
+	struct pfr_pfm_index_testing testing;
+	struct pfr_pfm_index index;
+	int status;
+
+	TEST_START;
+
+	pfr_pfm_index_testing_small_pfm (&testing);
+	testing.flash[PFR_PFM_INDEX_TESTING_PFM_ADDR] ^= 0x01;
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, NULL, 0,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_BAD_TAG, status);
+	CuAssertIntEquals (test, false, index.valid);
+}
+
+static void pfr_pfm_index_test_build_read_error (CuTest *test)
+{
+	struct pfr_pfm_index_testing testing;
+	struct pfr_pfm_index index;
+	int status;
+
+	TEST_START;
+
+	pfr_pfm_index_testing_small_pfm (&testing);
+
+	testing.fail_read = 0;
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, NULL, 0,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_TESTING_READ_ERROR, status);
+	CuAssertIntEquals (test, false, index.valid);
+
+	testing.reads = 0;
+	testing.fail_read = 1;
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, NULL, 0,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_TESTING_READ_ERROR, status);
+	CuAssertIntEquals (test, false, index.valid);
+}
+
+static void pfr_pfm_index_test_build_null (CuTest *test)
+{
+	struct pfr_pfm_index_testing testing;
+	struct pfr_pfm_index index;
+	uint8_t key[64] = {0};
+	int status;
+
+	TEST_START;
+
+	pfr_pfm_index_testing_small_pfm (&testing);
+
+	status = pfr_pfm_index_build (NULL, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, NULL, 0,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_INVALID_ARGUMENT, status);
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, NULL, 0,
+		NULL, &testing);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_INVALID_ARGUMENT, status);
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, NULL, 32,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_INVALID_ARGUMENT, status);
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, key,
+		sizeof (key), pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, PFR_PFM_INDEX_INVALID_ARGUMENT, status);
+
+	CuAssertIntEquals (test, 0, testing.reads);
+}
+
+static void pfr_pfm_index_test_matches (CuTest *test)
+{
+	struct pfr_pfm_index_testing testing;
+	struct pfr_pfm_index index;
+	uint8_t key[48];
+	uint8_t other[48];
+	int status;
+
+	TEST_START;
+
+	pfr_pfm_index_testing_small_pfm (&testing);
+	memset (key, 0x11, sizeof (key));
+	memset (other, 0x11, sizeof (other));
+	other[47] = 0x12;
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, true, key, 48,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, true, pfr_pfm_index_matches (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR,
+		key, 48));
+	CuAssertIntEquals (test, true, pfr_pfm_index_matches (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR,
+		NULL, 0));
+	CuAssertIntEquals (test, false, pfr_pfm_index_matches (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR,
+		other, 48));
+	CuAssertIntEquals (test, false, pfr_pfm_index_matches (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR,
+		key, 32));
+	CuAssertIntEquals (test, false, pfr_pfm_index_matches (&index,
+		PFR_PFM_INDEX_TESTING_PFM_ADDR + 0x1000, key, 48));
+	CuAssertIntEquals (test, false, pfr_pfm_index_matches (NULL, PFR_PFM_INDEX_TESTING_PFM_ADDR,
+		key, 48));
+
+	pfr_pfm_index_invalidate (&index);
+	CuAssertIntEquals (test, false, pfr_pfm_index_matches (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR,
+		key, 48));
+	CuAssertIntEquals (test, 0, index.spi_region_count);
+
+	pfr_pfm_index_invalidate (NULL);
+}
+
+static void pfr_pfm_index_test_find_fvm (CuTest *test)
+{
+	struct pfr_pfm_index_testing testing;
+	struct pfr_pfm_index index;
+	const struct pfr_pfm_fvm *fvm;
+	int status;
+
+	TEST_START;
+
+	pfr_pfm_index_testing_small_pfm (&testing);
+
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, NULL, 0,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, 0, status);
+
+	fvm = pfr_pfm_index_find_fvm (&index, 0x0002);
+	CuAssertPtrNotNull (test, fvm);
+	CuAssertIntEquals (test, 0x2400000, fvm->address);
+
+	fvm = pfr_pfm_index_find_fvm (&index, 0x0003);
+	CuAssertPtrEquals (test, NULL, (void*) fvm);
+
+	fvm = pfr_pfm_index_find_fvm (NULL, 0x0001);
+	CuAssertPtrEquals (test, NULL, (void*) fvm);
+
+	pfr_pfm_index_invalidate (&index);
+	fvm = pfr_pfm_index_find_fvm (&index, 0x0001);
+	CuAssertPtrEquals (test, NULL, (void*) fvm);
+}
+
+static void pfr_pfm_index_test_spi_transactions (CuTest *test)
+{
+	struct pfr_pfm_index_testing testing;
+	struct pfr_pfm_index index;
+	uint8_t block0[PFR_PFM_INDEX_TESTING_BLOCK0_SIZE];
+	uint8_t record[16];
+	int legacy_reads;
+	int index_reads;
+	int status;
+	int i;
+
+	TEST_START;
+
+	pfr_pfm_index_testing_large_pfm (&testing);
+
+	/* Region verification, FVM lookup and SPI filter setup each parse the PFM from flash. */
+	CuAssertIntEquals (test, 120, pfr_pfm_index_testing_legacy_walk (&testing,
+		PFR_PFM_INDEX_SPI_REGION));
+	CuAssertIntEquals (test, 8, pfr_pfm_index_testing_legacy_walk (&testing,
+		PFR_PFM_INDEX_FVM_ADDRESS));
+	pfr_pfm_index_testing_read (&testing, PFR_PFM_INDEX_TESTING_PFM_ADDR + 0x1c, record, 4);
+	for (i = 0; i < 120; i++) {
+		pfr_pfm_index_testing_read (&testing, PFR_PFM_INDEX_TESTING_PFM_ADDR, record,
+			sizeof (record));
+	}
+	legacy_reads = testing.reads;
+
+	/* The index is built once, then each user only checks Block 0 to confirm the key. */
+	testing.reads = 0;
+	testing.bytes = 0;
+	pfr_pfm_index_testing_read (&testing, 0, block0, sizeof (block0));
+	status = pfr_pfm_index_build (&index, PFR_PFM_INDEX_TESTING_PFM_ADDR, false, block0, 48,
+		pfr_pfm_index_testing_read, &testing);
+	CuAssertIntEquals (test, 0, status);
+	pfr_pfm_index_testing_read (&testing, 0, block0, sizeof (block0));
+	pfr_pfm_index_testing_read (&testing, 0, block0, sizeof (block0));
+	index_reads = testing.reads;
+
+	CuAssertTrue (test, (index_reads * 20) < legacy_reads);
+	CuAssertIntEquals (test, 120, index.spi_region_count);
+	CuAssertIntEquals (test, 8, index.fvm_count);
+}
+
+
+CuSuite* get_pfr_pfm_index_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_pfm_index_test_build);
+	SUITE_ADD_TEST (suite, pfr_pfm_index_test_build_hash_selection);
+	SUITE_ADD_TEST (suite, pfr_pfm_index_test_build_stops_at_padding);
+	SUITE_ADD_TEST (suite, pfr_pfm_index_test_build_empty);
+	SUITE_ADD_TEST (suite, pfr_pfm_index_test_build_large_pfm);
+	SUITE_ADD_TEST (suite, pfr_pfm_index_test_build_table_full);
+	SUITE_ADD_TEST (suite, pfr_pfm_index_test_build_truncated_definition);
+	SUITE_ADD_TEST (suite, pfr_pfm_index_test_build_bad_tag);
+	SUITE_ADD_TEST (suite, pfr_pfm_index_test_build_read_error);
+	SUITE_ADD_TEST (suite, pfr_pfm_index_test_build_null);
+	SUITE_ADD_TEST (suite, pfr_pfm_index_test_matches);
+	SUITE_ADD_TEST (suite, pfr_pfm_index_test_find_fvm);
+	SUITE_ADD_TEST (suite, pfr_pfm_index_test_spi_transactions);
+
+	return suite;
+}
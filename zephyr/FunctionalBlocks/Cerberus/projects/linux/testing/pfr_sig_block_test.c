@@ -0,0 +1,516 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "platform.h"
+#include "testing.h"
+#include "pfr_sig_block.h"
+
+
+static const char *SUITE = "pfr_sig_block";
+
+
+/**
+ * Number of random blocks parsed by each fuzzing test.
+ */
+#define	PFR_SIG_BLOCK_TESTING_FUZZ_COUNT		20000
+
+/**
+ * Number of entries in a table.
+ */
+#define	PFR_SIG_BLOCK_TESTING_COUNT(table)		(sizeof (table) / sizeof ((table)[0]))
+
+/**
+ * Protected content length and type written to Block0.
+ */
+#define	PFR_SIG_BLOCK_TESTING_PC_LENGTH			0x1000
+#define	PFR_SIG_BLOCK_TESTING_PC_TYPE			1
+
+/**
+ * Key IDs written to the root and CSK entries.
+ */
+#define	PFR_SIG_BLOCK_TESTING_ROOT_ID			0xffffffff
+#define	PFR_SIG_BLOCK_TESTING_CSK_ID			5
+
+
+/**
+ * Offset of the Block0 entry when the block has a CSK.
+ */
+#define	PFR_SIG_BLOCK_TESTING_B0_ENTRY			(PFR_SIG_BLOCK_CSK_OFFSET + PFR_SIG_BLOCK_CSK_SIZE)
+
+/**
+ * Offsets of every tag and then every curve in a block with a CSK, used to build malformed blocks.
+ */
+static const size_t pfr_sig_block_testing_magic[] = {
+	0,
+	PFR_SIG_BLOCK_BLOCK1_OFFSET,
+	PFR_SIG_BLOCK_ROOT_OFFSET,
+	PFR_SIG_BLOCK_TESTING_B0_ENTRY,
+	PFR_SIG_BLOCK_ROOT_OFFSET + 4,
+	PFR_SIG_BLOCK_CSK_OFFSET + 4,
+	PFR_SIG_BLOCK_CSK_OFFSET + PFR_SIG_BLOCK_KEY_ENTRY_SIZE,
+	PFR_SIG_BLOCK_TESTING_B0_ENTRY + 4,
+};
+
+
+/**
+ * State of the pseudo-random generator, so every run fuzzes the same blocks.
+ */
+static uint32_t pfr_sig_block_testing_seed;
+
+/**
+ * Get the next pseudo-random number.
+ */
+static uint32_t pfr_sig_block_testing_rand (void)
+{
+	pfr_sig_block_testing_seed = (pfr_sig_block_testing_seed * 1103515245) + 12345;
+
+	return pfr_sig_block_testing_seed >> 8;
+}
+
+/**
+ * Write a little endian word to the signature block.
+ */
+static void pfr_sig_block_testing_word (struct pfr_sig_block *block, size_t offset,
+	uint32_t value)
+{
+	block->data[offset] = value;
+	block->data[offset + 1] = value >> 8;
+	block->data[offset + 2] = value >> 16;
+	block->data[offset + 3] = value >> 24;
+}
+
+/**
+ * Write a public key entry with a P-384 key.
+ */
+static void pfr_sig_block_testing_key (struct pfr_sig_block *block, size_t offset, uint32_t tag,
+	uint32_t key_id)
+{
+	pfr_sig_block_testing_word (block, offset, tag);
+	pfr_sig_block_testing_word (block, offset + 4, PFR_SIG_BLOCK_PUBLIC_SECP384);
+	pfr_sig_block_testing_word (block, offset + 8, 0xffffffff);
+	pfr_sig_block_testing_word (block, offset + 12, key_id);
+	memset (&block->data[offset + 16], 0x11, PFR_SIG_BLOCK_KEY_SIZE);
+	memset (&block->data[offset + 16 + PFR_SIG_BLOCK_KEY_SIZE], 0x22, PFR_SIG_BLOCK_KEY_SIZE);
+}
+
+/**
+ * Write a P-384 signature.
+ */
+static void pfr_sig_block_testing_signature (struct pfr_sig_block *block, size_t offset)
+{
+	pfr_sig_block_testing_word (block, offset, PFR_SIG_BLOCK_SIGNATURE_SECP384);
+	memset (&block->data[offset + 4], 0x33, PFR_SIG_BLOCK_KEY_SIZE);
+	memset (&block->data[offset + 4 + PFR_SIG_BLOCK_KEY_SIZE], 0x44, PFR_SIG_BLOCK_KEY_SIZE);
+}
+
+/**
+ * Build a well formed signature block.
+ *
+ * @param block The block to build.
+ * @param csk true to add a CSK entry or false for a block signed by the root key.
+ */
+static void pfr_sig_block_testing_build (struct pfr_sig_block *block, bool csk)
+{
+	size_t entry = PFR_SIG_BLOCK_CSK_OFFSET;
+
+	memset (block, 0, sizeof (*block));
+
+	pfr_sig_block_testing_word (block, 0, PFR_SIG_BLOCK_BLOCK0_TAG);
+	pfr_sig_block_testing_word (block, 4, PFR_SIG_BLOCK_TESTING_PC_LENGTH);
+	pfr_sig_block_testing_word (block, 8, PFR_SIG_BLOCK_TESTING_PC_TYPE);
+	memset (&block->data[16], 0x55, 32);
+	memset (&block->data[48], 0x66, 48);
+
+	pfr_sig_block_testing_word (block, PFR_SIG_BLOCK_BLOCK1_OFFSET, PFR_SIG_BLOCK_BLOCK1_TAG);
+	pfr_sig_block_testing_key (block, PFR_SIG_BLOCK_ROOT_OFFSET, PFR_SIG_BLOCK_ROOT_TAG,
+		PFR_SIG_BLOCK_TESTING_ROOT_ID);
+
+	if (csk) {
+		pfr_sig_block_testing_key (block, entry, PFR_SIG_BLOCK_CSK_TAG,
+			PFR_SIG_BLOCK_TESTING_CSK_ID);
+		pfr_sig_block_testing_signature (block, entry + PFR_SIG_BLOCK_KEY_ENTRY_SIZE);
+		entry += PFR_SIG_BLOCK_CSK_SIZE;
+	}
+
+	pfr_sig_block_testing_word (block, entry, PFR_SIG_BLOCK_B0_ENTRY_TAG);
+	pfr_sig_block_testing_signature (block, entry + 4);
+}
+
+/**
+ * Check that a view of the block lies inside the raw data.
+ */
+static void pfr_sig_block_testing_check_view (CuTest *test, const struct pfr_sig_block *block,
+	const uint8_t *view, size_t length)
+{
+	CuAssertPtrNotNull (test, view);
+	CuAssertTrue (test, view >= block->data);
+	CuAssertTrue (test, (view + length) <= (block->data + sizeof (block->data)));
+}
+
+/**
+ * Check that every view set up by a successful parse lies inside the raw data.
+ */
+static void pfr_sig_block_testing_check_views (CuTest *test, const struct pfr_sig_block *block)
+{
+	pfr_sig_block_testing_check_view (test, block, block->sha256_pc, 32);
+	pfr_sig_block_testing_check_view (test, block, block->sha384_pc, 48);
+	pfr_sig_block_testing_check_view (test, block, block->root.x, PFR_SIG_BLOCK_KEY_SIZE);
+	pfr_sig_block_testing_check_view (test, block, block->root.y, PFR_SIG_BLOCK_KEY_SIZE);
+	pfr_sig_block_testing_check_view (test, block, block->block0_signature.r,
+		PFR_SIG_BLOCK_KEY_SIZE);
+	pfr_sig_block_testing_check_view (test, block, block->block0_signature.s,
+		PFR_SIG_BLOCK_KEY_SIZE);
+
+	if (block->has_csk) {
+		pfr_sig_block_testing_check_view (test, block, block->csk.x, PFR_SIG_BLOCK_KEY_SIZE);
+		pfr_sig_block_testing_check_view (test, block, block->csk.y, PFR_SIG_BLOCK_KEY_SIZE);
+		pfr_sig_block_testing_check_view (test, block, block->csk_signature.r,
+			PFR_SIG_BLOCK_KEY_SIZE);
+		pfr_sig_block_testing_check_view (test, block, block->csk_signature.s,
+			PFR_SIG_BLOCK_KEY_SIZE);
+		pfr_sig_block_testing_check_view (test, block, block->csk_signed,
+			PFR_SIG_BLOCK_CSK_SIGNED_SIZE);
+	}
+}
+
+/**
+ * Parse a block from a heap buffer of the exact size, so any read past the block is caught by the
+ * address sanitizer.
+ */
+static int pfr_sig_block_testing_parse (CuTest *test, const struct pfr_sig_block *block)
+{
+	struct pfr_sig_block *copy;
+	int status;
+
+	copy = platform_malloc (sizeof (*copy));
+	CuAssertPtrNotNull (test, copy);
+
+	memcpy (copy, block, sizeof (*copy));
+
+	status = pfr_sig_block_parse (copy);
+	if (status == 0)
+		pfr_sig_block_testing_check_views (test, copy);
+	else
+		CuAssertIntEquals (test, false, copy->has_csk);
+
+	platform_free (copy);
+
+	return status;
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_sig_block_test_parse_with_csk (CuTest *test)
+{
+	struct pfr_sig_block block;
+	int status;
+
+	TEST_START;
+
+	pfr_sig_block_testing_build (&block, true);
+
+	status = pfr_sig_block_parse (&block);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_TESTING_PC_LENGTH, block.pc_length);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_TESTING_PC_TYPE, block.pc_type);
+	CuAssertPtrEquals (test, &block.data[16], (void*) block.sha256_pc);
+	CuAssertPtrEquals (test, &block.data[48], (void*) block.sha384_pc);
+
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_CURVE_SECP384, block.root.curve);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_TESTING_ROOT_ID, block.root.key_id);
+	CuAssertPtrEquals (test, &block.data[PFR_SIG_BLOCK_ROOT_OFFSET + 16], (void*) block.root.x);
+	CuAssertPtrEquals (test, &block.data[PFR_SIG_BLOCK_ROOT_OFFSET + 64], (void*) block.root.y);
+
+	CuAssertIntEquals (test, true, block.has_csk);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_CURVE_SECP384, block.csk.curve);
+	CuAssertIntEquals (test, 0xffffffff, block.csk.permissions);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_TESTING_CSK_ID, block.csk.key_id);
+	CuAssertPtrEquals (test, &block.data[PFR_SIG_BLOCK_CSK_OFFSET + 16], (void*) block.csk.x);
+	CuAssertPtrEquals (test, &block.data[PFR_SIG_BLOCK_CSK_OFFSET + 4], (void*) block.csk_signed);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_CURVE_SECP384, block.csk_signature.curve);
+	CuAssertPtrEquals (test, &block.data[PFR_SIG_BLOCK_CSK_OFFSET + 136],
+		(void*) block.csk_signature.r);
+	CuAssertPtrEquals (test, &block.data[PFR_SIG_BLOCK_CSK_OFFSET + 184],
+		(void*) block.csk_signature.s);
+
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_CURVE_SECP384, block.block0_signature.curve);
+	CuAssertPtrEquals (test, &block.data[PFR_SIG_BLOCK_TESTING_B0_ENTRY + 8],
+		(void*) block.block0_signature.r);
+	CuAssertPtrEquals (test, &block.data[PFR_SIG_BLOCK_TESTING_B0_ENTRY + 56],
+		(void*) block.block0_signature.s);
+}
+
+static void pfr_sig_block_test_parse_without_csk (CuTest *test)
+{
+	struct pfr_sig_block block;
+	int status;
+
+	TEST_START;
+
+	pfr_sig_block_testing_build (&block, false);
+
+	status = pfr_sig_block_parse (&block);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, false, block.has_csk);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_CURVE_SECP384, block.block0_signature.curve);
+	CuAssertPtrEquals (test, &block.data[PFR_SIG_BLOCK_CSK_OFFSET + 8],
+		(void*) block.block0_signature.r);
+}
+
+static void pfr_sig_block_test_parse_secp256 (CuTest *test)
+{
+	struct pfr_sig_block block;
+	int status;
+
+	TEST_START;
+
+	pfr_sig_block_testing_build (&block, true);
+	pfr_sig_block_testing_word (&block, PFR_SIG_BLOCK_ROOT_OFFSET + 4,
+		PFR_SIG_BLOCK_PUBLIC_SECP256);
+	pfr_sig_block_testing_word (&block, PFR_SIG_BLOCK_CSK_OFFSET + 4,
+		PFR_SIG_BLOCK_PUBLIC_SECP256);
+	pfr_sig_block_testing_word (&block, PFR_SIG_BLOCK_CSK_OFFSET + PFR_SIG_BLOCK_KEY_ENTRY_SIZE,
+		PFR_SIG_BLOCK_SIGNATURE_SECP256);
+	pfr_sig_block_testing_word (&block, PFR_SIG_BLOCK_TESTING_B0_ENTRY + 4,
+		PFR_SIG_BLOCK_SIGNATURE_SECP256);
+
+	status = pfr_sig_block_parse (&block);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_CURVE_SECP256, block.root.curve);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_CURVE_SECP256, block.csk.curve);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_CURVE_SECP256, block.csk_signature.curve);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_CURVE_SECP256, block.block0_signature.curve);
+}
+
+static void pfr_sig_block_test_parse_null (CuTest *test)
+{
+	int status;
+
+	TEST_START;
+
+	status = pfr_sig_block_parse (NULL);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_INVALID_ARGUMENT, status);
+}
+
+static void pfr_sig_block_test_parse_bad_tag (CuTest *test)
+{
+	struct pfr_sig_block block;
+	int status;
+
+	TEST_START;
+
+	pfr_sig_block_testing_build (&block, true);
+	block.data[0] ^= 1;
+	status = pfr_sig_block_parse (&block);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_BAD_TAG, status);
+
+	pfr_sig_block_testing_build (&block, true);
+	block.data[PFR_SIG_BLOCK_BLOCK1_OFFSET] ^= 1;
+	status = pfr_sig_block_parse (&block);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_BAD_TAG, status);
+
+	pfr_sig_block_testing_build (&block, true);
+	block.data[PFR_SIG_BLOCK_ROOT_OFFSET] ^= 1;
+	status = pfr_sig_block_parse (&block);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_BAD_TAG, status);
+
+	pfr_sig_block_testing_build (&block, true);
+	block.data[PFR_SIG_BLOCK_TESTING_B0_ENTRY] ^= 1;
+	status = pfr_sig_block_parse (&block);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_BAD_TAG, status);
+	CuAssertIntEquals (test, false, block.has_csk);
+
+	pfr_sig_block_testing_build (&block, false);
+	block.data[PFR_SIG_BLOCK_CSK_OFFSET] ^= 1;
+	status = pfr_sig_block_parse (&block);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_BAD_TAG, status);
+}
+
+static void pfr_sig_block_test_parse_bad_csk_tag (CuTest *test)
+{
+	struct pfr_sig_block block;
+	int status;
+
+	TEST_START;
+
+	/* Without the CSK tag, the CSK entry is taken for a Block0 entry and rejected. */
+	pfr_sig_block_testing_build (&block, true);
+	block.data[PFR_SIG_BLOCK_CSK_OFFSET] ^= 1;
+
+	status = pfr_sig_block_parse (&block);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_BAD_TAG, status);
+	CuAssertIntEquals (test, false, block.has_csk);
+}
+
+static void pfr_sig_block_test_parse_bad_curve (CuTest *test)
+{
+	struct pfr_sig_block block;
+	size_t i;
+	int status;
+
+	TEST_START;
+
+	/* The first four offsets are tags. */
+	for (i = 4; i < PFR_SIG_BLOCK_TESTING_COUNT (pfr_sig_block_testing_magic); i++) {
+		pfr_sig_block_testing_build (&block, true);
+		block.data[pfr_sig_block_testing_magic[i]] ^= 1;
+
+		status = pfr_sig_block_parse (&block);
+		CuAssertIntEquals (test, PFR_SIG_BLOCK_BAD_CURVE, status);
+		CuAssertIntEquals (test, false, block.has_csk);
+	}
+}
+
+static void pfr_sig_block_test_parse_clears_csk (CuTest *test)
+{
+	struct pfr_sig_block block;
+	int status;
+
+	TEST_START;
+
+	pfr_sig_block_testing_build (&block, true);
+
+	status = pfr_sig_block_parse (&block);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, true, block.has_csk);
+
+	/* A block parsed into the same buffer must not keep the CSK of the previous one. */
+	block.data[PFR_SIG_BLOCK_TESTING_B0_ENTRY + 4] ^= 1;
+
+	status = pfr_sig_block_parse (&block);
+	CuAssertIntEquals (test, PFR_SIG_BLOCK_BAD_CURVE, status);
+	CuAssertIntEquals (test, false, block.has_csk);
+}
+
+static void pfr_sig_block_test_fuzz_random (CuTest *test)
+{
+	struct pfr_sig_block block;
+	int i;
+	size_t j;
+	int status;
+
+	TEST_START;
+
+	pfr_sig_block_testing_seed = 1;
+
+	for (i = 0; i < PFR_SIG_BLOCK_TESTING_FUZZ_COUNT; i++) {
+		for (j = 0; j < sizeof (block.data); j++)
+			block.data[j] = pfr_sig_block_testing_rand ();
+
+		status = pfr_sig_block_testing_parse (test, &block);
+		CuAssertIntEquals (test, PFR_SIG_BLOCK_BAD_TAG, status);
+	}
+}
+
+static void pfr_sig_block_test_fuzz_mutate (CuTest *test)
+{
+	struct pfr_sig_block block;
+	uint32_t offset;
+	int passed = 0;
+	int i;
+	int j;
+	int status;
+
+	TEST_START;
+
+	pfr_sig_block_testing_seed = 2;
+
+	for (i = 0; i < PFR_SIG_BLOCK_TESTING_FUZZ_COUNT; i++) {
+		pfr_sig_block_testing_build (&block, pfr_sig_block_testing_rand () & 1);
+
+		/* Change a few random bytes, favoring the tags and curves where the parser branches. */
+		for (j = (pfr_sig_block_testing_rand () % 4) + 1; j > 0; j--) {
+			if (pfr_sig_block_testing_rand () & 1) {
+				offset = pfr_sig_block_testing_magic[pfr_sig_block_testing_rand () %
+					PFR_SIG_BLOCK_TESTING_COUNT (pfr_sig_block_testing_magic)];
+				offset += pfr_sig_block_testing_rand () % 4;
+			}
+			else {
+				offset = pfr_sig_block_testing_rand () % sizeof (block.data);
+			}
+
+			block.data[offset] = pfr_sig_block_testing_rand ();
+		}
+
+		status = pfr_sig_block_testing_parse (test, &block);
+		if (status == 0)
+			passed++;
+		else
+			CuAssertTrue (test, (status == PFR_SIG_BLOCK_BAD_TAG) ||
+				(status == PFR_SIG_BLOCK_BAD_CURVE));
+	}
+
+	/* Changes outside of the structure still parse, so both paths are covered. */
+	CuAssertTrue (test, passed > 0);
+	CuAssertTrue (test, passed < PFR_SIG_BLOCK_TESTING_FUZZ_COUNT);
+}
+
+static void pfr_sig_block_test_fuzz_tags (CuTest *test)
+{
+	static const uint32_t tags[] = {
+		PFR_SIG_BLOCK_BLOCK0_TAG,
+		PFR_SIG_BLOCK_BLOCK1_TAG,
+		PFR_SIG_BLOCK_ROOT_TAG,
+		PFR_SIG_BLOCK_CSK_TAG,
+		PFR_SIG_BLOCK_B0_ENTRY_TAG,
+		PFR_SIG_BLOCK_PUBLIC_SECP256,
+		PFR_SIG_BLOCK_PUBLIC_SECP384,
+		PFR_SIG_BLOCK_SIGNATURE_SECP256,
+		PFR_SIG_BLOCK_SIGNATURE_SECP384,
+	};
+	struct pfr_sig_block block;
+	int i;
+	size_t j;
+	uint32_t offset;
+
+	TEST_START;
+
+	pfr_sig_block_testing_seed = 3;
+
+	/* Random data with valid magic numbers sprinkled at random word offsets. */
+	for (i = 0; i < PFR_SIG_BLOCK_TESTING_FUZZ_COUNT; i++) {
+		for (j = 0; j < sizeof (block.data); j++)
+			block.data[j] = pfr_sig_block_testing_rand ();
+
+		for (j = 0; j < 64; j++) {
+			offset = (pfr_sig_block_testing_rand () % (sizeof (block.data) / 4)) * 4;
+			pfr_sig_block_testing_word (&block, offset,
+				tags[pfr_sig_block_testing_rand () % PFR_SIG_BLOCK_TESTING_COUNT (tags)]);
+		}
+
+		pfr_sig_block_testing_parse (test, &block);
+	}
+}
+
+
+CuSuite* get_pfr_sig_block_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_sig_block_test_parse_with_csk);
+	SUITE_ADD_TEST (suite, pfr_sig_block_test_parse_without_csk);
+	SUITE_ADD_TEST (suite, pfr_sig_block_test_parse_secp256);
+	SUITE_ADD_TEST (suite, pfr_sig_block_test_parse_null);
+	SUITE_ADD_TEST (suite, pfr_sig_block_test_parse_bad_tag);
+	SUITE_ADD_TEST (suite, pfr_sig_block_test_parse_bad_csk_tag);
+	SUITE_ADD_TEST (suite, pfr_sig_block_test_parse_bad_curve);
+	SUITE_ADD_TEST (suite, pfr_sig_block_test_parse_clears_csk);
+	SUITE_ADD_TEST (suite, pfr_sig_block_test_fuzz_random);
+	SUITE_ADD_TEST (suite, pfr_sig_block_test_fuzz_mutate);
+	SUITE_ADD_TEST (suite, pfr_sig_block_test_fuzz_tags);
+
+	return suite;
+}
@@ -0,0 +1,441 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "testing.h"
+#include "emulated_flash.h"
+#include "pfr_spi_copy.h"
+
+
+static const char *SUITE = "pfr_spi_copy";
+
+
+/**
+ * Size of each emulated flash device.
+ */
+#define	PFR_SPI_COPY_TESTING_FLASH_SIZE		0x80000
+
+/**
+ * Size of the copy buffer.
+ */
+#define	PFR_SPI_COPY_TESTING_BUFFER_SIZE	0x8000
+
+/**
+ * Error returned by the flash when an injected fault hits.
+ */
+#define	PFR_SPI_COPY_TESTING_FLASH_ERROR	-20
+
+
+/**
+ * Source and destination flash devices for a copy.
+ */
+struct pfr_spi_copy_testing {
+	struct emulated_flash source;		/**< Flash to copy from. */
+	struct emulated_flash target;		/**< Flash to copy to. */
+	uint8_t buffer[PFR_SPI_COPY_TESTING_BUFFER_SIZE];	/**< Copy buffer. */
+	int write_count;					/**< Target writes before one fails, or -1. */
+	int read_count;						/**< Source reads before one fails, or -1. */
+};
+
+/**
+ * Flash handlers of the emulated devices, saved while a test injects faults.
+ */
+static int (*pfr_spi_copy_testing_write) (struct flash*, uint32_t, const uint8_t*, size_t);
+static int (*pfr_spi_copy_testing_read) (struct flash*, uint32_t, uint8_t*, size_t);
+
+/**
+ * The active test context, for the fault injection handlers.
+ */
+static struct pfr_spi_copy_testing *pfr_spi_copy_testing_active;
+
+static int pfr_spi_copy_testing_failing_write (struct flash *flash, uint32_t address,
+	const uint8_t *data, size_t length)
+{
+	struct pfr_spi_copy_testing *testing = pfr_spi_copy_testing_active;
+
+	if (testing->write_count == 0) {
+		return PFR_SPI_COPY_TESTING_FLASH_ERROR;
+	}
+
+	if (testing->write_count > 0) {
+		testing->write_count--;
+	}
+
+	return pfr_spi_copy_testing_write (flash, address, data, length);
+}
+
+static int pfr_spi_copy_testing_short_write (struct flash *flash, uint32_t address,
+	const uint8_t *data, size_t length)
+{
+	return pfr_spi_copy_testing_write (flash, address, data, length - 1);
+}
+
+static int pfr_spi_copy_testing_failing_read (struct flash *flash, uint32_t address, uint8_t *data,
+	size_t length)
+{
+	struct pfr_spi_copy_testing *testing = pfr_spi_copy_testing_active;
+
+	if (testing->read_count == 0) {
+		return PFR_SPI_COPY_TESTING_FLASH_ERROR;
+	}
+
+	if (testing->read_count > 0) {
+		testing->read_count--;
+	}
+
+	return pfr_spi_copy_testing_read (flash, address, data, length);
+}
+
+/**
+ * Create a source filled with a pattern and a destination holding different data, so any byte
+ * that is not erased and programmed is caught.
+ */
+static void pfr_spi_copy_testing_init (CuTest *test, struct pfr_spi_copy_testing *testing)
+{
+	int status;
+
+	status = emulated_flash_init (&testing->source, PFR_SPI_COPY_TESTING_FLASH_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = emulated_flash_init (&testing->target, PFR_SPI_COPY_TESTING_FLASH_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_fill_pattern (&testing->source, 0x53524320);
+	emulated_flash_fill_pattern (&testing->target, 0x44535420);
+
+	testing->write_count = -1;
+	testing->read_count = -1;
+
+	pfr_spi_copy_testing_active = testing;
+	pfr_spi_copy_testing_write = testing->target.base.write;
+	pfr_spi_copy_testing_read = testing->source.base.read;
+	testing->target.base.write = pfr_spi_copy_testing_failing_write;
+	testing->source.base.read = pfr_spi_copy_testing_failing_read;
+}
+
+static void pfr_spi_copy_testing_release (struct pfr_spi_copy_testing *testing)
+{
+	emulated_flash_release (&testing->source);
+	emulated_flash_release (&testing->target);
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_spi_copy_test_copy (CuTest *test)
+{
+	struct pfr_spi_copy_testing testing;
+	uint8_t before[0x1000];
+	uint8_t after[0x1000];
+	int status;
+
+	TEST_START;
+
+	pfr_spi_copy_testing_init (test, &testing);
+
+	memcpy (before, &testing.target.data[0x10000 - sizeof (before)], sizeof (before));
+	memcpy (after, &testing.target.data[0x50000], sizeof (after));
+
+	status = pfr_spi_copy (&testing.source.base, 0x21000, &testing.target.base, 0x10000, 0x40000,
+		PFR_SPI_COPY_ERASE_4K | PFR_SPI_COPY_ERASE_64K, testing.buffer, sizeof (testing.buffer));
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing_validate_array (&testing.source.data[0x21000], &testing.target.data[0x10000],
+		0x40000);
+	CuAssertIntEquals (test, 0, status);
+
+	/* Nothing outside the destination is touched. */
+	status = testing_validate_array (before, &testing.target.data[0x10000 - sizeof (before)],
+		sizeof (before));
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing_validate_array (after, &testing.target.data[0x50000], sizeof (after));
+	CuAssertIntEquals (test, 0, status);
+
+	/* One read and one write per buffer and one erase per block. */
+	CuAssertIntEquals (test, 8, testing.source.reads);
+	CuAssertIntEquals (test, 8, testing.target.writes);
+	CuAssertIntEquals (test, 4, testing.target.block_erases);
+	CuAssertIntEquals (test, 0, testing.target.sector_erases);
+	CuAssertIntEquals (test, 0, testing.source.writes);
+	CuAssertIntEquals (test, 0, testing.source.sector_erases + testing.source.block_erases);
+
+	pfr_spi_copy_testing_release (&testing);
+}
+
+static void pfr_spi_copy_test_unaligned_blocks (CuTest *test)
+{
+	struct pfr_spi_copy_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_copy_testing_init (test, &testing);
+
+	/* Sectors up to the first block boundary, one whole block, then sectors to the end. */
+	status = pfr_spi_copy (&testing.source.base, 0, &testing.target.base, 0x3000, 0x20000,
+		PFR_SPI_COPY_ERASE_4K | PFR_SPI_COPY_ERASE_64K, testing.buffer, sizeof (testing.buffer));
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing_validate_array (testing.source.data, &testing.target.data[0x3000], 0x20000);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 1, testing.target.block_erases);
+	CuAssertIntEquals (test, 13 + 3, testing.target.sector_erases);
+
+	pfr_spi_copy_testing_release (&testing);
+}
+
+static void pfr_spi_copy_test_sector_erase_only (CuTest *test)
+{
+	struct pfr_spi_copy_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_copy_testing_init (test, &testing);
+
+	status = pfr_spi_copy (&testing.source.base, 0x1000, &testing.target.base, 0x20000, 0x20000,
+		PFR_SPI_COPY_ERASE_4K, testing.buffer, sizeof (testing.buffer));
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing_validate_array (&testing.source.data[0x1000], &testing.target.data[0x20000],
+		0x20000);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 0, testing.target.block_erases);
+	CuAssertIntEquals (test, 32, testing.target.sector_erases);
+
+	pfr_spi_copy_testing_release (&testing);
+}
+
+static void pfr_spi_copy_test_partial_buffer (CuTest *test)
+{
+	struct pfr_spi_copy_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_copy_testing_init (test, &testing);
+
+	/* Only whole sectors of the buffer are used and the last chunk is short. */
+	status = pfr_spi_copy (&testing.source.base, 0x123, &testing.target.base, 0x4000, 0x5000,
+		PFR_SPI_COPY_ERASE_4K, testing.buffer, 0x2fff);
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing_validate_array (&testing.source.data[0x123], &testing.target.data[0x4000],
+		0x5000);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 3, testing.source.reads);
+	CuAssertIntEquals (test, 0x5000, testing.source.bytes_read);
+	CuAssertIntEquals (test, 3, testing.target.writes);
+
+	pfr_spi_copy_testing_release (&testing);
+}
+
+static void pfr_spi_copy_test_same_device (CuTest *test)
+{
+	struct pfr_spi_copy_testing testing;
+	uint8_t expected[0x30000];
+	int status;
+
+	TEST_START;
+
+	pfr_spi_copy_testing_init (test, &testing);
+	testing.target.base.write = pfr_spi_copy_testing_write;
+
+	memcpy (expected, testing.target.data, sizeof (expected));
+
+	status = pfr_spi_copy (&testing.target.base, 0, &testing.target.base, 0x40000,
+		sizeof (expected), PFR_SPI_COPY_ERASE_4K | PFR_SPI_COPY_ERASE_64K, testing.buffer,
+		sizeof (testing.buffer));
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing_validate_array (expected, testing.target.data, sizeof (expected));
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing_validate_array (expected, &testing.target.data[0x40000], sizeof (expected));
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_spi_copy_testing_release (&testing);
+}
+
+static void pfr_spi_copy_test_zero_length (CuTest *test)
+{
+	struct pfr_spi_copy_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_copy_testing_init (test, &testing);
+
+	status = pfr_spi_copy (&testing.source.base, 0, &testing.target.base, 0, 0,
+		PFR_SPI_COPY_ERASE_4K, testing.buffer, sizeof (testing.buffer));
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 0, testing.source.reads);
+	CuAssertIntEquals (test, 0, testing.target.writes);
+	CuAssertIntEquals (test, 0, testing.target.sector_erases + testing.target.block_erases);
+
+	pfr_spi_copy_testing_release (&testing);
+}
+
+static void pfr_spi_copy_test_write_error (CuTest *test)
+{
+	struct pfr_spi_copy_testing testing;
+	uint8_t expected[0x10000];
+	int status;
+
+	TEST_START;
+
+	pfr_spi_copy_testing_init (test, &testing);
+
+	memcpy (expected, &testing.target.data[0x10000], sizeof (expected));
+
+	/* The second chunk fails.  Its block was erased with the first one, but later blocks were
+	 * not erased. */
+	testing.write_count = 1;
+	status = pfr_spi_copy (&testing.source.base, 0, &testing.target.base, 0, 0x40000,
+		PFR_SPI_COPY_ERASE_4K | PFR_SPI_COPY_ERASE_64K, testing.buffer, sizeof (testing.buffer));
+	CuAssertIntEquals (test, PFR_SPI_COPY_TESTING_FLASH_ERROR, status);
+
+	status = testing_validate_array (testing.source.data, testing.target.data,
+		sizeof (testing.buffer));
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing_validate_array (expected, &testing.target.data[0x10000], sizeof (expected));
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 1, testing.target.block_erases);
+
+	pfr_spi_copy_testing_release (&testing);
+}
+
+static void pfr_spi_copy_test_short_write (CuTest *test)
+{
+	struct pfr_spi_copy_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_copy_testing_init (test, &testing);
+	testing.target.base.write = pfr_spi_copy_testing_short_write;
+
+	status = pfr_spi_copy (&testing.source.base, 0, &testing.target.base, 0, 0x2000,
+		PFR_SPI_COPY_ERASE_4K, testing.buffer, sizeof (testing.buffer));
+	CuAssertIntEquals (test, PFR_SPI_COPY_WRITE_FAILED, status);
+
+	pfr_spi_copy_testing_release (&testing);
+}
+
+static void pfr_spi_copy_test_read_error (CuTest *test)
+{
+	struct pfr_spi_copy_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_copy_testing_init (test, &testing);
+
+	testing.read_count = 2;
+	status = pfr_spi_copy (&testing.source.base, 0, &testing.target.base, 0, 0x40000,
+		PFR_SPI_COPY_ERASE_4K | PFR_SPI_COPY_ERASE_64K, testing.buffer, sizeof (testing.buffer));
+	CuAssertIntEquals (test, PFR_SPI_COPY_TESTING_FLASH_ERROR, status);
+
+	CuAssertIntEquals (test, 2, testing.target.writes);
+
+	pfr_spi_copy_testing_release (&testing);
+}
+
+static void pfr_spi_copy_test_erase_error (CuTest *test)
+{
+	struct pfr_spi_copy_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_copy_testing_init (test, &testing);
+
+	/* The target does not reach the end of the copy. */
+	status = pfr_spi_copy (&testing.source.base, 0, &testing.target.base,
+		PFR_SPI_COPY_TESTING_FLASH_SIZE - 0x1000, 0x2000, PFR_SPI_COPY_ERASE_4K, testing.buffer,
+		sizeof (testing.buffer));
+	CuAssertTrue (test, (status != 0));
+
+	CuAssertIntEquals (test, 0, testing.target.writes);
+
+	pfr_spi_copy_testing_release (&testing);
+}
+
+static void pfr_spi_copy_test_invalid_arguments (CuTest *test)
+{
+	struct pfr_spi_copy_testing testing;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_copy_testing_init (test, &testing);
+
+	status = pfr_spi_copy (NULL, 0, &testing.target.base, 0, 0x1000, PFR_SPI_COPY_ERASE_4K,
+		testing.buffer, sizeof (testing.buffer));
+	CuAssertIntEquals (test, PFR_SPI_COPY_INVALID_ARGUMENT, status);
+
+	status = pfr_spi_copy (&testing.source.base, 0, NULL, 0, 0x1000, PFR_SPI_COPY_ERASE_4K,
+		testing.buffer, sizeof (testing.buffer));
+	CuAssertIntEquals (test, PFR_SPI_COPY_INVALID_ARGUMENT, status);
+
+	status = pfr_spi_copy (&testing.source.base, 0, &testing.target.base, 0, 0x1000,
+		PFR_SPI_COPY_ERASE_4K, NULL, sizeof (testing.buffer));
+	CuAssertIntEquals (test, PFR_SPI_COPY_INVALID_ARGUMENT, status);
+
+	status = pfr_spi_copy (&testing.source.base, 0, &testing.target.base, 0, 0x1000,
+		PFR_SPI_COPY_ERASE_4K, testing.buffer, PFR_SPI_COPY_SECTOR_SIZE - 1);
+	CuAssertIntEquals (test, PFR_SPI_COPY_INVALID_ARGUMENT, status);
+
+	status = pfr_spi_copy (&testing.source.base, 0, &testing.target.base, 0x800, 0x1000,
+		PFR_SPI_COPY_ERASE_4K, testing.buffer, sizeof (testing.buffer));
+	CuAssertIntEquals (test, PFR_SPI_COPY_INVALID_ARGUMENT, status);
+
+	status = pfr_spi_copy (&testing.source.base, 0, &testing.target.base, 0, 0x1800,
+		PFR_SPI_COPY_ERASE_4K, testing.buffer, sizeof (testing.buffer));
+	CuAssertIntEquals (test, PFR_SPI_COPY_INVALID_ARGUMENT, status);
+
+	status = pfr_spi_copy (&testing.source.base, 0, &testing.target.base, 0xfffff000, 0x2000,
+		PFR_SPI_COPY_ERASE_4K, testing.buffer, sizeof (testing.buffer));
+	CuAssertIntEquals (test, PFR_SPI_COPY_INVALID_ARGUMENT, status);
+
+	CuAssertIntEquals (test, 0, testing.source.reads);
+	CuAssertIntEquals (test, 0, testing.target.writes);
+	CuAssertIntEquals (test, 0, testing.target.sector_erases + testing.target.block_erases);
+
+	pfr_spi_copy_testing_release (&testing);
+}
+
+
+CuSuite* get_pfr_spi_copy_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_spi_copy_test_copy);
+	SUITE_ADD_TEST (suite, pfr_spi_copy_test_unaligned_blocks);
+	SUITE_ADD_TEST (suite, pfr_spi_copy_test_sector_erase_only);
+	SUITE_ADD_TEST (suite, pfr_spi_copy_test_partial_buffer);
+	SUITE_ADD_TEST (suite, pfr_spi_copy_test_same_device);
+	SUITE_ADD_TEST (suite, pfr_spi_copy_test_zero_length);
+	SUITE_ADD_TEST (suite, pfr_spi_copy_test_write_error);
+	SUITE_ADD_TEST (suite, pfr_spi_copy_test_short_write);
+	SUITE_ADD_TEST (suite, pfr_spi_copy_test_read_error);
+	SUITE_ADD_TEST (suite, pfr_spi_copy_test_erase_error);
+	SUITE_ADD_TEST (suite, pfr_spi_copy_test_invalid_arguments);
+
+	return suite;
+}
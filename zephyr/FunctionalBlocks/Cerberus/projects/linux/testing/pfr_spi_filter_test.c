@@ -0,0 +1,617 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "testing.h"
+#include "pfr_spi_filter.h"
+
+
+static const char *SUITE = "pfr_spi_filter";
+
+
+/**
+ * Error returned by the register model for a locked table or an injected fault.
+ */
+#define	PFR_SPI_FILTER_TESTING_REG_ERROR		-20
+
+/**
+ * Register that ignores writes when a test models a stuck bit.
+ */
+#define	PFR_SPI_FILTER_TESTING_STUCK_REG		100
+
+
+/**
+ * Model of the address privilege tables of a SPI monitor.
+ */
+struct pfr_spi_filter_testing {
+	struct pfr_spi_filter_regs base;	/**< Register access API. */
+	uint32_t table[PFR_SPI_FILTER_TABLES][PFR_SPI_FILTER_TABLE_REGS];	/**< Register values. */
+	bool locked[PFR_SPI_FILTER_TABLES];	/**< Writes to the table are refused. */
+	bool stuck;							/**< Writes to one register are ignored. */
+	bool read_fails;					/**< Reads return an error. */
+	int reads;							/**< Number of read accesses. */
+	int writes;							/**< Number of write accesses. */
+	int regs_written;					/**< Number of registers written. */
+};
+
+
+static int pfr_spi_filter_testing_read (struct pfr_spi_filter_regs *regs, int table,
+	uint32_t first, uint32_t *values, size_t count)
+{
+	struct pfr_spi_filter_testing *testing = (struct pfr_spi_filter_testing*) regs;
+
+	if (testing->read_fails) {
+		return PFR_SPI_FILTER_TESTING_REG_ERROR;
+	}
+
+	if ((table >= PFR_SPI_FILTER_TABLES) || ((first + count) > PFR_SPI_FILTER_TABLE_REGS)) {
+		return PFR_SPI_FILTER_TESTING_REG_ERROR;
+	}
+
+	memcpy (values, &testing->table[table][first], count * sizeof (uint32_t));
+	testing->reads++;
+
+	return 0;
+}
+
+static int pfr_spi_filter_testing_write (struct pfr_spi_filter_regs *regs, int table,
+	uint32_t first, const uint32_t *values, size_t count)
+{
+	struct pfr_spi_filter_testing *testing = (struct pfr_spi_filter_testing*) regs;
+	size_t i;
+
+	if ((table >= PFR_SPI_FILTER_TABLES) || ((first + count) > PFR_SPI_FILTER_TABLE_REGS) ||
+		testing->locked[table]) {
+		return PFR_SPI_FILTER_TESTING_REG_ERROR;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!testing->stuck || ((first + i) != PFR_SPI_FILTER_TESTING_STUCK_REG)) {
+			testing->table[table][first + i] = values[i];
+		}
+	}
+
+	testing->writes++;
+	testing->regs_written += count;
+
+	return 0;
+}
+
+/**
+ * Set up a monitor in its state after the driver initializes it: every address readable and the
+ * first 128MB write protected.
+ *
+ * @param testing The monitor to initialize.
+ */
+static void pfr_spi_filter_testing_init (struct pfr_spi_filter_testing *testing)
+{
+	memset (testing, 0, sizeof (*testing));
+
+	testing->base.read = pfr_spi_filter_testing_read;
+	testing->base.write = pfr_spi_filter_testing_write;
+
+	memset (testing->table[PFR_SPI_FILTER_READ_TABLE], 0xff,
+		sizeof (testing->table[PFR_SPI_FILTER_READ_TABLE]));
+	memset (&testing->table[PFR_SPI_FILTER_WRITE_TABLE][PFR_SPI_FILTER_TABLE_REGS / 2], 0xff,
+		sizeof (testing->table[PFR_SPI_FILTER_WRITE_TABLE]) / 2);
+}
+
+/**
+ * Reset the access counters of the monitor.
+ *
+ * @param testing The monitor to update.
+ */
+static void pfr_spi_filter_testing_reset_counters (struct pfr_spi_filter_testing *testing)
+{
+	testing->reads = 0;
+	testing->writes = 0;
+	testing->regs_written = 0;
+}
+
+/**
+ * Check if a 16kB block allows an access.
+ *
+ * @param table The privilege table.
+ * @param address An address in the block.
+ *
+ * @return true if the access is allowed.
+ */
+static bool pfr_spi_filter_testing_allowed (const uint32_t *table, uint32_t address)
+{
+	uint32_t block = address / PFR_SPI_FILTER_BLOCK_SIZE;
+
+	return (table[block / 32] & (1U << (block % 32))) != 0;
+}
+
+/**
+ * Count the separate runs of allowed blocks in a privilege table.
+ *
+ * @param table The privilege table.
+ *
+ * @return The number of runs.
+ */
+static int pfr_spi_filter_testing_count_runs (const uint32_t *table)
+{
+	uint32_t block;
+	bool in_run = false;
+	bool allowed;
+	int runs = 0;
+
+	for (block = 0; block < (PFR_SPI_FILTER_TABLE_REGS * 32); block++) {
+		allowed = (table[block / 32] & (1U << (block % 32))) != 0;
+		if (allowed && !in_run) {
+			runs++;
+		}
+		in_run = allowed;
+	}
+
+	return runs;
+}
+
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_spi_filter_test_tables_init (CuTest *test)
+{
+	struct pfr_spi_filter_tables tables;
+	int i;
+
+	TEST_START;
+
+	memset (&tables, 0x55, sizeof (tables));
+
+	pfr_spi_filter_tables_init (&tables);
+
+	for (i = 0; i < PFR_SPI_FILTER_TABLE_REGS; i++) {
+		CuAssertIntEquals (test, 0xffffffff, tables.table[PFR_SPI_FILTER_READ_TABLE][i]);
+		CuAssertIntEquals (test, 0, tables.table[PFR_SPI_FILTER_WRITE_TABLE][i]);
+	}
+}
+
+static void pfr_spi_filter_test_tables_init_null (CuTest *test)
+{
+	TEST_START;
+
+	pfr_spi_filter_tables_init (NULL);
+}
+
+static void pfr_spi_filter_test_add_region_writable (CuTest *test)
+{
+	struct pfr_spi_filter_tables tables;
+	uint32_t *write;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_tables_init (&tables);
+	write = tables.table[PFR_SPI_FILTER_WRITE_TABLE];
+
+	status = pfr_spi_filter_tables_add_region (&tables, 0x10000, 0x20000, true, true);
+	CuAssertIntEquals (test, 0, status);
+
+	/* 64kB at 64kB is blocks 4 to 7 of the first register. */
+	CuAssertIntEquals (test, 0x000000f0, write[0]);
+	CuAssertIntEquals (test, 0, write[1]);
+	CuAssertIntEquals (test, 1, pfr_spi_filter_testing_count_runs (write));
+	CuAssertIntEquals (test, 0xffffffff, tables.table[PFR_SPI_FILTER_READ_TABLE][0]);
+	CuAssertIntEquals (test, 1,
+		pfr_spi_filter_testing_count_runs (tables.table[PFR_SPI_FILTER_READ_TABLE]));
+}
+
+static void pfr_spi_filter_test_add_region_whole_registers (CuTest *test)
+{
+	struct pfr_spi_filter_tables tables;
+	uint32_t *write;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_tables_init (&tables);
+	write = tables.table[PFR_SPI_FILTER_WRITE_TABLE];
+
+	/* 512kB per register: from the middle of register 1 to the middle of register 4. */
+	status = pfr_spi_filter_tables_add_region (&tables, 0xc0000, 0x240000, true, true);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 0, write[0]);
+	CuAssertIntEquals (test, 0xffff0000, write[1]);
+	CuAssertIntEquals (test, 0xffffffff, write[2]);
+	CuAssertIntEquals (test, 0xffffffff, write[3]);
+	CuAssertIntEquals (test, 0x0000ffff, write[4]);
+	CuAssertIntEquals (test, 0, write[5]);
+}
+
+static void pfr_spi_filter_test_add_region_unaligned (CuTest *test)
+{
+	struct pfr_spi_filter_tables tables;
+	uint32_t *write;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_tables_init (&tables);
+	write = tables.table[PFR_SPI_FILTER_WRITE_TABLE];
+
+	/* A 4kB region in the middle of the second block widens to that whole block. */
+	status = pfr_spi_filter_tables_add_region (&tables, 0x5000, 0x6000, true, true);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0x00000002, write[0]);
+
+	/* Crossing into the next block covers both. */
+	status = pfr_spi_filter_tables_add_region (&tables, 0x1f000, 0x21000, true, true);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0x00000182, write[0]);
+}
+
+static void pfr_spi_filter_test_add_region_merge_adjacent (CuTest *test)
+{
+	struct pfr_spi_filter_tables tables;
+	uint32_t *write;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_tables_init (&tables);
+	write = tables.table[PFR_SPI_FILTER_WRITE_TABLE];
+
+	status = pfr_spi_filter_tables_add_region (&tables, 0x100000, 0x180000, true, true);
+	status |= pfr_spi_filter_tables_add_region (&tables, 0x180000, 0x200000, true, true);
+	status |= pfr_spi_filter_tables_add_region (&tables, 0x400000, 0x410000, true, true);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 2, pfr_spi_filter_testing_count_runs (write));
+	CuAssertTrue (test, pfr_spi_filter_testing_allowed (write, 0x17c000));
+	CuAssertTrue (test, pfr_spi_filter_testing_allowed (write, 0x180000));
+	CuAssertTrue (test, !pfr_spi_filter_testing_allowed (write, 0x200000));
+	CuAssertTrue (test, !pfr_spi_filter_testing_allowed (write, 0xfc000));
+}
+
+static void pfr_spi_filter_test_add_region_merge_overlapping (CuTest *test)
+{
+	struct pfr_spi_filter_tables tables;
+	struct pfr_spi_filter_tables expected;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_tables_init (&tables);
+	pfr_spi_filter_tables_init (&expected);
+
+	status = pfr_spi_filter_tables_add_region (&tables, 0x300000, 0x380000, true, true);
+	status |= pfr_spi_filter_tables_add_region (&tables, 0x200000, 0x340000, true, true);
+	status |= pfr_spi_filter_tables_add_region (&tables, 0x320000, 0x330000, true, true);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_spi_filter_tables_add_region (&expected, 0x200000, 0x380000, true, true);
+	CuAssertIntEquals (test, 0, status);
+
+	status = memcmp (&expected, &tables, sizeof (tables));
+	CuAssertIntEquals (test, 0, status);
+}
+
+static void pfr_spi_filter_test_add_region_read_only (CuTest *test)
+{
+	struct pfr_spi_filter_tables tables;
+	struct pfr_spi_filter_tables expected;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_tables_init (&tables);
+	pfr_spi_filter_tables_init (&expected);
+
+	status = pfr_spi_filter_tables_add_region (&tables, 0x0, 0x800000, true, false);
+	CuAssertIntEquals (test, 0, status);
+
+	status = memcmp (&expected, &tables, sizeof (tables));
+	CuAssertIntEquals (test, 0, status);
+}
+
+static void pfr_spi_filter_test_add_region_not_readable (CuTest *test)
+{
+	struct pfr_spi_filter_tables tables;
+	uint32_t *read;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_tables_init (&tables);
+	read = tables.table[PFR_SPI_FILTER_READ_TABLE];
+
+	status = pfr_spi_filter_tables_add_region (&tables, 0x80000, 0x88000, false, false);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 0xffffffff, read[0]);
+	CuAssertIntEquals (test, 0xfffffffc, read[1]);
+	CuAssertIntEquals (test, 0xffffffff, read[2]);
+	CuAssertIntEquals (test, 0, pfr_spi_filter_testing_count_runs (
+		tables.table[PFR_SPI_FILTER_WRITE_TABLE]));
+}
+
+static void pfr_spi_filter_test_add_region_end_of_table (CuTest *test)
+{
+	struct pfr_spi_filter_tables tables;
+	uint32_t *write;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_tables_init (&tables);
+	write = tables.table[PFR_SPI_FILTER_WRITE_TABLE];
+
+	status = pfr_spi_filter_tables_add_region (&tables, PFR_SPI_FILTER_MAX_ADDRESS - 0x4000,
+		0xffffffff, true, true);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 0x80000000, write[PFR_SPI_FILTER_TABLE_REGS - 1]);
+	CuAssertIntEquals (test, 1, pfr_spi_filter_testing_count_runs (write));
+}
+
+static void pfr_spi_filter_test_add_region_invalid_arg (CuTest *test)
+{
+	struct pfr_spi_filter_tables tables;
+	struct pfr_spi_filter_tables expected;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_tables_init (&tables);
+	pfr_spi_filter_tables_init (&expected);
+
+	status = pfr_spi_filter_tables_add_region (NULL, 0x0, 0x10000, true, true);
+	CuAssertIntEquals (test, PFR_SPI_FILTER_INVALID_ARGUMENT, status);
+
+	status = pfr_spi_filter_tables_add_region (&tables, 0x10000, 0x10000, true, true);
+	CuAssertIntEquals (test, PFR_SPI_FILTER_INVALID_ARGUMENT, status);
+
+	status = pfr_spi_filter_tables_add_region (&tables, 0x20000, 0x10000, true, true);
+	CuAssertIntEquals (test, PFR_SPI_FILTER_INVALID_ARGUMENT, status);
+
+	status = pfr_spi_filter_tables_add_region (&tables, PFR_SPI_FILTER_MAX_ADDRESS,
+		PFR_SPI_FILTER_MAX_ADDRESS + 0x10000, true, true);
+	CuAssertIntEquals (test, PFR_SPI_FILTER_INVALID_ARGUMENT, status);
+
+	status = memcmp (&expected, &tables, sizeof (tables));
+	CuAssertIntEquals (test, 0, status);
+}
+
+static void pfr_spi_filter_test_program (CuTest *test)
+{
+	struct pfr_spi_filter_testing testing;
+	struct pfr_spi_filter_tables tables;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_testing_init (&testing);
+
+	pfr_spi_filter_tables_init (&tables);
+	status = pfr_spi_filter_tables_add_region (&tables, 0x1000000, 0x1080000, true, true);
+	status |= pfr_spi_filter_tables_add_region (&tables, 0x2000000, 0x2010000, false, false);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_spi_filter_program (&testing.base, &tables);
+	CuAssertIntEquals (test, 0, status);
+
+	status = memcmp (tables.table, testing.table, sizeof (testing.table));
+	CuAssertIntEquals (test, 0, status);
+
+	/* Two runs of changed registers: the RW region and the upper 128MB now write protected.
+	 * The upper half spans four chunks, so it takes a write per chunk.  One register of the read
+	 * table changes. */
+	CuAssertIntEquals (test, 1 + 4 + 1, testing.writes);
+	CuAssertIntEquals (test, 1 + (PFR_SPI_FILTER_TABLE_REGS / 2) + 1, testing.regs_written);
+
+	/* Each table is read once to compare and once to verify. */
+	CuAssertIntEquals (test, 4 * (PFR_SPI_FILTER_TABLE_REGS / PFR_SPI_FILTER_CHUNK_REGS),
+		testing.reads);
+}
+
+static void pfr_spi_filter_test_program_no_change (CuTest *test)
+{
+	struct pfr_spi_filter_testing testing;
+	struct pfr_spi_filter_tables tables;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_testing_init (&testing);
+
+	pfr_spi_filter_tables_init (&tables);
+	status = pfr_spi_filter_tables_add_region (&tables, 0x1000000, 0x1080000, true, true);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_spi_filter_program (&testing.base, &tables);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_spi_filter_testing_reset_counters (&testing);
+
+	status = pfr_spi_filter_program (&testing.base, &tables);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 0, testing.writes);
+	CuAssertIntEquals (test, 0, testing.regs_written);
+}
+
+static void pfr_spi_filter_test_program_one_region_changed (CuTest *test)
+{
+	struct pfr_spi_filter_testing testing;
+	struct pfr_spi_filter_tables tables;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_testing_init (&testing);
+
+	pfr_spi_filter_tables_init (&tables);
+	status = pfr_spi_filter_tables_add_region (&tables, 0x1000000, 0x1080000, true, true);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_spi_filter_program (&testing.base, &tables);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_spi_filter_tables_add_region (&tables, 0x1100000, 0x1104000, true, true);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_spi_filter_testing_reset_counters (&testing);
+
+	status = pfr_spi_filter_program (&testing.base, &tables);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 1, testing.writes);
+	CuAssertIntEquals (test, 1, testing.regs_written);
+	CuAssertTrue (test,
+		pfr_spi_filter_testing_allowed (testing.table[PFR_SPI_FILTER_WRITE_TABLE], 0x1100000));
+}
+
+static void pfr_spi_filter_test_program_removes_stale_region (CuTest *test)
+{
+	struct pfr_spi_filter_testing testing;
+	struct pfr_spi_filter_tables tables;
+	uint32_t *write = testing.table[PFR_SPI_FILTER_WRITE_TABLE];
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_testing_init (&testing);
+
+	pfr_spi_filter_tables_init (&tables);
+	status = pfr_spi_filter_tables_add_region (&tables, 0x1000000, 0x1080000, true, true);
+	status |= pfr_spi_filter_tables_add_region (&tables, 0x3000000, 0x3080000, true, true);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_spi_filter_program (&testing.base, &tables);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 2, pfr_spi_filter_testing_count_runs (write));
+
+	/* A new PFM without the second region. */
+	pfr_spi_filter_tables_init (&tables);
+	status = pfr_spi_filter_tables_add_region (&tables, 0x1000000, 0x1080000, true, true);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_spi_filter_program (&testing.base, &tables);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 1, pfr_spi_filter_testing_count_runs (write));
+	CuAssertTrue (test, !pfr_spi_filter_testing_allowed (write, 0x3000000));
+}
+
+static void pfr_spi_filter_test_program_null (CuTest *test)
+{
+	struct pfr_spi_filter_testing testing;
+	struct pfr_spi_filter_tables tables;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_testing_init (&testing);
+	pfr_spi_filter_tables_init (&tables);
+
+	status = pfr_spi_filter_program (NULL, &tables);
+	CuAssertIntEquals (test, PFR_SPI_FILTER_INVALID_ARGUMENT, status);
+
+	status = pfr_spi_filter_program (&testing.base, NULL);
+	CuAssertIntEquals (test, PFR_SPI_FILTER_INVALID_ARGUMENT, status);
+
+	CuAssertIntEquals (test, 0, testing.reads);
+	CuAssertIntEquals (test, 0, testing.writes);
+}
+
+static void pfr_spi_filter_test_program_locked (CuTest *test)
+{
+	struct pfr_spi_filter_testing testing;
+	struct pfr_spi_filter_tables tables;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_testing_init (&testing);
+	testing.locked[PFR_SPI_FILTER_WRITE_TABLE] = true;
+
+	pfr_spi_filter_tables_init (&tables);
+	status = pfr_spi_filter_tables_add_region (&tables, 0x1000000, 0x1080000, true, true);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_spi_filter_program (&testing.base, &tables);
+	CuAssertIntEquals (test, PFR_SPI_FILTER_TESTING_REG_ERROR, status);
+
+	CuAssertTrue (test,
+		!pfr_spi_filter_testing_allowed (testing.table[PFR_SPI_FILTER_WRITE_TABLE], 0x1000000));
+}
+
+static void pfr_spi_filter_test_program_verify_failed (CuTest *test)
+{
+	struct pfr_spi_filter_testing testing;
+	struct pfr_spi_filter_tables tables;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_testing_init (&testing);
+	testing.stuck = true;
+
+	pfr_spi_filter_tables_init (&tables);
+	status = pfr_spi_filter_tables_add_region (&tables,
+		PFR_SPI_FILTER_TESTING_STUCK_REG * 32 * PFR_SPI_FILTER_BLOCK_SIZE,
+		(PFR_SPI_FILTER_TESTING_STUCK_REG * 32 + 1) * PFR_SPI_FILTER_BLOCK_SIZE, true, true);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_spi_filter_program (&testing.base, &tables);
+	CuAssertIntEquals (test, PFR_SPI_FILTER_VERIFY_FAILED, status);
+}
+
+static void pfr_spi_filter_test_program_read_error (CuTest *test)
+{
+	struct pfr_spi_filter_testing testing;
+	struct pfr_spi_filter_tables tables;
+	int status;
+
+	TEST_START;
+
+	pfr_spi_filter_testing_init (&testing);
+	testing.read_fails = true;
+
+	pfr_spi_filter_tables_init (&tables);
+
+	status = pfr_spi_filter_program (&testing.base, &tables);
+	CuAssertIntEquals (test, PFR_SPI_FILTER_TESTING_REG_ERROR, status);
+
+	CuAssertIntEquals (test, 0, testing.writes);
+}
+
+
+CuSuite* get_pfr_spi_filter_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_tables_init);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_tables_init_null);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_add_region_writable);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_add_region_whole_registers);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_add_region_unaligned);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_add_region_merge_adjacent);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_add_region_merge_overlapping);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_add_region_read_only);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_add_region_not_readable);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_add_region_end_of_table);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_add_region_invalid_arg);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_program);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_program_no_change);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_program_one_region_changed);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_program_removes_stale_region);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_program_null);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_program_locked);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_program_verify_failed);
+	SUITE_ADD_TEST (suite, pfr_spi_filter_test_program_read_error);
+
+	return suite;
+}
@@ -0,0 +1,643 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "platform.h"
+#include "testing.h"
+#include "status/rot_status.h"
+#include "emulated_flash.h"
+#include "pfr_svn.h"
+
+
+static const char *SUITE = "pfr_svn";
+
+
+/**
+ * Size of the emulated internal flash.
+ */
+#define	PFR_SVN_TESTING_FLASH_SIZE		(64 * 1024)
+
+/**
+ * Address of the CPLD policy, the same offset it has in the provisioning UFM.
+ */
+#define	PFR_SVN_TESTING_BASE			0x84
+
+
+/**
+ * Write handler of the emulated flash, saved while a test injects write faults.
+ */
+static int (*pfr_svn_testing_write) (struct flash*, uint32_t, const uint8_t*, size_t);
+
+/**
+ * Flash write that always fails.
+ */
+static int pfr_svn_testing_failed_write (struct flash *flash, uint32_t address,
+	const uint8_t *data, size_t length)
+{
+	return FLASH_NO_MEMORY;
+}
+
+/**
+ * Flash write that loses power halfway through, so only the first half of the data is programmed.
+ */
+static int pfr_svn_testing_torn_write (struct flash *flash, uint32_t address,
+	const uint8_t *data, size_t length)
+{
+	pfr_svn_testing_write (flash, address, data, length / 2);
+
+	return FLASH_NO_MEMORY;
+}
+
+/**
+ * Set up an erased emulated flash and SVN policies that use it.
+ *
+ * @param test The test framework.
+ * @param flash The emulated flash to initialize.
+ * @param svn The policies to initialize.
+ */
+static void pfr_svn_testing_init (CuTest *test, struct emulated_flash *flash, struct pfr_svn *svn)
+{
+	int status;
+
+	status = emulated_flash_init (flash, PFR_SVN_TESTING_FLASH_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_svn_init (svn, &flash->base, PFR_SVN_TESTING_BASE);
+	CuAssertIntEquals (test, 0, status);
+
+	pfr_svn_testing_write = flash->base.write;
+}
+
+/**
+ * Check the SVN of a policy as seen by a new instance, such as after a reset.
+ *
+ * @param test The test framework.
+ * @param flash The flash that holds the policies.
+ * @param policy The policy to check.
+ *
+ * @return The SVN stored on flash.
+ */
+static uint8_t pfr_svn_testing_reload (CuTest *test, struct emulated_flash *flash, int policy)
+{
+	struct pfr_svn svn;
+	uint8_t value = 0xff;
+	int status;
+
+	status = pfr_svn_init (&svn, &flash->base, PFR_SVN_TESTING_BASE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_svn_get (&svn, policy, &value);
+	CuAssertIntEquals (test, 0, status);
+
+	return value;
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_svn_test_init (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	int status;
+
+	TEST_START;
+
+	pfr_svn_testing_init (test, &flash, &svn);
+
+	/* Nothing is read until the first access. */
+	CuAssertIntEquals (test, 0, flash.reads);
+
+	status = pfr_svn_init (NULL, &flash.base, PFR_SVN_TESTING_BASE);
+	CuAssertIntEquals (test, PFR_SVN_INVALID_ARGUMENT, status);
+
+	status = pfr_svn_init (&svn, NULL, PFR_SVN_TESTING_BASE);
+	CuAssertIntEquals (test, PFR_SVN_INVALID_ARGUMENT, status);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_svn_test_get_loads_once (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	uint8_t value;
+	int policy;
+	int i;
+	int status;
+
+	TEST_START;
+
+	pfr_svn_testing_init (test, &flash, &svn);
+
+	for (i = 0; i < 10; i++) {
+		for (policy = 0; policy < PFR_SVN_POLICIES; policy++) {
+			value = 0xff;
+			status = pfr_svn_get (&svn, policy, &value);
+			CuAssertIntEquals (test, 0, status);
+			CuAssertIntEquals (test, 0, value);
+
+			status = pfr_svn_check (&svn, policy, 0);
+			CuAssertIntEquals (test, 0, status);
+		}
+	}
+
+	/* Every policy is loaded with one read and checks are answered from RAM. */
+	CuAssertIntEquals (test, 1, flash.reads);
+	CuAssertIntEquals (test, PFR_SVN_POLICIES * PFR_SVN_BITMAP_SIZE, flash.bytes_read);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_svn_test_decode_stored_bitmap (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	uint8_t cpld[] = {0xfe, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+	uint8_t pch[] = {0x00, 0xf0, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+	uint8_t bmc[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80};
+	uint8_t value;
+	int status;
+
+	TEST_START;
+
+	pfr_svn_testing_init (test, &flash, &svn);
+
+	memcpy (&flash.data[PFR_SVN_TESTING_BASE], cpld, sizeof (cpld));
+	memcpy (&flash.data[PFR_SVN_TESTING_BASE + PFR_SVN_BITMAP_SIZE], pch, sizeof (pch));
+	memcpy (&flash.data[PFR_SVN_TESTING_BASE + (2 * PFR_SVN_BITMAP_SIZE)], bmc, sizeof (bmc));
+
+	status = pfr_svn_get (&svn, PFR_SVN_POLICY_CPLD, &value);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, value);
+
+	status = pfr_svn_get (&svn, PFR_SVN_POLICY_PCH, &value);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 12, value);
+
+	status = pfr_svn_get (&svn, PFR_SVN_POLICY_BMC, &value);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, PFR_SVN_MAX, value);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_svn_test_advance_boundaries (CuTest *test)
+{
+	const uint8_t values[] = {0, 1, 7, 8, 9, 31, 32, 62, PFR_SVN_MAX};
+	uint8_t expected[PFR_SVN_BITMAP_SIZE];
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	uint8_t value;
+	size_t i;
+	int status;
+
+	TEST_START;
+
+	for (i = 0; i < sizeof (values); i++) {
+		pfr_svn_testing_init (test, &flash, &svn);
+
+		status = pfr_svn_advance (&svn, PFR_SVN_POLICY_PCH, values[i]);
+		CuAssertIntEquals (test, 0, status);
+
+		status = pfr_svn_get (&svn, PFR_SVN_POLICY_PCH, &value);
+		CuAssertIntEquals (test, 0, status);
+		CuAssertIntEquals (test, values[i], value);
+
+		status = pfr_svn_commit (&svn);
+		CuAssertIntEquals (test, 0, status);
+
+		CuAssertIntEquals (test, values[i], pfr_svn_testing_reload (test, &flash,
+			PFR_SVN_POLICY_PCH));
+
+		/* The first n bits are cleared, least significant bit of the first byte first. */
+		memset (expected, 0xff, sizeof (expected));
+		memset (expected, 0, values[i] / 8);
+		expected[values[i] / 8] = 0xff << (values[i] % 8);
+
+		status = testing_validate_array (expected,
+			&flash.data[PFR_SVN_TESTING_BASE + PFR_SVN_BITMAP_SIZE], sizeof (expected));
+		CuAssertIntEquals (test, 0, status);
+
+		/* The other policies are untouched. */
+		CuAssertIntEquals (test, 0, pfr_svn_testing_reload (test, &flash, PFR_SVN_POLICY_CPLD));
+		CuAssertIntEquals (test, 0, pfr_svn_testing_reload (test, &flash, PFR_SVN_POLICY_BMC));
+
+		emulated_flash_release (&flash);
+	}
+}
+
+static void pfr_svn_test_advance_out_of_range (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	uint8_t value;
+	int status;
+
+	TEST_START;
+
+	pfr_svn_testing_init (test, &flash, &svn);
+
+	status = pfr_svn_check (&svn, PFR_SVN_POLICY_BMC, PFR_SVN_MAX + 1);
+	CuAssertIntEquals (test, PFR_SVN_OUT_OF_RANGE, status);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_BMC, PFR_SVN_MAX + 1);
+	CuAssertIntEquals (test, PFR_SVN_OUT_OF_RANGE, status);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_BMC, 0x100);
+	CuAssertIntEquals (test, PFR_SVN_OUT_OF_RANGE, status);
+
+	status = pfr_svn_get (&svn, PFR_SVN_POLICY_BMC, &value);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, value);
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, flash.writes);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_svn_test_bitmap_full (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	uint8_t value;
+	int status;
+
+	TEST_START;
+
+	pfr_svn_testing_init (test, &flash, &svn);
+
+	/* Every bit of the CPLD policy is cleared, which no valid SVN can match. */
+	memset (&flash.data[PFR_SVN_TESTING_BASE], 0, PFR_SVN_BITMAP_SIZE);
+
+	status = pfr_svn_get (&svn, PFR_SVN_POLICY_CPLD, &value);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, PFR_SVN_BITMAP_FULL, value);
+
+	status = pfr_svn_check (&svn, PFR_SVN_POLICY_CPLD, 0);
+	CuAssertIntEquals (test, PFR_SVN_ROLLBACK, status);
+
+	status = pfr_svn_check (&svn, PFR_SVN_POLICY_CPLD, PFR_SVN_MAX);
+	CuAssertIntEquals (test, PFR_SVN_ROLLBACK, status);
+
+	status = pfr_svn_check (&svn, PFR_SVN_POLICY_CPLD, PFR_SVN_BITMAP_FULL);
+	CuAssertIntEquals (test, PFR_SVN_OUT_OF_RANGE, status);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_CPLD, PFR_SVN_MAX);
+	CuAssertIntEquals (test, PFR_SVN_ROLLBACK, status);
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, flash.writes);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_svn_test_advance_is_monotonic (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	uint8_t value;
+	int status;
+
+	TEST_START;
+
+	pfr_svn_testing_init (test, &flash, &svn);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_BMC, 20);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, flash.writes);
+
+	status = pfr_svn_check (&svn, PFR_SVN_POLICY_BMC, 19);
+	CuAssertIntEquals (test, PFR_SVN_ROLLBACK, status);
+
+	status = pfr_svn_check (&svn, PFR_SVN_POLICY_BMC, 20);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_svn_check (&svn, PFR_SVN_POLICY_BMC, 21);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_BMC, 19);
+	CuAssertIntEquals (test, PFR_SVN_ROLLBACK, status);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_BMC, 0);
+	CuAssertIntEquals (test, PFR_SVN_ROLLBACK, status);
+
+	/* Advancing to the current SVN changes nothing and needs no write. */
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_BMC, 20);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, flash.writes);
+
+	status = pfr_svn_get (&svn, PFR_SVN_POLICY_BMC, &value);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 20, value);
+
+	CuAssertIntEquals (test, 20, pfr_svn_testing_reload (test, &flash, PFR_SVN_POLICY_BMC));
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_svn_test_commit_single_program (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	int status;
+
+	TEST_START;
+
+	pfr_svn_testing_init (test, &flash, &svn);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_CPLD, 3);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_BMC, 40);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_CPLD, 5);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_reset_counters (&flash);
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, 0, status);
+
+	/* Both policies are programmed with one write, read back once and never erased. */
+	CuAssertIntEquals (test, 1, flash.writes);
+	CuAssertIntEquals (test, PFR_SVN_POLICIES * PFR_SVN_BITMAP_SIZE, flash.bytes_written);
+	CuAssertIntEquals (test, 1, flash.reads);
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+	CuAssertIntEquals (test, 0, flash.block_erases);
+
+	CuAssertIntEquals (test, 5, pfr_svn_testing_reload (test, &flash, PFR_SVN_POLICY_CPLD));
+	CuAssertIntEquals (test, 0, pfr_svn_testing_reload (test, &flash, PFR_SVN_POLICY_PCH));
+	CuAssertIntEquals (test, 40, pfr_svn_testing_reload (test, &flash, PFR_SVN_POLICY_BMC));
+
+	/* Raising a policy again only programs its own bitmap. */
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_PCH, 9);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_reset_counters (&flash);
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, flash.writes);
+	CuAssertIntEquals (test, PFR_SVN_BITMAP_SIZE, flash.bytes_written);
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+
+	CuAssertIntEquals (test, 9, pfr_svn_testing_reload (test, &flash, PFR_SVN_POLICY_PCH));
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_svn_test_power_loss_before_commit (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	int status;
+
+	TEST_START;
+
+	pfr_svn_testing_init (test, &flash, &svn);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_PCH, 10);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_PCH, 30);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_svn_check (&svn, PFR_SVN_POLICY_PCH, 20);
+	CuAssertIntEquals (test, PFR_SVN_ROLLBACK, status);
+
+	/* Power is lost before the commit, so flash still holds the committed SVN. */
+	CuAssertIntEquals (test, 10, pfr_svn_testing_reload (test, &flash, PFR_SVN_POLICY_PCH));
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 30, pfr_svn_testing_reload (test, &flash, PFR_SVN_POLICY_PCH));
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_svn_test_power_loss_during_commit (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	uint8_t value;
+	int status;
+
+	TEST_START;
+
+	pfr_svn_testing_init (test, &flash, &svn);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_CPLD, 3);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_CPLD, 50);
+	CuAssertIntEquals (test, 0, status);
+
+	flash.base.write = pfr_svn_testing_torn_write;
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, FLASH_NO_MEMORY, status);
+
+	/* A torn program leaves an SVN between the old and new value, never an older one. */
+	value = pfr_svn_testing_reload (test, &flash, PFR_SVN_POLICY_CPLD);
+	CuAssertIntEquals (test, 32, value);
+	CuAssertTrue (test, (value >= 3) && (value <= 50));
+
+	flash.base.write = pfr_svn_testing_write;
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 50, pfr_svn_testing_reload (test, &flash, PFR_SVN_POLICY_CPLD));
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_svn_test_commit_write_error (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	uint8_t value;
+	int status;
+
+	TEST_START;
+
+	pfr_svn_testing_init (test, &flash, &svn);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_BMC, 63);
+	CuAssertIntEquals (test, 0, status);
+
+	flash.base.write = pfr_svn_testing_failed_write;
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, FLASH_NO_MEMORY, status);
+
+	/* The shadow keeps the raised SVN so older images are still rejected. */
+	status = pfr_svn_get (&svn, PFR_SVN_POLICY_BMC, &value);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 63, value);
+
+	status = pfr_svn_check (&svn, PFR_SVN_POLICY_BMC, 62);
+	CuAssertIntEquals (test, PFR_SVN_ROLLBACK, status);
+
+	CuAssertIntEquals (test, 0, pfr_svn_testing_reload (test, &flash, PFR_SVN_POLICY_BMC));
+
+	flash.base.write = pfr_svn_testing_write;
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 63, pfr_svn_testing_reload (test, &flash, PFR_SVN_POLICY_BMC));
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_svn_test_commit_verify_failure (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	int status;
+
+	TEST_START;
+
+	pfr_svn_testing_init (test, &flash, &svn);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_PCH, 2);
+	CuAssertIntEquals (test, 0, status);
+
+	/* A bit cleared on flash behind the shadow can't be set again by a program. */
+	flash.data[PFR_SVN_TESTING_BASE + PFR_SVN_BITMAP_SIZE + 6] = 0x00;
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, PFR_SVN_WRITE_FAILED, status);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_svn_test_invalidate (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	uint8_t value;
+	int status;
+
+	TEST_START;
+
+	pfr_svn_testing_init (test, &flash, &svn);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICY_PCH, 4);
+	CuAssertIntEquals (test, 0, status);
+
+	/* The UFM is erased and provisioned with a new SVN outside of the policies. */
+	memset (&flash.data[PFR_SVN_TESTING_BASE], 0xff, PFR_SVN_POLICIES * PFR_SVN_BITMAP_SIZE);
+	flash.data[PFR_SVN_TESTING_BASE + PFR_SVN_BITMAP_SIZE] = 0xfc;
+
+	pfr_svn_invalidate (&svn);
+
+	status = pfr_svn_get (&svn, PFR_SVN_POLICY_PCH, &value);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 2, value);
+
+	/* The uncommitted change was dropped. */
+	emulated_flash_reset_counters (&flash);
+
+	status = pfr_svn_commit (&svn);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 0, flash.writes);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_svn_test_null (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_svn svn;
+	uint8_t value;
+	int status;
+
+	TEST_START;
+
+	pfr_svn_testing_init (test, &flash, &svn);
+
+	status = pfr_svn_get (NULL, PFR_SVN_POLICY_CPLD, &value);
+	CuAssertIntEquals (test, PFR_SVN_INVALID_ARGUMENT, status);
+
+	status = pfr_svn_get (&svn, PFR_SVN_POLICY_CPLD, NULL);
+	CuAssertIntEquals (test, PFR_SVN_INVALID_ARGUMENT, status);
+
+	status = pfr_svn_get (&svn, -1, &value);
+	CuAssertIntEquals (test, PFR_SVN_INVALID_ARGUMENT, status);
+
+	status = pfr_svn_get (&svn, PFR_SVN_POLICIES, &value);
+	CuAssertIntEquals (test, PFR_SVN_INVALID_ARGUMENT, status);
+
+	status = pfr_svn_check (NULL, PFR_SVN_POLICY_CPLD, 0);
+	CuAssertIntEquals (test, PFR_SVN_INVALID_ARGUMENT, status);
+
+	status = pfr_svn_check (&svn, PFR_SVN_POLICIES, 0);
+	CuAssertIntEquals (test, PFR_SVN_INVALID_ARGUMENT, status);
+
+	status = pfr_svn_advance (NULL, PFR_SVN_POLICY_CPLD, 1);
+	CuAssertIntEquals (test, PFR_SVN_INVALID_ARGUMENT, status);
+
+	status = pfr_svn_advance (&svn, PFR_SVN_POLICIES, 1);
+	CuAssertIntEquals (test, PFR_SVN_INVALID_ARGUMENT, status);
+
+	status = pfr_svn_commit (NULL);
+	CuAssertIntEquals (test, PFR_SVN_INVALID_ARGUMENT, status);
+
+	pfr_svn_invalidate (NULL);
+
+	CuAssertIntEquals (test, 0, flash.reads);
+	CuAssertIntEquals (test, 0, flash.writes);
+
+	emulated_flash_release (&flash);
+}
+
+
+CuSuite* get_pfr_svn_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_svn_test_init);
+	SUITE_ADD_TEST (suite, pfr_svn_test_get_loads_once);
+	SUITE_ADD_TEST (suite, pfr_svn_test_decode_stored_bitmap);
+	SUITE_ADD_TEST (suite, pfr_svn_test_advance_boundaries);
+	SUITE_ADD_TEST (suite, pfr_svn_test_advance_out_of_range);
+	SUITE_ADD_TEST (suite, pfr_svn_test_bitmap_full);
+	SUITE_ADD_TEST (suite, pfr_svn_test_advance_is_monotonic);
+	SUITE_ADD_TEST (suite, pfr_svn_test_commit_single_program);
+	SUITE_ADD_TEST (suite, pfr_svn_test_power_loss_before_commit);
+	SUITE_ADD_TEST (suite, pfr_svn_test_power_loss_during_commit);
+	SUITE_ADD_TEST (suite, pfr_svn_test_commit_write_error);
+	SUITE_ADD_TEST (suite, pfr_svn_test_commit_verify_failure);
+	SUITE_ADD_TEST (suite, pfr_svn_test_invalidate);
+	SUITE_ADD_TEST (suite, pfr_svn_test_null);
+
+	return suite;
+}
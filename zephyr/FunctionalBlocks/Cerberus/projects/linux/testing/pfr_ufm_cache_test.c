@@ -0,0 +1,789 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "platform.h"
+#include "testing.h"
+#include "crypto/hash.h"
+#include "status/rot_status.h"
+#include "emulated_flash.h"
+#include "pfr_ufm_cache.h"
+
+
+static const char *SUITE = "pfr_ufm_cache";
+
+
+/**
+ * Size of the emulated internal flash.
+ */
+#define	PFR_UFM_CACHE_TESTING_FLASH_SIZE	(64 * 1024)
+
+/**
+ * Sector used for the provisioning data.  Keep it away from address 0 to catch base address bugs.
+ */
+#define	PFR_UFM_CACHE_TESTING_BASE			0x3000
+
+/**
+ * Number of read requests needed to verify a range after a flush.
+ */
+#define	PFR_UFM_CACHE_TESTING_VERIFY_READS(length)	\
+	(((length) + PFR_UFM_CACHE_VERIFY_CHUNK - 1) / PFR_UFM_CACHE_VERIFY_CHUNK)
+
+
+/**
+ * Write handler of the emulated flash, saved while a test injects write faults.
+ */
+static int (*pfr_ufm_cache_testing_write) (struct flash*, uint32_t, const uint8_t*, size_t);
+
+/**
+ * Flash write that programs the data and then corrupts the first byte, like a stuck bit.
+ */
+static int pfr_ufm_cache_testing_corrupt_write (struct flash *flash, uint32_t address,
+	const uint8_t *data, size_t length)
+{
+	struct emulated_flash *emulated = (struct emulated_flash*) flash;
+	int status;
+
+	status = pfr_ufm_cache_testing_write (flash, address, data, length);
+	if (!ROT_IS_ERROR (status) && (length != 0)) {
+		emulated->data[address] ^= 0x01;
+	}
+
+	return status;
+}
+
+/**
+ * Flash write that always fails.
+ */
+static int pfr_ufm_cache_testing_failed_write (struct flash *flash, uint32_t address,
+	const uint8_t *data, size_t length)
+{
+	return FLASH_NO_MEMORY;
+}
+
+/**
+ * Set up an emulated flash with a programmed provisioning sector and an initialized cache.
+ *
+ * @param test The test framework.
+ * @param flash The emulated flash to initialize.
+ * @param cache The cache to initialize.
+ */
+static void pfr_ufm_cache_testing_init (CuTest *test, struct emulated_flash *flash,
+	struct pfr_ufm_cache *cache)
+{
+	int status;
+
+	status = emulated_flash_init (flash, PFR_UFM_CACHE_TESTING_FLASH_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_fill_pattern (flash, 0x55464d30);
+
+	status = pfr_ufm_cache_init (cache, &flash->base, PFR_UFM_CACHE_TESTING_BASE);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_reset_counters (flash);
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void pfr_ufm_cache_test_init (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	int status;
+
+	TEST_START;
+
+	status = emulated_flash_init (&flash, PFR_UFM_CACHE_TESTING_FLASH_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_ufm_cache_init (&cache, &flash.base, PFR_UFM_CACHE_TESTING_BASE);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, false, pfr_ufm_cache_is_dirty (&cache));
+
+	/* Nothing is read until the first access. */
+	CuAssertIntEquals (test, 0, flash.reads);
+
+	status = pfr_ufm_cache_init (NULL, &flash.base, PFR_UFM_CACHE_TESTING_BASE);
+	CuAssertIntEquals (test, PFR_UFM_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_ufm_cache_init (&cache, NULL, PFR_UFM_CACHE_TESTING_BASE);
+	CuAssertIntEquals (test, PFR_UFM_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_ufm_cache_init (&cache, &flash.base, PFR_UFM_CACHE_TESTING_BASE + 0x100);
+	CuAssertIntEquals (test, PFR_UFM_CACHE_INVALID_ARGUMENT, status);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_read_loads_once (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t root_key_hash[SHA256_HASH_LENGTH];
+	uint8_t svn[8];
+	uint8_t policy;
+	uint32_t offset;
+	int i;
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+
+	/* A verification pass checks the root key, SVNs and cancellation policies repeatedly. */
+	for (i = 0; i < 16; i++) {
+		status = pfr_ufm_cache_read (&cache, 0x004, root_key_hash, sizeof (root_key_hash));
+		CuAssertIntEquals (test, 0, status);
+
+		status = testing_validate_array (&flash.data[PFR_UFM_CACHE_TESTING_BASE + 0x004],
+			root_key_hash, sizeof (root_key_hash));
+		CuAssertIntEquals (test, 0, status);
+
+		status = pfr_ufm_cache_read (&cache, 0x0e0, svn, sizeof (svn));
+		CuAssertIntEquals (test, 0, status);
+
+		status = testing_validate_array (&flash.data[PFR_UFM_CACHE_TESTING_BASE + 0x0e0], svn,
+			sizeof (svn));
+		CuAssertIntEquals (test, 0, status);
+
+		for (offset = 0x09c; offset < 0x0ec; offset += 0x10) {
+			status = pfr_ufm_cache_read (&cache, offset + i, &policy, 1);
+			CuAssertIntEquals (test, 0, status);
+			CuAssertIntEquals (test, flash.data[PFR_UFM_CACHE_TESTING_BASE + offset + i], policy);
+		}
+	}
+
+	CuAssertIntEquals (test, 1, flash.reads);
+	CuAssertIntEquals (test, PFR_UFM_CACHE_SIZE, flash.bytes_read);
+	CuAssertIntEquals (test, 0, flash.writes);
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_read_end_of_sector (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t data[16];
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+
+	status = pfr_ufm_cache_read (&cache, PFR_UFM_CACHE_SIZE - sizeof (data), data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing_validate_array (
+		&flash.data[PFR_UFM_CACHE_TESTING_BASE + PFR_UFM_CACHE_SIZE - sizeof (data)], data,
+		sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_ufm_cache_read (&cache, PFR_UFM_CACHE_SIZE - sizeof (data) + 1, data,
+		sizeof (data));
+	CuAssertIntEquals (test, PFR_UFM_CACHE_OUT_OF_RANGE, status);
+
+	status = pfr_ufm_cache_read (&cache, PFR_UFM_CACHE_SIZE + 1, data, 0);
+	CuAssertIntEquals (test, PFR_UFM_CACHE_OUT_OF_RANGE, status);
+
+	status = pfr_ufm_cache_write (&cache, PFR_UFM_CACHE_SIZE - 1, data, 2);
+	CuAssertIntEquals (test, PFR_UFM_CACHE_OUT_OF_RANGE, status);
+
+	CuAssertIntEquals (test, 1, flash.reads);
+	CuAssertIntEquals (test, false, pfr_ufm_cache_is_dirty (&cache));
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_write_is_buffered (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t original[PFR_UFM_CACHE_SIZE];
+	uint8_t offsets[12];
+	uint8_t data[12];
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+	memcpy (original, &flash.data[PFR_UFM_CACHE_TESTING_BASE], sizeof (original));
+
+	memset (offsets, 0xa5, sizeof (offsets));
+	offsets[0] = ~flash.data[PFR_UFM_CACHE_TESTING_BASE + 0x0a4];
+
+	status = pfr_ufm_cache_write (&cache, 0x0a4, offsets, sizeof (offsets));
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, true, pfr_ufm_cache_is_dirty (&cache));
+
+	status = pfr_ufm_cache_read (&cache, 0x0a4, data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing_validate_array (offsets, data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	/* Only the initial load touched the flash. */
+	CuAssertIntEquals (test, 1, flash.reads);
+	CuAssertIntEquals (test, 0, flash.writes);
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+
+	status = testing_validate_array (original, &flash.data[PFR_UFM_CACHE_TESTING_BASE],
+		sizeof (original));
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_write_identical_data (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t data[32];
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+
+	memcpy (data, &flash.data[PFR_UFM_CACHE_TESTING_BASE + 0x004], sizeof (data));
+
+	status = pfr_ufm_cache_write (&cache, 0x004, data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, false, pfr_ufm_cache_is_dirty (&cache));
+
+	status = pfr_ufm_cache_flush (&cache);
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 1, flash.reads);
+	CuAssertIntEquals (test, 0, flash.writes);
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_flush_coalesces_writes (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t expected[PFR_UFM_CACHE_SIZE];
+	uint8_t root_key_hash[SHA256_HASH_LENGTH];
+	uint8_t pch_offsets[12];
+	uint8_t bmc_offsets[12];
+	uint32_t ufm_status;
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+	memcpy (expected, &flash.data[PFR_UFM_CACHE_TESTING_BASE], sizeof (expected));
+
+	memset (root_key_hash, 0xff, sizeof (root_key_hash));
+	memset (pch_offsets, 0x5a, sizeof (pch_offsets));
+	memset (bmc_offsets, 0xc3, sizeof (bmc_offsets));
+
+	/* The same sequence as provisioning through the mailbox. */
+	status = pfr_ufm_cache_read (&cache, 0x000, (uint8_t*) &ufm_status, sizeof (ufm_status));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_ufm_cache_write (&cache, 0x004, root_key_hash, sizeof (root_key_hash));
+	CuAssertIntEquals (test, 0, status);
+	ufm_status &= ~0x02;
+	status = pfr_ufm_cache_write (&cache, 0x000, (uint8_t*) &ufm_status, sizeof (ufm_status));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_ufm_cache_write (&cache, 0x024, pch_offsets, sizeof (pch_offsets));
+	CuAssertIntEquals (test, 0, status);
+	ufm_status &= ~0x04;
+	status = pfr_ufm_cache_write (&cache, 0x000, (uint8_t*) &ufm_status, sizeof (ufm_status));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_ufm_cache_write (&cache, 0x030, bmc_offsets, sizeof (bmc_offsets));
+	CuAssertIntEquals (test, 0, status);
+	ufm_status &= ~0x08;
+	status = pfr_ufm_cache_write (&cache, 0x000, (uint8_t*) &ufm_status, sizeof (ufm_status));
+	CuAssertIntEquals (test, 0, status);
+
+	memcpy (&expected[0x000], &ufm_status, sizeof (ufm_status));
+	memcpy (&expected[0x004], root_key_hash, sizeof (root_key_hash));
+	memcpy (&expected[0x024], pch_offsets, sizeof (pch_offsets));
+	memcpy (&expected[0x030], bmc_offsets, sizeof (bmc_offsets));
+
+	CuAssertIntEquals (test, 0, flash.writes);
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+
+	status = pfr_ufm_cache_flush (&cache);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, false, pfr_ufm_cache_is_dirty (&cache));
+
+	/* Six updates cost one erase, one program and the read back. */
+	CuAssertIntEquals (test, 1, flash.sector_erases);
+	CuAssertIntEquals (test, 1, flash.writes);
+	CuAssertIntEquals (test, PFR_UFM_CACHE_SIZE, flash.bytes_written);
+	CuAssertIntEquals (test, 1 + PFR_UFM_CACHE_TESTING_VERIFY_READS (PFR_UFM_CACHE_SIZE),
+		flash.reads);
+
+	status = testing_validate_array (expected, &flash.data[PFR_UFM_CACHE_TESTING_BASE],
+		sizeof (expected));
+	CuAssertIntEquals (test, 0, status);
+
+	/* A second flush has nothing to do. */
+	status = pfr_ufm_cache_flush (&cache);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, flash.sector_erases);
+	CuAssertIntEquals (test, 1, flash.writes);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_flush_only_programs_used_data (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t ufm_status[4] = {0x01, 0xff, 0xff, 0xff};
+	int status;
+
+	TEST_START;
+
+	status = emulated_flash_init (&flash, PFR_UFM_CACHE_TESTING_FLASH_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	flash.data[PFR_UFM_CACHE_TESTING_BASE] = 0x00;
+
+	status = pfr_ufm_cache_init (&cache, &flash.base, PFR_UFM_CACHE_TESTING_BASE);
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_ufm_cache_write (&cache, 0x000, ufm_status, sizeof (ufm_status));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_ufm_cache_flush (&cache);
+	CuAssertIntEquals (test, 0, status);
+
+	/* The rest of the sector is erased, so only the first byte is programmed. */
+	CuAssertIntEquals (test, 1, flash.sector_erases);
+	CuAssertIntEquals (test, 1, flash.writes);
+	CuAssertIntEquals (test, 1, flash.bytes_written);
+	CuAssertIntEquals (test, 0x01, flash.data[PFR_UFM_CACHE_TESTING_BASE]);
+	CuAssertIntEquals (test, 0xff, flash.data[PFR_UFM_CACHE_TESTING_BASE + 1]);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_flush_clear_bits_in_place (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t expected[PFR_UFM_CACHE_SIZE];
+	uint8_t svn[8];
+	uint8_t policy;
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+
+	/* SVN updates and key cancellation only ever clear bits. */
+	status = pfr_ufm_cache_read (&cache, 0x0e0, svn, sizeof (svn));
+	CuAssertIntEquals (test, 0, status);
+
+	svn[0] = 0;
+	svn[1] &= 0xf0;
+	status = pfr_ufm_cache_write (&cache, 0x0e0, svn, sizeof (svn));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_ufm_cache_read (&cache, 0x0ac, &policy, 1);
+	CuAssertIntEquals (test, 0, status);
+
+	policy &= ~0x80;
+	status = pfr_ufm_cache_write (&cache, 0x0ac, &policy, 1);
+	CuAssertIntEquals (test, 0, status);
+
+	memcpy (expected, cache.data, sizeof (expected));
+
+	status = pfr_ufm_cache_flush (&cache);
+	CuAssertIntEquals (test, 0, status);
+
+	/* No erase, and only the range between the changes is programmed. */
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+	CuAssertIntEquals (test, 1, flash.writes);
+	CuAssertIntEquals (test, 1 + PFR_UFM_CACHE_TESTING_VERIFY_READS (0x0e2 - 0x0ac),
+		flash.reads);
+
+	status = testing_validate_array (expected, &flash.data[PFR_UFM_CACHE_TESTING_BASE],
+		sizeof (expected));
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_erase (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t data[32];
+	uint8_t erased[32];
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+
+	memset (data, 0, sizeof (data));
+	status = pfr_ufm_cache_write (&cache, 0x004, data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_ufm_cache_erase (&cache);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, false, pfr_ufm_cache_is_dirty (&cache));
+	CuAssertIntEquals (test, 1, flash.sector_erases);
+	CuAssertIntEquals (test, 0xff, flash.data[PFR_UFM_CACHE_TESTING_BASE + 0x004]);
+
+	memset (erased, 0xff, sizeof (erased));
+	status = pfr_ufm_cache_read (&cache, 0x004, data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	status = testing_validate_array (erased, data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	/* The pending write was dropped, so there is nothing to flush. */
+	status = pfr_ufm_cache_flush (&cache);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, flash.reads);
+	CuAssertIntEquals (test, 0, flash.writes);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_invalidate (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t data;
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+
+	status = pfr_ufm_cache_read (&cache, 0x200, &data, 1);
+	CuAssertIntEquals (test, 0, status);
+
+	/* Update the sector behind the cache. */
+	flash.data[PFR_UFM_CACHE_TESTING_BASE + 0x200] = ~data;
+
+	status = pfr_ufm_cache_read (&cache, 0x200, &data, 1);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, (uint8_t) ~flash.data[PFR_UFM_CACHE_TESTING_BASE + 0x200], data);
+
+	pfr_ufm_cache_invalidate (&cache);
+
+	status = pfr_ufm_cache_read (&cache, 0x200, &data, 1);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, flash.data[PFR_UFM_CACHE_TESTING_BASE + 0x200], data);
+	CuAssertIntEquals (test, 2, flash.reads);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_flush_verify_failure (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t data[4];
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+
+	pfr_ufm_cache_testing_write = flash.base.write;
+	flash.base.write = pfr_ufm_cache_testing_corrupt_write;
+
+	flash.data[PFR_UFM_CACHE_TESTING_BASE + 0x100] = 0xff;
+	status = pfr_ufm_cache_read (&cache, 0x100, data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	data[0] = 0x0f;
+	status = pfr_ufm_cache_write (&cache, 0x100, data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	/* The in place update fails to verify, then so does the erase and rewrite. */
+	status = pfr_ufm_cache_flush (&cache);
+	CuAssertIntEquals (test, PFR_UFM_CACHE_VERIFY_FAILED, status);
+	CuAssertIntEquals (test, true, pfr_ufm_cache_is_dirty (&cache));
+	CuAssertIntEquals (test, 2, flash.writes);
+	CuAssertIntEquals (test, 1, flash.sector_erases);
+
+	/* Once the flash works again, the retry commits the data. */
+	flash.base.write = pfr_ufm_cache_testing_write;
+
+	status = pfr_ufm_cache_flush (&cache);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, false, pfr_ufm_cache_is_dirty (&cache));
+
+	status = testing_validate_array (cache.data, &flash.data[PFR_UFM_CACHE_TESTING_BASE],
+		PFR_UFM_CACHE_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_flush_write_error (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t data[4] = {0x01, 0x02, 0x03, 0x04};
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+
+	flash.base.write = pfr_ufm_cache_testing_failed_write;
+
+	status = pfr_ufm_cache_write (&cache, 0x100, data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_ufm_cache_flush (&cache);
+	CuAssertIntEquals (test, FLASH_NO_MEMORY, status);
+	CuAssertIntEquals (test, true, pfr_ufm_cache_is_dirty (&cache));
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_write_through (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t expected[PFR_UFM_CACHE_SIZE];
+	uint8_t staged[4] = {0x01, 0x02, 0x03, 0x04};
+	uint8_t svn[8];
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+
+	memcpy (expected, &flash.data[PFR_UFM_CACHE_TESTING_BASE], sizeof (expected));
+
+	/* A pending change that needs an erase must not reach flash with the policy update. */
+	status = pfr_ufm_cache_write (&cache, 0x100, staged, sizeof (staged));
+	CuAssertIntEquals (test, 0, status);
+
+	status = pfr_ufm_cache_read (&cache, 0x0e0, svn, sizeof (svn));
+	CuAssertIntEquals (test, 0, status);
+
+	svn[0] = 0;
+	svn[1] &= 0xf0;
+	status = pfr_ufm_cache_write_through (&cache, 0x0e0, svn, sizeof (svn));
+	CuAssertIntEquals (test, 0, status);
+
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+	CuAssertIntEquals (test, 1, flash.writes);
+
+	memcpy (&expected[0x0e0], svn, sizeof (svn));
+	status = testing_validate_array (expected, &flash.data[PFR_UFM_CACHE_TESTING_BASE],
+		sizeof (expected));
+	CuAssertIntEquals (test, 0, status);
+
+	/* The other change is still pending. */
+	CuAssertIntEquals (test, true, pfr_ufm_cache_is_dirty (&cache));
+
+	status = pfr_ufm_cache_flush (&cache);
+	CuAssertIntEquals (test, 0, status);
+
+	memcpy (&expected[0x100], staged, sizeof (staged));
+	status = testing_validate_array (expected, &flash.data[PFR_UFM_CACHE_TESTING_BASE],
+		sizeof (expected));
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_write_through_sets_bits (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t expected[PFR_UFM_CACHE_SIZE];
+	uint8_t data[4];
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+
+	status = pfr_ufm_cache_read (&cache, 0x0e0, data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	memcpy (expected, cache.data, sizeof (expected));
+
+	data[2] = ~data[2];
+	status = pfr_ufm_cache_write_through (&cache, 0x0e0, data, sizeof (data));
+	CuAssertIntEquals (test, PFR_UFM_CACHE_NEEDS_ERASE, status);
+	CuAssertIntEquals (test, false, pfr_ufm_cache_is_dirty (&cache));
+	CuAssertIntEquals (test, 0, flash.writes);
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+
+	status = testing_validate_array (expected, cache.data, sizeof (expected));
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_write_through_pending_overlap (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t expected[PFR_UFM_CACHE_SIZE];
+	uint8_t staged[4] = {0x01, 0x02, 0x03, 0x04};
+	uint8_t data[8];
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+
+	memcpy (expected, &flash.data[PFR_UFM_CACHE_TESTING_BASE], sizeof (expected));
+
+	status = pfr_ufm_cache_write (&cache, 0x104, staged, sizeof (staged));
+	CuAssertIntEquals (test, 0, status);
+
+	/* Clearing bits of the staged data would program a range the flash does not hold yet. */
+	status = pfr_ufm_cache_read (&cache, 0x100, data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	data[4] = 0;
+	status = pfr_ufm_cache_write_through (&cache, 0x100, data, sizeof (data));
+	CuAssertIntEquals (test, PFR_UFM_CACHE_NEEDS_ERASE, status);
+	CuAssertIntEquals (test, 0, flash.writes);
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+
+	status = testing_validate_array (expected, &flash.data[PFR_UFM_CACHE_TESTING_BASE],
+		sizeof (expected));
+	CuAssertIntEquals (test, 0, status);
+
+	/* The staged data is unchanged and still pending. */
+	CuAssertIntEquals (test, true, pfr_ufm_cache_is_dirty (&cache));
+	status = testing_validate_array (staged, &cache.data[0x104], sizeof (staged));
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_write_through_verify_failure (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t data[4];
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+
+	pfr_ufm_cache_testing_write = flash.base.write;
+	flash.base.write = pfr_ufm_cache_testing_corrupt_write;
+
+	flash.data[PFR_UFM_CACHE_TESTING_BASE + 0x100] = 0xff;
+	status = pfr_ufm_cache_read (&cache, 0x100, data, sizeof (data));
+	CuAssertIntEquals (test, 0, status);
+
+	data[0] = 0x0f;
+	status = pfr_ufm_cache_write_through (&cache, 0x100, data, sizeof (data));
+	CuAssertIntEquals (test, PFR_UFM_CACHE_VERIFY_FAILED, status);
+	CuAssertIntEquals (test, 0, flash.sector_erases);
+
+	/* The range is left pending and the next flush rewrites the sector. */
+	CuAssertIntEquals (test, true, pfr_ufm_cache_is_dirty (&cache));
+
+	flash.base.write = pfr_ufm_cache_testing_write;
+
+	status = pfr_ufm_cache_flush (&cache);
+	CuAssertIntEquals (test, 0, status);
+	CuAssertIntEquals (test, 1, flash.sector_erases);
+
+	status = testing_validate_array (cache.data, &flash.data[PFR_UFM_CACHE_TESTING_BASE],
+		PFR_UFM_CACHE_SIZE);
+	CuAssertIntEquals (test, 0, status);
+
+	emulated_flash_release (&flash);
+}
+
+static void pfr_ufm_cache_test_null (CuTest *test)
+{
+	struct emulated_flash flash;
+	struct pfr_ufm_cache cache;
+	uint8_t data[4];
+	int status;
+
+	TEST_START;
+
+	pfr_ufm_cache_testing_init (test, &flash, &cache);
+
+	status = pfr_ufm_cache_read (NULL, 0, data, sizeof (data));
+	CuAssertIntEquals (test, PFR_UFM_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_ufm_cache_read (&cache, 0, NULL, sizeof (data));
+	CuAssertIntEquals (test, PFR_UFM_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_ufm_cache_write (NULL, 0, data, sizeof (data));
+	CuAssertIntEquals (test, PFR_UFM_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_ufm_cache_write (&cache, 0, NULL, sizeof (data));
+	CuAssertIntEquals (test, PFR_UFM_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_ufm_cache_erase (NULL);
+	CuAssertIntEquals (test, PFR_UFM_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_ufm_cache_flush (NULL);
+	CuAssertIntEquals (test, PFR_UFM_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_ufm_cache_write_through (NULL, 0, data, sizeof (data));
+	CuAssertIntEquals (test, PFR_UFM_CACHE_INVALID_ARGUMENT, status);
+
+	status = pfr_ufm_cache_write_through (&cache, 0, NULL, sizeof (data));
+	CuAssertIntEquals (test, PFR_UFM_CACHE_INVALID_ARGUMENT, status);
+
+	CuAssertIntEquals (test, false, pfr_ufm_cache_is_dirty (NULL));
+	pfr_ufm_cache_invalidate (NULL);
+
+	CuAssertIntEquals (test, 0, flash.reads);
+
+	emulated_flash_release (&flash);
+}
+
+
+CuSuite* get_pfr_ufm_cache_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_init);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_read_loads_once);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_read_end_of_sector);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_write_is_buffered);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_write_identical_data);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_flush_coalesces_writes);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_flush_only_programs_used_data);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_flush_clear_bits_in_place);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_erase);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_invalidate);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_flush_verify_failure);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_flush_write_error);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_write_through);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_write_through_sets_bits);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_write_through_pending_overlap);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_write_through_verify_failure);
+	SUITE_ADD_TEST (suite, pfr_ufm_cache_test_null);
+
+	return suite;
+}
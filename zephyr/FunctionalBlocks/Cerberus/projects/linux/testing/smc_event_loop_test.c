@@ -0,0 +1,486 @@
+//***********************************************************************//
+//*                                                                     *//
+//*                      Copyright © 2022 AMI                           *//
+//*                                                                     *//
+//*        All rights reserved. Subject to AMI licensing agreement.     *//
+//*                                                                     *//
+//***********************************************************************//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "platform.h"
+#include "testing.h"
+#include "smc_event_loop.h"
+
+
+static const char *SUITE = "smc_event_loop";
+
+
+/**
+ * Number of events that can be queued at once.
+ */
+#define	SMC_EVENT_LOOP_TESTING_QUEUE_SIZE	512
+
+/**
+ * Shape of the bursts posted while the loop is running.
+ */
+#define	SMC_EVENT_LOOP_TESTING_BURSTS		20
+#define	SMC_EVENT_LOOP_TESTING_BURST_SIZE	16
+#define	SMC_EVENT_LOOP_TESTING_BURST_GAP_MS	1
+
+/**
+ * Status returned by the queue once it has been closed and drained.
+ */
+#define	SMC_EVENT_LOOP_TESTING_CLOSED		0x7f
+
+
+/**
+ * What an event asks the dispatcher to do.
+ */
+enum {
+	SMC_EVENT_LOOP_TESTING_NOP,			/**< Handled without selecting a state, like INITIALIZE. */
+	SMC_EVENT_LOOP_TESTING_STATE,		/**< Selects a state to run. */
+	SMC_EVENT_LOOP_TESTING_CHAIN,		/**< Selects a state that moves straight to another. */
+	SMC_EVENT_LOOP_TESTING_STOP,		/**< Selects a state that terminates the machine. */
+};
+
+/**
+ * A synthetic state machine event.
+ */
+struct smc_event_loop_testing_event {
+	int action;							/**< The SMC_EVENT_LOOP_TESTING_* action. */
+};
+
+/**
+ * Event queue and state handlers for the loop under test.
+ */
+struct smc_event_loop_testing {
+	struct smc_event_loop loop;			/**< The loop under test. */
+	pthread_mutex_t lock;				/**< Protects the queue. */
+	pthread_cond_t posted;				/**< Signaled when an event is queued. */
+	struct smc_event_loop_testing_event *queue[SMC_EVENT_LOOP_TESTING_QUEUE_SIZE];	/**< Queue. */
+	int head;							/**< Next event to remove. */
+	int count;							/**< Number of queued events. */
+	int closed;							/**< No more events will be posted. */
+	int wait_status;					/**< Error to report instead of waiting, if not 0. */
+	int waits;							/**< Number of times the loop asked for an event. */
+	int dispatched;						/**< Number of events dispatched. */
+	int runs;							/**< Number of state runs. */
+	struct smc_event_loop_testing_event *current;	/**< Event that selected the current state. */
+	struct smc_event_loop_testing_event *order[SMC_EVENT_LOOP_TESTING_QUEUE_SIZE];	/**< Event of each state run. */
+};
+
+
+static int smc_event_loop_testing_wait_event (struct smc_event_loop *loop, void **event)
+{
+	struct smc_event_loop_testing *testing = (struct smc_event_loop_testing*) loop->context;
+	int status = 0;
+
+	pthread_mutex_lock (&testing->lock);
+	testing->waits++;
+
+	if (testing->wait_status) {
+		status = testing->wait_status;
+	}
+	else {
+		while ((testing->count == 0) && !testing->closed) {
+			pthread_cond_wait (&testing->posted, &testing->lock);
+		}
+
+		if (testing->count == 0) {
+			status = SMC_EVENT_LOOP_TESTING_CLOSED;
+		}
+		else {
+			*event = testing->queue[testing->head];
+			testing->head = (testing->head + 1) % SMC_EVENT_LOOP_TESTING_QUEUE_SIZE;
+			testing->count--;
+		}
+	}
+
+	pthread_mutex_unlock (&testing->lock);
+	return status;
+}
+
+static void smc_event_loop_testing_dispatch (struct smc_event_loop *loop, void *event)
+{
+	struct smc_event_loop_testing *testing = (struct smc_event_loop_testing*) loop->context;
+	struct smc_event_loop_testing_event *smc_event = (struct smc_event_loop_testing_event*) event;
+
+	testing->dispatched++;
+
+	if (smc_event->action != SMC_EVENT_LOOP_TESTING_NOP) {
+		testing->current = smc_event;
+		smc_event_loop_transition (loop);
+	}
+}
+
+static int smc_event_loop_testing_run_state (struct smc_event_loop *loop)
+{
+	struct smc_event_loop_testing *testing = (struct smc_event_loop_testing*) loop->context;
+	struct smc_event_loop_testing_event *smc_event = testing->current;
+
+	if (smc_event == NULL) {
+		return -1;
+	}
+
+	testing->order[testing->runs++] = smc_event;
+
+	switch (smc_event->action) {
+		case SMC_EVENT_LOOP_TESTING_CHAIN:
+			/* The state selects the next state directly, like execute_next_smc_action. */
+			smc_event->action = SMC_EVENT_LOOP_TESTING_STATE;
+			smc_event_loop_transition (loop);
+			break;
+
+		case SMC_EVENT_LOOP_TESTING_STOP:
+			return 1;
+	}
+
+	return 0;
+}
+
+static void smc_event_loop_testing_init (struct smc_event_loop_testing *testing)
+{
+	memset (testing, 0, sizeof (*testing));
+
+	pthread_mutex_init (&testing->lock, NULL);
+	pthread_cond_init (&testing->posted, NULL);
+
+	testing->loop.wait_event = smc_event_loop_testing_wait_event;
+	testing->loop.dispatch = smc_event_loop_testing_dispatch;
+	testing->loop.run_state = smc_event_loop_testing_run_state;
+	testing->loop.context = testing;
+}
+
+static void smc_event_loop_testing_release (struct smc_event_loop_testing *testing)
+{
+	pthread_mutex_destroy (&testing->lock);
+	pthread_cond_destroy (&testing->posted);
+}
+
+static void smc_event_loop_testing_post (struct smc_event_loop_testing *testing,
+	struct smc_event_loop_testing_event *event, int action)
+{
+	event->action = action;
+
+	pthread_mutex_lock (&testing->lock);
+	testing->queue[(testing->head + testing->count) % SMC_EVENT_LOOP_TESTING_QUEUE_SIZE] = event;
+	testing->count++;
+	pthread_cond_signal (&testing->posted);
+	pthread_mutex_unlock (&testing->lock);
+}
+
+static void smc_event_loop_testing_close (struct smc_event_loop_testing *testing)
+{
+	pthread_mutex_lock (&testing->lock);
+	testing->closed = 1;
+	pthread_cond_signal (&testing->posted);
+	pthread_mutex_unlock (&testing->lock);
+}
+
+/**
+ * State machine thread for tests that post events while the loop is running.
+ */
+struct smc_event_loop_testing_thread {
+	pthread_t thread;					/**< The thread running the loop. */
+	struct smc_event_loop_testing *testing;	/**< The loop to run. */
+	int status;							/**< Status returned by the loop. */
+};
+
+static void* smc_event_loop_testing_thread_main (void *arg)
+{
+	struct smc_event_loop_testing_thread *thread = (struct smc_event_loop_testing_thread*) arg;
+
+	thread->status = smc_event_loop_run (&thread->testing->loop);
+	return NULL;
+}
+
+/*******************
+ * Test cases
+ *******************/
+
+static void smc_event_loop_test_run_null (CuTest *test)
+{
+	struct smc_event_loop_testing testing;
+	int status;
+
+	TEST_START;
+
+	smc_event_loop_testing_init (&testing);
+
+	status = smc_event_loop_run (NULL);
+	CuAssertIntEquals (test, -1, status);
+
+	testing.loop.wait_event = NULL;
+	status = smc_event_loop_run (&testing.loop);
+	CuAssertIntEquals (test, -1, status);
+
+	testing.loop.wait_event = smc_event_loop_testing_wait_event;
+	testing.loop.dispatch = NULL;
+	status = smc_event_loop_run (&testing.loop);
+	CuAssertIntEquals (test, -1, status);
+
+	testing.loop.dispatch = smc_event_loop_testing_dispatch;
+	testing.loop.run_state = NULL;
+	status = smc_event_loop_run (&testing.loop);
+	CuAssertIntEquals (test, -1, status);
+
+	CuAssertIntEquals (test, 0, testing.waits);
+
+	smc_event_loop_transition (NULL);
+
+	smc_event_loop_testing_release (&testing);
+}
+
+static void smc_event_loop_test_run_state_once_per_event (CuTest *test)
+{
+	struct smc_event_loop_testing testing;
+	struct smc_event_loop_testing_event event[3];
+	int status;
+
+	TEST_START;
+
+	smc_event_loop_testing_init (&testing);
+
+	smc_event_loop_testing_post (&testing, &event[0], SMC_EVENT_LOOP_TESTING_STATE);
+	smc_event_loop_testing_post (&testing, &event[1], SMC_EVENT_LOOP_TESTING_STATE);
+	smc_event_loop_testing_post (&testing, &event[2], SMC_EVENT_LOOP_TESTING_STOP);
+
+	status = smc_event_loop_run (&testing.loop);
+	CuAssertIntEquals (test, 1, status);
+
+	CuAssertIntEquals (test, 3, testing.dispatched);
+	CuAssertIntEquals (test, 3, testing.runs);
+	CuAssertIntEquals (test, 3, testing.waits);
+
+	smc_event_loop_testing_release (&testing);
+}
+
+static void smc_event_loop_test_run_event_without_state (CuTest *test)
+{
+	struct smc_event_loop_testing testing;
+	struct smc_event_loop_testing_event event[3];
+	int status;
+
+	TEST_START;
+
+	smc_event_loop_testing_init (&testing);
+
+	/* Events that do not select a state never run the current state again. */
+	smc_event_loop_testing_post (&testing, &event[0], SMC_EVENT_LOOP_TESTING_NOP);
+	smc_event_loop_testing_post (&testing, &event[1], SMC_EVENT_LOOP_TESTING_NOP);
+	smc_event_loop_testing_post (&testing, &event[2], SMC_EVENT_LOOP_TESTING_STOP);
+
+	status = smc_event_loop_run (&testing.loop);
+	CuAssertIntEquals (test, 1, status);
+
+	CuAssertIntEquals (test, 3, testing.dispatched);
+	CuAssertIntEquals (test, 1, testing.runs);
+
+	smc_event_loop_testing_release (&testing);
+}
+
+static void smc_event_loop_test_run_transition_from_state (CuTest *test)
+{
+	struct smc_event_loop_testing testing;
+	struct smc_event_loop_testing_event event[2];
+	int status;
+
+	TEST_START;
+
+	smc_event_loop_testing_init (&testing);
+
+	smc_event_loop_testing_post (&testing, &event[0], SMC_EVENT_LOOP_TESTING_CHAIN);
+	smc_event_loop_testing_post (&testing, &event[1], SMC_EVENT_LOOP_TESTING_STOP);
+
+	status = smc_event_loop_run (&testing.loop);
+	CuAssertIntEquals (test, 1, status);
+
+	/* The chained state runs without waiting for another event. */
+	CuAssertIntEquals (test, 2, testing.dispatched);
+	CuAssertIntEquals (test, 3, testing.runs);
+	CuAssertIntEquals (test, 2, testing.waits);
+
+	smc_event_loop_testing_release (&testing);
+}
+
+static void smc_event_loop_test_run_pending_transition (CuTest *test)
+{
+	struct smc_event_loop_testing testing;
+	struct smc_event_loop_testing_event event;
+	int status;
+
+	TEST_START;
+
+	smc_event_loop_testing_init (&testing);
+
+	/* A state selected before the loop starts is run before any event is read. */
+	event.action = SMC_EVENT_LOOP_TESTING_STOP;
+	testing.current = &event;
+	smc_event_loop_transition (&testing.loop);
+
+	status = smc_event_loop_run (&testing.loop);
+	CuAssertIntEquals (test, 1, status);
+
+	CuAssertIntEquals (test, 0, testing.waits);
+	CuAssertIntEquals (test, 1, testing.runs);
+
+	smc_event_loop_testing_release (&testing);
+}
+
+static void smc_event_loop_test_run_wait_error (CuTest *test)
+{
+	struct smc_event_loop_testing testing;
+	struct smc_event_loop_testing_event event;
+	int status;
+
+	TEST_START;
+
+	smc_event_loop_testing_init (&testing);
+
+	smc_event_loop_testing_post (&testing, &event, SMC_EVENT_LOOP_TESTING_STATE);
+	testing.wait_status = 5;
+
+	status = smc_event_loop_run (&testing.loop);
+	CuAssertIntEquals (test, 5, status);
+
+	CuAssertIntEquals (test, 0, testing.dispatched);
+	CuAssertIntEquals (test, 0, testing.runs);
+
+	smc_event_loop_testing_release (&testing);
+}
+
+static void smc_event_loop_test_run_state_error (CuTest *test)
+{
+	struct smc_event_loop_testing testing;
+	struct smc_event_loop_testing_event event[2];
+	int status;
+
+	TEST_START;
+
+	smc_event_loop_testing_init (&testing);
+
+	/* A state run with no event fails, which stops the loop. */
+	smc_event_loop_transition (&testing.loop);
+	smc_event_loop_testing_post (&testing, &event[0], SMC_EVENT_LOOP_TESTING_STATE);
+	smc_event_loop_testing_post (&testing, &event[1], SMC_EVENT_LOOP_TESTING_STOP);
+
+	status = smc_event_loop_run (&testing.loop);
+	CuAssertIntEquals (test, -1, status);
+
+	CuAssertIntEquals (test, 0, testing.dispatched);
+	CuAssertIntEquals (test, 0, testing.waits);
+
+	smc_event_loop_testing_release (&testing);
+}
+
+static void smc_event_loop_test_run_blocks_while_idle (CuTest *test)
+{
+	struct smc_event_loop_testing testing;
+	struct smc_event_loop_testing_thread thread;
+	struct smc_event_loop_testing_event event;
+	int status;
+
+	TEST_START;
+
+	smc_event_loop_testing_init (&testing);
+
+	thread.testing = &testing;
+	status = pthread_create (&thread.thread, NULL, smc_event_loop_testing_thread_main, &thread);
+	CuAssertIntEquals (test, 0, status);
+
+	/* Nothing runs while no events are posted. */
+	platform_msleep (50);
+
+	pthread_mutex_lock (&testing.lock);
+	CuAssertIntEquals (test, 1, testing.waits);
+	CuAssertIntEquals (test, 0, testing.runs);
+	pthread_mutex_unlock (&testing.lock);
+
+	smc_event_loop_testing_post (&testing, &event, SMC_EVENT_LOOP_TESTING_STATE);
+	platform_msleep (20);
+
+	pthread_mutex_lock (&testing.lock);
+	CuAssertIntEquals (test, 2, testing.waits);
+	CuAssertIntEquals (test, 1, testing.runs);
+	pthread_mutex_unlock (&testing.lock);
+
+	smc_event_loop_testing_close (&testing);
+	pthread_join (thread.thread, NULL);
+	CuAssertIntEquals (test, SMC_EVENT_LOOP_TESTING_CLOSED, thread.status);
+
+	smc_event_loop_testing_release (&testing);
+}
+
+static void smc_event_loop_test_run_bursts_in_order (CuTest *test)
+{
+	struct smc_event_loop_testing *testing;
+	struct smc_event_loop_testing_thread thread;
+	struct smc_event_loop_testing_event *event;
+	int total = SMC_EVENT_LOOP_TESTING_BURSTS * SMC_EVENT_LOOP_TESTING_BURST_SIZE;
+	int status;
+	int i;
+	int j;
+
+	TEST_START;
+
+	testing = malloc (sizeof (*testing));
+	CuAssertPtrNotNull (test, testing);
+
+	event = calloc (total, sizeof (*event));
+	CuAssertPtrNotNull (test, event);
+
+	smc_event_loop_testing_init (testing);
+
+	thread.testing = testing;
+	status = pthread_create (&thread.thread, NULL, smc_event_loop_testing_thread_main, &thread);
+	CuAssertIntEquals (test, 0, status);
+
+	for (i = 0; i < SMC_EVENT_LOOP_TESTING_BURSTS; i++) {
+		for (j = 0; j < SMC_EVENT_LOOP_TESTING_BURST_SIZE; j++) {
+			smc_event_loop_testing_post (testing, &event[(i * SMC_EVENT_LOOP_TESTING_BURST_SIZE) + j],
+				SMC_EVENT_LOOP_TESTING_STATE);
+		}
+
+		platform_msleep (SMC_EVENT_LOOP_TESTING_BURST_GAP_MS);
+	}
+
+	smc_event_loop_testing_close (testing);
+	pthread_join (thread.thread, NULL);
+	CuAssertIntEquals (test, SMC_EVENT_LOOP_TESTING_CLOSED, thread.status);
+
+	/* Every event runs its state exactly once and in the order posted, with no extra runs while
+	 * idle. */
+	CuAssertIntEquals (test, total, testing->dispatched);
+	CuAssertIntEquals (test, total, testing->runs);
+	CuAssertIntEquals (test, total + 1, testing->waits);
+
+	for (i = 0; i < total; i++) {
+		CuAssertPtrEquals (test, &event[i], testing->order[i]);
+	}
+
+	smc_event_loop_testing_release (testing);
+	free (event);
+	free (testing);
+}
+
+
+CuSuite* get_smc_event_loop_suite ()
+{
+	CuSuite *suite = CuSuiteNew ();
+
+	SUITE_ADD_TEST (suite, smc_event_loop_test_run_null);
+	SUITE_ADD_TEST (suite, smc_event_loop_test_run_state_once_per_event);
+	SUITE_ADD_TEST (suite, smc_event_loop_test_run_event_without_state);
+	SUITE_ADD_TEST (suite, smc_event_loop_test_run_transition_from_state);
+	SUITE_ADD_TEST (suite, smc_event_loop_test_run_pending_transition);
+	SUITE_ADD_TEST (suite, smc_event_loop_test_run_wait_error);
+	SUITE_ADD_TEST (suite, smc_event_loop_test_run_state_error);
+	SUITE_ADD_TEST (suite, smc_event_loop_test_run_blocks_while_idle);
+	SUITE_ADD_TEST (suite, smc_event_loop_test_run_bursts_in_order);
+
+	return suite;
+}
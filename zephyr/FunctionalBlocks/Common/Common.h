@@ -51,6 +51,7 @@ struct spi_flash *getSpiFlashInstance(void);
 struct rsa_engine *getRsaEngineInstance(void);
 struct i2c_slave_interface *getI2CSlaveEngineInstance(void);
 struct SpiFilterEngine *getSpiFilterEngineWrapper(void);
+struct SpiEngine *getSpiEngineWrapper(void);
 
 #endif /* COMMON_COMMON_H_ */
 
@@ -54,6 +54,10 @@
 
 #define SHA256_SIGNATURE_LENGTH		256
 
+// Compressed (PBC) capsule content
+#define COMPRESSION_TAG				0x5F504243
+#define PFM_SIG_BLOCK_SIZE			1024
+
 
 // Hard-coded PFM offset
 #define UPDATE_FORMAT_TPYE_HROT 2
@@ -8,16 +8,32 @@
 
 #include <stdint.h>
 #include "state_machine/common_smc.h"
+#include "pfr/pfr_common.h"
 #include "cerberus_pfr_definitions.h"
+#include "pfr/pfr_util.h"
+#include "pfr/pfr_pbc_tag.h"
+#include "pfr/pfr_printk.h"
 
 
 #if PF_UPDATE_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_UPDATE, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
 
 
+/**
+ * Buffer for the flash data searched for the compression tag.
+ */
+static uint8_t pbc_tag_window[PFR_PBC_TAG_WINDOW_SIZE];
+
+static int cerberus_pbc_tag_read(void *context, uint32_t address, uint8_t *data, uint32_t length)
+{
+	uint32_t image_type = *(uint32_t *)context;
+
+	return pfr_spi_read(image_type, address, length, data);
+}
+
 /**
     Function Used to Verify whether the compression Tag value is Matched or Not
 
@@ -29,6 +45,15 @@
  **/
 int cerberus_is_compression_tag_matched(uint32_t image_type, uint32_t *compression_tag, uint32_t read_address, uint32_t AreaSize)
 {
+	*compression_tag = *compression_tag + PFM_SIG_BLOCK_SIZE + PFM_SIG_BLOCK_SIZE;
+
+	// Same search as the Intel capsule, a window at a time
+	if (pfr_pbc_tag_find(*compression_tag, read_address + AreaSize, COMPRESSION_TAG,
+			cerberus_pbc_tag_read, &image_type, pbc_tag_window, sizeof(pbc_tag_window),
+			compression_tag))
+		return Failure;
+
+	DEBUG_PRINTF("Tag Found\r\n");
 	return Success;
 }
 
@@ -11,10 +11,11 @@
 #include "state_machine/common_smc.h"
 #include "cerberus_pfr_provision.h"
 #include "pfr/pfr_common.h"
+#include "pfr/pfr_printk.h"
 
 #undef DEBUG_PRINTF
 #if CERBERUS_MANIFEST_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_MANIFEST, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
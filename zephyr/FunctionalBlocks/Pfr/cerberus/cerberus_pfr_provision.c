@@ -11,14 +11,16 @@
 #include "pfr/pfr_common.h"
 #include "cerberus_pfr_definitions.h"
 #include "pfr/pfr_util.h"
+#include "pfr/pfr_ufm.h"
 #include "cerberus_pfr_provision.h"
 #include "cerberus_pfr_verification.h"
 #include "include/SmbusMailBoxCom.h"
 #include "flash/flash_aspeed.h"
+#include "pfr/pfr_printk.h"
 
 #undef DEBUG_PRINTF
 #if PFR_AUTHENTICATION_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_AUTHENTICATION, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -118,7 +120,7 @@ unsigned char CerberusProvisionRootKeyHash(void)
 
 int getCerberusProvisionData(int offset, uint8_t *data, uint32_t length){
 	int status = 0;
-	status = pfr_spi_read(ROT_INTERNAL_INTEL_STATE, offset, length, data);
+	status = ufm_read(PROVISION_UFM, offset, data, length);
 	return status;
 }
 
@@ -183,7 +185,14 @@ int cerberus_provisioning_root_key_action(struct pfr_manifest *manifest){
 
 		uint8_t key_whole_data[data_length];
 		pfr_spi_read(manifest->flash_id, manifest->address + CERBERUS_ROOT_KEY_LENGTH, data_length, key_whole_data);
-		pfr_spi_write(ROT_INTERNAL_INTEL_STATE, CERBERUS_ROOT_KEY_ADDRESS, data_length, key_whole_data);
+		// The root key shares the provisioning sector, so it goes through the UFM cache
+		status = ufm_write(PROVISION_UFM, CERBERUS_ROOT_KEY_ADDRESS, key_whole_data, data_length);
+		if (status != Success)
+			return Failure;
+
+		status = ufm_flush(PROVISION_UFM);
+		if (status != Success)
+			return Failure;
 
 		DEBUG_PRINTF("Provisioning Done.\r\n");
 
@@ -19,9 +19,10 @@
 #include "flash/flash_util.h"
 #include "flash/flash_aspeed.h"
 #include "keystore/KeystoreManager.h"
+#include "pfr/pfr_printk.h"
 
 #if PF_UPDATE_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_UPDATE, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -127,7 +128,9 @@ int pfr_active_recovery_svn_validation(struct pfr_manifest *manifest)
 	return Success;
 }
 
-int pfr_recover_recovery_region(int image_type, uint32_t source_address, uint32_t target_address)
+// The recovery image is always rewritten in full, skip_unchanged is not used
+int pfr_recover_recovery_region(int image_type, uint32_t source_address, uint32_t target_address,
+		bool skip_unchanged)
 {
 	uint8_t status = Success;
 	uint8_t source_flash_id, target_flash_id;
@@ -155,14 +158,10 @@ int pfr_recover_recovery_region(int image_type, uint32_t source_address, uint32_
 	//will remove after provisioning done
 	uint32_t total_image_length = recovery_header.image_length + 0x100 + 0x06;
 	
-	for (int i = 0; i < (total_image_length / PAGE_SIZE); i++) {
-
-		status = pfr_spi_erase_4k(target_flash_id, erase_address);
-		if(status != Success){
-			return Failure;
-		}
-
-		erase_address += PAGE_SIZE;
+	status = pfr_spi_erase_region(target_flash_id, erase_address,
+		(total_image_length / PAGE_SIZE) * PAGE_SIZE);
+	if(status != Success){
+		return Failure;
 	}
 
 	for(int i = 0; i < (total_image_length / PAGE_SIZE); i++){
@@ -219,14 +218,10 @@ int pfr_recover_active_region(struct pfr_manifest *manifest)
 		data_offset = recovery_offset;
 		
 		//erase active region data BMC_FLASH_ID
-		for (int i = 0; i < (section_length / PAGE_SIZE); i++) {
-
-			status = pfr_spi_erase_4k(target_flash_id, erase_address);
-			if(status != Success){
-				return Failure;
-			}
-
-			erase_address += PAGE_SIZE;
+		status = pfr_spi_erase_region(target_flash_id, erase_address,
+			(section_length / PAGE_SIZE) * PAGE_SIZE);
+		if(status != Success){
+			return Failure;
 		}
 
 		//copy data from BMC_RECOVERY_FLASH_ID to BMC_FLASH_ID
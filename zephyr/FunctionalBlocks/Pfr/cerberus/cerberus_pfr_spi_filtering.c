@@ -12,7 +12,7 @@
 #define	ADDR_MASK_3	GENMASK(31, 24)
 #define	ADDR_SHIFT_3	24
 
-void init_SPI_RW_region(int spi_device_id)
+int init_SPI_RW_region(int spi_device_id)
 {
 	int status = 0;
 
@@ -21,6 +21,7 @@ void init_SPI_RW_region(int spi_device_id)
 	struct SpiFilterEngine *spi_filter = getSpiFilterEngineWrapper();
 
 	spi_flash->spi.device_id[0] = spi_device_id;
+	spi_filter->dev_id = spi_device_id;
 
 	int region_id = 1;
 	int region_length;
@@ -87,6 +88,8 @@ void init_SPI_RW_region(int spi_device_id)
 		region_id++;
 	}
 	spi_filter->base.enable_filter(spi_filter, true);
+
+	return 0;
 }
 
 #endif
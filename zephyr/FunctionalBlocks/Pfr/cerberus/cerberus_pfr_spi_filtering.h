@@ -1,6 +1,6 @@
 #ifndef CERBERUS_PFR_SPI_FILTERING_H_
 #define CERBERUS_PFR_SPI_FILTERING_H_
 
-void init_SPI_RW_region(int spi_device_id);
+int init_SPI_RW_region(int spi_device_id);
 
 #endif /*CERBERUS_PFR_SPI_FILTERING_H_*/
@@ -21,11 +21,12 @@
 #include "cerberus_pfr_common.h"
 #include "flash/flash_aspeed.h"
 #include "keystore/KeystoreManager.h"
+#include "pfr/pfr_printk.h"
 
 #define DECOMMISSION_PC_SIZE		128
 
 #if PF_UPDATE_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_UPDATE, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -161,8 +162,12 @@ int cerberus_update_HRoT_recovery_region(void)
 	uint32_t rot_active_address= 0;
 	int status = 0;	
 
+	status = pfr_spi_erase_region(ROT_INTERNAL_RECOVERY, rot_recovery_address,
+		(active_length / PAGE_SIZE) * PAGE_SIZE);
+	if(status != Success)
+		return Failure;
+
 	for(int i = 0; i < (active_length / PAGE_SIZE); i++){
-		pfr_spi_erase_4k(ROT_INTERNAL_RECOVERY, rot_recovery_address);
 		status = pfr_spi_page_read_write_between_spi(ROT_INTERNAL_ACTIVE, &rot_active_address, ROT_INTERNAL_RECOVERY, &rot_recovery_address);
 		if(status != Success)
 			return Failure;
@@ -186,8 +191,12 @@ int cerberus_update_HRoT_active_region(struct pfr_manifest *manifest)
 
 	length = image_section.section_length;
 
+	status = pfr_spi_erase_region(ROT_INTERNAL_ACTIVE, target_address,
+		((length / PAGE_SIZE) + 1) * PAGE_SIZE);
+	if(status != Success)
+		return Failure;
+
 	for(int i = 0; i <= (length / PAGE_SIZE); i++){
-		pfr_spi_erase_4k(ROT_INTERNAL_ACTIVE, target_address);
 		status = pfr_spi_page_read_write_between_spi(BMC_SPI, &source_address, ROT_INTERNAL_ACTIVE, &target_address);
 		if(status != Success)
 			return Failure;
@@ -310,7 +319,7 @@ int cerberus_check_svn_number(struct pfr_manifest *manifest, uint32_t read_addre
 
 int cerberus_update_recovery_region(int image_type, uint32_t source_address, uint32_t target_address)
 {
-	return pfr_recover_recovery_region(image_type, source_address, target_address);
+	return pfr_recover_recovery_region(image_type, source_address, target_address, false);
 }
 
 /******************************
@@ -360,14 +369,10 @@ int cerberus_update_active_region(struct pfr_manifest *manifest, uint8_t target_
 			data_offset = recovery_offset;
 			
 			//erase active region data BMC_FLASH_ID
-			for (int i = 0; i < (section_length / PAGE_SIZE); i++) {
-
-				status = pfr_spi_erase_4k(target_flash, erase_address);
-				if(status != Success){
-					return Failure;
-				}
-
-				erase_address += PAGE_SIZE;
+			status = pfr_spi_erase_region(target_flash, erase_address,
+				(section_length / PAGE_SIZE) * PAGE_SIZE);
+			if(status != Success){
+				return Failure;
 			}
 
 			//copy data from BMC_RECOVERY_FLASH_ID to BMC_FLASH_ID
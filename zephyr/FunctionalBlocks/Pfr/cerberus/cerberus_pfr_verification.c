@@ -8,6 +8,7 @@
 //***********************************************************************//
 #if CONFIG_CERBERUS_PFR_SUPPORT
 #include <stdint.h>
+#include <string.h>
 #include "state_machine/common_smc.h"
 #include "pfr/pfr_common.h"
 #include "include/definitions.h"
@@ -23,10 +24,11 @@
 #include <crypto/rsa.h>
 #include "keystore/KeystoreManager.h"
 #include "engineManager/engine_manager.h"
+#include "pfr/pfr_printk.h"
 
 #undef DEBUG_PRINTF
 #if PFR_AUTHENTICATION_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_AUTHENTICATION, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -74,26 +76,51 @@ int cerberus_pfr_manifest_verify(struct manifest *manifest, struct hash_engine *
 	return status;
 }
 
+/**
+ * Read the public key that follows the PFM.  The header and the key are each read with a single
+ * transaction and the key is parsed from RAM.
+ *
+ * @param public_key Output for the key.
+ *
+ * @return Success if the key was read or Failure if it is malformed.
+ */
 int cerberus_read_public_key(struct rsa_public_key *public_key)
 {	
-	struct flash *flash_device = getFlashDeviceInstance();
 	struct manifest_flash manifestFlash;
-	uint32_t public_key_offset, exponent_offset;
+	uint8_t key_block[sizeof(uint16_t) + RSA_MAX_KEY_LENGTH + sizeof(uint8_t) + sizeof(uint32_t)];
 	uint16_t module_length;
 	uint8_t exponent_length;
+	int status;
+
+	status = pfr_spi_read(0, PFM_FLASH_MANIFEST_ADDRESS, sizeof(manifestFlash.header), &manifestFlash.header);
+	if(status != Success)
+		return Failure;
+
+	// The key can be shorter than the buffer, whatever follows it is ignored
+	status = pfr_spi_read(0, PFM_FLASH_MANIFEST_ADDRESS + manifestFlash.header.length, sizeof(key_block), key_block);
+	if(status != Success)
+		return Failure;
+
+	memcpy(&module_length, key_block, sizeof(module_length));
+	if(module_length > RSA_MAX_KEY_LENGTH){
+		DEBUG_PRINTF("Public key modulus too long: %d\r\n", module_length);
+		return Failure;
+	}
+
+	exponent_length = key_block[sizeof(module_length) + module_length];
+	if(exponent_length > sizeof(public_key->exponent)){
+		DEBUG_PRINTF("Public key exponent too long: %d\r\n", exponent_length);
+		return Failure;
+	}
 
-	pfr_spi_read(0,PFM_FLASH_MANIFEST_ADDRESS, sizeof(manifestFlash.header), &manifestFlash.header);
-	pfr_spi_read(0,PFM_FLASH_MANIFEST_ADDRESS + manifestFlash.header.length, sizeof(module_length), &module_length);
-	public_key_offset = PFM_FLASH_MANIFEST_ADDRESS + manifestFlash.header.length + sizeof(module_length);
 	public_key->mod_length = module_length;
-	
-	pfr_spi_read(0,public_key_offset, public_key->mod_length, public_key->modulus);
-	exponent_offset = public_key_offset + public_key->mod_length;
-	pfr_spi_read(0,exponent_offset, sizeof(exponent_length), &exponent_length);
-	int int_exp_length = (int) exponent_length;
-	pfr_spi_read(0,exponent_offset + sizeof(exponent_length), int_exp_length, &public_key->exponent);
+	memcpy(public_key->modulus, &key_block[sizeof(module_length)], module_length);
 
-	return 0;
+	public_key->exponent = 0;
+	memcpy(&public_key->exponent, &key_block[sizeof(module_length) + module_length + sizeof(exponent_length)],
+		exponent_length);
+
+	return Success;
 }
 
 
@@ -101,7 +128,9 @@ int cerberus_verify_signature(struct signature_verification *verification,
 			 const uint8_t *digest, size_t length, const uint8_t *signature, size_t sig_length)
 {
 	struct rsa_public_key rsa_public;
-	cerberus_read_public_key(&rsa_public);
+	if(cerberus_read_public_key(&rsa_public) != Success)
+		return Failure;
+
 	struct rsa_engine *rsa = getRsaEngineInstance();
 	return rsa->sig_verify(&rsa, &rsa_public, signature, sig_length, digest, length);
 }
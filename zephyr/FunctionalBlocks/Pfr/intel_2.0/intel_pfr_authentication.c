@@ -11,9 +11,10 @@
 #include "intel_pfr_verification.h"
 #include "Smbus_mailbox/Smbus_mailbox.h"
 #include "intel_pfr_provision.h"
+#include "pfr/pfr_printk.h"
 
 #if PF_STATUS_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_STATUS, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -39,6 +39,9 @@
 #define SMBUS_MAILBOX_DEBUG         1
 #define INTEL_MANIFEST_DEBUG        1
 #define EVERY_BOOT_SVN_VALIDATION	1
+// Resets that may skip SPI regions the measurement cache proves unchanged, bit 0: host reset
+// with the SPI filter armed, bit 1: RoT restart.  0 always hashes every region.
+#define MEASUREMENT_CACHE_TRUSTED_RESETS	0x1
 
 #define BMC_SUPPORT                 1
 #define EMULATION_SUPPORT			1
@@ -15,13 +15,17 @@
 #include "flash/flash_aspeed.h"
 #include "pfr/pfr_common.h"
 #include "pfr/pfr_util.h"
+#include "pfr/pfr_ufm.h"
+#include "pfr/pfr_key_cancel.h"
+#include "pfr/pfr_sig_block.h"
 #include <StateMachineAction/StateMachineActions.h>
 #include <gpio/gpio_aspeed.h>
 #include <drivers/misc/aspeed/pfr_aspeed.h>
+#include "pfr/pfr_printk.h"
 
 #undef DEBUG_PRINTF
 #if PFR_AUTHENTICATION_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_AUTHENTICATION, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -49,20 +53,17 @@ int get_cancellation_policy_offset(uint32_t pc_type)
 int validate_key_cancellation_flag(struct pfr_manifest *manifest){
 
     uint32_t status = 0;
-    uint32_t key_id = 0;
-    uint32_t block1_address = manifest->address + sizeof(PFR_AUTHENTICATION_BLOCK0);
 
     if( (manifest->pc_type == CPLD_CAPSULE_CANCELLATION) || (manifest->pc_type == PCH_PFM_CANCELLATION) || (manifest->pc_type == PCH_CAPSULE_CANCELLATION)
         		|| (manifest->pc_type == BMC_PFM_CANCELLATION) || (manifest->pc_type == BMC_CAPSULE_CANCELLATION) ){
     	manifest->kc_flag = TRUE;
     }
     else{
-    	//Read Csk key ID
-        status = pfr_spi_read(manifest->image_type,block1_address + CSK_KEY_ID_ADDRESS, sizeof(key_id), &key_id);
-        if(status != Success)
+    	//Csk key ID from the signature block read by the manifest verification
+        if(!manifest->sig_block->has_csk)
             return Failure;
 
-		status = manifest->keystore->kc_flag->verify_kc_flag(manifest, key_id);
+		status = manifest->keystore->kc_flag->verify_kc_flag(manifest, manifest->sig_block->csk.key_id);
     	if(status != Success)
     		return Failure;
 
@@ -74,78 +75,61 @@ int validate_key_cancellation_flag(struct pfr_manifest *manifest){
     return Success;
 }
 
-int verify_csk_key_id(struct pfr_manifest *manifest, uint32_t key_id)
+/**
+ * Get the key cancellation policy for the images of a protected content type.
+ *
+ * @return The policy or -1 if the content type has no policy.
+ */
+static int get_cancellation_policy(uint32_t pc_type)
 {
+	uint32_t ufm_offset = get_cancellation_policy_offset(pc_type);
 
-	int status = 0;
-	uint32_t ufm_offset = get_cancellation_policy_offset(manifest->pc_type);
+	if(!ufm_offset)
+		return -1;
+
+	return (ufm_offset - KEY_CANCELLATION_POLICY_FOR_SIGNING_PCH_PFM) / CSK_KEY_SIZE;
+}
 
-	uint8_t old_key_id[CSK_KEY_SIZE] = {0};
-	uint8_t new_key_id = 0x80;
+int verify_csk_key_id(struct pfr_manifest *manifest, uint32_t key_id)
+{
+	int policy = get_cancellation_policy(manifest->pc_type);
 
 	if (manifest->pc_type == PFR_PCH_CPU_Seamless_Update_Capsule)
 		return Success;
 
-	if(!ufm_offset)
+	if(policy < 0)
 		 return Failure;
 
-	status = ufm_read(PROVISION_UFM,ufm_offset, old_key_id, sizeof(old_key_id));
-	if (status != Success)
-		return Failure;
-
-	new_key_id = new_key_id >> (key_id % 8) ;
-	if ((key_id / 8) > (CSK_KEY_SIZE - 1)){
+	if (key_id >= PFR_KEY_CANCEL_KEY_IDS){
 		DEBUG_PRINTF("Invalid Key Id\r\n");
 		return Failure;
 	}
 
-	if ((new_key_id & ~(old_key_id[key_id / 8]))){
+	if (pfr_key_cancel_is_cancelled(get_key_cancel_policies(), policy, key_id)){
 		DEBUG_PRINTF("This PFR CSK Key Was cancelled..!Can't Proceed with verify with this key Id: %d\r\n",key_id);
         return Failure;
 	}
 
 	return Success;
-
 }
 
 int cancel_csk_key_id(struct pfr_manifest *manifest, uint32_t key_id)
 {
-	uint32_t ufm_offset = get_cancellation_policy_offset(manifest->pc_type);
-	uint8_t cancellation_byte_old[16] = {0};
-	uint8_t cancellation_byte_new = 1;
-	uint8_t byte_no = 0;
-	uint8_t bit_no = 0;
-
+	int policy = get_cancellation_policy(manifest->pc_type);
 	int status = 0;
 
-	uint8_t policy_data = 0;
-
-    if(!ufm_offset){
+    if(policy < 0){
     	DEBUG_PRINTF("Invalid provisioned UFM offset for key cancellation\r\n");
     	 return Failure;
     }
 
-	byte_no = key_id / 8;
-	bit_no = key_id % 8;
-	ufm_offset = ufm_offset + byte_no;
-
-	//store policy data from flash part
-	status = ufm_read(PROVISION_UFM, ufm_offset, &policy_data, 1);
-	if(status != Success)
-	{
-		DEBUG_PRINTF("ReadCancellationPolicyStatus load cancellation policy fail\r\n");
-		return Failure;
-	}
-
-	policy_data = policy_data & ~(0x80 >> bit_no);
-	
-	status = ufm_write(PROVISION_UFM, ufm_offset, &policy_data, 1);
-	if(status != Success)
+	// The policy in RAM is only updated once flash holds the cancelled key
+	status = pfr_key_cancel_cancel(get_key_cancel_policies(), policy, key_id);
+	if(status != 0)
 	{
 		DEBUG_PRINTF("ReadCancellationPolicyStatus write cancellation policy fail");
 		return Failure;
 	}
 
 	return Success;
-
 }
@@ -6,18 +6,40 @@
 //*                                                                     *//
 //***********************************************************************//
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include "state_machine/common_smc.h"
 #include "intel_pfr_definitions.h"
+#include "pfr/pfr_common.h"
+#include "pfr/pfr_util.h"
+#include "pfr/pfr_pbc_plan.h"
+#include "pfr/pfr_pbc_tag.h"
+#include "CommonFlash/CommonFlash.h"
+#include "flash/flash_util.h"
+#include "Common.h"
+#include "pfr/pfr_printk.h"
 
 
 #if PF_UPDATE_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_UPDATE, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
 
 
+/**
+ * Buffer for the flash data searched for the compression tag.
+ */
+static uint8_t pbc_tag_window[PFR_PBC_TAG_WINDOW_SIZE];
+
+static int pbc_tag_read(void *context, uint32_t address, uint8_t *data, uint32_t length)
+{
+	uint32_t image_type = *(uint32_t *)context;
+
+	return pfr_spi_read(image_type, address, length, data);
+}
+
 /**
     Function Used to Verify whether the compression Tag value is Matched or Not
 
@@ -29,70 +51,179 @@
 **/
 int is_compression_tag_matched(uint32_t image_type, uint32_t *compression_tag,uint32_t read_address,uint32_t AreaSize)
 {
-    uint32_t tag = 0;
     *compression_tag = *compression_tag + PFM_SIG_BLOCK_SIZE + PFM_SIG_BLOCK_SIZE;// Adding PFR Size
-    //Loop To verify the Tag.
-    while ((*compression_tag <= (read_address + AreaSize) - 4))
-    {
-    	if( pfr_spi_read(image_type, *compression_tag, sizeof(tag), (uint8_t *)&tag) )
-    		return Failure;
-        if (tag == COMPRESSION_TAG)
-        {
-            DEBUG_PRINTF("Tag Found\r\n"); 
-            return Success;
-        }
-        *compression_tag += 1;
-    }
 
-    return Failure;
+    // Search the capsule a window at a time instead of reading 4 bytes at every offset
+    if (pfr_pbc_tag_find(*compression_tag, read_address + AreaSize, COMPRESSION_TAG, pbc_tag_read,
+            &image_type, pbc_tag_window, sizeof(pbc_tag_window), compression_tag))
+        return Failure;
+
+    DEBUG_PRINTF("Tag Found\r\n");
+    return Success;
 }
 
 /**
- * Function Used to Erase the Active Area based on the BitMap.
- * @param - N - Size
- * @param - ActiveMapAddress - Location od the Bitmap.
- * @return - Success or Failure
+ * Erase sizes the BMC and PCH flash drivers can issue.
  */
+#define PBC_ERASE_SIZES			(PFR_PBC_ERASE_4K | PFR_PBC_ERASE_64K)
+
+/**
+ * Largest pair of bitmaps that can be loaded, enough for a 128MB flash.
+ */
+#define PBC_MAX_BITMAP_SIZE		PFR_PBC_BITMAP_SIZE((128 * 1024 * 1024) / PFR_PBC_PAGE_SIZE)
+
+static uint8_t pbc_bitmaps[2 * PBC_MAX_BITMAP_SIZE];
+
+/**
+ * Pages where the active region already holds the data the capsule would write.
+ */
+static uint8_t pbc_unchanged[PBC_MAX_BITMAP_SIZE];
+
+#define PBC_PAGE_BIT(page)		(0x80 >> ((page) & 7))
+
+struct pbc_copy_context {
+	uint32_t image_type;
+	uint32_t payload_address;
+	const uint8_t *unchanged_map;
+};
+
+static int pbc_erase(void *context, uint32_t address, uint32_t length)
+{
+	uint32_t image_type = *(uint32_t *)context;
+
+	if (length == 0x10000)
+		return pfr_spi_erase_64k(image_type, address);
+
+	return pfr_spi_erase_4k(image_type, address);
+}
+
+static int pbc_copy(void *context, uint32_t payload_offset, uint32_t address, uint32_t length)
+{
+	struct pbc_copy_context *copy = (struct pbc_copy_context *)context;
+	uint32_t source_address = copy->payload_address + payload_offset;
+	uint8_t buffer[PFR_PBC_PAGE_SIZE];
+	uint32_t page;
+	int status;
+
+	// Each run of pages is copied in one pass, a page at a time
+	while (length) {
+		page = address / PFR_PBC_PAGE_SIZE;
+		if (!copy->unchanged_map || !(copy->unchanged_map[page / 8] & PBC_PAGE_BIT(page))) {
+			status = pfr_spi_read(copy->image_type, source_address, sizeof(buffer), buffer);
+			if (status != Success)
+				return Failure;
+
+			status = pfr_spi_write(copy->image_type, address, sizeof(buffer), buffer);
+			if (status != Success)
+				return Failure;
+		}
+
+		source_address += sizeof(buffer);
+		address += sizeof(buffer);
+		length -= sizeof(buffer);
+	}
+
+	return Success;
+}
+
+static int pbc_compare(void *context, uint32_t payload_offset, uint32_t address, uint32_t length)
+{
+	struct pbc_copy_context *copy = (struct pbc_copy_context *)context;
+	struct SpiEngine *spi_flash = getSpiEngineWrapper();
+	uint32_t source_address = copy->payload_address + payload_offset;
+	uint32_t page;
+	int status;
+
+	spi_flash->spi.device_id[0] = copy->image_type;
+
+	while (length) {
+		status = flash_hash_verify_copy_ext(&spi_flash->spi.base, address, &spi_flash->spi.base,
+			source_address, PFR_PBC_PAGE_SIZE, get_hash_engine_instance());
+		if (status == 0) {
+			page = address / PFR_PBC_PAGE_SIZE;
+			pbc_unchanged[page / 8] |= PBC_PAGE_BIT(page);
+		}
+		else if (status != FLASH_UTIL_DATA_MISMATCH) {
+			return Failure;
+		}
+
+		source_address += PFR_PBC_PAGE_SIZE;
+		address += PFR_PBC_PAGE_SIZE;
+		length -= PFR_PBC_PAGE_SIZE;
+	}
+
+	return Success;
+}
+
+/**
+    Function Used to find the pages of the Active Area that already match the capsule. Matching
+    pages are removed from the Active Bit Map so they are neither erased nor written.
+
+    @Param uint32_t		Number of pages covered by the bit maps
+    @Param uint32_t		Address of the compressed payload
+	@Param uint8_t *    	Active Bit Map, updated to the pages that must be erased
+	@Param uint8_t *    	Compression Bit Map
+
+    @retval int		Return Status
+**/
+int decompression_find_unchanged(uint32_t image_type, uint32_t pages, uint32_t payload_address,
+		uint8_t *active_map, const uint8_t *compression_map)
+{
+	struct SpiEngine *spi_flash = getSpiEngineWrapper();
+	struct pbc_copy_context context = {
+		.image_type = image_type,
+		.payload_address = payload_address,
+	};
+	struct pfr_pbc_run run;
+	uint32_t next = 0;
+	uint32_t page;
+	uint32_t i;
+
+	memset(pbc_unchanged, 0, PFR_PBC_BITMAP_SIZE(pages));
+
+	// Pages that will be written must already hold the payload data
+	if (pfr_pbc_plan_copy(compression_map, pages, pbc_compare, &context) != Success)
+		return Failure;
+
+	// Pages that are only erased must already be blank
+	spi_flash->spi.device_id[0] = image_type;
+	while (pfr_pbc_next_run(active_map, pages, &next, &run)) {
+		for (page = run.first_page; page < (run.first_page + run.page_count); page++) {
+			if (compression_map[page / 8] & PBC_PAGE_BIT(page))
+				continue;
+
+			if (flash_blank_check(&spi_flash->spi.base, page * PFR_PBC_PAGE_SIZE,
+					PFR_PBC_PAGE_SIZE) == 0)
+				pbc_unchanged[page / 8] |= PBC_PAGE_BIT(page);
+		}
+	}
+
+	for (i = 0; i < PFR_PBC_BITMAP_SIZE(pages); i++)
+		active_map[i] &= ~pbc_unchanged[i];
+
+	return Success;
+}
+
 /**
     Function Used to Erase the Active Area based on the BitMap
 
-    @Param uint32_t		Size
-	@Param uint32_t    	Active Bit Map Address
+    @Param uint32_t		Number of pages covered by the bit map
+	@Param uint8_t *    	Active Bit Map
 
     @retval int		Return Status
 **/
-int decompression_erasing(uint32_t image_type, uint32_t N,uint32_t active_map_address)
+int decompression_erasing(uint32_t image_type, uint32_t pages, const uint8_t *active_map)
 {
-	int status = 0;
-    uint32_t index0 = 0;
-	int8_t index1 = 0;
-	uint8_t bit_map_data = 0;
-	uint32_t erase_offset = 0;
-	
-    // Loop To Erase the data in destination chip based on the Active Buffer data
+	int status;
+
+    // Erase the pages set in the active bit map, using 64KB erases where whole blocks are set
     DEBUG_PRINTF("Erasing...\r\n");
-    for (index0 = 0; index0 < N/8; index0++)
-    {
-        status = pfr_spi_read(image_type, active_map_address, sizeof(uint8_t), (uint8_t *)&bit_map_data);
-        if(status != Success){
-    		DEBUG_PRINTF("Decompression Erase failed\r\n");
-    		return Failure;
-    	}
-       
-        active_map_address += 1;
-        for (index1 = 7; index1 >= 0; index1--)
-        {
-            if ((bit_map_data >> index1) & 1)
-            {
-            	status = pfr_spi_erase_4k(image_type, erase_offset);
-        		if(status != Success){
-        			DEBUG_PRINTF("Decompression Erase failed\r\n");
-        			return Failure;
-        		}
-            }
-            erase_offset += PAGE_SIZE;
-        }
-    }
+	status = pfr_pbc_plan_erase(active_map, pages, PBC_ERASE_SIZES, pbc_erase, &image_type);
+	if (status != Success) {
+		DEBUG_PRINTF("Decompression Erase failed\r\n");
+		return Failure;
+	}
+
     DEBUG_PRINTF("Erase Successful\r\n");
     return Success;
 }
@@ -101,41 +232,27 @@ int decompression_erasing(uint32_t image_type, uint32_t N,uint32_t active_map_ad
 /**
     Function Used to Write the Compressed Data based on the Bit Map
 
-    @Param uint32_t     	Size
-    @Param uint32_t     	Compression Tag
-    @Param uint32_t     	Compression Map Address
+    @Param uint32_t     	Number of pages covered by the bit map
+    @Param uint32_t     	Address of the compressed payload
+    @Param uint8_t *     	Compression Bit Map
+    @Param uint8_t *     	Pages to skip because they already hold the data, or NULL
 
     @retval int			Return Status
 **/
-int decompression_write(uint32_t image_type, uint32_t N,uint32_t compression_tag,uint32_t compression_map_address)
+int decompression_write(uint32_t image_type, uint32_t pages, uint32_t payload_address,
+		const uint8_t *compression_map, const uint8_t *unchanged_map)
 {
-	int status = 0;
-    uint8_t bit_map_data = 0;
-	uint32_t index0 = 0;
-	int8_t index1 = 0;
-	uint32_t erase_offset = 0;
-	
-    //Loop to Write the Data in destination Chip Based on the Compression Buffer data
+	struct pbc_copy_context context = {
+		.image_type = image_type,
+		.payload_address = payload_address,
+		.unchanged_map = unchanged_map,
+	};
+
+    //Copy the pages set in the compression bit map from the payload to the destination chip
     DEBUG_PRINTF("Writing...\r\n");
-    for (index0 = 0; index0 < N/8; index0++)
-    {
-    	status = pfr_spi_read(image_type, compression_map_address,sizeof(uint8_t), (uint8_t *)&bit_map_data);
-    	if(status != Success)
-    	   	return Failure;
-    
-    	compression_map_address += 1;
-        for (index1 = 7; index1 >= 0; index1--)
-        {
-			if ((bit_map_data >> index1) & 1){
-			    status = pfr_spi_page_read_write(image_type, &compression_tag,&erase_offset);
-			    if(status != Success)
-			    	return Failure;
-			}
-			else {
-				erase_offset += PAGE_SIZE;
-			}
-        }
-    }
+	if (pfr_pbc_plan_copy(compression_map, pages, pbc_copy, &context) != Success)
+		return Failure;
+
     return Success;
 }
 
@@ -144,15 +261,19 @@ int decompression_write(uint32_t image_type, uint32_t N,uint32_t compression_tag
 
     @Param uint32_t     	Read Address
     @Param uint32_t     	Total size need to Decompress
+    @Param bool     	Compare the destination first and skip the pages that already match.
+    			Only worth it for a repair, where most pages are unchanged
 
     @retval int		Return Status
 **/
-int capsule_decompression(uint32_t image_type, uint32_t read_address,uint32_t area_size)
+int capsule_decompression(uint32_t image_type, uint32_t read_address,uint32_t area_size,
+		bool skip_unchanged)
 {
+    const uint8_t *unchanged_map = NULL;
     int status = 0;
     uint32_t compression_tag = read_address;
     uint32_t N = 0;
-    uint32_t bit_map_address = 0;
+    uint32_t bit_map_size = 0;
     
     if(is_compression_tag_matched(image_type, &compression_tag, read_address,area_size))
     {
@@ -169,18 +290,40 @@ int capsule_decompression(uint32_t image_type, uint32_t read_address,uint32_t ar
 	}
 
     compression_tag += 108;
-    bit_map_address = compression_tag;
 
-    status = decompression_erasing(image_type, N,bit_map_address);
+    // The active and compression bit maps are stored back to back, load both in one read
+    bit_map_size = N / 8;
+    if (bit_map_size > PBC_MAX_BITMAP_SIZE) {
+		DEBUG_PRINTF("Decompression bit map too large\r\n");
+		return Failure;
+	}
+
+    status = pfr_spi_read(image_type, compression_tag, 2 * bit_map_size, pbc_bitmaps);
     if(status != Success){
+		DEBUG_PRINTF("Decompression failed\r\n");
 		return Failure;
 	}
 
-    compression_tag += N/8;
-    bit_map_address = compression_tag;
-    compression_tag += N/8;
+    compression_tag += 2 * bit_map_size;
+
+    // Skip pages that already match, so repairing a few corrupted sectors only touches those
+    if (skip_unchanged) {
+		status = decompression_find_unchanged(image_type, bit_map_size * 8, compression_tag,
+			pbc_bitmaps, &pbc_bitmaps[bit_map_size]);
+		if(status != Success){
+			DEBUG_PRINTF("Decompression compare failed\r\n");
+			return Failure;
+		}
+		unchanged_map = pbc_unchanged;
+	}
+
+    status = decompression_erasing(image_type, bit_map_size * 8, pbc_bitmaps);
+    if(status != Success){
+		return Failure;
+	}
 
-	status = decompression_write(image_type, N,compression_tag,bit_map_address);
+	status = decompression_write(image_type, bit_map_size * 8, compression_tag,
+		&pbc_bitmaps[bit_map_size], unchanged_map);
 	if(status != Success){
 		DEBUG_PRINTF("Decompression write failed\r\n");
 		return Failure;
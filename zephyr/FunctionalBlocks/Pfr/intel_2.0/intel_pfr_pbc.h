@@ -9,6 +9,9 @@
 #ifndef INTEL_PFR_PBC_H_
 #define INTEL_PFR_PBC_H_
 
-int capsule_decompression(int image_type, uint32_t read_address,uint32_t area_size);
+#include <stdbool.h>
+
+int capsule_decompression(int image_type, uint32_t read_address,uint32_t area_size,
+		bool skip_unchanged);
 
 #endif /*INTEL_PFR_PBC_H_*/
\ No newline at end of file
@@ -11,10 +11,16 @@
 #include "state_machine/common_smc.h"
 #include "intel_pfr_provision.h"
 #include "pfr/pfr_common.h"
+#include "pfr/pfr_util.h"
+#include "pfr/pfr_pfm_index.h"
+#include "pfr/pfr_measurement_cache.h"
+#include "pfr/pfr_ufm.h"
+#include "intel_pfr_verification.h"
+#include "pfr/pfr_printk.h"
 
 #undef DEBUG_PRINTF
 #if INTEL_MANIFEST_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_MANIFEST, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -27,6 +33,9 @@ uint8_t g_active_pfm_svn = 0;
 ProtectLevelMask pch_protect_level_mask_count;
 ProtectLevelMask bmc_protect_level_mask_count;
 
+// Parsed active PFM of each image, indexed by image type
+static struct pfr_pfm_index pfm_index[2];
+
 int pfm_spi_region_verification(struct pfr_manifest *manifest);
 Manifest_Status get_pfm_manifest_data(struct pfr_manifest *manifest, uint32_t *position,void *spi_definition, uint8_t *pfm_spi_hash, uint8_t pfm_definition);
 
@@ -151,6 +160,26 @@ int read_statging_area_pfm(struct pfr_manifest *manifest, uint8_t *svn_version)
     return Success;
 }
 
+// Select the region hash to check: the image curve digest when both are present
+static int spi_region_hash_select(struct pfr_manifest *manifest, PFM_SPI_DEFINITION *PfmSpiDefinition, uint32_t *hash_type, uint32_t *hash_offset) {
+
+	uint8_t sha256_present = PfmSpiDefinition->HashAlgorithmInfo.SHA256HashPresent;
+	uint8_t sha384_present = PfmSpiDefinition->HashAlgorithmInfo.SHA384HashPresent;
+
+	// SHA-256 hash is stored ahead of the SHA-384 hash when both are present
+	if(sha384_present && (!sha256_present || manifest->hash_curve == secp384r1)){
+		*hash_type = HASH_TYPE_SHA384;
+		*hash_offset = sha256_present ? SHA256_SIZE : 0;
+	}else if(sha256_present){
+		*hash_type = HASH_TYPE_SHA256;
+		*hash_offset = 0;
+	}else{
+		return Failure;
+	}
+
+	return Success;
+}
+
 int spi_region_hash_verification(struct pfr_manifest *pfr_manifest, PFM_SPI_DEFINITION *PfmSpiDefinition, uint8_t *pfm_spi_Hash) {
 
 	int status = 0;
@@ -163,25 +192,25 @@ int spi_region_hash_verification(struct pfr_manifest *pfr_manifest, PFM_SPI_DEFI
     if((PfmSpiDefinition->HashAlgorithmInfo.SHA256HashPresent == 1 ) ||
             (PfmSpiDefinition->HashAlgorithmInfo.SHA384HashPresent == 1)){
     	
-		uint8_t sha256_buffer[SHA384_DIGEST_LENGTH] = {0};
-		uint32_t hash_length = 0;		
+		uint8_t sha_buffer[SHA384_DIGEST_LENGTH] = {0};
+		uint32_t hash_length = 0;
+		uint32_t hash_type = 0;
+		uint32_t hash_offset = 0;
+
+		status = spi_region_hash_select(pfr_manifest, PfmSpiDefinition, &hash_type, &hash_offset);
+		if(status != Success)
+			return Failure;
 
 		pfr_manifest->pfr_hash->start_address = PfmSpiDefinition->RegionStartAddress;
 		pfr_manifest->pfr_hash->length = region_length;
-			
-        if( PfmSpiDefinition->HashAlgorithmInfo.SHA256HashPresent == 1){
-        	pfr_manifest->pfr_hash->type = HASH_TYPE_SHA256;
-			hash_length = SHA256_DIGEST_LENGTH;
-		} else if(PfmSpiDefinition->HashAlgorithmInfo.SHA384HashPresent ==1 ){
-			pfr_manifest->pfr_hash->type = HASH_TYPE_SHA384;
-			hash_length = SHA384_DIGEST_LENGTH;
-		}else{
+		pfr_manifest->pfr_hash->type = hash_type;
+		hash_length = (hash_type == HASH_TYPE_SHA384) ? SHA384_DIGEST_LENGTH : SHA256_DIGEST_LENGTH;
+
+		status = pfr_manifest->base->get_hash(pfr_manifest, pfr_manifest->hash, sha_buffer, hash_length);
+		if(status != Success)
 			return Failure;
-		}
 
-		pfr_manifest->base->get_hash(pfr_manifest,pfr_manifest->hash,sha256_buffer, SHA256_DIGEST_LENGTH);
-			
-		status = compare_buffer(pfm_spi_Hash, sha256_buffer,SHA256_DIGEST_LENGTH);
+		status = compare_buffer(pfm_spi_Hash, sha_buffer, hash_length);
         if(status != Success){
 			return Failure;
 			
@@ -193,6 +222,96 @@ int spi_region_hash_verification(struct pfr_manifest *pfr_manifest, PFM_SPI_DEFI
     return Success;
 }
 
+static int pfm_index_read(void *context, uint32_t address, uint8_t *data, uint32_t length)
+{
+	uint32_t image_type = *(uint32_t *)context;
+
+	return pfr_spi_read(image_type, address, length, data);
+}
+
+// The PFM index is keyed by the protected content digest in Block 0, which is covered by the PFM signature
+static int pfm_index_read_block0(uint32_t image_type, uint32_t pfm_address, PFR_AUTHENTICATION_BLOCK0 *block0)
+{
+	int status = 0;
+
+	status = pfr_spi_read(image_type, pfm_address, sizeof(PFR_AUTHENTICATION_BLOCK0), (uint8_t *)block0);
+	if(status != Success)
+		return Failure;
+
+	if(block0->Block0Tag != INTEL_PFR_BLOCK_0_TAG)
+		return Failure;
+
+	return Success;
+}
+
+struct pfr_pfm_index *get_pfm_index(uint32_t image_type)
+{
+	return &pfm_index[(image_type == PCH_TYPE) ? PCH_TYPE : BMC_TYPE];
+}
+
+/**
+ * Get the index of an active PFM if it was built from the PFM currently in flash.
+ *
+ * @param image_type BMC_TYPE or PCH_TYPE.
+ * @param pfm_read_address Address of the PFM signature block.
+ *
+ * @return The index or NULL if the PFM must be parsed from flash.
+ */
+struct pfr_pfm_index *get_verified_pfm_index(uint32_t image_type, uint32_t pfm_read_address)
+{
+	struct pfr_pfm_index *index = get_pfm_index(image_type);
+	PFR_AUTHENTICATION_BLOCK0 block0;
+	const uint8_t *key;
+
+	if(!pfr_pfm_index_matches(index, pfm_read_address + PFM_SIG_BLOCK_SIZE, NULL, 0))
+		return NULL;
+
+	if(pfm_index_read_block0(image_type, pfm_read_address, &block0) != Success)
+		return NULL;
+
+	key = (index->key_length == SHA384_SIZE) ? block0.Sha384Pc : block0.Sha256Pc;
+	if(!pfr_pfm_index_matches(index, pfm_read_address + PFM_SIG_BLOCK_SIZE, key, index->key_length))
+		return NULL;
+
+	return index;
+}
+
+// Build the index of a verified active PFM, or reuse it if the PFM has not changed
+static struct pfr_pfm_index *pfm_index_load(struct pfr_manifest *manifest)
+{
+	struct pfr_pfm_index *index = get_pfm_index(manifest->image_type);
+	uint32_t pfm_address = manifest->address + PFM_SIG_BLOCK_SIZE;
+	PFR_AUTHENTICATION_BLOCK0 block0;
+	const uint8_t *key;
+	size_t key_length;
+	int status = 0;
+
+	if(pfm_index_read_block0(manifest->image_type, manifest->address, &block0) != Success){
+		pfr_pfm_index_invalidate(index);
+		return NULL;
+	}
+
+	if(manifest->hash_curve == secp384r1){
+		key = block0.Sha384Pc;
+		key_length = SHA384_SIZE;
+	}else{
+		key = block0.Sha256Pc;
+		key_length = SHA256_SIZE;
+	}
+
+	if(pfr_pfm_index_matches(index, pfm_address, key, key_length))
+		return index;
+
+	status = pfr_pfm_index_build(index, pfm_address, manifest->hash_curve == secp384r1, key, key_length,
+			pfm_index_read, &manifest->image_type);
+	if(status != 0){
+		DEBUG_PRINTF("PFM index not built: %d\r\n", status);
+		return NULL;
+	}
+
+	return index;
+}
+
 int get_fvm_start_address (struct pfr_manifest *manifest, uint32_t *fvm_address) {
 
 	int status = 0;
@@ -225,8 +344,16 @@ int get_fvm_address(struct pfr_manifest *manifest, uint16_t fv_type) {
 	PFM_FVM_ADDRESS_DEFINITION pfm_definition = {0};
 	uint8_t pfm_definition_type = PCH_PFM_FVM_ADDRESS_DEFINITION;
 	uint8_t *pfm_hash;
+	struct pfr_pfm_index *index;
+	const struct pfr_pfm_fvm *fvm;
 	region_count = 0;
 
+	index = get_verified_pfm_index(manifest->image_type, manifest->address);
+	if (index != NULL) {
+		fvm = pfr_pfm_index_find_fvm(index, fv_type);
+		return (fvm != NULL) ? fvm->address : Failure;
+	}
+
 	for (position = 0; position <= g_pfm_manifest_length - 1; region_count++){
 		status = get_pfm_manifest_data(manifest, &position, (void *)&pfm_definition, (uint8_t *)&pfm_hash, pfm_definition_type);
 		if(status == manifest_failure){
@@ -241,24 +368,30 @@ int get_fvm_address(struct pfr_manifest *manifest, uint16_t fv_type) {
 
 	}
 
-	return 0;
+	return Failure;
 }
 
 int get_spi_region_hash(struct pfr_manifest *manifest, uint32_t address, PFM_SPI_DEFINITION *p_spi_definition, uint8_t *pfm_spi_hash, uint8_t pfm_definition) {
 	int status = 0;
+	uint32_t hash_type = 0;
+	uint32_t hash_offset = 0;
+	uint32_t hash_size = 0;
 
-	if (p_spi_definition->HashAlgorithmInfo.SHA256HashPresent == 1) {
-		if(p_spi_definition->PFMDefinitionType == pfm_definition)
-			status = pfr_spi_read(manifest->image_type, address, SHA256_SIZE, pfm_spi_hash);
-		
-		return SHA256_SIZE;
-	} else if (p_spi_definition->HashAlgorithmInfo.SHA384HashPresent == 1) {
-		if(p_spi_definition->PFMDefinitionType == pfm_definition)
-			status = pfr_spi_read(manifest->image_type, address, SHA384_SIZE, pfm_spi_hash);
-		return SHA384_SIZE;
+	if (spi_region_hash_select(manifest, p_spi_definition, &hash_type, &hash_offset) != Success)
+		return 0;
+
+	if(p_spi_definition->PFMDefinitionType == pfm_definition){
+		status = pfr_spi_read(manifest->image_type, address + hash_offset,
+				(hash_type == HASH_TYPE_SHA384) ? SHA384_SIZE : SHA256_SIZE, pfm_spi_hash);
 	}
 
-	return 0;
+	// Skip every hash stored with the definition
+	if (p_spi_definition->HashAlgorithmInfo.SHA256HashPresent == 1)
+		hash_size += SHA256_SIZE;
+	if (p_spi_definition->HashAlgorithmInfo.SHA384HashPresent == 1)
+		hash_size += SHA384_SIZE;
+
+	return hash_size;
 }
 
 void set_protect_level_mask_count(struct pfr_manifest *manifest, PFM_SPI_DEFINITION *spi_definition)
@@ -374,6 +507,78 @@ Manifest_Status get_pfm_manifest_data(struct pfr_manifest *manifest, uint32_t *p
 
 }
 
+// Verify the SPI regions from the PFM index instead of reading each definition from flash.  Read
+// only regions the measurement cache proves unchanged since they were last verified are skipped.
+static int pfm_index_spi_region_verification(struct pfr_manifest *manifest, struct pfr_pfm_index *index)
+{
+	int status = 0;
+	const struct pfr_pfm_spi_region *region;
+	PFM_SPI_DEFINITION pfm_spi_definition;
+	struct pfr_measurement_cache *cache;
+	size_t hash_length;
+	size_t i;
+
+	g_pfm_manifest_length = index->length;
+	g_active_pfm_svn = index->svn;
+
+	cache = get_measurement_cache(manifest->image_type);
+	if ((cache != NULL) && (pfr_measurement_cache_select(cache, index->key, index->key_length) != 0))
+		cache = NULL;
+
+	for (i = 0; i < index->spi_region_count; i++){
+		region = &index->spi_region[i];
+
+		memset(&pfm_spi_definition, 0, sizeof(PFM_SPI_DEFINITION));
+		pfm_spi_definition.PFMDefinitionType = PCH_PFM_SPI_REGION;
+		memcpy(&pfm_spi_definition.ProtectLevelMask, &region->protect_level_mask, sizeof(uint8_t));
+		pfm_spi_definition.HashAlgorithmInfo.SHA256HashPresent = (region->hash_type == PFR_PFM_INDEX_HASH_SHA256);
+		pfm_spi_definition.HashAlgorithmInfo.SHA384HashPresent = (region->hash_type == PFR_PFM_INDEX_HASH_SHA384);
+		pfm_spi_definition.RegionStartAddress = region->start_address;
+		pfm_spi_definition.RegionEndAddress = region->end_address;
+
+		set_protect_level_mask_count(manifest, &pfm_spi_definition);
+
+		// The SPI monitor only logs blocked requests, so writable regions are always hashed
+		hash_length = (region->hash_type == PFR_PFM_INDEX_HASH_SHA384) ? SHA384_SIZE : SHA256_SIZE;
+		if ((region->protect_level_mask & PFR_PFM_INDEX_WRITE_ALLOWED) ||
+				(region->hash_type == PFR_PFM_INDEX_HASH_NONE)){
+			hash_length = 0;
+		}
+
+		if ((cache != NULL) && (hash_length != 0) && pfr_measurement_cache_is_clean(cache,
+				region->start_address, region->end_address, region->hash, hash_length)){
+			continue;
+		}
+
+		status = spi_region_hash_verification(manifest, &pfm_spi_definition, (uint8_t *)region->hash);
+		if(status != Success){
+			DEBUG_PRINTF("SPI region hash verification fail...\r\n");
+			pfr_pfm_index_invalidate(index);
+			if (cache != NULL)
+				pfr_measurement_cache_clear(cache);
+			return Failure;
+		}
+
+		if ((cache != NULL) && (hash_length != 0)){
+			if (pfr_measurement_cache_update(cache, region->start_address, region->end_address,
+					region->hash, hash_length) != 0){
+				DEBUG_PRINTF("No room to cache SPI region measurement\r\n");
+			}
+		}
+	}
+
+	if ((cache != NULL) && (pfr_measurement_cache_commit(cache) != 0))
+		DEBUG_PRINTF("Failed to store SPI region measurements\r\n");
+
+	if (manifest->image_type == PCH_TYPE){
+		pch_protect_level_mask_count.Calculated = 1;
+	}else{
+		bmc_protect_level_mask_count.Calculated = 1;
+	}
+
+	return Success;
+}
+
 int pfm_spi_region_verification(struct pfr_manifest *manifest)
 {	
 	int status = 0;
@@ -383,8 +588,13 @@ int pfm_spi_region_verification(struct pfr_manifest *manifest)
     uint8_t pfm_definition_type = PCH_PFM_SPI_REGION;
     uint8_t pfm_spi_hash[SHA384_SIZE] = {0};
 	uint8_t fvm_region_count = 0;
+	struct pfr_pfm_index *index;
     
 	region_count = 0;
+
+	index = pfm_index_load(manifest);
+	if (index != NULL)
+		return pfm_index_spi_region_verification(manifest, index);
     
     for (position = 0; position <= g_pfm_manifest_length - 1; region_count++){
     	verify_status = get_pfm_manifest_data(manifest, &position, (void *)&pfm_spi_definition, (uint8_t *)&pfm_spi_hash, pfm_definition_type);
@@ -461,7 +671,7 @@ Manifest_Status get_fvm_manifest_data(struct pfr_manifest *manifest, uint32_t *p
 
 		*position += sizeof(PFM_SPI_DEFINITION);
 
-		*position += get_spi_region_Hhash((uint32_t)(manifest_start_address + *position), (PFM_SPI_DEFINITION *)spi_definition, fvm_spi_hash, fvm_def_type);
+		*position += get_spi_region_hash(manifest, (uint32_t)(manifest_start_address + *position), (PFM_SPI_DEFINITION *)spi_definition, fvm_spi_hash, fvm_def_type);
 
 	} else if (fvm_definition_type == PCH_FVM_Capabilities) {
 
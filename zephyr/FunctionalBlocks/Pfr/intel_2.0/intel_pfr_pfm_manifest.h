@@ -10,6 +10,7 @@
 #define INTEL_PFR_PFM_VERIFICATION_H_
 
 #include <stdint.h>
+#include "pfr/pfr_pfm_index.h"
 
 #pragma pack(1)
 
@@ -148,6 +149,9 @@ extern uint32_t g_fvm_manifest_length;
 extern ProtectLevelMask pch_protect_level_mask_count;
 extern ProtectLevelMask bmc_protect_level_mask_count;
 
+struct pfr_pfm_index *get_pfm_index(uint32_t image_type);
+struct pfr_pfm_index *get_verified_pfm_index(uint32_t image_type, uint32_t pfm_read_address);
+
 // int pfm_spi_region_verification(struct pfr_manifest *manifest);
 // Manifest_Status get_pfm_manifest_data(struct pfr_manifest *manifest, uint32_t *position,void *spi_definition, uint8_t *pfm_spi_hash, uint8_t pfm_definition);
 
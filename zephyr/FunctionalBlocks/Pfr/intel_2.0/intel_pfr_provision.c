@@ -13,10 +13,11 @@
 #include "pfr/pfr_util.h"
 #include "intel_pfr_provision.h" 
 #include "intel_pfr_verification.h" 
+#include "pfr/pfr_printk.h"
 
 #undef DEBUG_PRINTF
 #if PFR_AUTHENTICATION_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_AUTHENTICATION, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -7,6 +7,7 @@
 //***********************************************************************//
 #if CONFIG_INTEL_PFR_SUPPORT
 #include "pfr/pfr_common.h"
+#include "pfr/pfr_util.h"
 #include "state_machine/common_smc.h"
 #include "intel_pfr_recovery.h"
 #include "manifest/pfm/pfm_manager.h"
@@ -15,9 +16,11 @@
 #include "intel_pfr_verification.h"
 #include "CommonFlash/CommonFlash.h"
 #include "flash/flash_util.h"
+#include "Common.h"
+#include "pfr/pfr_printk.h"
 
 #if PF_UPDATE_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_UPDATE, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -60,10 +63,23 @@ int pfr_active_recovery_svn_validation(struct pfr_manifest *manifest){
     return Success;
 }
 
-int pfr_recover_recovery_region(int image_type,uint32_t source_address,uint32_t target_address)
+/**
+    Function to copy the staging image to the recovery region
+
+    @Param int		Image type, BMC_TYPE or PCH_TYPE
+    @Param uint32_t	Staging address
+    @Param uint32_t	Recovery region address
+    @Param bool		Compare each sector first and skip the ones that already match.
+    			Only worth it for a repair, where most sectors are unchanged
+
+    @retval int		Return Status
+**/
+int pfr_recover_recovery_region(int image_type,uint32_t source_address,uint32_t target_address,
+		bool skip_unchanged)
 {   
     int status = 0;
     uint32_t area_size = 0;
+    size_t updated = 0;
     struct SpiEngine *spi_flash = getSpiEngineWrapper();
 
     if(image_type == BMC_TYPE)
@@ -74,13 +90,20 @@ int pfr_recover_recovery_region(int image_type,uint32_t source_address,uint32_t
     spi_flash->spi.device_id[0] = image_type; // assign the flash device id,  0:spi1_cs0, 1:spi2_cs0 , 2:spi2_cs1, 3:spi2_cs2, 4:fmc_cs0, 5:fmc_cs1
     DEBUG_PRINTF("Recovering...");
 
-	status = flash_copy_and_verify(&spi_flash->spi, target_address, source_address, area_size);
+	if (skip_unchanged) {
+		// Only sectors that differ from the staging image are erased and programmed
+		status = flash_sector_copy_changed_and_verify(&spi_flash->spi, target_address,
+			source_address, area_size, get_hash_engine_instance(), &updated);
+	} else {
+		status = flash_copy_and_verify(&spi_flash->spi, target_address, source_address, area_size);
+		updated = area_size / PAGE_SIZE;
+	}
 	if(status != Success){
         DEBUG_PRINTF("Recovery region update failed\r\n");  
         return Failure;
     }
 		
-    DEBUG_PRINTF("Recovery region update completed\r\n");
+    DEBUG_PRINTF("Recovery region update completed, %d sectors updated\r\n", (int) updated);
 
     return Success;
 }
@@ -107,7 +130,8 @@ int pfr_recover_active_region(struct pfr_manifest *manifest){
         return Failure;
     }
 
-    status = capsule_decompression(manifest->image_type, read_address, area_size);
+    // A repair usually finds most pages intact, compare before rewriting
+    status = capsule_decompression(manifest->image_type, read_address, area_size, true);
     if (status != Success){
         DEBUG_PRINTF("Repair Failed\r\n");
         return Failure;
@@ -224,23 +248,10 @@ int pfr_staging_pch_staging(struct pfr_manifest *manifest){
     manifest->address = target_address;
     manifest->image_type = image_type;
 
-	uint32_t erase_address = target_address;
-
-	for (int i = 0; i < (area_size / PAGE_SIZE); i++) {
-
-		status = pfr_spi_erase_4k(manifest->image_type, erase_address);
-		if(status != Success){
-			return Failure;
-		}
-
-		erase_address += PAGE_SIZE;
-	}
-
-	for(int i = 0; i < (area_size / PAGE_SIZE); i++){
-        status = pfr_spi_page_read_write_between_spi(BMC_TYPE, &source_address,PCH_TYPE, &target_address);
-		if (status != Success)
-			return Failure;
-	}
+	// The staging area is erased as it is copied
+	status = pfr_spi_copy_between_spi(BMC_TYPE, source_address, PCH_TYPE, target_address, area_size);
+	if (status != Success)
+		return Failure;
 
 	if (manifest->state == RECOVERY) {
         DEBUG_PRINTF("PCH staging region verification\r\n");
@@ -3,28 +3,74 @@
 #include <Common.h>
 #include "intel_pfr_definitions.h"
 #include "intel_pfr_provision.h"
+#include "intel_pfr_pfm_manifest.h"
+#include <device.h>
+#include <drivers/misc/aspeed/pfr_aspeed.h>
+#include <spi_filter/spi_filter_aspeed.h>
+#include "pfr/pfr_measurement_cache.h"
+#include "pfr/pfr_ufm.h"
+#include "pfr/pfr_spi_filter.h"
+
+static char *spim_devs[4] = {
+	"spi_m1",
+	"spi_m2",
+	"spi_m3",
+	"spi_m4"
+};
+
+/**
+ * Privilege table access for one SPI monitor.
+ */
+struct spim_filter_regs {
+	struct pfr_spi_filter_regs base;
+	char *dev_name;
+};
+
+static int spim_filter_regs_read(struct pfr_spi_filter_regs *regs, int table, uint32_t first,
+				 uint32_t *values, size_t count)
+{
+	struct spim_filter_regs *spim = (struct spim_filter_regs *)regs;
+
+	return Get_SPI_Filter_Priv_Table(spim->dev_name, table, first, values, count);
+}
 
-void init_SPI_RW_region(int spi_device_id)
+static int spim_filter_regs_write(struct pfr_spi_filter_regs *regs, int table, uint32_t first,
+				  const uint32_t *values, size_t count)
 {
+	struct spim_filter_regs *spim = (struct spim_filter_regs *)regs;
 
-	int status = 0;
-	static char *spim_devs[4] = {
-		"spi_m1",
-		"spi_m2",
-		"spi_m3",
-		"spi_m4"
+	return Set_SPI_Filter_Priv_Table(spim->dev_name, table, first, values, count);
+}
+
+/**
+ * Program the SPI monitor of a host with the regions of its active PFM.
+ *
+ * The privilege tables are built from the full region list first and then programmed in a single
+ * pass, writing only the registers that change, and read back to verify them.  Regions that are
+ * not writable in the PFM are write protected, including any left over from an older PFM.
+ *
+ * @param spi_device_id 0 for the BMC or 1 for the PCH.
+ *
+ * @return 0 if the filter was programmed and enabled or an error code.  The filter is left
+ * disabled on failure, so the host must not be released.
+ */
+int init_SPI_RW_region(int spi_device_id)
+{
+	static struct pfr_spi_filter_tables tables;
+	struct spim_filter_regs regs = {
+		.base = {
+			.read = spim_filter_regs_read,
+			.write = spim_filter_regs_write,
+		},
+		.dev_name = spim_devs[spi_device_id],
 	};
+	int status = 0;
 
 	status = SpiFilterInit(getSpiFilterEngineWrapper());
 	struct SpiFilterEngine *spi_filter = getSpiFilterEngineWrapper();
 	spi_filter->dev_id = spi_device_id;                           // 0: BMC , 1: PCH
 
-	// read PFR_Manifest
-	// status = initializeEngines();
-	// status = initializeManifestProcessor();
-
 	struct SpiEngine *spi_flash = getSpiEngineWrapper();
-	uint8_t *data;
 	uint8_t pfm_length[4];
 	uint32_t pfm_read_address;
 	if (spi_device_id == 0) {
@@ -34,56 +80,117 @@ void init_SPI_RW_region(int spi_device_id)
 		get_provision_data_in_flash(PCH_ACTIVE_PFM_OFFSET, &pfm_read_address, sizeof(pfm_read_address));
 	}
 
-	// printk("pfm_read_address is %08x \n", pfm_read_address);
-
 	uint32_t pfm_region_Start = pfm_read_address + 0x400 + 0x20; // Block 0 + Block 1 = 1024 (0x400); PFM data(PFM Body = 0x20)
 	int default_region_length = 16;
 	uint32_t region_start_address;
 	uint32_t region_end_address;
 	uint32_t addr_size_of_pfm = pfm_read_address + 0x400 + 0x1c; // Table 2-14  get Length
-	int region_length;
-	int region_id = 1;                                           // cerberus define region_id start from 1
 	uint8_t region_record[16];
+	struct pfr_pfm_index *index;
+	size_t i;
 	spi_flash->spi.device_id[0] = spi_device_id;                 // assign the flash device id,  0:spi1_cs0, 1:spi2_cs0 , 2:spi2_cs1, 3:spi2_cs2, 4:fmc_cs0, 5:fmc_cs1
-	spi_flash->spi.base.read(&spi_flash->spi, addr_size_of_pfm, pfm_length, 4);
-
-	int pfm_record_length = (pfm_length[0] & 0xff) | (pfm_length[1] << 8 & 0xff00) | (pfm_length[2] << 16 & 0xff0000) | (pfm_length[3] << 24 & 0xff000000);
 
-	while (true) {
-		spi_flash->spi.base.read(&spi_flash->spi, pfm_region_Start, region_record, default_region_length);
-		if (region_record[0] == 0x01) {
-			if ((region_record[1] & 0x02) == 0x02) {
-				region_start_address = (region_record[8] & 0xff) | (region_record[9] << 8 & 0xff00) | (region_record[10] << 16 & 0xff0000) | (region_record[11] << 24 & 0xff000000);
-				region_end_address = (region_record[12] & 0xff) | (region_record[13] << 8 & 0xff00) | (region_record[14] << 16 & 0xff0000) | (region_record[15] << 24 & 0xff000000);
-				region_length = region_end_address - region_start_address;
-				spi_filter->base.set_filter_rw_region(&spi_filter->base, region_id, region_start_address, region_end_address);
-				region_id++;
+	pfr_spi_filter_tables_init(&tables);
 
-			}
+	// The PFM was parsed when it was verified, so use its index instead of reading every definition again
+	index = get_verified_pfm_index((spi_device_id == 0) ? BMC_TYPE : PCH_TYPE, pfm_read_address);
+	if (index != NULL) {
+		for (i = 0; i < index->spi_region_count; i++) {
+			pfr_spi_filter_tables_add_region(&tables, index->spi_region[i].start_address,
+				index->spi_region[i].end_address,
+				index->spi_region[i].protect_level_mask & PFR_PFM_INDEX_READ_ALLOWED,
+				index->spi_region[i].protect_level_mask & PFR_PFM_INDEX_WRITE_ALLOWED);
+		}
+	} else {
+		spi_flash->spi.base.read(&spi_flash->spi, addr_size_of_pfm, pfm_length, 4);
 
-			if ((region_record[1] & 0x01) != 0x01) {
+		int pfm_record_length = (pfm_length[0] & 0xff) | (pfm_length[1] << 8 & 0xff00) | (pfm_length[2] << 16 & 0xff0000) | (pfm_length[3] << 24 & 0xff000000);
 
+		while (true) {
+			spi_flash->spi.base.read(&spi_flash->spi, pfm_region_Start, region_record, default_region_length);
+			if (region_record[0] == 0x01) {
 				region_start_address = (region_record[8] & 0xff) | (region_record[9] << 8 & 0xff00) | (region_record[10] << 16 & 0xff0000) | (region_record[11] << 24 & 0xff000000);
 				region_end_address = (region_record[12] & 0xff) | (region_record[13] << 8 & 0xff00) | (region_record[14] << 16 & 0xff0000) | (region_record[15] << 24 & 0xff000000);
-				region_length = region_end_address - region_start_address;
-				Set_SPI_Filter_RW_Region(spim_devs[spi_device_id], SPI_FILTER_READ_PRIV, SPI_FILTER_PRIV_DIABLE, region_start_address, region_length);  // Cerberus did not support read disabled
-
-			}
-
-			if ((region_record[2] & 0x01) == 0x01) {
-				pfm_region_Start = pfm_region_Start + 48;
+				pfr_spi_filter_tables_add_region(&tables, region_start_address, region_end_address,
+					region_record[1] & 0x01, region_record[1] & 0x02);
+
+				if ((region_record[2] & 0x01) == 0x01) {
+					pfm_region_Start = pfm_region_Start + 48;
+				} else {
+					pfm_region_Start = pfm_region_Start + 16;
+				}
 			} else {
-				pfm_region_Start = pfm_region_Start + 16;
+				break;
+			}
+			if (pfm_region_Start > pfm_read_address + 0x400 + pfm_record_length) {
+				break;
 			}
-		} else {
-			break;
-		}
-		if (pfm_region_Start > pfm_read_address + 0x400 + pfm_record_length) {
-			break;
 		}
 	}
 
+	status = pfr_spi_filter_program(&regs.base, &tables);
+	if (status != 0) {
+		printk("SPI filter programming failed for %s: %d\n", spim_devs[spi_device_id], status);
+		return status;
+	}
+
 	spi_filter->base.enable_filter(spi_filter, true);
 
+	return 0;
+}
+
+/**
+ * Apply the requests the SPI monitor of a host blocked since the last call to the measurement
+ * cache of its image, then drop the measurements if the policy does not trust the reset.
+ *
+ * Consumed log entries are cleared, so the next slot still being set means the log wrapped and
+ * some entries were lost.  The cache is dropped in that case since any region may have changed.
+ *
+ * @param spi_device_id 0 for the BMC or 1 for the PCH.
+ * @param reset The reset that led to the verification, PFR_MEASUREMENT_CACHE_HOST_RESET or
+ * PFR_MEASUREMENT_CACHE_ROT_RESET.
+ */
+void apply_spi_monitor_log(int spi_device_id, uint32_t reset)
+{
+	// Log RAM is cleared when the RoT boots, so every monitor starts at the first entry
+	static uint32_t log_cursor[2];
+	struct pfr_measurement_cache *cache;
+	const struct device *dev;
+	struct spim_log_info info;
+	uint32_t entries;
+	uint32_t entry;
+
+	cache = get_measurement_cache((spi_device_id == 0) ? BMC_TYPE : PCH_TYPE);
+	if (cache == NULL)
+		return;
+
+	dev = device_get_binding(spim_devs[spi_device_id]);
+	if (dev == NULL) {
+		pfr_measurement_cache_clear(cache);
+		return;
+	}
+
+	spim_get_log_info(dev, &info);
+	entries = info.log_max_sz / sizeof(uint32_t);
+	if ((entries == 0) || (info.log_idx_reg >= entries)) {
+		pfr_measurement_cache_clear(cache);
+		return;
+	}
+
+	while (log_cursor[spi_device_id] != info.log_idx_reg) {
+		if (spim_log_read(dev, log_cursor[spi_device_id], &entry, 1) ||
+		    spim_log_clear(dev, log_cursor[spi_device_id], 1)) {
+			pfr_measurement_cache_clear(cache);
+			return;
+		}
+		pfr_measurement_cache_log_event(cache, entry);
+
+		log_cursor[spi_device_id] = (log_cursor[spi_device_id] + 1) % entries;
+	}
+
+	if (spim_log_read(dev, info.log_idx_reg, &entry, 1) || (entry != 0))
+		pfr_measurement_cache_clear(cache);
+
+	pfr_measurement_cache_reset(cache, reset, MEASUREMENT_CACHE_TRUSTED_RESETS);
 }
 #endif
\ No newline at end of file
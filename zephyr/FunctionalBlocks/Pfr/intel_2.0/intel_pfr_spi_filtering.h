@@ -1,6 +1,9 @@
 #ifndef INTEL_PFR_SPI_FILTERING_H_
 #define INTEL_PFR_SPI_FILTERING_H_
 
-void init_SPI_RW_region(int spi_device_id);
+#include <stdint.h>
+
+int init_SPI_RW_region(int spi_device_id);
+void apply_spi_monitor_log(int spi_device_id, uint32_t reset);
 
 #endif /*INTEL_PFR_SPI_FILTERING_H_*/
@@ -10,6 +10,9 @@
 #include "StateMachineAction/StateMachineActions.h"
 #include "state_machine/common_smc.h" 
 #include "pfr/pfr_common.h"
+#include "pfr/pfr_util.h"
+#include "pfr/pfr_ufm.h"
+#include "pfr/pfr_svn.h"
 #include "intel_pfr_definitions.h"
 #include "include/SmbusMailBoxCom.h"
 #include "intel_pfr_verification.h"
@@ -18,9 +21,10 @@
 #include "StateMachineAction/StateMachineActions.h"
 #include "intel_pfr_pfm_manifest.h"
 #include "flash/flash_aspeed.h"
+#include "pfr/pfr_printk.h"
 
 #if PF_UPDATE_DEBUG
-#define DEBUG_PRINTF printk
+#define DEBUG_PRINTF(...) PFR_PRINTK(PFR_PRINTK_UPDATE, __VA_ARGS__)
 #else
 #define DEBUG_PRINTF(...)
 #endif
@@ -108,23 +112,26 @@ int intel_pfr_update_verify (struct firmware_image *fw, struct hash_engine *hash
     return pfr_staging_verify(pfr_manifest);
 }
 
+/**
+ * Map an SVN policy offset in the provisioning UFM to its policy.
+ */
+static int svn_policy_from_offset(uint8_t offset)
+{
+	return (offset - SVN_POLICY_FOR_CPLD_UPDATE) / PFR_SVN_BITMAP_SIZE;
+}
+
 int set_ufm_svn(struct pfr_manifest *manifest, uint8_t ufm_location, uint8_t svn_number){
 	
+	struct pfr_svn *svn = get_svn_policies();
 	int status = 0;
-	uint8_t svn_buffer[8];
-    uint8_t offset = svn_number / 8;
-    uint8_t remain = svn_number % 8;
-    uint8_t index = 0;
-
-    memset(svn_buffer,0xFF,sizeof(svn_buffer));
-    for (index = 0; index < offset;index ++){
-        svn_buffer[index] = 0x00;
-    }
 
-	svn_buffer[index] = svn_buffer[index] << remain;
-	
-    status = ufm_write (PROVISION_UFM,ufm_location,svn_buffer,sizeof(svn_buffer));
-    if(status != Success)
+	status = pfr_svn_advance(svn, svn_policy_from_offset(ufm_location), svn_number);
+	if(status != 0)
+		return Failure;
+
+	// Commit the new SVN right away so a power loss can't roll it back
+	status = pfr_svn_commit(svn);
+	if(status != 0)
 		return Failure;
 
 	return Success;
@@ -132,20 +139,9 @@ int set_ufm_svn(struct pfr_manifest *manifest, uint8_t ufm_location, uint8_t svn
 
 int get_ufm_svn(struct pfr_manifest *manifest, uint8_t offset){
 	
-	uint8_t svn_size = 8; // we have (0- 63) SVN Number in 64 bits
-    uint8_t svn_buffer[8];
-    uint8_t svn_number = 0 ,index1 = 0,index2 = 0;
-    uint8_t mask = 0x01;
-    
-    ufm_read(PROVISION_UFM, offset, svn_buffer, sizeof(svn_buffer));
-    for (index1 = 0; index1 < svn_size;index1 ++){
-        for (index2 = 0; index2 < svn_size; index2 ++){
-            if (/*!*/((svn_buffer[index1] >> index2) & mask)){
-                return svn_number;
-            }
-            svn_number ++;
-        }
-    }
+	uint8_t svn_number = 0;
+
+	pfr_svn_get(get_svn_policies(), svn_policy_from_offset(offset), &svn_number);
 
 	return svn_number;
 }
@@ -220,19 +216,16 @@ int update_rot_fw(uint32_t address, uint32_t length){
 	uint32_t rot_active_address= 0;
 	uint32_t active_length = 0x60000;
 
-	for(int i = 0; i < (active_length / PAGE_SIZE); i++){
-		pfr_spi_erase_4k(ROT_INTERNAL_RECOVERY, rot_recovery_address);
-		status = pfr_spi_page_read_write_between_spi(ROT_INTERNAL_ACTIVE, &rot_active_address, ROT_INTERNAL_RECOVERY, &rot_recovery_address);
-		if(status != Success)
-			return Failure;
-	}
+	status = pfr_spi_copy_between_spi(ROT_INTERNAL_ACTIVE, rot_active_address, ROT_INTERNAL_RECOVERY,
+		rot_recovery_address, active_length);
+	if(status != Success)
+		return Failure;
 
-	for(int i = 0; i <= (length / PAGE_SIZE); i++){
-		pfr_spi_erase_4k(ROT_INTERNAL_ACTIVE, target_address);
-		status = pfr_spi_page_read_write_between_spi(BMC_SPI, &source_address, ROT_INTERNAL_ACTIVE, &target_address);
-		if(status != Success)
-			return Failure;
-	}
+	// The page holding the end of the image is copied in full
+	status = pfr_spi_copy_between_spi(BMC_SPI, source_address, ROT_INTERNAL_ACTIVE, target_address,
+		((length / PAGE_SIZE) + 1) * PAGE_SIZE);
+	if(status != Success)
+		return Failure;
 
 	return Success;
 }
@@ -364,7 +357,7 @@ int check_svn_number(struct pfr_manifest *manifest, uint32_t read_address, uint8
 }
 
 int update_recovery_region(int image_type,uint32_t source_address,uint32_t target_address){
-    return pfr_recover_recovery_region(image_type,source_address,target_address);
+    return pfr_recover_recovery_region(image_type,source_address,target_address,false);
 }
 
 int update_firmware_image(uint32_t image_type, void* EventContext)
@@ -482,7 +475,8 @@ int update_firmware_image(uint32_t image_type, void* EventContext)
 		//Active Update
 		DEBUG_PRINTF("Active Region Update\r\n");
 
-		status = capsule_decompression(pfr_manifest->image_type, source_address/* + PFM_SIG_BLOCK_SIZE + PFM_SIG_BLOCK_SIZE + PfmLength*/, area_size);
+		status = capsule_decompression(pfr_manifest->image_type, source_address/* + PFM_SIG_BLOCK_SIZE + PFM_SIG_BLOCK_SIZE + PfmLength*/, area_size,
+			false);
 		if(status != Success)
 			return Failure;
 
@@ -26,7 +26,7 @@ static int HashStartSha256 (struct hash_engine *Engine)
 static int HashCalculateSha384 (struct hash_engine *Engine, const uint8_t *Data,
 	size_t Length, uint8_t *Hash, size_t HashLength)
 {
-    return HashEngineCalculateSha384(Data, Length, Hash, HashLength);;
+    return HashEngineCalculateSha384(Data, Length, Hash, HashLength);
 }
 
 static int HashStartSha384 (struct hash_engine *Engine){
@@ -39,6 +39,16 @@ static int HashUpdate (struct hash_engine *Engine, const uint8_t *Data, size_t L
     return HashEngineUpdate(Data, Length);
 }
 
+static int HashUpdateAsync (struct hash_engine *Engine, const uint8_t *Data, size_t Length)
+{
+    return HashEngineUpdateAsync(Data, Length);
+}
+
+static int HashUpdateWait (struct hash_engine *Engine)
+{
+    return HashEngineWait();
+}
+
 static int HashFinish (struct hash_engine *Engine, uint8_t *Hash, size_t HashLength)
 {
     return HashEngineFinish(Hash, HashLength);
@@ -72,6 +82,8 @@ int HashInitialize (struct hash_engine *Engine)
 	Engine->update = HashUpdate;
 	Engine->finish = HashFinish;
 	Engine->cancel = HashCancel;
+	Engine->update_async = HashUpdateAsync;
+	Engine->update_wait = HashUpdateWait;
 
 	return 0;
 }
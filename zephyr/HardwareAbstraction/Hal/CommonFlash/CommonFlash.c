@@ -198,6 +198,21 @@ int SpiFlashChipErase (struct spi_flash *flash)
 	return Wrapper_spi_flash_chip_erase(flash);
 }
 
+/**
+ * Erase a region of flash with the fewest erase commands.
+ *
+ * @param flash The flash to erase.
+ * @param start_addr The starting address of the region to erase.  The erase starts at the
+ * beginning of the sector that contains it.
+ * @param length The number of bytes to erase starting from start_addr.
+ *
+ * @return 0 if the region was erased or an error code.
+ */
+int SpiFlashEraseRegion (struct spi_flash *flash, uint32_t start_addr, size_t length)
+{
+	return Wrapper_spi_flash_erase_region(flash, start_addr, length);
+}
+
 /**
  * Erase the Flash Init.
  *
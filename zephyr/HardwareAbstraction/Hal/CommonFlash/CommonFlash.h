@@ -42,5 +42,6 @@ do {												\
 } while (0)
 int FlashInit(struct SpiEngine *Spi, struct FlashMaster *Engine);
 int FlashMasterInit(struct FlashMaster *spi);
+int SpiFlashEraseRegion(struct spi_flash *flash, uint32_t start_addr, size_t length);
 
 #endif /* FLASH_COMMON_H_ */
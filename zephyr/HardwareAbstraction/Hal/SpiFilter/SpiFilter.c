@@ -358,7 +358,8 @@ int ClearFlashDirtyState(struct spi_filter_interface *ilter)
 int GetFilterRwRegion(struct spi_filter_interface *Filter, uint8_t Region,
 	uint32_t *StartAddress, uint32_t *EndAddress)
 {
-	return SpiGetFilterRwRegion(Region,StartAddress,EndAddress);
+	return SpiGetFilterRwRegion(((struct SpiFilterEngine *) Filter)->dev_id, Region, StartAddress,
+		EndAddress);
 }
 
 /**
@@ -375,7 +376,8 @@ int GetFilterRwRegion(struct spi_filter_interface *Filter, uint8_t Region,
 int SetFilterRwRegion(struct spi_filter_interface *Filter, uint8_t Region,
 	uint32_t StartAddress, uint32_t EndAddress)
 {
-	return SpiSetFilterRwRegion(Region,StartAddress,EndAddress);
+	return SpiSetFilterRwRegion(((struct SpiFilterEngine *) Filter)->dev_id, Region, StartAddress,
+		EndAddress);
 }
 
 /**
@@ -387,7 +389,7 @@ int SetFilterRwRegion(struct spi_filter_interface *Filter, uint8_t Region,
  */
 int ClearFilterRwRegions(struct spi_filter_interface *Filter)
 {
-	return SpiClearFilterRwRegions();
+	return SpiClearFilterRwRegions(((struct SpiFilterEngine *) Filter)->dev_id);
 }
 /**
  *  Initialize SpiFilter
@@ -9,9 +9,10 @@
 #include <crypto/ecdsa.h>
 #include <zephyr.h>
 
-int aspeed_ecdsa_verify_middlelayer(uint8_t *public_key_x, uint8_t *public_key_y,
-				    const uint8_t *digest, uint8_t *signature_r,
-				    uint8_t *signature_s)
+#ifdef CONFIG_ECDSA_ASPEED
+int aspeed_ecdsa_verify_middlelayer(int curve_id, uint32_t length, uint8_t *public_key_x,
+				    uint8_t *public_key_y, const uint8_t *digest,
+				    uint8_t *signature_r, uint8_t *signature_s)
 {
 	int status = 0;
 	const struct device *dev = device_get_binding(ECDSA_DRV_NAME);
@@ -19,26 +20,26 @@ int aspeed_ecdsa_verify_middlelayer(uint8_t *public_key_x, uint8_t *public_key_y
 	struct ecdsa_pkt pkt;
 	struct ecdsa_key ek;
 
-	ek.curve_id = ECC_CURVE_NIST_P256;
+	if (dev == NULL)
+		return -ENODEV;
+
+	ek.curve_id = curve_id;
 	ek.qx = public_key_x;
 	ek.qy = public_key_y;
 	pkt.m = digest;
 	pkt.r = signature_r;
 	pkt.s = signature_s;
-	pkt.m_len = 32;
-	pkt.r_len = 32;
-	pkt.s_len = 32;
+	pkt.m_len = length;
+	pkt.r_len = length;
+	pkt.s_len = length;
 	status = ecdsa_begin_session(dev, &ini, &ek);
 	if (status) {
 		printk("ecdsa_begin_session fail: %d\r\n", status);
+		return status;
 	}
 	status = ecdsa_verify(&ini, &pkt);
-	if (status) {
-		printk("Fail\r\n");
-	} else {
-		printk("Success\r\n");
-	}
 	ecdsa_free_session(dev, &ini);
 
 	return status;
 }
+#endif
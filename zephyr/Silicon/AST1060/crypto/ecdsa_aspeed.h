@@ -5,4 +5,4 @@
 #include <crypto/ecdsa.h>
 #include <zephyr.h>
 
-int aspeed_ecdsa_verify_middlelayer(uint8_t *public_key_x, uint8_t *public_key_y, const uint8_t *digest, uint8_t *signature_r, uint8_t *signature_s);
\ No newline at end of file
+int aspeed_ecdsa_verify_middlelayer(int curve_id, uint32_t length, uint8_t *public_key_x, uint8_t *public_key_y, const uint8_t *digest, uint8_t *signature_r, uint8_t *signature_s);
@@ -51,6 +51,7 @@ int hash_engine_sha_calculate(enum hash_algo algo, const uint8_t *data, size_t l
 	}
 
 	hash_free_session(dev, &hashParams.ctx);        // free hash engine
+	hashParams.sessionReady = 0;                    // session is released, next calculation must begin a new one
 
 	return ret;
 }
@@ -72,10 +73,13 @@ int hash_engine_start(enum hash_algo algo)
 	const struct device *dev;       // hash engine driver
 	int ret;
 
-	memset(&hashParams, 0, sizeof(hashParams));             // clear all the hash internal parameters
-
 	dev = device_get_binding(HASH_DRV_NAME);                // retrieves hash driver device info
 
+	if (hashParams.ctx.drv_sessn_state)
+		hash_free_session(dev, &hashParams.ctx);        // release the session of a hash that was never finished
+
+	memset(&hashParams, 0, sizeof(hashParams));             // clear all the hash internal parameters
+
 	ret = hash_begin_session(dev, &hashParams.ctx, algo);   // initializes hash engine
 
 	if (!ret)
@@ -103,6 +107,35 @@ int hash_engine_update(const uint8_t *data, size_t length)
 	return status;
 }
 
+/**
+ * @brief Start updating the current hash operation with a block of data without waiting for the
+ * hash engine to complete.
+ *
+ * The data buffer must not be modified until hash_engine_wait is called.
+ *
+ * @param data The data that should be added to generate the final hash.
+ * @param length The length of the data.
+ *
+ * @return 0 if the hash operation was started successfully or an error code.
+ */
+int hash_engine_update_async(const uint8_t *data, size_t length)
+{
+	hashParams.pkt.in_buf = (uint8_t *)data;                        // plaint text info
+	hashParams.pkt.in_len = length;                                 // plaint text size
+
+	return hash_update_async(&hashParams.ctx, &hashParams.pkt);     // start hash engine without waiting
+}
+
+/**
+ * @brief Wait for the hash update started by hash_engine_update_async to complete.
+ *
+ * @return 0 if the hash operation was updated successfully or an error code.
+ */
+int hash_engine_wait(void)
+{
+	return hash_wait(&hashParams.ctx);
+}
+
 /**
  * @brief Complete the current hash operation and get the calculated digest.
  *
@@ -51,6 +51,8 @@ void hash_engine_function_test(void);     // hash functions testing
 int hash_engine_sha_calculate(enum hash_algo algo, const uint8_t *data, size_t length, uint8_t *hash, size_t hash_length);
 int hash_engine_start(enum hash_algo algo);
 int hash_engine_update(const uint8_t *data, size_t length);
+int hash_engine_update_async(const uint8_t *data, size_t length);
+int hash_engine_wait(void);
 int hash_engine_finish(uint8_t *hash, size_t hash_length);
 void hash_engine_cancel(void);
 
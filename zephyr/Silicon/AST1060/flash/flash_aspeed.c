@@ -30,6 +30,39 @@ static char *Flash_Devices_List[6] = {
 	"fmc_cs1"
 };
 
+#define ROT_PARTITION_COUNT     (ROT_INTERNAL_LOG - ROT_INTERNAL_ACTIVE + 1)
+
+/*
+ * Devices and partitions are resolved once and reused for every transfer.
+ * device_get_binding() is a linear string compare over all devices and
+ * flash_area_read() repeats that lookup internally, which adds up over the
+ * tens of thousands of reads issued while hashing a BMC/PCH image.
+ */
+static const struct device *flash_devices[ARRAY_SIZE(Flash_Devices_List)];
+static const struct flash_area *flash_partitions[ROT_PARTITION_COUNT];
+
+#ifdef CONFIG_SPI_DMA_SUPPORT_ASPEED
+/*
+ * SPI DMA requires both the flash address and the RAM address to be 4-byte
+ * aligned, the length is free. Aligned reads land directly in the caller
+ * buffer, anything else is staged through this buffer.
+ */
+#define SPI_DMA_ALIGN_MASK      0x3
+#define SPI_DMA_BOUNCE_SIZE     4096
+
+static uint8_t dma_bounce_buf[SPI_DMA_BOUNCE_SIZE] __aligned(4);
+K_MUTEX_DEFINE(dma_bounce_lock);
+#endif
+
+/*
+ * Program data is staged through one static buffer rather than the caller's
+ * stack, so small threads such as the log flusher can write to flash.
+ */
+#define SPI_PROGRAM_BUF_SIZE    4096
+
+static char program_buf[SPI_PROGRAM_BUF_SIZE];
+K_MUTEX_DEFINE(program_buf_lock);
+
 static void Data_dump_buf(uint8_t *buf, uint32_t len)
 {
 	uint32_t i;
@@ -42,18 +75,168 @@ static void Data_dump_buf(uint8_t *buf, uint32_t len)
 	printk("\n");
 }
 
+static const struct device *get_flash_device(uint8_t DeviceId)
+{
+	if (DeviceId >= ARRAY_SIZE(Flash_Devices_List))
+		return NULL;
+
+	if (flash_devices[DeviceId] == NULL)
+		flash_devices[DeviceId] = device_get_binding(Flash_Devices_List[DeviceId]);
+
+	return flash_devices[DeviceId];
+}
+
+static const struct flash_area *get_flash_partition(uint8_t DeviceId)
+{
+	uint8_t area_id;
+	int index;
+
+	if (DeviceId < ROT_INTERNAL_ACTIVE || DeviceId > ROT_INTERNAL_LOG)
+		return NULL;
+
+	index = DeviceId - ROT_INTERNAL_ACTIVE;
+	if (flash_partitions[index] != NULL)
+		return flash_partitions[index];
+
+	switch (DeviceId) {
+	case ROT_INTERNAL_ACTIVE:
+		area_id = FLASH_AREA_ID(active);
+		break;
+	case ROT_INTERNAL_RECOVERY:
+		area_id = FLASH_AREA_ID(recovery);
+		break;
+	case ROT_INTERNAL_STATE:
+		area_id = FLASH_AREA_ID(state);
+		break;
+	case ROT_INTERNAL_INTEL_STATE:
+		area_id = FLASH_AREA_ID(intel_state);
+		break;
+	case ROT_INTERNAL_KEY:
+		area_id = FLASH_AREA_ID(key);
+		break;
+	default:
+		area_id = FLASH_AREA_ID(log);
+		break;
+	}
+
+	if (flash_area_open(area_id, &flash_partitions[index]))
+		flash_partitions[index] = NULL;
+
+	return flash_partitions[index];
+}
+
+/**
+ * Read from a flash device straight into the caller's buffer.
+ *
+ * When SPI DMA is enabled, requests that do not meet the DMA alignment rules
+ * are split into aligned chunks and copied out of a bounce buffer.
+ */
+static int SPI_Flash_Read_Direct(const struct device *flash_device, uint32_t address,
+				 uint8_t *data, uint32_t length)
+{
+#ifdef CONFIG_SPI_DMA_SUPPORT_ASPEED
+	uint32_t aligned_addr, head, chunk;
+	int ret = 0;
+
+	if ((((uint32_t)data | address) & SPI_DMA_ALIGN_MASK) == 0)
+		return flash_read(flash_device, address, data, length);
+
+	k_mutex_lock(&dma_bounce_lock, K_FOREVER);
+	while (length && !ret) {
+		aligned_addr = address & ~SPI_DMA_ALIGN_MASK;
+		head = address - aligned_addr;
+		chunk = MIN(length, SPI_DMA_BOUNCE_SIZE - head);
+
+		/* Stop at the end of the request, it may be the end of the device */
+		ret = flash_read(flash_device, aligned_addr, dma_bounce_buf, head + chunk);
+		if (!ret)
+			memcpy(data, &dma_bounce_buf[head], chunk);
+
+		address += chunk;
+		data += chunk;
+		length -= chunk;
+	}
+	k_mutex_unlock(&dma_bounce_lock);
+
+	return ret;
+#else
+	return flash_read(flash_device, address, data, length);
+#endif
+}
+
+/**
+ * Bind every flash device and open every RoT partition used by PFR.
+ *
+ * Runs once at boot so that the first image verification does not pay for
+ * the lookups. Devices that fail to bind here are retried on first use.
+ */
+int SPI_Device_Init(void)
+{
+	uint8_t DeviceId;
+
+	for (DeviceId = 0; DeviceId < ARRAY_SIZE(Flash_Devices_List); DeviceId++) {
+		if (get_flash_device(DeviceId) == NULL)
+			LOG_WRN("%s is not available", Flash_Devices_List[DeviceId]);
+	}
+
+	for (DeviceId = ROT_INTERNAL_ACTIVE; DeviceId <= ROT_INTERNAL_LOG; DeviceId++) {
+		if (get_flash_partition(DeviceId) == NULL)
+			LOG_WRN("RoT partition %d is not available", DeviceId);
+	}
+
+	return 0;
+}
+
+static int SPI_Device_Sys_Init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return SPI_Device_Init();
+}
+
+SYS_INIT(SPI_Device_Sys_Init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+int SPI_Flash_Read(uint8_t DeviceId, uint32_t address, uint8_t *data, uint32_t length)
+{
+	const struct flash_area *partition_device;
+	const struct device *flash_device;
+
+	if (data == NULL)
+		return -EINVAL;
+
+	if (DeviceId == BMC_SPI || DeviceId == PCH_SPI) {
+		flash_device = get_flash_device(DeviceId);
+		if (flash_device == NULL)
+			return -ENODEV;
+
+		return SPI_Flash_Read_Direct(flash_device, address, data, length);
+	}
+
+	partition_device = get_flash_partition(DeviceId);
+	flash_device = get_flash_device(ROT_SPI);
+	if (partition_device == NULL || flash_device == NULL)
+		return -ENODEV;
+
+	if ((address + length) > partition_device->fa_size || (address + length) < address)
+		return -EINVAL;
+
+	return SPI_Flash_Read_Direct(flash_device, partition_device->fa_off + address, data, length);
+}
+
 int BMC_PCH_SPI_Command(struct pspi_flash *flash, struct pflash_xfer *xfer)
 {
-	struct device *flash_device;
+	const struct device *flash_device;
 	uint8_t DeviceId = flash->device_id[0];
 	int AdrOffset = 0, Datalen = 0;
 	uint32_t FlashSize = 0;
 	int ret = 0;
-	char buf[4096];
 	uint32_t page_sz = 0;
 	uint32_t sector_sz = 0;
 
-	flash_device = device_get_binding(Flash_Devices_List[DeviceId]);
+	flash_device = get_flash_device(DeviceId);
+	if (flash_device == NULL)
+		return -ENODEV;
+
 	AdrOffset = xfer->address;
 	Datalen = xfer->length;
 
@@ -63,36 +246,35 @@ int BMC_PCH_SPI_Command(struct pspi_flash *flash, struct pflash_xfer *xfer)
 		// printk("FlashSize:%x\n",FlashSize);
 		return FlashSize;
 		break;
-#if 0
-	case SPI_APP_CMD_GET_FLASH_SECTOR_SIZE:
-		page_sz = flash_get_write_block_size(flash_device);
-		return page_sz;
-		break;
-#else
+	// SPI_APP_CMD_GET_FLASH_SECTOR_SIZE shares its code with write enable
 	case MIDLEY_FLASH_CMD_WREN:
 		ret = 0;                // bypass as write enabled
 		break;
-#endif
 	case SPI_APP_CMD_GET_FLASH_BLOCK_SIZE:
 		page_sz = (flash_get_write_block_size(flash_device) << 4);
 		return page_sz;
 		break;
 	case MIDLEY_FLASH_CMD_READ:
-		ret = flash_read(flash_device, AdrOffset, buf, Datalen);
-		// Data_dump_buf(buf,Datalen);
-		if (xfer->data != NULL) {
-			memcpy(xfer->data, buf, Datalen);
-		}
+		if (xfer->data != NULL)
+			ret = SPI_Flash_Read_Direct(flash_device, AdrOffset, xfer->data, Datalen);
+		// Data_dump_buf(xfer->data,Datalen);
 		break;
-	case MIDLEY_FLASH_CMD_PP:        // Flash Write
-		memset(buf, 0xff, Datalen);
-		memcpy(buf, xfer->data, Datalen);
-		ret = flash_write(flash_device, AdrOffset, buf, Datalen);
+	case MIDLEY_FLASH_CMD_PP:        // Flash Write, the driver splits it into device pages
+		if (Datalen > sizeof(program_buf))
+			return -EINVAL;
+		k_mutex_lock(&program_buf_lock, K_FOREVER);
+		memcpy(program_buf, xfer->data, Datalen);
+		ret = flash_write(flash_device, AdrOffset, program_buf, Datalen);
+		k_mutex_unlock(&program_buf_lock);
 		break;
 	case MIDLEY_FLASH_CMD_4K_ERASE:
 		sector_sz = flash_get_write_block_size(flash_device);
 		ret = flash_erase(flash_device, AdrOffset, sector_sz);
 		break;
+	case MIDLEY_FLASH_CMD_32K_ERASE:
+		sector_sz = (flash_get_write_block_size(flash_device) << 3);
+		ret = flash_erase(flash_device, AdrOffset, sector_sz);
+		break;
 	case MIDLEY_FLASH_CMD_64K_ERASE:
 		sector_sz =  (flash_get_write_block_size(flash_device) << 4);
 		ret = flash_erase(flash_device, AdrOffset, sector_sz);
@@ -116,64 +298,53 @@ int BMC_PCH_SPI_Command(struct pspi_flash *flash, struct pflash_xfer *xfer)
 
 int FMC_SPI_Command(struct pspi_flash *flash, struct pflash_xfer *xfer)
 {
-	struct device *flash_device;
-	struct flash_area *partition_device;
+	const struct device *flash_device;
+	const struct flash_area *partition_device;
 	uint32_t FlashSize = 0;
 	uint32_t page_sz = 0;
 	uint32_t sector_sz = 0;
 	int AdrOffset = 0;
 	int Datalen = 0;
-	char buf[4096];
-	int err, ret = 0;
-
-	flash_device = device_get_binding(Flash_Devices_List[ROT_SPI]);
+	int ret = 0;
 
 	uint8_t DeviceId = flash->device_id[0];
 
+	flash_device = get_flash_device(ROT_SPI);
+	partition_device = get_flash_partition(DeviceId);
+	if (flash_device == NULL || partition_device == NULL)
+		return -ENODEV;
+
 	AdrOffset = xfer->address;
 	Datalen = xfer->length;
 
-	if (DeviceId == ROT_INTERNAL_ACTIVE) {
-		err = flash_area_open(FLASH_AREA_ID(active), &partition_device);
-
-	} else if (DeviceId == ROT_INTERNAL_RECOVERY) {
-		err = flash_area_open(FLASH_AREA_ID(recovery), &partition_device);
-
-	} else if (DeviceId == ROT_INTERNAL_STATE) {
-		err = flash_area_open(FLASH_AREA_ID(state), &partition_device);
-
-	} else if (DeviceId == ROT_INTERNAL_INTEL_STATE) {
-		err = flash_area_open(FLASH_AREA_ID(intel_state), &partition_device);
-
-	} else if (DeviceId == ROT_INTERNAL_KEY) {
-		err = flash_area_open(FLASH_AREA_ID(key), &partition_device);
-
-	} else if (DeviceId == ROT_INTERNAL_LOG) {
-		err = flash_area_open(FLASH_AREA_ID(log), &partition_device);
-
-	}
-
 	switch (xfer->cmd) {
 	case SPI_APP_CMD_GET_FLASH_SIZE:
 		FlashSize = partition_device->fa_size;
 		return FlashSize;
 		break;
 
+	case SPI_APP_CMD_GET_FLASH_BLOCK_SIZE:
+		page_sz = (flash_get_write_block_size(flash_device) << 4);
+		return page_sz;
+		break;
+
+	// SPI_APP_CMD_GET_FLASH_SECTOR_SIZE shares its code with write enable
 	case MIDLEY_FLASH_CMD_WREN:
 		ret = 0;                // bypass as write enabled
 		break;
 
 	case MIDLEY_FLASH_CMD_READ:
-		ret = flash_area_read(partition_device, AdrOffset, buf, Datalen);
-		if (xfer->data != NULL) {
-			memcpy(xfer->data, buf, Datalen);
-		}
+		if (xfer->data != NULL)
+			ret = SPI_Flash_Read(DeviceId, AdrOffset, xfer->data, Datalen);
 		break;
 
-	case MIDLEY_FLASH_CMD_PP:        // Flash Write
-		memset(buf, 0xff, Datalen);
-		memcpy(buf, xfer->data, Datalen);
-		ret = flash_area_write(partition_device, AdrOffset, buf, Datalen);
+	case MIDLEY_FLASH_CMD_PP:        // Flash Write, the driver splits it into device pages
+		if (Datalen > sizeof(program_buf))
+			return -EINVAL;
+		k_mutex_lock(&program_buf_lock, K_FOREVER);
+		memcpy(program_buf, xfer->data, Datalen);
+		ret = flash_area_write(partition_device, AdrOffset, program_buf, Datalen);
+		k_mutex_unlock(&program_buf_lock);
 		break;
 
 	case MIDLEY_FLASH_CMD_4K_ERASE:
@@ -181,15 +352,21 @@ int FMC_SPI_Command(struct pspi_flash *flash, struct pflash_xfer *xfer)
 		ret = flash_area_erase(partition_device, AdrOffset, sector_sz);
 		break;
 
+	case MIDLEY_FLASH_CMD_32K_ERASE:
+		sector_sz = (flash_get_write_block_size(flash_device) << 3);
+		ret = flash_area_erase(partition_device, AdrOffset, sector_sz);
+		break;
+
 	case MIDLEY_FLASH_CMD_64K_ERASE:
-		printk("%d Command is not supported", xfer->cmd);
-		ret = 0;
+		sector_sz = (flash_get_write_block_size(flash_device) << 4);
+		ret = flash_area_erase(partition_device, AdrOffset, sector_sz);
 		break;
 
 	case MIDLEY_FLASH_CMD_CE:
-		printk("%d Command is not supported", xfer->cmd);
-		ret = 0;
+		// The RoT firmware shares the chip, so only the partition is erased
+		ret = flash_area_erase(partition_device, 0, partition_device->fa_size);
 		break;
+
 	case MIDLEY_FLASH_CMD_RDSR:
 		// bypass as flash status are write enabled and not busy
 		*xfer->data = 0x02;
@@ -205,16 +382,8 @@ int FMC_SPI_Command(struct pspi_flash *flash, struct pflash_xfer *xfer)
 
 int SPI_Command_Xfer(struct pspi_flash *flash, struct pflash_xfer *xfer)
 {
-	struct device *flash_device;
-	uint32_t FlashSize = 0;
 	uint8_t DeviceId = flash->device_id[0];
-	// uint8_t DeviceId=0;
-	uint32_t sector_sz = 0;
-	uint32_t page_sz = 0;
-	int ret = 0, i = 0;
-	char buf[4096];
-	int AdrOffset = 0, Datalen = 0;
-	struct device *dev;
+	int ret = 0;
 
 	if (DeviceId == BMC_SPI || DeviceId == PCH_SPI) {
 		ret = BMC_PCH_SPI_Command(flash, xfer);
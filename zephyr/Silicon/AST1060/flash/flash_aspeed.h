@@ -58,6 +58,7 @@ enum {
 	// MIDLEY_FLASH_CMD_ALT_WRSR2 = 0x3e,		/**< Alternate Write status register 2 */
 	// MIDLEY_FLASH_CMD_ALT_RDSR2 = 0x3f,		/**< Alternate Read status register 2 */
 	// MIDLEY_FLASH_CMD_VOLATILE_WREN = 0x50,	/**< Volatile write enabl efor status register 1 */
+	MIDLEY_FLASH_CMD_32K_ERASE      = 0x52,                 /**< Block erase 32kB */
 	// MIDLEY_FLASH_CMD_SFDP = 0x5a,				/**< Read SFDP registers */
 	// MIDLEY_FLASH_CMD_RSTEN = 0x66,			/**< Reset enable */
 	// MIDLEY_FLASH_CMD_QUAD_READ = 0x6b,		/**< Quad output read */
@@ -303,5 +304,7 @@ struct pspi_flash {
 #endif
 
 int SPI_Command_Xfer(struct pspi_flash *flash, struct pflash_xfer *xfer);
+int SPI_Device_Init(void);
+int SPI_Flash_Read(uint8_t DeviceId, uint32_t address, uint8_t *data, uint32_t length);
 
 #endif
@@ -38,4 +38,65 @@ int Set_SPI_Filter_RW_Region(char *dev_name, enum addr_priv_rw_select rw_select,
 
 	return ret;
 
-}
\ No newline at end of file
+}
+
+int Get_SPI_Filter_Priv_Table(char *dev_name, enum addr_priv_rw_select rw_select, uint32_t first_reg, uint32_t *val, uint32_t reg_num)
+{
+	const struct device *dev_m = NULL;
+
+	dev_m = device_get_binding(dev_name);
+	if (dev_m == NULL)
+		return -ENODEV;
+
+	return spim_address_privilege_table_read(dev_m, rw_select, first_reg, val, reg_num);
+}
+
+int Set_SPI_Filter_Priv_Table(char *dev_name, enum addr_priv_rw_select rw_select, uint32_t first_reg, const uint32_t *val, uint32_t reg_num)
+{
+	const struct device *dev_m = NULL;
+
+	dev_m = device_get_binding(dev_name);
+	if (dev_m == NULL)
+		return -ENODEV;
+
+	return spim_address_privilege_table_write(dev_m, rw_select, first_reg, val, reg_num);
+}
+
+/* Find the writable region with the given index, counting from 1, in the write privilege table */
+int Get_SPI_Filter_RW_Region(char *dev_name, uint8_t region, uint32_t *start_addr, uint32_t *end_addr)
+{
+	uint32_t reg_val[SPI_FILTER_PRIV_TABLE_CHUNK];
+	uint32_t found = 0;
+	uint32_t block = 0;
+	uint32_t first_reg;
+	bool in_region = false;
+	int ret;
+	int i;
+
+	for (first_reg = 0; first_reg < SPI_FILTER_PRIV_TABLE_REGS; first_reg += SPI_FILTER_PRIV_TABLE_CHUNK) {
+		ret = Get_SPI_Filter_Priv_Table(dev_name, FLAG_ADDR_PRIV_WRITE_SELECT, first_reg, reg_val, SPI_FILTER_PRIV_TABLE_CHUNK);
+		if (ret)
+			return ret;
+
+		for (i = 0; i < SPI_FILTER_PRIV_TABLE_CHUNK * 32; i++, block++) {
+			if ((reg_val[i / 32] & BIT(i % 32)) && !in_region) {
+				in_region = true;
+				if (++found == region)
+					*start_addr = block * SPI_FILTER_PRIV_BLOCK_SIZE;
+			} else if (!(reg_val[i / 32] & BIT(i % 32)) && in_region) {
+				in_region = false;
+				if (found == region) {
+					*end_addr = block * SPI_FILTER_PRIV_BLOCK_SIZE;
+					return 0;
+				}
+			}
+		}
+	}
+
+	if (in_region && (found == region)) {
+		*end_addr = block * SPI_FILTER_PRIV_BLOCK_SIZE;
+		return 0;
+	}
+
+	return -ENOENT;
+}
@@ -11,7 +11,15 @@
 #include <device.h>
 #include <drivers/misc/aspeed/pfr_aspeed.h>
 
+/* Each privilege table register covers 32 blocks of 16kB. */
+#define SPI_FILTER_PRIV_BLOCK_SIZE	0x4000
+#define SPI_FILTER_PRIV_TABLE_REGS	512
+#define SPI_FILTER_PRIV_TABLE_CHUNK	64
+
 void SPI_Monitor_Enable(char *dev_name, bool enabled);
 int Set_SPI_Filter_RW_Region(char *dev_name, enum addr_priv_rw_select rw_select, enum addr_priv_op op, mm_reg_t addr, uint32_t len);
+int Get_SPI_Filter_Priv_Table(char *dev_name, enum addr_priv_rw_select rw_select, uint32_t first_reg, uint32_t *val, uint32_t reg_num);
+int Set_SPI_Filter_Priv_Table(char *dev_name, enum addr_priv_rw_select rw_select, uint32_t first_reg, const uint32_t *val, uint32_t reg_num);
+int Get_SPI_Filter_RW_Region(char *dev_name, uint8_t region, uint32_t *start_addr, uint32_t *end_addr);
 
 #endif
\ No newline at end of file
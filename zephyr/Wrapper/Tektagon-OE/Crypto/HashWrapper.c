@@ -56,6 +56,22 @@ int HashEngineUpdate (const char *Data, size_t Length)
 	return hash_engine_update(Data, Length);
 }
 
+/**
+*	Function to Hash Engine Update without waiting for completion.
+*/
+int HashEngineUpdateAsync (const char *Data, size_t Length)
+{
+	return hash_engine_update_async(Data, Length);
+}
+
+/**
+*	Function to wait for Hash Engine Update Async completion.
+*/
+int HashEngineWait (void)
+{
+	return hash_engine_wait();
+}
+
 /**
 *	Function to Hash Engine Finish.
 */
@@ -19,6 +19,8 @@ int HashEngineStartSha256(void);
 int HashEngineCalculateSha384 (const char *Data, size_t Length, char *Hash, size_t HashLength);
 int HashEngineStartSha384(void);
 int HashEngineUpdate (const char *Data, size_t Length);
+int HashEngineUpdateAsync (const char *Data, size_t Length);
+int HashEngineWait (void);
 int HashEngineFinish (char *Hash, size_t HashLength);
 void HashEngineCancel(void);
 
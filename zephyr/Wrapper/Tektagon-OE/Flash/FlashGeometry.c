@@ -0,0 +1,363 @@
+//***********************************************************************
+//*                                                                     *
+//*                  Copyright (c) 1985-2022, AMI.                      *
+//*                                                                     *
+//*      All rights reserved. Subject to AMI licensing agreement.       *
+//*                                                                     *
+//***********************************************************************
+/**@file
+ * This file contains the flash geometry cache used by the Flash Wrapper
+ *
+ * The size and erase sizes of a device only change with the hardware, so they are queried once
+ * per device and the Flash Wrapper checks bounds and splits programs from the cached copy.  Only
+ * the flash commands themselves go to the driver.
+ */
+
+#include <string.h>
+#include "flash/flash_common.h"
+#include "FlashGeometry.h"
+
+
+/**
+ * Initialize an empty geometry cache.
+ *
+ * @param cache The cache to initialize.
+ * @param xfer Handler for the commands sent to the devices.
+ */
+void Wrapper_flash_geometry_init (struct flash_geometry_cache *cache, flash_geometry_xfer xfer)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	memset (cache, 0, sizeof (*cache));
+	cache->xfer = xfer;
+}
+
+/**
+ * Send a geometry query to the selected device.
+ *
+ * @return The size returned by the device, or 0 if the query failed.
+ */
+static uint32_t Wrapper_flash_geometry_query (struct flash_geometry_cache *cache,
+	struct spi_flash *flash, uint8_t cmd)
+{
+	struct flash_xfer xfer;
+	int size;
+
+	FLASH_XFER_INIT_CMD_ONLY (xfer, cmd, 0);
+
+	size = cache->xfer (flash, &xfer);
+
+	return (size > 0) ? size : 0;
+}
+
+/**
+ * Query the layout of the selected device.
+ *
+ * @param cache The cache to fill.
+ * @param flash The flash with the device selected.
+ * @param geometry Output for the layout of the device.
+ *
+ * @return 0 if the device was probed or an error code.
+ */
+static int Wrapper_flash_geometry_probe (struct flash_geometry_cache *cache,
+	struct spi_flash *flash, struct flash_geometry *geometry)
+{
+	geometry->device_size = Wrapper_flash_geometry_query (cache, flash,
+		FLASH_GEOMETRY_CMD_DEVICE_SIZE);
+	if (geometry->device_size == 0) {
+		return SPI_FLASH_NO_DEVICE;
+	}
+
+	/* The driver has no sector size query, its code is taken by write enable. */
+	geometry->sector_size = FLASH_GEOMETRY_SECTOR_SIZE;
+
+	geometry->block_size = Wrapper_flash_geometry_query (cache, flash,
+		FLASH_GEOMETRY_CMD_BLOCK_SIZE);
+	if (geometry->block_size == 0) {
+		geometry->block_size = FLASH_GEOMETRY_BLOCK_SIZE;
+	}
+
+	/* All supported devices use a 256 byte page size. */
+	geometry->page_size = FLASH_PAGE_SIZE;
+	geometry->max_program = FLASH_GEOMETRY_MAX_PROGRAM;
+	geometry->addr_mode = (geometry->device_size > 0x1000000) ? FLASH_FLAG_4BYTE_ADDRESS : 0;
+
+	/* The driver sizes the 32kB erase as half a block. */
+	geometry->erase_sizes = FLASH_GEOMETRY_ERASE_4K | FLASH_GEOMETRY_ERASE_64K |
+		FLASH_GEOMETRY_ERASE_CHIP;
+	if ((geometry->block_size / 2) > geometry->sector_size) {
+		geometry->erase_sizes |= FLASH_GEOMETRY_ERASE_32K;
+	}
+
+	return 0;
+}
+
+/**
+ * Get the layout of the device selected in a flash, probing it the first time the device is used.
+ * The size and address mode of the flash are updated to match the device.
+ *
+ * @param cache The geometry cache.
+ * @param flash The flash with the device selected by device_id[0].
+ * @param geometry Output for the layout of the device.  This points into the cache.
+ *
+ * @return 0 if the layout is available or an error code.
+ */
+int Wrapper_flash_geometry_get (struct flash_geometry_cache *cache, struct spi_flash *flash,
+	const struct flash_geometry **geometry)
+{
+	uint8_t device_id;
+	int status;
+
+	if ((cache == NULL) || (flash == NULL) || (geometry == NULL) || (cache->xfer == NULL)) {
+		return SPI_FLASH_INVALID_ARGUMENT;
+	}
+
+	device_id = flash->device_id[0];
+	if (device_id >= FLASH_GEOMETRY_DEVICES) {
+		return SPI_FLASH_UNSUPPORTED_DEVICE;
+	}
+
+	if (!cache->valid[device_id]) {
+		status = Wrapper_flash_geometry_probe (cache, flash, &cache->device[device_id]);
+		if (status != 0) {
+			return status;
+		}
+		cache->valid[device_id] = true;
+	}
+
+	flash->device_size = cache->device[device_id].device_size;
+	flash->addr_mode = cache->device[device_id].addr_mode;
+	*geometry = &cache->device[device_id];
+
+	return 0;
+}
+
+/**
+ * Forget the layout of a device so it is probed again on its next use.
+ *
+ * @param cache The geometry cache.
+ * @param device_id The device to forget.
+ */
+void Wrapper_flash_geometry_invalidate (struct flash_geometry_cache *cache, uint8_t device_id)
+{
+	if ((cache == NULL) || (device_id >= FLASH_GEOMETRY_DEVICES)) {
+		return;
+	}
+
+	cache->valid[device_id] = false;
+}
+
+/**
+ * Check that an access lies within a device.
+ *
+ * @param geometry The layout of the device.
+ * @param address The first address of the access.
+ * @param length The number of bytes accessed.
+ *
+ * @return 0 if the access is within the device or an error code.
+ */
+int Wrapper_flash_geometry_check (const struct flash_geometry *geometry, uint32_t address,
+	size_t length)
+{
+	if (geometry == NULL) {
+		return SPI_FLASH_INVALID_ARGUMENT;
+	}
+
+	if (address >= geometry->device_size) {
+		return SPI_FLASH_ADDRESS_OUT_OF_RANGE;
+	}
+
+	if (length > (geometry->device_size - address)) {
+		return SPI_FLASH_OPERATION_OUT_OF_RANGE;
+	}
+
+	return 0;
+}
+
+/**
+ * Program data to the selected device.  The data is sent in commands of up to max_program bytes,
+ * and every command after the first starts on a page boundary.  The flash needs to be erased
+ * prior to writing.
+ *
+ * @param cache The geometry cache.
+ * @param flash The flash with the device selected by device_id[0].
+ * @param address The address to start writing to.
+ * @param data The data to write.
+ * @param length The number of bytes to write.
+ *
+ * @return The number of bytes written to the flash or an error code.  Use ROT_IS_ERROR to check the
+ * return value.
+ */
+int Wrapper_flash_geometry_program (struct flash_geometry_cache *cache, struct spi_flash *flash,
+	uint32_t address, const uint8_t *data, size_t length)
+{
+	const struct flash_geometry *geometry;
+	struct flash_xfer xfer;
+	size_t remaining = length;
+	size_t write_len;
+	uint32_t end;
+	int status;
+
+	if ((data == NULL) && length) {
+		return SPI_FLASH_INVALID_ARGUMENT;
+	}
+
+	status = Wrapper_flash_geometry_get (cache, flash, &geometry);
+	if (status != 0) {
+		return status;
+	}
+
+	if (length == 0) {
+		return 0;
+	}
+
+	status = Wrapper_flash_geometry_check (geometry, address, length);
+	if (status != 0) {
+		return status;
+	}
+
+	while ((status == 0) && remaining) {
+		end = (address - (address % geometry->page_size)) + geometry->max_program;
+		write_len = end - address;
+		if (write_len > remaining) {
+			write_len = remaining;
+		}
+
+		FLASH_XFER_INIT_WRITE (xfer, FLASH_CMD_PP, address, 0, (uint8_t*) data, write_len,
+			geometry->addr_mode);
+
+		status = cache->xfer (flash, &xfer);
+		if (status == 0) {
+			remaining -= write_len;
+			data += write_len;
+			address += write_len;
+		}
+	}
+
+	length -= remaining;
+
+	return (length) ? (int) length : status;
+}
+
+/**
+ * Check if an erase of a given size can start at an address without passing the end of a region.
+ */
+static bool Wrapper_flash_geometry_erase_fits (uint32_t address, uint32_t end, uint32_t length)
+{
+	return (length != 0) && ((address % length) == 0) && ((end - address) >= length);
+}
+
+/**
+ * Choose the next erase command for a region.  This is the largest erase the device supports that
+ * starts at the address and ends within the region, so a region is covered exactly with the
+ * fewest commands.  A region that is the whole device is erased with one chip erase.
+ *
+ * @param geometry The layout of the device.
+ * @param address The first address left to erase.  It must be sector aligned.
+ * @param end The end of the region.  It must be at least one sector past the address.
+ * @param erase Output for the erase command.
+ *
+ * @return 0 if an erase was chosen or an error code.
+ */
+int Wrapper_flash_geometry_erase_step (const struct flash_geometry *geometry, uint32_t address,
+	uint32_t end, struct flash_geometry_erase *erase)
+{
+	if ((geometry == NULL) || (erase == NULL) || (end <= address) ||
+		!Wrapper_flash_geometry_erase_fits (address, end, geometry->sector_size)) {
+		return SPI_FLASH_INVALID_ARGUMENT;
+	}
+
+	erase->address = address;
+
+	if ((geometry->erase_sizes & FLASH_GEOMETRY_ERASE_CHIP) && (address == 0) &&
+		(end == geometry->device_size)) {
+		erase->cmd = FLASH_CMD_CE;
+		erase->length = geometry->device_size;
+	}
+	else if ((geometry->erase_sizes & FLASH_GEOMETRY_ERASE_64K) &&
+		Wrapper_flash_geometry_erase_fits (address, end, geometry->block_size)) {
+		erase->cmd = FLASH_CMD_64K_ERASE;
+		erase->length = geometry->block_size;
+	}
+	else if ((geometry->erase_sizes & FLASH_GEOMETRY_ERASE_32K) &&
+		Wrapper_flash_geometry_erase_fits (address, end, geometry->block_size / 2)) {
+		erase->cmd = FLASH_GEOMETRY_CMD_32K_ERASE;
+		erase->length = geometry->block_size / 2;
+	}
+	else {
+		erase->cmd = FLASH_CMD_4K_ERASE;
+		erase->length = geometry->sector_size;
+	}
+
+	return 0;
+}
+
+/**
+ * Erase a region of the selected device with the fewest erase commands.  Like
+ * flash_sector_erase_region, the erase starts at the beginning of the sector that contains the
+ * start address and ends at the end of the sector that contains the last byte.
+ *
+ * @param cache The geometry cache.
+ * @param flash The flash with the device selected by device_id[0].
+ * @param address The start of the region to erase.
+ * @param length The number of bytes to erase.
+ *
+ * @return 0 if the region was erased or an error code.
+ */
+int Wrapper_flash_geometry_erase (struct flash_geometry_cache *cache, struct spi_flash *flash,
+	uint32_t address, size_t length)
+{
+	const struct flash_geometry *geometry;
+	struct flash_geometry_erase erase;
+	struct flash_xfer xfer;
+	uint32_t end;
+	int status;
+
+	status = Wrapper_flash_geometry_get (cache, flash, &geometry);
+	if (status != 0) {
+		return status;
+	}
+
+	if (length == 0) {
+		return 0;
+	}
+
+	status = Wrapper_flash_geometry_check (geometry, address, length);
+	if (status != 0) {
+		return status;
+	}
+
+	end = address + length;
+	if (end % geometry->sector_size) {
+		end += geometry->sector_size - (end % geometry->sector_size);
+	}
+	if ((end > geometry->device_size) || (end == 0)) {
+		end = geometry->device_size;
+	}
+	address -= address % geometry->sector_size;
+
+	while (address < end) {
+		status = Wrapper_flash_geometry_erase_step (geometry, address, end, &erase);
+		if (status != 0) {
+			return status;
+		}
+
+		if (erase.cmd == FLASH_CMD_CE) {
+			FLASH_XFER_INIT_CMD_ONLY (xfer, erase.cmd, 0);
+		}
+		else {
+			FLASH_XFER_INIT_NO_DATA (xfer, erase.cmd, erase.address, geometry->addr_mode);
+		}
+
+		status = cache->xfer (flash, &xfer);
+		if (status != 0) {
+			return status;
+		}
+
+		address += erase.length;
+	}
+
+	return 0;
+}
@@ -0,0 +1,116 @@
+//***********************************************************************
+//*                                                                     *
+//*                  Copyright (c) 1985-2022, AMI.                      *
+//*                                                                     *
+//*      All rights reserved. Subject to AMI licensing agreement.       *
+//*                                                                     *
+//***********************************************************************
+/**@file
+ * This file contains the flash geometry cache used by the Flash Wrapper
+ */
+
+#ifndef FLASH_GEOMETRY_H_
+#define FLASH_GEOMETRY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "flash/spi_flash.h"
+
+
+/**
+ * Number of flash device IDs, from BMC_SPI to ROT_INTERNAL_LOG in flash_aspeed.h.
+ */
+#define	FLASH_GEOMETRY_DEVICES			10
+
+/**
+ * Most bytes sent in one program command.  This is the bounce buffer the AST1060 driver copies
+ * program data through, and the driver splits the command into device pages.
+ */
+#define	FLASH_GEOMETRY_MAX_PROGRAM		4096
+
+/**
+ * Geometry queries handled by SPI_Command_Xfer, the SPI_APP_CMD_GET_* codes of flash_aspeed.h.
+ */
+#define	FLASH_GEOMETRY_CMD_BLOCK_SIZE	0x07
+#define	FLASH_GEOMETRY_CMD_DEVICE_SIZE	0x09
+
+/**
+ * Erase sizes used when the driver does not report one.  The sector size is never reported.
+ */
+#define	FLASH_GEOMETRY_SECTOR_SIZE		0x1000
+#define	FLASH_GEOMETRY_BLOCK_SIZE		0x10000
+
+/**
+ * 32kB block erase, which is not in the Cerberus command set.
+ */
+#define	FLASH_GEOMETRY_CMD_32K_ERASE	0x52
+
+/**
+ * Erase commands a device supports, for the erase_sizes of the geometry.
+ */
+#define	FLASH_GEOMETRY_ERASE_4K			(1U << 0)
+#define	FLASH_GEOMETRY_ERASE_32K		(1U << 1)
+#define	FLASH_GEOMETRY_ERASE_64K		(1U << 2)
+#define	FLASH_GEOMETRY_ERASE_CHIP		(1U << 3)
+
+
+/**
+ * Issue one command to a flash device.  The device is selected by flash->device_id[0].
+ *
+ * @param flash The flash to send the command to.
+ * @param xfer The command to send.
+ *
+ * @return The result of the command.  Geometry queries return the size being queried.
+ */
+typedef int (*flash_geometry_xfer) (struct spi_flash *flash, struct flash_xfer *xfer);
+
+/**
+ * Layout of one flash device.
+ */
+struct flash_geometry {
+	uint32_t device_size;				/**< Total bytes of the device. */
+	uint32_t page_size;					/**< Bytes of a program page. */
+	uint32_t sector_size;				/**< Bytes of a sector erase. */
+	uint32_t block_size;				/**< Bytes of a block erase. */
+	uint16_t addr_mode;					/**< Address flag needed to reach the whole device. */
+	uint32_t max_program;				/**< Most bytes sent in one program command. */
+	uint32_t erase_sizes;				/**< FLASH_GEOMETRY_ERASE_* commands of the device. */
+};
+
+/**
+ * One erase command of a region erase.
+ */
+struct flash_geometry_erase {
+	uint8_t cmd;						/**< The erase command. */
+	uint32_t address;					/**< First address erased. */
+	uint32_t length;					/**< Number of bytes erased. */
+};
+
+/**
+ * Geometry of every flash device, probed the first time each device is used.
+ */
+struct flash_geometry_cache {
+	struct flash_geometry device[FLASH_GEOMETRY_DEVICES];	/**< Geometry of each device. */
+	bool valid[FLASH_GEOMETRY_DEVICES];						/**< The device has been probed. */
+	flash_geometry_xfer xfer;								/**< Command handler for the devices. */
+};
+
+
+void Wrapper_flash_geometry_init (struct flash_geometry_cache *cache, flash_geometry_xfer xfer);
+int Wrapper_flash_geometry_get (struct flash_geometry_cache *cache, struct spi_flash *flash,
+	const struct flash_geometry **geometry);
+void Wrapper_flash_geometry_invalidate (struct flash_geometry_cache *cache, uint8_t device_id);
+
+int Wrapper_flash_geometry_check (const struct flash_geometry *geometry, uint32_t address,
+	size_t length);
+int Wrapper_flash_geometry_program (struct flash_geometry_cache *cache, struct spi_flash *flash,
+	uint32_t address, const uint8_t *data, size_t length);
+
+int Wrapper_flash_geometry_erase_step (const struct flash_geometry *geometry, uint32_t address,
+	uint32_t end, struct flash_geometry_erase *erase);
+int Wrapper_flash_geometry_erase (struct flash_geometry_cache *cache, struct spi_flash *flash,
+	uint32_t address, size_t length);
+
+
+#endif /* FLASH_GEOMETRY_H_ */
@@ -22,6 +22,23 @@
 #include "flash/flash_aspeed.h"
 #include <flash/flash_common.h>
 #include "flash/flash_logging.h"
+#include "FlashGeometry.h"
+
+static int Wrapper_spi_command (struct spi_flash *flash, struct flash_xfer *xfer);
+
+/*
+ * Layout of every flash device.  One spi_flash is pointed at different devices by changing
+ * device_id[0], so the layout is cached per device instead of in the instance.  Each device is
+ * probed on first use, and reads, writes and size queries then need no geometry transaction.
+ */
+static struct flash_geometry_cache flash_geometry = {
+	.xfer = Wrapper_spi_command,
+};
+
+static int Wrapper_spi_command (struct spi_flash *flash, struct flash_xfer *xfer)
+{
+	return SPI_Command_Xfer (flash, xfer);
+}
 
 int WrapperSpiCommandRead(void)
 {
@@ -71,16 +88,19 @@ int WrapperSpiGetDeviceId(void)
  */
 int Wrapper_spi_flash_get_device_size (struct spi_flash *flash, uint32_t *bytes)
 {
-	struct flash_xfer  xfer;
+	const struct flash_geometry *geometry;
+	int status;
 
 	if ((flash == NULL) || (bytes == NULL)) {
 		return SPI_FLASH_INVALID_ARGUMENT;
 	}
-	
-	xfer.cmd = SPI_APP_CMD_GET_FLASH_SIZE;
 
+	status = Wrapper_flash_geometry_get (&flash_geometry, flash, &geometry);
+	if (status != 0) {
+		return status;
+	}
 
-	*bytes = SPI_Command_Xfer(flash,&xfer);
+	*bytes = geometry->device_size;
 
 	return 0;
 }
@@ -98,29 +118,28 @@ int Wrapper_spi_flash_get_device_size (struct spi_flash *flash, uint32_t *bytes)
 int Wrapper_spi_flash_read (struct spi_flash *flash, uint32_t address, uint8_t *data, size_t length)
 {
 
+	const struct flash_geometry *geometry;
 	struct flash_xfer xfer;
 	int status;
-	uint32_t bytes;
 	int read_dummy=0,read_mode=0;
-	int read_flags=0,addr_mode=0;
-	
-	// if ((flash == NULL) || (data == NULL)) {
-	// 	if(flash == NULL){
-	// 		printk("flash is NULL\n");
-	// 	}
-	// 	if(data == NULL){
-	// 		printk("data is NULL\n");
-	// 	}
-	// 	return SPI_FLASH_INVALID_ARGUMENT;
-	// }
-	if((flash == NULL)){
+	int read_flags=0;
+
+	if ((flash == NULL) || (data == NULL)) {
 		return SPI_FLASH_INVALID_ARGUMENT;
 	}
-	Wrapper_spi_flash_get_device_size(flash,&bytes);
 
-	//SPI_FLASH_BOUNDS_CHECK (bytes, address, length);
+	// Bounds are checked against the cached device size, so a read is a single transaction.
+	status = Wrapper_flash_geometry_get (&flash_geometry, flash, &geometry);
+	if (status != 0) {
+		return status;
+	}
 
-	FLASH_XFER_INIT_READ (xfer, FLASH_CMD_READ, address, read_dummy, read_mode, data, length, read_flags | addr_mode);
+	status = Wrapper_flash_geometry_check (geometry, address, length);
+	if (status != 0) {
+		return status;
+	}
+
+	FLASH_XFER_INIT_READ (xfer, FLASH_CMD_READ, address, read_dummy, read_mode, data, length, read_flags | geometry->addr_mode);
 	
 	status = SPI_Command_Xfer(flash,&xfer);
 
@@ -182,60 +201,20 @@ int Wrapper_spi_flash_minimum_write_per_page (struct spi_flash *flash, uint32_t
  */
 int Wrapper_spi_flash_write (struct spi_flash *flash, uint32_t address, const uint8_t *data, size_t length)
 {
-	struct flash_xfer xfer;
-	uint32_t page = FLASH_PAGE_BASE (address);
-	uint32_t next = page + FLASH_PAGE_SIZE;
-	size_t remaining = length;
-	int status = 0;
-	int write_flags=0,addr_mode=0;
+	int status;
 
-	if ((flash == NULL)) {
+	if (flash == NULL) {
 		return SPI_FLASH_INVALID_ARGUMENT;
 	}
-	// Wrapper_spi_flash_get_device_size(flash, &bytes);
-	// SPI_FLASH_BOUNDS_CHECK (flash->device_size, address, length);
-
-	while ((status == 0) && remaining) {
-		uint32_t end = address + remaining;
-		size_t write_len;
-
-		if (page != FLASH_PAGE_BASE(end)) {
-			write_len = next - address;
-		} else {
-			write_len = remaining;
-		}
-
-
-		FLASH_XFER_INIT_WRITE (xfer, FLASH_CMD_PP, address, 0, (uint8_t*) data, write_len,
-			write_flags | addr_mode);
-		
-
-		status = SPI_Command_Xfer(flash,&xfer);
-
-		//if (status == 0) {
-			//status = spi_flash_wait_for_write_completion (flash, -1, 1);
-		if (status == 0) {
-			remaining -= write_len;
-			data += write_len;
-			page = next;
-			address = next;
-			next += FLASH_PAGE_SIZE;
-		}
-	}
-	
-	length = length - remaining;
-	
-	if (length) {
-		if (status != 0) {
-			printk("debug_log_create_entry\n");
-			// debug_log_create_entry (DEBUG_LOG_SEVERITY_ERROR, DEBUG_LOG_COMPONENT_FLASH,
-			// FLASH_LOGGING_INCOMPLETE_WRITE, address, status);
-		}
-		return length;
-	} else {
-		return status;
+
+	// Whole pages go to the driver in one program command instead of one command per page.
+	status = Wrapper_flash_geometry_program (&flash_geometry, flash, address, data, length);
+	if ((status < 0) || ((size_t) status != length)) {
+		printk("Flash write incomplete: device %d address %x status %d\n", flash->device_id[0],
+			address, status);
 	}
 
+	return status;
 }
 
 /**
@@ -248,19 +227,20 @@ int Wrapper_spi_flash_write (struct spi_flash *flash, uint32_t address, const ui
  */
 int Wrapper_spi_flash_get_sector_size (struct spi_flash *flash, uint32_t *bytes)
 {
-	struct flash_master spi;
-	struct flash_xfer  xfer;
+	const struct flash_geometry *geometry;
+	int status;
 
 	if ((flash == NULL) || (bytes == NULL)) {
 		return SPI_FLASH_INVALID_ARGUMENT;
 	}
 
-	xfer.cmd = SPI_APP_CMD_GET_FLASH_SECTOR_SIZE;
-
+	status = Wrapper_flash_geometry_get (&flash_geometry, flash, &geometry);
+	if (status != 0) {
+		return status;
+	}
 
-	*bytes = SPI_Command_Xfer(flash,&xfer);
+	*bytes = geometry->sector_size;
 
-	
 	return 0;
 }
 
@@ -274,17 +254,28 @@ int Wrapper_spi_flash_get_sector_size (struct spi_flash *flash, uint32_t *bytes)
  */
 int Wrapper_spi_flash_sector_erase (struct spi_flash *flash, uint32_t sector_addr)
 {
+	const struct flash_geometry *geometry;
 	struct flash_xfer xfer;
-	int status = 0;
+	int status;
 
 	if (flash == NULL) {
 		return SPI_FLASH_INVALID_ARGUMENT;
 	}
-	xfer.cmd = MIDLEY_FLASH_CMD_4K_ERASE;
 
-    status = SPI_Command_Xfer(flash,&xfer);
+	status = Wrapper_flash_geometry_get (&flash_geometry, flash, &geometry);
+	if (status != 0) {
+		return status;
+	}
 
-	return status;
+	status = Wrapper_flash_geometry_check (geometry, sector_addr, 1);
+	if (status != 0) {
+		return status;
+	}
+
+	FLASH_XFER_INIT_NO_DATA (xfer, MIDLEY_FLASH_CMD_4K_ERASE,
+		sector_addr - (sector_addr % geometry->sector_size), geometry->addr_mode);
+
+	return SPI_Command_Xfer(flash,&xfer);
 }
 
 /**
@@ -297,20 +288,21 @@ int Wrapper_spi_flash_sector_erase (struct spi_flash *flash, uint32_t sector_add
  */
 int Wrapper_spi_flash_get_block_size (struct spi_flash *flash, uint32_t *bytes)
 {
-	struct flash_master spi;
-	struct flash_xfer  xfer;
+	const struct flash_geometry *geometry;
+	int status;
 
 	if ((flash == NULL) || (bytes == NULL)) {
 		return SPI_FLASH_INVALID_ARGUMENT;
 	}
 
-	xfer.cmd = SPI_APP_CMD_GET_FLASH_BLOCK_SIZE;
-	
-    *bytes = SPI_Command_Xfer(flash,&xfer);
-
-	return 0;
+	status = Wrapper_flash_geometry_get (&flash_geometry, flash, &geometry);
+	if (status != 0) {
+		return status;
+	}
 
+	*bytes = geometry->block_size;
 
+	return 0;
 }
 
 /**
@@ -323,18 +315,28 @@ int Wrapper_spi_flash_get_block_size (struct spi_flash *flash, uint32_t *bytes)
  */
 int Wrapper_spi_flash_block_erase (struct spi_flash *flash, uint32_t block_addr)
 {
-	struct flash_xfer  xfer;
-	int status = 0;
+	const struct flash_geometry *geometry;
+	struct flash_xfer xfer;
+	int status;
 
 	if (flash == NULL) {
 		return SPI_FLASH_INVALID_ARGUMENT;
 	}
-	xfer.cmd = MIDLEY_FLASH_CMD_64K_ERASE;
 
-	status = SPI_Command_Xfer(flash,&xfer);
-	
-	return status;
+	status = Wrapper_flash_geometry_get (&flash_geometry, flash, &geometry);
+	if (status != 0) {
+		return status;
+	}
 
+	status = Wrapper_flash_geometry_check (geometry, block_addr, 1);
+	if (status != 0) {
+		return status;
+	}
+
+	FLASH_XFER_INIT_NO_DATA (xfer, MIDLEY_FLASH_CMD_64K_ERASE,
+		block_addr - (block_addr % geometry->block_size), geometry->addr_mode);
+
+	return SPI_Command_Xfer(flash,&xfer);
 }
 
 /**
@@ -346,13 +348,29 @@ int Wrapper_spi_flash_block_erase (struct spi_flash *flash, uint32_t block_addr)
  */
 int Wrapper_spi_flash_chip_erase (struct spi_flash *flash)
 {
-	struct flash_xfer  xfer;
-	int status = 0;
+	struct flash_xfer xfer;
 
-	xfer.cmd = MIDLEY_FLASH_CMD_READ;
+	if (flash == NULL) {
+		return SPI_FLASH_INVALID_ARGUMENT;
+	}
 
-    status = SPI_Command_Xfer(flash,&xfer);
+	FLASH_XFER_INIT_CMD_ONLY (xfer, MIDLEY_FLASH_CMD_CE, 0);
 
-	return status;
-	
+	return SPI_Command_Xfer(flash,&xfer);
+}
+
+/**
+ * Erase a region of flash with the fewest commands, mixing 4kB sector, 32kB and 64kB block and
+ * chip erases.  The erasure will occur on flash sector boundaries, so up to two sectors more than
+ * requested may be erased.
+ *
+ * @param flash The flash to erase.
+ * @param start_addr The starting address of the region to erase.
+ * @param length The number of bytes to erase starting from start_addr.
+ *
+ * @return 0 if the region was erased or an error code.
+ */
+int Wrapper_spi_flash_erase_region (struct spi_flash *flash, uint32_t start_addr, size_t length)
+{
+	return Wrapper_flash_geometry_erase (&flash_geometry, flash, start_addr, length);
 }
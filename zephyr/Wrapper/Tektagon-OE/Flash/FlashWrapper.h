@@ -25,6 +25,7 @@ int Wrapper_spi_flash_sector_erase (struct spi_flash *flash, uint32_t sector_add
 int Wrapper_spi_flash_get_block_size (struct spi_flash *flash, uint32_t *bytes);
 int Wrapper_spi_flash_block_erase (struct spi_flash *flash, uint32_t block_addr);
 int Wrapper_spi_flash_chip_erase (struct spi_flash *flash);
+int Wrapper_spi_flash_erase_region (struct spi_flash *flash, uint32_t start_addr, size_t length);
 uint32_t Wrapper_flash_master_capabilities (struct flash_master *spi);
 
 
@@ -9,6 +9,7 @@
  * This file contains the GPIO Handling functions
  */
 
+#include <errno.h>
 #include "SpiFilterWrapper.h"
 #include "SpiFilter/SpiFilter.h"
 
@@ -357,7 +358,10 @@ int SpiFilterClearFlashDirtyState(void)
 /**
  * Get a SPI filter read/write region.
  *
- * @param filter The SPI filter to query.
+ * The region is read back from the write privilege table of the SPI monitor, where regions that
+ * touch have been merged.
+ *
+ * @param dev_id The SPI monitor to query.
  * @param region The filter region to select.  This is a region index, starting with 1.
  * @param start_addr The first address in the filtered region.
  * @param end_addr One past the last address in the filtered region.
@@ -365,15 +369,26 @@ int SpiFilterClearFlashDirtyState(void)
  * @return Completion status, 0 if success or an error code.  If the region specified is not
  * supported by the filter, SPI_FILTER_UNSUPPORTED_RW_REGION will be returned.
  */
-int SpiGetFilterRwRegion(uint8_t Region, uint32_t *StartAddress, uint32_t *EndAddress)
+int SpiGetFilterRwRegion(int DevId, uint8_t Region, uint32_t *StartAddress, uint32_t *EndAddress)
 {
-	return 0;
+	int ret;
+
+	if ((StartAddress == NULL) || (EndAddress == NULL)) {
+		return SPI_FILTER_INVALID_ARGUMENT;
+	}
+
+	ret = Get_SPI_Filter_RW_Region(spim_devs[DevId], Region, StartAddress, EndAddress);
+	if (ret == -ENOENT) {
+		return SPI_FILTER_UNSUPPORTED_RW_REGION;
+	}
+
+	return ret;
 }
 
 /**
  * Set a SPI filter read/write region.
  *
- * @param filter The SPI filter to update.
+ * @param dev_id The SPI monitor to update.
  * @param region The filter region to modify.  This is a region index, starting with 1.
  * @param start_addr The first address in the filtered region.
  * @param end_addr One past the last address in the filtered region.
@@ -381,15 +396,13 @@ int SpiGetFilterRwRegion(uint8_t Region, uint32_t *StartAddress, uint32_t *EndAd
  * @return Completion status, 0 if success or an error code.  If the region specified is not
  * supported by the filter, SPI_FILTER_UNSUPPORTED_RW_REGION will be returned.
  */
-int SpiSetFilterRwRegion(uint8_t Region, uint32_t StartAddress, uint32_t EndAddress)
+int SpiSetFilterRwRegion(int DevId, uint8_t Region, uint32_t StartAddress, uint32_t EndAddress)
 {
 	int ret = 0;
-	int dev_id = 0;
 
 	uint32_t length = EndAddress - StartAddress;
 
-	// need to modify
-	ret = Set_SPI_Filter_RW_Region(spim_devs[dev_id], SPI_FILTER_WRITE_PRIV, SPI_FILTER_PRIV_ENABLE, StartAddress, length);
+	ret = Set_SPI_Filter_RW_Region(spim_devs[DevId], SPI_FILTER_WRITE_PRIV, SPI_FILTER_PRIV_ENABLE, StartAddress, length);
 
 	return ret;
 }
@@ -397,11 +410,22 @@ int SpiSetFilterRwRegion(uint8_t Region, uint32_t StartAddress, uint32_t EndAddr
 /**
  * Clear all read/write regions configured in the SPI filter.
  *
- * @param filter The SPI filter to update.
+ * @param dev_id The SPI monitor to update.
  *
  * @return 0 if the regions were cleared successfully or an error code.
  */
-int SpiClearFilterRwRegions(void)
+int SpiClearFilterRwRegions(int DevId)
 {
+	static const uint32_t no_access[SPI_FILTER_PRIV_TABLE_CHUNK];
+	uint32_t first_reg;
+	int ret;
+
+	for (first_reg = 0; first_reg < SPI_FILTER_PRIV_TABLE_REGS; first_reg += SPI_FILTER_PRIV_TABLE_CHUNK) {
+		ret = Set_SPI_Filter_Priv_Table(spim_devs[DevId], SPI_FILTER_WRITE_PRIV, first_reg, no_access, SPI_FILTER_PRIV_TABLE_CHUNK);
+		if (ret) {
+			return ret;
+		}
+	}
+
 	return 0;
 }
@@ -40,8 +40,8 @@ int SpiFilterAllowAllSingleFlashWrites(bool Allowed);
 int SpiFilterGetWriteEnableDetected(bool *Detected);
 int SpiFilterGetFlashDirtyState(spi_filter_flash_state *State);
 int SpiFilterClearFlashDirtyState(void);
-int SpiGetFilterRwRegion(uint8_t Region, uint32_t *StartAddress, uint32_t *EndAddress);
-int SpiSetFilterRwRegion(uint8_t Region, uint32_t StartAddress, uint32_t EndAddress);
-int SpiClearFilterRwRegions(void);
+int SpiGetFilterRwRegion(int DevId, uint8_t Region, uint32_t *StartAddress, uint32_t *EndAddress);
+int SpiSetFilterRwRegion(int DevId, uint8_t Region, uint32_t StartAddress, uint32_t EndAddress);
+int SpiClearFilterRwRegions(int DevId);
 
 #endif /* SPIFILTER_WRAPPER_H_ */
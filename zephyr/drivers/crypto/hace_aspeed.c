@@ -9,6 +9,7 @@
 #include <drivers/reset_control.h>
 #include "soc.h"
 #include "hace_aspeed.h"
+#include "hash_aspeed_priv.h"
 
 #define LOG_LEVEL CONFIG_CRYPTO_LOG_LEVEL
 #include <logging/log.h>
@@ -27,10 +28,92 @@ struct hace_config {
 
 struct aspeed_hace_engine hace_eng;
 
+/* How long an abandoned job gets to finish before HACE is reset */
+#define HACE_STOP_TIMEOUT_US	1000
+
+static const struct device *hace_reset_dev;
+static reset_control_subsys_t hace_rst_id;
+
 #define DEV_CFG(dev)				 \
 	((const struct hace_config *const) \
 	 (dev)->config)
 
+int aspeed_hace_hash_start(struct aspeed_hash_ctx *data, uint32_t len)
+{
+	struct hace_register_s *hace_register = hace_eng.base;
+
+	if (hace_register->hace_sts.fields.hash_engine_sts) {
+		LOG_ERR("HACE error: engine busy\n");
+		return -EBUSY;
+	}
+
+	/* Clear pending completion status */
+	hace_register->hace_sts.value = HACE_HASH_ISR;
+
+	hace_register->hash_data_src.value = (uint32_t)data->sg;
+	hace_register->hash_dgst_dst.value = (uint32_t)data->digest;
+	hace_register->hash_key_buf.value = (uint32_t)data->digest;
+	hace_register->hash_data_len.value = len;
+	hace_register->hash_cmd_reg.value = data->method | HASH_CMD_INT_ENABLE;
+
+	return 0;
+}
+
+/* Complete a finished job whose interrupt was not taken */
+void aspeed_hace_hash_poll(void)
+{
+	struct hace_register_s *hace_register = hace_eng.base;
+	unsigned int key;
+	bool done;
+
+	key = irq_lock();
+	done = (hace_register->hace_sts.value & HACE_HASH_ISR) != 0;
+	if (done)
+		hace_register->hace_sts.value = HACE_HASH_ISR;
+	irq_unlock(key);
+
+	if (done)
+		aspeed_hash_complete(0);
+}
+
+/*
+ * Quiesce HACE after its job was abandoned. The job gets a short grace period
+ * to finish, then the engine is reset. Its completion status is dropped either
+ * way, so it cannot be credited to the next job.
+ */
+void aspeed_hace_hash_stop(void)
+{
+	struct hace_register_s *hace_register = hace_eng.base;
+	int i;
+
+	for (i = 0; i < HACE_STOP_TIMEOUT_US; i++) {
+		if (!hace_register->hace_sts.fields.hash_engine_sts)
+			break;
+		k_busy_wait(1);
+	}
+
+	if (hace_register->hace_sts.fields.hash_engine_sts) {
+		LOG_ERR("HACE error: engine stuck, resetting\n");
+		reset_control_assert(hace_reset_dev, hace_rst_id);
+		k_busy_wait(100);
+		reset_control_deassert(hace_reset_dev, hace_rst_id);
+	}
+
+	hace_register->hace_sts.value = HACE_HASH_ISR;
+}
+
+static void hace_isr(const void *arg)
+{
+	struct hace_register_s *hace_register = hace_eng.base;
+
+	ARG_UNUSED(arg);
+
+	if (hace_register->hace_sts.value & HACE_HASH_ISR) {
+		hace_register->hace_sts.value = HACE_HASH_ISR;
+		aspeed_hash_complete(0);
+	}
+}
+
 /* Crypto controller driver registration */
 static int hace_init(const struct device *dev)
 {
@@ -44,6 +127,15 @@ static int hace_init(const struct device *dev)
 	k_msleep(10);
 	reset_control_deassert(reset_dev, DEV_CFG(dev)->rst_id);
 	hace_eng.base = (struct hace_register_s *)hace_base;
+	hace_reset_dev = reset_dev;
+	hace_rst_id = DEV_CFG(dev)->rst_id;
+
+	/* Hash jobs complete in hace_isr */
+	hace_eng.base->hace_sts.value = HACE_HASH_ISR;
+	IRQ_CONNECT(DT_INST_IRQN(0),
+				DT_INST_IRQ(0, priority),
+				hace_isr, NULL, 0);
+	irq_enable(DT_INST_IRQN(0));
 
 	return 0;
 }
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2022 AMI
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Software model of the HACE hash engine in accumulative scatter-gather mode,
+ * for running the ASPEED hash driver on native_posix. Like HACE, it loads the
+ * intermediate digest from the session's digest buffer, hashes the blocks
+ * described by the sg list, stores the digest back and raises its completion
+ * later, from a timer interrupt.
+ */
+
+#include <kernel.h>
+#include <string.h>
+#include <logging/log.h>
+#include <sys/byteorder.h>
+
+#include "hash_aspeed_priv.h"
+
+LOG_MODULE_REGISTER(hace_sim, CONFIG_CRYPTO_LOG_LEVEL);
+
+#define HACE_ALGO_MASK		(BIT(4) | BIT(5) | BIT(6) | BIT(10))
+
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint64_t sha512_k[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+struct hace_sim {
+	struct k_timer timer;
+	bool busy;
+};
+
+static struct hace_sim hace_sim;
+
+#define ROR32(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+#define ROR64(x, n)	(((x) >> (n)) | ((x) << (64 - (n))))
+
+static void hace_sim_sha256_block(uint32_t *h, const uint8_t *block)
+{
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, k, t1, t2;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = sys_get_be32(&block[i * 4]);
+	for (; i < 64; i++)
+		w[i] = w[i - 16] + w[i - 7] +
+			(ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3)) +
+			(ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10));
+
+	a = h[0]; b = h[1]; c = h[2]; d = h[3];
+	e = h[4]; f = h[5]; g = h[6]; k = h[7];
+	for (i = 0; i < 64; i++) {
+		t1 = k + (ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25)) +
+			((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+		t2 = (ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22)) +
+			((a & b) ^ (a & c) ^ (b & c));
+		k = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+	h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+	h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+static void hace_sim_sha512_block(uint64_t *h, const uint8_t *block)
+{
+	uint64_t w[80];
+	uint64_t a, b, c, d, e, f, g, k, t1, t2;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = sys_get_be64(&block[i * 8]);
+	for (; i < 80; i++)
+		w[i] = w[i - 16] + w[i - 7] +
+			(ROR64(w[i - 15], 1) ^ ROR64(w[i - 15], 8) ^ (w[i - 15] >> 7)) +
+			(ROR64(w[i - 2], 19) ^ ROR64(w[i - 2], 61) ^ (w[i - 2] >> 6));
+
+	a = h[0]; b = h[1]; c = h[2]; d = h[3];
+	e = h[4]; f = h[5]; g = h[6]; k = h[7];
+	for (i = 0; i < 80; i++) {
+		t1 = k + (ROR64(e, 14) ^ ROR64(e, 18) ^ ROR64(e, 41)) +
+			((e & f) ^ (~e & g)) + sha512_k[i] + w[i];
+		t2 = (ROR64(a, 28) ^ ROR64(a, 34) ^ ROR64(a, 39)) +
+			((a & b) ^ (a & c) ^ (b & c));
+		k = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+	h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+	h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+/* Hash whole blocks from the sg list into the digest buffer, as HACE does */
+static int hace_sim_hash(struct aspeed_hash_ctx *data, uint32_t len)
+{
+	const struct aspeed_sg *sg = data->sg;
+	const uint8_t *src;
+	uint8_t block[128];
+	uint32_t block_size;
+	uint32_t filled = 0;
+	uint32_t total = 0;
+	uint32_t chunk;
+	uint32_t entry;
+	uint32_t h32[8];
+	uint64_t h64[8];
+	bool last;
+	int i;
+
+	switch (data->method & HACE_ALGO_MASK) {
+	case HACE_ALGO_SHA256:
+		block_size = 64;
+		for (i = 0; i < 8; i++)
+			h32[i] = sys_get_be32(&data->digest[i * 4]);
+		break;
+	case HACE_ALGO_SHA384:
+	case HACE_ALGO_SHA512:
+		block_size = 128;
+		for (i = 0; i < 8; i++)
+			h64[i] = sys_get_be64(&data->digest[i * 8]);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	do {
+		last = (sg->len & HACE_SG_LAST) != 0;
+		entry = sg->len & ~HACE_SG_LAST;
+		src = (const uint8_t *)(uintptr_t)sg->addr;
+		total += entry;
+
+		while (entry != 0) {
+			chunk = MIN(entry, block_size - filled);
+			memcpy(&block[filled], src, chunk);
+			filled += chunk;
+			src += chunk;
+			entry -= chunk;
+
+			if (filled == block_size) {
+				if (block_size == 64)
+					hace_sim_sha256_block(h32, block);
+				else
+					hace_sim_sha512_block(h64, block);
+				filled = 0;
+			}
+		}
+		sg++;
+	} while (!last && sg < &data->sg[ARRAY_SIZE(data->sg)]);
+
+	if (!last || total != len || filled != 0) {
+		LOG_ERR("HACE sim: bad sg list, %u of %u bytes", total, len);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < 8; i++) {
+		if (block_size == 64)
+			sys_put_be32(h32[i], &data->digest[i * 4]);
+		else
+			sys_put_be64(h64[i], &data->digest[i * 8]);
+	}
+
+	return 0;
+}
+
+static void hace_sim_isr(struct k_timer *timer)
+{
+	ARG_UNUSED(timer);
+
+	hace_sim.busy = false;
+	aspeed_hash_complete(0);
+}
+
+int aspeed_hace_hash_start(struct aspeed_hash_ctx *data, uint32_t len)
+{
+	int rc;
+
+	if (hace_sim.busy) {
+		LOG_ERR("HACE error: engine busy\n");
+		return -EBUSY;
+	}
+
+	rc = hace_sim_hash(data, len);
+	if (rc)
+		return rc;
+
+	/* Complete from interrupt context a tick later, like the real engine */
+	hace_sim.busy = true;
+	k_timer_start(&hace_sim.timer, K_TICKS(1), K_NO_WAIT);
+
+	return 0;
+}
+
+/* The model's timer interrupt is never lost, there is nothing to poll */
+void aspeed_hace_hash_poll(void)
+{
+}
+
+void aspeed_hace_hash_stop(void)
+{
+	k_timer_stop(&hace_sim.timer);
+	hace_sim.busy = false;
+}
+
+static int hace_sim_init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	k_timer_init(&hace_sim.timer, hace_sim_isr, NULL);
+	hace_sim.busy = false;
+
+	return 0;
+}
+
+SYS_INIT(hace_sim_init, POST_KERNEL, CONFIG_KERNEL_INIT_PRIORITY_DEVICE);
@@ -11,9 +11,15 @@
 #include <logging/log.h>
 #include <sys/byteorder.h>
 
-#include "hace_aspeed.h"
 #include "hash_aspeed_priv.h"
 
+#ifdef CONFIG_CRYPTO_ASPEED_HACE_SIM
+/* The software model reads the session buffers directly */
+#define NON_CACHED_BSS_ALIGN16 __aligned(16)
+#else
+#include <soc.h>
+#endif
+
 LOG_MODULE_REGISTER(hash_aspeed, CONFIG_CRYPTO_LOG_LEVEL);
 
 static const uint32_t sha256_iv[8] = {
@@ -35,20 +41,10 @@ static const uint32_t sha512_iv[16] = {
 	0xabd9831fUL, 0x6bbd41fbUL, 0x19cde05bUL, 0x79217e13UL
 };
 
-static struct aspeed_hash_drv_state drv_state NON_CACHED_BSS_ALIGN16;
+#define HASH_TIMEOUT_MS		3000
+#define HASH_POLL_MS		1
 
-static int aspeed_hash_wait_completion(int timeout_ms)
-{
-	struct hace_register_s *hace_register = hace_eng.base;
-	union hace_sts_s hace_sts;
-	int ret;
-
-	ret = reg_read_poll_timeout(hace_register, hace_sts, hace_sts,
-								hace_sts.fields.hash_int, 1, timeout_ms);
-	if (ret)
-		LOG_ERR("HACE poll timeout\n");
-	return ret;
-}
+static struct aspeed_hash_drv_state drv_state NON_CACHED_BSS_ALIGN16;
 
 static void aspeed_ahash_fill_padding(struct aspeed_hash_ctx *ctx, unsigned int remainder)
 {
@@ -75,36 +71,179 @@ static void aspeed_ahash_fill_padding(struct aspeed_hash_ctx *ctx, unsigned int
 	}
 }
 
-static int hash_trigger(struct aspeed_hash_ctx *data, int hash_len)
+static void aspeed_hash_job_done(struct aspeed_hash_ctx *data, int status)
 {
-	struct hace_register_s *hace_register = hace_eng.base;
+	struct hash_pkt *pkt = data->pkt;
+	struct hash_ctx *ctx = data->ctx;
 
-	if (hace_register->hace_sts.fields.hash_engine_sts) {
-		LOG_ERR("HACE error: engine busy\n");
-		return -EBUSY;
+	/* data->buffer is a HACE source until completion, stage the tail only now */
+	if (data->pending_len != 0)
+		memcpy(data->buffer, data->pending_src, data->pending_len);
+	data->bufcnt = data->pending_len;
+	data->pending_len = 0;
+	data->job_status = status;
+	data->pkt = NULL;
+
+	if (pkt != NULL && ctx->completion_cb != NULL)
+		ctx->completion_cb(pkt, status);
+
+	k_sem_give(&data->done);
+}
+
+/*
+ * Hand queued jobs to HACE until one is running. A job HACE refuses is
+ * completed with the error, outside the lock since it signals its waiter.
+ */
+static void aspeed_hash_engine_run(void)
+{
+	struct aspeed_hash_ctx *data;
+	k_spinlock_key_t key;
+	sys_snode_t *node;
+	int rc;
+
+	for (;;) {
+		key = k_spin_lock(&drv_state.lock);
+		if (drv_state.active != NULL || drv_state.stopping) {
+			k_spin_unlock(&drv_state.lock, key);
+			return;
+		}
+
+		node = sys_slist_get(&drv_state.queue);
+		if (node == NULL) {
+			k_spin_unlock(&drv_state.lock, key);
+			return;
+		}
+
+		data = CONTAINER_OF(node, struct aspeed_hash_ctx, node);
+		rc = aspeed_hace_hash_start(data, data->job_len);
+		if (rc == 0)
+			drv_state.active = data;
+		k_spin_unlock(&drv_state.lock, key);
+
+		if (rc == 0)
+			return;
+
+		aspeed_hash_job_done(data, rc);
 	}
+}
 
-	/* Clear pending completion status */
-	hace_register->hace_sts.value = HACE_HASH_ISR;
+/* Called by the engine backend, in interrupt context, when HACE is done */
+void aspeed_hash_complete(int status)
+{
+	struct aspeed_hash_ctx *data;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&drv_state.lock);
+	data = drv_state.active;
+	if (data == NULL) {
+		/* Late completion of a job its waiter already abandoned */
+		k_spin_unlock(&drv_state.lock, key);
+		return;
+	}
+	drv_state.active = NULL;
+	k_spin_unlock(&drv_state.lock, key);
 
-	hace_register->hash_data_src.value = (uint32_t)data->sg;
-	hace_register->hash_dgst_dst.value = (uint32_t)data->digest;
-	hace_register->hash_key_buf.value = (uint32_t)data->digest;
-	hace_register->hash_data_len.value = hash_len;
-	hace_register->hash_cmd_reg.value = data->method;
+	/* Keep HACE busy with the next session before finishing this one */
+	aspeed_hash_engine_run();
 
-	return aspeed_hash_wait_completion(3000);
+	aspeed_hash_job_done(data, status);
 }
 
-static int aspeed_hash_update(struct hash_ctx *ctx, struct hash_pkt *pkt)
+static void aspeed_hash_submit(struct aspeed_hash_ctx *data, uint32_t len,
+							   struct hash_pkt *pkt)
+{
+	k_spinlock_key_t key;
+
+	data->job_len = len;
+	data->pkt = pkt;
+	data->busy = true;
+	k_sem_reset(&data->done);
+
+	key = k_spin_lock(&drv_state.lock);
+	sys_slist_append(&drv_state.queue, &data->node);
+	k_spin_unlock(&drv_state.lock, key);
+
+	aspeed_hash_engine_run();
+}
+
+/* Drop a timed out job, idling HACE first if it is the one running */
+static void aspeed_hash_abandon(struct aspeed_hash_ctx *data, bool running)
+{
+	k_spinlock_key_t key;
+
+	if (running) {
+		aspeed_hace_hash_stop();
+
+		key = k_spin_lock(&drv_state.lock);
+		drv_state.stopping = false;
+		k_spin_unlock(&drv_state.lock, key);
+	}
+
+	data->pending_len = 0;
+	data->pkt = NULL;
+	data->busy = false;
+	aspeed_hash_engine_run();
+}
+
+static int aspeed_hash_wait(struct hash_ctx *ctx)
+{
+	struct aspeed_hash_ctx *data = ctx->drv_sessn_state;
+	k_spinlock_key_t key;
+	bool running = false;
+	bool queued = false;
+	int waited;
+
+	if (!data->busy)
+		return 0;
+
+	for (waited = 0; waited < HASH_TIMEOUT_MS; waited += HASH_POLL_MS) {
+		if (k_sem_take(&data->done, K_MSEC(HASH_POLL_MS)) == 0) {
+			data->busy = false;
+			return data->job_status;
+		}
+
+		/* Fall back to polling when the HACE interrupt does not arrive */
+		aspeed_hace_hash_poll();
+	}
+
+	/* Decide under the lock, the job may have completed meanwhile */
+	key = k_spin_lock(&drv_state.lock);
+	if (drv_state.active == data) {
+		drv_state.active = NULL;
+		drv_state.stopping = true;
+		running = true;
+	} else {
+		queued = sys_slist_find_and_remove(&drv_state.queue, &data->node);
+	}
+	k_spin_unlock(&drv_state.lock, key);
+
+	if (!running && !queued) {
+		/* Its completion is being signalled right now */
+		k_sem_take(&data->done, K_FOREVER);
+		data->busy = false;
+		return data->job_status;
+	}
+
+	LOG_ERR("HACE timeout\n");
+	aspeed_hash_abandon(data, running);
+
+	return -ETIMEDOUT;
+}
+
+static int aspeed_hash_update_common(struct hash_ctx *ctx, struct hash_pkt *pkt,
+									 bool async)
 {
-	struct aspeed_hash_ctx *data = &drv_state.data;
+	struct aspeed_hash_ctx *data = ctx->drv_sessn_state;
 	struct aspeed_sg *sg = data->sg;
 	int rc;
 	int remainder;
 	int total_len;
 	int i;
 
+	rc = aspeed_hash_wait(ctx);
+	if (rc)
+		return rc;
+
 	data->digcnt[0] += pkt->in_len;
 	if (data->digcnt[0] < pkt->in_len)
 		data->digcnt[1]++;
@@ -112,6 +251,8 @@ static int aspeed_hash_update(struct hash_ctx *ctx, struct hash_pkt *pkt)
 	if (data->bufcnt + pkt->in_len < data->block_size) {
 		memcpy(data->buffer + data->bufcnt, pkt->in_buf, pkt->in_len);
 		data->bufcnt += pkt->in_len;
+		if (async && ctx->completion_cb != NULL)
+			ctx->completion_cb(pkt, 0);
 		return 0;
 	}
 	remainder = (pkt->in_len + data->bufcnt) % data->block_size;
@@ -130,20 +271,29 @@ static int aspeed_hash_update(struct hash_ctx *ctx, struct hash_pkt *pkt)
 		sg[i].len = (total_len - data->bufcnt) | HACE_SG_LAST;
 	}
 
-	rc = hash_trigger(data, total_len);
-	if (remainder != 0) {
-		memcpy(data->buffer, pkt->in_buf + (total_len - data->bufcnt), remainder);
-		data->bufcnt = remainder;
-	}
-	if (rc)
-		return rc;
+	data->pending_src = pkt->in_buf + (total_len - data->bufcnt);
+	data->pending_len = remainder;
 
-	return 0;
+	aspeed_hash_submit(data, total_len, async ? pkt : NULL);
+	if (async)
+		return 0;
+
+	return aspeed_hash_wait(ctx);
+}
+
+static int aspeed_hash_update(struct hash_ctx *ctx, struct hash_pkt *pkt)
+{
+	return aspeed_hash_update_common(ctx, pkt, false);
+}
+
+static int aspeed_hash_update_async(struct hash_ctx *ctx, struct hash_pkt *pkt)
+{
+	return aspeed_hash_update_common(ctx, pkt, true);
 }
 
 static int aspeed_hash_final(struct hash_ctx *ctx, struct hash_pkt *pkt)
 {
-	struct aspeed_hash_ctx *data = &drv_state.data;
+	struct aspeed_hash_ctx *data = ctx->drv_sessn_state;
 	struct aspeed_sg *sg = data->sg;
 	int rc;
 
@@ -151,12 +301,18 @@ static int aspeed_hash_final(struct hash_ctx *ctx, struct hash_pkt *pkt)
 		LOG_ERR("HACE error: insufficient size on destination buffer\n");
 		return -EINVAL;
 	}
+
+	rc = aspeed_hash_wait(ctx);
+	if (rc)
+		return rc;
+
 	aspeed_ahash_fill_padding(data, 0);
 
 	sg[0].addr = (uint32_t)data->buffer;
 	sg[0].len = data->bufcnt | HACE_SG_LAST;
 
-	rc = hash_trigger(data, data->bufcnt);
+	aspeed_hash_submit(data, data->bufcnt, NULL);
+	rc = aspeed_hash_wait(ctx);
 	if (rc) {
 		return rc;
 	}
@@ -167,8 +323,17 @@ static int aspeed_hash_final(struct hash_ctx *ctx, struct hash_pkt *pkt)
 
 static int aspeed_hash_init(const struct device *dev)
 {
+	int i;
+
 	ARG_UNUSED(dev);
-	drv_state.in_use = false;
+
+	sys_slist_init(&drv_state.queue);
+	drv_state.active = NULL;
+	drv_state.stopping = false;
+	for (i = 0; i < ARRAY_SIZE(drv_state.sessions); i++) {
+		drv_state.sessions[i].in_use = false;
+		k_sem_init(&drv_state.sessions[i].done, 0, 1);
+	}
 
 	return 0;
 }
@@ -177,17 +342,28 @@ static int aspeed_hash_session_setup(const struct device *dev,
 									 struct hash_ctx *ctx,
 									 enum hash_algo algo)
 {
-	struct aspeed_hash_ctx *data;
+	struct aspeed_hash_ctx *data = NULL;
+	k_spinlock_key_t key;
+	int i;
 
 	ARG_UNUSED(dev);
 
-	if (drv_state.in_use) {
-		LOG_ERR("Peripheral in use");
-		return -EBUSY;
+	ctx->drv_sessn_state = NULL;
+
+	key = k_spin_lock(&drv_state.lock);
+	for (i = 0; i < ARRAY_SIZE(drv_state.sessions); i++) {
+		if (!drv_state.sessions[i].in_use) {
+			data = &drv_state.sessions[i];
+			data->in_use = true;
+			break;
+		}
 	}
+	k_spin_unlock(&drv_state.lock, key);
 
-	data = &drv_state.data;
-	drv_state.in_use = true;
+	if (data == NULL) {
+		LOG_ERR("No free HASH session");
+		return -EBUSY;
+	}
 
 	data->method = HASH_CMD_ACC_MODE | HACE_SHA_BE_EN | HACE_SG_EN;
 	switch (algo) {
@@ -211,11 +387,19 @@ static int aspeed_hash_session_setup(const struct device *dev,
 		break;
 	default:
 		LOG_ERR("ASPEED HASH Unsupported mode");
+		data->in_use = false;
 		return -EINVAL;
 	}
 	ctx->ops.update_hndlr = aspeed_hash_update;
 	ctx->ops.final_hndlr = aspeed_hash_final;
-
+	ctx->ops.update_async_hndlr = aspeed_hash_update_async;
+	ctx->ops.wait_hndlr = aspeed_hash_wait;
+	ctx->drv_sessn_state = data;
+
+	data->ctx = ctx;
+	data->pkt = NULL;
+	data->busy = false;
+	data->pending_len = 0;
 	data->bufcnt = 0;
 	data->digcnt[0] = 0;
 	data->digcnt[1] = 0;
@@ -226,14 +410,20 @@ static int aspeed_hash_session_setup(const struct device *dev,
 static int aspeed_hash_session_free(const struct device *dev,
 									struct hash_ctx *ctx)
 {
+	struct aspeed_hash_ctx *data = ctx->drv_sessn_state;
+
 	ARG_UNUSED(dev);
-	ARG_UNUSED(ctx);
 
-	drv_state.in_use = false;
+	if (data == NULL)
+		return 0;
+
+	/* Never release the buffers while HACE may still be reading them */
+	aspeed_hash_wait(ctx);
+	ctx->drv_sessn_state = NULL;
+	data->in_use = false;
 
 	return 0;
 }
-
 static struct hash_driver_api hash_funcs = {
 	.begin_session = aspeed_hash_session_setup,
 	.free_session = aspeed_hash_session_free,
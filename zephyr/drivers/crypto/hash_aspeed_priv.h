@@ -18,6 +18,8 @@
 #define ZEPHYR_DRIVERS_CRYPTO_HASH_ASPEED_PRIV_H_
 
 #include <kernel.h>
+#include <sys/slist.h>
+#include <crypto/hash.h>
 
 #define ASPEED_HACE_STS					0x1C
 #define  HACE_RSA_ISR					BIT(13)
@@ -41,6 +43,7 @@
 #define  HACE_ALGO_SHA512				(BIT(5) | BIT(6))
 #define  HACE_ALGO_SHA384				(BIT(5) | BIT(6) | BIT(10))
 #define  HASH_CMD_ACC_MODE				(0x2 << 7)
+#define  HASH_CMD_INT_ENABLE			BIT(9)
 #define  HACE_SG_EN						BIT(18)
 
 struct aspeed_sg {
@@ -56,11 +59,36 @@ struct aspeed_hash_ctx {
 	uint64_t digcnt[2]; /* total length */
 	uint32_t bufcnt;
 	uint8_t buffer[256];
+	bool in_use; /* session is allocated to a hash_ctx */
+	bool busy; /* a job of this session is queued or running on HACE */
+	const uint8_t *pending_src; /* partial block to stage once HACE is done */
+	uint32_t pending_len;
+	uint32_t job_len; /* bytes described by sg for the queued job */
+	int job_status;
+	struct hash_ctx *ctx;
+	struct hash_pkt *pkt; /* packet of an asynchronous update, for its callback */
+	sys_snode_t node; /* entry in the engine queue */
+	struct k_sem done;
 };
 
 struct aspeed_hash_drv_state {
-	struct aspeed_hash_ctx data;
-	bool in_use;
+	struct aspeed_hash_ctx sessions[CONFIG_CRYPTO_ASPEED_HASH_SESSIONS];
+	sys_slist_t queue; /* sessions waiting for HACE */
+	struct aspeed_hash_ctx *active; /* session HACE is working on */
+	bool stopping; /* HACE is being quiesced after a timed out job */
+	struct k_spinlock lock;
 };
 
+/*
+ * HACE hash engine backend, provided by hace_aspeed.c or by the software
+ * model. It starts the job described by the session's sg list and digest
+ * buffer, then reports completion with aspeed_hash_complete() from interrupt
+ * context. aspeed_hace_hash_poll() reports a completion whose interrupt was
+ * missed, and aspeed_hace_hash_stop() idles the engine after a timeout.
+ */
+int aspeed_hace_hash_start(struct aspeed_hash_ctx *data, uint32_t len);
+void aspeed_hace_hash_poll(void);
+void aspeed_hace_hash_stop(void);
+void aspeed_hash_complete(int status);
+
 #endif  /* ZEPHYR_DRIVERS_CRYPTO_HASH_ASPEED_PRIV_H_ */
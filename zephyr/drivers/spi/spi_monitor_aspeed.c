@@ -952,6 +952,76 @@ end:
 	return ret;
 }
 
+/* read back consecutive registers of an address privilege table */
+int spim_address_privilege_table_read(const struct device *dev,
+	enum addr_priv_rw_select rw_select, uint32_t first_reg,
+	uint32_t *val, uint32_t reg_num)
+{
+	const struct aspeed_spim_config *config = dev->config;
+	mm_reg_t priv_table_base = config->ctrl_base + SPIM_ADDR_PRIV_TABLE_BASE;
+	uint32_t i;
+
+	if (first_reg >= SPIM_ADDR_PRIV_REG_NUN ||
+		reg_num > SPIM_ADDR_PRIV_REG_NUN - first_reg) {
+		LOG_WRN("invalid privilege table range!");
+		return -EINVAL;
+	}
+
+	acquire_spim_device(dev);
+
+	spim_addr_priv_access_enable(dev, rw_select);
+	for (i = 0; i < reg_num; i++)
+		val[i] = sys_read32(priv_table_base + (first_reg + i) * 4);
+
+	release_spim_device(dev);
+
+	return 0;
+}
+
+/*
+ * write consecutive registers of an address privilege table with a single
+ * table selection, so a whole region list can be applied in one pass
+ */
+int spim_address_privilege_table_write(const struct device *dev,
+	enum addr_priv_rw_select rw_select, uint32_t first_reg,
+	const uint32_t *val, uint32_t reg_num)
+{
+	const struct aspeed_spim_config *config = dev->config;
+	mm_reg_t priv_table_base = config->ctrl_base + SPIM_ADDR_PRIV_TABLE_BASE;
+	int ret = 0;
+	uint32_t i;
+
+	if (first_reg >= SPIM_ADDR_PRIV_REG_NUN ||
+		reg_num > SPIM_ADDR_PRIV_REG_NUN - first_reg) {
+		LOG_WRN("invalid privilege table range!");
+		return -EINVAL;
+	}
+
+	acquire_spim_device(dev);
+
+	/* check lock status */
+	if (rw_select == FLAG_ADDR_PRIV_READ_SELECT &&
+		(sys_read32(config->ctrl_base + SPIM_LOCK_REG) & SPIM_ADDR_PRIV_READ_TABLE_LOCK)) {
+		LOG_ERR("read address privilege table is locked!");
+		ret = -ECANCELED;
+		goto end;
+	} else if (rw_select == FLAG_ADDR_PRIV_WRITE_SELECT &&
+		(sys_read32(config->ctrl_base + SPIM_LOCK_REG) & SPIM_ADDR_PRIV_WRITE_TABLE_LOCK)) {
+		LOG_ERR("write address privilege table is locked!");
+		ret = -ECANCELED;
+		goto end;
+	}
+
+	spim_addr_priv_access_enable(dev, rw_select);
+	for (i = 0; i < reg_num; i++)
+		sys_write32(val[i], priv_table_base + (first_reg + i) * 4);
+
+end:
+	release_spim_device(dev);
+
+	return ret;
+}
+
 void spim_lock_rw_privilege_table(const struct device *dev,
 	enum addr_priv_rw_select rw_select)
 {
@@ -1136,6 +1206,50 @@ void spim_get_log_info(const struct device *dev, struct spim_log_info *info)
 	return;
 }
 
+/*
+ * read consecutive entries of the block log, so a consumer can walk
+ * the log without touching the log RAM directly
+ */
+int spim_log_read(const struct device *dev, uint32_t first_entry,
+	uint32_t *val, uint32_t entry_num)
+{
+	struct aspeed_spim_data *const data = dev->data;
+	uint32_t max_entry = data->log_info.log_max_sz / 4;
+	uint32_t i;
+
+	if (first_entry >= max_entry || entry_num > max_entry - first_entry) {
+		LOG_WRN("invalid log range!");
+		return -EINVAL;
+	}
+
+	for (i = 0; i < entry_num; i++)
+		val[i] = sys_read32(data->log_info.log_ram_addr + (first_entry + i) * 4);
+
+	return 0;
+}
+
+/*
+ * clear consumed log entries, so a set entry at the log pointer
+ * shows that the log wrapped before it was read
+ */
+int spim_log_clear(const struct device *dev, uint32_t first_entry,
+	uint32_t entry_num)
+{
+	struct aspeed_spim_data *const data = dev->data;
+	uint32_t max_entry = data->log_info.log_max_sz / 4;
+	uint32_t i;
+
+	if (first_entry >= max_entry || entry_num > max_entry - first_entry) {
+		LOG_WRN("invalid log range!");
+		return -EINVAL;
+	}
+
+	for (i = 0; i < entry_num; i++)
+		sys_write32(0, data->log_info.log_ram_addr + (first_entry + i) * 4);
+
+	return 0;
+}
+
 uint32_t spim_get_ctrl_idx(const struct device *dev)
 {
 	const struct aspeed_spim_config *config = dev->config;
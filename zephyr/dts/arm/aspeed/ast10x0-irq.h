@@ -12,6 +12,10 @@
 #define INTR_MMC			0
 #define INTR_RESV_1			1
 #define INTR_MAC			2
+/* Unverified on AST1060: taken from the AST2600 mapping, only exercised
+ * against the hace_aspeed_sim.c model.
+ */
+#define INTR_HACE			4
 
 #define INTR_UART5			8
 #define INTR_USBDEV			9
@@ -94,6 +94,7 @@ static inline int hash_begin_session(const struct device *dev,
 
 	api = (struct hash_driver_api *) dev->api;
 	ctx->device = dev;
+	ctx->completion_cb = NULL;
 
 	return api->begin_session(dev, ctx, algo);
 }
@@ -149,6 +150,66 @@ static inline int hash_final(struct hash_ctx *ctx,
 	return ctx->ops.final_hndlr(ctx, pkt);
 }
 
+/**
+ * @brief Start a Hash update without waiting for it to complete.
+ *
+ * The input buffer must stay valid and unmodified until hash_wait()
+ * returns. Drivers without asynchronous support complete the update
+ * before returning.
+ *
+ * @param  ctx   Pointer to the hash context of this op.
+ * @param  pkt   Structure holding the input buffer pointer.
+ *
+ * @return 0 on success, negative errno code on fail.
+ */
+static inline int hash_update_async(struct hash_ctx *ctx,
+							  struct hash_pkt *pkt)
+{
+	int ret;
+
+	pkt->ctx = ctx;
+	if (ctx->ops.update_async_hndlr == NULL) {
+		ret = ctx->ops.update_hndlr(ctx, pkt);
+		if (ctx->completion_cb != NULL)
+			ctx->completion_cb(pkt, ret);
+
+		return ret;
+	}
+
+	return ctx->ops.update_async_hndlr(ctx, pkt);
+}
+
+/**
+ * @brief Set the callback for asynchronous updates of a session.
+ *
+ * The callback runs once the update completes, possibly from interrupt
+ * context, and the input buffer may be reused from then on. Drivers without
+ * asynchronous support invoke it before hash_update_async() returns.
+ *
+ * @param  ctx   Pointer to the hash context of the session.
+ * @param  cb    Callback, or NULL for none.
+ */
+static inline void hash_callback_set(struct hash_ctx *ctx,
+							  hash_completion_cb cb)
+{
+	ctx->completion_cb = cb;
+}
+
+/**
+ * @brief Wait for a Hash update started by hash_update_async().
+ *
+ * @param  ctx   Pointer to the hash context of this op.
+ *
+ * @return 0 on success, negative errno code on fail.
+ */
+static inline int hash_wait(struct hash_ctx *ctx)
+{
+	if (ctx->ops.wait_hndlr == NULL)
+		return 0;
+
+	return ctx->ops.wait_hndlr(ctx);
+}
+
 
 /**
  * @}
@@ -39,10 +39,18 @@ struct hash_pkt;
 
 typedef int (*hash_update_t)(struct hash_ctx *ctx, struct hash_pkt *pkt);
 typedef int (*hash_final_t)(struct hash_ctx *ctx, struct hash_pkt *pkt);
+typedef int (*hash_wait_t)(struct hash_ctx *ctx);
+
+/* Called when an update started by hash_update_async() completes */
+typedef void (*hash_completion_cb)(struct hash_pkt *completed, int status);
 
 struct hash_ops {
 	hash_update_t update_hndlr;
 	hash_final_t final_hndlr;
+	/* Optional: start an update without waiting for the engine */
+	hash_update_t update_async_hndlr;
+	/* Optional: wait for an update started by update_async_hndlr */
+	hash_wait_t wait_hndlr;
 };
 
 /**
@@ -79,6 +87,12 @@ struct hash_ctx {
 	 */
 	void *app_sessn_state;
 
+	/** Optional callback for asynchronous updates, set by the app with
+	 * hash_callback_set() after begin_session(). Drivers may invoke it
+	 * from interrupt context.
+	 */
+	hash_completion_cb completion_cb;
+
 	uint32_t digest_size;
 };
 
@@ -114,6 +114,12 @@ void spim_dump_rw_addr_privilege_table(const struct device *dev);
 int spim_address_privilege_config(const struct device *dev,
 	enum addr_priv_rw_select rw_select, enum addr_priv_op priv_op,
 	mm_reg_t addr, uint32_t len);
+int spim_address_privilege_table_read(const struct device *dev,
+	enum addr_priv_rw_select rw_select, uint32_t first_reg,
+	uint32_t *val, uint32_t reg_num);
+int spim_address_privilege_table_write(const struct device *dev,
+	enum addr_priv_rw_select rw_select, uint32_t first_reg,
+	const uint32_t *val, uint32_t reg_num);
 
 void spim_lock_rw_privilege_table(const struct device *dev,
 	enum addr_priv_rw_select rw_select);
@@ -132,6 +138,10 @@ typedef void (*spim_isr_callback_t)(const struct device *dev);
 void spim_isr_callback_install(const struct device *dev,
 	spim_isr_callback_t isr_callback);
 void spim_get_log_info(const struct device *dev, struct spim_log_info *info);
+int spim_log_read(const struct device *dev, uint32_t first_entry,
+	uint32_t *val, uint32_t entry_num);
+int spim_log_clear(const struct device *dev, uint32_t first_entry,
+	uint32_t entry_num);
 uint32_t spim_get_ctrl_idx(const struct device *dev);
 
 bool get_wdt_timeout_status(const struct device *dev);
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2022 AMI
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Tests for the ASPEED hash driver, run on the software model of HACE. Every
+ * digest is checked against a reference value, so jobs of different sessions
+ * sharing the engine must not disturb each other.
+ */
+
+#include <ztest.h>
+#include <device.h>
+#include <crypto/hash.h>
+
+#define TEST_DATA_SIZE		5000
+#define TEST_SESSIONS		CONFIG_CRYPTO_ASPEED_HASH_SESSIONS
+#define TEST_STACK_SIZE		2048
+
+static const struct device *hash_dev;
+static uint8_t test_data[TEST_DATA_SIZE];
+
+struct test_digest {
+	enum hash_algo algo;
+	uint32_t length;
+	const uint8_t *digest;
+};
+
+/* Digests of test_data */
+static const struct test_digest test_digests[] = {
+	{
+		.algo = HASH_SHA256,
+		.length = 32,
+		.digest =
+			"\x1e\x92\xfd\x98\xf1\x13\xab\xa0\xa7\x8e\x08\x30\xca\x06\xe2\x77"
+			"\x59\x12\x37\x0f\xea\xb1\x12\xdf\xc5\x7b\xf3\x25\x8b\x81\x05\x95",
+	},
+	{
+		.algo = HASH_SHA384,
+		.length = 48,
+		.digest =
+			"\x86\xb2\x8d\x14\x5a\xc3\x39\x3a\x93\xb0\xfb\x08\xa7\x5b\x76\x8c"
+			"\x75\x4d\xa9\x0a\x79\x06\x97\x27\x4c\x6e\xcc\xd4\x4b\x7b\x20\x3b"
+			"\x5e\x1e\x26\x36\xeb\xe3\x1f\x5b\xb1\x23\x16\x7c\x79\x97\x15\xc8",
+	},
+	{
+		.algo = HASH_SHA512,
+		.length = 64,
+		.digest =
+			"\xe1\x5b\x57\xd1\xea\xbf\x16\xa1\x49\x7d\x5f\xa3\x67\x40\x12\x6d"
+			"\xa5\xbd\x32\xed\x99\x70\x23\x9b\x0d\x71\xbc\x42\x5f\x11\x01\x64"
+			"\xfa\x32\x88\xee\x59\x3d\x86\x77\xee\x88\x18\xe0\x09\x27\x52\xa6"
+			"\xf7\x14\xd5\xe2\xb5\x40\xe9\x9d\xd1\xff\x6e\xfa\x0e\x95\xee\xc6",
+	},
+};
+
+/* Update sizes around the block boundaries, adding up to TEST_DATA_SIZE */
+static const int test_fragments[] = {
+	1, 63, 64, 65, 127, 128, 129, 1000, 3423
+};
+
+struct test_callback_log {
+	int count;
+	int order[64];
+	bool in_isr;
+	int status;
+};
+
+static struct test_callback_log callback_log;
+
+static void test_callback(struct hash_pkt *pkt, int status)
+{
+	callback_log.order[callback_log.count++] =
+		(int)(uintptr_t)pkt->ctx->app_sessn_state;
+	callback_log.in_isr |= k_is_in_isr();
+	if (status != 0)
+		callback_log.status = status;
+}
+
+static void test_finish(struct hash_ctx *ctx, const struct test_digest *expected)
+{
+	struct hash_pkt pkt;
+	uint8_t digest[64];
+	int ret;
+
+	pkt.out_buf = digest;
+	pkt.out_buf_max = sizeof(digest);
+
+	ret = hash_final(ctx, &pkt);
+	zassert_equal(ret, 0, "final failed: %d", ret);
+	zassert_equal(ctx->digest_size, expected->length, "wrong digest size");
+	zassert_mem_equal(digest, expected->digest, expected->length,
+					  "digest mismatch for algo %d", expected->algo);
+}
+
+static void test_setup(void)
+{
+	int i;
+
+	for (i = 0; i < sizeof(test_data); i++)
+		test_data[i] = (uint8_t)(i * 31 + 7);
+
+	hash_dev = device_get_binding(CONFIG_CRYPTO_ASPEED_HASH_DRV_NAME);
+	zassert_not_null(hash_dev, "hash device not found");
+}
+
+static void test_fragmented_updates(void)
+{
+	struct hash_ctx ctx;
+	struct hash_pkt pkt;
+	int offset;
+	int ret;
+	int i;
+	int f;
+
+	for (i = 0; i < ARRAY_SIZE(test_digests); i++) {
+		ret = hash_begin_session(hash_dev, &ctx, test_digests[i].algo);
+		zassert_equal(ret, 0, "begin failed: %d", ret);
+
+		offset = 0;
+		for (f = 0; f < ARRAY_SIZE(test_fragments); f++) {
+			pkt.in_buf = &test_data[offset];
+			pkt.in_len = test_fragments[f];
+			offset += test_fragments[f];
+
+			ret = hash_update(&ctx, &pkt);
+			zassert_equal(ret, 0, "update failed: %d", ret);
+		}
+		zassert_equal(offset, TEST_DATA_SIZE, "fragments do not cover the data");
+
+		test_finish(&ctx, &test_digests[i]);
+		hash_free_session(hash_dev, &ctx);
+	}
+}
+
+static void test_empty_message(void)
+{
+	static const struct test_digest empty = {
+		.algo = HASH_SHA256,
+		.length = 32,
+		.digest =
+			"\xe3\xb0\xc4\x42\x98\xfc\x1c\x14\x9a\xfb\xf4\xc8\x99\x6f\xb9\x24"
+			"\x27\xae\x41\xe4\x64\x9b\x93\x4c\xa4\x95\x99\x1b\x78\x52\xb8\x55",
+	};
+	struct hash_ctx ctx;
+	int ret;
+
+	ret = hash_begin_session(hash_dev, &ctx, HASH_SHA256);
+	zassert_equal(ret, 0, "begin failed: %d", ret);
+
+	test_finish(&ctx, &empty);
+	hash_free_session(hash_dev, &ctx);
+}
+
+static void test_session_pool(void)
+{
+	struct hash_ctx ctx[TEST_SESSIONS + 1];
+	int ret;
+	int i;
+
+	for (i = 0; i < TEST_SESSIONS; i++) {
+		ret = hash_begin_session(hash_dev, &ctx[i], HASH_SHA256);
+		zassert_equal(ret, 0, "begin %d failed: %d", i, ret);
+	}
+
+	ret = hash_begin_session(hash_dev, &ctx[TEST_SESSIONS], HASH_SHA256);
+	zassert_equal(ret, -EBUSY, "pool not exhausted: %d", ret);
+
+	/* A failed begin leaves nothing to free */
+	ret = hash_free_session(hash_dev, &ctx[TEST_SESSIONS]);
+	zassert_equal(ret, 0, "free failed: %d", ret);
+
+	hash_free_session(hash_dev, &ctx[0]);
+	ret = hash_begin_session(hash_dev, &ctx[TEST_SESSIONS], HASH_SHA256);
+	zassert_equal(ret, 0, "freed session not reused: %d", ret);
+
+	ret = hash_begin_session(hash_dev, &ctx[0], 0);
+	zassert_equal(ret, -EINVAL, "bad algo accepted: %d", ret);
+
+	for (i = 1; i <= TEST_SESSIONS; i++)
+		hash_free_session(hash_dev, &ctx[i]);
+
+	/* The rejected algorithm did not leak a session */
+	for (i = 0; i < TEST_SESSIONS; i++) {
+		ret = hash_begin_session(hash_dev, &ctx[i], HASH_SHA256);
+		zassert_equal(ret, 0, "begin %d failed: %d", i, ret);
+	}
+	for (i = 0; i < TEST_SESSIONS; i++)
+		hash_free_session(hash_dev, &ctx[i]);
+}
+
+static void test_interleaved_sessions(void)
+{
+	struct hash_ctx ctx[TEST_SESSIONS];
+	struct hash_pkt pkt[TEST_SESSIONS];
+	int offset = 0;
+	int ret;
+	int len;
+	int i;
+
+	memset(&callback_log, 0, sizeof(callback_log));
+
+	for (i = 0; i < TEST_SESSIONS; i++) {
+		ret = hash_begin_session(hash_dev, &ctx[i],
+								 test_digests[i % ARRAY_SIZE(test_digests)].algo);
+		zassert_equal(ret, 0, "begin %d failed: %d", i, ret);
+
+		ctx[i].app_sessn_state = (void *)(uintptr_t)i;
+		hash_callback_set(&ctx[i], test_callback);
+	}
+
+	/* Every session has a job queued on the engine at the same time */
+	while (offset < TEST_DATA_SIZE) {
+		len = MIN(700, TEST_DATA_SIZE - offset);
+		for (i = 0; i < TEST_SESSIONS; i++) {
+			pkt[i].in_buf = &test_data[offset];
+			pkt[i].in_len = len;
+			ret = hash_update_async(&ctx[i], &pkt[i]);
+			zassert_equal(ret, 0, "update %d failed: %d", i, ret);
+		}
+		offset += len;
+	}
+
+	for (i = TEST_SESSIONS - 1; i >= 0; i--) {
+		ret = hash_wait(&ctx[i]);
+		zassert_equal(ret, 0, "wait %d failed: %d", i, ret);
+
+		test_finish(&ctx[i], &test_digests[i % ARRAY_SIZE(test_digests)]);
+		hash_free_session(hash_dev, &ctx[i]);
+	}
+
+	zassert_equal(callback_log.count,
+				  TEST_SESSIONS * DIV_ROUND_UP(TEST_DATA_SIZE, 700),
+				  "missing callbacks");
+	zassert_equal(callback_log.status, 0, "callback reported an error");
+}
+
+static void test_queue_order(void)
+{
+	struct hash_ctx ctx[TEST_SESSIONS];
+	struct hash_pkt pkt[TEST_SESSIONS];
+	int ret;
+	int i;
+
+	memset(&callback_log, 0, sizeof(callback_log));
+
+	for (i = 0; i < TEST_SESSIONS; i++) {
+		ret = hash_begin_session(hash_dev, &ctx[i], HASH_SHA256);
+		zassert_equal(ret, 0, "begin %d failed: %d", i, ret);
+
+		ctx[i].app_sessn_state = (void *)(uintptr_t)i;
+		hash_callback_set(&ctx[i], test_callback);
+
+		pkt[i].in_buf = test_data;
+		pkt[i].in_len = 4096;
+		ret = hash_update_async(&ctx[i], &pkt[i]);
+		zassert_equal(ret, 0, "update %d failed: %d", i, ret);
+	}
+
+	/* Freeing a session waits for its job, which runs after the earlier ones */
+	for (i = TEST_SESSIONS - 1; i >= 0; i--)
+		hash_free_session(hash_dev, &ctx[i]);
+
+	zassert_equal(callback_log.count, TEST_SESSIONS, "missing callbacks");
+	for (i = 0; i < TEST_SESSIONS; i++)
+		zassert_equal(callback_log.order[i], i, "jobs ran out of order");
+	zassert_true(callback_log.in_isr, "completion not signalled by interrupt");
+}
+
+static void test_buffered_update_callback(void)
+{
+	struct hash_ctx ctx;
+	struct hash_pkt pkt;
+	int ret;
+
+	memset(&callback_log, 0, sizeof(callback_log));
+
+	ret = hash_begin_session(hash_dev, &ctx, HASH_SHA256);
+	zassert_equal(ret, 0, "begin failed: %d", ret);
+	hash_callback_set(&ctx, test_callback);
+
+	/* Less than a block never reaches the engine and completes at once */
+	pkt.in_buf = test_data;
+	pkt.in_len = 10;
+	ret = hash_update_async(&ctx, &pkt);
+	zassert_equal(ret, 0, "update failed: %d", ret);
+	zassert_equal(callback_log.count, 1, "no callback for a buffered update");
+
+	hash_free_session(hash_dev, &ctx);
+}
+
+K_THREAD_STACK_ARRAY_DEFINE(test_stacks, 2, TEST_STACK_SIZE);
+static struct k_thread test_threads[2];
+
+static void test_hash_thread(void *p1, void *p2, void *p3)
+{
+	const struct test_digest *expected = p1;
+	struct hash_ctx ctx;
+	struct hash_pkt pkt;
+	int offset;
+	int ret;
+
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	ret = hash_begin_session(hash_dev, &ctx, expected->algo);
+	zassert_equal(ret, 0, "begin failed: %d", ret);
+
+	for (offset = 0; offset < TEST_DATA_SIZE; offset += 500) {
+		pkt.in_buf = &test_data[offset];
+		pkt.in_len = 500;
+		ret = hash_update(&ctx, &pkt);
+		zassert_equal(ret, 0, "update failed: %d", ret);
+	}
+
+	test_finish(&ctx, expected);
+	hash_free_session(hash_dev, &ctx);
+}
+
+static void test_concurrent_threads(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(test_threads); i++) {
+		k_thread_create(&test_threads[i], test_stacks[i], TEST_STACK_SIZE,
+						test_hash_thread, (void *)&test_digests[i], NULL, NULL,
+						K_PRIO_PREEMPT(1), 0, K_NO_WAIT);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(test_threads); i++)
+		k_thread_join(&test_threads[i], K_FOREVER);
+}
+
+void test_main(void)
+{
+	test_setup();
+
+	ztest_test_suite(hash_aspeed,
+					 ztest_unit_test(test_fragmented_updates),
+					 ztest_unit_test(test_empty_message),
+					 ztest_unit_test(test_session_pool),
+					 ztest_unit_test(test_interleaved_sessions),
+					 ztest_unit_test(test_queue_order),
+					 ztest_unit_test(test_buffered_update_callback),
+					 ztest_unit_test(test_concurrent_threads));
+
+	ztest_run_test_suite(hash_aspeed);
+}
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2022 AMI
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Tests for the PFR flash read path of flash_aspeed.c, run on RAM backed
+ * flash devices that take the place of the BMC, PCH and FMC flashes. Like the
+ * SPI controller with DMA, the devices reject long reads whose flash or RAM
+ * address is not 4-byte aligned, and they record where every read went, so
+ * the tests can tell a direct read from one staged through the bounce buffer.
+ */
+
+#include <ztest.h>
+#include <device.h>
+#include <drivers/flash.h>
+#include <storage/flash_map.h>
+#include <flash/flash_aspeed.h>
+
+#define TEST_SPI_SIZE			(64 * 1024)
+#define TEST_FMC_SIZE			(2 * 1024 * 1024)
+#define TEST_UNUSED_SIZE		4096
+#define TEST_SECTOR_SIZE		4096
+#define TEST_DMA_TRIGGER_LEN	128
+#define TEST_READ_SIZE			5000
+
+struct test_flash {
+	uint8_t *mem;
+	size_t size;
+	struct flash_parameters params;
+	int reads; /* reads issued to the device */
+	int direct_reads; /* reads that landed in the caller buffer */
+	uint32_t read_start; /* lowest address read */
+	uint32_t read_end; /* end of the highest read */
+	void *caller_buf;
+};
+
+/* Lookups made through the wrapped functions */
+static int test_binding_lookups;
+static int test_partition_opens;
+
+const struct device *__real_z_impl_device_get_binding(const char *name);
+int __real_flash_area_open(uint8_t id, const struct flash_area **fa);
+
+const struct device *__wrap_z_impl_device_get_binding(const char *name)
+{
+	test_binding_lookups++;
+	return __real_z_impl_device_get_binding(name);
+}
+
+int __wrap_flash_area_open(uint8_t id, const struct flash_area **fa)
+{
+	test_partition_opens++;
+	return __real_flash_area_open(id, fa);
+}
+
+static int test_flash_read(const struct device *dev, off_t offset, void *data, size_t len)
+{
+	struct test_flash *flash = dev->data;
+
+	if (offset < 0 || (offset + len) > flash->size)
+		return -EINVAL;
+
+	if (len > TEST_DMA_TRIGGER_LEN && ((offset | (uintptr_t)data) & 0x3))
+		return -EINVAL;
+
+	flash->reads++;
+	if (data == flash->caller_buf)
+		flash->direct_reads++;
+	flash->read_start = MIN(flash->read_start, (uint32_t)offset);
+	flash->read_end = MAX(flash->read_end, (uint32_t)(offset + len));
+	memcpy(data, &flash->mem[offset], len);
+
+	return 0;
+}
+
+static int test_flash_write(const struct device *dev, off_t offset, const void *data,
+							size_t len)
+{
+	struct test_flash *flash = dev->data;
+
+	if (offset < 0 || (offset + len) > flash->size)
+		return -EINVAL;
+
+	memcpy(&flash->mem[offset], data, len);
+
+	return 0;
+}
+
+static int test_flash_erase(const struct device *dev, off_t offset, size_t size)
+{
+	struct test_flash *flash = dev->data;
+
+	if (offset < 0 || (offset + size) > flash->size)
+		return -EINVAL;
+
+	memset(&flash->mem[offset], 0xff, size);
+
+	return 0;
+}
+
+static int test_flash_write_protection(const struct device *dev, bool enable)
+{
+	return 0;
+}
+
+static const struct flash_parameters *test_flash_get_parameters(const struct device *dev)
+{
+	struct test_flash *flash = dev->data;
+
+	return &flash->params;
+}
+
+#if defined(CONFIG_FLASH_PAGE_LAYOUT)
+static void test_flash_page_layout(const struct device *dev,
+								   const struct flash_pages_layout **layout,
+								   size_t *layout_size)
+{
+	struct test_flash *flash = dev->data;
+	static struct flash_pages_layout pages;
+
+	pages.pages_count = flash->size / TEST_SECTOR_SIZE;
+	pages.pages_size = TEST_SECTOR_SIZE;
+	*layout = &pages;
+	*layout_size = 1;
+}
+#endif
+
+static const struct flash_driver_api test_flash_api = {
+	.read = test_flash_read,
+	.write = test_flash_write,
+	.erase = test_flash_erase,
+	.write_protection = test_flash_write_protection,
+	.get_parameters = test_flash_get_parameters,
+#if defined(CONFIG_FLASH_PAGE_LAYOUT)
+	.page_layout = test_flash_page_layout,
+#endif
+};
+
+static int test_flash_init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+#define TEST_FLASH_DEFINE(n, name, sz)									\
+	static uint8_t test_flash_mem_##n[sz];								\
+	static struct test_flash test_flash_##n = {							\
+		.mem = test_flash_mem_##n,										\
+		.size = sz,														\
+		.params = {														\
+			.write_block_size = TEST_SECTOR_SIZE,						\
+			.erase_value = 0xff,										\
+			.flash_size = sz,											\
+		},																\
+	};																	\
+	DEVICE_DEFINE(test_flash_dev_##n, name, test_flash_init, NULL,		\
+				  &test_flash_##n, NULL, POST_KERNEL,					\
+				  CONFIG_KERNEL_INIT_PRIORITY_DEVICE, &test_flash_api)
+
+TEST_FLASH_DEFINE(bmc, "spi1_cs0", TEST_SPI_SIZE);
+TEST_FLASH_DEFINE(pch, "spi2_cs0", TEST_SPI_SIZE);
+TEST_FLASH_DEFINE(spi2_cs1, "spi2_cs1", TEST_UNUSED_SIZE);
+TEST_FLASH_DEFINE(spi2_cs2, "spi2_cs2", TEST_UNUSED_SIZE);
+TEST_FLASH_DEFINE(fmc, "fmc_cs0", TEST_FMC_SIZE);
+TEST_FLASH_DEFINE(fmc_cs1, "fmc_cs1", TEST_UNUSED_SIZE);
+
+static uint8_t test_buffer[TEST_READ_SIZE + 8] __aligned(4);
+
+static void test_flash_fill(struct test_flash *flash)
+{
+	size_t i;
+
+	for (i = 0; i < flash->size; i++)
+		flash->mem[i] = (uint8_t)(i * 7 + (i >> 8));
+}
+
+static void test_flash_reset(struct test_flash *flash, void *caller_buf)
+{
+	flash->reads = 0;
+	flash->direct_reads = 0;
+	flash->read_start = UINT32_MAX;
+	flash->read_end = 0;
+	flash->caller_buf = caller_buf;
+}
+
+static void test_read(struct test_flash *flash, uint8_t device_id, uint32_t address,
+					  uint32_t flash_offset, uint8_t *data, uint32_t length)
+{
+	int ret;
+
+	test_flash_reset(flash, data);
+
+	ret = SPI_Flash_Read(device_id, address, data, length);
+	zassert_equal(ret, 0, "read of %u bytes at %x failed: %d", length, address, ret);
+	zassert_mem_equal(data, &flash->mem[flash_offset], length,
+					  "wrong data at %x", address);
+	zassert_true(flash->read_start >= ROUND_DOWN(flash_offset, 4),
+				 "read before the request: %x", flash->read_start);
+	zassert_true(flash->read_end <= (flash_offset + length),
+				 "read past the request: %x", flash->read_end);
+}
+
+static void test_setup(void)
+{
+	test_flash_fill(&test_flash_bmc);
+	test_flash_fill(&test_flash_pch);
+	test_flash_fill(&test_flash_fmc);
+}
+
+static void test_read_aligned_direct(void)
+{
+	test_read(&test_flash_bmc, BMC_SPI, 0x1000, 0x1000, test_buffer, TEST_READ_SIZE);
+
+	zassert_equal(test_flash_bmc.reads, 1, "aligned read was split");
+	zassert_equal(test_flash_bmc.direct_reads, 1, "aligned read was bounced");
+}
+
+static void test_read_unaligned_address(void)
+{
+	test_read(&test_flash_pch, PCH_SPI, 0x2003, 0x2003, test_buffer, TEST_READ_SIZE);
+
+	zassert_equal(test_flash_pch.direct_reads, 0, "unaligned read went direct");
+	zassert_equal(test_flash_pch.reads, 2, "expected one read per bounce buffer");
+}
+
+static void test_read_unaligned_buffer(void)
+{
+	test_read(&test_flash_bmc, BMC_SPI, 0x3000, 0x3000, &test_buffer[1], TEST_READ_SIZE);
+
+	zassert_equal(test_flash_bmc.direct_reads, 0, "unaligned read went direct");
+}
+
+static void test_read_unaligned_end(void)
+{
+	/* The transfer is not rounded up past the last requested byte */
+	test_read(&test_flash_bmc, BMC_SPI, 0x101, 0x101, test_buffer, 6);
+	test_read(&test_flash_bmc, BMC_SPI, TEST_SPI_SIZE - 3, TEST_SPI_SIZE - 3, test_buffer, 3);
+}
+
+static void test_read_partition(void)
+{
+	const struct flash_area *fa;
+	int ret;
+
+	ret = flash_area_open(FLASH_AREA_ID(active), &fa);
+	zassert_equal(ret, 0, "active partition not found");
+
+	test_read(&test_flash_fmc, ROT_INTERNAL_ACTIVE, 0x10, fa->fa_off + 0x10,
+			  test_buffer, TEST_READ_SIZE);
+	zassert_equal(test_flash_fmc.direct_reads, 1, "partition read was bounced");
+
+	test_read(&test_flash_fmc, ROT_INTERNAL_ACTIVE, fa->fa_size - 2, fa->fa_off + fa->fa_size - 2,
+			  test_buffer, 2);
+
+	ret = SPI_Flash_Read(ROT_INTERNAL_ACTIVE, fa->fa_size - 2, test_buffer, 4);
+	zassert_equal(ret, -EINVAL, "read past the partition was accepted");
+}
+
+static void test_bindings_cached(void)
+{
+	uint8_t data[16];
+	int i;
+
+	test_binding_lookups = 0;
+	test_partition_opens = 0;
+
+	for (i = 0; i < 8; i++) {
+		zassert_equal(SPI_Flash_Read(BMC_SPI, i * 16, data, sizeof(data)), 0, NULL);
+		zassert_equal(SPI_Flash_Read(PCH_SPI, i * 16, data, sizeof(data)), 0, NULL);
+		zassert_equal(SPI_Flash_Read(ROT_INTERNAL_ACTIVE, i * 16, data, sizeof(data)), 0,
+					  NULL);
+		zassert_equal(SPI_Flash_Read(ROT_INTERNAL_LOG, i * 16, data, sizeof(data)), 0, NULL);
+	}
+
+	zassert_equal(test_binding_lookups, 0, "devices bound again: %d", test_binding_lookups);
+	zassert_equal(test_partition_opens, 0, "partitions opened again: %d",
+				  test_partition_opens);
+}
+
+void test_main(void)
+{
+	test_setup();
+
+	ztest_test_suite(flash_aspeed,
+					 ztest_unit_test(test_read_aligned_direct),
+					 ztest_unit_test(test_read_unaligned_address),
+					 ztest_unit_test(test_read_unaligned_buffer),
+					 ztest_unit_test(test_read_unaligned_end),
+					 ztest_unit_test(test_read_partition),
+					 ztest_unit_test(test_bindings_cached));
+
+	ztest_run_test_suite(flash_aspeed);
+}